@@ -96,6 +96,11 @@ do
             sample_build "PC" "linux" "build_pc_linux"
             exit_if_binary_does_not_exist "build_pc_linux" "iot-middleware-sample"
             exit_if_binary_does_not_exist "build_pc_linux" "iot-middleware-sample-pnp"
+
+            # Counts and heap peaks are checked exactly, stack against budgets
+            # and timings with loose tolerances, see benchmarks/README.md.
+            echo -e "::group::Running benchmarks for linux port"
+            cmake --build build_pc_linux --target run_benchmarks
             ;;
         * )
             echo "build for $arg not found";;
@@ -0,0 +1,159 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench.c
+ * @brief Measurement helpers and result collection of the benchmarks.
+ */
+
+#include "bench.h"
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* FreeRTOS */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief One result.
+ */
+typedef struct BenchResult
+{
+    char cName[ BENCH_MAX_NAME_LENGTH + 1 ];
+    char cUnit[ 8 ];
+    double xValue;
+    BenchBetter_t xBetter;
+} BenchResult_t;
+
+/**
+ * @brief Group being run by #Bench_RunGroup.
+ */
+typedef struct BenchGroup
+{
+    const char * pcName;
+    BenchGroupFunction_t xFunction;
+    TaskHandle_t xCaller;
+    bool xResult;
+} BenchGroup_t;
+
+static BenchResult_t xResults[ BENCH_MAX_RESULTS ];
+static uint32_t ulResultCount;
+/*-----------------------------------------------------------*/
+
+uint64_t Bench_NowUs( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( uint64_t ) xTime.tv_sec * 1000000U + ( uint64_t ) xTime.tv_nsec / 1000U;
+}
+/*-----------------------------------------------------------*/
+
+void Bench_Report( const char * pcName,
+                   double xValue,
+                   const char * pcUnit,
+                   BenchBetter_t xBetter )
+{
+    BenchResult_t * pxResult;
+
+    printf( "  %-48s %14.3f %s\n", pcName, xValue, pcUnit );
+
+    if( ulResultCount == BENCH_MAX_RESULTS )
+    {
+        printf( "Result table full, %s dropped\n", pcName );
+        return;
+    }
+
+    pxResult = &xResults[ ulResultCount++ ];
+    ( void ) snprintf( pxResult->cName, sizeof( pxResult->cName ), "%s", pcName );
+    ( void ) snprintf( pxResult->cUnit, sizeof( pxResult->cUnit ), "%s", pcUnit );
+    pxResult->xValue = xValue;
+    pxResult->xBetter = xBetter;
+}
+/*-----------------------------------------------------------*/
+
+static void prvGroupTask( void * pvParameters )
+{
+    BenchGroup_t * pxGroup = ( BenchGroup_t * ) pvParameters;
+    char cName[ BENCH_MAX_NAME_LENGTH + 1 ];
+    UBaseType_t uxStackLeft;
+
+    Bench_HeapResetPeak();
+
+    pxGroup->xResult = pxGroup->xFunction();
+
+    uxStackLeft = uxTaskGetStackHighWaterMark( NULL );
+    ( void ) snprintf( cName, sizeof( cName ), "%s_stack_bytes", pxGroup->pcName );
+    Bench_Report( cName, ( double ) ( ( BENCH_TASK_STACK_SIZE - uxStackLeft ) * sizeof( StackType_t ) ),
+                  "bytes", eBenchLowerIsBetter );
+
+    ( void ) snprintf( cName, sizeof( cName ), "%s_heap_peak_bytes", pxGroup->pcName );
+    Bench_Report( cName, ( double ) Bench_HeapPeak(), "bytes", eBenchLowerIsBetter );
+
+    ( void ) xTaskNotifyGive( pxGroup->xCaller );
+    vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+bool Bench_RunGroup( const char * pcGroup,
+                     BenchGroupFunction_t xFunction )
+{
+    BenchGroup_t xGroup =
+    {
+        .pcName    = pcGroup,
+        .xFunction = xFunction,
+        .xCaller   = xTaskGetCurrentTaskHandle(),
+        .xResult   = false
+    };
+
+    printf( "%s\n", pcGroup );
+
+    if( xTaskCreate( prvGroupTask, pcGroup, BENCH_TASK_STACK_SIZE, &xGroup,
+                     uxTaskPriorityGet( NULL ), NULL ) != pdPASS )
+    {
+        printf( "  cannot create the task\n" );
+        return false;
+    }
+
+    ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+    if( !xGroup.xResult )
+    {
+        printf( "  FAILED\n" );
+    }
+
+    return xGroup.xResult;
+}
+/*-----------------------------------------------------------*/
+
+bool Bench_WriteResults( const char * pcPath )
+{
+    FILE * pxFile = fopen( pcPath, "w" );
+    uint32_t ulIndex;
+
+    if( pxFile == NULL )
+    {
+        return false;
+    }
+
+    fprintf( pxFile, "{\n  \"results\": [\n" );
+
+    for( ulIndex = 0; ulIndex < ulResultCount; ulIndex++ )
+    {
+        fprintf( pxFile, "    { \"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\", \"better\": \"%s\" }%s\n",
+                 xResults[ ulIndex ].cName, xResults[ ulIndex ].xValue, xResults[ ulIndex ].cUnit,
+                 ( xResults[ ulIndex ].xBetter == eBenchLowerIsBetter ) ? "lower" : "higher",
+                 ( ulIndex + 1 < ulResultCount ) ? "," : "" );
+    }
+
+    fprintf( pxFile, "  ]\n}\n" );
+
+    return fclose( pxFile ) == 0;
+}
+/*-----------------------------------------------------------*/
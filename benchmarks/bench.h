@@ -0,0 +1,150 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench.h
+ * @brief Measurement helpers and result collection of the benchmarks.
+ *
+ * Every benchmark group runs in its own task so the stack high-water mark and
+ * the peak heap use of the group can be reported with its timings. Results
+ * are kept in a fixed table and written as JSON once all groups have run,
+ * see bench_compare.c for the format.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Most results of one run.
+ */
+#ifndef BENCH_MAX_RESULTS
+    #define BENCH_MAX_RESULTS          ( 96U )
+#endif
+
+/**
+ * @brief Longest result name, without the terminator.
+ */
+#define BENCH_MAX_NAME_LENGTH          ( 47U )
+
+/**
+ * @brief Stack of the task running a group, in words.
+ */
+#ifndef BENCH_TASK_STACK_SIZE
+    #define BENCH_TASK_STACK_SIZE      ( 8U * 1024U )
+#endif
+
+/**
+ * @brief Which way a result improves.
+ */
+typedef enum BenchBetter
+{
+    eBenchLowerIsBetter = 0,
+    eBenchHigherIsBetter
+} BenchBetter_t;
+
+/**
+ * @brief A group of measurements.
+ *
+ * @return false if the group failed, its results are then incomplete.
+ */
+typedef bool ( * BenchGroupFunction_t )( void );
+
+/**
+ * @brief Monotonic time of the host in microseconds.
+ */
+uint64_t Bench_NowUs( void );
+
+/**
+ * @brief Record a result.
+ *
+ * @param[in] pcName Name, unique within the run.
+ * @param[in] xValue Value.
+ * @param[in] pcUnit Unit, for example "us", "msg/s" or "bytes".
+ * @param[in] xBetter Which way the value improves.
+ */
+void Bench_Report( const char * pcName,
+                   double xValue,
+                   const char * pcUnit,
+                   BenchBetter_t xBetter );
+
+/**
+ * @brief Run a group in a task of its own and wait for it to finish.
+ *
+ * Records "<pcGroup>_stack_bytes" and "<pcGroup>_heap_peak_bytes" after the
+ * results of the group itself.
+ *
+ * @return The result of @p xFunction.
+ */
+bool Bench_RunGroup( const char * pcGroup,
+                     BenchGroupFunction_t xFunction );
+
+/**
+ * @brief Write all results to a file as JSON.
+ *
+ * @return false if the file could not be written.
+ */
+bool Bench_WriteResults( const char * pcPath );
+
+/**
+ * @brief Start tracking the peak heap use of the calling task.
+ *
+ * Memory allocated by other tasks, like the servers of the benchmarks, is not
+ * counted.
+ */
+void Bench_HeapResetPeak( void );
+
+/**
+ * @brief Most bytes the tracked task had allocated at once since
+ * #Bench_HeapResetPeak.
+ */
+size_t Bench_HeapPeak( void );
+
+/**
+ * @brief Start measuring the peak heap use of one operation of the tracked
+ * task, without affecting the peak of the group.
+ */
+void Bench_HeapStartWindow( void );
+
+/**
+ * @brief Most bytes the tracked task had allocated at once since
+ * #Bench_HeapStartWindow, above what it held at that call.
+ */
+size_t Bench_HeapWindowPeak( void );
+
+/**
+ * @brief Number of allocations made since start.
+ */
+uint32_t Bench_HeapAllocations( void );
+
+/**
+ * @brief Benchmark groups, one file each.
+ */
+bool BenchTls_Run( void );
+bool BenchCrypto_Run( void );
+bool BenchCompress_Run( void );
+bool BenchJson_Run( void );
+bool BenchHub_Run( void );
+bool BenchLog_Run( void );
+bool BenchReplay_Run( void );
+
+/**
+ * @brief Read the log of a recorded session for the replay group.
+ *
+ * @param[in] pcPath Log written by transport_capture.c.
+ * @param[in] ulSpeed Replay speed in percent, 0 without waiting.
+ *
+ * @return false if the file could not be read.
+ */
+bool BenchReplay_Load( const char * pcPath,
+                       uint32_t ulSpeed );
+
+/**
+ * @brief Whether a session was loaded, the replay group only runs then.
+ */
+bool BenchReplay_IsLoaded( void );
+
+#endif /* BENCH_H */
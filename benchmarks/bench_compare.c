@@ -0,0 +1,355 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_compare.c
+ * @brief Compare benchmark results with the checked-in baseline.
+ *
+ * Usage: bench_compare <baseline.json> <results.json> [--tolerance <percent>]
+ *
+ * Both files use the format written by the benchmarks:
+ *
+ *     { "results": [ { "name": "hmac_sha256_us", "value": 3.2, "unit": "us",
+ *                      "better": "lower", "tolerance": 15 }, ... ] }
+ *
+ * "tolerance" is optional and overrides the default in percent for one
+ * result. A baseline value of null has not been recorded yet and is only
+ * reported. Exits with 1 if a baseline result is missing from the results or
+ * is worse than the baseline by more than its tolerance.
+ *
+ * Runs on the host, without FreeRTOS.
+ */
+
+/* Standard includes. */
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*-----------------------------------------------------------*/
+
+#define compareMAX_RESULTS              ( 256 )
+#define compareMAX_NAME_LENGTH          ( 63 )
+#define compareDEFAULT_TOLERANCE_PCT    ( 10.0 )
+
+typedef struct CompareResult
+{
+    char cName[ compareMAX_NAME_LENGTH + 1 ];
+    double xValue;
+    double xTolerance;     /**< @brief Percent, negative if not given. */
+    bool xHasValue;
+    bool xHigherIsBetter;
+} CompareResult_t;
+
+typedef struct CompareFile
+{
+    CompareResult_t xResults[ compareMAX_RESULTS ];
+    size_t xCount;
+} CompareFile_t;
+
+static CompareFile_t xBaseline;
+static CompareFile_t xCurrent;
+/*-----------------------------------------------------------*/
+
+static const char * prvSkipSpace( const char * pcText )
+{
+    while( isspace( ( unsigned char ) *pcText ) )
+    {
+        pcText++;
+    }
+
+    return pcText;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read a JSON string without escapes into a buffer.
+ *
+ * @return The text after the string, or NULL.
+ */
+static const char * prvParseString( const char * pcText,
+                                    char * pcOutput,
+                                    size_t xOutputSize )
+{
+    size_t xLength = 0;
+
+    if( *pcText++ != '"' )
+    {
+        return NULL;
+    }
+
+    while( ( *pcText != '"' ) && ( *pcText != '\0' ) && ( *pcText != '\\' ) )
+    {
+        if( xLength + 1 < xOutputSize )
+        {
+            pcOutput[ xLength++ ] = *pcText;
+        }
+
+        pcText++;
+    }
+
+    pcOutput[ xLength ] = '\0';
+
+    return ( *pcText == '"' ) ? pcText + 1 : NULL;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read one result object.
+ *
+ * @return The text after the object, or NULL.
+ */
+static const char * prvParseResult( const char * pcText,
+                                    CompareResult_t * pxResult )
+{
+    char cKey[ 16 ];
+    char cText[ compareMAX_NAME_LENGTH + 1 ];
+    char * pcEnd;
+    double xNumber;
+
+    memset( pxResult, 0, sizeof( *pxResult ) );
+    pxResult->xTolerance = -1.0;
+    pcText = prvSkipSpace( pcText + 1 );
+
+    while( *pcText != '}' )
+    {
+        if( ( ( pcText = prvParseString( pcText, cKey, sizeof( cKey ) ) ) == NULL ) ||
+            ( *( pcText = prvSkipSpace( pcText ) ) != ':' ) )
+        {
+            return NULL;
+        }
+
+        pcText = prvSkipSpace( pcText + 1 );
+
+        if( *pcText == '"' )
+        {
+            if( ( pcText = prvParseString( pcText, cText, sizeof( cText ) ) ) == NULL )
+            {
+                return NULL;
+            }
+
+            if( strcmp( cKey, "name" ) == 0 )
+            {
+                strcpy( pxResult->cName, cText );
+            }
+            else if( strcmp( cKey, "better" ) == 0 )
+            {
+                pxResult->xHigherIsBetter = ( strcmp( cText, "higher" ) == 0 );
+            }
+        }
+        else if( strncmp( pcText, "null", 4 ) == 0 )
+        {
+            pcText += 4;
+        }
+        else
+        {
+            xNumber = strtod( pcText, &pcEnd );
+
+            if( pcEnd == pcText )
+            {
+                return NULL;
+            }
+
+            pcText = pcEnd;
+
+            if( strcmp( cKey, "value" ) == 0 )
+            {
+                pxResult->xValue = xNumber;
+                pxResult->xHasValue = true;
+            }
+            else if( strcmp( cKey, "tolerance" ) == 0 )
+            {
+                pxResult->xTolerance = xNumber;
+            }
+        }
+
+        pcText = prvSkipSpace( pcText );
+
+        if( *pcText == ',' )
+        {
+            pcText = prvSkipSpace( pcText + 1 );
+        }
+        else if( *pcText != '}' )
+        {
+            return NULL;
+        }
+    }
+
+    return ( pxResult->cName[ 0 ] != '\0' ) ? pcText + 1 : NULL;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvLoad( const char * pcPath,
+                     CompareFile_t * pxFile )
+{
+    FILE * pxStream = fopen( pcPath, "rb" );
+    char * pcContent;
+    const char * pcText;
+    long lSize;
+    bool xResult = false;
+
+    if( pxStream == NULL )
+    {
+        fprintf( stderr, "Cannot open %s\n", pcPath );
+
+        return false;
+    }
+
+    if( ( fseek( pxStream, 0, SEEK_END ) == 0 ) &&
+        ( ( lSize = ftell( pxStream ) ) >= 0 ) &&
+        ( fseek( pxStream, 0, SEEK_SET ) == 0 ) &&
+        ( ( pcContent = malloc( ( size_t ) lSize + 1 ) ) != NULL ) )
+    {
+        pcContent[ fread( pcContent, 1, ( size_t ) lSize, pxStream ) ] = '\0';
+        pcText = strstr( pcContent, "\"results\"" );
+        pcText = ( pcText != NULL ) ? strchr( pcText, '[' ) : NULL;
+
+        if( pcText != NULL )
+        {
+            pcText = prvSkipSpace( pcText + 1 );
+            xResult = true;
+
+            while( xResult && ( *pcText == '{' ) && ( pxFile->xCount < compareMAX_RESULTS ) )
+            {
+                pcText = prvParseResult( pcText, &pxFile->xResults[ pxFile->xCount ] );
+
+                if( pcText == NULL )
+                {
+                    xResult = false;
+                }
+                else
+                {
+                    pxFile->xCount++;
+                    pcText = prvSkipSpace( pcText );
+                    pcText = prvSkipSpace( ( *pcText == ',' ) ? pcText + 1 : pcText );
+                }
+            }
+
+            xResult = xResult && ( *pcText == ']' );
+        }
+
+        free( pcContent );
+    }
+
+    fclose( pxStream );
+
+    if( !xResult )
+    {
+        fprintf( stderr, "Cannot parse %s\n", pcPath );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+static const CompareResult_t * prvFind( const CompareFile_t * pxFile,
+                                        const char * pcName )
+{
+    size_t xIndex;
+
+    for( xIndex = 0; xIndex < pxFile->xCount; xIndex++ )
+    {
+        if( strcmp( pxFile->xResults[ xIndex ].cName, pcName ) == 0 )
+        {
+            return &pxFile->xResults[ xIndex ];
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    const CompareResult_t * pxBase;
+    const CompareResult_t * pxResult;
+    double xDefaultTolerance = compareDEFAULT_TOLERANCE_PCT;
+    double xTolerance;
+    double xChange;
+    double xWorse;
+    size_t xIndex;
+    const char * pcStatus;
+    int lFailures = 0;
+
+    if( ( argc == 5 ) && ( strcmp( argv[ 3 ], "--tolerance" ) == 0 ) )
+    {
+        xDefaultTolerance = atof( argv[ 4 ] );
+    }
+    else if( argc != 3 )
+    {
+        fprintf( stderr, "Usage: %s <baseline.json> <results.json> [--tolerance <percent>]\n", argv[ 0 ] );
+
+        return 2;
+    }
+
+    if( !prvLoad( argv[ 1 ], &xBaseline ) || !prvLoad( argv[ 2 ], &xCurrent ) )
+    {
+        return 2;
+    }
+
+    printf( "%-40s %14s %14s %9s  %s\n", "name", "baseline", "result", "change", "status" );
+
+    for( xIndex = 0; xIndex < xBaseline.xCount; xIndex++ )
+    {
+        pxBase = &xBaseline.xResults[ xIndex ];
+        pxResult = prvFind( &xCurrent, pxBase->cName );
+        xTolerance = ( pxBase->xTolerance >= 0.0 ) ? pxBase->xTolerance : xDefaultTolerance;
+
+        if( ( pxResult == NULL ) || !pxResult->xHasValue )
+        {
+            printf( "%-40s %14s %14s %9s  MISSING\n", pxBase->cName, "", "", "" );
+            lFailures++;
+            continue;
+        }
+
+        if( !pxBase->xHasValue )
+        {
+            printf( "%-40s %14s %14.3f %9s  not recorded\n", pxBase->cName, "null", pxResult->xValue, "" );
+            continue;
+        }
+
+        /* Compared in absolute terms, so a regression from a baseline of 0,
+         * such as allocations per message, is not hidden by a zero division. */
+        xWorse = pxBase->xHigherIsBetter ? ( pxBase->xValue - pxResult->xValue ) :
+                 ( pxResult->xValue - pxBase->xValue );
+
+        if( xWorse > ( fabs( pxBase->xValue ) * xTolerance / 100.0 ) )
+        {
+            pcStatus = "REGRESSED";
+            lFailures++;
+        }
+        else
+        {
+            pcStatus = "ok";
+        }
+
+        if( pxBase->xValue != 0.0 )
+        {
+            xChange = ( pxResult->xValue - pxBase->xValue ) * 100.0 / fabs( pxBase->xValue );
+            printf( "%-40s %14.3f %14.3f %+8.1f%%  %s\n", pxBase->cName, pxBase->xValue, pxResult->xValue,
+                    xChange, pcStatus );
+        }
+        else
+        {
+            printf( "%-40s %14.3f %14.3f %9s  %s\n", pxBase->cName, pxBase->xValue, pxResult->xValue,
+                    "", pcStatus );
+        }
+    }
+
+    for( xIndex = 0; xIndex < xCurrent.xCount; xIndex++ )
+    {
+        if( prvFind( &xBaseline, xCurrent.xResults[ xIndex ].cName ) == NULL )
+        {
+            printf( "%-40s %14s %14.3f %9s  new, not in the baseline\n", xCurrent.xResults[ xIndex ].cName, "",
+                    xCurrent.xResults[ xIndex ].xValue, "" );
+        }
+    }
+
+    printf( "%d result(s) missing or beyond tolerance\n", lFailures );
+
+    return ( lFailures == 0 ) ? 0 : 1;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,236 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_compress.c
+ * @brief Telemetry compression of lz_dict.c.
+ *
+ * Times compression and decompression of the PnP telemetry with the
+ * dictionary of sample_azure_iot_pnp_simulated_data.c, then round trips
+ * generated inputs, checking every output against #LZ_DICT_COMPRESS_BOUND.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "lz_dict.h"
+#include "sample_azure_iot_pnp_data_if.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Operations timed for each result.
+ */
+#ifndef benchCOMPRESS_ITERATIONS
+    #define benchCOMPRESS_ITERATIONS     ( 20000U )
+#endif
+
+/**
+ * @brief Generated inputs round tripped.
+ */
+#ifndef benchCOMPRESS_FUZZ_CASES
+    #define benchCOMPRESS_FUZZ_CASES     ( 20000U )
+#endif
+
+#define benchCOMPRESS_MAX_INPUT          ( 1024U )
+#define benchCOMPRESS_MAX_DICTIONARY     ( 256U )
+
+/**
+ * @brief Kinds of generated input.
+ */
+typedef enum BenchCompressInput
+{
+    eBenchCompressRandom = 0,     /**< Random bytes, incompressible. */
+    eBenchCompressSmallAlphabet,  /**< Few distinct bytes, many short matches. */
+    eBenchCompressShortMatches,   /**< One literal, then a 3 or 4 byte repeat, the worst case of the format. */
+    eBenchCompressDictionary,     /**< Pieces of the dictionary with random bytes between them. */
+    eBenchCompressInputCount
+} BenchCompressInput_t;
+
+static LZDictContext_t xContext;
+static uint8_t ucDictionary[ benchCOMPRESS_MAX_DICTIONARY ];
+static uint8_t ucInput[ benchCOMPRESS_MAX_INPUT ];
+static uint8_t ucCompressed[ LZ_DICT_COMPRESS_BOUND( benchCOMPRESS_MAX_INPUT ) ];
+static uint8_t ucOutput[ benchCOMPRESS_MAX_INPUT ];
+static uint32_t ulRandomState = 1;
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( void )
+{
+    /* xorshift32, the same inputs on every run. */
+    ulRandomState ^= ulRandomState << 13;
+    ulRandomState ^= ulRandomState >> 17;
+    ulRandomState ^= ulRandomState << 5;
+
+    return ulRandomState;
+}
+/*-----------------------------------------------------------*/
+
+static void prvGenerate( BenchCompressInput_t xKind,
+                         uint32_t ulDictionaryLength,
+                         uint32_t ulLength )
+{
+    uint32_t ulIndex = 0;
+    uint32_t ulPiece;
+    uint32_t ulStart;
+
+    while( ulIndex < ulLength )
+    {
+        switch( xKind )
+        {
+            case eBenchCompressSmallAlphabet:
+                ucInput[ ulIndex++ ] = ( uint8_t ) ( 'a' + prvRandom() % 3U );
+                break;
+
+            case eBenchCompressShortMatches:
+
+                /* "xabc" then "yabc" then "zabc" ... every repeat is preceded
+                 * by a new literal. */
+                ucInput[ ulIndex++ ] = ( uint8_t ) prvRandom();
+
+                for( ulPiece = 0; ( ulPiece < 3U + ( prvRandom() & 1U ) ) && ( ulIndex < ulLength ); ulPiece++ )
+                {
+                    ucInput[ ulIndex++ ] = ( uint8_t ) ( 'a' + ulPiece );
+                }
+
+                break;
+
+            case eBenchCompressDictionary:
+
+                if( ( ulDictionaryLength > 0 ) && ( ( prvRandom() & 3U ) != 0 ) )
+                {
+                    ulStart = prvRandom() % ulDictionaryLength;
+
+                    for( ulPiece = 1U + prvRandom() % 16U;
+                         ( ulPiece > 0 ) && ( ulStart < ulDictionaryLength ) && ( ulIndex < ulLength );
+                         ulPiece-- )
+                    {
+                        ucInput[ ulIndex++ ] = ucDictionary[ ulStart++ ];
+                    }
+                }
+                else
+                {
+                    ucInput[ ulIndex++ ] = ( uint8_t ) prvRandom();
+                }
+
+                break;
+
+            default:
+                ucInput[ ulIndex++ ] = ( uint8_t ) prvRandom();
+                break;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Compress and decompress generated inputs of every kind and length up
+ * to #benchCOMPRESS_MAX_INPUT, with and without a dictionary.
+ *
+ * The compressed data must fit in exactly #LZ_DICT_COMPRESS_BOUND bytes and
+ * decompress to the input.
+ *
+ * @return Number of inputs which failed.
+ */
+static uint32_t prvFuzz( uint32_t * pulWorstOverhead )
+{
+    uint32_t ulCase;
+    uint32_t ulIndex;
+    uint32_t ulDictionaryLength;
+    uint32_t ulLength;
+    uint32_t ulCompressedLength;
+    uint32_t ulOutputLength;
+    uint32_t ulFailures = 0;
+
+    *pulWorstOverhead = 0;
+
+    for( ulCase = 0; ulCase < benchCOMPRESS_FUZZ_CASES; ulCase++ )
+    {
+        ulDictionaryLength = ( ( ulCase & 1U ) != 0 ) ? prvRandom() % ( benchCOMPRESS_MAX_DICTIONARY + 1U ) : 0U;
+        ulLength = prvRandom() % ( benchCOMPRESS_MAX_INPUT + 1U );
+
+        for( ulIndex = 0; ulIndex < ulDictionaryLength; ulIndex++ )
+        {
+            ucDictionary[ ulIndex ] = ( uint8_t ) ( 'a' + prvRandom() % 8U );
+        }
+
+        prvGenerate( ( BenchCompressInput_t ) ( ( ulCase >> 1 ) % eBenchCompressInputCount ), ulDictionaryLength, ulLength );
+
+        if( ( LZDict_Compress( &xContext, ucDictionary, ulDictionaryLength, ucInput, ulLength,
+                               ucCompressed, LZ_DICT_COMPRESS_BOUND( ulLength ),
+                               &ulCompressedLength ) != eLZDictSuccess ) ||
+            ( LZDict_Decompress( ucDictionary, ulDictionaryLength, ucCompressed, ulCompressedLength,
+                                 ucOutput, sizeof( ucOutput ), &ulOutputLength ) != eLZDictSuccess ) ||
+            ( ulOutputLength != ulLength ) ||
+            ( memcmp( ucOutput, ucInput, ulLength ) != 0 ) )
+        {
+            printf( "Round trip failed: case %u, kind %u, dictionary %u bytes, input %u bytes\n",
+                    ( unsigned ) ulCase, ( unsigned ) ( ( ulCase >> 1 ) % eBenchCompressInputCount ),
+                    ( unsigned ) ulDictionaryLength, ( unsigned ) ulLength );
+            ulFailures++;
+        }
+        else if( ulCompressedLength > ulLength + *pulWorstOverhead )
+        {
+            *pulWorstOverhead = ulCompressedLength - ulLength;
+        }
+    }
+
+    return ulFailures;
+}
+/*-----------------------------------------------------------*/
+
+bool BenchCompress_Run( void )
+{
+    const uint8_t * pucTelemetryDictionary;
+    uint8_t ucTelemetry[ 128 ];
+    uint32_t ulTelemetryDictionaryLength = ulGetTelemetryDictionary( &pucTelemetryDictionary );
+    uint32_t ulTelemetryLength;
+    uint32_t ulCompressedLength = 0;
+    uint32_t ulOutputLength = 0;
+    uint32_t ulWorstOverhead;
+    uint32_t ulFailures;
+    uint32_t ulIndex;
+    uint64_t ullStartUs;
+    bool xResult = ( ulCreateTelemetry( ucTelemetry, sizeof( ucTelemetry ), &ulTelemetryLength ) == 0 );
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchCOMPRESS_ITERATIONS ); ulIndex++ )
+    {
+        xResult = ( LZDict_Compress( &xContext, pucTelemetryDictionary, ulTelemetryDictionaryLength,
+                                     ucTelemetry, ulTelemetryLength, ucCompressed, sizeof( ucCompressed ),
+                                     &ulCompressedLength ) == eLZDictSuccess );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "compress_telemetry_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchCOMPRESS_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+        Bench_Report( "compress_telemetry_bytes", ( double ) ulCompressedLength, "bytes", eBenchLowerIsBetter );
+    }
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchCOMPRESS_ITERATIONS ); ulIndex++ )
+    {
+        xResult = ( LZDict_Decompress( pucTelemetryDictionary, ulTelemetryDictionaryLength,
+                                       ucCompressed, ulCompressedLength, ucOutput, sizeof( ucOutput ),
+                                       &ulOutputLength ) == eLZDictSuccess ) &&
+                  ( ulOutputLength == ulTelemetryLength );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "decompress_telemetry_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchCOMPRESS_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    ulFailures = prvFuzz( &ulWorstOverhead );
+    Bench_Report( "compress_fuzz_failures", ( double ) ulFailures, "inputs", eBenchLowerIsBetter );
+    Bench_Report( "compress_worst_overhead_bytes", ( double ) ulWorstOverhead, "bytes", eBenchLowerIsBetter );
+
+    return xResult && ( ulFailures == 0 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,135 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_crypto.c
+ * @brief HMAC and SAS token signing of the symmetric key authentication.
+ *
+ * The SAS signature follows what the middleware computes on connect: decode
+ * the base64 device key, HMAC-SHA256 the string to sign, then base64 and URL
+ * encode the result.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* mbed TLS */
+#include "mbedtls/base64.h"
+
+#include "bench.h"
+#include "crypto.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Operations timed for each result.
+ */
+#ifndef benchCRYPTO_ITERATIONS
+    #define benchCRYPTO_ITERATIONS    ( 2000U )
+#endif
+
+/**
+ * @brief Sample device key and string to sign, the sizes a device uses.
+ */
+#define benchCRYPTO_DEVICE_KEY        "dGhpcyBpcyBhIHNhbXBsZSBkZXZpY2Uga2V5IGZvciBiZW5jaG1hcmtzIG9ubHk="
+#define benchCRYPTO_STRING_TO_SIGN    "contoso-hub.azure-devices.net%2Fdevices%2Fthermostat-0001\n1700000000"
+/*-----------------------------------------------------------*/
+
+static uint32_t prvUrlEncode( const uint8_t * pucInput,
+                              size_t xInputLength,
+                              char * pcOutput,
+                              size_t xOutputSize )
+{
+    size_t xIndex;
+    uint32_t ulLength = 0;
+
+    for( xIndex = 0; xIndex < xInputLength; xIndex++ )
+    {
+        if( ( pucInput[ xIndex ] == '+' ) || ( pucInput[ xIndex ] == '/' ) || ( pucInput[ xIndex ] == '=' ) )
+        {
+            if( ulLength + 3 >= xOutputSize )
+            {
+                return 0;
+            }
+
+            ulLength += ( uint32_t ) snprintf( pcOutput + ulLength, xOutputSize - ulLength, "%%%02X", pucInput[ xIndex ] );
+        }
+        else
+        {
+            if( ulLength + 1 >= xOutputSize )
+            {
+                return 0;
+            }
+
+            pcOutput[ ulLength++ ] = ( char ) pucInput[ xIndex ];
+        }
+    }
+
+    pcOutput[ ulLength ] = '\0';
+
+    return ulLength;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvSignSas( char * pcSignature,
+                        size_t xSignatureSize )
+{
+    uint8_t ucKey[ 64 ];
+    uint8_t ucHmac[ 32 ];
+    uint8_t ucBase64[ 48 ];
+    size_t xKeyLength;
+    size_t xBase64Length;
+    uint32_t ulHmacLength;
+
+    return ( mbedtls_base64_decode( ucKey, sizeof( ucKey ), &xKeyLength,
+                                    ( const uint8_t * ) benchCRYPTO_DEVICE_KEY,
+                                    sizeof( benchCRYPTO_DEVICE_KEY ) - 1 ) == 0 ) &&
+           ( Crypto_HMAC( ucKey, ( uint32_t ) xKeyLength,
+                          ( const uint8_t * ) benchCRYPTO_STRING_TO_SIGN, sizeof( benchCRYPTO_STRING_TO_SIGN ) - 1,
+                          ucHmac, sizeof( ucHmac ), &ulHmacLength ) == 0 ) &&
+           ( mbedtls_base64_encode( ucBase64, sizeof( ucBase64 ), &xBase64Length, ucHmac, ulHmacLength ) == 0 ) &&
+           ( prvUrlEncode( ucBase64, xBase64Length, pcSignature, xSignatureSize ) != 0 );
+}
+/*-----------------------------------------------------------*/
+
+bool BenchCrypto_Run( void )
+{
+    uint8_t ucHmac[ 32 ];
+    char cSignature[ 96 ];
+    uint32_t ulHmacLength;
+    uint32_t ulIndex;
+    uint64_t ullStartUs;
+    bool xResult = true;
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchCRYPTO_ITERATIONS ); ulIndex++ )
+    {
+        xResult = ( Crypto_HMAC( ( const uint8_t * ) benchCRYPTO_DEVICE_KEY, sizeof( benchCRYPTO_DEVICE_KEY ) - 1,
+                                 ( const uint8_t * ) benchCRYPTO_STRING_TO_SIGN, sizeof( benchCRYPTO_STRING_TO_SIGN ) - 1,
+                                 ucHmac, sizeof( ucHmac ), &ulHmacLength ) == 0 );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "hmac_sha256_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchCRYPTO_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchCRYPTO_ITERATIONS ); ulIndex++ )
+    {
+        xResult = prvSignSas( cSignature, sizeof( cSignature ) );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "sas_signature_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchCRYPTO_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
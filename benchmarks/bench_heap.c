@@ -0,0 +1,144 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_heap.c
+ * @brief FreeRTOS heap of the benchmarks, in place of heap_3.
+ *
+ * Wraps the C library allocator like heap_3 does and keeps the number of
+ * bytes in use by one task, so the peak of each benchmark group can be
+ * reported without the in-process servers it talks to.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+
+/* FreeRTOS */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "bench.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Placed before every block, sized to keep the block aligned.
+ */
+typedef union BenchHeapHeader
+{
+    struct
+    {
+        size_t xSize;
+        TaskHandle_t xOwner;     /**< @brief Tracked task which allocated the block, or NULL. */
+    } xBlock;
+    long double xAlign;
+} BenchHeapHeader_t;
+
+static TaskHandle_t xTrackedTask;
+static size_t xBytesInUse;
+static size_t xPeakBytes;
+static size_t xWindowStartBytes;
+static size_t xWindowPeakBytes;
+static uint32_t ulAllocations;
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xWantedSize )
+{
+    BenchHeapHeader_t * pxHeader;
+
+    vTaskSuspendAll();
+    {
+        pxHeader = malloc( sizeof( BenchHeapHeader_t ) + xWantedSize );
+
+        if( pxHeader != NULL )
+        {
+            pxHeader->xBlock.xSize = xWantedSize;
+            pxHeader->xBlock.xOwner = ( xTaskGetCurrentTaskHandle() == xTrackedTask ) ? xTrackedTask : NULL;
+            ulAllocations++;
+
+            if( pxHeader->xBlock.xOwner != NULL )
+            {
+                xBytesInUse += xWantedSize;
+
+                if( xBytesInUse > xPeakBytes )
+                {
+                    xPeakBytes = xBytesInUse;
+                }
+
+                if( xBytesInUse > xWindowPeakBytes )
+                {
+                    xWindowPeakBytes = xBytesInUse;
+                }
+            }
+        }
+    }
+    ( void ) xTaskResumeAll();
+
+    return ( pxHeader != NULL ) ? ( void * ) ( pxHeader + 1 ) : NULL;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    BenchHeapHeader_t * pxHeader;
+
+    if( pv != NULL )
+    {
+        pxHeader = ( ( BenchHeapHeader_t * ) pv ) - 1;
+
+        vTaskSuspendAll();
+        {
+            if( ( pxHeader->xBlock.xOwner != NULL ) && ( pxHeader->xBlock.xOwner == xTrackedTask ) )
+            {
+                xBytesInUse -= pxHeader->xBlock.xSize;
+            }
+
+            free( pxHeader );
+        }
+        ( void ) xTaskResumeAll();
+    }
+}
+/*-----------------------------------------------------------*/
+
+void Bench_HeapResetPeak( void )
+{
+    vTaskSuspendAll();
+    {
+        xTrackedTask = xTaskGetCurrentTaskHandle();
+        xBytesInUse = 0;
+        xPeakBytes = 0;
+        xWindowStartBytes = 0;
+        xWindowPeakBytes = 0;
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+size_t Bench_HeapPeak( void )
+{
+    return xPeakBytes;
+}
+/*-----------------------------------------------------------*/
+
+void Bench_HeapStartWindow( void )
+{
+    vTaskSuspendAll();
+    {
+        xWindowStartBytes = xBytesInUse;
+        xWindowPeakBytes = xBytesInUse;
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+size_t Bench_HeapWindowPeak( void )
+{
+    return xWindowPeakBytes - xWindowStartBytes;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t Bench_HeapAllocations( void )
+{
+    return ulAllocations;
+}
+/*-----------------------------------------------------------*/
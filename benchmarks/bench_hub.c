@@ -0,0 +1,464 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_hub.c
+ * @brief Hub client cost per message over the loopback transport.
+ *
+ * transport_loopback.c answers the client and injects messages from the hub
+ * in memory, so the results are the CPU of the client alone. TLS is left out,
+ * see bench_tls.c for its cost.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "bench.h"
+#include "hub_session.h"
+#include "hub_subscribe.h"
+#include "sample_azure_iot_pnp_data_if.h"
+#include "transport_loopback.h"
+
+/*-----------------------------------------------------------*/
+
+#ifndef benchHUB_CONNECTS
+    #define benchHUB_CONNECTS          ( 200U )
+#endif
+
+#ifndef benchHUB_MESSAGES
+    #define benchHUB_MESSAGES          ( 20000U )
+#endif
+
+#define benchHUB_HOSTNAME              "contoso-hub.azure-devices.net"
+#define benchHUB_DEVICE_ID             "thermostat-0001"
+#define benchHUB_CONNACK_TIMEOUT_MS    ( 1000U )
+
+#define benchHUB_SUBSCRIBE_TIMEOUT_MS  ( 1000U )
+
+#ifndef benchHUB_RECONNECTS
+    #define benchHUB_RECONNECTS        ( 200U )
+#endif
+
+/**
+ * @brief Process loops allowed for one injected message.
+ */
+#define benchHUB_MAX_LOOPS             ( 4U )
+
+#define benchHUB_COMMAND_NAME          "getMaxMinReport"
+#define benchHUB_COMMAND_PAYLOAD       "\"2023-01-10T09:00:00Z\""
+#define benchHUB_C2D_PAYLOAD           "{\"message\":\"hello\"}"
+#define benchHUB_DESIRED_PROPERTIES    "{\"targetTemperature\":23.5}"
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    LoopbackTransportParams_t * pParams;
+};
+
+static LoopbackTransportParams_t xLoopback;
+static uint8_t ucMQTTMessageBuffer[ 2048 ];
+static uint32_t ulMessagesHandled;
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
+                              void * pvContext )
+{
+    uint8_t ucResponse[ 256 ];
+    uint32_t ulStatus;
+    uint32_t ulLength = ulHandleCommand( pxMessage, &ulStatus, ucResponse, sizeof( ucResponse ) );
+
+    ( void ) pvContext;
+
+    if( AzureIoTHubClient_SendCommandResponse( &xAzureIoTHubClient, pxMessage, ulStatus,
+                                               ucResponse, ulLength ) == eAzureIoTSuccess )
+    {
+        ulMessagesHandled++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleCloudToDevice( AzureIoTHubClientCloudToDeviceMessageRequest_t * pxMessage,
+                                    void * pvContext )
+{
+    ( void ) pxMessage;
+    ( void ) pvContext;
+
+    ulMessagesHandled++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleProperties( AzureIoTHubClientPropertiesResponse_t * pxMessage,
+                                 void * pvContext )
+{
+    uint8_t ucResponse[ 256 ];
+    uint32_t ulLength = 0;
+
+    ( void ) pvContext;
+
+    /* Responses to reported properties are not counted, the benchmark waits
+     * for the message it injected. */
+    if( pxMessage->xMessageType == eAzureIoTHubPropertiesRequestedMessage )
+    {
+        ulMessagesHandled++;
+    }
+
+    if( pxMessage->xMessageType != eAzureIoTHubPropertiesWritablePropertyMessage )
+    {
+        return;
+    }
+
+    vHandleWritableProperties( pxMessage, ucResponse, sizeof( ucResponse ), &ulLength );
+
+    if( ( ulLength != 0 ) &&
+        ( AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient, ucResponse, ulLength, NULL ) == eAzureIoTSuccess ) )
+    {
+        ulMessagesHandled++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static bool prvConnect( void )
+{
+    bool xSessionPresent;
+
+    Loopback_Init( &xLoopback, benchHUB_DEVICE_ID, NULL );
+
+    return AzureIoTHubClient_Connect( &xAzureIoTHubClient, false, &xSessionPresent,
+                                      benchHUB_CONNACK_TIMEOUT_MS ) == eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send telemetry and report the messages per second.
+ */
+static bool prvSendTelemetry( AzureIoTHubMessageQoS_t xQOS,
+                              const char * pcName )
+{
+    uint8_t ucPayload[ 128 ];
+    uint32_t ulPayloadLength;
+    uint32_t ulIndex;
+    uint64_t ullStartUs;
+    size_t xBytesFromClient = xLoopback.xStats.xBytesFromClient;
+    uint32_t ulAllocations = Bench_HeapAllocations();
+    bool xResult = ( ulCreateTelemetry( ucPayload, sizeof( ucPayload ), &ulPayloadLength ) == 0 );
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchHUB_MESSAGES ); ulIndex++ )
+    {
+        xResult = ( AzureIoTHubClient_SendTelemetry( &xAzureIoTHubClient, ucPayload, ulPayloadLength,
+                                                     NULL, xQOS, NULL ) == eAzureIoTSuccess ) &&
+                  ( AzureIoTHubClient_ProcessLoop( &xAzureIoTHubClient, 0 ) == eAzureIoTSuccess );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( pcName, ( double ) benchHUB_MESSAGES * 1000000.0 / ( double ) ( Bench_NowUs() - ullStartUs ),
+                      "msg/s", eBenchHigherIsBetter );
+    }
+
+    if( xResult && ( xQOS == eAzureIoTHubMessageQoS1 ) )
+    {
+        Bench_Report( "hub_telemetry_bytes_per_msg",
+                      ( double ) ( xLoopback.xStats.xBytesFromClient - xBytesFromClient ) / benchHUB_MESSAGES,
+                      "bytes", eBenchLowerIsBetter );
+        Bench_Report( "hub_telemetry_allocs_per_msg",
+                      ( double ) ( Bench_HeapAllocations() - ulAllocations ) / benchHUB_MESSAGES,
+                      "allocs", eBenchLowerIsBetter );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Inject messages from the hub and report the time the client takes
+ * to handle each, including its response.
+ *
+ * A message may wait behind the response to the previous one, the process
+ * loop runs until it is handled.
+ */
+static bool prvReceive( const char * pcName,
+                        bool ( * xInject )( uint32_t ulIndex ) )
+{
+    uint32_t ulIndex;
+    uint32_t ulLoops;
+    uint64_t ullStartUs;
+    bool xResult = true;
+
+    ulMessagesHandled = 0;
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchHUB_MESSAGES ); ulIndex++ )
+    {
+        xResult = xInject( ulIndex );
+
+        for( ulLoops = 0; xResult && ( ulMessagesHandled <= ulIndex ) && ( ulLoops < benchHUB_MAX_LOOPS ); ulLoops++ )
+        {
+            xResult = ( AzureIoTHubClient_ProcessLoop( &xAzureIoTHubClient, 0 ) == eAzureIoTSuccess );
+        }
+
+        xResult = xResult && ( ulMessagesHandled == ulIndex + 1 );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( pcName, ( double ) ( Bench_NowUs() - ullStartUs ) / benchHUB_MESSAGES,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Subscribe to commands, cloud to device messages and properties, one
+ * feature after the other with the middleware, then all at once with
+ * hub_subscribe.c, and report the round trips each took.
+ *
+ * The loopback peer answers before the send returns, so a round trip is a
+ * read of the client which gets the answer to what it sent since its
+ * previous read.
+ */
+static bool prvSubscribe( void )
+{
+    HubSubscriptions_t xSubscriptions = { 0 };
+    uint32_t ulRoundTrips = xLoopback.xStats.ulRoundTrips;
+    bool xResult;
+
+    xResult = ( AzureIoTHubClient_SubscribeCommand( &xAzureIoTHubClient, prvHandleCommand, NULL,
+                                                    benchHUB_SUBSCRIBE_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_SubscribeCloudToDeviceMessage( &xAzureIoTHubClient, prvHandleCloudToDevice, NULL,
+                                                                 benchHUB_SUBSCRIBE_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_SubscribeProperties( &xAzureIoTHubClient, prvHandleProperties, NULL,
+                                                       benchHUB_SUBSCRIBE_TIMEOUT_MS ) == eAzureIoTSuccess );
+
+    if( !xResult )
+    {
+        return false;
+    }
+
+    Bench_Report( "hub_subscribe_serial_round_trips", ( double ) ( xLoopback.xStats.ulRoundTrips - ulRoundTrips ),
+                  "round trips", eBenchLowerIsBetter );
+
+    xResult = ( AzureIoTHubClient_UnsubscribeCommand( &xAzureIoTHubClient ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_UnsubscribeCloudToDeviceMessage( &xAzureIoTHubClient ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_UnsubscribeProperties( &xAzureIoTHubClient ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_ProcessLoop( &xAzureIoTHubClient, 0 ) == eAzureIoTSuccess );
+
+    if( !xResult )
+    {
+        return false;
+    }
+
+    /* The messages received afterwards go through the receive handlers
+     * installed by the batch. */
+    xSubscriptions.xCommandCallback = prvHandleCommand;
+    xSubscriptions.xCloudToDeviceMessageCallback = prvHandleCloudToDevice;
+    xSubscriptions.xPropertiesCallback = prvHandleProperties;
+    xSubscriptions.ulSubscribeTimeoutMs = benchHUB_SUBSCRIBE_TIMEOUT_MS;
+    ulRoundTrips = xLoopback.xStats.ulRoundTrips;
+
+    if( HubSubscribe_All( &xAzureIoTHubClient, &xSubscriptions, NULL ) != eAzureIoTSuccess )
+    {
+        return false;
+    }
+
+    Bench_Report( "hub_subscribe_batch_round_trips", ( double ) ( xLoopback.xStats.ulRoundTrips - ulRoundTrips ),
+                  "round trips", eBenchLowerIsBetter );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Report the cost of each reconnect since the given counters.
+ */
+static void prvReportReconnects( const char * pcSubscribesName,
+                                 const char * pcRoundTripsName,
+                                 const char * pcLatencyName,
+                                 uint32_t ulSubscribes,
+                                 uint32_t ulRoundTrips,
+                                 uint64_t ullStartUs )
+{
+    Bench_Report( pcLatencyName, ( double ) ( Bench_NowUs() - ullStartUs ) / benchHUB_RECONNECTS,
+                  "us", eBenchLowerIsBetter );
+    Bench_Report( pcSubscribesName,
+                  ( double ) ( xLoopback.xStats.ulSubscribesFromClient - ulSubscribes ) / benchHUB_RECONNECTS,
+                  "packets", eBenchLowerIsBetter );
+    Bench_Report( pcRoundTripsName,
+                  ( double ) ( xLoopback.xStats.ulRoundTrips - ulRoundTrips ) / benchHUB_RECONNECTS,
+                  "round trips", eBenchLowerIsBetter );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reconnect the hub client and subscribe to all features, first with a
+ * clean session each time, then through hub_session.c with a persistent
+ * session, and report the SUBSCRIBE packets, round trips and time from
+ * CONNECT to ready of each reconnect.
+ *
+ * The loopback peer answers at once, so the time is the CPU of the client.
+ * On a network every round trip adds its latency on top.
+ */
+static bool prvReconnect( void )
+{
+    HubSubscriptions_t xSubscriptions = { 0 };
+    HubSession_t xSession;
+    bool xSessionPresent;
+    uint32_t ulIndex;
+    uint32_t ulSubscribes = xLoopback.xStats.ulSubscribesFromClient;
+    uint32_t ulRoundTrips = xLoopback.xStats.ulRoundTrips;
+    uint64_t ullStartUs;
+    bool xResult = true;
+
+    xSubscriptions.xCommandCallback = prvHandleCommand;
+    xSubscriptions.xCloudToDeviceMessageCallback = prvHandleCloudToDevice;
+    xSubscriptions.xPropertiesCallback = prvHandleProperties;
+    xSubscriptions.ulSubscribeTimeoutMs = benchHUB_SUBSCRIBE_TIMEOUT_MS;
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchHUB_RECONNECTS ); ulIndex++ )
+    {
+        Loopback_Reconnect( &xLoopback );
+        xResult = ( AzureIoTHubClient_Connect( &xAzureIoTHubClient, true, &xSessionPresent,
+                                               benchHUB_CONNACK_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+                  ( HubSubscribe_All( &xAzureIoTHubClient, &xSubscriptions, NULL ) == eAzureIoTSuccess ) &&
+                  ( AzureIoTHubClient_Disconnect( &xAzureIoTHubClient ) == eAzureIoTSuccess );
+    }
+
+    if( !xResult )
+    {
+        return false;
+    }
+
+    prvReportReconnects( "hub_reconnect_clean_subscribes", "hub_reconnect_clean_round_trips",
+                         "hub_reconnect_clean_us", ulSubscribes, ulRoundTrips, ullStartUs );
+
+    /* The first connect of the session subscribes, the measured ones resume. */
+    Loopback_Reconnect( &xLoopback );
+    xResult = ( HubSession_Init( &xSession, &xAzureIoTHubClient, &xSubscriptions ) == eAzureIoTSuccess ) &&
+              ( HubSession_Connect( &xSession, benchHUB_CONNACK_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+              ( HubSession_Disconnect( &xSession ) == eAzureIoTSuccess );
+    ulSubscribes = xLoopback.xStats.ulSubscribesFromClient;
+    ulRoundTrips = xLoopback.xStats.ulRoundTrips;
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchHUB_RECONNECTS ); ulIndex++ )
+    {
+        Loopback_Reconnect( &xLoopback );
+        xResult = ( HubSession_Connect( &xSession, benchHUB_CONNACK_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+                  ( HubSession_Disconnect( &xSession ) == eAzureIoTSuccess );
+    }
+
+    if( !xResult || ( xSession.xStats.ulResumedCount != benchHUB_RECONNECTS ) )
+    {
+        return false;
+    }
+
+    prvReportReconnects( "hub_reconnect_persistent_subscribes", "hub_reconnect_persistent_round_trips",
+                         "hub_reconnect_persistent_us", ulSubscribes, ulRoundTrips, ullStartUs );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvInjectCommand( uint32_t ulIndex )
+{
+    return Loopback_InjectCommand( &xLoopback, benchHUB_COMMAND_NAME, ulIndex,
+                                   ( const uint8_t * ) benchHUB_COMMAND_PAYLOAD,
+                                   sizeof( benchHUB_COMMAND_PAYLOAD ) - 1 );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvInjectCloudToDevice( uint32_t ulIndex )
+{
+    ( void ) ulIndex;
+
+    return Loopback_InjectCloudToDevice( &xLoopback, ( const uint8_t * ) benchHUB_C2D_PAYLOAD,
+                                         sizeof( benchHUB_C2D_PAYLOAD ) - 1 );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvInjectDesiredProperties( uint32_t ulIndex )
+{
+    ( void ) ulIndex;
+
+    return Loopback_InjectDesiredProperties( &xLoopback, ( const uint8_t * ) benchHUB_DESIRED_PROPERTIES,
+                                             sizeof( benchHUB_DESIRED_PROPERTIES ) - 1 );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvRequestProperties( uint32_t ulIndex )
+{
+    ( void ) ulIndex;
+
+    return AzureIoTHubClient_RequestPropertiesAsync( &xAzureIoTHubClient ) == eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+bool BenchHub_Run( void )
+{
+    NetworkContext_t xNetworkContext = { &xLoopback };
+    AzureIoTTransportInterface_t xTransport = { &xNetworkContext, Loopback_Send, Loopback_Recv };
+    AzureIoTHubClientOptions_t xHubOptions = { 0 };
+    uint32_t ulIndex;
+    uint64_t ullStartUs;
+    bool xResult = true;
+
+    if( AzureIoTHubClient_OptionsInit( &xHubOptions ) != eAzureIoTSuccess )
+    {
+        return false;
+    }
+
+    xHubOptions.pucModelID = ( const uint8_t * ) sampleazureiotMODEL_ID;
+    xHubOptions.ulModelIDLength = sizeof( sampleazureiotMODEL_ID ) - 1;
+
+    if( AzureIoTHubClient_Init( &xAzureIoTHubClient,
+                                ( const uint8_t * ) benchHUB_HOSTNAME, sizeof( benchHUB_HOSTNAME ) - 1,
+                                ( const uint8_t * ) benchHUB_DEVICE_ID, sizeof( benchHUB_DEVICE_ID ) - 1,
+                                &xHubOptions, ucMQTTMessageBuffer, sizeof( ucMQTTMessageBuffer ),
+                                prvGetUnixTime, &xTransport ) != eAzureIoTSuccess )
+    {
+        return false;
+    }
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchHUB_CONNECTS ); ulIndex++ )
+    {
+        xResult = prvConnect() &&
+                  ( AzureIoTHubClient_Disconnect( &xAzureIoTHubClient ) == eAzureIoTSuccess );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "hub_connect_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchHUB_CONNECTS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    xResult = xResult && prvConnect() &&
+              prvSendTelemetry( eAzureIoTHubMessageQoS0, "hub_telemetry_qos0_msg_per_s" ) &&
+              prvSendTelemetry( eAzureIoTHubMessageQoS1, "hub_telemetry_qos1_msg_per_s" );
+
+    xResult = xResult && prvSubscribe() &&
+              prvReceive( "hub_command_roundtrip_us", prvInjectCommand ) &&
+              prvReceive( "hub_c2d_receive_us", prvInjectCloudToDevice ) &&
+              prvReceive( "hub_properties_get_us", prvRequestProperties ) &&
+              prvReceive( "hub_desired_properties_roundtrip_us", prvInjectDesiredProperties );
+
+    xResult = xResult && ( AzureIoTHubClient_Disconnect( &xAzureIoTHubClient ) == eAzureIoTSuccess ) &&
+              prvReconnect();
+
+    AzureIoTHubClient_Deinit( &xAzureIoTHubClient );
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,168 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_json.c
+ * @brief JSON encode and decode of the PnP sample payloads.
+ *
+ * Times the functions of sample_azure_iot_pnp_data_if.h as the PnP sample
+ * calls them, on the thermostat model of sample_azure_iot_pnp_simulated_data.c.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "bench.h"
+#include "sample_azure_iot_pnp_data_if.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Operations timed for each result.
+ */
+#ifndef benchJSON_ITERATIONS
+    #define benchJSON_ITERATIONS         ( 5000U )
+#endif
+
+#define benchJSON_HOSTNAME               "contoso-hub.azure-devices.net"
+#define benchJSON_DEVICE_ID              "thermostat-0001"
+#define benchJSON_COMMAND_NAME           "getMaxMinReport"
+#define benchJSON_COMMAND_PAYLOAD        "\"2023-01-10T09:00:00Z\""
+#define benchJSON_WRITABLE_PROPERTIES    "{\"targetTemperature\":23.5,\"$version\":7}"
+
+/**
+ * @brief The client used by the sample to build and parse property payloads.
+ */
+AzureIoTHubClient_t xAzureIoTHubClient;
+
+static uint8_t ucMQTTMessageBuffer[ 1024 ];
+/*-----------------------------------------------------------*/
+
+static int32_t prvUnusedSend( NetworkContext_t * pxNetworkContext,
+                              const void * pvBuffer,
+                              size_t xBytesToSend )
+{
+    ( void ) pxNetworkContext;
+    ( void ) pvBuffer;
+    ( void ) xBytesToSend;
+
+    return -1;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvUnusedRecv( NetworkContext_t * pxNetworkContext,
+                              void * pvBuffer,
+                              size_t xBytesToRecv )
+{
+    ( void ) pxNetworkContext;
+    ( void ) pvBuffer;
+    ( void ) xBytesToRecv;
+
+    return -1;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+bool BenchJson_Run( void )
+{
+    /* The payloads are never sent, the client is not connected. */
+    AzureIoTTransportInterface_t xTransport = { NULL, prvUnusedSend, prvUnusedRecv };
+    AzureIoTHubClientOptions_t xHubOptions = { 0 };
+    AzureIoTHubClientCommandRequest_t xCommand = { 0 };
+    AzureIoTHubClientPropertiesResponse_t xProperties = { 0 };
+    uint8_t ucPayload[ 256 ];
+    uint32_t ulLength = 0;
+    uint32_t ulStatus;
+    uint32_t ulIndex;
+    uint64_t ullStartUs;
+    bool xResult = true;
+
+    if( AzureIoTHubClient_OptionsInit( &xHubOptions ) != eAzureIoTSuccess )
+    {
+        return false;
+    }
+
+    xHubOptions.pucModelID = ( const uint8_t * ) sampleazureiotMODEL_ID;
+    xHubOptions.ulModelIDLength = sizeof( sampleazureiotMODEL_ID ) - 1;
+
+    if( AzureIoTHubClient_Init( &xAzureIoTHubClient,
+                                ( const uint8_t * ) benchJSON_HOSTNAME, sizeof( benchJSON_HOSTNAME ) - 1,
+                                ( const uint8_t * ) benchJSON_DEVICE_ID, sizeof( benchJSON_DEVICE_ID ) - 1,
+                                &xHubOptions, ucMQTTMessageBuffer, sizeof( ucMQTTMessageBuffer ),
+                                prvGetUnixTime, &xTransport ) != eAzureIoTSuccess )
+    {
+        return false;
+    }
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchJSON_ITERATIONS ); ulIndex++ )
+    {
+        xResult = ( ulCreateTelemetry( ucPayload, sizeof( ucPayload ), &ulLength ) == 0 );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "json_telemetry_encode_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchJSON_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchJSON_ITERATIONS ); ulIndex++ )
+    {
+        xResult = ( ulCreateReportedPropertiesUpdate( ucPayload, sizeof( ucPayload ) ) != 0 );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "json_reported_properties_encode_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchJSON_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    xCommand.pucCommandName = ( const uint8_t * ) benchJSON_COMMAND_NAME;
+    xCommand.usCommandNameLength = sizeof( benchJSON_COMMAND_NAME ) - 1;
+    xCommand.pvMessagePayload = benchJSON_COMMAND_PAYLOAD;
+    xCommand.ulPayloadLength = sizeof( benchJSON_COMMAND_PAYLOAD ) - 1;
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchJSON_ITERATIONS ); ulIndex++ )
+    {
+        ulLength = ulHandleCommand( &xCommand, &ulStatus, ucPayload, sizeof( ucPayload ) );
+        xResult = ( ulStatus == AZ_IOT_STATUS_OK );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "json_command_roundtrip_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchJSON_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    xProperties.xMessageType = eAzureIoTHubPropertiesWritablePropertyMessage;
+    xProperties.pvMessagePayload = benchJSON_WRITABLE_PROPERTIES;
+    xProperties.ulPayloadLength = sizeof( benchJSON_WRITABLE_PROPERTIES ) - 1;
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchJSON_ITERATIONS ); ulIndex++ )
+    {
+        ulLength = 0;
+        vHandleWritableProperties( &xProperties, ucPayload, sizeof( ucPayload ), &ulLength );
+        xResult = ( ulLength != 0 );
+    }
+
+    if( xResult )
+    {
+        Bench_Report( "json_writable_properties_roundtrip_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchJSON_ITERATIONS,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    AzureIoTHubClient_Deinit( &xAzureIoTHubClient );
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
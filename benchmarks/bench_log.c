@@ -0,0 +1,130 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_log.c
+ * @brief Cost of a log call on the calling task, written in place or
+ * deferred to the log task of deferred_log.c.
+ *
+ * Both write to /dev/null and flush every message, as standard out does on a
+ * terminal. The deferred messages are logged in bursts that fit the ring, the
+ * log task writes them between bursts, outside the timings.
+ */
+
+/* Standard includes. */
+#include <stdarg.h>
+#include <stdio.h>
+
+/* FreeRTOS */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "bench.h"
+#include "deferred_log.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Messages logged for each result.
+ */
+#ifndef benchLOG_ITERATIONS
+    #define benchLOG_ITERATIONS    ( 4096U )
+#endif
+
+#define benchLOG_BURST             ( deferredlogSLOTS / 2U )
+
+/* A command logged by the samples, with its payload. */
+#define benchLOG_FORMAT            "[INFO] [sample_azure_iot_pnp.c:%d] Command payload : %.*s \r\n"
+#define benchLOG_PAYLOAD           "{\"since\":\"2023-01-10T09:00:00Z\",\"targetTemperature\":23.5}"
+
+static FILE * pxOutput;
+/*-----------------------------------------------------------*/
+
+static void prvWriteLog( const char * pcMessage,
+                         uint32_t ulLength )
+{
+    ( void ) fwrite( pcMessage, 1, ulLength, pxOutput );
+    ( void ) fflush( pxOutput );
+}
+/*-----------------------------------------------------------*/
+
+static void prvLogInPlace( const char * pcFormat,
+                           ... )
+{
+    va_list xArguments;
+
+    va_start( xArguments, pcFormat );
+    ( void ) vfprintf( pxOutput, pcFormat, xArguments );
+    va_end( xArguments );
+    ( void ) fflush( pxOutput );
+}
+/*-----------------------------------------------------------*/
+
+static void prvLogDeferred( const char * pcFormat,
+                            ... )
+{
+    va_list xArguments;
+
+    va_start( xArguments, pcFormat );
+    ( void ) DeferredLog_VPrintf( pcFormat, xArguments );
+    va_end( xArguments );
+}
+/*-----------------------------------------------------------*/
+
+bool BenchLog_Run( void )
+{
+    uint64_t ullTotalUs = 0;
+    uint64_t ullStartUs;
+    uint32_t ulIndex;
+    uint32_t ulDropped;
+
+    if( ( pxOutput = fopen( "/dev/null", "w" ) ) == NULL )
+    {
+        return false;
+    }
+
+    ullStartUs = Bench_NowUs();
+
+    for( ulIndex = 0; ulIndex < benchLOG_ITERATIONS; ulIndex++ )
+    {
+        prvLogInPlace( benchLOG_FORMAT, ( int ) ulIndex, ( int ) sizeof( benchLOG_PAYLOAD ) - 1, benchLOG_PAYLOAD );
+    }
+
+    Bench_Report( "log_in_place_us", ( double ) ( Bench_NowUs() - ullStartUs ) / benchLOG_ITERATIONS,
+                  "us", eBenchLowerIsBetter );
+
+    if( !DeferredLog_Init( prvWriteLog ) )
+    {
+        ( void ) fclose( pxOutput );
+        return false;
+    }
+
+    ulDropped = DeferredLog_Dropped();
+
+    for( ulIndex = 0; ulIndex < benchLOG_ITERATIONS; ulIndex++ )
+    {
+        if( ( ulIndex % benchLOG_BURST ) == 0 )
+        {
+            /* Let the log task empty the ring. */
+            vTaskDelay( pdMS_TO_TICKS( deferredlogPOLL_INTERVAL_MS * 2U ) );
+            ullStartUs = Bench_NowUs();
+        }
+
+        prvLogDeferred( benchLOG_FORMAT, ( int ) ulIndex, ( int ) sizeof( benchLOG_PAYLOAD ) - 1, benchLOG_PAYLOAD );
+
+        if( ( ( ulIndex + 1U ) % benchLOG_BURST ) == 0 )
+        {
+            ullTotalUs += Bench_NowUs() - ullStartUs;
+        }
+    }
+
+    Bench_Report( "log_deferred_us", ( double ) ullTotalUs / benchLOG_ITERATIONS, "us", eBenchLowerIsBetter );
+    Bench_Report( "log_deferred_dropped", ( double ) ( DeferredLog_Dropped() - ulDropped ), "msg",
+                  eBenchLowerIsBetter );
+
+    /* The log task keeps running, with nothing left to write. */
+    vTaskDelay( pdMS_TO_TICKS( deferredlogPOLL_INTERVAL_MS * 2U ) );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
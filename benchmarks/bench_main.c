@@ -0,0 +1,235 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_main.c
+ * @brief Entry point of the benchmarks on the FreeRTOS POSIX port.
+ *
+ * Usage: iot-middleware-benchmarks [--verbose] [--replay <session> [--speed <percent>]] [results.json]
+ *
+ * Runs every benchmark group, prints the results and writes them as JSON for
+ * bench_compare. The replay group only runs with a session recorded by the
+ * PnP sample. Exits with 1 if a group failed.
+ */
+
+/* Standard includes. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* FreeRTOS */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Azure Provisioning/IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+#include "bench.h"
+#include "crypto.h"
+
+/*-----------------------------------------------------------*/
+
+#define benchmainDEFAULT_RESULTS_PATH    "benchmark_results.json"
+
+/**
+ * @brief Stack of the task running the groups, in words.
+ */
+#define benchmainTASK_STACK_SIZE         ( 2U * 1024U )
+
+static const char * pcResultsPath = benchmainDEFAULT_RESULTS_PATH;
+static bool xVerbose;
+/*-----------------------------------------------------------*/
+
+void vLoggingPrintf( const char * pcFormat,
+                     ... )
+{
+    va_list arg;
+
+    /* Logging would be timed with the code under test. */
+    if( xVerbose )
+    {
+        va_start( arg, pcFormat );
+        vprintf( pcFormat, arg );
+        va_end( arg );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunnerTask( void * pvParameters )
+{
+    bool xResult;
+
+    ( void ) pvParameters;
+
+    xResult = ( Crypto_Init() == 0 ) && ( AzureIoT_Init() == eAzureIoTSuccess );
+
+    /* Every group runs, a failing one does not hide the results of the
+     * others. The variants of the mbed TLS build only differ in TLS. */
+    #ifndef benchTLS_VARIANT
+        xResult = Bench_RunGroup( "crypto", BenchCrypto_Run ) && xResult;
+        xResult = Bench_RunGroup( "json", BenchJson_Run ) && xResult;
+        xResult = Bench_RunGroup( "compress", BenchCompress_Run ) && xResult;
+        xResult = Bench_RunGroup( "hub", BenchHub_Run ) && xResult;
+        xResult = Bench_RunGroup( "log", BenchLog_Run ) && xResult;
+    #endif
+    xResult = Bench_RunGroup( "tls", BenchTls_Run ) && xResult;
+
+    if( BenchReplay_IsLoaded() )
+    {
+        xResult = Bench_RunGroup( "replay", BenchReplay_Run ) && xResult;
+    }
+
+    xResult = Bench_WriteResults( pcResultsPath ) && xResult;
+
+    printf( "%s, results in %s\n", xResult ? "Done" : "FAILED", pcResultsPath );
+
+    exit( xResult ? 0 : 1 );
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int lArgument;
+    const char * pcReplayPath = NULL;
+    uint32_t ulReplaySpeed = 0;
+
+    for( lArgument = 1; lArgument < argc; lArgument++ )
+    {
+        if( strcmp( argv[ lArgument ], "--verbose" ) == 0 )
+        {
+            xVerbose = true;
+        }
+        else if( ( strcmp( argv[ lArgument ], "--replay" ) == 0 ) && ( lArgument + 1 < argc ) )
+        {
+            pcReplayPath = argv[ ++lArgument ];
+        }
+        else if( ( strcmp( argv[ lArgument ], "--speed" ) == 0 ) && ( lArgument + 1 < argc ) )
+        {
+            ulReplaySpeed = ( uint32_t ) strtoul( argv[ ++lArgument ], NULL, 10 );
+        }
+        else if( argv[ lArgument ][ 0 ] != '-' )
+        {
+            pcResultsPath = argv[ lArgument ];
+        }
+        else
+        {
+            printf( "Usage: %s [--verbose] [--replay <session> [--speed <percent>]] [results.json]\n", argv[ 0 ] );
+
+            return 2;
+        }
+    }
+
+    if( ( pcReplayPath != NULL ) && !BenchReplay_Load( pcReplayPath, ulReplaySpeed ) )
+    {
+        printf( "Cannot read %s\n", pcReplayPath );
+
+        return 2;
+    }
+
+    if( xTaskCreate( prvRunnerTask, "Bench", benchmainTASK_STACK_SIZE, NULL,
+                     tskIDLE_PRIORITY + 1, NULL ) != pdPASS )
+    {
+        return 1;
+    }
+
+    vTaskStartScheduler();
+
+    /* Only reached if the idle or timer task could not be created. */
+    return 1;
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    printf( "vAssertCalled( %s, %u\n", pcFile, ulLine );
+
+    /* A benchmark run cannot be debugged, fail it instead of blocking. */
+    exit( 1 );
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxRand( void )
+{
+    static UBaseType_t ulNextRand = 1;
+    const uint32_t ulMultiplier = 0x015a4e35UL, ulIncrement = 1UL;
+
+    ulNextRand = ( ulMultiplier * ulNextRand ) + ulIncrement;
+
+    return( ( int ) ( ulNextRand >> 16UL ) & 0x7fffUL );
+}
+/*-----------------------------------------------------------*/
+
+int iMainRand32( void )
+{
+    return ( int ) uxRand();
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    uint32_t * pulIdleTaskStackSize )
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     uint32_t * pulTimerTaskStackSize )
+{
+    static StaticTask_t xTimerTaskTCB;
+    static StackType_t uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
+
+    *ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = uxTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t ullGetUnixTime( void )
+{
+    return ( uint64_t ) time( NULL );
+}
+/*-----------------------------------------------------------*/
+
+int mbedtls_platform_entropy_poll( void * data,
+                                   unsigned char * output,
+                                   size_t len,
+                                   size_t * olen )
+{
+    FILE * file;
+    size_t read_len;
+
+    ( ( void ) data );
+
+    *olen = 0;
+
+    file = fopen( "/dev/urandom", "rb" );
+
+    if( file == NULL )
+    {
+        return( -1 );
+    }
+
+    read_len = fread( output, 1, len, file );
+    fclose( file );
+
+    if( read_len != len )
+    {
+        return( -1 );
+    }
+
+    *olen = len;
+
+    return( 0 );
+}
+/*-----------------------------------------------------------*/
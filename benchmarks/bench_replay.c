@@ -0,0 +1,209 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_replay.c
+ * @brief Hub client cost of a recorded session.
+ *
+ * Plays back a session recorded by the PnP sample with
+ * democonfigTRANSPORT_CAPTURE_FILE through transport_replay.c, so the client
+ * handles the commands, property updates and cloud to device messages of a
+ * real device in the order and the mix they arrived in. Speed 0 delivers them
+ * as fast as the client reads, the session then takes the same path on every
+ * run.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "sample_azure_iot_pnp_data_if.h"
+#include "transport_replay.h"
+
+/*-----------------------------------------------------------*/
+
+#define benchREPLAY_HOSTNAME              "contoso-hub.azure-devices.net"
+#define benchREPLAY_DEVICE_ID             "thermostat-0001"
+#define benchREPLAY_CONNACK_TIMEOUT_MS    ( 1000U )
+#define benchREPLAY_SUBSCRIBE_TIMEOUT_MS  ( 1000U )
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    ReplayTransportParams_t * pParams;
+};
+
+static ReplayTransportParams_t xReplay;
+static uint8_t ucMQTTMessageBuffer[ 2048 ];
+static uint8_t * pucLog;
+static size_t xLogLength;
+static uint32_t ulSpeedPercent;
+static uint32_t ulMessagesHandled;
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
+                              void * pvContext )
+{
+    uint8_t ucResponse[ 256 ];
+    uint32_t ulStatus;
+    uint32_t ulLength = ulHandleCommand( pxMessage, &ulStatus, ucResponse, sizeof( ucResponse ) );
+
+    ( void ) pvContext;
+
+    ( void ) AzureIoTHubClient_SendCommandResponse( &xAzureIoTHubClient, pxMessage, ulStatus,
+                                                    ucResponse, ulLength );
+    ulMessagesHandled++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleCloudToDevice( AzureIoTHubClientCloudToDeviceMessageRequest_t * pxMessage,
+                                    void * pvContext )
+{
+    ( void ) pxMessage;
+    ( void ) pvContext;
+
+    ulMessagesHandled++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleProperties( AzureIoTHubClientPropertiesResponse_t * pxMessage,
+                                 void * pvContext )
+{
+    uint8_t ucResponse[ 256 ];
+    uint32_t ulLength = 0;
+
+    ( void ) pvContext;
+
+    ulMessagesHandled++;
+
+    if( pxMessage->xMessageType != eAzureIoTHubPropertiesWritablePropertyMessage )
+    {
+        return;
+    }
+
+    vHandleWritableProperties( pxMessage, ucResponse, sizeof( ucResponse ), &ulLength );
+
+    if( ulLength != 0 )
+    {
+        ( void ) AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient, ucResponse, ulLength, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+bool BenchReplay_Load( const char * pcPath,
+                       uint32_t ulSpeed )
+{
+    FILE * pxFile = fopen( pcPath, "rb" );
+    long lLength;
+    bool xResult = false;
+
+    if( pxFile == NULL )
+    {
+        return false;
+    }
+
+    /* Read before the scheduler starts, the log is not counted in the heap
+     * of the group. */
+    if( ( fseek( pxFile, 0, SEEK_END ) == 0 ) && ( ( lLength = ftell( pxFile ) ) > 0 ) &&
+        ( fseek( pxFile, 0, SEEK_SET ) == 0 ) && ( ( pucLog = malloc( ( size_t ) lLength ) ) != NULL ) )
+    {
+        xLogLength = fread( pucLog, 1, ( size_t ) lLength, pxFile );
+        xResult = ( xLogLength == ( size_t ) lLength );
+    }
+
+    fclose( pxFile );
+    ulSpeedPercent = ulSpeed;
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+bool BenchReplay_IsLoaded( void )
+{
+    return pucLog != NULL;
+}
+/*-----------------------------------------------------------*/
+
+bool BenchReplay_Run( void )
+{
+    NetworkContext_t xNetworkContext = { &xReplay };
+    AzureIoTTransportInterface_t xTransport = { &xNetworkContext, Replay_Send, Replay_Recv };
+    AzureIoTHubClientOptions_t xHubOptions = { 0 };
+    uint32_t ulHandled;
+    uint64_t ullLoopStartUs;
+    uint64_t ullHandlingUs = 0;
+    uint64_t ullStartUs;
+    bool xSessionPresent;
+    bool xResult;
+
+    if( !Replay_Init( &xReplay, benchREPLAY_DEVICE_ID, pucLog, xLogLength, ulSpeedPercent ) ||
+        ( AzureIoTHubClient_OptionsInit( &xHubOptions ) != eAzureIoTSuccess ) )
+    {
+        return false;
+    }
+
+    xHubOptions.pucModelID = ( const uint8_t * ) sampleazureiotMODEL_ID;
+    xHubOptions.ulModelIDLength = sizeof( sampleazureiotMODEL_ID ) - 1;
+
+    if( AzureIoTHubClient_Init( &xAzureIoTHubClient,
+                                ( const uint8_t * ) benchREPLAY_HOSTNAME, sizeof( benchREPLAY_HOSTNAME ) - 1,
+                                ( const uint8_t * ) benchREPLAY_DEVICE_ID, sizeof( benchREPLAY_DEVICE_ID ) - 1,
+                                &xHubOptions, ucMQTTMessageBuffer, sizeof( ucMQTTMessageBuffer ),
+                                prvGetUnixTime, &xTransport ) != eAzureIoTSuccess )
+    {
+        return false;
+    }
+
+    ulMessagesHandled = 0;
+    ullStartUs = Bench_NowUs();
+
+    xResult = ( AzureIoTHubClient_Connect( &xAzureIoTHubClient, false, &xSessionPresent,
+                                           benchREPLAY_CONNACK_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_SubscribeCommand( &xAzureIoTHubClient, prvHandleCommand, NULL,
+                                                    benchREPLAY_SUBSCRIBE_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_SubscribeCloudToDeviceMessage( &xAzureIoTHubClient, prvHandleCloudToDevice, NULL,
+                                                                 benchREPLAY_SUBSCRIBE_TIMEOUT_MS ) == eAzureIoTSuccess ) &&
+              ( AzureIoTHubClient_SubscribeProperties( &xAzureIoTHubClient, prvHandleProperties, NULL,
+                                                       benchREPLAY_SUBSCRIBE_TIMEOUT_MS ) == eAzureIoTSuccess );
+
+    /* Only the process loops that handled a message are timed, not the ones
+     * waiting for the next recorded message. */
+    while( xResult && !Replay_IsFinished( &xReplay ) )
+    {
+        ulHandled = ulMessagesHandled;
+        ullLoopStartUs = Bench_NowUs();
+        xResult = ( AzureIoTHubClient_ProcessLoop( &xAzureIoTHubClient, 0 ) == eAzureIoTSuccess );
+
+        if( ulMessagesHandled != ulHandled )
+        {
+            ullHandlingUs += Bench_NowUs() - ullLoopStartUs;
+        }
+    }
+
+    if( xResult && ( ulMessagesHandled > 0 ) )
+    {
+        Bench_Report( "replay_session_us", ( double ) ( Bench_NowUs() - ullStartUs ), "us", eBenchLowerIsBetter );
+        Bench_Report( "replay_messages", ( double ) ulMessagesHandled, "msgs", eBenchHigherIsBetter );
+        Bench_Report( "replay_us_per_message", ( double ) ullHandlingUs / ulMessagesHandled,
+                      "us", eBenchLowerIsBetter );
+    }
+
+    printf( "Replayed %u publishes of %u connections, skipped %u packets and %u too large%s\n",
+            ( unsigned ) xReplay.xStats.ulPublishesReplayed, ( unsigned ) xReplay.xStats.ulConnections,
+            ( unsigned ) xReplay.xStats.ulPacketsSkipped, ( unsigned ) xReplay.xStats.ulPacketsTooLarge,
+            xReplay.xLogError ? ", the log is truncated" : "" );
+
+    xResult = xResult && ( AzureIoTHubClient_Disconnect( &xAzureIoTHubClient ) == eAzureIoTSuccess );
+
+    AzureIoTHubClient_Deinit( &xAzureIoTHubClient );
+
+    return xResult && ( ulMessagesHandled > 0 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,286 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_sockets.c
+ * @brief In-memory implementation of sockets_wrapper.h.
+ */
+
+#include "bench_sockets.h"
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stream_buffer.h"
+
+/*-----------------------------------------------------------*/
+
+typedef struct BenchSocketPair BenchSocketPair_t;
+
+/**
+ * @brief One end of a connection.
+ */
+typedef struct BenchSocket
+{
+    BenchSocketPair_t * pxPair;
+    StreamBufferHandle_t xReceive;     /**< @brief Bytes sent by the other end. */
+    TickType_t xReceiveTimeout;
+    TickType_t xSendTimeout;
+    size_t xBytesSent;
+    volatile BaseType_t xClosed;
+} BenchSocket_t;
+
+/**
+ * @brief Both ends, freed when both are closed.
+ */
+struct BenchSocketPair
+{
+    BenchSocket_t xEnds[ 2 ];
+    uint32_t ulReferences;
+};
+
+static BenchSocketsAcceptFunction_t xAcceptFunction;
+static void * pvAcceptContext;
+/*-----------------------------------------------------------*/
+
+static BenchSocket_t * prvPeer( BenchSocket_t * pxSocket )
+{
+    BenchSocketPair_t * pxPair = pxSocket->pxPair;
+
+    return ( pxSocket == &pxPair->xEnds[ 0 ] ) ? &pxPair->xEnds[ 1 ] : &pxPair->xEnds[ 0 ];
+}
+/*-----------------------------------------------------------*/
+
+void BenchSockets_SetAcceptFunction( BenchSocketsAcceptFunction_t xAccept,
+                                     void * pvContext )
+{
+    xAcceptFunction = xAccept;
+    pvAcceptContext = pvContext;
+}
+/*-----------------------------------------------------------*/
+
+size_t BenchSockets_GetBytesSent( SocketHandle xSocket )
+{
+    return ( ( BenchSocket_t * ) xSocket )->xBytesSent;
+}
+/*-----------------------------------------------------------*/
+
+size_t BenchSockets_GetBytesReceived( SocketHandle xSocket )
+{
+    return prvPeer( ( BenchSocket_t * ) xSocket )->xBytesSent;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t Sockets_Init()
+{
+    return SOCKETS_ERROR_NONE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t Sockets_DeInit()
+{
+    return SOCKETS_ERROR_NONE;
+}
+/*-----------------------------------------------------------*/
+
+SocketHandle Sockets_Open()
+{
+    BenchSocketPair_t * pxPair = pvPortMalloc( sizeof( BenchSocketPair_t ) );
+
+    if( pxPair == NULL )
+    {
+        return SOCKETS_INVALID_SOCKET;
+    }
+
+    memset( pxPair, 0, sizeof( BenchSocketPair_t ) );
+    pxPair->xEnds[ 0 ].pxPair = pxPair;
+    pxPair->xEnds[ 0 ].xReceiveTimeout = portMAX_DELAY;
+    pxPair->xEnds[ 0 ].xSendTimeout = portMAX_DELAY;
+    pxPair->xEnds[ 1 ].pxPair = pxPair;
+    pxPair->xEnds[ 1 ].xReceiveTimeout = portMAX_DELAY;
+    pxPair->xEnds[ 1 ].xSendTimeout = portMAX_DELAY;
+    pxPair->ulReferences = 1;
+
+    return ( SocketHandle ) &pxPair->xEnds[ 0 ];
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t Sockets_Close( SocketHandle xSocket )
+{
+    BenchSocket_t * pxSocket = ( BenchSocket_t * ) xSocket;
+    BenchSocketPair_t * pxPair = pxSocket->pxPair;
+    uint32_t ulReferences;
+
+    pxSocket->xClosed = pdTRUE;
+
+    taskENTER_CRITICAL();
+    {
+        ulReferences = --pxPair->ulReferences;
+    }
+    taskEXIT_CRITICAL();
+
+    if( ulReferences == 0 )
+    {
+        if( pxPair->xEnds[ 0 ].xReceive != NULL )
+        {
+            vStreamBufferDelete( pxPair->xEnds[ 0 ].xReceive );
+            vStreamBufferDelete( pxPair->xEnds[ 1 ].xReceive );
+        }
+
+        vPortFree( pxPair );
+    }
+
+    return SOCKETS_ERROR_NONE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t Sockets_Connect( SocketHandle xSocket,
+                            const char * pcHostName,
+                            uint16_t usPort )
+{
+    BenchSocket_t * pxSocket = ( BenchSocket_t * ) xSocket;
+    BenchSocketPair_t * pxPair = pxSocket->pxPair;
+
+    ( void ) pcHostName;
+    ( void ) usPort;
+
+    if( ( xAcceptFunction == NULL ) || ( pxPair->xEnds[ 0 ].xReceive != NULL ) )
+    {
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    pxPair->xEnds[ 0 ].xReceive = xStreamBufferCreate( BENCH_SOCKETS_BUFFER_SIZE, 1 );
+    pxPair->xEnds[ 1 ].xReceive = xStreamBufferCreate( BENCH_SOCKETS_BUFFER_SIZE, 1 );
+
+    if( ( pxPair->xEnds[ 0 ].xReceive == NULL ) || ( pxPair->xEnds[ 1 ].xReceive == NULL ) )
+    {
+        /* Sockets_Close only frees the buffers of a connected pair. */
+        if( pxPair->xEnds[ 0 ].xReceive != NULL )
+        {
+            vStreamBufferDelete( pxPair->xEnds[ 0 ].xReceive );
+            pxPair->xEnds[ 0 ].xReceive = NULL;
+        }
+
+        if( pxPair->xEnds[ 1 ].xReceive != NULL )
+        {
+            vStreamBufferDelete( pxPair->xEnds[ 1 ].xReceive );
+            pxPair->xEnds[ 1 ].xReceive = NULL;
+        }
+
+        return SOCKETS_ENOMEM;
+    }
+
+    pxPair->ulReferences = 2;
+
+    if( xAcceptFunction( ( SocketHandle ) &pxPair->xEnds[ 1 ], pvAcceptContext ) != pdTRUE )
+    {
+        pxPair->xEnds[ 1 ].xClosed = pdTRUE;
+        pxPair->ulReferences = 1;
+
+        return SOCKETS_SOCKET_ERROR;
+    }
+
+    return SOCKETS_ERROR_NONE;
+}
+/*-----------------------------------------------------------*/
+
+void Sockets_Disconnect( SocketHandle xSocket )
+{
+    ( ( BenchSocket_t * ) xSocket )->xClosed = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t Sockets_Recv( SocketHandle xSocket,
+                         uint8_t * pucReceiveBuffer,
+                         size_t xReceiveBufferLength )
+{
+    BenchSocket_t * pxSocket = ( BenchSocket_t * ) xSocket;
+    size_t xReceived;
+
+    if( pxSocket->xReceive == NULL )
+    {
+        return SOCKETS_ENOTCONN;
+    }
+
+    xReceived = xStreamBufferReceive( pxSocket->xReceive, pucReceiveBuffer,
+                                      xReceiveBufferLength, pxSocket->xReceiveTimeout );
+
+    /* Like a TCP socket, what was sent before the other end closed can still
+     * be read. */
+    if( ( xReceived == 0 ) && ( prvPeer( pxSocket )->xClosed || pxSocket->xClosed ) )
+    {
+        return SOCKETS_ECLOSED;
+    }
+
+    return ( BaseType_t ) xReceived;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t Sockets_Send( SocketHandle xSocket,
+                         const uint8_t * pucData,
+                         size_t xDataLength )
+{
+    BenchSocket_t * pxSocket = ( BenchSocket_t * ) xSocket;
+    BenchSocket_t * pxPeer;
+    size_t xSent;
+
+    if( pxSocket->xReceive == NULL )
+    {
+        return SOCKETS_ENOTCONN;
+    }
+
+    pxPeer = prvPeer( pxSocket );
+
+    if( pxSocket->xClosed || pxPeer->xClosed )
+    {
+        return SOCKETS_ECLOSED;
+    }
+
+    xSent = xStreamBufferSend( pxPeer->xReceive, pucData, xDataLength, pxSocket->xSendTimeout );
+    pxSocket->xBytesSent += xSent;
+
+    return ( xSent > 0 ) ? ( BaseType_t ) xSent : SOCKETS_EWOULDBLOCK;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t Sockets_SetSockOpt( SocketHandle xSocket,
+                               int32_t lOptionName,
+                               const void * pvOptionValue,
+                               size_t xOptionLength )
+{
+    BenchSocket_t * pxSocket = ( BenchSocket_t * ) xSocket;
+    TickType_t xTimeout;
+
+    if( ( pvOptionValue == NULL ) || ( xOptionLength != sizeof( TickType_t ) ) )
+    {
+        return SOCKETS_EINVAL;
+    }
+
+    /* Comply with Berkeley standard - a 0 timeout is wait forever. */
+    xTimeout = *( ( const TickType_t * ) pvOptionValue );
+
+    if( xTimeout == 0U )
+    {
+        xTimeout = portMAX_DELAY;
+    }
+
+    switch( lOptionName )
+    {
+        case SOCKETS_SO_RCVTIMEO:
+            pxSocket->xReceiveTimeout = xTimeout;
+            break;
+
+        case SOCKETS_SO_SNDTIMEO:
+            pxSocket->xSendTimeout = xTimeout;
+            break;
+
+        default:
+            return SOCKETS_ENOPROTOOPT;
+    }
+
+    return SOCKETS_ERROR_NONE;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,55 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_sockets.h
+ * @brief In-memory implementation of sockets_wrapper.h.
+ *
+ * Sockets_Connect does not resolve the host name: it pairs the socket with a
+ * new server side socket and hands that to the accept function, which serves
+ * it from another task with Sockets_Recv and Sockets_Send. Each direction is
+ * a FreeRTOS stream buffer, so the TLS transport of the samples runs
+ * unchanged without the TCP/IP stack.
+ */
+
+#ifndef BENCH_SOCKETS_H
+#define BENCH_SOCKETS_H
+
+#include <stddef.h>
+
+#include "sockets_wrapper.h"
+
+/**
+ * @brief Bytes buffered in each direction.
+ */
+#ifndef BENCH_SOCKETS_BUFFER_SIZE
+    #define BENCH_SOCKETS_BUFFER_SIZE    ( 16U * 1024U )
+#endif
+
+/**
+ * @brief Called by Sockets_Connect with the server side of the connection.
+ *
+ * The server side must be closed with Sockets_Close when done.
+ *
+ * @return false to refuse the connection.
+ */
+typedef BaseType_t ( * BenchSocketsAcceptFunction_t )( SocketHandle xServerSocket,
+                                                        void * pvContext );
+
+/**
+ * @brief Set the function accepting connections.
+ */
+void BenchSockets_SetAcceptFunction( BenchSocketsAcceptFunction_t xAccept,
+                                     void * pvContext );
+
+/**
+ * @brief Bytes sent from a socket since it connected.
+ */
+size_t BenchSockets_GetBytesSent( SocketHandle xSocket );
+
+/**
+ * @brief Bytes sent to a socket by the other end since it connected.
+ */
+size_t BenchSockets_GetBytesReceived( SocketHandle xSocket );
+
+#endif /* BENCH_SOCKETS_H */
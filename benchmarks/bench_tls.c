@@ -0,0 +1,398 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file bench_tls.c
+ * @brief TLS handshake of the sample transport against an in-process server.
+ *
+ * The client side is TLS_Socket_Connect of the samples, unchanged. The server
+ * is an mbed TLS server task reached through bench_sockets.c, serving one
+ * connection at a time.
+ *
+ * Every combination of server key, P-256 or RSA-2048, device authentication,
+ * SAS token or X.509 certificate, and cipher, AES-128 GCM or CBC, is
+ * measured. The server picks the key exchange and cipher, the client keeps
+ * the board configuration. Options of the mbed TLS build, like
+ * MBEDTLS_AES_ROM_TABLES, are compared by the variants of the benchmark
+ * binary, see benchTLS_VARIANT.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* mbed TLS */
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+
+#include "bench.h"
+#include "bench_credentials.h"
+#include "bench_sockets.h"
+#include "transport_tls_socket.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Handshakes measured, the median is reported.
+ */
+#ifndef benchTLS_HANDSHAKES
+    #define benchTLS_HANDSHAKES            ( 21U )
+#endif
+
+/**
+ * @brief Prefix of the results after "tls_", naming the mbed TLS build
+ * variant. Empty for the configuration of the board.
+ */
+#ifndef benchTLS_VARIANT
+    #define benchTLS_VARIANT               ""
+#endif
+
+/**
+ * @brief Stack of the server task, in words.
+ */
+#define benchTLS_SERVER_STACK_SIZE         ( 8U * 1024U )
+
+/**
+ * @brief Timeouts of the client and the server.
+ */
+#define benchTLS_TIMEOUT_MS                ( 5000U )
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    TlsTransportParams_t * pParams;
+};
+
+/**
+ * @brief One combination of the matrix.
+ */
+typedef struct BenchTlsCase
+{
+    const char * pcName;
+    bool xRsa;                          /**< @brief RSA-2048 server key, else P-256. */
+    bool xX509;                         /**< @brief Device certificate, else SAS token. */
+    const int * plCiphersuites;         /**< @brief Offered by the server. */
+} BenchTlsCase_t;
+
+/**
+ * @brief Server state, shared by the connections which are served one at a
+ * time.
+ */
+typedef struct BenchTlsServer
+{
+    mbedtls_ssl_config xConfig;
+    mbedtls_x509_crt xRootCa;
+    mbedtls_x509_crt xEcCertificate;
+    mbedtls_pk_context xEcKey;
+    mbedtls_x509_crt xRsaCertificate;
+    mbedtls_pk_context xRsaKey;
+    mbedtls_entropy_context xEntropy;
+    mbedtls_ctr_drbg_context xDrbg;
+    SemaphoreHandle_t xIdle;            /**< @brief Given when no connection is being served. */
+} BenchTlsServer_t;
+
+extern int mbedtls_platform_entropy_poll( void * data,
+                                          unsigned char * output,
+                                          size_t len,
+                                          size_t * olen );
+
+static const int lEcdsaGcm[] = { MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, 0 };
+static const int lEcdsaCbc[] = { MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256, 0 };
+static const int lRsaGcm[] = { MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256, 0 };
+static const int lRsaCbc[] = { MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256, 0 };
+
+static const BenchTlsCase_t xCases[] =
+{
+    { "p256_sas_gcm",  false, false, lEcdsaGcm },
+    { "p256_sas_cbc",  false, false, lEcdsaCbc },
+    { "p256_x509_gcm", false, true,  lEcdsaGcm },
+    { "p256_x509_cbc", false, true,  lEcdsaCbc },
+    { "rsa_sas_gcm",   true,  false, lRsaGcm   },
+    { "rsa_sas_cbc",   true,  false, lRsaCbc   },
+    { "rsa_x509_gcm",  true,  true,  lRsaGcm   },
+    { "rsa_x509_cbc",  true,  true,  lRsaCbc   }
+};
+
+static BenchTlsServer_t xServer;
+/*-----------------------------------------------------------*/
+
+static int prvServerSend( void * pvContext,
+                          const unsigned char * pucBuffer,
+                          size_t xLength )
+{
+    BaseType_t xResult = Sockets_Send( ( SocketHandle ) pvContext, pucBuffer, xLength );
+
+    return ( xResult == SOCKETS_EWOULDBLOCK ) ? MBEDTLS_ERR_SSL_WANT_WRITE : ( int ) xResult;
+}
+/*-----------------------------------------------------------*/
+
+static int prvServerRecv( void * pvContext,
+                          unsigned char * pucBuffer,
+                          size_t xLength )
+{
+    BaseType_t xResult = Sockets_Recv( ( SocketHandle ) pvContext, pucBuffer, xLength );
+
+    return ( xResult == 0 ) ? MBEDTLS_ERR_SSL_WANT_READ : ( int ) xResult;
+}
+/*-----------------------------------------------------------*/
+
+static void prvServerTask( void * pvParameters )
+{
+    SocketHandle xSocket = ( SocketHandle ) pvParameters;
+    mbedtls_ssl_context xContext;
+    uint8_t ucBuffer[ 64 ];
+    int lResult;
+
+    mbedtls_ssl_init( &xContext );
+
+    if( mbedtls_ssl_setup( &xContext, &xServer.xConfig ) == 0 )
+    {
+        mbedtls_ssl_set_bio( &xContext, xSocket, prvServerSend, prvServerRecv, NULL );
+
+        do
+        {
+            lResult = mbedtls_ssl_handshake( &xContext );
+        } while( ( lResult == MBEDTLS_ERR_SSL_WANT_READ ) || ( lResult == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+
+        /* Serve until the client sends close-notify or goes away. */
+        while( lResult == 0 )
+        {
+            lResult = mbedtls_ssl_read( &xContext, ucBuffer, sizeof( ucBuffer ) );
+
+            if( ( lResult > 0 ) || ( lResult == MBEDTLS_ERR_SSL_WANT_READ ) )
+            {
+                lResult = 0;
+            }
+        }
+    }
+
+    mbedtls_ssl_free( &xContext );
+    ( void ) Sockets_Close( xSocket );
+    ( void ) xSemaphoreGive( xServer.xIdle );
+    vTaskDelete( NULL );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvAccept( SocketHandle xServerSocket,
+                             void * pvContext )
+{
+    TickType_t xTimeout = pdMS_TO_TICKS( benchTLS_TIMEOUT_MS );
+
+    ( void ) pvContext;
+
+    ( void ) Sockets_SetSockOpt( xServerSocket, SOCKETS_SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+    ( void ) Sockets_SetSockOpt( xServerSocket, SOCKETS_SO_SNDTIMEO, &xTimeout, sizeof( xTimeout ) );
+
+    return xTaskCreate( prvServerTask, "TlsServer", benchTLS_SERVER_STACK_SIZE, xServerSocket,
+                        uxTaskPriorityGet( NULL ), NULL );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvServerInit( void )
+{
+    mbedtls_ssl_config_init( &xServer.xConfig );
+    mbedtls_x509_crt_init( &xServer.xRootCa );
+    mbedtls_x509_crt_init( &xServer.xEcCertificate );
+    mbedtls_pk_init( &xServer.xEcKey );
+    mbedtls_x509_crt_init( &xServer.xRsaCertificate );
+    mbedtls_pk_init( &xServer.xRsaKey );
+    mbedtls_entropy_init( &xServer.xEntropy );
+    mbedtls_ctr_drbg_init( &xServer.xDrbg );
+
+    if( ( ( xServer.xIdle = xSemaphoreCreateBinary() ) == NULL ) ||
+        ( xSemaphoreGive( xServer.xIdle ) != pdTRUE ) ||
+        ( mbedtls_entropy_add_source( &xServer.xEntropy, mbedtls_platform_entropy_poll, NULL,
+                                      32, MBEDTLS_ENTROPY_SOURCE_STRONG ) != 0 ) ||
+        ( mbedtls_ctr_drbg_seed( &xServer.xDrbg, mbedtls_entropy_func, &xServer.xEntropy, NULL, 0 ) != 0 ) ||
+        ( mbedtls_x509_crt_parse( &xServer.xRootCa, ( const unsigned char * ) benchROOT_CA_PEM,
+                                  sizeof( benchROOT_CA_PEM ) ) != 0 ) ||
+        ( mbedtls_x509_crt_parse( &xServer.xEcCertificate, ( const unsigned char * ) benchSERVER_EC_CERT_PEM,
+                                  sizeof( benchSERVER_EC_CERT_PEM ) ) != 0 ) ||
+        ( mbedtls_pk_parse_key( &xServer.xEcKey, ( const unsigned char * ) benchSERVER_EC_KEY_PEM,
+                                sizeof( benchSERVER_EC_KEY_PEM ), NULL, 0 ) != 0 ) ||
+        ( mbedtls_x509_crt_parse( &xServer.xRsaCertificate, ( const unsigned char * ) benchSERVER_RSA_CERT_PEM,
+                                  sizeof( benchSERVER_RSA_CERT_PEM ) ) != 0 ) ||
+        ( mbedtls_pk_parse_key( &xServer.xRsaKey, ( const unsigned char * ) benchSERVER_RSA_KEY_PEM,
+                                sizeof( benchSERVER_RSA_KEY_PEM ), NULL, 0 ) != 0 ) )
+    {
+        return false;
+    }
+
+    BenchSockets_SetAcceptFunction( prvAccept, NULL );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Set up the server for one combination, between two connections.
+ */
+static bool prvServerConfigure( const BenchTlsCase_t * pxCase )
+{
+    mbedtls_ssl_config_free( &xServer.xConfig );
+    mbedtls_ssl_config_init( &xServer.xConfig );
+
+    if( ( mbedtls_ssl_config_defaults( &xServer.xConfig, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                       MBEDTLS_SSL_PRESET_DEFAULT ) != 0 ) ||
+        ( mbedtls_ssl_conf_own_cert( &xServer.xConfig,
+                                     pxCase->xRsa ? &xServer.xRsaCertificate : &xServer.xEcCertificate,
+                                     pxCase->xRsa ? &xServer.xRsaKey : &xServer.xEcKey ) != 0 ) )
+    {
+        return false;
+    }
+
+    mbedtls_ssl_conf_rng( &xServer.xConfig, mbedtls_ctr_drbg_random, &xServer.xDrbg );
+    mbedtls_ssl_conf_ciphersuites( &xServer.xConfig, pxCase->plCiphersuites );
+
+    /* With SAS the device authenticates in the MQTT CONNECT, not in TLS. */
+    if( pxCase->xX509 )
+    {
+        mbedtls_ssl_conf_authmode( &xServer.xConfig, MBEDTLS_SSL_VERIFY_REQUIRED );
+        mbedtls_ssl_conf_ca_chain( &xServer.xConfig, &xServer.xRootCa, NULL );
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static void prvServerDeinit( void )
+{
+    /* Wait for the last connection to be served. */
+    ( void ) xSemaphoreTake( xServer.xIdle, portMAX_DELAY );
+
+    BenchSockets_SetAcceptFunction( NULL, NULL );
+    vSemaphoreDelete( xServer.xIdle );
+    mbedtls_ssl_config_free( &xServer.xConfig );
+    mbedtls_x509_crt_free( &xServer.xRootCa );
+    mbedtls_x509_crt_free( &xServer.xEcCertificate );
+    mbedtls_pk_free( &xServer.xEcKey );
+    mbedtls_x509_crt_free( &xServer.xRsaCertificate );
+    mbedtls_pk_free( &xServer.xRsaKey );
+    mbedtls_ctr_drbg_free( &xServer.xDrbg );
+    mbedtls_entropy_free( &xServer.xEntropy );
+}
+/*-----------------------------------------------------------*/
+
+static int prvCompareDurations( const void * pvLeft,
+                                const void * pvRight )
+{
+    uint64_t ullLeft = *( const uint64_t * ) pvLeft;
+    uint64_t ullRight = *( const uint64_t * ) pvRight;
+
+    return ( ullLeft > ullRight ) - ( ullLeft < ullRight );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReport( const BenchTlsCase_t * pxCase,
+                       const char * pcMetric,
+                       double xValue,
+                       const char * pcUnit )
+{
+    char cName[ BENCH_MAX_NAME_LENGTH + 1 ];
+
+    ( void ) snprintf( cName, sizeof( cName ), "tls_%s%s_%s", benchTLS_VARIANT, pxCase->pcName, pcMetric );
+    Bench_Report( cName, xValue, pcUnit, eBenchLowerIsBetter );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Measure the handshakes of one combination.
+ *
+ * Reports the median time, the bytes of the last handshake in both
+ * directions and the largest heap use of the client during a handshake.
+ */
+static bool prvRunCase( const BenchTlsCase_t * pxCase )
+{
+    NetworkCredentials_t xCredentials = { 0 };
+    TlsTransportParams_t xParams = { 0 };
+    NetworkContext_t xNetworkContext = { &xParams };
+    uint64_t ullDurationsUs[ benchTLS_HANDSHAKES ];
+    uint64_t ullStartUs;
+    size_t xBytes = 0;
+    size_t xHeapPeak = 0;
+    uint32_t ulIndex;
+    bool xResult = true;
+
+    xCredentials.pucRootCa = ( const uint8_t * ) benchROOT_CA_PEM;
+    xCredentials.xRootCaSize = sizeof( benchROOT_CA_PEM );
+
+    if( pxCase->xX509 )
+    {
+        xCredentials.pucClientCert = ( const uint8_t * ) benchDEVICE_CERT_PEM;
+        xCredentials.xClientCertSize = sizeof( benchDEVICE_CERT_PEM );
+        xCredentials.pucPrivateKey = ( const uint8_t * ) benchDEVICE_KEY_PEM;
+        xCredentials.xPrivateKeySize = sizeof( benchDEVICE_KEY_PEM );
+    }
+
+    ( void ) xSemaphoreTake( xServer.xIdle, portMAX_DELAY );
+    xResult = prvServerConfigure( pxCase );
+    ( void ) xSemaphoreGive( xServer.xIdle );
+
+    for( ulIndex = 0; xResult && ( ulIndex < benchTLS_HANDSHAKES ); ulIndex++ )
+    {
+        ( void ) xSemaphoreTake( xServer.xIdle, portMAX_DELAY );
+
+        Bench_HeapStartWindow();
+        ullStartUs = Bench_NowUs();
+
+        if( TLS_Socket_Connect( &xNetworkContext, "localhost", 8883, &xCredentials,
+                                benchTLS_TIMEOUT_MS, benchTLS_TIMEOUT_MS ) != eTLSTransportSuccess )
+        {
+            ( void ) xSemaphoreGive( xServer.xIdle );
+            xResult = false;
+        }
+        else
+        {
+            ullDurationsUs[ ulIndex ] = Bench_NowUs() - ullStartUs;
+            xBytes = BenchSockets_GetBytesSent( xParams.xTCPSocket ) + BenchSockets_GetBytesReceived( xParams.xTCPSocket );
+
+            if( Bench_HeapWindowPeak() > xHeapPeak )
+            {
+                xHeapPeak = Bench_HeapWindowPeak();
+            }
+
+            TLS_Socket_Disconnect( &xNetworkContext );
+        }
+    }
+
+    if( xResult )
+    {
+        qsort( ullDurationsUs, benchTLS_HANDSHAKES, sizeof( ullDurationsUs[ 0 ] ), prvCompareDurations );
+        prvReport( pxCase, "ms", ( double ) ullDurationsUs[ benchTLS_HANDSHAKES / 2 ] / 1000.0, "ms" );
+        prvReport( pxCase, "bytes", ( double ) xBytes, "bytes" );
+        prvReport( pxCase, "heap", ( double ) xHeapPeak, "bytes" );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+bool BenchTls_Run( void )
+{
+    uint32_t ulIndex;
+    bool xResult = true;
+
+    if( !prvServerInit() )
+    {
+        return false;
+    }
+
+    for( ulIndex = 0; xResult && ( ulIndex < sizeof( xCases ) / sizeof( xCases[ 0 ] ) ); ulIndex++ )
+    {
+        xResult = prvRunCase( &xCases[ ulIndex ] );
+    }
+
+    prvServerDeinit();
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,30 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file mbedtls_config.h
+ * @brief mbed TLS configuration of the benchmarks.
+ *
+ * The configuration of the board, plus the TLS server side used by the
+ * in-process server of bench_tls.c. The TLS variants of the benchmark binary
+ * turn off the speed options of the board one by one.
+ */
+
+#ifndef BENCH_MBEDTLS_CONFIG_H
+#define BENCH_MBEDTLS_CONFIG_H
+
+#include_next "mbedtls_config.h"
+
+#define MBEDTLS_SSL_SRV_C
+
+/* AES tables computed into RAM at start instead of constant in flash. */
+#ifdef benchTLS_AES_RAM_TABLES
+    #undef MBEDTLS_AES_ROM_TABLES
+#endif
+
+/* Generic modular reduction for the NIST curves. */
+#ifdef benchTLS_NO_NIST_OPTIM
+    #undef MBEDTLS_ECP_NIST_OPTIM
+#endif
+
+#endif /* BENCH_MBEDTLS_CONFIG_H */
@@ -0,0 +1,223 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file clock_service.c
+ * @brief Monotonic and wall clock time with millisecond resolution.
+ */
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Logging configuration for the clock service. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "Clock"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "clock_service.h"
+
+/*-----------------------------------------------------------*/
+
+#ifndef CLOCK_SERVICE_MONOTONIC_US
+
+/**
+ * @brief Monotonic time from the tick count, extended to 64 bits with the
+ * kernel's overflow counter.
+ */
+    static uint64_t prvTickMonotonicUs( void )
+    {
+        TimeOut_t xNow;
+        uint64_t ullTicks;
+
+        vTaskSetTimeOutState( &xNow );
+        ullTicks = ( uint64_t ) ( UBaseType_t ) xNow.xOverflowCount * ( ( uint64_t ) portMAX_DELAY + 1U ) +
+                   ( uint64_t ) xNow.xTimeOnEntering;
+
+        return ullTicks * 1000000U / configTICK_RATE_HZ;
+    }
+
+    #define CLOCK_SERVICE_MONOTONIC_US()    prvTickMonotonicUs()
+#endif /* CLOCK_SERVICE_MONOTONIC_US */
+
+/**
+ * @brief Wall clock is monotonic time + llOffsetMs, plus the drift accrued since ullAnchorMs.
+ */
+static int64_t llOffsetMs = ( int64_t ) CLOCK_SERVICE_DEFAULT_UNIX_TIME_S * 1000;
+static uint64_t ullAnchorMs = 0;
+
+/* Drift estimation, from the corrections summed since the reference sample. */
+static bool xHasDriftReference = false;
+static uint64_t ullDriftReferenceMs = 0;
+static int64_t llCorrectionSinceReferenceMs = 0;
+
+static ClockStats_t xClockStats;
+
+static SemaphoreHandle_t xClockMutex = NULL;
+static StaticSemaphore_t xClockMutexBuffer;
+/*-----------------------------------------------------------*/
+
+static void prvLock( void )
+{
+    if( xClockMutex != NULL )
+    {
+        ( void ) xSemaphoreTake( xClockMutex, portMAX_DELAY );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvUnlock( void )
+{
+    if( xClockMutex != NULL )
+    {
+        ( void ) xSemaphoreGive( xClockMutex );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wall clock time at a monotonic time, lock held.
+ */
+static int64_t prvUnixTimeMsAt( uint64_t ullMonotonicMs )
+{
+    int64_t llElapsedMs = ( int64_t ) ( ullMonotonicMs - ullAnchorMs );
+
+    return ( int64_t ) ullMonotonicMs + llOffsetMs +
+           ( llElapsedMs * xClockStats.lDriftPpm ) / 1000000;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetAnchor( uint64_t ullUnixTimeMs,
+                          uint64_t ullMonotonicMs )
+{
+    ullAnchorMs = ullMonotonicMs;
+    llOffsetMs = ( int64_t ) ullUnixTimeMs - ( int64_t ) ullMonotonicMs;
+}
+/*-----------------------------------------------------------*/
+
+void Clock_Init( void )
+{
+    if( xClockMutex == NULL )
+    {
+        xClockMutex = xSemaphoreCreateMutexStatic( &xClockMutexBuffer );
+        configASSERT( xClockMutex != NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetMonotonicUs( void )
+{
+    return CLOCK_SERVICE_MONOTONIC_US();
+}
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetMonotonicMs( void )
+{
+    return CLOCK_SERVICE_MONOTONIC_US() / 1000U;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t Clock_GetUnixTimeMs( void )
+{
+    uint64_t ullMonotonicMs = Clock_GetMonotonicMs();
+    int64_t llUnixTimeMs;
+
+    prvLock();
+    llUnixTimeMs = prvUnixTimeMsAt( ullMonotonicMs );
+    prvUnlock();
+
+    return ( llUnixTimeMs < 0 ) ? 0 : ( uint64_t ) llUnixTimeMs;
+}
+/*-----------------------------------------------------------*/
+
+void Clock_SetUnixTimeMs( uint64_t ullUnixTimeMs )
+{
+    uint64_t ullMonotonicMs = Clock_GetMonotonicMs();
+
+    prvLock();
+    prvSetAnchor( ullUnixTimeMs, ullMonotonicMs );
+    xHasDriftReference = false;
+    xClockStats.xSynchronized = true;
+    prvUnlock();
+}
+/*-----------------------------------------------------------*/
+
+void Clock_Discipline( uint64_t ullUnixTimeMs,
+                       uint64_t ullMonotonicUs )
+{
+    uint64_t ullMonotonicMs = ullMonotonicUs / 1000U;
+    uint64_t ullSpanMs;
+    int64_t llCorrectionMs;
+    int64_t llDriftPpm;
+
+    prvLock();
+
+    llCorrectionMs = ( int64_t ) ullUnixTimeMs - prvUnixTimeMsAt( ullMonotonicMs );
+
+    if( !xHasDriftReference )
+    {
+        /* First accurate sample, the correction includes the initial error. */
+        xHasDriftReference = true;
+        ullDriftReferenceMs = ullMonotonicMs;
+        llCorrectionSinceReferenceMs = 0;
+    }
+    else
+    {
+        llCorrectionSinceReferenceMs += llCorrectionMs;
+        ullSpanMs = ullMonotonicMs - ullDriftReferenceMs;
+
+        if( ullSpanMs >= CLOCK_SERVICE_MIN_DRIFT_INTERVAL_MS )
+        {
+            /* Move halfway to the drift which would have avoided the corrections. */
+            llDriftPpm = xClockStats.lDriftPpm +
+                         ( llCorrectionSinceReferenceMs * 1000000 / ( int64_t ) ullSpanMs ) / 2;
+
+            if( llDriftPpm > CLOCK_SERVICE_MAX_DRIFT_PPM )
+            {
+                llDriftPpm = CLOCK_SERVICE_MAX_DRIFT_PPM;
+            }
+            else if( llDriftPpm < -CLOCK_SERVICE_MAX_DRIFT_PPM )
+            {
+                llDriftPpm = -CLOCK_SERVICE_MAX_DRIFT_PPM;
+            }
+
+            xClockStats.lDriftPpm = ( int32_t ) llDriftPpm;
+            ullDriftReferenceMs = ullMonotonicMs;
+            llCorrectionSinceReferenceMs = 0;
+        }
+    }
+
+    prvSetAnchor( ullUnixTimeMs, ullMonotonicMs );
+
+    xClockStats.xSynchronized = true;
+    xClockStats.ulSyncCount++;
+    xClockStats.llLastCorrectionMs = llCorrectionMs;
+    xClockStats.ullLastSyncMonotonicMs = ullMonotonicMs;
+
+    prvUnlock();
+
+    LogInfo( ( "Clock corrected by %d ms, drift %d ppm",
+               ( int ) llCorrectionMs, ( int ) xClockStats.lDriftPpm ) );
+}
+/*-----------------------------------------------------------*/
+
+bool Clock_IsSynchronized( void )
+{
+    return xClockStats.xSynchronized;
+}
+/*-----------------------------------------------------------*/
+
+void Clock_GetStats( ClockStats_t * pxStats )
+{
+    if( pxStats != NULL )
+    {
+        prvLock();
+        *pxStats = xClockStats;
+        prvUnlock();
+    }
+}
+/*-----------------------------------------------------------*/
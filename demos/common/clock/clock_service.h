@@ -0,0 +1,125 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file clock_service.h
+ * @brief Monotonic and wall clock time with millisecond resolution.
+ *
+ * Monotonic time counts from boot and never steps. By default it is derived
+ * from the 64 bit extended tick count, so its resolution is one tick (1 ms at
+ * a configTICK_RATE_HZ of 1000) even though it is returned in microseconds;
+ * define #CLOCK_SERVICE_MONOTONIC_US in demo_config.h to use a finer counter.
+ * The ESP32 ports use esp_timer and the Linux port the host monotonic clock,
+ * the Windows, STM32 and NXP ports keep tick resolution.
+ *
+ * Wall clock time is monotonic time plus an offset. Until the first time
+ * source is applied it starts at #CLOCK_SERVICE_DEFAULT_UNIX_TIME_S. Each
+ * #Clock_Discipline call, typically from an SNTP exchange, steps the offset
+ * and, once two samples are far enough apart, refines an estimate of the
+ * local oscillator drift which is applied between samples.
+ *
+ * Call #Clock_Init once before tasks use the clock. None of the functions
+ * may be called from an interrupt.
+ */
+
+#ifndef CLOCK_SERVICE_H
+#define CLOCK_SERVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Wall clock time, in seconds since the epoch, before any time source.
+ */
+#ifndef CLOCK_SERVICE_DEFAULT_UNIX_TIME_S
+    #define CLOCK_SERVICE_DEFAULT_UNIX_TIME_S      ( 1673769600ULL )
+#endif
+
+/**
+ * @brief Shortest time between two samples used to update the drift estimate.
+ */
+#ifndef CLOCK_SERVICE_MIN_DRIFT_INTERVAL_MS
+    #define CLOCK_SERVICE_MIN_DRIFT_INTERVAL_MS    ( 15U * 60U * 1000U )
+#endif
+
+/**
+ * @brief Largest drift estimate, in parts per million.
+ */
+#ifndef CLOCK_SERVICE_MAX_DRIFT_PPM
+    #define CLOCK_SERVICE_MAX_DRIFT_PPM            ( 1000 )
+#endif
+
+/**
+ * @brief Clock state, for reporting.
+ */
+typedef struct ClockStats
+{
+    bool xSynchronized;              /**< @brief A time source has been applied. */
+    uint32_t ulSyncCount;            /**< @brief Discipline samples applied. */
+    int64_t llLastCorrectionMs;      /**< @brief Step applied by the last sample, positive if the clock was late. */
+    int32_t lDriftPpm;               /**< @brief Estimated drift, positive if the local clock runs slow. */
+    uint64_t ullLastSyncMonotonicMs; /**< @brief Monotonic time of the last sample. */
+} ClockStats_t;
+
+/**
+ * @brief Create the lock guarding the wall clock state.
+ */
+void Clock_Init( void );
+
+/**
+ * @brief Monotonic time since boot.
+ *
+ * @note The resolution is one tick unless #CLOCK_SERVICE_MONOTONIC_US is
+ * defined, so intervals shorter than a tick may measure as 0.
+ *
+ * @return Time in microseconds.
+ */
+uint64_t Clock_GetMonotonicUs( void );
+
+/**
+ * @brief Monotonic time since boot.
+ *
+ * @return Time in milliseconds.
+ */
+uint64_t Clock_GetMonotonicMs( void );
+
+/**
+ * @brief Wall clock time.
+ *
+ * @return Milliseconds since 1970-01-01T00:00:00Z.
+ */
+uint64_t Clock_GetUnixTimeMs( void );
+
+/**
+ * @brief Set the wall clock from a coarse source such as an RTC or the host.
+ *
+ * Does not count as a discipline sample and resets the drift reference.
+ *
+ * @param[in] ullUnixTimeMs Current wall clock time in milliseconds.
+ */
+void Clock_SetUnixTimeMs( uint64_t ullUnixTimeMs );
+
+/**
+ * @brief Apply an accurate time sample.
+ *
+ * @param[in] ullUnixTimeMs Wall clock time in milliseconds at @p ullMonotonicUs.
+ * @param[in] ullMonotonicUs Monotonic time the sample refers to.
+ */
+void Clock_Discipline( uint64_t ullUnixTimeMs,
+                       uint64_t ullMonotonicUs );
+
+/**
+ * @brief Whether a time source has been applied.
+ *
+ * @return true once #Clock_SetUnixTimeMs or #Clock_Discipline was called.
+ */
+bool Clock_IsSynchronized( void );
+
+/**
+ * @brief Read the clock state.
+ *
+ * @param[out] pxStats Clock state.
+ */
+void Clock_GetStats( ClockStats_t * pxStats );
+
+#endif /* CLOCK_SERVICE_H */
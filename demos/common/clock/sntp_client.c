@@ -0,0 +1,90 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file sntp_client.c
+ * @brief Minimal SNTP client disciplining the clock service.
+ */
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Logging configuration for the SNTP client. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "SNTP"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "clock_service.h"
+#include "sntp_client.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Arguments of the synchronization task.
+ */
+static const char * pcTaskServer;
+static uint32_t ulTaskPeriodMs;
+/*-----------------------------------------------------------*/
+
+SNTPClientStatus_t SNTPClient_Sync( const char * pcServer )
+{
+    SNTPClientStatus_t xStatus;
+    uint64_t ullUnixTimeMs;
+    uint64_t ullMonotonicUs;
+
+    xStatus = SNTPClient_Query( pcServer, SNTP_CLIENT_TIMEOUT_MS, &ullUnixTimeMs, &ullMonotonicUs );
+
+    if( xStatus == eSNTPClientSuccess )
+    {
+        Clock_Discipline( ullUnixTimeMs, ullMonotonicUs );
+    }
+    else
+    {
+        LogWarn( ( "SNTP exchange with %s failed: status=%d", pcServer, ( int ) xStatus ) );
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSNTPClientTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        if( SNTPClient_Sync( pcTaskServer ) == eSNTPClientSuccess )
+        {
+            vTaskDelay( pdMS_TO_TICKS( ulTaskPeriodMs ) );
+        }
+        else
+        {
+            vTaskDelay( pdMS_TO_TICKS( SNTP_CLIENT_RETRY_DELAY_MS ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t SNTPClient_StartTask( const char * pcServer,
+                                 uint32_t ulPeriodMs )
+{
+    if( pcServer == NULL )
+    {
+        return pdFAIL;
+    }
+
+    pcTaskServer = pcServer;
+    ulTaskPeriodMs = ulPeriodMs;
+
+    return xTaskCreate( prvSNTPClientTask,
+                        "SNTP",
+                        SNTP_CLIENT_TASK_STACK_SIZE,
+                        NULL,
+                        SNTP_CLIENT_TASK_PRIORITY,
+                        NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,94 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file sntp_client.h
+ * @brief Minimal SNTP client disciplining the clock service.
+ *
+ * #SNTPClient_Query performs one request/reply exchange over UDP and is
+ * implemented once per network stack (sntp_client_freertos_tcpip.c,
+ * sntp_client_lwip.c). The rest is stack independent.
+ */
+
+#ifndef SNTP_CLIENT_H
+#define SNTP_CLIENT_H
+
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/**
+ * @brief Stack size of the task started by #SNTPClient_StartTask.
+ */
+#ifndef SNTP_CLIENT_TASK_STACK_SIZE
+    #define SNTP_CLIENT_TASK_STACK_SIZE     ( configMINIMAL_STACK_SIZE * 4 )
+#endif
+
+/**
+ * @brief Priority of the task started by #SNTPClient_StartTask.
+ */
+#ifndef SNTP_CLIENT_TASK_PRIORITY
+    #define SNTP_CLIENT_TASK_PRIORITY       ( tskIDLE_PRIORITY + 1 )
+#endif
+
+/**
+ * @brief Time to wait for a reply.
+ */
+#ifndef SNTP_CLIENT_TIMEOUT_MS
+    #define SNTP_CLIENT_TIMEOUT_MS          ( 3000U )
+#endif
+
+/**
+ * @brief Delay before retrying a failed exchange from the task.
+ */
+#ifndef SNTP_CLIENT_RETRY_DELAY_MS
+    #define SNTP_CLIENT_RETRY_DELAY_MS      ( 10000U )
+#endif
+
+/**
+ * @brief Result of an exchange.
+ */
+typedef enum SNTPClientStatus
+{
+    eSNTPClientSuccess = 0,
+    eSNTPClientInvalidParameter,
+    eSNTPClientDNSFailed,
+    eSNTPClientSocketError,
+    eSNTPClientTimeout,
+    eSNTPClientBadReply
+} SNTPClientStatus_t;
+
+/**
+ * @brief Query a server once, without changing the clock.
+ *
+ * @param[in] pcServer Host name of the server.
+ * @param[in] ulTimeoutMs Time to wait for the reply.
+ * @param[out] pullUnixTimeMs Server time when the reply was received.
+ * @param[out] pullMonotonicUs Monotonic time when the reply was received.
+ * @return An #SNTPClientStatus_t with the result of the operation.
+ */
+SNTPClientStatus_t SNTPClient_Query( const char * pcServer,
+                                     uint32_t ulTimeoutMs,
+                                     uint64_t * pullUnixTimeMs,
+                                     uint64_t * pullMonotonicUs );
+
+/**
+ * @brief Query a server and discipline the clock with the reply.
+ *
+ * @param[in] pcServer Host name of the server.
+ * @return An #SNTPClientStatus_t with the result of the operation.
+ */
+SNTPClientStatus_t SNTPClient_Sync( const char * pcServer );
+
+/**
+ * @brief Start a task which synchronizes the clock periodically.
+ *
+ * @param[in] pcServer Host name of the server, must stay valid.
+ * @param[in] ulPeriodMs Time between successful exchanges.
+ * @return pdPASS if the task was created.
+ */
+BaseType_t SNTPClient_StartTask( const char * pcServer,
+                                 uint32_t ulPeriodMs );
+
+#endif /* SNTP_CLIENT_H */
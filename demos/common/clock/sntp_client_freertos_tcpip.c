@@ -0,0 +1,103 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file sntp_client_freertos_tcpip.c
+ * @brief SNTP exchange over FreeRTOS+TCP.
+ */
+
+#include "sntp_client.h"
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_DNS.h"
+
+#include "clock_service.h"
+#include "sntp_packet.h"
+/*-----------------------------------------------------------*/
+
+SNTPClientStatus_t SNTPClient_Query( const char * pcServer,
+                                     uint32_t ulTimeoutMs,
+                                     uint64_t * pullUnixTimeMs,
+                                     uint64_t * pullMonotonicUs )
+{
+    SNTPClientStatus_t xStatus = eSNTPClientSuccess;
+    struct freertos_sockaddr xServerAddress = { 0 };
+    struct freertos_sockaddr xSourceAddress;
+    socklen_t xSourceAddressLength = sizeof( xSourceAddress );
+    uint8_t ucPacket[ SNTP_PACKET_SIZE ];
+    TickType_t xTimeout = pdMS_TO_TICKS( ulTimeoutMs );
+    Socket_t xSocket;
+    uint32_t ulIPAddress;
+    uint64_t ullTransmitUnixTimeMs;
+    uint64_t ullSendMonotonicUs;
+    int32_t lReceived;
+
+    if( ( pcServer == NULL ) || ( pullUnixTimeMs == NULL ) || ( pullMonotonicUs == NULL ) )
+    {
+        return eSNTPClientInvalidParameter;
+    }
+
+    if( ( ulIPAddress = ( uint32_t ) FreeRTOS_gethostbyname( pcServer ) ) == 0 )
+    {
+        return eSNTPClientDNSFailed;
+    }
+
+    xSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP );
+
+    if( xSocket == FREERTOS_INVALID_SOCKET )
+    {
+        return eSNTPClientSocketError;
+    }
+
+    ( void ) FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+
+    xServerAddress.sin_family = FREERTOS_AF_INET;
+    xServerAddress.sin_port = FreeRTOS_htons( SNTP_PORT );
+    xServerAddress.sin_addr = ulIPAddress;
+    xServerAddress.sin_len = ( uint8_t ) sizeof( xServerAddress );
+
+    ullTransmitUnixTimeMs = Clock_GetUnixTimeMs();
+    SNTPPacket_BuildRequest( ucPacket, ullTransmitUnixTimeMs );
+    ullSendMonotonicUs = Clock_GetMonotonicUs();
+
+    if( FreeRTOS_sendto( xSocket, ucPacket, sizeof( ucPacket ), 0,
+                         &xServerAddress, sizeof( xServerAddress ) ) != ( int32_t ) sizeof( ucPacket ) )
+    {
+        xStatus = eSNTPClientSocketError;
+    }
+    else
+    {
+        /* Skip stray datagrams until the reply from the server or the timeout. */
+        do
+        {
+            lReceived = FreeRTOS_recvfrom( xSocket, ucPacket, sizeof( ucPacket ), 0,
+                                           &xSourceAddress, &xSourceAddressLength );
+        } while( ( lReceived > 0 ) && ( xSourceAddress.sin_addr != ulIPAddress ) );
+
+        *pullMonotonicUs = Clock_GetMonotonicUs();
+
+        if( lReceived <= 0 )
+        {
+            xStatus = eSNTPClientTimeout;
+        }
+        else if( SNTPPacket_ParseReply( ucPacket, ( uint32_t ) lReceived, ullTransmitUnixTimeMs,
+                                        ( uint32_t ) ( ( *pullMonotonicUs - ullSendMonotonicUs ) / 1000U ),
+                                        pullUnixTimeMs ) != eSNTPSuccess )
+        {
+            xStatus = eSNTPClientBadReply;
+        }
+    }
+
+    ( void ) FreeRTOS_closesocket( xSocket );
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
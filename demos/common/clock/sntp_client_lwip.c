@@ -0,0 +1,105 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file sntp_client_lwip.c
+ * @brief SNTP exchange over lwIP sockets.
+ */
+
+#include "sntp_client.h"
+
+/* Standard includes. */
+#include <string.h>
+
+/* Lwip includes. */
+#include "lwip/sockets.h"
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+#include "clock_service.h"
+#include "sntp_packet.h"
+/*-----------------------------------------------------------*/
+
+/* DNS resolution from sockets_wrapper_lwip.c. */
+extern uint32_t prvGetHostByName( const char * pcHostName );
+/*-----------------------------------------------------------*/
+
+SNTPClientStatus_t SNTPClient_Query( const char * pcServer,
+                                     uint32_t ulTimeoutMs,
+                                     uint64_t * pullUnixTimeMs,
+                                     uint64_t * pullMonotonicUs )
+{
+    SNTPClientStatus_t xStatus = eSNTPClientSuccess;
+    struct sockaddr_in xServerAddress = { 0 };
+    struct sockaddr_in xSourceAddress;
+    socklen_t xSourceAddressLength;
+    struct timeval xTimeout;
+    uint8_t ucPacket[ SNTP_PACKET_SIZE ];
+    uint32_t ulIPAddress;
+    uint64_t ullTransmitUnixTimeMs;
+    uint64_t ullSendMonotonicUs;
+    int lSocket;
+    int lReceived;
+
+    if( ( pcServer == NULL ) || ( pullUnixTimeMs == NULL ) || ( pullMonotonicUs == NULL ) )
+    {
+        return eSNTPClientInvalidParameter;
+    }
+
+    if( ( ulIPAddress = prvGetHostByName( pcServer ) ) == 0 )
+    {
+        return eSNTPClientDNSFailed;
+    }
+
+    if( ( lSocket = lwip_socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP ) ) < 0 )
+    {
+        return eSNTPClientSocketError;
+    }
+
+    xTimeout.tv_sec = ulTimeoutMs / 1000U;
+    xTimeout.tv_usec = ( ulTimeoutMs % 1000U ) * 1000U;
+    ( void ) lwip_setsockopt( lSocket, SOL_SOCKET, SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+
+    xServerAddress.sin_family = AF_INET;
+    xServerAddress.sin_port = lwip_htons( SNTP_PORT );
+    xServerAddress.sin_addr.s_addr = ulIPAddress;
+
+    ullTransmitUnixTimeMs = Clock_GetUnixTimeMs();
+    SNTPPacket_BuildRequest( ucPacket, ullTransmitUnixTimeMs );
+    ullSendMonotonicUs = Clock_GetMonotonicUs();
+
+    if( lwip_sendto( lSocket, ucPacket, sizeof( ucPacket ), 0,
+                     ( struct sockaddr * ) &xServerAddress, sizeof( xServerAddress ) ) != ( int ) sizeof( ucPacket ) )
+    {
+        xStatus = eSNTPClientSocketError;
+    }
+    else
+    {
+        /* Skip stray datagrams until the reply from the server or the timeout. */
+        do
+        {
+            xSourceAddressLength = sizeof( xSourceAddress );
+            lReceived = lwip_recvfrom( lSocket, ucPacket, sizeof( ucPacket ), 0,
+                                       ( struct sockaddr * ) &xSourceAddress, &xSourceAddressLength );
+        } while( ( lReceived > 0 ) && ( xSourceAddress.sin_addr.s_addr != ulIPAddress ) );
+
+        *pullMonotonicUs = Clock_GetMonotonicUs();
+
+        if( lReceived <= 0 )
+        {
+            xStatus = eSNTPClientTimeout;
+        }
+        else if( SNTPPacket_ParseReply( ucPacket, ( uint32_t ) lReceived, ullTransmitUnixTimeMs,
+                                        ( uint32_t ) ( ( *pullMonotonicUs - ullSendMonotonicUs ) / 1000U ),
+                                        pullUnixTimeMs ) != eSNTPSuccess )
+        {
+            xStatus = eSNTPClientBadReply;
+        }
+    }
+
+    ( void ) lwip_close( lSocket );
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
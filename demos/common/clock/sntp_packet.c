@@ -0,0 +1,133 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file sntp_packet.c
+ * @brief Serialization of SNTP (RFC 4330) client requests and server replies.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "sntp_packet.h"
+
+/*-----------------------------------------------------------*/
+
+/* Seconds from the NTP epoch (1900) to the Unix epoch (1970). */
+#define sntpNTP_TO_UNIX_SECONDS        ( 2208988800ULL )
+
+/* Version 4, client mode. */
+#define sntpREQUEST_FLAGS              ( ( 4U << 3 ) | 3U )
+
+#define sntpMODE_MASK                  ( 0x07U )
+#define sntpMODE_SERVER                ( 4U )
+#define sntpLEAP_UNSYNCHRONIZED        ( 3U )
+
+#define sntpSTRATUM_OFFSET             ( 1U )
+#define sntpORIGINATE_OFFSET           ( 24U )
+#define sntpRECEIVE_OFFSET             ( 32U )
+#define sntpTRANSMIT_OFFSET            ( 40U )
+/*-----------------------------------------------------------*/
+
+static void prvWriteTimestamp( uint8_t * pucDestination,
+                               uint64_t ullUnixTimeMs )
+{
+    uint32_t ulSeconds = ( uint32_t ) ( ullUnixTimeMs / 1000U + sntpNTP_TO_UNIX_SECONDS );
+    uint32_t ulFraction = ( uint32_t ) ( ( ( ullUnixTimeMs % 1000U ) << 32 ) / 1000U );
+
+    pucDestination[ 0 ] = ( uint8_t ) ( ulSeconds >> 24 );
+    pucDestination[ 1 ] = ( uint8_t ) ( ulSeconds >> 16 );
+    pucDestination[ 2 ] = ( uint8_t ) ( ulSeconds >> 8 );
+    pucDestination[ 3 ] = ( uint8_t ) ulSeconds;
+    pucDestination[ 4 ] = ( uint8_t ) ( ulFraction >> 24 );
+    pucDestination[ 5 ] = ( uint8_t ) ( ulFraction >> 16 );
+    pucDestination[ 6 ] = ( uint8_t ) ( ulFraction >> 8 );
+    pucDestination[ 7 ] = ( uint8_t ) ulFraction;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadUInt32( const uint8_t * pucSource )
+{
+    return ( ( uint32_t ) pucSource[ 0 ] << 24 ) | ( ( uint32_t ) pucSource[ 1 ] << 16 ) |
+           ( ( uint32_t ) pucSource[ 2 ] << 8 ) | ( uint32_t ) pucSource[ 3 ];
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief NTP timestamp to Unix milliseconds, assuming NTP era 0 (until 2036).
+ */
+static int64_t prvReadTimestamp( const uint8_t * pucSource )
+{
+    uint64_t ullSeconds = prvReadUInt32( pucSource );
+    uint64_t ullFraction = prvReadUInt32( pucSource + 4 );
+
+    return ( int64_t ) ( ( ullSeconds - sntpNTP_TO_UNIX_SECONDS ) * 1000U +
+                         ( ( ullFraction * 1000U + 0x80000000U ) >> 32 ) );
+}
+/*-----------------------------------------------------------*/
+
+void SNTPPacket_BuildRequest( uint8_t * pucPacket,
+                              uint64_t ullTransmitUnixTimeMs )
+{
+    if( pucPacket != NULL )
+    {
+        memset( pucPacket, 0, SNTP_PACKET_SIZE );
+        pucPacket[ 0 ] = ( uint8_t ) sntpREQUEST_FLAGS;
+        prvWriteTimestamp( &pucPacket[ sntpTRANSMIT_OFFSET ], ullTransmitUnixTimeMs );
+    }
+}
+/*-----------------------------------------------------------*/
+
+SNTPStatus_t SNTPPacket_ParseReply( const uint8_t * pucPacket,
+                                    uint32_t ulPacketLength,
+                                    uint64_t ullTransmitUnixTimeMs,
+                                    uint32_t ulRoundTripMs,
+                                    uint64_t * pullUnixTimeMs )
+{
+    uint8_t ucExpectedOriginate[ 8 ];
+    int64_t llServerReceiveMs;
+    int64_t llServerTransmitMs;
+    int64_t llNetworkDelayMs;
+
+    if( ( pucPacket == NULL ) || ( pullUnixTimeMs == NULL ) )
+    {
+        return eSNTPInvalidParameter;
+    }
+
+    if( ( ulPacketLength < SNTP_PACKET_SIZE ) ||
+        ( ( pucPacket[ 0 ] & sntpMODE_MASK ) != sntpMODE_SERVER ) )
+    {
+        return eSNTPInvalidPacket;
+    }
+
+    if( pucPacket[ sntpSTRATUM_OFFSET ] == 0 )
+    {
+        return eSNTPKissOfDeath;
+    }
+
+    if( ( pucPacket[ 0 ] >> 6 ) == sntpLEAP_UNSYNCHRONIZED )
+    {
+        return eSNTPUnsynchronized;
+    }
+
+    prvWriteTimestamp( ucExpectedOriginate, ullTransmitUnixTimeMs );
+
+    if( memcmp( &pucPacket[ sntpORIGINATE_OFFSET ], ucExpectedOriginate, sizeof( ucExpectedOriginate ) ) != 0 )
+    {
+        return eSNTPOriginateMismatch;
+    }
+
+    llServerReceiveMs = prvReadTimestamp( &pucPacket[ sntpRECEIVE_OFFSET ] );
+    llServerTransmitMs = prvReadTimestamp( &pucPacket[ sntpTRANSMIT_OFFSET ] );
+    llNetworkDelayMs = ( int64_t ) ulRoundTripMs - ( llServerTransmitMs - llServerReceiveMs );
+
+    if( llNetworkDelayMs < 0 )
+    {
+        llNetworkDelayMs = 0;
+    }
+
+    *pullUnixTimeMs = ( uint64_t ) ( llServerTransmitMs + llNetworkDelayMs / 2 );
+
+    return eSNTPSuccess;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,69 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file sntp_packet.h
+ * @brief Serialization of SNTP (RFC 4330) client requests and server replies.
+ *
+ * Only the fields a unicast client needs are handled. The functions are
+ * plain integer arithmetic with no kernel or network stack dependency, so
+ * each socket layer only has to move the 48 byte packets.
+ */
+
+#ifndef SNTP_PACKET_H
+#define SNTP_PACKET_H
+
+#include <stdint.h>
+
+/**
+ * @brief Size of an SNTP packet without authentication.
+ */
+#define SNTP_PACKET_SIZE    ( 48U )
+
+/**
+ * @brief UDP port of SNTP servers.
+ */
+#define SNTP_PORT           ( 123U )
+
+/**
+ * @brief Result of parsing a reply.
+ */
+typedef enum SNTPStatus
+{
+    eSNTPSuccess = 0,
+    eSNTPInvalidParameter,
+    eSNTPInvalidPacket,      /**< Wrong size or mode. */
+    eSNTPKissOfDeath,        /**< Stratum 0, the server asks the client to back off. */
+    eSNTPUnsynchronized,     /**< Server clock not synchronized. */
+    eSNTPOriginateMismatch   /**< Reply does not answer our request. */
+} SNTPStatus_t;
+
+/**
+ * @brief Build a client request.
+ *
+ * @param[out] pucPacket Buffer of #SNTP_PACKET_SIZE bytes.
+ * @param[in] ullTransmitUnixTimeMs Local wall clock time, echoed by the server.
+ */
+void SNTPPacket_BuildRequest( uint8_t * pucPacket,
+                              uint64_t ullTransmitUnixTimeMs );
+
+/**
+ * @brief Parse a server reply.
+ *
+ * The server time is corrected by half of the round trip, excluding the
+ * time the server held the request.
+ *
+ * @param[in] pucPacket Received packet.
+ * @param[in] ulPacketLength Length of @p pucPacket.
+ * @param[in] ullTransmitUnixTimeMs Value passed to #SNTPPacket_BuildRequest.
+ * @param[in] ulRoundTripMs Local time between sending the request and receiving the reply.
+ * @param[out] pullUnixTimeMs Wall clock time when the reply was received.
+ * @return An #SNTPStatus_t with the result of the operation.
+ */
+SNTPStatus_t SNTPPacket_ParseReply( const uint8_t * pucPacket,
+                                    uint32_t ulPacketLength,
+                                    uint64_t ullTransmitUnixTimeMs,
+                                    uint32_t ulRoundTripMs,
+                                    uint64_t * pullUnixTimeMs );
+
+#endif /* SNTP_PACKET_H */
@@ -0,0 +1,296 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_command.c
+ * @brief Execution of commands on worker tasks, away from the process loop.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* Logging configuration for the command dispatcher. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "HubCommand"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "clock_service.h"
+#include "hub_command.h"
+
+/*-----------------------------------------------------------*/
+
+#define hubcommandEMPTY_PAYLOAD             "{}"
+#define hubcommandSTATUS_TOO_LARGE          ( 413U )
+#define hubcommandSTATUS_UNAVAILABLE        ( 503U )
+/*-----------------------------------------------------------*/
+
+static bool prvIsExpired( const HubCommandPool_t * pxPool,
+                          const HubCommandSlot_t * pxSlot )
+{
+    return ( Clock_GetMonotonicUs() - pxSlot->xTraceRecord.ullPointsUs[ eHubTraceArrival ] ) >
+           ( ( uint64_t ) pxPool->ulTimeoutMs * 1000U );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSpanMs( const HubTraceRecord_t * pxRecord,
+                           HubTraceCommandPoint_t xFrom,
+                           HubTraceCommandPoint_t xTo )
+{
+    return ( uint32_t ) ( ( pxRecord->ullPointsUs[ xTo ] - pxRecord->ullPointsUs[ xFrom ] ) / 1000U );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Answer a request which is not queued.
+ */
+static void prvReject( HubCommandPool_t * pxPool,
+                       const AzureIoTHubClientCommandRequest_t * pxMessage,
+                       uint32_t ulStatus )
+{
+    AzureIoTResult_t xResult;
+
+    pxPool->xStats.ulRejected++;
+
+    if( ( xResult = AzureIoTHubClient_SendCommandResponse( pxPool->pxHubClient, pxMessage, ulStatus,
+                                                           ( const uint8_t * ) hubcommandEMPTY_PAYLOAD,
+                                                           sizeof( hubcommandEMPTY_PAYLOAD ) - 1 ) ) != eAzureIoTSuccess )
+    {
+        LogError( ( "Error sending command rejection %u: result 0x%08x", ( unsigned ) ulStatus, xResult ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvCopyField( const uint8_t * pucSource,
+                          uint16_t usLength,
+                          uint8_t * pucField,
+                          const uint8_t ** ppucCopy,
+                          uint16_t * pusCopyLength )
+{
+    if( usLength > 0 )
+    {
+        ( void ) memcpy( pucField, pucSource, usLength );
+    }
+
+    *ppucCopy = ( usLength > 0 ) ? pucField : NULL;
+    *pusCopyLength = usLength;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWorkerTask( void * pvParameters )
+{
+    HubCommandPool_t * pxPool = ( HubCommandPool_t * ) pvParameters;
+    HubCommandSlot_t * pxSlot;
+    uint32_t ulIndex;
+
+    for( ; ; )
+    {
+        if( xQueueReceive( pxPool->xRequestQueue, &ulIndex, portMAX_DELAY ) != pdTRUE )
+        {
+            continue;
+        }
+
+        pxSlot = &pxPool->xSlots[ ulIndex ];
+        pxSlot->xTimedOut = prvIsExpired( pxPool, pxSlot );
+
+        if( !pxSlot->xTimedOut )
+        {
+            HubTrace_Mark( &pxSlot->xTraceRecord, eHubTraceHandlerStart );
+            pxSlot->ulResponseLength = pxPool->xHandler( &pxSlot->xRequest, &pxSlot->ulResponseStatus,
+                                                         pxSlot->ucResponse, sizeof( pxSlot->ucResponse ) );
+            HubTrace_Mark( &pxSlot->xTraceRecord, eHubTraceHandlerEnd );
+        }
+
+        /* Never waits, the queue holds every slot. */
+        ( void ) xQueueSend( pxPool->xResponseQueue, &ulIndex, portMAX_DELAY );
+    }
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubCommand_Init( HubCommandPool_t * pxPool,
+                                  AzureIoTHubClient_t * pxHubClient,
+                                  HubCommandHandler_t xHandler,
+                                  HubTrace_t * pxTrace,
+                                  uint32_t ulTimeoutMs )
+{
+    uint32_t ulWorker;
+
+    if( ( pxPool == NULL ) || ( pxHubClient == NULL ) || ( xHandler == NULL ) )
+    {
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxPool, 0, sizeof( HubCommandPool_t ) );
+    pxPool->pxHubClient = pxHubClient;
+    pxPool->xHandler = xHandler;
+    pxPool->pxTrace = pxTrace;
+    pxPool->ulTimeoutMs = ulTimeoutMs;
+
+    pxPool->xRequestQueue = xQueueCreateStatic( HUB_COMMAND_MAX_PENDING, sizeof( uint32_t ),
+                                                pxPool->ucRequestQueueStorage, &pxPool->xRequestQueueBuffer );
+    pxPool->xResponseQueue = xQueueCreateStatic( HUB_COMMAND_MAX_PENDING, sizeof( uint32_t ),
+                                                 pxPool->ucResponseQueueStorage, &pxPool->xResponseQueueBuffer );
+    configASSERT( ( pxPool->xRequestQueue != NULL ) && ( pxPool->xResponseQueue != NULL ) );
+
+    for( ulWorker = 0; ulWorker < HUB_COMMAND_WORKERS; ulWorker++ )
+    {
+        if( xTaskCreate( prvWorkerTask, "HubCommand", HUB_COMMAND_WORKER_STACK_SIZE, pxPool,
+                         HUB_COMMAND_WORKER_PRIORITY, NULL ) != pdPASS )
+        {
+            LogError( ( "Failed to create command worker %u", ( unsigned ) ulWorker ) );
+            return eAzureIoTErrorOutOfMemory;
+        }
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubCommand_Dispatch( HubCommandPool_t * pxPool,
+                                      const AzureIoTHubClientCommandRequest_t * pxMessage )
+{
+    HubCommandSlot_t * pxSlot = NULL;
+    uint32_t ulIndex;
+
+    pxPool->xStats.ulReceived++;
+
+    if( ( pxMessage->usRequestIDLength > HUB_COMMAND_MAX_REQUEST_ID_LENGTH ) ||
+        ( pxMessage->usComponentNameLength > HUB_COMMAND_MAX_NAME_LENGTH ) ||
+        ( pxMessage->usCommandNameLength > HUB_COMMAND_MAX_NAME_LENGTH ) ||
+        ( pxMessage->ulPayloadLength > HUB_COMMAND_MAX_PAYLOAD_LENGTH ) )
+    {
+        LogWarn( ( "Command %.*s does not fit a slot, rejected: request ID %u, component %u, "
+                   "command %u and payload %u bytes",
+                   pxMessage->usCommandNameLength, ( const char * ) pxMessage->pucCommandName,
+                   ( unsigned ) pxMessage->usRequestIDLength, ( unsigned ) pxMessage->usComponentNameLength,
+                   ( unsigned ) pxMessage->usCommandNameLength, ( unsigned ) pxMessage->ulPayloadLength ) );
+        prvReject( pxPool, pxMessage, hubcommandSTATUS_TOO_LARGE );
+
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    for( ulIndex = 0; ulIndex < HUB_COMMAND_MAX_PENDING; ulIndex++ )
+    {
+        if( !pxPool->xSlots[ ulIndex ].xInUse )
+        {
+            pxSlot = &pxPool->xSlots[ ulIndex ];
+            break;
+        }
+    }
+
+    if( pxSlot == NULL )
+    {
+        LogWarn( ( "No free command slot, %.*s rejected",
+                   pxMessage->usCommandNameLength, ( const char * ) pxMessage->pucCommandName ) );
+        prvReject( pxPool, pxMessage, hubcommandSTATUS_UNAVAILABLE );
+
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    HubTrace_CommandStart( &pxSlot->xTraceRecord );
+    pxSlot->xInUse = true;
+    pxSlot->xTimedOut = false;
+    pxSlot->ulResponseStatus = 0;
+    pxSlot->ulResponseLength = 0;
+
+    prvCopyField( pxMessage->pucRequestID, pxMessage->usRequestIDLength, pxSlot->ucRequestID,
+                  &pxSlot->xRequest.pucRequestID, &pxSlot->xRequest.usRequestIDLength );
+    prvCopyField( pxMessage->pucComponentName, pxMessage->usComponentNameLength, pxSlot->ucComponentName,
+                  &pxSlot->xRequest.pucComponentName, &pxSlot->xRequest.usComponentNameLength );
+    prvCopyField( pxMessage->pucCommandName, pxMessage->usCommandNameLength, pxSlot->ucCommandName,
+                  &pxSlot->xRequest.pucCommandName, &pxSlot->xRequest.usCommandNameLength );
+
+    if( pxMessage->ulPayloadLength > 0 )
+    {
+        ( void ) memcpy( pxSlot->ucPayload, pxMessage->pvMessagePayload, pxMessage->ulPayloadLength );
+    }
+
+    pxSlot->xRequest.pvMessagePayload = pxSlot->ucPayload;
+    pxSlot->xRequest.ulPayloadLength = pxMessage->ulPayloadLength;
+
+    pxPool->xStats.ulQueueDepth++;
+
+    if( pxPool->xStats.ulQueueDepth > pxPool->xStats.ulMaxQueueDepth )
+    {
+        pxPool->xStats.ulMaxQueueDepth = pxPool->xStats.ulQueueDepth;
+    }
+
+    /* Never waits, the queue holds every slot. */
+    ( void ) xQueueSend( pxPool->xRequestQueue, &ulIndex, 0 );
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubCommand_Process( HubCommandPool_t * pxPool )
+{
+    AzureIoTResult_t xReturn = eAzureIoTSuccess;
+    AzureIoTResult_t xResult;
+    HubCommandSlot_t * pxSlot;
+    uint32_t ulIndex;
+    uint32_t ulMs;
+
+    while( xQueueReceive( pxPool->xResponseQueue, &ulIndex, 0 ) == pdTRUE )
+    {
+        pxSlot = &pxPool->xSlots[ ulIndex ];
+
+        if( pxSlot->xTimedOut )
+        {
+            LogWarn( ( "Command %.*s timed out before it ran",
+                       pxSlot->xRequest.usCommandNameLength, ( const char * ) pxSlot->xRequest.pucCommandName ) );
+            pxPool->xStats.ulTimedOut++;
+        }
+        else
+        {
+            ulMs = prvSpanMs( &pxSlot->xTraceRecord, eHubTraceArrival, eHubTraceHandlerStart );
+            pxPool->xStats.ulMaxWaitMs = ( ulMs > pxPool->xStats.ulMaxWaitMs ) ? ulMs : pxPool->xStats.ulMaxWaitMs;
+
+            ulMs = prvSpanMs( &pxSlot->xTraceRecord, eHubTraceHandlerStart, eHubTraceHandlerEnd );
+            pxPool->xStats.ulMaxExecutionMs = ( ulMs > pxPool->xStats.ulMaxExecutionMs ) ? ulMs : pxPool->xStats.ulMaxExecutionMs;
+            pxPool->xStats.ullExecutionMs += ulMs;
+
+            if( prvIsExpired( pxPool, pxSlot ) )
+            {
+                LogWarn( ( "Command %.*s ran for %u ms, response dropped after the timeout",
+                           pxSlot->xRequest.usCommandNameLength, ( const char * ) pxSlot->xRequest.pucCommandName,
+                           ( unsigned ) ulMs ) );
+                pxPool->xStats.ulTimedOut++;
+            }
+            else if( ( xResult = AzureIoTHubClient_SendCommandResponse( pxPool->pxHubClient, &pxSlot->xRequest,
+                                                                        pxSlot->ulResponseStatus,
+                                                                        pxSlot->ucResponse,
+                                                                        pxSlot->ulResponseLength ) ) != eAzureIoTSuccess )
+            {
+                LogError( ( "Error sending command response: result 0x%08x", xResult ) );
+                xReturn = xResult;
+            }
+            else
+            {
+                HubTrace_Mark( &pxSlot->xTraceRecord, eHubTraceResponse );
+                pxPool->xStats.ulCompleted++;
+            }
+
+            HubTrace_CommandEnd( pxPool->pxTrace, &pxSlot->xTraceRecord );
+        }
+
+        pxSlot->xInUse = false;
+        pxPool->xStats.ulQueueDepth--;
+    }
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void HubCommand_GetStats( const HubCommandPool_t * pxPool,
+                          HubCommandStats_t * pxStats )
+{
+    *pxStats = pxPool->xStats;
+}
+/*-----------------------------------------------------------*/
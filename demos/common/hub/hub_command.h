@@ -0,0 +1,223 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_command.h
+ * @brief Execution of commands on worker tasks, away from the process loop.
+ *
+ * The command callback runs inside AzureIoTHubClient_ProcessLoop(), so a
+ * slow handler holds back keep alives and every other incoming message.
+ * #HubCommand_Dispatch, called from the callback instead of the handler,
+ * copies the request into a free slot of a fixed pool and queues it for
+ * #HUB_COMMAND_WORKERS worker tasks. The handler runs on a worker, which
+ * queues the slot back with the response. #HubCommand_Process, called from
+ * the task running the process loop, sends the queued responses with
+ * AzureIoTHubClient_SendCommandResponse(), as the hub client is not thread
+ * safe, and frees their slots.
+ *
+ * A request which does not fit its slot or finds no free slot is answered
+ * at once with an error status. A request still queued when its timeout
+ * passed is not run, and a response ready after the timeout is not sent,
+ * IoT Hub having already answered the caller.
+ *
+ * Handlers of different requests run at the same time when there is more
+ * than one worker.
+ */
+
+#ifndef HUB_COMMAND_H
+#define HUB_COMMAND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "queue.h"
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+#include "hub_trace.h"
+
+/**
+ * @brief Number of requests queued or running at a time.
+ */
+#ifndef HUB_COMMAND_MAX_PENDING
+    #define HUB_COMMAND_MAX_PENDING               ( 4U )
+#endif
+
+/**
+ * @brief Number of worker tasks.
+ */
+#ifndef HUB_COMMAND_WORKERS
+    #define HUB_COMMAND_WORKERS                   ( 1U )
+#endif
+
+#ifndef HUB_COMMAND_WORKER_STACK_SIZE
+    #define HUB_COMMAND_WORKER_STACK_SIZE         ( configMINIMAL_STACK_SIZE * 4 )
+#endif
+
+#ifndef HUB_COMMAND_WORKER_PRIORITY
+    #define HUB_COMMAND_WORKER_PRIORITY           ( tskIDLE_PRIORITY )
+#endif
+
+/**
+ * @brief Longest request ID.
+ *
+ * IoT Hub passes the request ID in the $rid parameter of the command topic.
+ * It is a hexadecimal counter today, but its length is not bounded by the
+ * service, so this leaves it room to grow. Requests with a longer ID are
+ * answered with status 413.
+ */
+#ifndef HUB_COMMAND_MAX_REQUEST_ID_LENGTH
+    #define HUB_COMMAND_MAX_REQUEST_ID_LENGTH     ( 64U )
+#endif
+
+/**
+ * @brief Longest component name or command name.
+ *
+ * DTDL limits names to 64 characters. Requests with a longer name are
+ * answered with status 413.
+ */
+#ifndef HUB_COMMAND_MAX_NAME_LENGTH
+    #define HUB_COMMAND_MAX_NAME_LENGTH           ( 64U )
+#endif
+
+/**
+ * @brief Longest request payload.
+ *
+ * Requests with a longer payload are answered with status 413.
+ */
+#ifndef HUB_COMMAND_MAX_PAYLOAD_LENGTH
+    #define HUB_COMMAND_MAX_PAYLOAD_LENGTH        ( 256U )
+#endif
+
+/**
+ * @brief Size of the response payload buffer given to the handler.
+ */
+#ifndef HUB_COMMAND_MAX_RESPONSE_LENGTH
+    #define HUB_COMMAND_MAX_RESPONSE_LENGTH       ( 256U )
+#endif
+
+/**
+ * @brief Handler of a command, with the signature of ulHandleCommand().
+ *
+ * @param[in] pxMessage Request, pointing into its slot.
+ * @param[out] pulResponseStatus Status of the response.
+ * @param[out] pucResponsePayload Buffer for the response payload.
+ * @param[in] ulResponsePayloadSize Size of @p pucResponsePayload.
+ * @return Length of the response payload.
+ */
+typedef uint32_t ( * HubCommandHandler_t )( AzureIoTHubClientCommandRequest_t * pxMessage,
+                                            uint32_t * pulResponseStatus,
+                                            uint8_t * pucResponsePayload,
+                                            uint32_t ulResponsePayloadSize );
+
+/**
+ * @brief One request, owned by the process loop task while free or
+ * answered, by a worker while queued or running.
+ */
+typedef struct HubCommandSlot
+{
+    bool xInUse;
+    bool xTimedOut; /**< @brief Timeout passed before the handler ran. */
+    AzureIoTHubClientCommandRequest_t xRequest;
+    uint8_t ucRequestID[ HUB_COMMAND_MAX_REQUEST_ID_LENGTH ];
+    uint8_t ucComponentName[ HUB_COMMAND_MAX_NAME_LENGTH ];
+    uint8_t ucCommandName[ HUB_COMMAND_MAX_NAME_LENGTH ];
+    uint8_t ucPayload[ HUB_COMMAND_MAX_PAYLOAD_LENGTH ];
+    uint32_t ulResponseStatus;
+    uint32_t ulResponseLength;
+    uint8_t ucResponse[ HUB_COMMAND_MAX_RESPONSE_LENGTH ];
+    HubTraceRecord_t xTraceRecord; /**< @brief Times of the request, also without a tracer. */
+} HubCommandSlot_t;
+
+/**
+ * @brief Dispatcher counters.
+ */
+typedef struct HubCommandStats
+{
+    uint32_t ulReceived;       /**< @brief Requests given to #HubCommand_Dispatch. */
+    uint32_t ulRejected;       /**< @brief Requests answered at once, for lack of a slot or too large. */
+    uint32_t ulCompleted;      /**< @brief Responses sent for handled requests. */
+    uint32_t ulTimedOut;       /**< @brief Requests not run or not answered in time. */
+    uint32_t ulQueueDepth;     /**< @brief Requests queued or running. */
+    uint32_t ulMaxQueueDepth;  /**< @brief Largest #ulQueueDepth. */
+    uint32_t ulMaxWaitMs;      /**< @brief Largest time from arrival to handler start. */
+    uint32_t ulMaxExecutionMs; /**< @brief Largest handler execution time. */
+    uint64_t ullExecutionMs;   /**< @brief Sum of the handler execution times. */
+} HubCommandStats_t;
+
+/**
+ * @brief Command dispatcher for one hub client.
+ */
+typedef struct HubCommandPool
+{
+    AzureIoTHubClient_t * pxHubClient;
+    HubCommandHandler_t xHandler;
+    HubTrace_t * pxTrace;
+    uint32_t ulTimeoutMs;
+    HubCommandSlot_t xSlots[ HUB_COMMAND_MAX_PENDING ];
+
+    /* Slot indexes, to the workers then back with the response. */
+    QueueHandle_t xRequestQueue;
+    StaticQueue_t xRequestQueueBuffer;
+    uint8_t ucRequestQueueStorage[ HUB_COMMAND_MAX_PENDING * sizeof( uint32_t ) ];
+    QueueHandle_t xResponseQueue;
+    StaticQueue_t xResponseQueueBuffer;
+    uint8_t ucResponseQueueStorage[ HUB_COMMAND_MAX_PENDING * sizeof( uint32_t ) ];
+
+    HubCommandStats_t xStats;
+} HubCommandPool_t;
+
+/**
+ * @brief Initialize a dispatcher and start its workers.
+ *
+ * The dispatcher lives for the rest of the program, across reconnects of
+ * the hub client.
+ *
+ * @param[out] pxPool Dispatcher to initialize.
+ * @param[in] pxHubClient Hub client to respond with.
+ * @param[in] xHandler Handler of every command.
+ * @param[in] pxTrace Tracer the commands are added to, may be NULL.
+ * @param[in] ulTimeoutMs Time after arrival past which a request is not run
+ * or answered, the response timeout of the caller.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubCommand_Init( HubCommandPool_t * pxPool,
+                                  AzureIoTHubClient_t * pxHubClient,
+                                  HubCommandHandler_t xHandler,
+                                  HubTrace_t * pxTrace,
+                                  uint32_t ulTimeoutMs );
+
+/**
+ * @brief Queue a request for the workers, from the command callback.
+ *
+ * @param[in] pxPool Dispatcher.
+ * @param[in] pxMessage Request, copied.
+ * @return An #AzureIoTResult_t with the result of the operation,
+ * eAzureIoTErrorOutOfMemory if the request was answered at once.
+ */
+AzureIoTResult_t HubCommand_Dispatch( HubCommandPool_t * pxPool,
+                                      const AzureIoTHubClientCommandRequest_t * pxMessage );
+
+/**
+ * @brief Send the responses the workers queued.
+ *
+ * Call from the task running the process loop, after each process loop.
+ *
+ * @param[in] pxPool Dispatcher.
+ * @return An #AzureIoTResult_t with the result of the last failed send.
+ */
+AzureIoTResult_t HubCommand_Process( HubCommandPool_t * pxPool );
+
+/**
+ * @brief Read the counters of a dispatcher.
+ *
+ * @param[in] pxPool Dispatcher.
+ * @param[out] pxStats Counters.
+ */
+void HubCommand_GetStats( const HubCommandPool_t * pxPool,
+                          HubCommandStats_t * pxStats );
+
+#endif /* HUB_COMMAND_H */
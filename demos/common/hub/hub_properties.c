@@ -0,0 +1,84 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_properties.c
+ * @brief Message property bags encoded once and shared across sends.
+ */
+
+#include "hub_properties.h"
+
+/* Standard includes. */
+#include <string.h>
+
+/*-----------------------------------------------------------*/
+
+void HubProperties_TemplateInit( HubPropertyTemplate_t * pxTemplate,
+                                 uint8_t * pucBuffer,
+                                 uint32_t ulBufferSize )
+{
+    /* The encoded properties hold no NUL, the first one ends them. */
+    ( void ) memset( pucBuffer, 0, ulBufferSize );
+
+    pxTemplate->pucBuffer = pucBuffer;
+    pxTemplate->ulLength = 0;
+    pxTemplate->ulSize = ulBufferSize;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubProperties_TemplateAppend( HubPropertyTemplate_t * pxTemplate,
+                                               const uint8_t * pucName,
+                                               uint32_t ulNameLength,
+                                               const uint8_t * pucValue,
+                                               uint32_t ulValueLength )
+{
+    AzureIoTMessageProperties_t xProperties;
+    AzureIoTResult_t xResult;
+
+    if( pxTemplate->ulLength == pxTemplate->ulSize )
+    {
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    /* Encoded by the library, as it would for a bag of each message. */
+    if( ( ( xResult = AzureIoTMessage_PropertiesInit( &xProperties, pxTemplate->pucBuffer, pxTemplate->ulLength,
+                                                      pxTemplate->ulSize ) ) == eAzureIoTSuccess ) &&
+        ( ( xResult = AzureIoTMessage_PropertiesAppend( &xProperties, pucName, ulNameLength,
+                                                        pucValue, ulValueLength ) ) == eAzureIoTSuccess ) )
+    {
+        pxTemplate->ulLength = ( uint32_t ) strnlen( ( const char * ) pxTemplate->pucBuffer, pxTemplate->ulSize );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubProperties_Share( const HubPropertyTemplate_t * pxTemplate,
+                                      AzureIoTMessageProperties_t * pxProperties )
+{
+    if( pxTemplate->ulLength == 0 )
+    {
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    /* Full, so the library never writes to the template. */
+    return AzureIoTMessage_PropertiesInit( pxProperties, pxTemplate->pucBuffer,
+                                           pxTemplate->ulLength, pxTemplate->ulLength );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubProperties_Instantiate( const HubPropertyTemplate_t * pxTemplate,
+                                            AzureIoTMessageProperties_t * pxProperties,
+                                            uint8_t * pucBuffer,
+                                            uint32_t ulBufferSize )
+{
+    if( pxTemplate->ulLength > ulBufferSize )
+    {
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    ( void ) memcpy( pucBuffer, pxTemplate->pucBuffer, pxTemplate->ulLength );
+
+    return AzureIoTMessage_PropertiesInit( pxProperties, pucBuffer, pxTemplate->ulLength, ulBufferSize );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,102 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_properties.h
+ * @brief Message property bags encoded once and shared across sends.
+ *
+ * A template holds the encoded properties that are the same for every
+ * message, like a content type or a component name. It is either written at
+ * build time with #HUB_PROPERTY_TEMPLATE_LITERAL or built once at run time
+ * with #HubProperties_TemplateAppend, which encodes like
+ * AzureIoTMessage_PropertiesAppend.
+ *
+ * For each message, #HubProperties_Share makes a bag over the template
+ * itself, nothing is copied or encoded. When a message also carries
+ * properties of its own, like a message ID, #HubProperties_Instantiate copies
+ * the encoded template into a small buffer and appending continues after it.
+ *
+ * A template is never written once built, so tasks can share it.
+ */
+
+#ifndef HUB_PROPERTIES_H
+#define HUB_PROPERTIES_H
+
+#include <stdint.h>
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+/**
+ * @brief Template of encoded properties from a string literal, "name=value"
+ * pairs joined by '&' with names and values as sent.
+ */
+#define HUB_PROPERTY_TEMPLATE_LITERAL( pcEncoded )    { ( uint8_t * ) ( pcEncoded ), sizeof( pcEncoded ) - 1U, sizeof( pcEncoded ) - 1U }
+
+/**
+ * @brief Encoded properties.
+ */
+typedef struct HubPropertyTemplate
+{
+    uint8_t * pucBuffer; /**< @brief Encoded properties, only written while built. */
+    uint32_t ulLength;   /**< @brief Length of the encoded properties. */
+    uint32_t ulSize;     /**< @brief Size of @p pucBuffer, equal to ulLength for literals. */
+} HubPropertyTemplate_t;
+
+/**
+ * @brief Start building a template at run time.
+ *
+ * @param[out] pxTemplate Template to build.
+ * @param[in] pucBuffer Buffer of the encoded properties, kept for the life of
+ * the template.
+ * @param[in] ulBufferSize Size of @p pucBuffer.
+ */
+void HubProperties_TemplateInit( HubPropertyTemplate_t * pxTemplate,
+                                 uint8_t * pucBuffer,
+                                 uint32_t ulBufferSize );
+
+/**
+ * @brief Encode a property into a template being built.
+ *
+ * @param[in] pxTemplate Template started by #HubProperties_TemplateInit.
+ * @param[in] pucName Property name.
+ * @param[in] ulNameLength Length of @p pucName.
+ * @param[in] pucValue Property value.
+ * @param[in] ulValueLength Length of @p pucValue.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubProperties_TemplateAppend( HubPropertyTemplate_t * pxTemplate,
+                                               const uint8_t * pucName,
+                                               uint32_t ulNameLength,
+                                               const uint8_t * pucValue,
+                                               uint32_t ulValueLength );
+
+/**
+ * @brief Make a bag of the properties of a template, without a copy.
+ *
+ * Nothing can be appended to the bag.
+ *
+ * @param[in] pxTemplate Template, not empty.
+ * @param[out] pxProperties Bag to send with a message.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubProperties_Share( const HubPropertyTemplate_t * pxTemplate,
+                                      AzureIoTMessageProperties_t * pxProperties );
+
+/**
+ * @brief Make a bag starting with the properties of a template, to append
+ * the properties of one message to.
+ *
+ * @param[in] pxTemplate Template.
+ * @param[out] pxProperties Bag to append to and send with a message.
+ * @param[in] pucBuffer Buffer of the bag, for the template and the appended
+ * properties.
+ * @param[in] ulBufferSize Size of @p pucBuffer.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubProperties_Instantiate( const HubPropertyTemplate_t * pxTemplate,
+                                            AzureIoTMessageProperties_t * pxProperties,
+                                            uint8_t * pucBuffer,
+                                            uint32_t ulBufferSize );
+
+#endif /* HUB_PROPERTIES_H */
@@ -0,0 +1,569 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_publish.c
+ * @brief QoS1 telemetry publishing with a window of unacknowledged messages.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Logging configuration for the hub publish pipeline. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "HubPublish"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "hub_publish.h"
+
+/* The resend goes through the MQTT client of the hub client. */
+#include "azure_iot_mqtt.h"
+
+/*-----------------------------------------------------------*/
+
+static HubPublishSlot_t * prvFindSlot( HubPublishPipeline_t * pxPipeline,
+                                       uint16_t usPacketID )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < pxPipeline->ulWindowSize; ulIndex++ )
+    {
+        if( pxPipeline->xSlots[ ulIndex ].xInUse &&
+            ( pxPipeline->xSlots[ ulIndex ].usPacketID == usPacketID ) )
+        {
+            return &pxPipeline->xSlots[ ulIndex ];
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static HubPublishSlot_t * prvFreeSlot( HubPublishPipeline_t * pxPipeline )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < pxPipeline->ulWindowSize; ulIndex++ )
+    {
+        if( !pxPipeline->xSlots[ ulIndex ].xInUse )
+        {
+            return &pxPipeline->xSlots[ ulIndex ];
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvComplete( HubPublishPipeline_t * pxPipeline,
+                         HubPublishSlot_t * pxSlot,
+                         AzureIoTResult_t xResult )
+{
+    uint32_t ulLatencyMs = ( uint32_t ) ( ( xTaskGetTickCount() - pxSlot->xSentTicks ) * portTICK_PERIOD_MS );
+    HubPublishCompleteCallback_t xCallback = pxSlot->xCallback;
+    void * pvContext = pxSlot->pvContext;
+    uint16_t usPacketID = pxSlot->usPacketID;
+
+    /* Free the slot before the callback so it can send again. */
+    pxSlot->xInUse = false;
+    pxPipeline->ulInFlight--;
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        pxPipeline->xStats.ulAcked++;
+
+        if( ulLatencyMs > pxPipeline->xStats.ulMaxAckLatencyMs )
+        {
+            pxPipeline->xStats.ulMaxAckLatencyMs = ulLatencyMs;
+        }
+    }
+    else
+    {
+        pxPipeline->xStats.ulAborted++;
+    }
+
+    if( xCallback != NULL )
+    {
+        xCallback( usPacketID, ulLatencyMs, xResult, pvContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvWaitInFlightBelow( HubPublishPipeline_t * pxPipeline,
+                                              uint32_t ulLimit,
+                                              uint32_t ulTimeoutMs )
+{
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xTimeout = pdMS_TO_TICKS( ulTimeoutMs );
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+
+    while( pxPipeline->ulInFlight > ulLimit )
+    {
+        if( ( xTaskGetTickCount() - xStart ) >= xTimeout )
+        {
+            return eAzureIoTErrorFailed;
+        }
+
+        if( ( xResult = AzureIoTHubClient_ProcessLoop( pxPipeline->pxHubClient, HUB_PUBLISH_WAIT_INTERVAL_MS ) ) != eAzureIoTSuccess )
+        {
+            return xResult;
+        }
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubPublish_Init( HubPublishPipeline_t * pxPipeline,
+                                  AzureIoTHubClient_t * pxHubClient,
+                                  uint32_t ulWindowSize )
+{
+    if( ( pxPipeline == NULL ) || ( pxHubClient == NULL ) ||
+        ( ulWindowSize == 0 ) || ( ulWindowSize > HUB_PUBLISH_WINDOW_MAX ) )
+    {
+        LogError( ( "HubPublish_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxPipeline, 0, sizeof( HubPublishPipeline_t ) );
+    pxPipeline->pxHubClient = pxHubClient;
+    pxPipeline->ulWindowSize = ulWindowSize;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+void HubPublish_Deinit( HubPublishPipeline_t * pxPipeline )
+{
+    HubPublish_Abort( pxPipeline );
+}
+/*-----------------------------------------------------------*/
+
+void HubPublish_HandleAck( HubPublishPipeline_t * pxPipeline,
+                           uint16_t usPacketID )
+{
+    HubPublishSlot_t * pxSlot;
+
+    if( pxPipeline == NULL )
+    {
+        LogError( ( "HubPublish_HandleAck failed: invalid argument" ) );
+        return;
+    }
+
+    pxSlot = prvFindSlot( pxPipeline, usPacketID );
+
+    if( pxSlot == NULL )
+    {
+        LogWarn( ( "PUBACK for unknown packet id %u", usPacketID ) );
+    }
+    else
+    {
+        prvComplete( pxPipeline, pxSlot, eAzureIoTSuccess );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait, running the process loop, until the window has room.
+ */
+static AzureIoTResult_t prvReserveSlot( HubPublishPipeline_t * pxPipeline,
+                                        uint32_t ulWindowTimeoutMs )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxPipeline->ulInFlight >= pxPipeline->ulWindowSize )
+    {
+        pxPipeline->xStats.ulWindowFullWaits++;
+
+        if( ( xResult = prvWaitInFlightBelow( pxPipeline, pxPipeline->ulWindowSize - 1,
+                                              ulWindowTimeoutMs ) ) != eAzureIoTSuccess )
+        {
+            LogError( ( "Publish window still full after %u ms", ( unsigned ) ulWindowTimeoutMs ) );
+            return xResult;
+        }
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Keep what a slot needs to send its publish again.
+ *
+ * The telemetry topic, with the encoded properties, is built into the slot
+ * while the properties are certain to be those sent, then the payload is
+ * copied after it, unless a generator writes it.
+ */
+static void prvKeepForResend( HubPublishPipeline_t * pxPipeline,
+                              HubPublishSlot_t * pxSlot,
+                              const uint8_t * pucTelemetryData,
+                              uint32_t ulTelemetryDataLength,
+                              const AzureIoTMessageProperties_t * pxProperties,
+                              StreamingTransport_t * pxStreaming,
+                              StreamingGenerator_t xGenerator,
+                              void * pvGeneratorContext )
+{
+    size_t xTopicLength = 0;
+
+    pxSlot->pxStreaming = pxStreaming;
+    pxSlot->xGenerator = xGenerator;
+    pxSlot->pvGeneratorContext = pvGeneratorContext;
+    pxSlot->ulPayloadLength = ulTelemetryDataLength;
+    pxSlot->xResendable = false;
+
+    /* The middleware has no accessor for the encoded properties, so the
+     * embedded SDK bag inside is passed on. */
+    if( az_result_failed( az_iot_hub_client_telemetry_get_publish_topic( &pxPipeline->pxHubClient->_internal.xAzureIoTHubClientCore,
+                                                                         ( pxProperties != NULL ) ?
+                                                                         &pxProperties->_internal.xProperties : NULL,
+                                                                         ( char * ) pxSlot->ucResend,
+                                                                         sizeof( pxSlot->ucResend ),
+                                                                         &xTopicLength ) ) )
+    {
+        LogWarn( ( "Topic of packet id %u too large to resend after a reconnect", pxSlot->usPacketID ) );
+        return;
+    }
+
+    pxSlot->usTopicLength = ( uint16_t ) xTopicLength;
+
+    /* A streamed payload is written again by its generator. */
+    if( xGenerator != NULL )
+    {
+        ulTelemetryDataLength = 0;
+    }
+
+    if( ulTelemetryDataLength > ( sizeof( pxSlot->ucResend ) - xTopicLength ) )
+    {
+        LogWarn( ( "Publish of %u bytes too large to resend after a reconnect",
+                   ( unsigned ) ( xTopicLength + ulTelemetryDataLength ) ) );
+        return;
+    }
+
+    if( ulTelemetryDataLength > 0 )
+    {
+        memcpy( &pxSlot->ucResend[ xTopicLength ], pucTelemetryData, ulTelemetryDataLength );
+    }
+
+    pxSlot->xResendable = true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send telemetry in the slot reserved by #prvReserveSlot.
+ */
+static AzureIoTResult_t prvSend( HubPublishPipeline_t * pxPipeline,
+                                 const uint8_t * pucTelemetryData,
+                                 uint32_t ulTelemetryDataLength,
+                                 AzureIoTMessageProperties_t * pxProperties,
+                                 StreamingTransport_t * pxStreaming,
+                                 StreamingGenerator_t xGenerator,
+                                 void * pvGeneratorContext,
+                                 HubPublishCompleteCallback_t xCallback,
+                                 void * pvContext,
+                                 uint16_t * pusPacketID )
+{
+    HubPublishSlot_t * pxSlot;
+    AzureIoTResult_t xResult;
+    uint16_t usPacketID = 0;
+
+    pxSlot = prvFreeSlot( pxPipeline );
+    configASSERT( pxSlot != NULL );
+
+    xResult = AzureIoTHubClient_SendTelemetry( pxPipeline->pxHubClient,
+                                               pucTelemetryData, ulTelemetryDataLength,
+                                               pxProperties, eAzureIoTHubMessageQoS1, &usPacketID );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        LogError( ( "Failed to send telemetry: result 0x%08x", xResult ) );
+        return xResult;
+    }
+
+    pxSlot->xInUse = true;
+    pxSlot->usPacketID = usPacketID;
+    pxSlot->xSentTicks = xTaskGetTickCount();
+    pxSlot->xCallback = xCallback;
+    pxSlot->pvContext = pvContext;
+    prvKeepForResend( pxPipeline, pxSlot, pucTelemetryData, ulTelemetryDataLength, pxProperties,
+                      pxStreaming, xGenerator, pvGeneratorContext );
+
+    pxPipeline->ulInFlight++;
+    pxPipeline->xStats.ulSent++;
+
+    if( pxPipeline->ulInFlight > pxPipeline->xStats.ulMaxInFlight )
+    {
+        pxPipeline->xStats.ulMaxInFlight = pxPipeline->ulInFlight;
+    }
+
+    if( pusPacketID != NULL )
+    {
+        *pusPacketID = usPacketID;
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubPublish_SendTelemetry( HubPublishPipeline_t * pxPipeline,
+                                           const uint8_t * pucTelemetryData,
+                                           uint32_t ulTelemetryDataLength,
+                                           AzureIoTMessageProperties_t * pxProperties,
+                                           HubPublishCompleteCallback_t xCallback,
+                                           void * pvContext,
+                                           uint32_t ulWindowTimeoutMs,
+                                           uint16_t * pusPacketID )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxPipeline == NULL )
+    {
+        LogError( ( "HubPublish_SendTelemetry failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( ( xResult = prvReserveSlot( pxPipeline, ulWindowTimeoutMs ) ) != eAzureIoTSuccess )
+    {
+        return xResult;
+    }
+
+    return prvSend( pxPipeline, pucTelemetryData, ulTelemetryDataLength, pxProperties,
+                    NULL, NULL, NULL, xCallback, pvContext, pusPacketID );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubPublish_SendTelemetryStream( HubPublishPipeline_t * pxPipeline,
+                                                 StreamingTransport_t * pxStreaming,
+                                                 StreamingGenerator_t xGenerator,
+                                                 void * pvGeneratorContext,
+                                                 uint32_t ulTelemetryDataLength,
+                                                 AzureIoTMessageProperties_t * pxProperties,
+                                                 HubPublishCompleteCallback_t xCallback,
+                                                 void * pvContext,
+                                                 uint32_t ulWindowTimeoutMs,
+                                                 uint16_t * pusPacketID )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pxPipeline == NULL ) || ( pxStreaming == NULL ) || ( xGenerator == NULL ) )
+    {
+        LogError( ( "HubPublish_SendTelemetryStream failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    /* Wait for the window first, so no callback of the process loop can
+     * change what the generator writes between the sizing pass and the send. */
+    if( ( xResult = prvReserveSlot( pxPipeline, ulWindowTimeoutMs ) ) != eAzureIoTSuccess )
+    {
+        return xResult;
+    }
+
+    if( ( ulTelemetryDataLength == 0 ) &&
+        !Streaming_Measure( pxStreaming, xGenerator, pvGeneratorContext, &ulTelemetryDataLength ) )
+    {
+        return eAzureIoTErrorFailed;
+    }
+
+    if( ulTelemetryDataLength == 0 )
+    {
+        return prvSend( pxPipeline, NULL, 0, pxProperties,
+                        NULL, NULL, NULL, xCallback, pvContext, pusPacketID );
+    }
+
+    xResult = prvSend( pxPipeline,
+                       Streaming_Arm( pxStreaming, xGenerator, pvGeneratorContext, ulTelemetryDataLength ),
+                       ulTelemetryDataLength, pxProperties,
+                       pxStreaming, xGenerator, pvGeneratorContext,
+                       xCallback, pvContext, pusPacketID );
+
+    /* A payload sent in part fails the send and breaks the stream, so the
+     * connection fails as well. */
+    Streaming_Disarm( pxStreaming );
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubPublish_ProcessLoop( HubPublishPipeline_t * pxPipeline,
+                                         uint32_t ulTimeoutMs )
+{
+    if( pxPipeline == NULL )
+    {
+        LogError( ( "HubPublish_ProcessLoop failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    return AzureIoTHubClient_ProcessLoop( pxPipeline->pxHubClient, ulTimeoutMs );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubPublish_Flush( HubPublishPipeline_t * pxPipeline,
+                                   uint32_t ulTimeoutMs )
+{
+    if( pxPipeline == NULL )
+    {
+        LogError( ( "HubPublish_Flush failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    return prvWaitInFlightBelow( pxPipeline, 0, ulTimeoutMs );
+}
+/*-----------------------------------------------------------*/
+
+void HubPublish_Abort( HubPublishPipeline_t * pxPipeline )
+{
+    uint32_t ulIndex;
+
+    if( pxPipeline == NULL )
+    {
+        return;
+    }
+
+    for( ulIndex = 0; ulIndex < pxPipeline->ulWindowSize; ulIndex++ )
+    {
+        if( pxPipeline->xSlots[ ulIndex ].xInUse )
+        {
+            prvComplete( pxPipeline, &pxPipeline->xSlots[ ulIndex ], eAzureIoTErrorFailed );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the publish of a slot again, with its packet ID and the DUP flag.
+ *
+ * AzureIoTHubClient_SendTelemetry() always takes a new packet ID, so this
+ * publishes the topic kept by the slot through the MQTT client inside the
+ * hub client, as the middleware does.
+ */
+static AzureIoTResult_t prvResend( HubPublishPipeline_t * pxPipeline,
+                                   HubPublishSlot_t * pxSlot )
+{
+    AzureIoTMQTTPublishInfo_t xPublishInfo;
+    AzureIoTMQTTResult_t xMQTTResult;
+    uint32_t ulPayloadLength = pxSlot->ulPayloadLength;
+
+    memset( &xPublishInfo, 0, sizeof( xPublishInfo ) );
+    xPublishInfo.xQOS = eAzureIoTMQTTQoS1;
+    xPublishInfo.xDup = true;
+    xPublishInfo.pcTopicName = pxSlot->ucResend;
+    xPublishInfo.usTopicNameLength = pxSlot->usTopicLength;
+    xPublishInfo.xPayloadLength = ulPayloadLength;
+
+    if( pxSlot->xGenerator != NULL )
+    {
+        /* A DUP carries the message of the first send, so the generator must
+         * write the same payload again. Its length is the check. */
+        if( !Streaming_Measure( pxSlot->pxStreaming, pxSlot->xGenerator,
+                                pxSlot->pvGeneratorContext, &ulPayloadLength ) )
+        {
+            return eAzureIoTErrorFailed;
+        }
+
+        configASSERT( ulPayloadLength == pxSlot->ulPayloadLength );
+
+        if( ulPayloadLength != pxSlot->ulPayloadLength )
+        {
+            LogError( ( "Generator of packet id %u wrote %u bytes, not the %u first sent",
+                        pxSlot->usPacketID, ( unsigned ) ulPayloadLength,
+                        ( unsigned ) pxSlot->ulPayloadLength ) );
+            return eAzureIoTErrorFailed;
+        }
+
+        if( ulPayloadLength > 0 )
+        {
+            xPublishInfo.pvPayload = Streaming_Arm( pxSlot->pxStreaming, pxSlot->xGenerator,
+                                                    pxSlot->pvGeneratorContext, ulPayloadLength );
+        }
+    }
+    else if( ulPayloadLength > 0 )
+    {
+        xPublishInfo.pvPayload = &pxSlot->ucResend[ pxSlot->usTopicLength ];
+    }
+
+    /* coreMQTT still has the state of the packet ID from the first send and
+     * accepts the duplicate. */
+    xMQTTResult = AzureIoTMQTT_Publish( &pxPipeline->pxHubClient->_internal.xMQTTContext,
+                                        &xPublishInfo, pxSlot->usPacketID );
+
+    if( pxSlot->xGenerator != NULL )
+    {
+        Streaming_Disarm( pxSlot->pxStreaming );
+    }
+
+    if( xMQTTResult != eAzureIoTMQTTSuccess )
+    {
+        LogError( ( "Failed to resend packet id %u: MQTT error 0x%08x", pxSlot->usPacketID, xMQTTResult ) );
+        return eAzureIoTErrorPublishFailed;
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubPublish_Resume( HubPublishPipeline_t * pxPipeline,
+                                    bool xSessionPresent )
+{
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+    AzureIoTResult_t xResendResult;
+    HubPublishSlot_t * pxSlot;
+    uint32_t ulIndex;
+
+    if( pxPipeline == NULL )
+    {
+        LogError( ( "HubPublish_Resume failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( !xSessionPresent )
+    {
+        if( pxPipeline->ulInFlight > 0 )
+        {
+            LogWarn( ( "Session not kept, %u publishes lost", ( unsigned ) pxPipeline->ulInFlight ) );
+        }
+
+        HubPublish_Abort( pxPipeline );
+
+        return eAzureIoTSuccess;
+    }
+
+    for( ulIndex = 0; ulIndex < pxPipeline->ulWindowSize; ulIndex++ )
+    {
+        pxSlot = &pxPipeline->xSlots[ ulIndex ];
+
+        if( !pxSlot->xInUse )
+        {
+            continue;
+        }
+
+        if( !pxSlot->xResendable )
+        {
+            LogWarn( ( "Packet id %u too large to resend", pxSlot->usPacketID ) );
+            prvComplete( pxPipeline, pxSlot, eAzureIoTErrorFailed );
+        }
+        else if( ( xResendResult = prvResend( pxPipeline, pxSlot ) ) != eAzureIoTSuccess )
+        {
+            prvComplete( pxPipeline, pxSlot, xResendResult );
+            xResult = xResendResult;
+        }
+        else
+        {
+            pxPipeline->xStats.ulResent++;
+        }
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t HubPublish_InFlight( const HubPublishPipeline_t * pxPipeline )
+{
+    return ( pxPipeline == NULL ) ? 0 : pxPipeline->ulInFlight;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,281 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_publish.h
+ * @brief QoS1 telemetry publishing with a window of unacknowledged messages.
+ *
+ * Instead of waiting for each PUBACK before sending the next message, up to
+ * the configured window of QoS1 publishes may be outstanding. Completion is
+ * reported per message through a callback once its PUBACK is processed. When
+ * the window is full, sending runs the process loop until a slot frees up.
+ *
+ * The telemetry acknowledgement callback of the hub client carries only the
+ * packet ID, so the application hands each PUBACK of a hub client to the
+ * pipeline of that client with #HubPublish_HandleAck, from the
+ * xTelemetryCallback set in the #AzureIoTHubClientOptions_t of the client.
+ *
+ * #HubPublish_SendTelemetryStream sends a payload written by a generator
+ * while it goes out, through the decorator of transport_streaming.h, so its
+ * size is not limited by a buffer.
+ *
+ * A slot keeps its publish until the PUBACK, the telemetry topic with the
+ * encoded properties, and a copy of the payload or the generator of a
+ * streamed payload, so #HubPublish_Resume can
+ * send it again after a reconnect which kept the session.
+ */
+
+#ifndef HUB_PUBLISH_H
+#define HUB_PUBLISH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+#include "transport_streaming.h"
+
+/**
+ * @brief Largest supported window of unacknowledged publishes.
+ *
+ * @note Each outstanding publish takes an entry in the coreMQTT state array,
+ * so keep this below MQTT_STATE_ARRAY_MAX_COUNT to leave room for incoming
+ * QoS1 messages.
+ */
+#ifndef HUB_PUBLISH_WINDOW_MAX
+    #define HUB_PUBLISH_WINDOW_MAX        ( 8U )
+#endif
+
+/**
+ * @brief Process loop timeout while waiting for room in the window.
+ */
+#ifndef HUB_PUBLISH_WAIT_INTERVAL_MS
+    #define HUB_PUBLISH_WAIT_INTERVAL_MS  ( 10U )
+#endif
+
+/**
+ * @brief Longest topic and payload, together, kept by a slot to resend.
+ *
+ * The topic holds the device ID and the encoded properties. A publish which
+ * does not fit cannot be sent again after a reconnect, see
+ * #HubPublish_Resume.
+ */
+#ifndef HUB_PUBLISH_MAX_RESEND_LENGTH
+    #define HUB_PUBLISH_MAX_RESEND_LENGTH ( 384U )
+#endif
+
+/**
+ * @brief Called once per publish when it completes.
+ *
+ * @param[in] usPacketID Packet ID of the publish.
+ * @param[in] ulLatencyMs Time from send to PUBACK.
+ * @param[in] xResult eAzureIoTSuccess when acknowledged, else the publish was
+ * abandoned by #HubPublish_Abort or #HubPublish_Resume.
+ * @param[in] pvContext Context given when sending.
+ */
+typedef void ( * HubPublishCompleteCallback_t )( uint16_t usPacketID,
+                                                 uint32_t ulLatencyMs,
+                                                 AzureIoTResult_t xResult,
+                                                 void * pvContext );
+
+/**
+ * @brief One outstanding publish.
+ */
+typedef struct HubPublishSlot
+{
+    bool xInUse;
+    uint16_t usPacketID;
+    TickType_t xSentTicks;
+    HubPublishCompleteCallback_t xCallback;
+    void * pvContext;
+
+    /* What to send again, a streamed payload or a copy. */
+    bool xResendable;
+    StreamingTransport_t * pxStreaming;
+    StreamingGenerator_t xGenerator;
+    void * pvGeneratorContext;
+    uint16_t usTopicLength;
+    uint32_t ulPayloadLength;
+    uint8_t ucResend[ HUB_PUBLISH_MAX_RESEND_LENGTH ]; /**< @brief Topic then payload. */
+} HubPublishSlot_t;
+
+/**
+ * @brief Publish counters.
+ */
+typedef struct HubPublishStats
+{
+    uint32_t ulSent;              /**< @brief Publishes handed to the hub client. */
+    uint32_t ulAcked;             /**< @brief Publishes acknowledged by IoT Hub. */
+    uint32_t ulAborted;           /**< @brief Publishes abandoned without PUBACK. */
+    uint32_t ulResent;            /**< @brief Publishes sent again after a reconnect. */
+    uint32_t ulWindowFullWaits;   /**< @brief Sends which had to wait for room in the window. */
+    uint32_t ulMaxInFlight;       /**< @brief Most publishes outstanding at once. */
+    uint32_t ulMaxAckLatencyMs;   /**< @brief Largest send to PUBACK latency. */
+} HubPublishStats_t;
+
+/**
+ * @brief Publish pipeline for one hub client.
+ */
+typedef struct HubPublishPipeline
+{
+    AzureIoTHubClient_t * pxHubClient;
+    uint32_t ulWindowSize;
+    uint32_t ulInFlight;
+    HubPublishSlot_t xSlots[ HUB_PUBLISH_WINDOW_MAX ];
+    HubPublishStats_t xStats;
+} HubPublishPipeline_t;
+
+/**
+ * @brief Initialize a pipeline.
+ *
+ * @param[out] pxPipeline Pipeline to initialize.
+ * @param[in] pxHubClient Hub client to send with.
+ * @param[in] ulWindowSize Maximum outstanding publishes, 1 to #HUB_PUBLISH_WINDOW_MAX.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubPublish_Init( HubPublishPipeline_t * pxPipeline,
+                                  AzureIoTHubClient_t * pxHubClient,
+                                  uint32_t ulWindowSize );
+
+/**
+ * @brief Deinitialize a pipeline, abandoning outstanding publishes.
+ *
+ * @param[in] pxPipeline Pipeline to deinitialize.
+ */
+void HubPublish_Deinit( HubPublishPipeline_t * pxPipeline );
+
+/**
+ * @brief Complete the publish acknowledged by a PUBACK.
+ *
+ * Call from the xTelemetryCallback of the hub client of @p pxPipeline, which
+ * runs inside its process loop.
+ *
+ * @param[in] pxPipeline Pipeline of the hub client which got the PUBACK.
+ * @param[in] usPacketID Packet ID of the acknowledged publish.
+ */
+void HubPublish_HandleAck( HubPublishPipeline_t * pxPipeline,
+                           uint16_t usPacketID );
+
+/**
+ * @brief Send telemetry at QoS1 without waiting for its PUBACK.
+ *
+ * Blocks, running the process loop, only while the window is full.
+ *
+ * @param[in] pxPipeline Pipeline to send with.
+ * @param[in] pucTelemetryData Payload.
+ * @param[in] ulTelemetryDataLength Payload length.
+ * @param[in] pxProperties Message properties, may be NULL.
+ * @param[in] xCallback Completion callback, may be NULL.
+ * @param[in] pvContext Context for @p xCallback.
+ * @param[in] ulWindowTimeoutMs Time to wait for room in the window.
+ * @param[out] pusPacketID Packet ID of the publish, may be NULL.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubPublish_SendTelemetry( HubPublishPipeline_t * pxPipeline,
+                                           const uint8_t * pucTelemetryData,
+                                           uint32_t ulTelemetryDataLength,
+                                           AzureIoTMessageProperties_t * pxProperties,
+                                           HubPublishCompleteCallback_t xCallback,
+                                           void * pvContext,
+                                           uint32_t ulWindowTimeoutMs,
+                                           uint16_t * pusPacketID );
+
+/**
+ * @brief Send telemetry at QoS1 with a payload written by a generator as it
+ * is sent.
+ *
+ * Blocks, running the process loop, only while the window is full, before
+ * the generator runs. When @p ulTelemetryDataLength is 0, a first run of the
+ * generator measures the payload.
+ *
+ * The generator and its context must stay valid until the publish completes,
+ * #HubPublish_Resume runs them again to resend the payload. Until then, each
+ * run must write the same bytes, as a resend with the DUP flag is the same
+ * message; a resend whose length differs fails.
+ *
+ * @param[in] pxPipeline Pipeline to send with.
+ * @param[in] pxStreaming Streaming decorator of the transport of the hub
+ * client.
+ * @param[in] xGenerator Generator of the payload.
+ * @param[in] pvGeneratorContext Context of @p xGenerator.
+ * @param[in] ulTelemetryDataLength Payload length, 0 to measure it.
+ * @param[in] pxProperties Message properties, may be NULL.
+ * @param[in] xCallback Completion callback, may be NULL.
+ * @param[in] pvContext Context for @p xCallback.
+ * @param[in] ulWindowTimeoutMs Time to wait for room in the window.
+ * @param[out] pusPacketID Packet ID of the publish, may be NULL.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubPublish_SendTelemetryStream( HubPublishPipeline_t * pxPipeline,
+                                                 StreamingTransport_t * pxStreaming,
+                                                 StreamingGenerator_t xGenerator,
+                                                 void * pvGeneratorContext,
+                                                 uint32_t ulTelemetryDataLength,
+                                                 AzureIoTMessageProperties_t * pxProperties,
+                                                 HubPublishCompleteCallback_t xCallback,
+                                                 void * pvContext,
+                                                 uint32_t ulWindowTimeoutMs,
+                                                 uint16_t * pusPacketID );
+
+/**
+ * @brief Run the hub client process loop for this pipeline.
+ *
+ * @param[in] pxPipeline Pipeline to process.
+ * @param[in] ulTimeoutMs Process loop timeout.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubPublish_ProcessLoop( HubPublishPipeline_t * pxPipeline,
+                                         uint32_t ulTimeoutMs );
+
+/**
+ * @brief Wait until every outstanding publish is acknowledged.
+ *
+ * @param[in] pxPipeline Pipeline to flush.
+ * @param[in] ulTimeoutMs Time to wait.
+ * @return eAzureIoTSuccess if the window drained in time.
+ */
+AzureIoTResult_t HubPublish_Flush( HubPublishPipeline_t * pxPipeline,
+                                   uint32_t ulTimeoutMs );
+
+/**
+ * @brief Complete every outstanding publish as failed.
+ *
+ * Call when the publishes still in flight will not be sent again, the
+ * session being ended or lost.
+ *
+ * @param[in] pxPipeline Pipeline to abort.
+ */
+void HubPublish_Abort( HubPublishPipeline_t * pxPipeline );
+
+/**
+ * @brief Continue the outstanding publishes after a reconnect.
+ *
+ * When IoT Hub kept the session, it and coreMQTT still wait for the PUBACK of
+ * each outstanding publish, so they are sent again with their packet ID and
+ * the DUP flag, as MQTT 3.1.1 requires, and complete on their PUBACK. A
+ * publish too large to keep is completed as failed. When the session was not
+ * kept, every outstanding publish is completed as failed, as by
+ * #HubPublish_Abort.
+ *
+ * Call after each connect, before sending anything else.
+ *
+ * @param[in] pxPipeline Pipeline to resume.
+ * @param[in] xSessionPresent Session present flag of the CONNACK.
+ * @return An #AzureIoTResult_t with the result of the last failed resend.
+ */
+AzureIoTResult_t HubPublish_Resume( HubPublishPipeline_t * pxPipeline,
+                                    bool xSessionPresent );
+
+/**
+ * @brief Number of outstanding publishes.
+ *
+ * @param[in] pxPipeline Pipeline to query.
+ * @return Outstanding publishes.
+ */
+uint32_t HubPublish_InFlight( const HubPublishPipeline_t * pxPipeline );
+
+#endif /* HUB_PUBLISH_H */
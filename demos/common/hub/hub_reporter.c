@@ -0,0 +1,944 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_reporter.c
+ * @brief Coalescing of reported property updates into single twin patches.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Logging configuration for the hub reporter. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "HubReporter"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "hub_reporter.h"
+
+/*-----------------------------------------------------------*/
+
+#define hubreporterCOMPONENT_MARKER_NAME     "__t"
+#define hubreporterCOMPONENT_MARKER_VALUE    "\"c\""
+#define hubreporterACK_VERSION_NAME          "av"
+
+/**
+ * @brief Result of reading the next member of a JSON object.
+ */
+typedef enum HubReporterMember
+{
+    eHubReporterMemberFound = 0,
+    eHubReporterMemberEnd,
+    eHubReporterMemberError
+} HubReporterMember_t;
+
+/**
+ * @brief Span of one "name":value member, name without the quotes.
+ */
+typedef struct HubReporterSpan
+{
+    const uint8_t * pucName;
+    uint32_t ulNameLength;
+    const uint8_t * pucValue;
+    uint32_t ulValueLength;
+} HubReporterSpan_t;
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSkipSpace( const uint8_t * pucJSON,
+                              uint32_t ulLength,
+                              uint32_t ulIndex )
+{
+    while( ( ulIndex < ulLength ) &&
+           ( ( pucJSON[ ulIndex ] == ' ' ) || ( pucJSON[ ulIndex ] == '\t' ) ||
+             ( pucJSON[ ulIndex ] == '\r' ) || ( pucJSON[ ulIndex ] == '\n' ) ) )
+    {
+        ulIndex++;
+    }
+
+    return ulIndex;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the end of the string starting at @p ulIndex, past the closing quote.
+ */
+static bool prvScanString( const uint8_t * pucJSON,
+                           uint32_t ulLength,
+                           uint32_t ulIndex,
+                           uint32_t * pulEnd )
+{
+    if( ( ulIndex >= ulLength ) || ( pucJSON[ ulIndex ] != '"' ) )
+    {
+        return false;
+    }
+
+    for( ulIndex++; ulIndex < ulLength; ulIndex++ )
+    {
+        if( pucJSON[ ulIndex ] == '\\' )
+        {
+            ulIndex++;
+        }
+        else if( pucJSON[ ulIndex ] == '"' )
+        {
+            *pulEnd = ulIndex + 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the end of the value starting at @p ulIndex.
+ */
+static bool prvScanValue( const uint8_t * pucJSON,
+                          uint32_t ulLength,
+                          uint32_t ulIndex,
+                          uint32_t * pulEnd )
+{
+    uint32_t ulDepth = 0;
+
+    if( ulIndex >= ulLength )
+    {
+        return false;
+    }
+
+    if( pucJSON[ ulIndex ] == '"' )
+    {
+        return prvScanString( pucJSON, ulLength, ulIndex, pulEnd );
+    }
+
+    if( ( pucJSON[ ulIndex ] != '{' ) && ( pucJSON[ ulIndex ] != '[' ) )
+    {
+        /* Number or literal, up to the next delimiter. */
+        while( ( ulIndex < ulLength ) && ( pucJSON[ ulIndex ] != ',' ) &&
+               ( pucJSON[ ulIndex ] != '}' ) && ( pucJSON[ ulIndex ] != ']' ) &&
+               ( pucJSON[ ulIndex ] != ' ' ) && ( pucJSON[ ulIndex ] != '\t' ) &&
+               ( pucJSON[ ulIndex ] != '\r' ) && ( pucJSON[ ulIndex ] != '\n' ) )
+        {
+            ulIndex++;
+        }
+
+        *pulEnd = ulIndex;
+        return true;
+    }
+
+    while( ulIndex < ulLength )
+    {
+        if( pucJSON[ ulIndex ] == '"' )
+        {
+            if( !prvScanString( pucJSON, ulLength, ulIndex, &ulIndex ) )
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        if( ( pucJSON[ ulIndex ] == '{' ) || ( pucJSON[ ulIndex ] == '[' ) )
+        {
+            ulDepth++;
+        }
+        else if( ( pucJSON[ ulIndex ] == '}' ) || ( pucJSON[ ulIndex ] == ']' ) )
+        {
+            if( --ulDepth == 0 )
+            {
+                *pulEnd = ulIndex + 1;
+                return true;
+            }
+        }
+
+        ulIndex++;
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the next member of an object, @p pulIndex starts just past the '{'.
+ */
+static HubReporterMember_t prvNextMember( const uint8_t * pucJSON,
+                                          uint32_t ulLength,
+                                          uint32_t * pulIndex,
+                                          HubReporterSpan_t * pxSpan )
+{
+    uint32_t ulIndex = prvSkipSpace( pucJSON, ulLength, *pulIndex );
+    uint32_t ulEnd;
+
+    if( ( ulIndex < ulLength ) && ( pucJSON[ ulIndex ] == ',' ) )
+    {
+        ulIndex = prvSkipSpace( pucJSON, ulLength, ulIndex + 1 );
+    }
+
+    if( ulIndex >= ulLength )
+    {
+        return eHubReporterMemberError;
+    }
+
+    if( pucJSON[ ulIndex ] == '}' )
+    {
+        *pulIndex = ulIndex + 1;
+        return eHubReporterMemberEnd;
+    }
+
+    if( !prvScanString( pucJSON, ulLength, ulIndex, &ulEnd ) )
+    {
+        return eHubReporterMemberError;
+    }
+
+    pxSpan->pucName = &pucJSON[ ulIndex + 1 ];
+    pxSpan->ulNameLength = ulEnd - ulIndex - 2;
+
+    ulIndex = prvSkipSpace( pucJSON, ulLength, ulEnd );
+
+    if( ( ulIndex >= ulLength ) || ( pucJSON[ ulIndex ] != ':' ) )
+    {
+        return eHubReporterMemberError;
+    }
+
+    ulIndex = prvSkipSpace( pucJSON, ulLength, ulIndex + 1 );
+
+    if( !prvScanValue( pucJSON, ulLength, ulIndex, &ulEnd ) || ( ulEnd == ulIndex ) )
+    {
+        return eHubReporterMemberError;
+    }
+
+    pxSpan->pucValue = &pucJSON[ ulIndex ];
+    pxSpan->ulValueLength = ulEnd - ulIndex;
+    *pulIndex = ulEnd;
+
+    return eHubReporterMemberFound;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvSpanIs( const uint8_t * pucText,
+                       uint32_t ulLength,
+                       const char * pcExpected )
+{
+    return ( ulLength == strlen( pcExpected ) ) && ( memcmp( pucText, pcExpected, ulLength ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvIsComponent( const HubReporterSpan_t * pxMember )
+{
+    HubReporterSpan_t xChild;
+    uint32_t ulIndex = 1;
+
+    if( pxMember->pucValue[ 0 ] != '{' )
+    {
+        return false;
+    }
+
+    while( prvNextMember( pxMember->pucValue, pxMember->ulValueLength, &ulIndex, &xChild ) == eHubReporterMemberFound )
+    {
+        if( prvSpanIs( xChild.pucName, xChild.ulNameLength, hubreporterCOMPONENT_MARKER_NAME ) )
+        {
+            return prvSpanIs( xChild.pucValue, xChild.ulValueLength, hubreporterCOMPONENT_MARKER_VALUE );
+        }
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Writable property version acknowledged by a value of the form {"av":n,...}, else 0.
+ */
+static uint32_t prvAckVersion( const uint8_t * pucValue,
+                               uint32_t ulValueLength )
+{
+    HubReporterSpan_t xChild;
+    uint32_t ulIndex = 1;
+    uint32_t ulVersion = 0;
+    uint32_t ulDigit;
+
+    if( pucValue[ 0 ] != '{' )
+    {
+        return 0;
+    }
+
+    while( prvNextMember( pucValue, ulValueLength, &ulIndex, &xChild ) == eHubReporterMemberFound )
+    {
+        if( prvSpanIs( xChild.pucName, xChild.ulNameLength, hubreporterACK_VERSION_NAME ) )
+        {
+            for( ulDigit = 0; ulDigit < xChild.ulValueLength; ulDigit++ )
+            {
+                if( ( xChild.pucValue[ ulDigit ] < '0' ) || ( xChild.pucValue[ ulDigit ] > '9' ) )
+                {
+                    return 0;
+                }
+
+                ulVersion = ulVersion * 10 + ( uint32_t ) ( xChild.pucValue[ ulDigit ] - '0' );
+            }
+
+            return ulVersion;
+        }
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvOpenWindow( HubReporter_t * pxReporter )
+{
+    if( !pxReporter->xWindowOpen )
+    {
+        pxReporter->xWindowOpen = true;
+        pxReporter->xWindowStartTicks = xTaskGetTickCount();
+    }
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvSet( HubReporter_t * pxReporter,
+                                const uint8_t * pucComponentName,
+                                uint32_t ulComponentNameLength,
+                                const uint8_t * pucPropertyName,
+                                uint32_t ulPropertyNameLength,
+                                const uint8_t * pucValue,
+                                uint32_t ulValueLength )
+{
+    HubReporterProperty_t * pxProperty = NULL;
+    HubReporterProperty_t * pxFree = NULL;
+    uint32_t ulIndex;
+
+    if( ( ulComponentNameLength > HUB_REPORTER_MAX_NAME_LENGTH ) ||
+        ( ulPropertyNameLength > HUB_REPORTER_MAX_NAME_LENGTH ) ||
+        ( ulValueLength > HUB_REPORTER_MAX_VALUE_LENGTH ) ||
+        ( ulPropertyNameLength == 0 ) || ( ulValueLength == 0 ) )
+    {
+        LogError( ( "Reported property %.*s too large", ( int ) ulPropertyNameLength, pucPropertyName ) );
+        pxReporter->xStats.ulTooLarge++;
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    for( ulIndex = 0; ( ulIndex < HUB_REPORTER_MAX_PROPERTIES ) && ( pxProperty == NULL ); ulIndex++ )
+    {
+        HubReporterProperty_t * pxEntry = &pxReporter->xProperties[ ulIndex ];
+
+        if( !pxEntry->xInUse )
+        {
+            pxFree = ( pxFree == NULL ) ? pxEntry : pxFree;
+        }
+        else if( prvSpanIs( pucComponentName, ulComponentNameLength, pxEntry->cComponentName ) &&
+                 prvSpanIs( pucPropertyName, ulPropertyNameLength, pxEntry->cPropertyName ) )
+        {
+            pxProperty = pxEntry;
+        }
+    }
+
+    if( pxProperty == NULL )
+    {
+        if( pxFree == NULL )
+        {
+            LogError( ( "No room to track reported property %.*s", ( int ) ulPropertyNameLength, pucPropertyName ) );
+            return eAzureIoTErrorOutOfMemory;
+        }
+
+        pxProperty = pxFree;
+        memset( pxProperty, 0, sizeof( HubReporterProperty_t ) );
+        pxProperty->xInUse = true;
+        memcpy( pxProperty->cComponentName, pucComponentName, ulComponentNameLength );
+        memcpy( pxProperty->cPropertyName, pucPropertyName, ulPropertyNameLength );
+    }
+    else if( ( pxProperty->ulValueLength == ulValueLength ) &&
+             ( memcmp( pxProperty->ucValue, pucValue, ulValueLength ) == 0 ) )
+    {
+        /* Already pending or sent, a rejected patch makes it pending again. */
+        pxReporter->xStats.ulUnchanged++;
+        return eAzureIoTSuccess;
+    }
+
+    memcpy( pxProperty->ucValue, pucValue, ulValueLength );
+    pxProperty->ulValueLength = ulValueLength;
+    pxProperty->ulUpdateSequence = ++pxReporter->ulSequence;
+    pxProperty->ulAckVersion = prvAckVersion( pucValue, ulValueLength );
+    pxProperty->xPending = true;
+
+    pxReporter->xStats.ulUpdates++;
+    prvOpenWindow( pxReporter );
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvAppend( HubReporter_t * pxReporter,
+                       uint32_t * pulIndex,
+                       uint32_t ulLimit,
+                       const void * pvData,
+                       uint32_t ulLength )
+{
+    if( *pulIndex + ulLength > ulLimit )
+    {
+        return false;
+    }
+
+    memcpy( &pxReporter->pucPatchBuffer[ *pulIndex ], pvData, ulLength );
+    *pulIndex += ulLength;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append ,"name":value (comma unless first) and record it in the patch.
+ */
+static bool prvAppendProperty( HubReporter_t * pxReporter,
+                               HubReporterPatch_t * pxPatch,
+                               uint32_t ulProperty,
+                               uint32_t * pulIndex,
+                               uint32_t ulLimit,
+                               bool xFirst )
+{
+    HubReporterProperty_t * pxProperty = &pxReporter->xProperties[ ulProperty ];
+    uint32_t ulStart = *pulIndex;
+
+    if( ( xFirst || prvAppend( pxReporter, pulIndex, ulLimit, ",", 1 ) ) &&
+        prvAppend( pxReporter, pulIndex, ulLimit, "\"", 1 ) &&
+        prvAppend( pxReporter, pulIndex, ulLimit, pxProperty->cPropertyName, strlen( pxProperty->cPropertyName ) ) &&
+        prvAppend( pxReporter, pulIndex, ulLimit, "\":", 2 ) &&
+        prvAppend( pxReporter, pulIndex, ulLimit, pxProperty->ucValue, pxProperty->ulValueLength ) )
+    {
+        pxPatch->ulSequences[ ulProperty ] = pxProperty->ulUpdateSequence;
+
+        if( pxProperty->ulAckVersion > pxPatch->ulAckVersion )
+        {
+            pxPatch->ulAckVersion = pxProperty->ulAckVersion;
+        }
+
+        return true;
+    }
+
+    *pulIndex = ulStart;
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Build the patch JSON from the pending properties that fit.
+ *
+ * Root properties come first, then one object per component. Room for the
+ * closing braces is kept aside while appending.
+ *
+ * @return Length of the patch, 0 if nothing was added.
+ */
+static uint32_t prvBuildPatch( HubReporter_t * pxReporter,
+                               HubReporterPatch_t * pxPatch )
+{
+    uint32_t ulSize = pxReporter->ulPatchBufferSize;
+    uint32_t ulIndex = 0;
+    uint32_t ulGroupStart;
+    uint32_t ulProperty;
+    uint32_t ulMember;
+    uint32_t ulDone = 0;
+    bool xEmpty = true;
+    bool xGroupEmpty;
+    HubReporterProperty_t * pxProperty;
+
+    ( void ) prvAppend( pxReporter, &ulIndex, ulSize, "{", 1 );
+
+    for( ulProperty = 0; ulProperty < HUB_REPORTER_MAX_PROPERTIES; ulProperty++ )
+    {
+        pxProperty = &pxReporter->xProperties[ ulProperty ];
+
+        if( pxProperty->xPending && ( pxProperty->cComponentName[ 0 ] == '\0' ) &&
+            prvAppendProperty( pxReporter, pxPatch, ulProperty, &ulIndex, ulSize - 1, xEmpty ) )
+        {
+            xEmpty = false;
+        }
+    }
+
+    for( ulProperty = 0; ulProperty < HUB_REPORTER_MAX_PROPERTIES; ulProperty++ )
+    {
+        pxProperty = &pxReporter->xProperties[ ulProperty ];
+
+        if( !pxProperty->xPending || ( pxProperty->cComponentName[ 0 ] == '\0' ) ||
+            ( ( ulDone & ( 1UL << ulProperty ) ) != 0 ) )
+        {
+            continue;
+        }
+
+        ulGroupStart = ulIndex;
+        xGroupEmpty = true;
+
+        if( ( xEmpty || prvAppend( pxReporter, &ulIndex, ulSize - 2, ",", 1 ) ) &&
+            prvAppend( pxReporter, &ulIndex, ulSize - 2, "\"", 1 ) &&
+            prvAppend( pxReporter, &ulIndex, ulSize - 2, pxProperty->cComponentName, strlen( pxProperty->cComponentName ) ) &&
+            prvAppend( pxReporter, &ulIndex, ulSize - 2, "\":{\"" hubreporterCOMPONENT_MARKER_NAME "\":" hubreporterCOMPONENT_MARKER_VALUE,
+                       sizeof( "\":{\"" hubreporterCOMPONENT_MARKER_NAME "\":" hubreporterCOMPONENT_MARKER_VALUE ) - 1 ) )
+        {
+            for( ulMember = ulProperty; ulMember < HUB_REPORTER_MAX_PROPERTIES; ulMember++ )
+            {
+                if( pxReporter->xProperties[ ulMember ].xPending &&
+                    ( strcmp( pxReporter->xProperties[ ulMember ].cComponentName, pxProperty->cComponentName ) == 0 ) )
+                {
+                    ulDone |= ( 1UL << ulMember );
+
+                    if( prvAppendProperty( pxReporter, pxPatch, ulMember, &ulIndex, ulSize - 2, false ) )
+                    {
+                        xGroupEmpty = false;
+                    }
+                }
+            }
+        }
+
+        if( xGroupEmpty )
+        {
+            ulIndex = ulGroupStart;
+        }
+        else
+        {
+            ( void ) prvAppend( pxReporter, &ulIndex, ulSize - 1, "}", 1 );
+            xEmpty = false;
+        }
+    }
+
+    if( xEmpty )
+    {
+        return 0;
+    }
+
+    ( void ) prvAppend( pxReporter, &ulIndex, ulSize, "}", 1 );
+
+    return ulIndex;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Make the properties of a patch given up on pending again, unless
+ * overwritten since or carried by another patch in flight.
+ */
+static void prvRequeue( HubReporter_t * pxReporter,
+                        HubReporterPatch_t * pxPatch )
+{
+    HubReporterProperty_t * pxProperty;
+    uint32_t ulProperty;
+    uint32_t ulIndex;
+    bool xCarried;
+
+    pxPatch->xInUse = false;
+    pxReporter->xStats.ulPatchesUntracked++;
+
+    if( pxReporter->xResponseCallback != NULL )
+    {
+        pxReporter->xResponseCallback( pxPatch->ulRequestID,
+                                       ( uint32_t ) ( ( xTaskGetTickCount() - pxPatch->xSentTicks ) * portTICK_PERIOD_MS ),
+                                       false, pxReporter->pvResponseContext );
+    }
+
+    for( ulProperty = 0; ulProperty < HUB_REPORTER_MAX_PROPERTIES; ulProperty++ )
+    {
+        pxProperty = &pxReporter->xProperties[ ulProperty ];
+
+        if( ( pxPatch->ulSequences[ ulProperty ] == 0 ) ||
+            ( pxPatch->ulSequences[ ulProperty ] != pxProperty->ulUpdateSequence ) ||
+            ( pxProperty->ulAckedSequence >= pxProperty->ulUpdateSequence ) )
+        {
+            continue;
+        }
+
+        xCarried = false;
+
+        for( ulIndex = 0; ulIndex < HUB_REPORTER_MAX_IN_FLIGHT; ulIndex++ )
+        {
+            if( pxReporter->xPatches[ ulIndex ].xInUse &&
+                ( pxReporter->xPatches[ ulIndex ].ulSequences[ ulProperty ] == pxProperty->ulUpdateSequence ) )
+            {
+                xCarried = true;
+            }
+        }
+
+        if( !xCarried )
+        {
+            pxProperty->xPending = true;
+            prvOpenWindow( pxReporter );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Give up on the patches whose response is overdue.
+ */
+static void prvExpirePatches( HubReporter_t * pxReporter )
+{
+    HubReporterPatch_t * pxPatch;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < HUB_REPORTER_MAX_IN_FLIGHT; ulIndex++ )
+    {
+        pxPatch = &pxReporter->xPatches[ ulIndex ];
+
+        if( pxPatch->xInUse &&
+            ( ( xTaskGetTickCount() - pxPatch->xSentTicks ) >= pdMS_TO_TICKS( HUB_REPORTER_RESPONSE_TIMEOUT_MS ) ) )
+        {
+            LogWarn( ( "No response to patch %u, sending its properties again", ( unsigned ) pxPatch->ulRequestID ) );
+            prvRequeue( pxReporter, pxPatch );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Free patch slot, giving up on the oldest patch if none is free.
+ */
+static HubReporterPatch_t * prvPatchSlot( HubReporter_t * pxReporter )
+{
+    HubReporterPatch_t * pxOldest = &pxReporter->xPatches[ 0 ];
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < HUB_REPORTER_MAX_IN_FLIGHT; ulIndex++ )
+    {
+        if( !pxReporter->xPatches[ ulIndex ].xInUse )
+        {
+            return &pxReporter->xPatches[ ulIndex ];
+        }
+
+        if( ( xTaskGetTickCount() - pxReporter->xPatches[ ulIndex ].xSentTicks ) >
+            ( xTaskGetTickCount() - pxOldest->xSentTicks ) )
+        {
+            pxOldest = &pxReporter->xPatches[ ulIndex ];
+        }
+    }
+
+    /* Stop waiting for its response and send its properties again. */
+    LogWarn( ( "Too many patches in flight, sending the properties of patch %u again",
+               ( unsigned ) pxOldest->ulRequestID ) );
+    prvRequeue( pxReporter, pxOldest );
+
+    return pxOldest;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubReporter_Init( HubReporter_t * pxReporter,
+                                   AzureIoTHubClient_t * pxHubClient,
+                                   uint8_t * pucPatchBuffer,
+                                   uint32_t ulPatchBufferSize,
+                                   uint32_t ulWindowMs )
+{
+    if( ( pxReporter == NULL ) || ( pxHubClient == NULL ) ||
+        ( pucPatchBuffer == NULL ) || ( ulPatchBufferSize < 2 ) )
+    {
+        LogError( ( "HubReporter_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxReporter, 0, sizeof( HubReporter_t ) );
+    pxReporter->pxHubClient = pxHubClient;
+    pxReporter->pucPatchBuffer = pucPatchBuffer;
+    pxReporter->ulPatchBufferSize = ulPatchBufferSize;
+    pxReporter->ulWindowMs = ulWindowMs;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+void HubReporter_SetResponseCallback( HubReporter_t * pxReporter,
+                                      HubReporterResponseCallback_t xCallback,
+                                      void * pvContext )
+{
+    if( pxReporter != NULL )
+    {
+        pxReporter->xResponseCallback = xCallback;
+        pxReporter->pvResponseContext = pvContext;
+    }
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubReporter_SetJSON( HubReporter_t * pxReporter,
+                                      const char * pcComponentName,
+                                      const char * pcPropertyName,
+                                      const uint8_t * pucValue,
+                                      uint32_t ulValueLength )
+{
+    if( ( pxReporter == NULL ) || ( pcPropertyName == NULL ) || ( pucValue == NULL ) )
+    {
+        LogError( ( "HubReporter_SetJSON failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pcComponentName == NULL )
+    {
+        pcComponentName = "";
+    }
+
+    return prvSet( pxReporter,
+                   ( const uint8_t * ) pcComponentName, strlen( pcComponentName ),
+                   ( const uint8_t * ) pcPropertyName, strlen( pcPropertyName ),
+                   pucValue, ulValueLength );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubReporter_MergePatch( HubReporter_t * pxReporter,
+                                         const uint8_t * pucPatch,
+                                         uint32_t ulPatchLength )
+{
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+    AzureIoTResult_t xSetResult = eAzureIoTSuccess;
+    HubReporterMember_t xMember;
+    HubReporterMember_t xChildMember;
+    HubReporterSpan_t xSpan;
+    HubReporterSpan_t xChild;
+    uint32_t ulIndex;
+    uint32_t ulChildIndex;
+
+    if( ( pxReporter == NULL ) || ( pucPatch == NULL ) )
+    {
+        LogError( ( "HubReporter_MergePatch failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    ulIndex = prvSkipSpace( pucPatch, ulPatchLength, 0 );
+
+    if( ( ulIndex >= ulPatchLength ) || ( pucPatch[ ulIndex ] != '{' ) )
+    {
+        LogError( ( "Reported properties patch is not an object" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    ulIndex++;
+
+    /* A property which cannot be tracked is skipped, the others still go out. */
+    while( ( xMember = prvNextMember( pucPatch, ulPatchLength, &ulIndex, &xSpan ) ) == eHubReporterMemberFound )
+    {
+        if( !prvIsComponent( &xSpan ) )
+        {
+            if( ( xSetResult = prvSet( pxReporter, NULL, 0, xSpan.pucName, xSpan.ulNameLength,
+                                       xSpan.pucValue, xSpan.ulValueLength ) ) != eAzureIoTSuccess )
+            {
+                xResult = xSetResult;
+            }
+
+            continue;
+        }
+
+        ulChildIndex = 1;
+
+        while( ( xChildMember = prvNextMember( xSpan.pucValue, xSpan.ulValueLength,
+                                               &ulChildIndex, &xChild ) ) == eHubReporterMemberFound )
+        {
+            if( !prvSpanIs( xChild.pucName, xChild.ulNameLength, hubreporterCOMPONENT_MARKER_NAME ) &&
+                ( ( xSetResult = prvSet( pxReporter, xSpan.pucName, xSpan.ulNameLength,
+                                         xChild.pucName, xChild.ulNameLength,
+                                         xChild.pucValue, xChild.ulValueLength ) ) != eAzureIoTSuccess ) )
+            {
+                xResult = xSetResult;
+            }
+        }
+
+        if( xChildMember == eHubReporterMemberError )
+        {
+            xMember = eHubReporterMemberError;
+            break;
+        }
+    }
+
+    if( xMember == eHubReporterMemberError )
+    {
+        LogError( ( "Malformed reported properties patch: %.*s", ( int ) ulPatchLength, pucPatch ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubReporter_Flush( HubReporter_t * pxReporter )
+{
+    HubReporterPatch_t xPatch;
+    HubReporterPatch_t * pxSlot;
+    AzureIoTResult_t xResult;
+    uint32_t ulLength;
+    uint32_t ulProperty;
+    uint32_t ulCount = 0;
+    bool xRemaining = false;
+
+    if( pxReporter == NULL )
+    {
+        LogError( ( "HubReporter_Flush failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    for( ulProperty = 0; ( ulProperty < HUB_REPORTER_MAX_PROPERTIES ) && !xRemaining; ulProperty++ )
+    {
+        xRemaining = pxReporter->xProperties[ ulProperty ].xPending;
+    }
+
+    if( !xRemaining )
+    {
+        pxReporter->xWindowOpen = false;
+        return eAzureIoTSuccess;
+    }
+
+    /* Free a slot first, so a patch given up on is sent again in this one. */
+    pxSlot = prvPatchSlot( pxReporter );
+    memset( &xPatch, 0, sizeof( xPatch ) );
+    xRemaining = false;
+
+    if( ( ulLength = prvBuildPatch( pxReporter, &xPatch ) ) == 0 )
+    {
+        pxReporter->xWindowOpen = false;
+        return eAzureIoTSuccess;
+    }
+
+    LogDebug( ( "Sending reported properties patch: %.*s", ( int ) ulLength, pxReporter->pucPatchBuffer ) );
+
+    xResult = AzureIoTHubClient_SendPropertiesReported( pxReporter->pxHubClient,
+                                                        pxReporter->pucPatchBuffer, ulLength,
+                                                        &xPatch.ulRequestID );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        LogError( ( "There was an error sending the reported properties: 0x%08x", xResult ) );
+        return xResult;
+    }
+
+    for( ulProperty = 0; ulProperty < HUB_REPORTER_MAX_PROPERTIES; ulProperty++ )
+    {
+        if( xPatch.ulSequences[ ulProperty ] != 0 )
+        {
+            pxReporter->xProperties[ ulProperty ].xPending = false;
+            ulCount++;
+        }
+        else if( pxReporter->xProperties[ ulProperty ].xPending )
+        {
+            xRemaining = true;
+        }
+    }
+
+    xPatch.xInUse = true;
+    xPatch.xSentTicks = xTaskGetTickCount();
+    *pxSlot = xPatch;
+
+    pxReporter->xStats.ulPatchesSent++;
+
+    /* Whatever did not fit goes out on the next call without waiting again. */
+    pxReporter->xWindowOpen = xRemaining;
+
+    LogInfo( ( "Reported %u properties in patch %u (%u updates in %u patches)",
+               ( unsigned ) ulCount, ( unsigned ) xPatch.ulRequestID,
+               ( unsigned ) pxReporter->xStats.ulUpdates,
+               ( unsigned ) pxReporter->xStats.ulPatchesSent ) );
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubReporter_Process( HubReporter_t * pxReporter )
+{
+    if( pxReporter == NULL )
+    {
+        LogError( ( "HubReporter_Process failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    prvExpirePatches( pxReporter );
+
+    if( !pxReporter->xWindowOpen ||
+        ( ( xTaskGetTickCount() - pxReporter->xWindowStartTicks ) < pdMS_TO_TICKS( pxReporter->ulWindowMs ) ) )
+    {
+        return eAzureIoTSuccess;
+    }
+
+    return HubReporter_Flush( pxReporter );
+}
+/*-----------------------------------------------------------*/
+
+void HubReporter_HandleResponse( HubReporter_t * pxReporter,
+                                 const AzureIoTHubClientPropertiesResponse_t * pxMessage )
+{
+    HubReporterPatch_t * pxPatch = NULL;
+    HubReporterProperty_t * pxProperty;
+    uint32_t ulStatus;
+    uint32_t ulLatencyMs;
+    uint32_t ulIndex;
+
+    if( ( pxReporter == NULL ) || ( pxMessage == NULL ) )
+    {
+        return;
+    }
+
+    for( ulIndex = 0; ulIndex < HUB_REPORTER_MAX_IN_FLIGHT; ulIndex++ )
+    {
+        if( pxReporter->xPatches[ ulIndex ].xInUse &&
+            ( pxReporter->xPatches[ ulIndex ].ulRequestID == pxMessage->ulRequestID ) )
+        {
+            pxPatch = &pxReporter->xPatches[ ulIndex ];
+        }
+    }
+
+    if( pxPatch == NULL )
+    {
+        LogWarn( ( "Reported properties response for unknown request %u", ( unsigned ) pxMessage->ulRequestID ) );
+        return;
+    }
+
+    ulStatus = ( uint32_t ) pxMessage->xMessageStatus;
+    ulLatencyMs = ( uint32_t ) ( ( xTaskGetTickCount() - pxPatch->xSentTicks ) * portTICK_PERIOD_MS );
+
+    if( ulLatencyMs > pxReporter->xStats.ulMaxAckLatencyMs )
+    {
+        pxReporter->xStats.ulMaxAckLatencyMs = ulLatencyMs;
+    }
+
+    for( ulIndex = 0; ulIndex < HUB_REPORTER_MAX_PROPERTIES; ulIndex++ )
+    {
+        pxProperty = &pxReporter->xProperties[ ulIndex ];
+
+        if( pxPatch->ulSequences[ ulIndex ] == 0 )
+        {
+            continue;
+        }
+
+        if( ( ulStatus >= 200 ) && ( ulStatus < 300 ) )
+        {
+            if( pxPatch->ulSequences[ ulIndex ] > pxProperty->ulAckedSequence )
+            {
+                pxProperty->ulAckedSequence = pxPatch->ulSequences[ ulIndex ];
+            }
+        }
+        else if( pxPatch->ulSequences[ ulIndex ] == pxProperty->ulUpdateSequence )
+        {
+            /* Not overwritten since, so send the same value again. */
+            pxProperty->xPending = true;
+            prvOpenWindow( pxReporter );
+        }
+    }
+
+    if( ( ulStatus >= 200 ) && ( ulStatus < 300 ) )
+    {
+        pxReporter->xStats.ulPatchesAcked++;
+        pxReporter->xStats.ulReportedVersion = pxMessage->ulVersion;
+
+        if( pxPatch->ulAckVersion > pxReporter->xStats.ulAckedVersion )
+        {
+            pxReporter->xStats.ulAckedVersion = pxPatch->ulAckVersion;
+        }
+
+        LogInfo( ( "Patch %u accepted in %u ms, reported version %u, acknowledged desired version %u",
+                   ( unsigned ) pxMessage->ulRequestID, ( unsigned ) ulLatencyMs,
+                   ( unsigned ) pxMessage->ulVersion, ( unsigned ) pxReporter->xStats.ulAckedVersion ) );
+    }
+    else
+    {
+        pxReporter->xStats.ulPatchesRejected++;
+        LogError( ( "Patch %u rejected with status %u", ( unsigned ) pxMessage->ulRequestID, ( unsigned ) ulStatus ) );
+    }
+
+    pxPatch->xInUse = false;
+
+    if( pxReporter->xResponseCallback != NULL )
+    {
+        pxReporter->xResponseCallback( pxMessage->ulRequestID, ulLatencyMs, true, pxReporter->pvResponseContext );
+    }
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,247 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_reporter.h
+ * @brief Coalescing of reported property updates into single twin patches.
+ *
+ * Updates are held in a fixed table, keyed by component and property name,
+ * and the newest value of each property wins. Once the configured window has
+ * passed since the first pending update, every pending property is sent in
+ * one reported properties PATCH, so that a burst of updates costs one twin
+ * operation instead of one per update.
+ *
+ * Each patch remembers which update of each property it carried. When IoT
+ * Hub answers on the reported properties response topic, pass the message to
+ * #HubReporter_HandleResponse: accepted patches advance the acknowledged
+ * update and writable property version, rejected ones make their properties
+ * pending again unless they were overwritten in the meantime. So do patches
+ * whose response is overdue, or which are no longer tracked to make room
+ * for a newer one.
+ *
+ * An optional response callback gets the round trip of every patch, for
+ * example to gauge the link like the PUBACK latency of telemetry does.
+ */
+
+#ifndef HUB_REPORTER_H
+#define HUB_REPORTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+/**
+ * @brief Number of distinct properties which can be tracked.
+ *
+ * @note Must not be above 32.
+ */
+#ifndef HUB_REPORTER_MAX_PROPERTIES
+    #define HUB_REPORTER_MAX_PROPERTIES      ( 12U )
+#endif
+
+/**
+ * @brief Longest component or property name, as it appears in the JSON.
+ */
+#ifndef HUB_REPORTER_MAX_NAME_LENGTH
+    #define HUB_REPORTER_MAX_NAME_LENGTH     ( 32U )
+#endif
+
+/**
+ * @brief Longest JSON value of a property.
+ */
+#ifndef HUB_REPORTER_MAX_VALUE_LENGTH
+    #define HUB_REPORTER_MAX_VALUE_LENGTH    ( 96U )
+#endif
+
+/**
+ * @brief Number of sent patches awaiting a response which are tracked.
+ */
+#ifndef HUB_REPORTER_MAX_IN_FLIGHT
+    #define HUB_REPORTER_MAX_IN_FLIGHT       ( 2U )
+#endif
+
+/**
+ * @brief Time after which the response of a patch is given up on and its
+ * properties are sent again.
+ */
+#ifndef HUB_REPORTER_RESPONSE_TIMEOUT_MS
+    #define HUB_REPORTER_RESPONSE_TIMEOUT_MS ( 30000U )
+#endif
+
+/**
+ * @brief Called once per sent patch when it completes.
+ *
+ * @param[in] ulRequestID Request ID of the patch.
+ * @param[in] ulLatencyMs Time from send to response, or to giving up on it.
+ * @param[in] xAnswered false if the patch got no response in time or was no
+ * longer tracked, true if IoT Hub answered, accepting or rejecting it.
+ * @param[in] pvContext Context given to #HubReporter_SetResponseCallback.
+ */
+typedef void ( * HubReporterResponseCallback_t )( uint32_t ulRequestID,
+                                                  uint32_t ulLatencyMs,
+                                                  bool xAnswered,
+                                                  void * pvContext );
+
+/**
+ * @brief Latest value of one reported property.
+ */
+typedef struct HubReporterProperty
+{
+    bool xInUse;
+    bool xPending;                                                /**< @brief Not yet sent since last update. */
+    char cComponentName[ HUB_REPORTER_MAX_NAME_LENGTH + 1 ];      /**< @brief Empty for the root component. */
+    char cPropertyName[ HUB_REPORTER_MAX_NAME_LENGTH + 1 ];
+    uint8_t ucValue[ HUB_REPORTER_MAX_VALUE_LENGTH ];
+    uint32_t ulValueLength;
+    uint32_t ulUpdateSequence;                                    /**< @brief Update which set the current value. */
+    uint32_t ulAckedSequence;                                     /**< @brief Last update IoT Hub accepted. */
+    uint32_t ulAckVersion;                                        /**< @brief Writable property version ("av") of the value, or 0. */
+} HubReporterProperty_t;
+
+/**
+ * @brief A sent patch waiting for its response.
+ */
+typedef struct HubReporterPatch
+{
+    bool xInUse;
+    uint32_t ulRequestID;
+    TickType_t xSentTicks;
+    uint32_t ulAckVersion;                                         /**< @brief Highest writable property version carried. */
+    uint32_t ulSequences[ HUB_REPORTER_MAX_PROPERTIES ];           /**< @brief Update carried per property, 0 if none. */
+} HubReporterPatch_t;
+
+/**
+ * @brief Reporter counters.
+ */
+typedef struct HubReporterStats
+{
+    uint32_t ulUpdates;           /**< @brief Property updates accepted. */
+    uint32_t ulUnchanged;         /**< @brief Updates dropped as equal to the pending or sent value. */
+    uint32_t ulPatchesSent;       /**< @brief Reported properties PATCHes sent. */
+    uint32_t ulPatchesAcked;      /**< @brief Patches accepted by IoT Hub. */
+    uint32_t ulPatchesRejected;   /**< @brief Patches answered with an error status. */
+    uint32_t ulPatchesUntracked;  /**< @brief Patches overdue or evicted, their properties queued again. */
+    uint32_t ulTooLarge;          /**< @brief Properties skipped as too large to track. */
+    uint32_t ulAckedVersion;      /**< @brief Highest writable property version acknowledged. */
+    uint32_t ulReportedVersion;   /**< @brief Reported properties version from the last response. */
+    uint32_t ulMaxAckLatencyMs;   /**< @brief Largest send to response latency. */
+} HubReporterStats_t;
+
+/**
+ * @brief Reported property coalescer for one hub client.
+ */
+typedef struct HubReporter
+{
+    AzureIoTHubClient_t * pxHubClient;
+    uint8_t * pucPatchBuffer;
+    uint32_t ulPatchBufferSize;
+    uint32_t ulWindowMs;
+    bool xWindowOpen;
+    TickType_t xWindowStartTicks;
+    uint32_t ulSequence;
+    HubReporterProperty_t xProperties[ HUB_REPORTER_MAX_PROPERTIES ];
+    HubReporterPatch_t xPatches[ HUB_REPORTER_MAX_IN_FLIGHT ];
+    HubReporterStats_t xStats;
+    HubReporterResponseCallback_t xResponseCallback;
+    void * pvResponseContext;
+} HubReporter_t;
+
+/**
+ * @brief Initialize a reporter.
+ *
+ * @param[out] pxReporter Reporter to initialize.
+ * @param[in] pxHubClient Hub client to send with.
+ * @param[in] pucPatchBuffer Buffer the patch JSON is built in.
+ * @param[in] ulPatchBufferSize Size of @p pucPatchBuffer.
+ * @param[in] ulWindowMs Time updates are held for before sending, 0 sends on the next #HubReporter_Process.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubReporter_Init( HubReporter_t * pxReporter,
+                                   AzureIoTHubClient_t * pxHubClient,
+                                   uint8_t * pucPatchBuffer,
+                                   uint32_t ulPatchBufferSize,
+                                   uint32_t ulWindowMs );
+
+/**
+ * @brief Set the callback told of the completion of every patch.
+ *
+ * @param[in] pxReporter Reporter to update.
+ * @param[in] xCallback Callback, NULL for none.
+ * @param[in] pvContext Context for @p xCallback.
+ */
+void HubReporter_SetResponseCallback( HubReporter_t * pxReporter,
+                                      HubReporterResponseCallback_t xCallback,
+                                      void * pvContext );
+
+/**
+ * @brief Set the value of one property.
+ *
+ * @param[in] pxReporter Reporter to update.
+ * @param[in] pcComponentName Component name, NULL for the root component.
+ * @param[in] pcPropertyName Property name.
+ * @param[in] pucValue JSON text of the value.
+ * @param[in] ulValueLength Length of @p pucValue.
+ * @return An #AzureIoTResult_t with the result of the operation,
+ * eAzureIoTErrorOutOfMemory if the property is too large or there is no room
+ * to track it.
+ */
+AzureIoTResult_t HubReporter_SetJSON( HubReporter_t * pxReporter,
+                                      const char * pcComponentName,
+                                      const char * pcPropertyName,
+                                      const uint8_t * pucValue,
+                                      uint32_t ulValueLength );
+
+/**
+ * @brief Split a reported properties JSON patch into property updates.
+ *
+ * Accepts what would otherwise be passed to
+ * AzureIoTHubClient_SendPropertiesReported(), including component objects
+ * marked with "__t":"c".
+ *
+ * A property which cannot be tracked, as it is too large or the table is
+ * full, is skipped and the others are still merged.
+ *
+ * @param[in] pxReporter Reporter to update.
+ * @param[in] pucPatch JSON object.
+ * @param[in] ulPatchLength Length of @p pucPatch.
+ * @return An #AzureIoTResult_t with the result of the operation,
+ * eAzureIoTErrorOutOfMemory if a property was skipped.
+ */
+AzureIoTResult_t HubReporter_MergePatch( HubReporter_t * pxReporter,
+                                         const uint8_t * pucPatch,
+                                         uint32_t ulPatchLength );
+
+/**
+ * @brief Send the pending properties if the window has passed.
+ *
+ * Patches without a response after #HUB_REPORTER_RESPONSE_TIMEOUT_MS make
+ * their properties pending again first.
+ *
+ * @param[in] pxReporter Reporter to process.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubReporter_Process( HubReporter_t * pxReporter );
+
+/**
+ * @brief Send the pending properties now.
+ *
+ * @param[in] pxReporter Reporter to flush.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubReporter_Flush( HubReporter_t * pxReporter );
+
+/**
+ * @brief Match a reported properties response with its patch.
+ *
+ * @param[in] pxReporter Reporter which sent the patch.
+ * @param[in] pxMessage Message of type eAzureIoTHubPropertiesReportedResponseMessage.
+ */
+void HubReporter_HandleResponse( HubReporter_t * pxReporter,
+                                 const AzureIoTHubClientPropertiesResponse_t * pxMessage );
+
+#endif /* HUB_REPORTER_H */
@@ -0,0 +1,168 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_session.c
+ * @brief Persistent MQTT session handling on top of the Azure IoT Hub client.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Logging configuration for the hub session. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "HubSession"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "hub_session.h"
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvElapsedMs( TickType_t xStart )
+{
+    return ( uint32_t ) ( ( xTaskGetTickCount() - xStart ) * portTICK_PERIOD_MS );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubSession_Init( HubSession_t * pxSession,
+                                  AzureIoTHubClient_t * pxHubClient,
+                                  const HubSubscriptions_t * pxSubscriptions )
+{
+    if( ( pxSession == NULL ) || ( pxHubClient == NULL ) || ( pxSubscriptions == NULL ) )
+    {
+        LogError( ( "HubSession_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxSession, 0, sizeof( HubSession_t ) );
+    pxSession->pxHubClient = pxHubClient;
+    pxSession->pxSubscriptions = pxSubscriptions;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubSession_Connect( HubSession_t * pxSession,
+                                     uint32_t ulConnackTimeoutMs )
+{
+    AzureIoTResult_t xResult;
+    bool xSessionPresent = false;
+    TickType_t xStart;
+    uint32_t ulLatencyMs;
+
+    if( pxSession == NULL )
+    {
+        LogError( ( "HubSession_Connect failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    xStart = xTaskGetTickCount();
+
+    /* Clean session is disabled so that IoT Hub keeps our subscriptions. */
+    xResult = AzureIoTHubClient_Connect( pxSession->pxHubClient,
+                                         false, &xSessionPresent,
+                                         ulConnackTimeoutMs );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        LogError( ( "MQTT connect failed: result 0x%08x", xResult ) );
+        return xResult;
+    }
+
+    pxSession->xStats.ulConnectCount++;
+    pxSession->xStats.xLastSessionPresent = xSessionPresent;
+
+    if( xSessionPresent && pxSession->xCallbacksRegistered )
+    {
+        LogInfo( ( "Session present, skipping subscriptions" ) );
+        pxSession->xStats.ulResumedCount++;
+    }
+    else
+    {
+        xResult = HubSubscribe_All( pxSession->pxHubClient, pxSession->pxSubscriptions, NULL );
+
+        if( xResult != eAzureIoTSuccess )
+        {
+            LogError( ( "Subscribing failed: result 0x%08x", xResult ) );
+            pxSession->xCallbacksRegistered = false;
+            return xResult;
+        }
+
+        pxSession->xCallbacksRegistered = true;
+    }
+
+    ulLatencyMs = prvElapsedMs( xStart );
+    pxSession->xStats.ulLastReadyLatencyMs = ulLatencyMs;
+
+    if( ulLatencyMs > pxSession->xStats.ulMaxReadyLatencyMs )
+    {
+        pxSession->xStats.ulMaxReadyLatencyMs = ulLatencyMs;
+    }
+
+    LogInfo( ( "Session ready in %u ms (session present %d, resumed %u of %u connects)",
+               ( unsigned ) ulLatencyMs, xSessionPresent,
+               ( unsigned ) pxSession->xStats.ulResumedCount,
+               ( unsigned ) pxSession->xStats.ulConnectCount ) );
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubSession_Disconnect( HubSession_t * pxSession )
+{
+    if( pxSession == NULL )
+    {
+        LogError( ( "HubSession_Disconnect failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    /* No UNSUBSCRIBE here, the subscriptions stay with the broker session. */
+    return AzureIoTHubClient_Disconnect( pxSession->pxHubClient );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubSession_End( HubSession_t * pxSession )
+{
+    const HubSubscriptions_t * pxSubs;
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+
+    if( pxSession == NULL )
+    {
+        LogError( ( "HubSession_End failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pxSubs = pxSession->pxSubscriptions;
+
+    if( pxSubs->xPropertiesCallback != NULL )
+    {
+        xResult = AzureIoTHubClient_UnsubscribeProperties( pxSession->pxHubClient );
+    }
+
+    if( ( xResult == eAzureIoTSuccess ) && ( pxSubs->xCommandCallback != NULL ) )
+    {
+        xResult = AzureIoTHubClient_UnsubscribeCommand( pxSession->pxHubClient );
+    }
+
+    if( ( xResult == eAzureIoTSuccess ) && ( pxSubs->xCloudToDeviceMessageCallback != NULL ) )
+    {
+        xResult = AzureIoTHubClient_UnsubscribeCloudToDeviceMessage( pxSession->pxHubClient );
+    }
+
+    pxSession->xCallbacksRegistered = false;
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        xResult = AzureIoTHubClient_Disconnect( pxSession->pxHubClient );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,101 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_session.h
+ * @brief Persistent MQTT session handling on top of the Azure IoT Hub client.
+ *
+ * The session connects with clean session disabled. When IoT Hub reports that
+ * the previous session is still present, the broker side subscriptions are
+ * retained and, as long as the same #AzureIoTHubClient_t was not
+ * re-initialized, so are the middleware receive callbacks. In that case the
+ * SUBSCRIBE round trips are skipped entirely.
+ *
+ * QoS1 publishes not acknowledged before a disconnect belong to the session
+ * as well: after a connect which kept it, send them again with
+ * HubPublish_Resume() and xStats.xLastSessionPresent rather than abandoning
+ * them.
+ */
+
+#ifndef HUB_SESSION_H
+#define HUB_SESSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+#include "hub_subscribe.h"
+
+/**
+ * @brief Counters kept across connections of a session.
+ */
+typedef struct HubSessionStats
+{
+    uint32_t ulConnectCount;        /**< @brief Number of successful MQTT connects. */
+    uint32_t ulResumedCount;        /**< @brief Connects which reused the broker session and skipped subscribing. */
+    uint32_t ulLastReadyLatencyMs;  /**< @brief Time from CONNECT sent to subscriptions ready, last connect. */
+    uint32_t ulMaxReadyLatencyMs;   /**< @brief Largest ready latency seen. */
+    bool xLastSessionPresent;       /**< @brief Session present flag of the last CONNACK. */
+} HubSessionStats_t;
+
+/**
+ * @brief Session state, one per #AzureIoTHubClient_t.
+ */
+typedef struct HubSession
+{
+    AzureIoTHubClient_t * pxHubClient;
+    const HubSubscriptions_t * pxSubscriptions;
+    bool xCallbacksRegistered; /**< @brief Receive callbacks are registered in pxHubClient. */
+    HubSessionStats_t xStats;
+} HubSession_t;
+
+/**
+ * @brief Initialize a session.
+ *
+ * @note The hub client must be initialized by the caller once and must not be
+ * re-initialized between connections, otherwise the receive callbacks are lost
+ * and resuming a session would leave incoming messages undispatched.
+ *
+ * @param[out] pxSession Session to initialize.
+ * @param[in] pxHubClient Initialized hub client.
+ * @param[in] pxSubscriptions Subscriptions for this session. Must outlive the session.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubSession_Init( HubSession_t * pxSession,
+                                  AzureIoTHubClient_t * pxHubClient,
+                                  const HubSubscriptions_t * pxSubscriptions );
+
+/**
+ * @brief Connect over an already established transport and make the session ready.
+ *
+ * Subscribes only if IoT Hub did not keep the previous session, or if this is
+ * the first connect of this hub client.
+ *
+ * @param[in] pxSession Session to connect.
+ * @param[in] ulConnackTimeoutMs Timeout waiting for CONNACK.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubSession_Connect( HubSession_t * pxSession,
+                                     uint32_t ulConnackTimeoutMs );
+
+/**
+ * @brief Disconnect, keeping the session and its subscriptions on the broker.
+ *
+ * @note The caller closes the transport afterwards.
+ *
+ * @param[in] pxSession Session to disconnect.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubSession_Disconnect( HubSession_t * pxSession );
+
+/**
+ * @brief Unsubscribe from all features and disconnect, ending the session.
+ *
+ * @param[in] pxSession Session to end.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t HubSession_End( HubSession_t * pxSession );
+
+#endif /* HUB_SESSION_H */
@@ -0,0 +1,392 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_subscribe.c
+ * @brief Subscribe to the IoT Hub features of a device in one round trip.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Logging configuration for the hub subscribe helper. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "HubSubscribe"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "hub_subscribe.h"
+
+/* The SUBSCRIBE packets go through the MQTT client of the hub client. */
+#include "azure_iot_mqtt.h"
+
+/*-----------------------------------------------------------*/
+
+/* Receive contexts of the hub client and the states of their subscription,
+ * as the middleware numbers them. */
+#define hubsubscribeCONTEXT_CLOUD_TO_DEVICE    ( 0U )
+#define hubsubscribeCONTEXT_COMMAND            ( 1U )
+#define hubsubscribeCONTEXT_PROPERTIES         ( 2U )
+#define hubsubscribeSTATE_SUB                  ( 1U )
+#define hubsubscribeSTATE_SUBACK               ( 2U )
+
+/**
+ * @brief Most topic filters in the SUBSCRIBE of one feature.
+ */
+#define hubsubscribeMAX_FILTERS                ( 2U )
+
+static const char * const pcTopicNames[ eHubSubscribeTopicCount ] =
+{
+    "c2d",
+    "commands",
+    "properties"
+};
+
+static const uint32_t ulContextIndex[ eHubSubscribeTopicCount ] =
+{
+    hubsubscribeCONTEXT_CLOUD_TO_DEVICE,
+    hubsubscribeCONTEXT_COMMAND,
+    hubsubscribeCONTEXT_PROPERTIES
+};
+/*-----------------------------------------------------------*/
+
+static az_span prvTopicSpan( const AzureIoTMQTTPublishInfo_t * pxPublishInfo )
+{
+    return az_span_create( ( uint8_t * ) pxPublishInfo->pcTopicName, pxPublishInfo->usTopicNameLength );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Receive handler of cloud to device messages.
+ *
+ * @return eAzureIoTErrorTopicNotMatched to let the next handler try.
+ */
+static uint32_t prvProcessCloudToDevice( AzureIoTHubClientReceiveContext_t * pxContext,
+                                         AzureIoTHubClient_t * pxHubClient,
+                                         void * pvPublishInfo )
+{
+    AzureIoTMQTTPublishInfo_t * pxPublishInfo = ( AzureIoTMQTTPublishInfo_t * ) pvPublishInfo;
+    AzureIoTHubClientCloudToDeviceMessageRequest_t xMessage;
+    az_iot_hub_client_c2d_request xRequest;
+
+    if( az_result_failed( az_iot_hub_client_c2d_parse_received_topic( &pxHubClient->_internal.xAzureIoTHubClientCore,
+                                                                      prvTopicSpan( pxPublishInfo ), &xRequest ) ) )
+    {
+        return ( uint32_t ) eAzureIoTErrorTopicNotMatched;
+    }
+
+    memset( &xMessage, 0, sizeof( xMessage ) );
+    xMessage.pvMessagePayload = pxPublishInfo->pvPayload;
+    xMessage.ulPayloadLength = ( uint32_t ) pxPublishInfo->xPayloadLength;
+    xMessage.xProperties._internal.xProperties = xRequest.properties;
+
+    pxContext->_internal.callbacks.xCloudToDeviceMessageCallback( &xMessage, pxContext->_internal.pvCallbackContext );
+
+    return ( uint32_t ) eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Receive handler of commands.
+ *
+ * @return eAzureIoTErrorTopicNotMatched to let the next handler try.
+ */
+static uint32_t prvProcessCommand( AzureIoTHubClientReceiveContext_t * pxContext,
+                                   AzureIoTHubClient_t * pxHubClient,
+                                   void * pvPublishInfo )
+{
+    AzureIoTMQTTPublishInfo_t * pxPublishInfo = ( AzureIoTMQTTPublishInfo_t * ) pvPublishInfo;
+    AzureIoTHubClientCommandRequest_t xCommand;
+    az_iot_hub_client_command_request xRequest;
+
+    if( az_result_failed( az_iot_hub_client_commands_parse_received_topic( &pxHubClient->_internal.xAzureIoTHubClientCore,
+                                                                           prvTopicSpan( pxPublishInfo ), &xRequest ) ) )
+    {
+        return ( uint32_t ) eAzureIoTErrorTopicNotMatched;
+    }
+
+    memset( &xCommand, 0, sizeof( xCommand ) );
+    xCommand.pvMessagePayload = pxPublishInfo->pvPayload;
+    xCommand.ulPayloadLength = ( uint32_t ) pxPublishInfo->xPayloadLength;
+    xCommand.pucComponentName = az_span_ptr( xRequest.component_name );
+    xCommand.usComponentNameLength = ( uint16_t ) az_span_size( xRequest.component_name );
+    xCommand.pucCommandName = az_span_ptr( xRequest.command_name );
+    xCommand.usCommandNameLength = ( uint16_t ) az_span_size( xRequest.command_name );
+    xCommand.pucRequestID = az_span_ptr( xRequest.request_id );
+    xCommand.usRequestIDLength = ( uint16_t ) az_span_size( xRequest.request_id );
+
+    pxContext->_internal.callbacks.xCommandCallback( &xCommand, pxContext->_internal.pvCallbackContext );
+
+    return ( uint32_t ) eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Receive handler of property documents, updates and responses.
+ *
+ * @return eAzureIoTErrorTopicNotMatched to let the next handler try.
+ */
+static uint32_t prvProcessProperties( AzureIoTHubClientReceiveContext_t * pxContext,
+                                      AzureIoTHubClient_t * pxHubClient,
+                                      void * pvPublishInfo )
+{
+    AzureIoTMQTTPublishInfo_t * pxPublishInfo = ( AzureIoTMQTTPublishInfo_t * ) pvPublishInfo;
+    AzureIoTHubClientPropertiesResponse_t xResponse;
+    az_iot_hub_client_properties_message xMessage;
+
+    if( az_result_failed( az_iot_hub_client_properties_parse_received_topic( &pxHubClient->_internal.xAzureIoTHubClientCore,
+                                                                             prvTopicSpan( pxPublishInfo ), &xMessage ) ) )
+    {
+        return ( uint32_t ) eAzureIoTErrorTopicNotMatched;
+    }
+
+    memset( &xResponse, 0, sizeof( xResponse ) );
+    xResponse.pvMessagePayload = pxPublishInfo->pvPayload;
+    xResponse.ulPayloadLength = ( uint32_t ) pxPublishInfo->xPayloadLength;
+    xResponse.xMessageStatus = ( AzureIoTHubMessageStatus_t ) xMessage.status;
+
+    switch( xMessage.message_type )
+    {
+        case AZ_IOT_HUB_CLIENT_PROPERTIES_MESSAGE_TYPE_GET_RESPONSE:
+            xResponse.xMessageType = eAzureIoTHubPropertiesRequestedMessage;
+            break;
+
+        case AZ_IOT_HUB_CLIENT_PROPERTIES_MESSAGE_TYPE_WRITABLE_UPDATED:
+            xResponse.xMessageType = eAzureIoTHubPropertiesWritablePropertyMessage;
+            break;
+
+        default:
+            /* Responses to reported properties, and errors, which carry the
+             * status of the request. */
+            xResponse.xMessageType = eAzureIoTHubPropertiesReportedResponseMessage;
+            break;
+    }
+
+    if( ( az_span_size( xMessage.request_id ) > 0 ) &&
+        az_result_failed( az_span_atou32( xMessage.request_id, &xResponse.ulRequestID ) ) )
+    {
+        LogWarn( ( "Properties message with an invalid request id" ) );
+    }
+
+    pxContext->_internal.callbacks.xPropertiesCallback( &xResponse, pxContext->_internal.pvCallbackContext );
+
+    return ( uint32_t ) eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvIsRequested( const HubSubscriptions_t * pxSubscriptions,
+                            HubSubscribeTopic_t xTopic )
+{
+    switch( xTopic )
+    {
+        case eHubSubscribeCloudToDevice:
+            return pxSubscriptions->xCloudToDeviceMessageCallback != NULL;
+
+        case eHubSubscribeCommand:
+            return pxSubscriptions->xCommandCallback != NULL;
+
+        case eHubSubscribeProperties:
+            return pxSubscriptions->xPropertiesCallback != NULL;
+
+        default:
+            return false;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetFilter( AzureIoTMQTTSubscribeInfo_t * pxFilter,
+                          AzureIoTMQTTQoS_t xQoS,
+                          const char * pcTopicFilter,
+                          uint16_t usTopicFilterLength )
+{
+    pxFilter->xQoS = xQoS;
+    pxFilter->pcTopicFilter = ( const uint8_t * ) pcTopicFilter;
+    pxFilter->usTopicFilterLength = usTopicFilterLength;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the SUBSCRIBE of a feature and install its receive handler,
+ * without waiting for the SUBACK.
+ */
+static AzureIoTResult_t prvSendSubscribe( AzureIoTHubClient_t * pxHubClient,
+                                          const HubSubscriptions_t * pxSubscriptions,
+                                          HubSubscribeTopic_t xTopic )
+{
+    AzureIoTHubClientReceiveContext_t * pxContext = &pxHubClient->_internal.xReceiveContext[ ulContextIndex[ xTopic ] ];
+    AzureIoTMQTTSubscribeInfo_t xFilters[ hubsubscribeMAX_FILTERS ];
+    AzureIoTMQTTResult_t xMQTTResult;
+    uint32_t ulFilterCount = 1;
+    uint16_t usPacketID;
+
+    memset( xFilters, 0, sizeof( xFilters ) );
+    memset( pxContext, 0, sizeof( AzureIoTHubClientReceiveContext_t ) );
+
+    /* Filters and QoS of the subscribe functions of the middleware. */
+    switch( xTopic )
+    {
+        case eHubSubscribeCloudToDevice:
+            prvSetFilter( &xFilters[ 0 ], eAzureIoTMQTTQoS1, AZ_IOT_HUB_CLIENT_C2D_SUBSCRIBE_TOPIC,
+                          sizeof( AZ_IOT_HUB_CLIENT_C2D_SUBSCRIBE_TOPIC ) - 1 );
+            pxContext->_internal.pxProcessFunction = prvProcessCloudToDevice;
+            pxContext->_internal.callbacks.xCloudToDeviceMessageCallback = pxSubscriptions->xCloudToDeviceMessageCallback;
+            break;
+
+        case eHubSubscribeCommand:
+            prvSetFilter( &xFilters[ 0 ], eAzureIoTMQTTQoS0, AZ_IOT_HUB_CLIENT_COMMANDS_SUBSCRIBE_TOPIC,
+                          sizeof( AZ_IOT_HUB_CLIENT_COMMANDS_SUBSCRIBE_TOPIC ) - 1 );
+            pxContext->_internal.pxProcessFunction = prvProcessCommand;
+            pxContext->_internal.callbacks.xCommandCallback = pxSubscriptions->xCommandCallback;
+            break;
+
+        default:
+            prvSetFilter( &xFilters[ 0 ], eAzureIoTMQTTQoS0, AZ_IOT_HUB_CLIENT_PROPERTIES_MESSAGE_SUBSCRIBE_TOPIC,
+                          sizeof( AZ_IOT_HUB_CLIENT_PROPERTIES_MESSAGE_SUBSCRIBE_TOPIC ) - 1 );
+            prvSetFilter( &xFilters[ 1 ], eAzureIoTMQTTQoS0, AZ_IOT_HUB_CLIENT_PROPERTIES_RESPONSE_SUBSCRIBE_TOPIC,
+                          sizeof( AZ_IOT_HUB_CLIENT_PROPERTIES_RESPONSE_SUBSCRIBE_TOPIC ) - 1 );
+            ulFilterCount = 2;
+            pxContext->_internal.pxProcessFunction = prvProcessProperties;
+            pxContext->_internal.callbacks.xPropertiesCallback = pxSubscriptions->xPropertiesCallback;
+            break;
+    }
+
+    pxContext->_internal.pvCallbackContext = pxSubscriptions->pvCallbackContext;
+    usPacketID = AzureIoTMQTT_GetPacketId( &pxHubClient->_internal.xMQTTContext );
+
+    xMQTTResult = AzureIoTMQTT_Subscribe( &pxHubClient->_internal.xMQTTContext,
+                                          xFilters, ulFilterCount, usPacketID );
+
+    if( xMQTTResult != eAzureIoTMQTTSuccess )
+    {
+        LogError( ( "Failed to send the SUBSCRIBE of %s: MQTT error 0x%08x", pcTopicNames[ xTopic ], xMQTTResult ) );
+        memset( pxContext, 0, sizeof( AzureIoTHubClientReceiveContext_t ) );
+
+        return eAzureIoTErrorSubscribeFailed;
+    }
+
+    /* The SUBACK handler of the middleware moves the state on. */
+    pxContext->_internal.usMqttSubPacketID = usPacketID;
+    pxContext->_internal.usState = hubsubscribeSTATE_SUB;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t HubSubscribe_All( AzureIoTHubClient_t * pxHubClient,
+                                   const HubSubscriptions_t * pxSubscriptions,
+                                   HubSubscribeResult_t pxResults[ eHubSubscribeTopicCount ] )
+{
+    HubSubscribeResult_t xLocalResults[ eHubSubscribeTopicCount ];
+    AzureIoTHubClientReceiveContext_t * pxContext;
+    AzureIoTResult_t xFirstError = eAzureIoTSuccess;
+    AzureIoTResult_t xLoopResult = eAzureIoTSuccess;
+    TickType_t xStart;
+    TickType_t xDeadline;
+    TickType_t xElapsed;
+    TickType_t xWait;
+    uint32_t ulPending = 0;
+    int32_t lTopic;
+
+    if( ( pxHubClient == NULL ) || ( pxSubscriptions == NULL ) )
+    {
+        LogError( ( "HubSubscribe_All failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxResults == NULL )
+    {
+        pxResults = xLocalResults;
+    }
+
+    memset( pxResults, 0, sizeof( HubSubscribeResult_t ) * eHubSubscribeTopicCount );
+
+    xStart = xTaskGetTickCount();
+    xDeadline = pdMS_TO_TICKS( pxSubscriptions->ulSubscribeTimeoutMs );
+
+    /* Every SUBSCRIBE goes out before any SUBACK is awaited. */
+    for( lTopic = 0; lTopic < eHubSubscribeTopicCount; lTopic++ )
+    {
+        if( prvIsRequested( pxSubscriptions, ( HubSubscribeTopic_t ) lTopic ) )
+        {
+            pxResults[ lTopic ].xRequested = true;
+            pxResults[ lTopic ].xResult = prvSendSubscribe( pxHubClient, pxSubscriptions, ( HubSubscribeTopic_t ) lTopic );
+
+            if( pxResults[ lTopic ].xResult == eAzureIoTSuccess )
+            {
+                ulPending |= ( 1UL << lTopic );
+            }
+        }
+    }
+
+    while( ulPending != 0 )
+    {
+        for( lTopic = 0; lTopic < eHubSubscribeTopicCount; lTopic++ )
+        {
+            pxContext = &pxHubClient->_internal.xReceiveContext[ ulContextIndex[ lTopic ] ];
+
+            if( ( ( ulPending & ( 1UL << lTopic ) ) != 0 ) &&
+                ( pxContext->_internal.usState == hubsubscribeSTATE_SUBACK ) )
+            {
+                ulPending &= ~( 1UL << lTopic );
+                pxResults[ lTopic ].ulLatencyMs = ( uint32_t ) ( ( xTaskGetTickCount() - xStart ) * portTICK_PERIOD_MS );
+                LogDebug( ( "Subscribed to %s in %u ms", pcTopicNames[ lTopic ],
+                            ( unsigned ) pxResults[ lTopic ].ulLatencyMs ) );
+            }
+        }
+
+        xElapsed = xTaskGetTickCount() - xStart;
+
+        if( ( ulPending == 0 ) || ( xElapsed >= xDeadline ) )
+        {
+            break;
+        }
+
+        xWait = xDeadline - xElapsed;
+
+        if( xWait > pdMS_TO_TICKS( HUB_SUBSCRIBE_WAIT_INTERVAL_MS ) )
+        {
+            xWait = pdMS_TO_TICKS( HUB_SUBSCRIBE_WAIT_INTERVAL_MS );
+        }
+
+        if( ( xLoopResult = AzureIoTHubClient_ProcessLoop( pxHubClient,
+                                                           ( uint32_t ) ( xWait * portTICK_PERIOD_MS ) ) ) != eAzureIoTSuccess )
+        {
+            break;
+        }
+    }
+
+    for( lTopic = 0; lTopic < eHubSubscribeTopicCount; lTopic++ )
+    {
+        if( ( ulPending & ( 1UL << lTopic ) ) != 0 )
+        {
+            /* As the middleware does when its SUBACK wait fails. */
+            memset( &pxHubClient->_internal.xReceiveContext[ ulContextIndex[ lTopic ] ], 0,
+                    sizeof( AzureIoTHubClientReceiveContext_t ) );
+            pxResults[ lTopic ].xResult = ( xLoopResult != eAzureIoTSuccess ) ?
+                                          xLoopResult : eAzureIoTErrorSubackWaitTimeout;
+        }
+
+        if( pxResults[ lTopic ].xRequested && ( pxResults[ lTopic ].xResult != eAzureIoTSuccess ) )
+        {
+            LogError( ( "Subscribe to %s failed: result 0x%08x", pcTopicNames[ lTopic ],
+                        pxResults[ lTopic ].xResult ) );
+
+            if( xFirstError == eAzureIoTSuccess )
+            {
+                xFirstError = pxResults[ lTopic ].xResult;
+            }
+        }
+    }
+
+    LogInfo( ( "Subscriptions done in %u ms",
+               ( unsigned ) ( ( xTaskGetTickCount() - xStart ) * portTICK_PERIOD_MS ) ) );
+
+    return xFirstError;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,90 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_subscribe.h
+ * @brief Subscribe to the IoT Hub features of a device in one round trip.
+ *
+ * The SUBSCRIBE packets of all features go out back to back, then the
+ * SUBACKs are awaited together under a single deadline, so subscribing costs
+ * one round trip instead of one per feature. Each feature reports its own
+ * result and SUBACK latency, so a failed feature does not prevent the others
+ * from being subscribed.
+ *
+ * @note The subscribe functions of the middleware wait for the SUBACK before
+ * returning, so the packets are sent here through the MQTT client of the hub
+ * client, and the receive handler of each feature is installed in the hub
+ * client the way those functions do. The features remain unsubscribed with
+ * the middleware, AzureIoTHubClient_UnsubscribeCommand() for example.
+ */
+
+#ifndef HUB_SUBSCRIBE_H
+#define HUB_SUBSCRIBE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+/**
+ * @brief Process loop timeout while waiting for the SUBACKs.
+ */
+#ifndef HUB_SUBSCRIBE_WAIT_INTERVAL_MS
+    #define HUB_SUBSCRIBE_WAIT_INTERVAL_MS    ( 10U )
+#endif
+
+/**
+ * @brief Features which can be subscribed to.
+ */
+typedef enum HubSubscribeTopic
+{
+    eHubSubscribeCloudToDevice = 0,
+    eHubSubscribeCommand,
+    eHubSubscribeProperties,
+    eHubSubscribeTopicCount
+} HubSubscribeTopic_t;
+
+/**
+ * @brief Subscriptions of a device.
+ *
+ * Leave a callback NULL to not subscribe to that feature.
+ */
+typedef struct HubSubscriptions
+{
+    AzureIoTHubClientCloudToDeviceMessageCallback_t xCloudToDeviceMessageCallback; /**< @brief Cloud to device message callback. */
+    AzureIoTHubClientCommandCallback_t xCommandCallback;                           /**< @brief Command callback. */
+    AzureIoTHubClientPropertiesCallback_t xPropertiesCallback;                     /**< @brief Properties callback. */
+    void * pvCallbackContext;                                                      /**< @brief Context passed to every callback. */
+    uint32_t ulSubscribeTimeoutMs;                                                 /**< @brief Deadline for all SUBACKs together. */
+} HubSubscriptions_t;
+
+/**
+ * @brief Outcome of one subscription.
+ */
+typedef struct HubSubscribeResult
+{
+    bool xRequested;           /**< @brief A callback was given for this feature. */
+    AzureIoTResult_t xResult;  /**< @brief Result of the subscription, if requested. */
+    uint32_t ulLatencyMs;      /**< @brief Time from SUBSCRIBE to SUBACK, if successful. */
+} HubSubscribeResult_t;
+
+/**
+ * @brief Subscribe to every feature with a callback in @p pxSubscriptions.
+ *
+ * Sends a SUBSCRIBE for each feature without waiting, then runs the process
+ * loop until every SUBACK arrived or the deadline passed. A feature whose
+ * SUBACK did not arrive in time has its receive handler removed again.
+ *
+ * @param[in] pxHubClient Connected hub client.
+ * @param[in] pxSubscriptions Features to subscribe to.
+ * @param[out] pxResults Per feature results, indexed by #HubSubscribeTopic_t.
+ * May be NULL.
+ * @return eAzureIoTSuccess if every requested subscription succeeded, else the
+ * result of the first one that failed.
+ */
+AzureIoTResult_t HubSubscribe_All( AzureIoTHubClient_t * pxHubClient,
+                                   const HubSubscriptions_t * pxSubscriptions,
+                                   HubSubscribeResult_t pxResults[ eHubSubscribeTopicCount ] );
+
+#endif /* HUB_SUBSCRIBE_H */
@@ -0,0 +1,415 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_trace.c
+ * @brief End to end latency tracing of telemetry and commands.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+#include "clock_service.h"
+#include "hub_trace.h"
+
+/*-----------------------------------------------------------*/
+
+#define hubtraceCORRELATION_ID_PROPERTY    "$.cid"
+#define hubtraceCREATION_TIME_PROPERTY     "$.ctime"
+
+/* ISO 8601 UTC with milliseconds, the colons URL encoded for the topic. */
+#define hubtraceCREATION_TIME_FORMAT       "%04u-%02u-%02uT%02u%%3A%02u%%3A%02u.%03uZ"
+#define hubtraceCREATION_TIME_SIZE         ( sizeof( "2023-01-15T08%3A00%3A00.000Z" ) )
+
+#define hubtraceCORRELATION_ID_SIZE        ( sizeof( "ffffffff-4294967295" ) )
+
+/* Parts of the JSON, a span n is part 1 + n. */
+#define hubtracePART_HEADER                ( 0U )
+#define hubtracePART_END                   ( eHubTraceSpanCount + 1U )
+#define hubtracePART_DONE                  ( eHubTraceSpanCount + 2U )
+
+/**
+ * @brief JSON names of the spans, in #HubTraceSpan_t order.
+ */
+static const char * const pcSpanNames[ eHubTraceSpanCount ] =
+{
+    "telemetryEnqueue",
+    "telemetrySend",
+    "telemetryAck",
+    "telemetryTotal",
+    "commandDispatch",
+    "commandHandler",
+    "commandResponse",
+    "commandTotal",
+    "connect"
+};
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Add the spans of a record, from the first point of @p xFirstSpan.
+ */
+static void prvRecordSpans( HubTrace_t * pxTrace,
+                            const HubTraceRecord_t * pxRecord,
+                            HubTraceSpan_t xFirstSpan )
+{
+    uint32_t ulPoint;
+    uint32_t ulLast = 0;
+
+    if( pxRecord->ullPointsUs[ 0 ] == 0 )
+    {
+        return;
+    }
+
+    for( ulPoint = 1; ulPoint < HUB_TRACE_POINTS; ulPoint++ )
+    {
+        if( pxRecord->ullPointsUs[ ulPoint ] == 0 )
+        {
+            /* Later points may be missing, e.g. no PUBACK without QoS1 tracking. */
+            continue;
+        }
+
+        if( ( pxRecord->ullPointsUs[ ulPoint - 1 ] != 0 ) &&
+            ( pxRecord->ullPointsUs[ ulPoint ] >= pxRecord->ullPointsUs[ ulPoint - 1 ] ) )
+        {
+            LatencyHistogram_Record( &pxTrace->xHistograms[ xFirstSpan + ulPoint - 1 ],
+                                     pxRecord->ullPointsUs[ ulPoint ] - pxRecord->ullPointsUs[ ulPoint - 1 ] );
+        }
+
+        ulLast = ulPoint;
+    }
+
+    if( ( ulLast != 0 ) && ( pxRecord->ullPointsUs[ ulLast ] >= pxRecord->ullPointsUs[ 0 ] ) )
+    {
+        LatencyHistogram_Record( &pxTrace->xHistograms[ xFirstSpan + HUB_TRACE_POINTS - 1 ],
+                                 pxRecord->ullPointsUs[ ulLast ] - pxRecord->ullPointsUs[ 0 ] );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvFormatCreationTime( uint64_t ullUnixTimeMs,
+                                       char * pcBuffer,
+                                       uint32_t ulBufferSize )
+{
+    uint32_t ulDays = ( uint32_t ) ( ullUnixTimeMs / 86400000U );
+    uint32_t ulDayMs = ( uint32_t ) ( ullUnixTimeMs % 86400000U );
+    uint32_t ulDayOfEra, ulYearOfEra, ulDayOfYear, ulMonthIndex;
+    uint32_t ulEra, ulYear, ulMonth, ulDay;
+    int lLength;
+
+    /* Civil date from days since 1970-01-01, eras of 400 years starting on March 1st. */
+    ulDays += 719468U;
+    ulEra = ulDays / 146097U;
+    ulDayOfEra = ulDays - ulEra * 146097U;
+    ulYearOfEra = ( ulDayOfEra - ulDayOfEra / 1460U + ulDayOfEra / 36524U - ulDayOfEra / 146096U ) / 365U;
+    ulDayOfYear = ulDayOfEra - ( 365U * ulYearOfEra + ulYearOfEra / 4U - ulYearOfEra / 100U );
+    ulMonthIndex = ( 5U * ulDayOfYear + 2U ) / 153U;
+    ulDay = ulDayOfYear - ( 153U * ulMonthIndex + 2U ) / 5U + 1U;
+    ulMonth = ( ulMonthIndex < 10U ) ? ulMonthIndex + 3U : ulMonthIndex - 9U;
+    ulYear = ulYearOfEra + ulEra * 400U + ( ( ulMonth <= 2U ) ? 1U : 0U );
+
+    lLength = snprintf( pcBuffer, ulBufferSize, hubtraceCREATION_TIME_FORMAT,
+                        ( unsigned ) ulYear, ( unsigned ) ulMonth, ( unsigned ) ulDay,
+                        ( unsigned ) ( ulDayMs / 3600000U ), ( unsigned ) ( ulDayMs / 60000U % 60U ),
+                        ( unsigned ) ( ulDayMs / 1000U % 60U ), ( unsigned ) ( ulDayMs % 1000U ) );
+
+    return ( ( lLength > 0 ) && ( ( uint32_t ) lLength < ulBufferSize ) ) ? ( uint32_t ) lLength : 0;
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_Init( HubTrace_t * pxTrace )
+{
+    if( pxTrace != NULL )
+    {
+        memset( pxTrace, 0, sizeof( HubTrace_t ) );
+        pxTrace->ulBootID = ( uint32_t ) ( Clock_GetUnixTimeMs() / 1000U );
+        pxTrace->ulNextCorrelationID = 1;
+        pxTrace->ullIntervalStartUs = Clock_GetMonotonicUs();
+    }
+}
+/*-----------------------------------------------------------*/
+
+HubTraceRecord_t * HubTrace_TelemetryStart( HubTrace_t * pxTrace,
+                                            AzureIoTMessageProperties_t * pxProperties )
+{
+    HubTraceRecord_t * pxRecord = NULL;
+    char cCorrelationID[ hubtraceCORRELATION_ID_SIZE ];
+    char cCreationTime[ hubtraceCREATION_TIME_SIZE ];
+    uint32_t ulLength;
+    uint32_t ulIndex;
+    int lLength;
+
+    if( pxTrace == NULL )
+    {
+        return NULL;
+    }
+
+    for( ulIndex = 0; ulIndex < HUB_TRACE_MAX_TELEMETRY; ulIndex++ )
+    {
+        if( !pxTrace->xTelemetry[ ulIndex ].xInUse )
+        {
+            pxRecord = &pxTrace->xTelemetry[ ulIndex ];
+            break;
+        }
+    }
+
+    if( pxRecord == NULL )
+    {
+        pxTrace->ulUntraced++;
+        return NULL;
+    }
+
+    memset( pxRecord, 0, sizeof( HubTraceRecord_t ) );
+    pxRecord->xInUse = true;
+    pxRecord->ulCorrelationID = pxTrace->ulNextCorrelationID++;
+    pxRecord->ullPointsUs[ eHubTraceCreate ] = Clock_GetMonotonicUs();
+
+    if( pxProperties != NULL )
+    {
+        lLength = snprintf( cCorrelationID, sizeof( cCorrelationID ), "%08x-%u",
+                            ( unsigned ) pxTrace->ulBootID, ( unsigned ) pxRecord->ulCorrelationID );
+
+        /* The message is still sent when the property buffer is too small. */
+        if( lLength > 0 )
+        {
+            ( void ) AzureIoTMessage_PropertiesAppend( pxProperties,
+                                                       ( const uint8_t * ) hubtraceCORRELATION_ID_PROPERTY,
+                                                       sizeof( hubtraceCORRELATION_ID_PROPERTY ) - 1,
+                                                       ( const uint8_t * ) cCorrelationID, ( uint32_t ) lLength );
+        }
+
+        if( ( ulLength = prvFormatCreationTime( Clock_GetUnixTimeMs(), cCreationTime, sizeof( cCreationTime ) ) ) > 0 )
+        {
+            ( void ) AzureIoTMessage_PropertiesAppend( pxProperties,
+                                                       ( const uint8_t * ) hubtraceCREATION_TIME_PROPERTY,
+                                                       sizeof( hubtraceCREATION_TIME_PROPERTY ) - 1,
+                                                       ( const uint8_t * ) cCreationTime, ulLength );
+        }
+    }
+
+    return pxRecord;
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_Mark( HubTraceRecord_t * pxRecord,
+                    uint32_t ulPoint )
+{
+    if( ( pxRecord != NULL ) && ( ulPoint < HUB_TRACE_POINTS ) )
+    {
+        pxRecord->ullPointsUs[ ulPoint ] = Clock_GetMonotonicUs();
+    }
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_TelemetryEnd( HubTrace_t * pxTrace,
+                            HubTraceRecord_t * pxRecord )
+{
+    if( ( pxTrace != NULL ) && ( pxRecord != NULL ) && pxRecord->xInUse )
+    {
+        prvRecordSpans( pxTrace, pxRecord, eHubTraceTelemetryEnqueue );
+        pxRecord->xInUse = false;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_CommandStart( HubTraceRecord_t * pxRecord )
+{
+    if( pxRecord != NULL )
+    {
+        memset( pxRecord, 0, sizeof( HubTraceRecord_t ) );
+        pxRecord->xInUse = true;
+        pxRecord->ullPointsUs[ eHubTraceArrival ] = Clock_GetMonotonicUs();
+    }
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_CommandEnd( HubTrace_t * pxTrace,
+                          const HubTraceRecord_t * pxRecord )
+{
+    if( ( pxTrace != NULL ) && ( pxRecord != NULL ) )
+    {
+        prvRecordSpans( pxTrace, pxRecord, eHubTraceCommandDispatch );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_AddLatency( HubTrace_t * pxTrace,
+                          HubTraceSpan_t xSpan,
+                          uint64_t ullLatencyUs )
+{
+    if( ( pxTrace != NULL ) && ( xSpan < eHubTraceSpanCount ) )
+    {
+        LatencyHistogram_Record( &pxTrace->xHistograms[ xSpan ], ullLatencyUs );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_Snapshot( HubTrace_t * pxTrace,
+                        HubTraceSnapshot_t * pxSnapshot )
+{
+    /* Not on the stack of the caller, a histogram takes 1.5 KB. Snapshots
+     * are taken by the task running the process loop only. */
+    static LatencyHistogram_t xInterval;
+    uint64_t ullNowUs;
+    uint32_t ulSpan;
+
+    if( ( pxTrace == NULL ) || ( pxSnapshot == NULL ) )
+    {
+        return;
+    }
+
+    ullNowUs = Clock_GetMonotonicUs();
+
+    if( pxSnapshot->ullIntervalEndUs == 0 )
+    {
+        pxSnapshot->ullIntervalStartUs = pxTrace->ullIntervalStartUs;
+    }
+
+    /* Moved out one span at a time, a record ending on another task in
+     * between is counted in this interval or the next, never torn. */
+    for( ulSpan = 0; ulSpan < eHubTraceSpanCount; ulSpan++ )
+    {
+        LatencyHistogram_Snapshot( &pxTrace->xHistograms[ ulSpan ], &xInterval );
+        LatencyHistogram_Merge( &pxSnapshot->xHistograms[ ulSpan ], &xInterval );
+    }
+
+    pxSnapshot->ullIntervalEndUs = ullNowUs;
+    pxSnapshot->ulUntraced += pxTrace->ulUntraced;
+    pxTrace->ulUntraced = 0;
+    pxTrace->ullIntervalStartUs = ullNowUs;
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_SnapshotClear( HubTraceSnapshot_t * pxSnapshot )
+{
+    if( pxSnapshot != NULL )
+    {
+        memset( pxSnapshot, 0, sizeof( HubTraceSnapshot_t ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t HubTrace_Serialize( const HubTraceSnapshot_t * pxSnapshot,
+                             uint8_t * pucBuffer,
+                             uint32_t ulBufferSize )
+{
+    HubTraceCursor_t xCursor;
+    int32_t lLength;
+
+    if( ( pxSnapshot == NULL ) || ( pucBuffer == NULL ) )
+    {
+        return 0;
+    }
+
+    HubTrace_CursorInit( &xCursor, pxSnapshot );
+    lLength = HubTrace_SerializePart( &xCursor, pucBuffer, ulBufferSize );
+
+    return ( xCursor.ulPart == hubtracePART_DONE ) ? ( uint32_t ) lLength : 0;
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_CursorInit( HubTraceCursor_t * pxCursor,
+                          const HubTraceSnapshot_t * pxSnapshot )
+{
+    pxCursor->pxSnapshot = pxSnapshot;
+    HubTrace_CursorRewind( pxCursor );
+}
+/*-----------------------------------------------------------*/
+
+void HubTrace_CursorRewind( HubTraceCursor_t * pxCursor )
+{
+    pxCursor->ulPart = hubtracePART_HEADER;
+    pxCursor->ulHistogramCursor = LATENCY_HISTOGRAM_CURSOR_START;
+}
+/*-----------------------------------------------------------*/
+
+int32_t HubTrace_SerializePart( HubTraceCursor_t * pxCursor,
+                                uint8_t * pucBuffer,
+                                uint32_t ulBufferSize )
+{
+    const LatencyHistogram_t * pxHistogram;
+    char * pcBuffer = ( char * ) pucBuffer;
+    uint32_t ulLength = 0;
+    uint32_t ulSpanStart;
+    int32_t lHistogramLength;
+    int lLength;
+
+    while( pxCursor->ulPart != hubtracePART_DONE )
+    {
+        if( pxCursor->ulPart == hubtracePART_HEADER )
+        {
+            lLength = snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength,
+                                "{\"latencyTrace\":{\"unit\":\"us\",\"intervalMs\":%u,\"untraced\":%u",
+                                ( unsigned ) ( ( pxCursor->pxSnapshot->ullIntervalEndUs -
+                                                 pxCursor->pxSnapshot->ullIntervalStartUs ) / 1000U ),
+                                ( unsigned ) pxCursor->pxSnapshot->ulUntraced );
+        }
+        else if( pxCursor->ulPart == hubtracePART_END )
+        {
+            lLength = snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "}}" );
+        }
+        else
+        {
+            pxHistogram = &pxCursor->pxSnapshot->xHistograms[ pxCursor->ulPart - 1U ];
+
+            if( LatencyHistogram_Count( pxHistogram ) == 0 )
+            {
+                pxCursor->ulPart++;
+                continue;
+            }
+
+            ulSpanStart = ulLength;
+
+            /* The name goes with the first part of its histogram. */
+            if( pxCursor->ulHistogramCursor == LATENCY_HISTOGRAM_CURSOR_START )
+            {
+                lLength = snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, ",\"%s\":",
+                                    pcSpanNames[ pxCursor->ulPart - 1U ] );
+
+                if( ( lLength <= 0 ) || ( ( uint32_t ) lLength >= ulBufferSize - ulLength ) )
+                {
+                    break;
+                }
+
+                ulLength += ( uint32_t ) lLength;
+            }
+
+            lHistogramLength = LatencyHistogram_SerializePart( pxHistogram, &pxCursor->ulHistogramCursor,
+                                                               &pcBuffer[ ulLength ], ulBufferSize - ulLength );
+
+            if( lHistogramLength < 0 )
+            {
+                ulLength = ulSpanStart;
+                break;
+            }
+
+            ulLength += ( uint32_t ) lHistogramLength;
+
+            if( pxCursor->ulHistogramCursor != LATENCY_HISTOGRAM_CURSOR_DONE )
+            {
+                break;
+            }
+
+            pxCursor->ulHistogramCursor = LATENCY_HISTOGRAM_CURSOR_START;
+            pxCursor->ulPart++;
+            continue;
+        }
+
+        if( ( lLength <= 0 ) || ( ( uint32_t ) lLength >= ulBufferSize - ulLength ) )
+        {
+            break;
+        }
+
+        ulLength += ( uint32_t ) lLength;
+        pxCursor->ulPart++;
+    }
+
+    if( ( ulLength == 0 ) && ( pxCursor->ulPart != hubtracePART_DONE ) )
+    {
+        return -1;
+    }
+
+    return ( int32_t ) ulLength;
+}
+/*-----------------------------------------------------------*/
+
@@ -0,0 +1,272 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file hub_trace.h
+ * @brief End to end latency tracing of telemetry and commands.
+ *
+ * A trace record holds the monotonic time of each point a message went
+ * through. Telemetry records are taken from a fixed pool when the message is
+ * created, which also tags the message with the IoT Hub correlation-id
+ * ("$.cid") and creation time ("$.ctime") system properties so the cloud
+ * side can join its own timestamps. Command records live on the stack of the
+ * command callback.
+ *
+ * When a record ends, the time between consecutive points and the end to
+ * end time are added to the latency histograms of latency_histogram.h, as
+ * are the latencies given to #HubTrace_AddLatency. #HubTrace_Snapshot moves
+ * them to a snapshot and starts the next interval, #HubTrace_Serialize turns
+ * the snapshot into a JSON telemetry message.
+ *
+ * Records can end and latencies be added from any task, the histograms are
+ * lock free. The other functions are for the task running the hub client
+ * process loop.
+ */
+
+#ifndef HUB_TRACE_H
+#define HUB_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+#include "latency_histogram.h"
+
+/**
+ * @brief Telemetry messages which can be traced at the same time.
+ */
+#ifndef HUB_TRACE_MAX_TELEMETRY
+    #define HUB_TRACE_MAX_TELEMETRY        ( 8U )
+#endif
+
+/**
+ * @brief Buffer size needed for the properties added by #HubTrace_TelemetryStart.
+ */
+#define HUB_TRACE_PROPERTIES_SIZE          ( 72U )
+
+/**
+ * @brief Points of a telemetry message.
+ */
+typedef enum HubTraceTelemetryPoint
+{
+    eHubTraceCreate = 0,     /**< Payload built. */
+    eHubTraceEnqueue,        /**< Handed to the publish path. */
+    eHubTraceSendComplete,   /**< Written to the transport. */
+    eHubTracePuback          /**< PUBACK processed. */
+} HubTraceTelemetryPoint_t;
+
+/**
+ * @brief Points of a command.
+ */
+typedef enum HubTraceCommandPoint
+{
+    eHubTraceArrival = 0,    /**< Command callback entered. */
+    eHubTraceHandlerStart,   /**< Application handler started. */
+    eHubTraceHandlerEnd,     /**< Application handler returned. */
+    eHubTraceResponse        /**< Response sent. */
+} HubTraceCommandPoint_t;
+
+#define HUB_TRACE_POINTS    ( 4U )
+
+/**
+ * @brief Latencies between points, one histogram each.
+ */
+typedef enum HubTraceSpan
+{
+    eHubTraceTelemetryEnqueue = 0, /**< Create to enqueue. */
+    eHubTraceTelemetrySend,        /**< Enqueue to send complete. */
+    eHubTraceTelemetryAck,         /**< Send complete to PUBACK. */
+    eHubTraceTelemetryTotal,       /**< Create to PUBACK, or to the last point reached. */
+    eHubTraceCommandDispatch,      /**< Arrival to handler start. */
+    eHubTraceCommandHandler,       /**< Handler start to end. */
+    eHubTraceCommandResponse,      /**< Handler end to response. */
+    eHubTraceCommandTotal,         /**< Arrival to response. */
+    eHubTraceConnect,              /**< Network connection, DNS, TCP and TLS, with its retries. */
+    eHubTraceSpanCount
+} HubTraceSpan_t;
+
+/**
+ * @brief Times of one message, 0 for points not reached.
+ */
+typedef struct HubTraceRecord
+{
+    bool xInUse;
+    uint32_t ulCorrelationID;
+    uint64_t ullPointsUs[ HUB_TRACE_POINTS ];
+} HubTraceRecord_t;
+
+/**
+ * @brief Tracer for one hub client.
+ */
+typedef struct HubTrace
+{
+    uint32_t ulBootID;                                        /**< @brief Correlation ID prefix, unique per boot. */
+    uint32_t ulNextCorrelationID;
+    uint32_t ulUntraced;                                      /**< @brief Messages sent without a free record. */
+    uint64_t ullIntervalStartUs;
+    HubTraceRecord_t xTelemetry[ HUB_TRACE_MAX_TELEMETRY ];
+    LatencyHistogram_t xHistograms[ eHubTraceSpanCount ];
+} HubTrace_t;
+
+/**
+ * @brief Histograms of one or more intervals, taken from a tracer.
+ */
+typedef struct HubTraceSnapshot
+{
+    uint64_t ullIntervalStartUs;                              /**< @brief Start of the first interval held. */
+    uint64_t ullIntervalEndUs;                                /**< @brief End of the last interval held, 0 if empty. */
+    uint32_t ulUntraced;
+    LatencyHistogram_t xHistograms[ eHubTraceSpanCount ];
+} HubTraceSnapshot_t;
+
+/**
+ * @brief Initialize a tracer.
+ *
+ * @param[out] pxTrace Tracer to initialize.
+ */
+void HubTrace_Init( HubTrace_t * pxTrace );
+
+/**
+ * @brief Start tracing a telemetry message.
+ *
+ * Marks #eHubTraceCreate and appends the correlation-id and creation time
+ * properties, which need #HUB_TRACE_PROPERTIES_SIZE bytes of the property
+ * buffer.
+ *
+ * @param[in] pxTrace Tracer.
+ * @param[in] pxProperties Properties of the message, may be NULL.
+ * @return The record, or NULL if every record is in use.
+ */
+HubTraceRecord_t * HubTrace_TelemetryStart( HubTrace_t * pxTrace,
+                                            AzureIoTMessageProperties_t * pxProperties );
+
+/**
+ * @brief Record that a message reached a point.
+ *
+ * @param[in] pxRecord Record, may be NULL.
+ * @param[in] ulPoint A #HubTraceTelemetryPoint_t or #HubTraceCommandPoint_t.
+ */
+void HubTrace_Mark( HubTraceRecord_t * pxRecord,
+                    uint32_t ulPoint );
+
+/**
+ * @brief Add a telemetry record to the histograms and release it.
+ *
+ * @param[in] pxTrace Tracer.
+ * @param[in] pxRecord Record from #HubTrace_TelemetryStart, may be NULL.
+ */
+void HubTrace_TelemetryEnd( HubTrace_t * pxTrace,
+                            HubTraceRecord_t * pxRecord );
+
+/**
+ * @brief Start tracing a command, marking #eHubTraceArrival.
+ *
+ * @param[out] pxRecord Record owned by the caller.
+ */
+void HubTrace_CommandStart( HubTraceRecord_t * pxRecord );
+
+/**
+ * @brief Add a command record to the histograms.
+ *
+ * @param[in] pxTrace Tracer.
+ * @param[in] pxRecord Record from #HubTrace_CommandStart.
+ */
+void HubTrace_CommandEnd( HubTrace_t * pxTrace,
+                          const HubTraceRecord_t * pxRecord );
+
+/**
+ * @brief Add a latency measured by the caller, for spans without points.
+ *
+ * @param[in] pxTrace Tracer.
+ * @param[in] xSpan Span, #eHubTraceConnect.
+ * @param[in] ullLatencyUs Latency in microseconds.
+ */
+void HubTrace_AddLatency( HubTrace_t * pxTrace,
+                          HubTraceSpan_t xSpan,
+                          uint64_t ullLatencyUs );
+
+/**
+ * @brief End the current interval, adding its histograms to a snapshot, and
+ * start the next.
+ *
+ * Latencies recorded at the same time end up in the snapshot or in the next
+ * interval, none are lost. A snapshot which could not be sent can be kept
+ * and taken into again, it then covers both intervals.
+ *
+ * @param[in] pxTrace Tracer.
+ * @param[in,out] pxSnapshot Snapshot, cleared by #HubTrace_SnapshotClear or
+ * holding earlier intervals.
+ */
+void HubTrace_Snapshot( HubTrace_t * pxTrace,
+                        HubTraceSnapshot_t * pxSnapshot );
+
+/**
+ * @brief Empty a snapshot, once it has been sent.
+ *
+ * @param[out] pxSnapshot Snapshot.
+ */
+void HubTrace_SnapshotClear( HubTraceSnapshot_t * pxSnapshot );
+
+/**
+ * @brief Write a snapshot as a JSON object.
+ *
+ * Spans without samples are left out, the others are written by
+ * #LatencyHistogram_Serialize.
+ *
+ * @param[in] pxSnapshot Snapshot.
+ * @param[out] pucBuffer Buffer for the JSON.
+ * @param[in] ulBufferSize Size of @p pucBuffer.
+ * @return Length of the JSON, 0 if it did not fit.
+ */
+uint32_t HubTrace_Serialize( const HubTraceSnapshot_t * pxSnapshot,
+                             uint8_t * pucBuffer,
+                             uint32_t ulBufferSize );
+
+/**
+ * @brief Position in the JSON of #HubTrace_Serialize, to write it in parts.
+ */
+typedef struct HubTraceCursor
+{
+    const HubTraceSnapshot_t * pxSnapshot;
+    uint32_t ulPart;            /**< @brief Header, spans, then end. */
+    uint32_t ulHistogramCursor; /**< @brief Position in the histogram of the span. */
+} HubTraceCursor_t;
+
+/**
+ * @brief Start writing the JSON of a snapshot in parts.
+ *
+ * Every run from the start writes the same bytes as long as the snapshot is
+ * unchanged.
+ *
+ * @param[out] pxCursor Cursor.
+ * @param[in] pxSnapshot Snapshot.
+ */
+void HubTrace_CursorInit( HubTraceCursor_t * pxCursor,
+                          const HubTraceSnapshot_t * pxSnapshot );
+
+/**
+ * @brief Go back to the start of the JSON.
+ *
+ * @param[in] pxCursor Cursor.
+ */
+void HubTrace_CursorRewind( HubTraceCursor_t * pxCursor );
+
+/**
+ * @brief Write the next parts of the JSON of #HubTrace_Serialize, as many as
+ * fit in the buffer.
+ *
+ * A part is at most the name of a span and the fields of its histogram,
+ * about 130 bytes, see #LatencyHistogram_SerializePart.
+ *
+ * @param[in] pxCursor Cursor.
+ * @param[out] pucBuffer Buffer for the parts.
+ * @param[in] ulBufferSize Size of @p pucBuffer.
+ * @return Length written, 0 when done, or -1 if the next part does not fit.
+ */
+int32_t HubTrace_SerializePart( HubTraceCursor_t * pxCursor,
+                                uint8_t * pucBuffer,
+                                uint32_t ulBufferSize );
+
+#endif /* HUB_TRACE_H */
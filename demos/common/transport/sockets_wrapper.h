@@ -42,6 +42,31 @@ typedef void * SocketHandle;
 #define SOCKETS_SO_RCVTIMEO         ( 0 )          /**< Set the receive timeout. */
 #define SOCKETS_SO_SNDTIMEO         ( 1 )          /**< Set the send timeout. */
 
+/**
+ * @brief Layer between a socket and the transport using it, to emulate a
+ * network link for example.
+ *
+ * The functions take the place of Sockets_Connect, Sockets_Send and
+ * Sockets_Recv, with the same parameters and results, and call them on the
+ * socket. The transport passes @p pvContext as their first parameter.
+ */
+typedef struct SocketsInterposer
+{
+    void * pvContext;
+    BaseType_t ( * xConnect )( void * pvContext,
+                               SocketHandle xSocket,
+                               const char * pcHostName,
+                               uint16_t usPort );
+    BaseType_t ( * xSend )( void * pvContext,
+                            SocketHandle xSocket,
+                            const uint8_t * pucData,
+                            size_t xDataLength );
+    BaseType_t ( * xRecv )( void * pvContext,
+                            SocketHandle xSocket,
+                            uint8_t * pucReceiveBuffer,
+                            size_t xReceiveBufferLength );
+} SocketsInterposer_t;
+
 /**
  * @brief Initialize the sockets
  *
@@ -28,6 +28,14 @@
 /* A negative error code indicating a network failure. */
 #define FREERTOS_SOCKETS_WRAPPER_NETWORK_ERROR    ( -1 )
 
+/* Spans of the trace recorder, see trace_recorder_hooks.h. */
+#ifndef traceSPAN_BEGIN
+    #define traceSPAN_BEGIN( pcName )
+#endif
+#ifndef traceSPAN_END
+    #define traceSPAN_END( pcName )
+#endif
+
 /*-----------------------------------------------------------*/
 
 BaseType_t Sockets_Init()
@@ -75,6 +83,8 @@ BaseType_t Sockets_Connect( SocketHandle xSocket,
     struct freertos_sockaddr xServerAddress = { 0 };
     uint32_t ulIPAddres;
 
+    traceSPAN_BEGIN( "Sockets_Connect" );
+
     /* Check for errors from DNS lookup. */
     if( ( ulIPAddres = ( uint32_t ) FreeRTOS_gethostbyname( pcHostName ) ) == 0 )
     {
@@ -94,6 +104,8 @@ BaseType_t Sockets_Connect( SocketHandle xSocket,
         }
     }
 
+    traceSPAN_END( "Sockets_Connect" );
+
     return lRetVal;
 }
 /*-----------------------------------------------------------*/
@@ -104,6 +116,8 @@ void Sockets_Disconnect( SocketHandle xSocket )
     uint8_t pucDummyBuffer[ 2 ];
     Socket_t xTcpSocket = ( Socket_t ) xSocket;
 
+    traceSPAN_BEGIN( "Sockets_Disconnect" );
+
     if( xTcpSocket != FREERTOS_INVALID_SOCKET )
     {
         /* Initiate graceful shutdown. */
@@ -121,6 +135,8 @@ void Sockets_Disconnect( SocketHandle xSocket )
             }
         }
     }
+
+    traceSPAN_END( "Sockets_Disconnect" );
 }
 /*-----------------------------------------------------------*/
 
@@ -128,8 +144,14 @@ BaseType_t Sockets_Recv( SocketHandle xSocket,
                          uint8_t * pucReceiveBuffer,
                          size_t xReceiveBufferLength )
 {
-    return ( BaseType_t ) FreeRTOS_recv( ( Socket_t ) xSocket,
-                                         pucReceiveBuffer, xReceiveBufferLength, 0 );
+    BaseType_t xResult;
+
+    traceSPAN_BEGIN( "Sockets_Recv" );
+    xResult = ( BaseType_t ) FreeRTOS_recv( ( Socket_t ) xSocket,
+                                            pucReceiveBuffer, xReceiveBufferLength, 0 );
+    traceSPAN_END( "Sockets_Recv" );
+
+    return xResult;
 }
 /*-----------------------------------------------------------*/
 
@@ -137,8 +159,14 @@ BaseType_t Sockets_Send( SocketHandle xSocket,
                          const uint8_t * pucData,
                          size_t xDataLength )
 {
-    return ( BaseType_t ) FreeRTOS_send( ( Socket_t ) xSocket,
-                                         pucData, xDataLength, 0 );
+    BaseType_t xResult;
+
+    traceSPAN_BEGIN( "Sockets_Send" );
+    xResult = ( BaseType_t ) FreeRTOS_send( ( Socket_t ) xSocket,
+                                            pucData, xDataLength, 0 );
+    traceSPAN_END( "Sockets_Send" );
+
+    return xResult;
 }
 /*-----------------------------------------------------------*/
 
@@ -0,0 +1,160 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_capture.c
+ * @brief Transport decorator recording the plaintext of a session.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+#include "transport_capture.h"
+
+/* Monotonic clock header. */
+#include "clock_service.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Longest record header: type, time and length varints.
+ */
+#define captureMAX_HEADER_LENGTH    ( 1U + 10U + 10U )
+/*-----------------------------------------------------------*/
+
+static size_t prvEncodeVarint( uint8_t * pucOutput,
+                               uint64_t ullValue )
+{
+    size_t xLength = 0;
+
+    do
+    {
+        pucOutput[ xLength ] = ( uint8_t ) ( ullValue & 0x7FU );
+        ullValue >>= 7;
+
+        if( ullValue != 0 )
+        {
+            pucOutput[ xLength ] |= 0x80U;
+        }
+
+        xLength++;
+    } while( ullValue != 0 );
+
+    return xLength;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecord( CaptureTransport_t * pxCapture,
+                       uint8_t ucType,
+                       const uint8_t * pucData,
+                       size_t xLength )
+{
+    uint8_t ucHeader[ captureMAX_HEADER_LENGTH ];
+    size_t xHeaderLength = 0;
+    uint64_t ullNowUs = Clock_GetMonotonicUs();
+
+    ucHeader[ xHeaderLength++ ] = ucType;
+    xHeaderLength += prvEncodeVarint( &ucHeader[ xHeaderLength ], ullNowUs - pxCapture->ullLastRecordUs );
+    pxCapture->ullLastRecordUs = ullNowUs;
+
+    if( ucType != captureRECORD_CONNECT )
+    {
+        xHeaderLength += prvEncodeVarint( &ucHeader[ xHeaderLength ], xLength );
+    }
+
+    pxCapture->xWrite( pxCapture->pvWriteContext, ucHeader, xHeaderLength );
+
+    if( xLength > 0 )
+    {
+        pxCapture->xWrite( pxCapture->pvWriteContext, pucData, xLength );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void Capture_Init( CaptureTransport_t * pxCapture,
+                   CaptureWrite_t xWrite,
+                   void * pvWriteContext )
+{
+    configASSERT( ( pxCapture != NULL ) && ( xWrite != NULL ) );
+
+    memset( pxCapture, 0, sizeof( *pxCapture ) );
+    pxCapture->xWrite = xWrite;
+    pxCapture->pvWriteContext = pvWriteContext;
+    pxCapture->ullLastRecordUs = Clock_GetMonotonicUs();
+
+    xWrite( pvWriteContext, ( const uint8_t * ) captureMAGIC, captureMAGIC_LENGTH );
+}
+/*-----------------------------------------------------------*/
+
+void Capture_Wrap( CaptureTransport_t * pxCapture,
+                   AzureIoTTransportInterface_t * pxTransport )
+{
+    configASSERT( ( pxCapture != NULL ) && ( pxTransport != NULL ) );
+
+    pxCapture->pxInnerContext = pxTransport->pxNetworkContext;
+    pxCapture->xInnerSend = pxTransport->xSend;
+    pxCapture->xInnerRecv = pxTransport->xRecv;
+
+    /* The capture is its own network context, only this file dereferences it. */
+    pxTransport->pxNetworkContext = ( NetworkContext_t * ) pxCapture;
+    pxTransport->xSend = Capture_Send;
+    pxTransport->xRecv = Capture_Recv;
+
+    Capture_Reconnect( pxCapture );
+}
+/*-----------------------------------------------------------*/
+
+void Capture_Reconnect( CaptureTransport_t * pxCapture )
+{
+    prvRecord( pxCapture, captureRECORD_CONNECT, NULL, 0 );
+}
+/*-----------------------------------------------------------*/
+
+void Capture_WriteFile( void * pvContext,
+                        const uint8_t * pucData,
+                        size_t xLength )
+{
+    FILE * pxFile = ( FILE * ) pvContext;
+
+    ( void ) fwrite( pucData, 1, xLength, pxFile );
+    ( void ) fflush( pxFile );
+}
+/*-----------------------------------------------------------*/
+
+int32_t Capture_Send( NetworkContext_t * pxNetworkContext,
+                      const void * pvBuffer,
+                      size_t xBytesToSend )
+{
+    CaptureTransport_t * pxCapture = ( CaptureTransport_t * ) pxNetworkContext;
+    int32_t lSent = pxCapture->xInnerSend( pxCapture->pxInnerContext, pvBuffer, xBytesToSend );
+
+    if( lSent > 0 )
+    {
+        prvRecord( pxCapture, captureRECORD_SEND, ( const uint8_t * ) pvBuffer, ( size_t ) lSent );
+        pxCapture->xBytesSent += ( size_t ) lSent;
+    }
+
+    return lSent;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Capture_Recv( NetworkContext_t * pxNetworkContext,
+                      void * pvBuffer,
+                      size_t xBytesToRecv )
+{
+    CaptureTransport_t * pxCapture = ( CaptureTransport_t * ) pxNetworkContext;
+    int32_t lReceived = pxCapture->xInnerRecv( pxCapture->pxInnerContext, pvBuffer, xBytesToRecv );
+
+    if( lReceived > 0 )
+    {
+        prvRecord( pxCapture, captureRECORD_RECV, ( const uint8_t * ) pvBuffer, ( size_t ) lReceived );
+        pxCapture->xBytesReceived += ( size_t ) lReceived;
+    }
+
+    return lReceived;
+}
+/*-----------------------------------------------------------*/
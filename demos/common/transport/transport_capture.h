@@ -0,0 +1,129 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_capture.h
+ * @brief Transport decorator recording the plaintext of a session.
+ *
+ * Wraps the send and receive functions of an #AzureIoTTransportInterface_t,
+ * typically TLS_Socket_Send and TLS_Socket_Recv, and writes every byte they
+ * move to a log that transport_replay.h plays back. The log starts with the
+ * four bytes of #captureMAGIC, followed by records:
+ *
+ *     <type> <time> [<length> <bytes>]
+ *
+ * - type is one byte, #captureRECORD_SEND, #captureRECORD_RECV or
+ *   #captureRECORD_CONNECT.
+ * - time is the microseconds since the previous record, as a varint of
+ *   seven bits per byte, least significant first.
+ * - length, also a varint, and bytes follow send and receive records.
+ *
+ * Receive calls that return no data are not recorded. The log holds
+ * everything the client exchanges with IoT Hub, SAS tokens included, keep it
+ * as private as the device credentials.
+ */
+
+#ifndef TRANSPORT_CAPTURE_H
+#define TRANSPORT_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "azure_iot_transport_interface.h"
+
+#define captureMAGIC             "AZC1"
+#define captureMAGIC_LENGTH      ( 4U )
+
+#define captureRECORD_SEND       ( 0x01U )
+#define captureRECORD_RECV       ( 0x02U )
+#define captureRECORD_CONNECT    ( 0x03U )
+
+/**
+ * @brief Sink of the log.
+ *
+ * @param[in] pvContext Context given to #Capture_Init.
+ * @param[in] pucData Bytes to append to the log.
+ * @param[in] xLength Length of @p pucData.
+ */
+typedef void ( * CaptureWrite_t )( void * pvContext,
+                                   const uint8_t * pucData,
+                                   size_t xLength );
+
+/**
+ * @brief State of one capture.
+ *
+ * The wrapped interface is given a pointer to this structure as its network
+ * context.
+ */
+typedef struct CaptureTransport
+{
+    CaptureWrite_t xWrite;
+    void * pvWriteContext;
+    uint64_t ullLastRecordUs;
+
+    /* Wrapped transport. */
+    NetworkContext_t * pxInnerContext;
+    AzureIoTTransportSend_t xInnerSend;
+    AzureIoTTransportRecv_t xInnerRecv;
+
+    size_t xBytesSent;
+    size_t xBytesReceived;
+} CaptureTransport_t;
+
+/**
+ * @brief Start a log.
+ *
+ * @param[out] pxCapture Capture to initialize.
+ * @param[in] xWrite Sink of the log, #Capture_WriteFile for a file.
+ * @param[in] pvWriteContext Context passed to @p xWrite.
+ */
+void Capture_Init( CaptureTransport_t * pxCapture,
+                   CaptureWrite_t xWrite,
+                   void * pvWriteContext );
+
+/**
+ * @brief Put the capture between a client and a connected transport, and
+ * record the connection.
+ *
+ * Call before the client is initialized with @p pxTransport.
+ *
+ * @param[in] pxCapture Initialized capture.
+ * @param[in,out] pxTransport Interface of the transport, replaced by the
+ * interface of the capture.
+ */
+void Capture_Wrap( CaptureTransport_t * pxCapture,
+                   AzureIoTTransportInterface_t * pxTransport );
+
+/**
+ * @brief Record a new connection of the wrapped transport.
+ *
+ * Call after every connect of the wrapped transport but the one before
+ * #Capture_Wrap.
+ *
+ * @param[in] pxCapture Capture.
+ */
+void Capture_Reconnect( CaptureTransport_t * pxCapture );
+
+/**
+ * @brief #CaptureWrite_t appending to the FILE * given as context, flushed
+ * after every record so a crash does not lose the end of the session.
+ */
+void Capture_WriteFile( void * pvContext,
+                        const uint8_t * pucData,
+                        size_t xLength );
+
+/**
+ * @brief Send through the wrapped transport and record what it took.
+ */
+int32_t Capture_Send( NetworkContext_t * pxNetworkContext,
+                      const void * pvBuffer,
+                      size_t xBytesToSend );
+
+/**
+ * @brief Receive through the wrapped transport and record what it returned.
+ */
+int32_t Capture_Recv( NetworkContext_t * pxNetworkContext,
+                      void * pvBuffer,
+                      size_t xBytesToRecv );
+
+#endif /* TRANSPORT_CAPTURE_H */
@@ -0,0 +1,628 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_impairment.c
+ * @brief Socket interposer emulating a poor network link.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Logging configuration for the impairment. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "Impairment"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "transport_impairment.h"
+
+/* Monotonic clock header. */
+#include "clock_service.h"
+
+/*-----------------------------------------------------------*/
+
+#define impairmentNEVER                   ( UINT64_MAX )
+
+static const ImpairmentConfig_t xProfiles[] =
+{
+    /* Name,             latency, jitter, loss, retransmit, uplink,  downlink, stall every, for,  reset every */
+    { "lan",             0,       0,      0,    0,          0,       0,        0,           0,    0          },
+    { "wifi-congested",  20,      80,     20,   200,        250000,  250000,   60000,       1000, 0          },
+    { "lte",             40,      30,     5,    200,        625000,  1250000,  120000,      500,  0          },
+    { "cellular-weak",   300,     400,    50,   1000,       4000,    8000,     30000,       5000, 600000     },
+    { "satellite",       300,     50,     10,   1200,       16000,   64000,    0,           0,    0          }
+};
+
+#define impairmentPROFILE_COUNT           ( sizeof( xProfiles ) / sizeof( xProfiles[ 0 ] ) )
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief xorshift32, enough to spread impairments and cheap to repeat.
+ */
+static uint32_t prvRandom( ImpairedTransport_t * pxImpaired )
+{
+    uint32_t ulState = pxImpaired->ulRandomState;
+
+    ulState ^= ulState << 13;
+    ulState ^= ulState >> 17;
+    ulState ^= ulState << 5;
+    pxImpaired->ulRandomState = ulState;
+
+    return ulState;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Random value in [0, ulBound].
+ */
+static uint32_t prvRandomUpTo( ImpairedTransport_t * pxImpaired,
+                               uint32_t ulBound )
+{
+    return ( ulBound == 0 ) ? 0 : ( uint32_t ) ( prvRandom( pxImpaired ) % ( ( uint64_t ) ulBound + 1 ) );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Time of the next event with a mean interval of @p ulMeanMs, drawn
+ * uniformly from ]0, 2 * mean].
+ */
+static uint64_t prvSchedule( ImpairedTransport_t * pxImpaired,
+                             uint64_t ullNowMs,
+                             uint32_t ulMeanMs )
+{
+    if( ulMeanMs == 0 )
+    {
+        return impairmentNEVER;
+    }
+
+    return ullNowMs + 1 + prvRandomUpTo( pxImpaired, 2 * ulMeanMs - 1 );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start the stalls and resets that are due.
+ */
+static void prvUpdateEvents( ImpairedTransport_t * pxImpaired,
+                             uint64_t ullNowMs )
+{
+    uint32_t ulDurationMs;
+
+    if( !pxImpaired->xReset && ( ullNowMs >= pxImpaired->ullNextResetMs ) )
+    {
+        pxImpaired->xReset = true;
+        pxImpaired->ullNextResetMs = impairmentNEVER;
+        pxImpaired->xStats.ulResets++;
+        LogInfo( ( "Connection reset" ) );
+    }
+
+    if( ullNowMs >= pxImpaired->ullNextStallMs )
+    {
+        ulDurationMs = pxImpaired->xConfig.ulStallDurationMs / 2 +
+                       prvRandomUpTo( pxImpaired, pxImpaired->xConfig.ulStallDurationMs );
+        pxImpaired->ullStallEndMs = ullNowMs + ulDurationMs;
+        pxImpaired->ullNextStallMs = prvSchedule( pxImpaired, pxImpaired->ullStallEndMs,
+                                                  pxImpaired->xConfig.ulStallIntervalMs );
+        pxImpaired->xStats.ulStalls++;
+        LogInfo( ( "Link stalled for %u ms", ( unsigned ) ulDurationMs ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Time the first chunk of a queue can be delivered.
+ */
+static uint64_t prvNextDue( const ImpairedTransport_t * pxImpaired,
+                            const ImpairmentQueue_t * pxQueue )
+{
+    uint64_t ullDueMs;
+
+    if( pxQueue->ulChunkCount == 0 )
+    {
+        return impairmentNEVER;
+    }
+
+    ullDueMs = pxQueue->xChunks[ pxQueue->ulChunkHead ].ullDueMs;
+
+    return ( ullDueMs < pxImpaired->ullStallEndMs ) ? pxImpaired->ullStallEndMs : ullDueMs;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Record the last @p xLength bytes written to a queue as a chunk and
+ * compute when the link delivers it.
+ */
+static void prvAddChunk( ImpairedTransport_t * pxImpaired,
+                         ImpairmentQueue_t * pxQueue,
+                         size_t xLength,
+                         uint32_t ulBytesPerSecond,
+                         uint64_t ullNowMs )
+{
+    uint32_t ulIndex = ( pxQueue->ulChunkHead + pxQueue->ulChunkCount ) % impairmentMAX_CHUNKS;
+    uint64_t ullDueMs;
+
+    if( pxQueue->ullLinkFreeMs < ullNowMs )
+    {
+        pxQueue->ullLinkFreeMs = ullNowMs;
+    }
+
+    if( ulBytesPerSecond != 0 )
+    {
+        pxQueue->ullLinkFreeMs += ( ( uint64_t ) xLength * 1000U + ulBytesPerSecond - 1 ) / ulBytesPerSecond;
+    }
+
+    ullDueMs = pxQueue->ullLinkFreeMs + pxImpaired->xConfig.ulLatencyMs +
+               prvRandomUpTo( pxImpaired, pxImpaired->xConfig.ulJitterMs );
+
+    if( ( pxImpaired->xConfig.ulLossPerMille != 0 ) &&
+        ( prvRandom( pxImpaired ) % 1000U < pxImpaired->xConfig.ulLossPerMille ) )
+    {
+        ullDueMs += pxImpaired->xConfig.ulRetransmitMs;
+        pxImpaired->xStats.ulChunksLost++;
+    }
+
+    /* The stream stays in order, a chunk cannot overtake a delayed one. */
+    if( ullDueMs < pxQueue->ullLastDueMs )
+    {
+        ullDueMs = pxQueue->ullLastDueMs;
+    }
+
+    pxQueue->ullLastDueMs = ullDueMs;
+    pxQueue->xChunks[ ulIndex ].ullQueuedMs = ullNowMs;
+    pxQueue->xChunks[ ulIndex ].ullDueMs = ullDueMs;
+    pxQueue->xChunks[ ulIndex ].xLength = xLength;
+    pxQueue->xLength += xLength;
+    pxQueue->ulChunkCount++;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Remove bytes from the head of a queue.
+ */
+static void prvConsume( ImpairedTransport_t * pxImpaired,
+                        ImpairmentQueue_t * pxQueue,
+                        size_t xLength,
+                        uint64_t ullNowMs )
+{
+    uint32_t ulDelayMs;
+
+    pxQueue->xHead = ( pxQueue->xHead + xLength ) % impairmentQUEUE_SIZE;
+    pxQueue->xLength -= xLength;
+    pxQueue->xChunks[ pxQueue->ulChunkHead ].xLength -= xLength;
+
+    if( pxQueue->xChunks[ pxQueue->ulChunkHead ].xLength == 0 )
+    {
+        ulDelayMs = ( uint32_t ) ( ullNowMs - pxQueue->xChunks[ pxQueue->ulChunkHead ].ullQueuedMs );
+
+        if( ulDelayMs > pxImpaired->xStats.ulMaxDelayMs )
+        {
+            pxImpaired->xStats.ulMaxDelayMs = ulDelayMs;
+        }
+
+        pxQueue->ulChunkHead = ( pxQueue->ulChunkHead + 1 ) % impairmentMAX_CHUNKS;
+        pxQueue->ulChunkCount--;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Contiguous bytes at the head of the first chunk.
+ */
+static size_t prvHeadSegment( const ImpairmentQueue_t * pxQueue )
+{
+    size_t xLength = pxQueue->xChunks[ pxQueue->ulChunkHead ].xLength;
+
+    if( xLength > impairmentQUEUE_SIZE - pxQueue->xHead )
+    {
+        xLength = impairmentQUEUE_SIZE - pxQueue->xHead;
+    }
+
+    return xLength;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Hand the uplink chunks that are due to the socket.
+ *
+ * @return SOCKETS_ERROR_NONE, or the error of the socket.
+ */
+static BaseType_t prvFlushUplink( ImpairedTransport_t * pxImpaired,
+                                  SocketHandle xSocket,
+                                  uint64_t ullNowMs )
+{
+    ImpairmentQueue_t * pxQueue = &pxImpaired->xUplink;
+    BaseType_t xSent;
+
+    while( prvNextDue( pxImpaired, pxQueue ) <= ullNowMs )
+    {
+        xSent = Sockets_Send( xSocket, &pxQueue->ucData[ pxQueue->xHead ], prvHeadSegment( pxQueue ) );
+
+        if( xSent < 0 )
+        {
+            return xSent;
+        }
+        else if( xSent == 0 )
+        {
+            break;
+        }
+
+        pxImpaired->xStats.xBytesSent += ( size_t ) xSent;
+        prvConsume( pxImpaired, pxQueue, ( size_t ) xSent, ullNowMs );
+    }
+
+    return SOCKETS_ERROR_NONE;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copy the downlink chunks that are due.
+ */
+static size_t prvDeliverDownlink( ImpairedTransport_t * pxImpaired,
+                                  uint8_t * pucBuffer,
+                                  size_t xBufferLength,
+                                  uint64_t ullNowMs )
+{
+    ImpairmentQueue_t * pxQueue = &pxImpaired->xDownlink;
+    size_t xCopied = 0;
+    size_t xLength;
+
+    while( ( xCopied < xBufferLength ) && ( prvNextDue( pxImpaired, pxQueue ) <= ullNowMs ) )
+    {
+        xLength = prvHeadSegment( pxQueue );
+
+        if( xLength > xBufferLength - xCopied )
+        {
+            xLength = xBufferLength - xCopied;
+        }
+
+        memcpy( pucBuffer + xCopied, &pxQueue->ucData[ pxQueue->xHead ], xLength );
+        xCopied += xLength;
+        prvConsume( pxImpaired, pxQueue, xLength, ullNowMs );
+    }
+
+    pxImpaired->xStats.xBytesReceived += xCopied;
+
+    return xCopied;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read from the socket into the free space of the downlink queue.
+ *
+ * @return SOCKETS_ERROR_NONE, or the error of the socket.
+ */
+static BaseType_t prvPullDownlink( ImpairedTransport_t * pxImpaired,
+                                   SocketHandle xSocket )
+{
+    ImpairmentQueue_t * pxQueue = &pxImpaired->xDownlink;
+    size_t xTail = ( pxQueue->xHead + pxQueue->xLength ) % impairmentQUEUE_SIZE;
+    size_t xFree = impairmentQUEUE_SIZE - pxQueue->xLength;
+    BaseType_t xReceived;
+
+    if( xFree > impairmentQUEUE_SIZE - xTail )
+    {
+        xFree = impairmentQUEUE_SIZE - xTail;
+    }
+
+    xReceived = Sockets_Recv( xSocket, &pxQueue->ucData[ xTail ], xFree );
+
+    if( xReceived > 0 )
+    {
+        prvAddChunk( pxImpaired, pxQueue, ( size_t ) xReceived,
+                     pxImpaired->xConfig.ulDownlinkBytesPerSecond, Clock_GetMonotonicMs() );
+    }
+
+    return ( xReceived < 0 ) ? xReceived : SOCKETS_ERROR_NONE;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait until @p ullWakeMs, at most @p ulMaxWaitMs.
+ */
+static void prvWaitUntil( uint64_t ullWakeMs,
+                          uint64_t ullNowMs,
+                          uint32_t ulMaxWaitMs )
+{
+    uint64_t ullWaitMs = ( ullWakeMs > ullNowMs ) ? ullWakeMs - ullNowMs : 0;
+
+    if( ullWaitMs > ulMaxWaitMs )
+    {
+        ullWaitMs = ulMaxWaitMs;
+    }
+
+    /* Round up so the wake time has passed. */
+    vTaskDelay( pdMS_TO_TICKS( ( uint32_t ) ullWaitMs ) + 1 );
+}
+/*-----------------------------------------------------------*/
+
+const ImpairmentConfig_t * Impairment_FindProfile( const char * pcName,
+                                                   uint32_t ulNameLength )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < impairmentPROFILE_COUNT; ulIndex++ )
+    {
+        if( ( strlen( xProfiles[ ulIndex ].pcName ) == ulNameLength ) &&
+            ( strncmp( xProfiles[ ulIndex ].pcName, pcName, ulNameLength ) == 0 ) )
+        {
+            return &xProfiles[ ulIndex ];
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start a new connection, from empty queues and without a reset.
+ */
+static void prvResetLink( ImpairedTransport_t * pxImpaired )
+{
+    uint64_t ullNowMs = Clock_GetMonotonicMs();
+
+    memset( &pxImpaired->xUplink, 0, sizeof( pxImpaired->xUplink ) );
+    memset( &pxImpaired->xDownlink, 0, sizeof( pxImpaired->xDownlink ) );
+    pxImpaired->xReset = false;
+    pxImpaired->ullStallEndMs = 0;
+    pxImpaired->ullNextStallMs = prvSchedule( pxImpaired, ullNowMs, pxImpaired->xConfig.ulStallIntervalMs );
+    pxImpaired->ullNextResetMs = prvSchedule( pxImpaired, ullNowMs, pxImpaired->xConfig.ulResetIntervalMs );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Delay of one crossing of the link by a packet too small to be
+ * spaced by the bandwidth.
+ */
+static uint32_t prvCrossingMs( ImpairedTransport_t * pxImpaired )
+{
+    uint32_t ulDelayMs = pxImpaired->xConfig.ulLatencyMs + prvRandomUpTo( pxImpaired, pxImpaired->xConfig.ulJitterMs );
+
+    if( ( pxImpaired->xConfig.ulLossPerMille != 0 ) &&
+        ( prvRandom( pxImpaired ) % 1000U < pxImpaired->xConfig.ulLossPerMille ) )
+    {
+        ulDelayMs += pxImpaired->xConfig.ulRetransmitMs;
+        pxImpaired->xStats.ulChunksLost++;
+    }
+
+    return ulDelayMs;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Connect the socket, then wait for the SYN and SYN-ACK to cross the
+ * link, and a stall to end.
+ */
+static BaseType_t prvConnect( void * pvContext,
+                              SocketHandle xSocket,
+                              const char * pcHostName,
+                              uint16_t usPort )
+{
+    ImpairedTransport_t * pxImpaired = ( ImpairedTransport_t * ) pvContext;
+    BaseType_t xResult = Sockets_Connect( xSocket, pcHostName, usPort );
+    uint64_t ullDoneMs;
+
+    if( xResult == SOCKETS_ERROR_NONE )
+    {
+        prvResetLink( pxImpaired );
+        ullDoneMs = Clock_GetMonotonicMs() + prvCrossingMs( pxImpaired ) + prvCrossingMs( pxImpaired );
+        prvUpdateEvents( pxImpaired, ullDoneMs );
+
+        if( ullDoneMs < pxImpaired->ullStallEndMs )
+        {
+            ullDoneMs = pxImpaired->ullStallEndMs;
+        }
+
+        prvWaitUntil( ullDoneMs, Clock_GetMonotonicMs(), UINT32_MAX );
+
+        if( pxImpaired->xReset )
+        {
+            xResult = SOCKETS_ECLOSED;
+        }
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue bytes for the uplink and deliver the chunks that are due.
+ *
+ * Waits for room while the uplink queue is full.
+ *
+ * @return Number of bytes queued, or a negative error after a reset or an
+ * error of the socket.
+ */
+static BaseType_t prvSend( void * pvContext,
+                           SocketHandle xSocket,
+                           const uint8_t * pucData,
+                           size_t xDataLength );
+
+/**
+ * @brief Receive the downlink bytes that are due.
+ *
+ * Reads the socket, or waits while the link is stalled.
+ *
+ * @return Number of bytes copied, 0 if none are due, or a negative error
+ * after a reset or an error of the socket.
+ */
+static BaseType_t prvRecv( void * pvContext,
+                           SocketHandle xSocket,
+                           uint8_t * pucReceiveBuffer,
+                           size_t xReceiveBufferLength );
+/*-----------------------------------------------------------*/
+
+void Impairment_Init( ImpairedTransport_t * pxImpaired,
+                      const ImpairmentConfig_t * pxConfig,
+                      uint32_t ulSeed )
+{
+    configASSERT( ( pxImpaired != NULL ) && ( pxConfig != NULL ) );
+
+    memset( pxImpaired, 0, sizeof( *pxImpaired ) );
+    pxImpaired->xConfig = *pxConfig;
+
+    /* xorshift never leaves a zero state. */
+    pxImpaired->ulRandomState = ( ulSeed != 0 ) ? ulSeed : 0x9E3779B9U;
+    pxImpaired->ullNextStallMs = impairmentNEVER;
+    pxImpaired->ullNextResetMs = impairmentNEVER;
+
+    pxImpaired->xInterposer.pvContext = pxImpaired;
+    pxImpaired->xInterposer.xConnect = prvConnect;
+    pxImpaired->xInterposer.xSend = prvSend;
+    pxImpaired->xInterposer.xRecv = prvRecv;
+}
+/*-----------------------------------------------------------*/
+
+const SocketsInterposer_t * Impairment_GetInterposer( ImpairedTransport_t * pxImpaired )
+{
+    return &pxImpaired->xInterposer;
+}
+/*-----------------------------------------------------------*/
+
+void Impairment_GetStats( const ImpairedTransport_t * pxImpaired,
+                          ImpairmentStats_t * pxStats )
+{
+    *pxStats = pxImpaired->xStats;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSend( void * pvContext,
+                           SocketHandle xSocket,
+                           const uint8_t * pucData,
+                           size_t xDataLength )
+{
+    ImpairedTransport_t * pxImpaired = ( ImpairedTransport_t * ) pvContext;
+    ImpairmentQueue_t * pxQueue = &pxImpaired->xUplink;
+    uint64_t ullNowMs = Clock_GetMonotonicMs();
+    BaseType_t xResult;
+    size_t xTail;
+    size_t xFirst;
+    size_t xLength = 0;
+    uint32_t ulAttempt;
+
+    /* When the queue is full, wait once for the next chunk to go out, like a
+     * socket with a full send buffer. The caller retries on 0. */
+    for( ulAttempt = 0; ( ulAttempt < 2 ) && ( xLength == 0 ); ulAttempt++ )
+    {
+        if( ulAttempt > 0 )
+        {
+            prvWaitUntil( prvNextDue( pxImpaired, pxQueue ), ullNowMs, impairmentPOLL_INTERVAL_MS );
+            ullNowMs = Clock_GetMonotonicMs();
+        }
+
+        prvUpdateEvents( pxImpaired, ullNowMs );
+
+        if( pxImpaired->xReset )
+        {
+            return SOCKETS_ECLOSED;
+        }
+
+        if( ( xResult = prvFlushUplink( pxImpaired, xSocket, ullNowMs ) ) != SOCKETS_ERROR_NONE )
+        {
+            return xResult;
+        }
+
+        xLength = impairmentQUEUE_SIZE - pxQueue->xLength;
+
+        if( xLength > xDataLength )
+        {
+            xLength = xDataLength;
+        }
+
+        if( pxQueue->ulChunkCount == impairmentMAX_CHUNKS )
+        {
+            xLength = 0;
+        }
+    }
+
+    if( xLength > 0 )
+    {
+        xTail = ( pxQueue->xHead + pxQueue->xLength ) % impairmentQUEUE_SIZE;
+        xFirst = impairmentQUEUE_SIZE - xTail;
+
+        if( xFirst > xLength )
+        {
+            xFirst = xLength;
+        }
+
+        memcpy( &pxQueue->ucData[ xTail ], pucData, xFirst );
+        memcpy( pxQueue->ucData, pucData + xFirst, xLength - xFirst );
+        prvAddChunk( pxImpaired, pxQueue, xLength, pxImpaired->xConfig.ulUplinkBytesPerSecond, ullNowMs );
+
+        /* Without latency the chunk goes out right away. */
+        if( ( xResult = prvFlushUplink( pxImpaired, xSocket, ullNowMs ) ) != SOCKETS_ERROR_NONE )
+        {
+            return xResult;
+        }
+    }
+
+    return ( BaseType_t ) xLength;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRecv( void * pvContext,
+                           SocketHandle xSocket,
+                           uint8_t * pucReceiveBuffer,
+                           size_t xReceiveBufferLength )
+{
+    ImpairedTransport_t * pxImpaired = ( ImpairedTransport_t * ) pvContext;
+    uint64_t ullNowMs = Clock_GetMonotonicMs();
+    uint64_t ullWakeMs;
+    BaseType_t xResult;
+
+    prvUpdateEvents( pxImpaired, ullNowMs );
+
+    if( pxImpaired->xReset )
+    {
+        return SOCKETS_ECLOSED;
+    }
+
+    if( ( xResult = prvFlushUplink( pxImpaired, xSocket, ullNowMs ) ) != SOCKETS_ERROR_NONE )
+    {
+        return xResult;
+    }
+
+    /* Bytes left in the socket during a stall arrive after it. Otherwise
+     * its receive timeout paces the caller. */
+    if( ( ullNowMs >= pxImpaired->ullStallEndMs ) &&
+        ( pxImpaired->xDownlink.xLength < impairmentQUEUE_SIZE ) &&
+        ( pxImpaired->xDownlink.ulChunkCount < impairmentMAX_CHUNKS ) )
+    {
+        if( ( xResult = prvPullDownlink( pxImpaired, xSocket ) ) != SOCKETS_ERROR_NONE )
+        {
+            return xResult;
+        }
+    }
+    else
+    {
+        ullWakeMs = prvNextDue( pxImpaired, &pxImpaired->xDownlink );
+
+        if( ullWakeMs > pxImpaired->ullStallEndMs )
+        {
+            ullWakeMs = pxImpaired->ullStallEndMs;
+        }
+
+        prvWaitUntil( ullWakeMs, ullNowMs, impairmentPOLL_INTERVAL_MS );
+    }
+
+    ullNowMs = Clock_GetMonotonicMs();
+    prvUpdateEvents( pxImpaired, ullNowMs );
+
+    if( pxImpaired->xReset )
+    {
+        return SOCKETS_ECLOSED;
+    }
+
+    if( ( xResult = prvFlushUplink( pxImpaired, xSocket, ullNowMs ) ) != SOCKETS_ERROR_NONE )
+    {
+        return xResult;
+    }
+
+    return ( BaseType_t ) prvDeliverDownlink( pxImpaired, pucReceiveBuffer, xReceiveBufferLength, ullNowMs );
+}
+/*-----------------------------------------------------------*/
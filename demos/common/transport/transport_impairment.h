@@ -0,0 +1,180 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_impairment.h
+ * @brief Socket interposer emulating a poor network link.
+ *
+ * Sits between the TLS transport and its socket, as the
+ * #SocketsInterposer_t of #TlsTransportParams_t, so the TCP connect, the
+ * TLS handshake and every TLS record cross the emulated link. The bytes of
+ * each direction are held in a queue until the link delivers them:
+ *
+ * - Every chunk is delayed by the one-way latency plus a random jitter, in
+ *   order, as TCP would deliver it.
+ * - A lost chunk is delivered after an extra retransmission delay.
+ * - A bandwidth cap spaces chunks by their serialization time.
+ * - During a stall nothing is delivered in either direction.
+ * - After a reset send and receive fail until the next connect, as for a
+ *   connection closed by the peer.
+ *
+ * A connect takes one round trip of the link, and starts from empty queues.
+ *
+ * All randomness comes from a PRNG seeded by #Impairment_Init, so a run can
+ * be repeated.
+ *
+ * Queued bytes move when the transport sends or receives, which the process
+ * loop of the client does continuously. Connect the TLS transport with a
+ * receive timeout of #impairmentPOLL_INTERVAL_MS, so a receive blocking in
+ * the socket does not hold back queued bytes and received bytes are
+ * timestamped close to their arrival. Not thread safe: use one interposer
+ * per connection, from the task running its client.
+ */
+
+#ifndef TRANSPORT_IMPAIRMENT_H
+#define TRANSPORT_IMPAIRMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sockets_wrapper.h"
+
+/**
+ * @brief Bytes queued in each direction.
+ */
+#ifndef impairmentQUEUE_SIZE
+    #define impairmentQUEUE_SIZE          ( 4096U )
+#endif
+
+/**
+ * @brief Chunks queued in each direction.
+ */
+#ifndef impairmentMAX_CHUNKS
+    #define impairmentMAX_CHUNKS          ( 32U )
+#endif
+
+/**
+ * @brief Longest wait of the interposer in one call, and the receive
+ * timeout of the socket.
+ */
+#ifndef impairmentPOLL_INTERVAL_MS
+    #define impairmentPOLL_INTERVAL_MS    ( 10U )
+#endif
+
+/**
+ * @brief Characteristics of the emulated link. A zero field disables its
+ * impairment.
+ */
+typedef struct ImpairmentConfig
+{
+    const char * pcName;
+    uint32_t ulLatencyMs;              /**< @brief One-way delay of every chunk. */
+    uint32_t ulJitterMs;               /**< @brief Largest random delay added to the latency. */
+    uint32_t ulLossPerMille;           /**< @brief Chunks needing a retransmission, per thousand. */
+    uint32_t ulRetransmitMs;           /**< @brief Extra delay of a lost chunk. */
+    uint32_t ulUplinkBytesPerSecond;   /**< @brief Bandwidth from the device. */
+    uint32_t ulDownlinkBytesPerSecond; /**< @brief Bandwidth to the device. */
+    uint32_t ulStallIntervalMs;        /**< @brief Mean time between stalls. */
+    uint32_t ulStallDurationMs;        /**< @brief Mean duration of a stall. */
+    uint32_t ulResetIntervalMs;        /**< @brief Mean time between connection resets. */
+} ImpairmentConfig_t;
+
+/**
+ * @brief Counters of one interposer, kept across connections.
+ */
+typedef struct ImpairmentStats
+{
+    size_t xBytesSent;
+    size_t xBytesReceived;
+    uint32_t ulChunksLost;
+    uint32_t ulStalls;
+    uint32_t ulResets;
+    uint32_t ulMaxDelayMs; /**< @brief Longest time a chunk was queued. */
+} ImpairmentStats_t;
+
+/**
+ * @brief Chunks of one direction, in order of delivery.
+ */
+typedef struct ImpairmentQueue
+{
+    uint8_t ucData[ impairmentQUEUE_SIZE ];
+    size_t xHead;
+    size_t xLength;
+
+    struct
+    {
+        uint64_t ullQueuedMs;
+        uint64_t ullDueMs;
+        size_t xLength;
+    } xChunks[ impairmentMAX_CHUNKS ];
+    uint32_t ulChunkHead;
+    uint32_t ulChunkCount;
+
+    uint64_t ullLinkFreeMs; /**< @brief End of the serialization of the last chunk. */
+    uint64_t ullLastDueMs;
+} ImpairmentQueue_t;
+
+/**
+ * @brief State of one interposer.
+ */
+typedef struct ImpairedTransport
+{
+    ImpairmentConfig_t xConfig;
+    uint32_t ulRandomState;
+    SocketsInterposer_t xInterposer;
+
+    ImpairmentQueue_t xUplink;
+    ImpairmentQueue_t xDownlink;
+    uint64_t ullNextStallMs;
+    uint64_t ullStallEndMs;
+    uint64_t ullNextResetMs;
+    bool xReset;
+
+    ImpairmentStats_t xStats;
+} ImpairedTransport_t;
+
+/**
+ * @brief Find a predefined link by name.
+ *
+ * The links are "lan", "wifi-congested", "lte", "cellular-weak" and
+ * "satellite".
+ *
+ * @param[in] pcName Link name.
+ * @param[in] ulNameLength Length of @p pcName.
+ * @return The link, or NULL if there is none with that name.
+ */
+const ImpairmentConfig_t * Impairment_FindProfile( const char * pcName,
+                                                   uint32_t ulNameLength );
+
+/**
+ * @brief Set the link of an interposer and seed its PRNG.
+ *
+ * @param[out] pxImpaired Interposer to initialize.
+ * @param[in] pxConfig Link to emulate, copied.
+ * @param[in] ulSeed Seed of the PRNG, the same seed repeats the same
+ * impairments for the same traffic.
+ */
+void Impairment_Init( ImpairedTransport_t * pxImpaired,
+                      const ImpairmentConfig_t * pxConfig,
+                      uint32_t ulSeed );
+
+/**
+ * @brief Interposer to put in the #TlsTransportParams_t of the connection,
+ * before it connects.
+ *
+ * @param[in] pxImpaired Initialized interposer.
+ * @return The socket functions of @p pxImpaired.
+ */
+const SocketsInterposer_t * Impairment_GetInterposer( ImpairedTransport_t * pxImpaired );
+
+/**
+ * @brief Read the counters of an interposer.
+ *
+ * @param[in] pxImpaired Interposer.
+ * @param[out] pxStats Counters.
+ */
+void Impairment_GetStats( const ImpairedTransport_t * pxImpaired,
+                          ImpairmentStats_t * pxStats );
+
+#endif /* TRANSPORT_IMPAIRMENT_H */
@@ -0,0 +1,527 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_loopback.c
+ * @brief In-memory transport with a scripted IoT Hub peer.
+ */
+
+#include "transport_loopback.h"
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/*-----------------------------------------------------------*/
+
+#define loopbackCONNECT                 ( 0x10U )
+#define loopbackCONNACK                 ( 0x20U )
+#define loopbackPUBLISH                 ( 0x30U )
+#define loopbackPUBACK                  ( 0x40U )
+#define loopbackSUBSCRIBE               ( 0x80U )
+#define loopbackSUBACK                  ( 0x90U )
+#define loopbackUNSUBSCRIBE             ( 0xA0U )
+#define loopbackUNSUBACK                ( 0xB0U )
+#define loopbackPINGREQ                 ( 0xC0U )
+#define loopbackPINGRESP                ( 0xD0U )
+
+#define loopbackPUBLISH_QOS_MASK        ( 0x06U )
+#define loopbackPUBLISH_QOS1            ( 0x02U )
+
+#define loopbackCONNECT_FLAGS_OFFSET    ( 7U )
+#define loopbackCLEAN_SESSION           ( 0x02U )
+
+/**
+ * @brief Most topic filters answered in one SUBACK.
+ */
+#define loopbackMAX_FILTERS             ( 16U )
+
+/**
+ * @brief Longest topic of a message for the client.
+ */
+#define loopbackMAX_TOPIC_LENGTH        ( 160U )
+
+#define loopbackTWIN_GET_TOPIC          "$iothub/twin/GET/"
+#define loopbackTWIN_REPORTED_TOPIC     "$iothub/twin/PATCH/properties/reported/"
+#define loopbackREQUEST_ID_KEY          "$rid="
+#define loopbackEMPTY_TWIN_DOCUMENT     "{\"desired\":{\"$version\":1},\"reported\":{\"$version\":1}}"
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    LoopbackTransportParams_t * pParams;
+};
+/*-----------------------------------------------------------*/
+
+static void prvWrite( LoopbackTransportParams_t * pxParams,
+                      const uint8_t * pucBytes,
+                      size_t xLength )
+{
+    size_t xTail = ( pxParams->xToClientHead + pxParams->xToClientLength ) % loopbackTO_CLIENT_BUFFER_SIZE;
+    size_t xFirst = loopbackTO_CLIENT_BUFFER_SIZE - xTail;
+
+    if( xLength == 0 )
+    {
+        return;
+    }
+
+    if( xFirst > xLength )
+    {
+        xFirst = xLength;
+    }
+
+    memcpy( &pxParams->ucToClient[ xTail ], pucBytes, xFirst );
+    memcpy( pxParams->ucToClient, pucBytes + xFirst, xLength - xFirst );
+    pxParams->xToClientLength += xLength;
+    pxParams->xStats.xBytesToClient += xLength;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvQueue( LoopbackTransportParams_t * pxParams,
+                      const uint8_t * pucPacket,
+                      size_t xLength )
+{
+    if( loopbackTO_CLIENT_BUFFER_SIZE - pxParams->xToClientLength < xLength )
+    {
+        return false;
+    }
+
+    prvWrite( pxParams, pucPacket, xLength );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue a PUBLISH whose payload is @p pucPayload followed by
+ * @p pcSuffix.
+ */
+static bool prvQueuePublish( LoopbackTransportParams_t * pxParams,
+                             const char * pcTopic,
+                             bool xQoS1,
+                             const uint8_t * pucPayload,
+                             size_t xPayloadLength,
+                             const char * pcSuffix )
+{
+    uint8_t ucHeader[ 1 + 4 + 2 ];
+    uint8_t ucPacketId[ 2 ];
+    size_t xTopicLength = strlen( pcTopic );
+    size_t xSuffixLength = ( pcSuffix != NULL ) ? strlen( pcSuffix ) : 0;
+    size_t xRemainingLength = 2 + xTopicLength + ( xQoS1 ? 2 : 0 ) + xPayloadLength + xSuffixLength;
+    size_t xLength = xRemainingLength;
+    size_t xHeaderLength = 1;
+
+    ucHeader[ 0 ] = ( uint8_t ) ( loopbackPUBLISH | ( xQoS1 ? loopbackPUBLISH_QOS1 : 0U ) );
+
+    do
+    {
+        ucHeader[ xHeaderLength ] = ( uint8_t ) ( xLength & 0x7FU );
+        xLength >>= 7;
+
+        if( xLength != 0 )
+        {
+            ucHeader[ xHeaderLength ] |= 0x80U;
+        }
+
+        xHeaderLength++;
+    } while( ( xLength != 0 ) && ( xHeaderLength < 5 ) );
+
+    ucHeader[ xHeaderLength++ ] = ( uint8_t ) ( xTopicLength >> 8 );
+    ucHeader[ xHeaderLength++ ] = ( uint8_t ) xTopicLength;
+
+    if( ( xLength != 0 ) ||
+        ( loopbackTO_CLIENT_BUFFER_SIZE - pxParams->xToClientLength < xHeaderLength - 2 + xRemainingLength ) )
+    {
+        return false;
+    }
+
+    prvWrite( pxParams, ucHeader, xHeaderLength );
+    prvWrite( pxParams, ( const uint8_t * ) pcTopic, xTopicLength );
+
+    if( xQoS1 )
+    {
+        if( ++pxParams->usNextPacketId == 0 )
+        {
+            pxParams->usNextPacketId = 1;
+        }
+
+        ucPacketId[ 0 ] = ( uint8_t ) ( pxParams->usNextPacketId >> 8 );
+        ucPacketId[ 1 ] = ( uint8_t ) pxParams->usNextPacketId;
+        prvWrite( pxParams, ucPacketId, sizeof( ucPacketId ) );
+    }
+
+    prvWrite( pxParams, pucPayload, xPayloadLength );
+    prvWrite( pxParams, ( const uint8_t * ) pcSuffix, xSuffixLength );
+    pxParams->xStats.ulPublishesToClient++;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Answer a twin request of the client, other publishes only get their
+ * PUBACK.
+ */
+static bool prvHandleTwinRequest( LoopbackTransportParams_t * pxParams,
+                                  const char * pcTopic )
+{
+    char cResponseTopic[ loopbackMAX_TOPIC_LENGTH ];
+    const char * pcRequestId = strstr( pcTopic, loopbackREQUEST_ID_KEY );
+    int lRequestIdLength;
+
+    if( pcRequestId == NULL )
+    {
+        return true;
+    }
+
+    pcRequestId += sizeof( loopbackREQUEST_ID_KEY ) - 1;
+    lRequestIdLength = ( int ) strcspn( pcRequestId, "&" );
+
+    if( strncmp( pcTopic, loopbackTWIN_GET_TOPIC, sizeof( loopbackTWIN_GET_TOPIC ) - 1 ) == 0 )
+    {
+        ( void ) snprintf( cResponseTopic, sizeof( cResponseTopic ), "$iothub/twin/res/200/?$rid=%.*s",
+                           lRequestIdLength, pcRequestId );
+
+        return prvQueuePublish( pxParams, cResponseTopic, false,
+                                ( const uint8_t * ) pxParams->pcTwinDocument,
+                                strlen( pxParams->pcTwinDocument ), NULL );
+    }
+
+    if( strncmp( pcTopic, loopbackTWIN_REPORTED_TOPIC, sizeof( loopbackTWIN_REPORTED_TOPIC ) - 1 ) == 0 )
+    {
+        ( void ) snprintf( cResponseTopic, sizeof( cResponseTopic ), "$iothub/twin/res/204/?$rid=%.*s&$version=%u",
+                           lRequestIdLength, pcRequestId, ( unsigned ) ++pxParams->ulTwinVersion );
+
+        return prvQueuePublish( pxParams, cResponseTopic, false, NULL, 0, NULL );
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Answer a complete packet of the client.
+ *
+ * @param[in] xBodyLength Length of the variable header and payload, of which
+ * at most #loopbackPACKET_PREFIX_SIZE bytes are in ucPacket.
+ */
+static bool prvHandlePacket( LoopbackTransportParams_t * pxParams,
+                             uint8_t ucType,
+                             size_t xBodyLength )
+{
+    const uint8_t * pucBody = pxParams->ucPacket;
+    size_t xStored = ( xBodyLength < loopbackPACKET_PREFIX_SIZE ) ? xBodyLength : loopbackPACKET_PREFIX_SIZE;
+    uint8_t ucResponse[ 4 + loopbackMAX_FILTERS ];
+    char cTopic[ loopbackMAX_TOPIC_LENGTH ];
+    size_t xTopicLength;
+    size_t xOffset;
+    size_t xFilters = 0;
+    bool xSessionPresent;
+
+    switch( ucType & 0xF0U )
+    {
+        case loopbackCONNECT:
+
+            /* Protocol name "MQTT" and level come before the connect flags. */
+            if( xStored <= loopbackCONNECT_FLAGS_OFFSET )
+            {
+                return false;
+            }
+
+            xSessionPresent = ( ( pucBody[ loopbackCONNECT_FLAGS_OFFSET ] & loopbackCLEAN_SESSION ) == 0 ) &&
+                              pxParams->xPersistentSession;
+            pxParams->xPersistentSession = ( pucBody[ loopbackCONNECT_FLAGS_OFFSET ] & loopbackCLEAN_SESSION ) == 0;
+
+            ucResponse[ 0 ] = loopbackCONNACK;
+            ucResponse[ 1 ] = 2;
+            ucResponse[ 2 ] = xSessionPresent ? 1U : 0U;
+            ucResponse[ 3 ] = 0;
+
+            return prvQueue( pxParams, ucResponse, 4 );
+
+        case loopbackPUBLISH:
+            pxParams->xStats.ulPublishesFromClient++;
+            xTopicLength = ( xStored >= 2 ) ? ( ( ( size_t ) pucBody[ 0 ] << 8 ) | pucBody[ 1 ] ) : xStored;
+            xOffset = ( ( ucType & loopbackPUBLISH_QOS_MASK ) != 0 ) ? 2 : 0;
+
+            if( ( xStored < 2 + xTopicLength + xOffset ) || ( xTopicLength >= sizeof( cTopic ) ) )
+            {
+                return false;
+            }
+
+            if( xOffset != 0 )
+            {
+                ucResponse[ 0 ] = loopbackPUBACK;
+                ucResponse[ 1 ] = 2;
+                ucResponse[ 2 ] = pucBody[ 2 + xTopicLength ];
+                ucResponse[ 3 ] = pucBody[ 3 + xTopicLength ];
+
+                if( !prvQueue( pxParams, ucResponse, 4 ) )
+                {
+                    return false;
+                }
+            }
+
+            memcpy( cTopic, &pucBody[ 2 ], xTopicLength );
+            cTopic[ xTopicLength ] = '\0';
+
+            return !pxParams->xAnswerTwinRequests || prvHandleTwinRequest( pxParams, cTopic );
+
+        case loopbackSUBSCRIBE:
+            pxParams->xStats.ulSubscribesFromClient++;
+
+            /* Grant the requested QoS of every topic filter. */
+            for( xOffset = 2; ( xOffset + 2 <= xStored ) && ( xFilters < loopbackMAX_FILTERS ); xFilters++ )
+            {
+                xOffset += 2 + ( ( ( size_t ) pucBody[ xOffset ] << 8 ) | pucBody[ xOffset + 1 ] );
+
+                if( xOffset >= xStored )
+                {
+                    return false;
+                }
+
+                ucResponse[ 4 + xFilters ] = pucBody[ xOffset++ ];
+            }
+
+            ucResponse[ 0 ] = loopbackSUBACK;
+            ucResponse[ 1 ] = ( uint8_t ) ( 2 + xFilters );
+            ucResponse[ 2 ] = pucBody[ 0 ];
+            ucResponse[ 3 ] = pucBody[ 1 ];
+
+            return ( xFilters > 0 ) && prvQueue( pxParams, ucResponse, 4 + xFilters );
+
+        case loopbackUNSUBSCRIBE:
+            ucResponse[ 0 ] = loopbackUNSUBACK;
+            ucResponse[ 1 ] = 2;
+            ucResponse[ 2 ] = pucBody[ 0 ];
+            ucResponse[ 3 ] = pucBody[ 1 ];
+
+            return ( xStored >= 2 ) && prvQueue( pxParams, ucResponse, 4 );
+
+        case loopbackPINGREQ:
+            ucResponse[ 0 ] = loopbackPINGRESP;
+            ucResponse[ 1 ] = 0;
+
+            return prvQueue( pxParams, ucResponse, 2 );
+
+        default:
+            /* PUBACK of injected messages and DISCONNECT need no answer. */
+            return true;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void Loopback_Init( LoopbackTransportParams_t * pxParams,
+                    const char * pcDeviceId,
+                    const char * pcTwinDocument )
+{
+    memset( pxParams, 0, sizeof( LoopbackTransportParams_t ) );
+    pxParams->pcDeviceId = pcDeviceId;
+    pxParams->pcTwinDocument = ( pcTwinDocument != NULL ) ? pcTwinDocument : loopbackEMPTY_TWIN_DOCUMENT;
+    pxParams->ulTwinVersion = 1;
+    pxParams->xAnswerTwinRequests = true;
+}
+/*-----------------------------------------------------------*/
+
+void Loopback_Reconnect( LoopbackTransportParams_t * pxParams )
+{
+    pxParams->xHeaderLength = 0;
+    pxParams->xRemainingLength = 0;
+    pxParams->xBodyReceived = 0;
+    pxParams->xHeaderComplete = false;
+    pxParams->xSentSinceRead = false;
+    pxParams->xToClientHead = 0;
+    pxParams->xToClientLength = 0;
+}
+/*-----------------------------------------------------------*/
+
+bool Loopback_InjectCloudToDevice( LoopbackTransportParams_t * pxParams,
+                                   const uint8_t * pucPayload,
+                                   uint32_t ulPayloadLength )
+{
+    char cTopic[ loopbackMAX_TOPIC_LENGTH ];
+    int lLength = snprintf( cTopic, sizeof( cTopic ), "devices/%s/messages/devicebound/", pxParams->pcDeviceId );
+
+    return ( lLength > 0 ) && ( ( size_t ) lLength < sizeof( cTopic ) ) &&
+           prvQueuePublish( pxParams, cTopic, true, pucPayload, ulPayloadLength, NULL );
+}
+/*-----------------------------------------------------------*/
+
+bool Loopback_InjectCommand( LoopbackTransportParams_t * pxParams,
+                             const char * pcCommandName,
+                             uint32_t ulRequestId,
+                             const uint8_t * pucPayload,
+                             uint32_t ulPayloadLength )
+{
+    char cTopic[ loopbackMAX_TOPIC_LENGTH ];
+    int lLength = snprintf( cTopic, sizeof( cTopic ), "$iothub/methods/POST/%s/?$rid=%u",
+                            pcCommandName, ( unsigned ) ulRequestId );
+
+    return ( lLength > 0 ) && ( ( size_t ) lLength < sizeof( cTopic ) ) &&
+           prvQueuePublish( pxParams, cTopic, false, pucPayload, ulPayloadLength, NULL );
+}
+/*-----------------------------------------------------------*/
+
+bool Loopback_InjectDesiredProperties( LoopbackTransportParams_t * pxParams,
+                                       const uint8_t * pucPayload,
+                                       uint32_t ulPayloadLength )
+{
+    char cTopic[ loopbackMAX_TOPIC_LENGTH ];
+    char cVersion[ 24 ];
+
+    if( ( ulPayloadLength < 2 ) || ( pucPayload[ 0 ] != '{' ) || ( pucPayload[ ulPayloadLength - 1 ] != '}' ) )
+    {
+        return false;
+    }
+
+    pxParams->ulTwinVersion++;
+    ( void ) snprintf( cTopic, sizeof( cTopic ), "$iothub/twin/PATCH/properties/desired/?$version=%u",
+                       ( unsigned ) pxParams->ulTwinVersion );
+
+    /* Replace the closing brace with the version. */
+    ( void ) snprintf( cVersion, sizeof( cVersion ), "%s\"$version\":%u}",
+                       ( ulPayloadLength > 2 ) ? "," : "", ( unsigned ) pxParams->ulTwinVersion );
+
+    return prvQueuePublish( pxParams, cTopic, false, pucPayload, ulPayloadLength - 1, cVersion );
+}
+/*-----------------------------------------------------------*/
+
+bool Loopback_InjectPacket( LoopbackTransportParams_t * pxParams,
+                            const uint8_t * pucPacket,
+                            size_t xPacketLength )
+{
+    if( !prvQueue( pxParams, pucPacket, xPacketLength ) )
+    {
+        return false;
+    }
+
+    if( ( xPacketLength > 0 ) && ( ( pucPacket[ 0 ] & 0xF0U ) == loopbackPUBLISH ) )
+    {
+        pxParams->xStats.ulPublishesToClient++;
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Loopback_Write( LoopbackTransportParams_t * pxParams,
+                        const void * pvBuffer,
+                        size_t xBytesToSend )
+{
+    const uint8_t * pucBytes = ( const uint8_t * ) pvBuffer;
+    size_t xIndex = 0;
+    size_t xCopy;
+
+    while( xIndex < xBytesToSend )
+    {
+        if( !pxParams->xHeaderComplete )
+        {
+            /* Fixed header: type and up to four bytes of remaining length. */
+            pxParams->ucHeader[ pxParams->xHeaderLength++ ] = pucBytes[ xIndex++ ];
+
+            if( ( pxParams->xHeaderLength >= 2 ) &&
+                ( ( pxParams->ucHeader[ pxParams->xHeaderLength - 1 ] & 0x80U ) == 0 ) )
+            {
+                pxParams->xRemainingLength = 0;
+
+                for( xCopy = pxParams->xHeaderLength - 1; xCopy > 0; xCopy-- )
+                {
+                    pxParams->xRemainingLength = ( pxParams->xRemainingLength << 7 ) |
+                                                 ( pxParams->ucHeader[ xCopy ] & 0x7FU );
+                }
+
+                pxParams->xHeaderComplete = true;
+                pxParams->xBodyReceived = 0;
+            }
+            else if( pxParams->xHeaderLength == sizeof( pxParams->ucHeader ) )
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            xCopy = pxParams->xRemainingLength - pxParams->xBodyReceived;
+
+            if( xCopy > xBytesToSend - xIndex )
+            {
+                xCopy = xBytesToSend - xIndex;
+            }
+
+            if( pxParams->xBodyReceived < loopbackPACKET_PREFIX_SIZE )
+            {
+                memcpy( &pxParams->ucPacket[ pxParams->xBodyReceived ], &pucBytes[ xIndex ],
+                        ( pxParams->xBodyReceived + xCopy <= loopbackPACKET_PREFIX_SIZE ) ?
+                        xCopy : loopbackPACKET_PREFIX_SIZE - pxParams->xBodyReceived );
+            }
+
+            pxParams->xBodyReceived += xCopy;
+            xIndex += xCopy;
+        }
+
+        if( pxParams->xHeaderComplete && ( pxParams->xBodyReceived == pxParams->xRemainingLength ) )
+        {
+            if( !prvHandlePacket( pxParams, pxParams->ucHeader[ 0 ], pxParams->xRemainingLength ) )
+            {
+                return -1;
+            }
+
+            pxParams->xHeaderComplete = false;
+            pxParams->xHeaderLength = 0;
+        }
+    }
+
+    pxParams->xStats.xBytesFromClient += xBytesToSend;
+    pxParams->xSentSinceRead = true;
+
+    return ( int32_t ) xBytesToSend;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Loopback_Read( LoopbackTransportParams_t * pxParams,
+                       void * pvBuffer,
+                       size_t xBytesToRecv )
+{
+    size_t xFirst;
+
+    if( xBytesToRecv > pxParams->xToClientLength )
+    {
+        xBytesToRecv = pxParams->xToClientLength;
+    }
+
+    xFirst = loopbackTO_CLIENT_BUFFER_SIZE - pxParams->xToClientHead;
+
+    if( xFirst > xBytesToRecv )
+    {
+        xFirst = xBytesToRecv;
+    }
+
+    memcpy( pvBuffer, &pxParams->ucToClient[ pxParams->xToClientHead ], xFirst );
+    memcpy( ( uint8_t * ) pvBuffer + xFirst, pxParams->ucToClient, xBytesToRecv - xFirst );
+    pxParams->xToClientHead = ( pxParams->xToClientHead + xBytesToRecv ) % loopbackTO_CLIENT_BUFFER_SIZE;
+    pxParams->xToClientLength -= xBytesToRecv;
+
+    if( ( xBytesToRecv > 0 ) && pxParams->xSentSinceRead )
+    {
+        pxParams->xSentSinceRead = false;
+        pxParams->xStats.ulRoundTrips++;
+    }
+
+    return ( int32_t ) xBytesToRecv;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Loopback_Send( NetworkContext_t * pxNetworkContext,
+                       const void * pvBuffer,
+                       size_t xBytesToSend )
+{
+    return Loopback_Write( pxNetworkContext->pParams, pvBuffer, xBytesToSend );
+}
+/*-----------------------------------------------------------*/
+
+int32_t Loopback_Recv( NetworkContext_t * pxNetworkContext,
+                       void * pvBuffer,
+                       size_t xBytesToRecv )
+{
+    return Loopback_Read( pxNetworkContext->pParams, pvBuffer, xBytesToRecv );
+}
+/*-----------------------------------------------------------*/
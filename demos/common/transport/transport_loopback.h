@@ -0,0 +1,196 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_loopback.h
+ * @brief In-memory transport with a scripted IoT Hub peer.
+ *
+ * Takes the place of TLS_Socket_Send and TLS_Socket_Recv in an
+ * #AzureIoTTransportInterface_t, to measure the client without TCP/IP and TLS.
+ * Every packet sent by the client is answered before the send returns:
+ *
+ * - CONNECT gets an accepting CONNACK. Session present is set when it and
+ *   the previous CONNECT both asked for a persistent session, see
+ *   #Loopback_Reconnect.
+ * - SUBSCRIBE gets a SUBACK granting every requested QoS.
+ * - PUBLISH at QoS 1 gets a PUBACK.
+ * - A twin GET gets the canned twin document, a reported properties PATCH
+ *   gets a 204 response with the next version.
+ * - PINGREQ gets a PINGRESP.
+ *
+ * Cloud to device messages, commands and desired property updates are queued
+ * with the Loopback_Inject functions and read by the next process loop.
+ *
+ * Not thread safe: send, receive and inject from the task running the client.
+ */
+
+#ifndef TRANSPORT_LOOPBACK_H
+#define TRANSPORT_LOOPBACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "azure_iot_transport_interface.h"
+
+/**
+ * @brief Bytes kept from each packet of the client, enough for the topic and
+ * the packet identifier. The rest of the payload is skipped.
+ */
+#ifndef loopbackPACKET_PREFIX_SIZE
+    #define loopbackPACKET_PREFIX_SIZE      ( 512U )
+#endif
+
+/**
+ * @brief Bytes queued for the client, responses and injected messages.
+ */
+#ifndef loopbackTO_CLIENT_BUFFER_SIZE
+    #define loopbackTO_CLIENT_BUFFER_SIZE    ( 4096U )
+#endif
+
+typedef struct NetworkContext NetworkContext_t;
+
+/**
+ * @brief Counters of the peer.
+ */
+typedef struct LoopbackStats
+{
+    size_t xBytesFromClient;
+    size_t xBytesToClient;
+    uint32_t ulPublishesFromClient;
+    uint32_t ulPublishesToClient;
+    uint32_t ulSubscribesFromClient;
+    uint32_t ulRoundTrips; /**< @brief Reads of the client getting bytes after it sent some, each a wait on the network. */
+} LoopbackStats_t;
+
+/**
+ * @brief State of the connection, the pParams of the #NetworkContext_t.
+ */
+typedef struct LoopbackTransportParams
+{
+    const char * pcDeviceId;     /**< @brief Device of the cloud to device topic. */
+    const char * pcTwinDocument; /**< @brief Answer to twin GET requests. */
+    uint32_t ulTwinVersion;      /**< @brief Version of the last twin update. */
+    bool xAnswerTwinRequests;    /**< @brief Answer twin GET and PATCH requests, true after #Loopback_Init. */
+    uint16_t usNextPacketId;
+    bool xPersistentSession;     /**< @brief The last CONNECT had clean session 0. */
+
+    /* Packet being received from the client. */
+    uint8_t ucPacket[ loopbackPACKET_PREFIX_SIZE ];
+    uint8_t ucHeader[ 5 ];
+    size_t xHeaderLength;
+    size_t xRemainingLength;
+    size_t xBodyReceived;
+    bool xHeaderComplete;
+
+    bool xSentSinceRead;
+
+    /* Ring of bytes for the client. */
+    uint8_t ucToClient[ loopbackTO_CLIENT_BUFFER_SIZE ];
+    size_t xToClientHead;
+    size_t xToClientLength;
+
+    LoopbackStats_t xStats;
+} LoopbackTransportParams_t;
+
+/**
+ * @brief Reset the connection.
+ *
+ * @param[out] pxParams Connection to reset.
+ * @param[in] pcDeviceId NULL terminated device id, used in the cloud to device
+ * topic.
+ * @param[in] pcTwinDocument NULL terminated twin document, or NULL for an
+ * empty one.
+ */
+void Loopback_Init( LoopbackTransportParams_t * pxParams,
+                    const char * pcDeviceId,
+                    const char * pcTwinDocument );
+
+/**
+ * @brief Start a new connection of the same device, keeping the session, the
+ * twin and the counters.
+ *
+ * Drops what was queued for the previous connection and any partial packet
+ * of the client.
+ *
+ * @param[in,out] pxParams Connection to restart.
+ */
+void Loopback_Reconnect( LoopbackTransportParams_t * pxParams );
+
+/**
+ * @brief Queue a cloud to device message, at QoS 1.
+ *
+ * @return false if there is not enough room for the message.
+ */
+bool Loopback_InjectCloudToDevice( LoopbackTransportParams_t * pxParams,
+                                   const uint8_t * pucPayload,
+                                   uint32_t ulPayloadLength );
+
+/**
+ * @brief Queue a command, at QoS 0 like IoT Hub.
+ *
+ * @param[in] pcCommandName NULL terminated command name, "component*name"
+ * for a component command.
+ * @param[in] ulRequestId Request id the response must carry.
+ *
+ * @return false if there is not enough room for the command.
+ */
+bool Loopback_InjectCommand( LoopbackTransportParams_t * pxParams,
+                             const char * pcCommandName,
+                             uint32_t ulRequestId,
+                             const uint8_t * pucPayload,
+                             uint32_t ulPayloadLength );
+
+/**
+ * @brief Queue a desired properties update, with the next twin version.
+ *
+ * @param[in] pucPayload Desired properties, without "$version".
+ *
+ * @return false if there is not enough room for the update.
+ */
+bool Loopback_InjectDesiredProperties( LoopbackTransportParams_t * pxParams,
+                                       const uint8_t * pucPayload,
+                                       uint32_t ulPayloadLength );
+
+/**
+ * @brief Queue a complete MQTT packet as it is.
+ *
+ * @return false if there is not enough room for the packet.
+ */
+bool Loopback_InjectPacket( LoopbackTransportParams_t * pxParams,
+                            const uint8_t * pucPacket,
+                            size_t xPacketLength );
+
+/**
+ * @brief #Loopback_Send for transports built on the peer.
+ */
+int32_t Loopback_Write( LoopbackTransportParams_t * pxParams,
+                        const void * pvBuffer,
+                        size_t xBytesToSend );
+
+/**
+ * @brief #Loopback_Recv for transports built on the peer.
+ */
+int32_t Loopback_Read( LoopbackTransportParams_t * pxParams,
+                       void * pvBuffer,
+                       size_t xBytesToRecv );
+
+/**
+ * @brief Send to the peer, which answers before returning.
+ *
+ * @return Number of bytes sent, or -1 if a response could not be queued.
+ */
+int32_t Loopback_Send( NetworkContext_t * pxNetworkContext,
+                       const void * pvBuffer,
+                       size_t xBytesToSend );
+
+/**
+ * @brief Receive what the peer queued.
+ *
+ * @return Number of bytes copied, 0 if nothing is queued.
+ */
+int32_t Loopback_Recv( NetworkContext_t * pxNetworkContext,
+                       void * pvBuffer,
+                       size_t xBytesToRecv );
+
+#endif /* TRANSPORT_LOOPBACK_H */
@@ -0,0 +1,328 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_replay.c
+ * @brief In-memory transport playing back the messages of a captured session.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "transport_replay.h"
+#include "transport_capture.h"
+
+/* Monotonic clock header. */
+#include "clock_service.h"
+
+/*-----------------------------------------------------------*/
+
+#define replayNEVER                 ( UINT64_MAX )
+
+#define replayPUBLISH               ( 0x30U )
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    ReplayTransportParams_t * pParams;
+};
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read a varint of the log.
+ *
+ * @return false if it is truncated or too long.
+ */
+static bool prvReadVarint( ReplayTransportParams_t * pxParams,
+                           uint64_t * pullValue )
+{
+    uint32_t ulShift = 0;
+    uint8_t ucByte;
+
+    *pullValue = 0;
+
+    do
+    {
+        if( ( pxParams->xLogOffset >= pxParams->xLogLength ) || ( ulShift > 63 ) )
+        {
+            return false;
+        }
+
+        ucByte = pxParams->pucLog[ pxParams->xLogOffset++ ];
+        *pullValue |= ( uint64_t ) ( ucByte & 0x7FU ) << ulShift;
+        ulShift += 7;
+    } while( ( ucByte & 0x80U ) != 0 );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Read the next record of the log.
+ *
+ * @return false at the end of the log or if it is malformed.
+ */
+static bool prvReadRecord( ReplayTransportParams_t * pxParams )
+{
+    uint64_t ullDeltaUs;
+    uint64_t ullLength = 0;
+    uint8_t ucType;
+
+    if( pxParams->xLogError || ( pxParams->xLogOffset >= pxParams->xLogLength ) )
+    {
+        return false;
+    }
+
+    ucType = pxParams->pucLog[ pxParams->xLogOffset++ ];
+
+    if( !prvReadVarint( pxParams, &ullDeltaUs ) ||
+        ( ( ucType != captureRECORD_CONNECT ) && !prvReadVarint( pxParams, &ullLength ) ) ||
+        ( ullLength > pxParams->xLogLength - pxParams->xLogOffset ) )
+    {
+        pxParams->xLogError = true;
+
+        return false;
+    }
+
+    /* The recording starts with its first record. */
+    pxParams->ullRecordedUs = pxParams->xFirstRecord ? 0 : pxParams->ullRecordedUs + ullDeltaUs;
+    pxParams->xFirstRecord = false;
+
+    switch( ucType )
+    {
+        case captureRECORD_CONNECT:
+
+            /* A new stream, drop what is left of a packet of the last one. */
+            pxParams->xStats.ulConnections++;
+            pxParams->xPacketReceived = 0;
+            pxParams->xPacketSize = 0;
+            break;
+
+        case captureRECORD_RECV:
+            pxParams->pucRecord = &pxParams->pucLog[ pxParams->xLogOffset ];
+            pxParams->xRecordRemaining = ( size_t ) ullLength;
+            break;
+
+        case captureRECORD_SEND:
+            break;
+
+        default:
+            pxParams->xLogError = true;
+
+            return false;
+    }
+
+    pxParams->xLogOffset += ( size_t ) ullLength;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reassemble recorded packets from the rest of the receive record
+ * until one to replay is complete.
+ */
+static void prvReadPackets( ReplayTransportParams_t * pxParams )
+{
+    size_t xCopy;
+    size_t xIndex;
+    size_t xRemainingLength;
+    uint8_t ucByte;
+
+    while( ( pxParams->xRecordRemaining > 0 ) && !pxParams->xPacketReady )
+    {
+        if( pxParams->xPacketSize == 0 )
+        {
+            /* Fixed header: type and up to four bytes of remaining length. */
+            ucByte = *pxParams->pucRecord++;
+            pxParams->xRecordRemaining--;
+            pxParams->ucPacket[ pxParams->xPacketReceived++ ] = ucByte;
+
+            if( ( pxParams->xPacketReceived >= 2 ) && ( ( ucByte & 0x80U ) == 0 ) )
+            {
+                xRemainingLength = 0;
+
+                for( xIndex = pxParams->xPacketReceived - 1; xIndex > 0; xIndex-- )
+                {
+                    xRemainingLength = ( xRemainingLength << 7 ) | ( pxParams->ucPacket[ xIndex ] & 0x7FU );
+                }
+
+                pxParams->xPacketSize = pxParams->xPacketReceived + xRemainingLength;
+            }
+            else if( pxParams->xPacketReceived == 5 )
+            {
+                pxParams->xLogError = true;
+                pxParams->xRecordRemaining = 0;
+
+                return;
+            }
+        }
+        else
+        {
+            xCopy = pxParams->xPacketSize - pxParams->xPacketReceived;
+
+            if( xCopy > pxParams->xRecordRemaining )
+            {
+                xCopy = pxParams->xRecordRemaining;
+            }
+
+            if( pxParams->xPacketReceived + xCopy <= replayMAX_PACKET_SIZE )
+            {
+                memcpy( &pxParams->ucPacket[ pxParams->xPacketReceived ], pxParams->pucRecord, xCopy );
+            }
+
+            pxParams->pucRecord += xCopy;
+            pxParams->xRecordRemaining -= xCopy;
+            pxParams->xPacketReceived += xCopy;
+        }
+
+        if( ( pxParams->xPacketSize != 0 ) && ( pxParams->xPacketReceived == pxParams->xPacketSize ) )
+        {
+            if( pxParams->xPacketSize > replayMAX_PACKET_SIZE )
+            {
+                pxParams->xStats.ulPacketsTooLarge++;
+            }
+            else if( ( pxParams->ucPacket[ 0 ] & 0xF0U ) == replayPUBLISH )
+            {
+                pxParams->xPacketReady = true;
+                pxParams->ullPacketRecordedUs = pxParams->ullRecordedUs;
+            }
+            else
+            {
+                pxParams->xStats.ulPacketsSkipped++;
+            }
+
+            if( !pxParams->xPacketReady )
+            {
+                pxParams->xPacketReceived = 0;
+                pxParams->xPacketSize = 0;
+            }
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue the recorded packets that are due for the client.
+ *
+ * @return Time the next packet is due, replayNEVER at the end of the log.
+ */
+static uint64_t prvQueueDuePackets( ReplayTransportParams_t * pxParams,
+                                    uint64_t ullNowUs )
+{
+    uint64_t ullDueUs;
+
+    for( ; ; )
+    {
+        if( pxParams->xPacketReady )
+        {
+            ullDueUs = ( pxParams->ulSpeedPercent == 0 ) ? 0 :
+                       pxParams->ullStartUs + pxParams->ullPacketRecordedUs * 100U / pxParams->ulSpeedPercent;
+
+            if( ullDueUs > ullNowUs )
+            {
+                return ullDueUs;
+            }
+
+            /* Wait for the client to read what is queued. */
+            if( !Loopback_InjectPacket( &pxParams->xPeer, pxParams->ucPacket, pxParams->xPacketSize ) )
+            {
+                return ullNowUs;
+            }
+
+            pxParams->xStats.ulPublishesReplayed++;
+            pxParams->xPacketReady = false;
+            pxParams->xPacketReceived = 0;
+            pxParams->xPacketSize = 0;
+        }
+        else if( pxParams->xRecordRemaining > 0 )
+        {
+            prvReadPackets( pxParams );
+        }
+        else if( !prvReadRecord( pxParams ) )
+        {
+            return replayNEVER;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+bool Replay_Init( ReplayTransportParams_t * pxParams,
+                  const char * pcDeviceId,
+                  const uint8_t * pucLog,
+                  size_t xLogLength,
+                  uint32_t ulSpeedPercent )
+{
+    configASSERT( ( pxParams != NULL ) && ( pucLog != NULL ) );
+
+    memset( pxParams, 0, sizeof( ReplayTransportParams_t ) );
+
+    if( ( xLogLength < captureMAGIC_LENGTH ) || ( memcmp( pucLog, captureMAGIC, captureMAGIC_LENGTH ) != 0 ) )
+    {
+        return false;
+    }
+
+    /* Twin requests are answered by the recording. */
+    Loopback_Init( &pxParams->xPeer, pcDeviceId, NULL );
+    pxParams->xPeer.xAnswerTwinRequests = false;
+
+    pxParams->pucLog = pucLog;
+    pxParams->xLogLength = xLogLength;
+    pxParams->xLogOffset = captureMAGIC_LENGTH;
+    pxParams->ulSpeedPercent = ulSpeedPercent;
+    pxParams->ullStartUs = Clock_GetMonotonicUs();
+    pxParams->xFirstRecord = true;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+bool Replay_IsFinished( const ReplayTransportParams_t * pxParams )
+{
+    return ( pxParams->xLogError || ( pxParams->xLogOffset >= pxParams->xLogLength ) ) &&
+           ( pxParams->xRecordRemaining == 0 ) && !pxParams->xPacketReady &&
+           ( pxParams->xPeer.xToClientLength == 0 );
+}
+/*-----------------------------------------------------------*/
+
+int32_t Replay_Send( NetworkContext_t * pxNetworkContext,
+                     const void * pvBuffer,
+                     size_t xBytesToSend )
+{
+    return Loopback_Write( &pxNetworkContext->pParams->xPeer, pvBuffer, xBytesToSend );
+}
+/*-----------------------------------------------------------*/
+
+int32_t Replay_Recv( NetworkContext_t * pxNetworkContext,
+                     void * pvBuffer,
+                     size_t xBytesToRecv )
+{
+    ReplayTransportParams_t * pxParams = pxNetworkContext->pParams;
+    uint64_t ullNowUs = Clock_GetMonotonicUs();
+    uint64_t ullDueUs = prvQueueDuePackets( pxParams, ullNowUs );
+    int32_t lReceived = Loopback_Read( &pxParams->xPeer, pvBuffer, xBytesToRecv );
+    uint64_t ullWaitUs;
+
+    if( ( lReceived == 0 ) && ( ullDueUs != replayNEVER ) && ( ullDueUs > ullNowUs ) )
+    {
+        ullWaitUs = ullDueUs - ullNowUs;
+
+        if( ullWaitUs > replayPOLL_INTERVAL_MS * 1000U )
+        {
+            ullWaitUs = replayPOLL_INTERVAL_MS * 1000U;
+        }
+
+        /* Round up so the packet is due after the wait. */
+        vTaskDelay( pdMS_TO_TICKS( ( uint32_t ) ( ullWaitUs / 1000U ) ) + 1 );
+
+        ( void ) prvQueueDuePackets( pxParams, Clock_GetMonotonicUs() );
+        lReceived = Loopback_Read( &pxParams->xPeer, pvBuffer, xBytesToRecv );
+    }
+
+    return lReceived;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,134 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_replay.h
+ * @brief In-memory transport playing back the messages of a captured session.
+ *
+ * Reads a log written by transport_capture.h and delivers the PUBLISH
+ * packets IoT Hub sent in it, twin responses, desired property updates,
+ * commands and cloud to device messages, at their recorded times divided by
+ * a speed factor. The packets of the client are answered by the scripted
+ * peer of transport_loopback.h instead of the recording, so the client does
+ * not need to repeat the recorded session exactly: CONNACK, SUBACK, PUBACK
+ * and PINGRESP follow its own packets, twin requests get the recorded
+ * responses.
+ *
+ * Recorded acknowledgements are skipped, as are packets larger than
+ * #replayMAX_PACKET_SIZE. Not thread safe: send and receive from the task
+ * running the client.
+ */
+
+#ifndef TRANSPORT_REPLAY_H
+#define TRANSPORT_REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "transport_loopback.h"
+
+/**
+ * @brief Largest recorded packet replayed.
+ */
+#ifndef replayMAX_PACKET_SIZE
+    #define replayMAX_PACKET_SIZE        loopbackTO_CLIENT_BUFFER_SIZE
+#endif
+
+/**
+ * @brief Longest wait of a receive for the next recorded packet.
+ */
+#ifndef replayPOLL_INTERVAL_MS
+    #define replayPOLL_INTERVAL_MS       ( 10U )
+#endif
+
+/**
+ * @brief Counters of a replay.
+ */
+typedef struct ReplayStats
+{
+    uint32_t ulConnections;       /**< @brief Connections of the recording read so far. */
+    uint32_t ulPublishesReplayed;
+    uint32_t ulPacketsSkipped;    /**< @brief Recorded acknowledgements. */
+    uint32_t ulPacketsTooLarge;
+} ReplayStats_t;
+
+/**
+ * @brief State of a replay, the pParams of the #NetworkContext_t.
+ */
+typedef struct ReplayTransportParams
+{
+    LoopbackTransportParams_t xPeer;
+
+    const uint8_t * pucLog;
+    size_t xLogLength;
+    size_t xLogOffset;
+    bool xLogError;
+
+    uint32_t ulSpeedPercent;
+    uint64_t ullStartUs;          /**< @brief Replay time of the start of the recording. */
+    uint64_t ullRecordedUs;       /**< @brief Recorded time of the last record read. */
+    bool xFirstRecord;
+
+    /* Rest of the receive record being read. */
+    const uint8_t * pucRecord;
+    size_t xRecordRemaining;
+
+    /* Recorded packet being reassembled. */
+    uint8_t ucPacket[ replayMAX_PACKET_SIZE ];
+    size_t xPacketReceived;
+    size_t xPacketSize;           /**< @brief Header and body, 0 until the header is complete. */
+    bool xPacketReady;
+    uint64_t ullPacketRecordedUs;
+
+    ReplayStats_t xStats;
+} ReplayTransportParams_t;
+
+/**
+ * @brief Start a replay.
+ *
+ * @param[out] pxParams Replay to initialize.
+ * @param[in] pcDeviceId NULL terminated device id of the client.
+ * @param[in] pucLog Log written by transport_capture.h, kept until the end of
+ * the replay.
+ * @param[in] xLogLength Length of @p pucLog.
+ * @param[in] ulSpeedPercent 100 replays at the recorded speed, 200 twice as
+ * fast, 0 without waiting.
+ *
+ * @return false if @p pucLog is not a capture log.
+ */
+bool Replay_Init( ReplayTransportParams_t * pxParams,
+                  const char * pcDeviceId,
+                  const uint8_t * pucLog,
+                  size_t xLogLength,
+                  uint32_t ulSpeedPercent );
+
+/**
+ * @brief Whether every recorded packet was delivered and read.
+ *
+ * @return true at the end of the log, or if it is malformed.
+ */
+bool Replay_IsFinished( const ReplayTransportParams_t * pxParams );
+
+/**
+ * @brief Send to the scripted peer, which answers before returning.
+ *
+ * @return Number of bytes sent, or -1 if a response could not be queued.
+ */
+int32_t Replay_Send( NetworkContext_t * pxNetworkContext,
+                     const void * pvBuffer,
+                     size_t xBytesToSend );
+
+/**
+ * @brief Receive the answers of the peer and the recorded packets that are
+ * due.
+ *
+ * Waits up to #replayPOLL_INTERVAL_MS for the next recorded packet.
+ *
+ * @return Number of bytes copied, 0 if nothing is due.
+ */
+int32_t Replay_Recv( NetworkContext_t * pxNetworkContext,
+                     void * pvBuffer,
+                     size_t xBytesToRecv );
+
+#endif /* TRANSPORT_REPLAY_H */
@@ -0,0 +1,210 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_streaming.c
+ * @brief Transport decorator writing message payloads from a generator.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+/* Logging configuration for the streaming transport. */
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "Streaming"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "transport_streaming.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether a send is the next part of the armed payload.
+ *
+ * The MQTT library advances the payload pointer by what each send took, so
+ * the next part starts @p ulSent bytes after the chunk.
+ */
+static bool prvIsPayload( const StreamingTransport_t * pxStreaming,
+                          const void * pvBuffer )
+{
+    return ( pxStreaming->xGenerator != NULL ) &&
+           ( ( uintptr_t ) pvBuffer == ( uintptr_t ) pxStreaming->ucChunk + pxStreaming->ulSent );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the next bytes of the armed payload, generating a chunk when
+ * the previous one is sent.
+ */
+static int32_t prvSendPayload( StreamingTransport_t * pxStreaming,
+                               size_t xBytesToSend )
+{
+    uint32_t ulRemaining = pxStreaming->ulLength - pxStreaming->ulSent;
+    int32_t lGenerated;
+    int32_t lSent;
+
+    if( pxStreaming->ulChunkLength == 0 )
+    {
+        lGenerated = pxStreaming->xGenerator( pxStreaming->pvGeneratorContext, pxStreaming->ulSent,
+                                              pxStreaming->ucChunk, streamingCHUNK_SIZE );
+
+        if( ( lGenerated <= 0 ) || ( ( uint32_t ) lGenerated > ulRemaining ) )
+        {
+            LogError( ( "Payload generator failed at %u of %u bytes: %d",
+                        ( unsigned ) pxStreaming->ulSent, ( unsigned ) pxStreaming->ulLength, ( int ) lGenerated ) );
+            pxStreaming->xBroken = true;
+
+            return -1;
+        }
+
+        pxStreaming->ulChunkHead = 0;
+        pxStreaming->ulChunkLength = ( uint32_t ) lGenerated;
+    }
+
+    if( xBytesToSend > pxStreaming->ulChunkLength )
+    {
+        xBytesToSend = pxStreaming->ulChunkLength;
+    }
+
+    lSent = pxStreaming->xInnerSend( pxStreaming->pxInnerContext,
+                                     &pxStreaming->ucChunk[ pxStreaming->ulChunkHead ], xBytesToSend );
+
+    if( lSent < 0 )
+    {
+        pxStreaming->xBroken = true;
+    }
+    else
+    {
+        pxStreaming->ulChunkHead += ( uint32_t ) lSent;
+        pxStreaming->ulChunkLength -= ( uint32_t ) lSent;
+        pxStreaming->ulSent += ( uint32_t ) lSent;
+    }
+
+    return lSent;
+}
+/*-----------------------------------------------------------*/
+
+void Streaming_Wrap( StreamingTransport_t * pxStreaming,
+                     AzureIoTTransportInterface_t * pxTransport )
+{
+    configASSERT( ( pxStreaming != NULL ) && ( pxTransport != NULL ) );
+
+    memset( pxStreaming, 0, sizeof( StreamingTransport_t ) );
+    pxStreaming->pxInnerContext = pxTransport->pxNetworkContext;
+    pxStreaming->xInnerSend = pxTransport->xSend;
+    pxStreaming->xInnerRecv = pxTransport->xRecv;
+
+    /* The wrapper is its own network context, only this file dereferences it. */
+    pxTransport->pxNetworkContext = ( NetworkContext_t * ) pxStreaming;
+    pxTransport->xSend = Streaming_Send;
+    pxTransport->xRecv = Streaming_Recv;
+}
+/*-----------------------------------------------------------*/
+
+void Streaming_Reconnect( StreamingTransport_t * pxStreaming )
+{
+    pxStreaming->xGenerator = NULL;
+    pxStreaming->xBroken = false;
+}
+/*-----------------------------------------------------------*/
+
+bool Streaming_Measure( StreamingTransport_t * pxStreaming,
+                        StreamingGenerator_t xGenerator,
+                        void * pvContext,
+                        uint32_t * pulLength )
+{
+    uint32_t ulLength = 0;
+    int32_t lGenerated;
+
+    if( pxStreaming->xGenerator != NULL )
+    {
+        return false;
+    }
+
+    while( ( lGenerated = xGenerator( pvContext, ulLength, pxStreaming->ucChunk, streamingCHUNK_SIZE ) ) > 0 )
+    {
+        ulLength += ( uint32_t ) lGenerated;
+    }
+
+    if( lGenerated < 0 )
+    {
+        LogError( ( "Payload generator failed at %u bytes: %d", ( unsigned ) ulLength, ( int ) lGenerated ) );
+        return false;
+    }
+
+    *pulLength = ulLength;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+const uint8_t * Streaming_Arm( StreamingTransport_t * pxStreaming,
+                               StreamingGenerator_t xGenerator,
+                               void * pvContext,
+                               uint32_t ulLength )
+{
+    configASSERT( ( xGenerator != NULL ) && ( ulLength != 0 ) );
+
+    pxStreaming->xGenerator = xGenerator;
+    pxStreaming->pvGeneratorContext = pvContext;
+    pxStreaming->ulLength = ulLength;
+    pxStreaming->ulSent = 0;
+    pxStreaming->ulChunkHead = 0;
+    pxStreaming->ulChunkLength = 0;
+
+    return pxStreaming->ucChunk;
+}
+/*-----------------------------------------------------------*/
+
+void Streaming_Disarm( StreamingTransport_t * pxStreaming )
+{
+    /* The rest of the packet never follows. */
+    if( ( pxStreaming->ulSent != 0 ) && ( pxStreaming->ulSent != pxStreaming->ulLength ) )
+    {
+        pxStreaming->xBroken = true;
+    }
+
+    pxStreaming->xGenerator = NULL;
+}
+/*-----------------------------------------------------------*/
+
+int32_t Streaming_Send( NetworkContext_t * pxNetworkContext,
+                        const void * pvBuffer,
+                        size_t xBytesToSend )
+{
+    StreamingTransport_t * pxStreaming = ( StreamingTransport_t * ) pxNetworkContext;
+
+    if( pxStreaming->xBroken )
+    {
+        return -1;
+    }
+
+    if( prvIsPayload( pxStreaming, pvBuffer ) )
+    {
+        return prvSendPayload( pxStreaming, xBytesToSend );
+    }
+
+    return pxStreaming->xInnerSend( pxStreaming->pxInnerContext, pvBuffer, xBytesToSend );
+}
+/*-----------------------------------------------------------*/
+
+int32_t Streaming_Recv( NetworkContext_t * pxNetworkContext,
+                        void * pvBuffer,
+                        size_t xBytesToRecv )
+{
+    StreamingTransport_t * pxStreaming = ( StreamingTransport_t * ) pxNetworkContext;
+
+    if( pxStreaming->xBroken )
+    {
+        return -1;
+    }
+
+    return pxStreaming->xInnerRecv( pxStreaming->pxInnerContext, pvBuffer, xBytesToRecv );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,176 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file transport_streaming.h
+ * @brief Transport decorator writing message payloads from a generator.
+ *
+ * Wraps the send and receive functions of an #AzureIoTTransportInterface_t
+ * so a publish can carry a payload that is never held in memory as a whole.
+ * The payload is produced by a #StreamingGenerator_t, one chunk of
+ * #streamingCHUNK_SIZE bytes at a time, while the MQTT library writes it to
+ * the transport after the fixed header and the topic:
+ *
+ * - #Streaming_Arm takes the generator and the payload length, which goes
+ *   into the fixed header before any of the payload exists, and returns the
+ *   pointer to publish as the payload.
+ * - Sends of that pointer, advanced by the bytes already sent, are filled
+ *   from the generator. Every other send goes to the wrapped transport as is.
+ * - #Streaming_Disarm ends the publish.
+ *
+ * When the length is not known in advance, #Streaming_Measure runs the
+ * generator once without sending anything. The generator must then produce
+ * the same bytes when it runs again from offset 0.
+ *
+ * Once part of a payload is sent, a generator error or a length that does
+ * not match leaves the peer in the middle of a packet. Send and receive then
+ * fail until the next #Streaming_Reconnect, so the client reconnects.
+ *
+ * Wrap last, after any other decorator, so the decorators below it see the
+ * generated bytes. Not thread safe: use one wrapper per connection, from
+ * the task running its client.
+ */
+
+#ifndef TRANSPORT_STREAMING_H
+#define TRANSPORT_STREAMING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "azure_iot_transport_interface.h"
+
+/**
+ * @brief Bytes generated and sent at a time, also the largest TLS record of
+ * a streamed payload.
+ */
+#ifndef streamingCHUNK_SIZE
+    #define streamingCHUNK_SIZE    ( 256U )
+#endif
+
+/**
+ * @brief Producer of a payload.
+ *
+ * @param[in] pvContext Context given with the generator.
+ * @param[in] ulOffset Bytes produced so far. 0 starts the payload over.
+ * @param[out] pucBuffer Buffer for the next bytes.
+ * @param[in] ulBufferSize Size of @p pucBuffer, #streamingCHUNK_SIZE.
+ * @return Number of bytes written, 0 at the end of the payload, or a
+ * negative value on error.
+ */
+typedef int32_t ( * StreamingGenerator_t )( void * pvContext,
+                                            uint32_t ulOffset,
+                                            uint8_t * pucBuffer,
+                                            uint32_t ulBufferSize );
+
+/**
+ * @brief State of one wrapper.
+ *
+ * The wrapped interface is given a pointer to this structure as its network
+ * context.
+ */
+typedef struct StreamingTransport
+{
+    /* Wrapped transport. */
+    NetworkContext_t * pxInnerContext;
+    AzureIoTTransportSend_t xInnerSend;
+    AzureIoTTransportRecv_t xInnerRecv;
+
+    /* Armed payload, no generator when disarmed. */
+    StreamingGenerator_t xGenerator;
+    void * pvGeneratorContext;
+    uint32_t ulLength;
+    uint32_t ulSent;
+
+    /* Generated bytes not sent yet. The chunk is also the payload pointer
+     * given to the MQTT library, no other send uses it. */
+    uint8_t ucChunk[ streamingCHUNK_SIZE ];
+    uint32_t ulChunkHead;
+    uint32_t ulChunkLength;
+
+    bool xBroken;
+} StreamingTransport_t;
+
+/**
+ * @brief Put the wrapper between a client and a connected transport.
+ *
+ * Call before the client is initialized with @p pxTransport.
+ *
+ * @param[out] pxStreaming Wrapper to initialize.
+ * @param[in,out] pxTransport Interface of the transport, replaced by the
+ * interface of the wrapper.
+ */
+void Streaming_Wrap( StreamingTransport_t * pxStreaming,
+                     AzureIoTTransportInterface_t * pxTransport );
+
+/**
+ * @brief Start a new connection of the wrapped transport.
+ *
+ * Clears a broken stream. Call after every connect of the wrapped transport
+ * but the one before #Streaming_Wrap.
+ *
+ * @param[in] pxStreaming Wrapper.
+ */
+void Streaming_Reconnect( StreamingTransport_t * pxStreaming );
+
+/**
+ * @brief Length of a payload, from a run of its generator.
+ *
+ * @param[in] pxStreaming Wrapper, not armed. Its chunk is the buffer of the
+ * generator.
+ * @param[in] xGenerator Generator of the payload.
+ * @param[in] pvContext Context of @p xGenerator.
+ * @param[out] pulLength Length of the payload.
+ * @return false on a generator error, or if the wrapper is armed.
+ */
+bool Streaming_Measure( StreamingTransport_t * pxStreaming,
+                        StreamingGenerator_t xGenerator,
+                        void * pvContext,
+                        uint32_t * pulLength );
+
+/**
+ * @brief Generate the payload of the next publish.
+ *
+ * @param[in] pxStreaming Wrapper.
+ * @param[in] xGenerator Generator of the payload.
+ * @param[in] pvContext Context of @p xGenerator.
+ * @param[in] ulLength Exact length of the payload, not 0.
+ * @return The payload pointer to publish with a length of @p ulLength. It
+ * must not be read.
+ */
+const uint8_t * Streaming_Arm( StreamingTransport_t * pxStreaming,
+                               StreamingGenerator_t xGenerator,
+                               void * pvContext,
+                               uint32_t ulLength );
+
+/**
+ * @brief End the publish started by #Streaming_Arm, once the MQTT library
+ * returned.
+ *
+ * A payload sent in part breaks the stream.
+ *
+ * @param[in] pxStreaming Wrapper.
+ */
+void Streaming_Disarm( StreamingTransport_t * pxStreaming );
+
+/**
+ * @brief Send bytes, generating the payload when the armed pointer is sent.
+ *
+ * @return Number of bytes sent, or -1 on a broken stream or an error of the
+ * wrapped transport.
+ */
+int32_t Streaming_Send( NetworkContext_t * pxNetworkContext,
+                        const void * pvBuffer,
+                        size_t xBytesToSend );
+
+/**
+ * @brief Receive from the wrapped transport.
+ *
+ * @return Number of bytes received, or -1 on a broken stream or an error of
+ * the wrapped transport.
+ */
+int32_t Streaming_Recv( NetworkContext_t * pxNetworkContext,
+                        void * pvBuffer,
+                        size_t xBytesToRecv );
+
+#endif /* TRANSPORT_STREAMING_H */
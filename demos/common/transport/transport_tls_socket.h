@@ -14,6 +14,13 @@ typedef struct TlsTransportParams
 {
     SocketHandle xTCPSocket;
     SSLContextHandle xSSLContext;
+
+    /**
+     * @brief Optional layer between TLS and the socket, NULL to use the
+     * socket directly. The TCP connect and every TLS record, the handshake
+     * included, go through it.
+     */
+    const SocketsInterposer_t * pxInterposer;
 } TlsTransportParams_t;
 
 /**
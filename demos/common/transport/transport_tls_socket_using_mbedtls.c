@@ -55,6 +55,14 @@ extern void vLoggingPrintf( const char * pcFormatString,
 #include "mbedtls/x509.h"
 #include "mbedtls/error.h"
 
+/* Spans of the trace recorder, see trace_recorder_hooks.h. */
+#ifndef traceSPAN_BEGIN
+    #define traceSPAN_BEGIN( pcName )
+#endif
+#ifndef traceSPAN_END
+    #define traceSPAN_END( pcName )
+#endif
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -513,6 +521,57 @@ static TlsTransportStatus_t tlsSetup( NetworkContext_t * pxNetworkContext,
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Connect the socket, through the interposer if there is one.
+ */
+static BaseType_t socketConnect( TlsTransportParams_t * pxTlsTransportParams,
+                                 const char * pcHostName,
+                                 uint16_t usPort )
+{
+    const SocketsInterposer_t * pxInterposer = pxTlsTransportParams->pxInterposer;
+
+    if( pxInterposer != NULL )
+    {
+        return pxInterposer->xConnect( pxInterposer->pvContext, pxTlsTransportParams->xTCPSocket,
+                                       pcHostName, usPort );
+    }
+
+    return Sockets_Connect( pxTlsTransportParams->xTCPSocket, pcHostName, usPort );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send of the mbed TLS connection through the interposer of the
+ * transport parameters given as @p pvContext.
+ */
+static int interposedSend( void * pvContext,
+                           const unsigned char * pucBuffer,
+                           size_t xLength )
+{
+    TlsTransportParams_t * pxTlsTransportParams = ( TlsTransportParams_t * ) pvContext;
+    const SocketsInterposer_t * pxInterposer = pxTlsTransportParams->pxInterposer;
+
+    return ( int ) pxInterposer->xSend( pxInterposer->pvContext, pxTlsTransportParams->xTCPSocket,
+                                        pucBuffer, xLength );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Receive of the mbed TLS connection through the interposer of the
+ * transport parameters given as @p pvContext.
+ */
+static int interposedRecv( void * pvContext,
+                           unsigned char * pucBuffer,
+                           size_t xLength )
+{
+    TlsTransportParams_t * pxTlsTransportParams = ( TlsTransportParams_t * ) pvContext;
+    const SocketsInterposer_t * pxInterposer = pxTlsTransportParams->pxInterposer;
+
+    return ( int ) pxInterposer->xRecv( pxInterposer->pvContext, pxTlsTransportParams->xTCPSocket,
+                                        pucBuffer, xLength );
+}
+/*-----------------------------------------------------------*/
+
 static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pxNetworkContext,
                                           const NetworkCredentials_t * pxNetworkCredentials )
 {
@@ -550,22 +609,37 @@ static TlsTransportStatus_t tlsHandshake( NetworkContext_t * pxNetworkContext,
          * #mbedtls_ssl_set_bio requires the second parameter as void *.
          */
         /* coverity[misra_c_2012_rule_11_2_violation] */
-        mbedtls_ssl_set_bio( &( pxSSLContext->context ),
-                             ( void * ) pxTlsTransportParams->xTCPSocket,
-                             mbedtls_platform_send,
-                             mbedtls_platform_recv,
-                             NULL );
+        if( pxTlsTransportParams->pxInterposer != NULL )
+        {
+            mbedtls_ssl_set_bio( &( pxSSLContext->context ),
+                                 ( void * ) pxTlsTransportParams,
+                                 interposedSend,
+                                 interposedRecv,
+                                 NULL );
+        }
+        else
+        {
+            mbedtls_ssl_set_bio( &( pxSSLContext->context ),
+                                 ( void * ) pxTlsTransportParams->xTCPSocket,
+                                 mbedtls_platform_send,
+                                 mbedtls_platform_recv,
+                                 NULL );
+        }
     }
 
     if( xRetVal == eTLSTransportSuccess )
     {
         /* Perform the TLS handshake. */
+        traceSPAN_BEGIN( "TLS handshake" );
+
         do
         {
             lMbedtlsError = mbedtls_ssl_handshake( &( pxSSLContext->context ) );
         } while( ( lMbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
                  ( lMbedtlsError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
 
+        traceSPAN_END( "TLS handshake" );
+
         if( lMbedtlsError != 0 )
         {
             LogError( ( "Failed to perform TLS handshake: lMbedtlsError[%d]= %s : %s.",
@@ -657,6 +731,8 @@ TlsTransportStatus_t TLS_Socket_Connect( NetworkContext_t * pxNetworkContext,
     TickType_t xRecvTimeout = pdMS_TO_TICKS( ulReceiveTimeoutMs );
     TickType_t xSendTimeout = pdMS_TO_TICKS( ulSendTimeoutMs );
 
+    traceSPAN_BEGIN( "TLS_Socket_Connect" );
+
     if( ( pxNetworkContext == NULL ) ||
         ( pxNetworkContext->pParams == NULL ) ||
         ( pcHostName == NULL ) ||
@@ -705,9 +781,9 @@ TlsTransportStatus_t TLS_Socket_Connect( NetworkContext_t * pxNetworkContext,
             LogError( ( "Failed to set send timeout on socket %d.", xSocketStatus ) );
             xRetVal = eTLSTransportInternalError;
         }
-        else if( ( xSocketStatus = Sockets_Connect( pxTlsTransportParams->xTCPSocket,
-                                                    pcHostName,
-                                                    usPort ) ) != 0 )
+        else if( ( xSocketStatus = socketConnect( pxTlsTransportParams,
+                                                  pcHostName,
+                                                  usPort ) ) != 0 )
         {
             LogError( ( "Failed to connect to %s with error %d.",
                         pcHostName,
@@ -753,6 +829,8 @@ TlsTransportStatus_t TLS_Socket_Connect( NetworkContext_t * pxNetworkContext,
         }
     }
 
+    traceSPAN_END( "TLS_Socket_Connect" );
+
     return xRetVal;
 }
 /*-----------------------------------------------------------*/
@@ -763,6 +841,8 @@ void TLS_Socket_Disconnect( NetworkContext_t * pxNetworkContext )
     int32_t lMbedtlsError = 0;
     MbedSSLContext_t * pxSSLContext;
 
+    traceSPAN_BEGIN( "TLS_Socket_Disconnect" );
+
     if( ( pxNetworkContext != NULL ) && ( pxNetworkContext->pParams != NULL ) &&
         ( pxNetworkContext->pParams->xSSLContext != NULL ) )
     {
@@ -808,6 +888,8 @@ void TLS_Socket_Disconnect( NetworkContext_t * pxNetworkContext )
 
     /* Clear the mutex functions for mbed TLS thread safety. */
     mbedtls_threading_free_alt();
+
+    traceSPAN_END( "TLS_Socket_Disconnect" );
 }
 /*-----------------------------------------------------------*/
 
@@ -823,9 +905,11 @@ int32_t TLS_Socket_Recv( NetworkContext_t * pxNetworkContext,
                   ( pxNetworkContext->pParams->xSSLContext != NULL ) );
 
     pxSSLContext = ( MbedSSLContext_t * ) pxNetworkContext->pParams->xSSLContext;
+    traceSPAN_BEGIN( "TLS_Socket_Recv" );
     lMbedtlsError = ( int32_t ) mbedtls_ssl_read( &( pxSSLContext->context ),
                                                   pvBuffer,
                                                   xBytesToRecv );
+    traceSPAN_END( "TLS_Socket_Recv" );
 
     if( ( lMbedtlsError == MBEDTLS_ERR_SSL_TIMEOUT ) ||
         ( lMbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
@@ -867,9 +951,11 @@ int32_t TLS_Socket_Send( NetworkContext_t * pxNetworkContext,
                   ( pxNetworkContext->pParams->xSSLContext != NULL ) );
 
     pxSSLContext = ( MbedSSLContext_t * ) pxNetworkContext->pParams->xSSLContext;
+    traceSPAN_BEGIN( "TLS_Socket_Send" );
     lMbedtlsError = ( int32_t ) mbedtls_ssl_write( &( pxSSLContext->context ),
                                                    pvBuffer,
                                                    xBytesToSend );
+    traceSPAN_END( "TLS_Socket_Send" );
 
     if( ( lMbedtlsError == MBEDTLS_ERR_SSL_TIMEOUT ) ||
         ( lMbedtlsError == MBEDTLS_ERR_SSL_WANT_READ ) ||
@@ -0,0 +1,210 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file deferred_log.c
+ * @brief Logger that moves the output of log messages to a task of its own.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "deferred_log.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A message of the ring.
+ *
+ * The slot of position n is free for it while ulSequence is n, holds its
+ * message when ulSequence is n + 1 and is free for position n +
+ * #deferredlogSLOTS once written.
+ */
+typedef struct DeferredLogSlot
+{
+    uint32_t ulSequence;
+    uint32_t ulLength;
+    char cMessage[ deferredlogMESSAGE_SIZE ];
+} DeferredLogSlot_t;
+
+static DeferredLogSlot_t xSlots[ deferredlogSLOTS ];
+static DeferredLogWrite_t xWriteFunction;
+
+/* Next position to log to, shared by the callers. */
+static uint32_t ulHead;
+
+/* Next position to write, only moved by the task holding xDraining. */
+static uint32_t ulTail;
+static bool xDraining;
+
+static uint32_t ulDropped;
+static uint32_t ulDroppedReported;
+static uint32_t ulTruncated;
+static uint32_t ulTruncatedReported;
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the messages of the ring, unless another task is.
+ */
+static void prvDrain( void )
+{
+    DeferredLogSlot_t * pxSlot;
+    char cDropped[ 64 ];
+    uint32_t ulDroppedNow;
+    uint32_t ulTruncatedNow;
+    int lLength;
+
+    if( __atomic_exchange_n( &xDraining, true, __ATOMIC_ACQUIRE ) )
+    {
+        return;
+    }
+
+    /* Reported before the messages that made it past the drops. */
+    ulDroppedNow = __atomic_load_n( &ulDropped, __ATOMIC_RELAXED );
+    ulTruncatedNow = __atomic_load_n( &ulTruncated, __ATOMIC_RELAXED );
+
+    if( ( ulDroppedNow != ulDroppedReported ) || ( ulTruncatedNow != ulTruncatedReported ) )
+    {
+        lLength = snprintf( cDropped, sizeof( cDropped ), "[%u log messages dropped, %u truncated]\r\n",
+                            ( unsigned ) ( ulDroppedNow - ulDroppedReported ),
+                            ( unsigned ) ( ulTruncatedNow - ulTruncatedReported ) );
+        xWriteFunction( cDropped, ( uint32_t ) lLength );
+        ulDroppedReported = ulDroppedNow;
+        ulTruncatedReported = ulTruncatedNow;
+    }
+
+    for( ; ; )
+    {
+        pxSlot = &xSlots[ ulTail & ( deferredlogSLOTS - 1U ) ];
+
+        if( __atomic_load_n( &pxSlot->ulSequence, __ATOMIC_ACQUIRE ) != ulTail + 1U )
+        {
+            break;
+        }
+
+        xWriteFunction( pxSlot->cMessage, pxSlot->ulLength );
+        __atomic_store_n( &pxSlot->ulSequence, ulTail + deferredlogSLOTS, __ATOMIC_RELEASE );
+        ulTail++;
+    }
+
+    __atomic_store_n( &xDraining, false, __ATOMIC_RELEASE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvLogTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        prvDrain();
+        vTaskDelay( pdMS_TO_TICKS( deferredlogPOLL_INTERVAL_MS ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+bool DeferredLog_Init( DeferredLogWrite_t xWrite )
+{
+    uint32_t ulSlot;
+
+    for( ulSlot = 0; ulSlot < deferredlogSLOTS; ulSlot++ )
+    {
+        xSlots[ ulSlot ].ulSequence = ulSlot;
+    }
+
+    ulHead = 0;
+    ulTail = 0;
+    __atomic_store_n( &xWriteFunction, xWrite, __ATOMIC_RELEASE );
+
+    return xTaskCreate( prvLogTask, "Log", deferredlogTASK_STACK_SIZE, NULL,
+                        deferredlogTASK_PRIORITY, NULL ) == pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+bool DeferredLog_VPrintf( const char * pcFormat,
+                          va_list xArguments )
+{
+    DeferredLogSlot_t * pxSlot;
+    uint32_t ulPosition = __atomic_load_n( &ulHead, __ATOMIC_RELAXED );
+    uint32_t ulSequence;
+    int lLength;
+
+    if( __atomic_load_n( &xWriteFunction, __ATOMIC_ACQUIRE ) == NULL )
+    {
+        return false;
+    }
+
+    /* Claim the slot of the head, or find the ring full. */
+    for( ; ; )
+    {
+        pxSlot = &xSlots[ ulPosition & ( deferredlogSLOTS - 1U ) ];
+        ulSequence = __atomic_load_n( &pxSlot->ulSequence, __ATOMIC_ACQUIRE );
+
+        if( ulSequence == ulPosition )
+        {
+            if( __atomic_compare_exchange_n( &ulHead, &ulPosition, ulPosition + 1U, true,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+            {
+                break;
+            }
+        }
+        else if( ( int32_t ) ( ulSequence - ulPosition ) < 0 )
+        {
+            /* Not written yet since the previous lap. */
+            ( void ) __atomic_fetch_add( &ulDropped, 1U, __ATOMIC_RELAXED );
+
+            return false;
+        }
+        else
+        {
+            ulPosition = __atomic_load_n( &ulHead, __ATOMIC_RELAXED );
+        }
+    }
+
+    lLength = vsnprintf( pxSlot->cMessage, sizeof( pxSlot->cMessage ), pcFormat, xArguments );
+
+    if( lLength < 0 )
+    {
+        lLength = 0;
+    }
+    else if( ( uint32_t ) lLength >= sizeof( pxSlot->cMessage ) )
+    {
+        /* Marked, so a cut message does not read as a complete one. */
+        lLength = sizeof( pxSlot->cMessage ) - 1;
+        memcpy( &pxSlot->cMessage[ ( uint32_t ) lLength - ( sizeof( deferredlogTRUNCATION_MARK ) - 1U ) ],
+                deferredlogTRUNCATION_MARK, sizeof( deferredlogTRUNCATION_MARK ) - 1U );
+        ( void ) __atomic_fetch_add( &ulTruncated, 1U, __ATOMIC_RELAXED );
+    }
+
+    pxSlot->ulLength = ( uint32_t ) lLength;
+    __atomic_store_n( &pxSlot->ulSequence, ulPosition + 1U, __ATOMIC_RELEASE );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+void DeferredLog_Flush( void )
+{
+    if( __atomic_load_n( &xWriteFunction, __ATOMIC_ACQUIRE ) != NULL )
+    {
+        prvDrain();
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t DeferredLog_Dropped( void )
+{
+    return __atomic_load_n( &ulDropped, __ATOMIC_RELAXED );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t DeferredLog_Truncated( void )
+{
+    return __atomic_load_n( &ulTruncated, __ATOMIC_RELAXED );
+}
+/*-----------------------------------------------------------*/
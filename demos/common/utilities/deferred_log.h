@@ -0,0 +1,117 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file deferred_log.h
+ * @brief Logger that moves the output of log messages to a task of its own.
+ *
+ * #DeferredLog_VPrintf formats a message into a slot of a ring and returns,
+ * the log task writes the slots in order at low priority. Formatting happens
+ * on the caller, as the arguments of a message, like the buffers of "%.*s",
+ * do not outlive the call; the write to the output, the expensive part, does
+ * not.
+ *
+ * Any task can log at the same time, the ring takes no lock: a caller claims
+ * a slot with a compare and swap and publishes it with its sequence number,
+ * as in Vyukov's bounded queue. When the ring is full the message is dropped
+ * and counted, the log task reports the drops with the next message it writes.
+ * Messages longer than #deferredlogMESSAGE_SIZE are truncated, end with
+ * #deferredlogTRUNCATION_MARK and are counted and reported with the drops.
+ *
+ * Needs the GCC atomic builtins.
+ */
+
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Slots of the ring, a power of two.
+ */
+#ifndef deferredlogSLOTS
+    #define deferredlogSLOTS               ( 64U )
+#endif
+
+/**
+ * @brief Size of a slot, the longest message with its terminator.
+ */
+#ifndef deferredlogMESSAGE_SIZE
+    #define deferredlogMESSAGE_SIZE        ( 256U )
+#endif
+
+/**
+ * @brief Replaces the end of a truncated message.
+ */
+#ifndef deferredlogTRUNCATION_MARK
+    #define deferredlogTRUNCATION_MARK     "..."
+#endif
+
+/**
+ * @brief Priority of the log task, below the tasks that log.
+ */
+#ifndef deferredlogTASK_PRIORITY
+    #define deferredlogTASK_PRIORITY       ( tskIDLE_PRIORITY )
+#endif
+
+/**
+ * @brief Stack of the log task, in words.
+ */
+#ifndef deferredlogTASK_STACK_SIZE
+    #define deferredlogTASK_STACK_SIZE     ( configMINIMAL_STACK_SIZE * 4 )
+#endif
+
+/**
+ * @brief Time the log task waits when the ring is empty, in milliseconds.
+ */
+#ifndef deferredlogPOLL_INTERVAL_MS
+    #define deferredlogPOLL_INTERVAL_MS    ( 10U )
+#endif
+
+/**
+ * @brief Output of the log task, called with each message in order.
+ */
+typedef void ( * DeferredLogWrite_t )( const char * pcMessage,
+                                       uint32_t ulLength );
+
+/**
+ * @brief Create the log task.
+ *
+ * Messages logged before the scheduler starts are written once it runs.
+ *
+ * @param[in] xWrite Output of the messages.
+ * @return false if the task could not be created.
+ */
+bool DeferredLog_Init( DeferredLogWrite_t xWrite );
+
+/**
+ * @brief Format a message into the ring.
+ *
+ * @param[in] pcFormat printf format.
+ * @param[in] xArguments Arguments of @p pcFormat.
+ * @return false if the ring was full and the message dropped.
+ */
+bool DeferredLog_VPrintf( const char * pcFormat,
+                          va_list xArguments );
+
+/**
+ * @brief Write the messages in the ring from the calling task.
+ *
+ * For a task that is about to stop the application, like an assert handler.
+ * Does nothing if the log task is writing at the same time.
+ */
+void DeferredLog_Flush( void );
+
+/**
+ * @brief Number of messages dropped since start.
+ */
+uint32_t DeferredLog_Dropped( void );
+
+/**
+ * @brief Number of messages truncated since start.
+ */
+uint32_t DeferredLog_Truncated( void );
+
+#endif /* DEFERRED_LOG_H */
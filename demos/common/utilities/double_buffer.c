@@ -0,0 +1,110 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file double_buffer.c
+ * @brief Two buffers passed between a producer and a consumer task.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "double_buffer.h"
+
+/*-----------------------------------------------------------*/
+
+void DoubleBuffer_Init( DoubleBuffer_t * pxDouble,
+                        uint8_t * pucBuffer,
+                        uint32_t ulBufferSize )
+{
+    configASSERT( ( pxDouble != NULL ) && ( pucBuffer != NULL ) && ( ulBufferSize >= 2U ) );
+
+    memset( pxDouble, 0, sizeof( DoubleBuffer_t ) );
+    pxDouble->ulSize = ulBufferSize / 2U;
+    pxDouble->pucBuffers[ 0 ] = pucBuffer;
+    pxDouble->pucBuffers[ 1 ] = &pucBuffer[ pxDouble->ulSize ];
+
+    pxDouble->xBackMutex = xSemaphoreCreateMutexStatic( &pxDouble->xBackMutexBuffer );
+    configASSERT( pxDouble->xBackMutex != NULL );
+}
+/*-----------------------------------------------------------*/
+
+uint8_t * DoubleBuffer_Back( DoubleBuffer_t * pxDouble,
+                             uint32_t * pulSize )
+{
+    if( xSemaphoreTake( pxDouble->xBackMutex, 0 ) != pdTRUE )
+    {
+        pxDouble->xStats.ulProducerWaits++;
+        ( void ) xSemaphoreTake( pxDouble->xBackMutex, portMAX_DELAY );
+    }
+
+    /* Replaced by this fill. */
+    if( pxDouble->ulLengths[ pxDouble->ulBack ] != 0 )
+    {
+        pxDouble->ulLengths[ pxDouble->ulBack ] = 0;
+        pxDouble->xStats.ulOverwrites++;
+    }
+
+    *pulSize = pxDouble->ulSize;
+
+    return pxDouble->pucBuffers[ pxDouble->ulBack ];
+}
+/*-----------------------------------------------------------*/
+
+void DoubleBuffer_Commit( DoubleBuffer_t * pxDouble,
+                          uint32_t ulLength )
+{
+    configASSERT( ulLength <= pxDouble->ulSize );
+
+    pxDouble->ulLengths[ pxDouble->ulBack ] = ulLength;
+    ( void ) xSemaphoreGive( pxDouble->xBackMutex );
+}
+/*-----------------------------------------------------------*/
+
+const uint8_t * DoubleBuffer_Front( DoubleBuffer_t * pxDouble,
+                                    uint32_t * pulLength,
+                                    TickType_t xTicksToWait )
+{
+    const uint8_t * pucFront = NULL;
+
+    configASSERT( pxDouble->xFrontTaken == pdFALSE );
+
+    if( xSemaphoreTake( pxDouble->xBackMutex, xTicksToWait ) != pdTRUE )
+    {
+        pxDouble->xStats.ulConsumerMisses++;
+        return NULL;
+    }
+
+    if( pxDouble->ulLengths[ pxDouble->ulBack ] == 0 )
+    {
+        pxDouble->xStats.ulConsumerMisses++;
+    }
+    else
+    {
+        /* The producer fills the buffer sent before this one next. */
+        *pulLength = pxDouble->ulLengths[ pxDouble->ulBack ];
+        pucFront = pxDouble->pucBuffers[ pxDouble->ulBack ];
+        pxDouble->ulBack ^= 1U;
+        pxDouble->ulLengths[ pxDouble->ulBack ] = 0;
+        pxDouble->xFrontTaken = pdTRUE;
+        pxDouble->xStats.ulSwaps++;
+    }
+
+    ( void ) xSemaphoreGive( pxDouble->xBackMutex );
+
+    return pucFront;
+}
+/*-----------------------------------------------------------*/
+
+void DoubleBuffer_Release( DoubleBuffer_t * pxDouble )
+{
+    pxDouble->xFrontTaken = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+void DoubleBuffer_GetStats( const DoubleBuffer_t * pxDouble,
+                            DoubleBufferStats_t * pxStats )
+{
+    *pxStats = pxDouble->xStats;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,130 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file double_buffer.h
+ * @brief Two buffers passed between a producer and a consumer task.
+ *
+ * The producer fills the back buffer on its own schedule, replacing what it
+ * filled before if that was not taken yet. The consumer swaps the buffers
+ * only when it takes the front one, so it always gets the latest fill:
+ *
+ *     Producer                                Consumer
+ *     pucBack = DoubleBuffer_Back( ... );
+ *     ... fill pucBack ...
+ *     DoubleBuffer_Commit( ..., ulLength );
+ *                                             pucFront = DoubleBuffer_Front( ... );
+ *     pucBack = DoubleBuffer_Back( ... );     ... use pucFront ...
+ *     ... fill pucBack ...                    DoubleBuffer_Release( ... );
+ *     DoubleBuffer_Commit( ..., ulLength );
+ *
+ * A fill and a swap exclude each other, so the consumer waits at most for
+ * one fill and the producer for one swap. Neither waits while the other
+ * works on its own buffer.
+ *
+ * One producer task and one consumer task per double buffer.
+ */
+
+#ifndef DOUBLE_BUFFER_H
+#define DOUBLE_BUFFER_H
+
+#include <stdint.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/**
+ * @brief Counters of a double buffer.
+ */
+typedef struct DoubleBufferStats
+{
+    uint32_t ulSwaps;
+    uint32_t ulOverwrites;     /**< @brief Fills replaced by a newer one before they were taken. */
+    uint32_t ulProducerWaits;  /**< @brief Fills which waited for a swap. */
+    uint32_t ulConsumerMisses; /**< @brief Calls of #DoubleBuffer_Front which found no new fill. */
+} DoubleBufferStats_t;
+
+/**
+ * @brief Double buffer state.
+ */
+typedef struct DoubleBuffer
+{
+    uint8_t * pucBuffers[ 2 ];
+    uint32_t ulLengths[ 2 ]; /**< @brief Bytes committed to each buffer, 0 if there is nothing to take. */
+    uint32_t ulSize;
+    uint32_t ulBack;         /**< @brief Index of the back buffer, changed by swaps only. */
+    BaseType_t xFrontTaken;  /**< @brief The consumer took the front buffer and did not release it yet. */
+
+    /* Held by a fill or a swap. */
+    SemaphoreHandle_t xBackMutex;
+    StaticSemaphore_t xBackMutexBuffer;
+
+    DoubleBufferStats_t xStats;
+} DoubleBuffer_t;
+
+/**
+ * @brief Initialize a double buffer on two halves of a buffer.
+ *
+ * @param[out] pxDouble Double buffer to initialize.
+ * @param[in] pucBuffer Buffer of both halves, kept for the life of the double
+ * buffer.
+ * @param[in] ulBufferSize Size of @p pucBuffer, twice the size of a buffer.
+ */
+void DoubleBuffer_Init( DoubleBuffer_t * pxDouble,
+                        uint8_t * pucBuffer,
+                        uint32_t ulBufferSize );
+
+/**
+ * @brief Back buffer, for the producer to fill.
+ *
+ * Waits while the consumer swaps. What was committed before and not taken
+ * is dropped. Call #DoubleBuffer_Commit once filled.
+ *
+ * @param[in] pxDouble Double buffer.
+ * @param[out] pulSize Size of the buffer.
+ * @return The back buffer.
+ */
+uint8_t * DoubleBuffer_Back( DoubleBuffer_t * pxDouble,
+                             uint32_t * pulSize );
+
+/**
+ * @brief End the fill of the back buffer started by #DoubleBuffer_Back.
+ *
+ * @param[in] pxDouble Double buffer.
+ * @param[in] ulLength Bytes written to the back buffer, 0 to leave nothing to
+ * take.
+ */
+void DoubleBuffer_Commit( DoubleBuffer_t * pxDouble,
+                          uint32_t ulLength );
+
+/**
+ * @brief Swap the buffers and take the front buffer, for the consumer to use.
+ *
+ * @param[in] pxDouble Double buffer.
+ * @param[out] pulLength Bytes written to the buffer by the producer.
+ * @param[in] xTicksToWait Time to wait for a fill under way to be committed.
+ * @return The latest committed buffer, or NULL if nothing was committed since
+ * the last call. Once taken, call #DoubleBuffer_Release.
+ */
+const uint8_t * DoubleBuffer_Front( DoubleBuffer_t * pxDouble,
+                                    uint32_t * pulLength,
+                                    TickType_t xTicksToWait );
+
+/**
+ * @brief Done with the front buffer taken by #DoubleBuffer_Front.
+ *
+ * @param[in] pxDouble Double buffer.
+ */
+void DoubleBuffer_Release( DoubleBuffer_t * pxDouble );
+
+/**
+ * @brief Read the counters of a double buffer.
+ *
+ * @param[in] pxDouble Double buffer.
+ * @param[out] pxStats Counters.
+ */
+void DoubleBuffer_GetStats( const DoubleBuffer_t * pxDouble,
+                            DoubleBufferStats_t * pxStats );
+
+#endif /* DOUBLE_BUFFER_H */
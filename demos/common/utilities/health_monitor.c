@@ -0,0 +1,190 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file health_monitor.c
+ * @brief Task CPU, stack and heap use of the device, as a telemetry payload.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "health_monitor.h"
+
+/* The snapshot needs uxTaskGetSystemState. */
+#if ( configUSE_TRACE_FACILITY == 1 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a snapshot of every task.
+ *
+ * @return Number of tasks, 0 if there are more than the snapshot holds.
+ */
+    static UBaseType_t prvSnapshot( HealthMonitor_t * pxMonitor,
+                                    configRUN_TIME_COUNTER_TYPE * pxTotalRunTime )
+    {
+        *pxTotalRunTime = 0;
+
+        return uxTaskGetSystemState( pxMonitor->xStatus, HEALTH_MONITOR_MAX_TASKS, pxTotalRunTime );
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Keep the run time of every task of the last snapshot for the next
+ * interval.
+ */
+    static void prvStartInterval( HealthMonitor_t * pxMonitor,
+                                  UBaseType_t uxCount,
+                                  configRUN_TIME_COUNTER_TYPE xTotalRunTime )
+    {
+        UBaseType_t uxIndex;
+
+        for( uxIndex = 0; uxIndex < uxCount; uxIndex++ )
+        {
+            pxMonitor->xPrevious[ uxIndex ].uxTaskNumber = pxMonitor->xStatus[ uxIndex ].xTaskNumber;
+            pxMonitor->xPrevious[ uxIndex ].xRunTime = pxMonitor->xStatus[ uxIndex ].ulRunTimeCounter;
+        }
+
+        pxMonitor->uxPreviousCount = uxCount;
+        pxMonitor->xPreviousTotalRunTime = xTotalRunTime;
+        pxMonitor->xPreviousTick = xTaskGetTickCount();
+    }
+/*-----------------------------------------------------------*/
+
+    #if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+/**
+ * @brief Run time of a task in the interval, all of it for a task created
+ * since the previous snapshot.
+ */
+        static configRUN_TIME_COUNTER_TYPE prvIntervalRunTime( const HealthMonitor_t * pxMonitor,
+                                                               const TaskStatus_t * pxStatus )
+        {
+            UBaseType_t uxIndex;
+
+            for( uxIndex = 0; uxIndex < pxMonitor->uxPreviousCount; uxIndex++ )
+            {
+                if( pxMonitor->xPrevious[ uxIndex ].uxTaskNumber == pxStatus->xTaskNumber )
+                {
+                    /* Unsigned, so the difference survives a counter wrap. */
+                    return pxStatus->ulRunTimeCounter - pxMonitor->xPrevious[ uxIndex ].xRunTime;
+                }
+            }
+
+            return pxStatus->ulRunTimeCounter;
+        }
+    #endif /* configGENERATE_RUN_TIME_STATS == 1 */
+/*-----------------------------------------------------------*/
+
+    static bool prvAppend( char * pcBuffer,
+                           uint32_t ulBufferSize,
+                           uint32_t * pulLength,
+                           int lLength )
+    {
+        if( ( lLength <= 0 ) || ( ( uint32_t ) lLength >= ulBufferSize - *pulLength ) )
+        {
+            return false;
+        }
+
+        *pulLength += ( uint32_t ) lLength;
+
+        return true;
+    }
+/*-----------------------------------------------------------*/
+
+    void HealthMonitor_Init( HealthMonitor_t * pxMonitor )
+    {
+        configRUN_TIME_COUNTER_TYPE xTotalRunTime;
+        UBaseType_t uxCount;
+
+        configASSERT( pxMonitor != NULL );
+
+        memset( pxMonitor, 0, sizeof( HealthMonitor_t ) );
+        uxCount = prvSnapshot( pxMonitor, &xTotalRunTime );
+        prvStartInterval( pxMonitor, uxCount, xTotalRunTime );
+    }
+/*-----------------------------------------------------------*/
+
+    uint32_t HealthMonitor_Serialize( HealthMonitor_t * pxMonitor,
+                                      uint8_t * pucBuffer,
+                                      uint32_t ulBufferSize )
+    {
+        char * pcBuffer = ( char * ) pucBuffer;
+        const TaskStatus_t * pxStatus;
+        configRUN_TIME_COUNTER_TYPE xTotalRunTime;
+        configRUN_TIME_COUNTER_TYPE xIntervalRunTime;
+        uint32_t ulPermille;
+        uint32_t ulLength = 0;
+        UBaseType_t uxCount;
+        UBaseType_t uxIndex;
+        bool xFits;
+
+        if( ( pxMonitor == NULL ) || ( pucBuffer == NULL ) ||
+            ( ( uxCount = prvSnapshot( pxMonitor, &xTotalRunTime ) ) == 0 ) )
+        {
+            return 0;
+        }
+
+        xIntervalRunTime = xTotalRunTime - pxMonitor->xPreviousTotalRunTime;
+
+        xFits = prvAppend( pcBuffer, ulBufferSize, &ulLength,
+                           snprintf( pcBuffer, ulBufferSize, "{\"health\":{\"intervalMs\":%u,",
+                                     ( unsigned ) ( ( xTaskGetTickCount() - pxMonitor->xPreviousTick ) * portTICK_PERIOD_MS ) ) );
+
+        #if ( HEALTH_MONITOR_HEAP_STATS != 0 )
+            xFits = xFits &&
+                    prvAppend( pcBuffer, ulBufferSize, &ulLength,
+                               snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "\"heapFree\":%u,\"heapMinFree\":%u,",
+                                         ( unsigned ) xPortGetFreeHeapSize(),
+                                         ( unsigned ) xPortGetMinimumEverFreeHeapSize() ) );
+        #endif
+
+        xFits = xFits &&
+                prvAppend( pcBuffer, ulBufferSize, &ulLength,
+                           snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "\"tasks\":{" ) );
+
+        for( uxIndex = 0; xFits && ( uxIndex < uxCount ); uxIndex++ )
+        {
+            pxStatus = &pxMonitor->xStatus[ uxIndex ];
+
+            xFits = prvAppend( pcBuffer, ulBufferSize, &ulLength,
+                               snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "%s\"%s\":{",
+                                         ( uxIndex == 0 ) ? "" : ",", pxStatus->pcTaskName ) );
+
+            #if ( configGENERATE_RUN_TIME_STATS == 1 )
+                if( xFits && ( xIntervalRunTime != 0 ) )
+                {
+                    ulPermille = ( uint32_t ) ( ( uint64_t ) prvIntervalRunTime( pxMonitor, pxStatus ) * 1000U /
+                                                xIntervalRunTime );
+                    xFits = prvAppend( pcBuffer, ulBufferSize, &ulLength,
+                                       snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "\"cpu\":%u.%u,",
+                                                 ( unsigned ) ( ulPermille / 10U ), ( unsigned ) ( ulPermille % 10U ) ) );
+                }
+            #else
+                ( void ) ulPermille;
+                ( void ) xIntervalRunTime;
+            #endif
+
+            xFits = xFits &&
+                    prvAppend( pcBuffer, ulBufferSize, &ulLength,
+                               snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "\"stackFree\":%u}",
+                                         ( unsigned ) ( pxStatus->usStackHighWaterMark * sizeof( StackType_t ) ) ) );
+        }
+
+        prvStartInterval( pxMonitor, uxCount, xTotalRunTime );
+
+        if( !xFits || ( ulLength + sizeof( "}}}" ) > ulBufferSize ) )
+        {
+            return 0;
+        }
+
+        memcpy( &pcBuffer[ ulLength ], "}}}", sizeof( "}}}" ) );
+
+        return ulLength + sizeof( "}}}" ) - 1;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* configUSE_TRACE_FACILITY == 1 */
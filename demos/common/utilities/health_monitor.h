@@ -0,0 +1,96 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file health_monitor.h
+ * @brief Task CPU, stack and heap use of the device, as a telemetry payload.
+ *
+ * Each #HealthMonitor_Serialize takes a snapshot of every task with
+ * uxTaskGetSystemState and writes:
+ *
+ *     {"health":{"intervalMs":60000,"heapFree":81234,"heapMinFree":60112,
+ *      "tasks":{"IDLE":{"cpu":97.5,"stackFree":312},...}}}
+ *
+ * - cpu is the share of the run time counter the task used since the
+ *   previous snapshot, in percent with one decimal. It is only present with
+ *   configGENERATE_RUN_TIME_STATS, whose counter should tick well above the
+ *   tick rate for short tasks to show.
+ * - stackFree is the stack high-water mark: the fewest bytes of stack the
+ *   task has had left since it started.
+ * - heapFree and heapMinFree come from xPortGetFreeHeapSize and
+ *   xPortGetMinimumEverFreeHeapSize. They are left out when
+ *   #HEALTH_MONITOR_HEAP_STATS is 0, for heap_3 which does not provide them.
+ *
+ * Needs configUSE_TRACE_FACILITY. Use from one task.
+ */
+
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * @brief Most tasks in a snapshot. uxTaskGetSystemState fails if there are
+ * more.
+ */
+#ifndef HEALTH_MONITOR_MAX_TASKS
+    #define HEALTH_MONITOR_MAX_TASKS    ( 24U )
+#endif
+
+/**
+ * @brief Report the free heap. Set to 0 with heap_3.
+ */
+#ifndef HEALTH_MONITOR_HEAP_STATS
+    #define HEALTH_MONITOR_HEAP_STATS    ( 1 )
+#endif
+
+#ifndef configRUN_TIME_COUNTER_TYPE
+    #define configRUN_TIME_COUNTER_TYPE    uint32_t
+#endif
+
+/**
+ * @brief Run time of a task at the previous snapshot.
+ */
+typedef struct HealthMonitorTaskRunTime
+{
+    UBaseType_t uxTaskNumber;
+    configRUN_TIME_COUNTER_TYPE xRunTime;
+} HealthMonitorTaskRunTime_t;
+
+/**
+ * @brief Monitor state, the snapshot buffers included.
+ */
+typedef struct HealthMonitor
+{
+    TaskStatus_t xStatus[ HEALTH_MONITOR_MAX_TASKS ];
+    HealthMonitorTaskRunTime_t xPrevious[ HEALTH_MONITOR_MAX_TASKS ];
+    UBaseType_t uxPreviousCount;
+    configRUN_TIME_COUNTER_TYPE xPreviousTotalRunTime;
+    TickType_t xPreviousTick;
+} HealthMonitor_t;
+
+/**
+ * @brief Initialize a monitor and take the first snapshot, the start of the
+ * first interval.
+ *
+ * @param[out] pxMonitor Monitor to initialize.
+ */
+void HealthMonitor_Init( HealthMonitor_t * pxMonitor );
+
+/**
+ * @brief Take a snapshot and write it as JSON, starting the next interval.
+ *
+ * @param[in] pxMonitor Monitor.
+ * @param[out] pucBuffer Buffer for the JSON.
+ * @param[in] ulBufferSize Size of @p pucBuffer.
+ * @return Length of the JSON, 0 if it did not fit or there were more than
+ * #HEALTH_MONITOR_MAX_TASKS tasks.
+ */
+uint32_t HealthMonitor_Serialize( HealthMonitor_t * pxMonitor,
+                                  uint8_t * pucBuffer,
+                                  uint32_t ulBufferSize );
+
+#endif /* HEALTH_MONITOR_H */
@@ -0,0 +1,322 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file latency_histogram.c
+ * @brief Fixed size latency histogram with log-linear buckets.
+ */
+
+/* Standard includes. */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "latency_histogram.h"
+
+/*-----------------------------------------------------------*/
+
+#define latencyhistogramSUB_BUCKETS    ( 1U << LATENCY_HISTOGRAM_SUB_BUCKET_BITS )
+
+#if defined( __GNUC__ )
+    #define latencyhistogramADD( pulValue, ulAdd ) \
+    ( void ) __atomic_fetch_add( ( pulValue ), ( ulAdd ), __ATOMIC_RELAXED )
+#else
+
+/* Compilers without the GCC atomics, MSVC for the Windows simulator. */
+    #define latencyhistogramADD( pulValue, ulAdd ) \
+    do {                                           \
+        taskENTER_CRITICAL();                      \
+        *( pulValue ) += ( ulAdd );                \
+        taskEXIT_CRITICAL();                       \
+    } while( 0 )
+#endif
+/*-----------------------------------------------------------*/
+
+static uint32_t prvExchange( uint32_t * pulValue,
+                             uint32_t ulNew )
+{
+    #if defined( __GNUC__ )
+        return __atomic_exchange_n( pulValue, ulNew, __ATOMIC_RELAXED );
+    #else
+        uint32_t ulOld;
+
+        taskENTER_CRITICAL();
+        ulOld = *pulValue;
+        *pulValue = ulNew;
+        taskEXIT_CRITICAL();
+
+        return ulOld;
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+static void prvRaiseMax( uint32_t * pulMax,
+                         uint32_t ulValue )
+{
+    #if defined( __GNUC__ )
+        uint32_t ulMax = __atomic_load_n( pulMax, __ATOMIC_RELAXED );
+
+        /* Retry if another task raised it in between. */
+        while( ( ulValue > ulMax ) &&
+               !__atomic_compare_exchange_n( pulMax, &ulMax, ulValue, true,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+        {
+        }
+    #else
+        taskENTER_CRITICAL();
+
+        if( ulValue > *pulMax )
+        {
+            *pulMax = ulValue;
+        }
+
+        taskEXIT_CRITICAL();
+    #endif
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBucket( uint32_t ulValue )
+{
+    uint32_t ulMagnitude = LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+
+    if( ulValue < latencyhistogramSUB_BUCKETS )
+    {
+        return ulValue;
+    }
+
+    if( ( ulValue >> LATENCY_HISTOGRAM_MAX_BITS ) != 0 )
+    {
+        return LATENCY_HISTOGRAM_BUCKETS - 1U;
+    }
+
+    while( ( ulValue >> ( ulMagnitude + 1U ) ) != 0 )
+    {
+        ulMagnitude++;
+    }
+
+    /* The power of two, then the top bits below its leading one. */
+    return ( ( ulMagnitude - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1U ) << LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) +
+           ( ulValue >> ( ulMagnitude - LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) ) - latencyhistogramSUB_BUCKETS;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Lowest latency of a bucket and its width.
+ */
+static void prvBucketRange( uint32_t ulBucket,
+                            uint32_t * pulLowest,
+                            uint32_t * pulWidth )
+{
+    uint32_t ulShift;
+
+    if( ulBucket < latencyhistogramSUB_BUCKETS )
+    {
+        *pulLowest = ulBucket;
+        *pulWidth = 1;
+    }
+    else
+    {
+        ulShift = ( ulBucket >> LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) - 1U;
+        *pulLowest = ( latencyhistogramSUB_BUCKETS + ( ulBucket & ( latencyhistogramSUB_BUCKETS - 1U ) ) ) << ulShift;
+        *pulWidth = 1U << ulShift;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Record( LatencyHistogram_t * pxHistogram,
+                              uint64_t ullLatencyUs )
+{
+    uint32_t ulLatencyUs = ( ullLatencyUs > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) ullLatencyUs;
+
+    latencyhistogramADD( &pxHistogram->ulCounts[ prvBucket( ulLatencyUs ) ], 1U );
+    prvRaiseMax( &pxHistogram->ulMaxUs, ulLatencyUs );
+}
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Snapshot( LatencyHistogram_t * pxHistogram,
+                                LatencyHistogram_t * pxSnapshot )
+{
+    uint32_t ulBucket;
+
+    for( ulBucket = 0; ulBucket < LATENCY_HISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        pxSnapshot->ulCounts[ ulBucket ] = prvExchange( &pxHistogram->ulCounts[ ulBucket ], 0 );
+    }
+
+    pxSnapshot->ulMaxUs = prvExchange( &pxHistogram->ulMaxUs, 0 );
+}
+/*-----------------------------------------------------------*/
+
+void LatencyHistogram_Merge( LatencyHistogram_t * pxInto,
+                             const LatencyHistogram_t * pxFrom )
+{
+    uint32_t ulBucket;
+
+    for( ulBucket = 0; ulBucket < LATENCY_HISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        pxInto->ulCounts[ ulBucket ] += pxFrom->ulCounts[ ulBucket ];
+    }
+
+    if( pxFrom->ulMaxUs > pxInto->ulMaxUs )
+    {
+        pxInto->ulMaxUs = pxFrom->ulMaxUs;
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t LatencyHistogram_Count( const LatencyHistogram_t * pxHistogram )
+{
+    uint32_t ulCount = 0;
+    uint32_t ulBucket;
+
+    for( ulBucket = 0; ulBucket < LATENCY_HISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        ulCount += pxHistogram->ulCounts[ ulBucket ];
+    }
+
+    return ulCount;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t LatencyHistogram_Percentile( const LatencyHistogram_t * pxHistogram,
+                                      uint32_t ulPercent )
+{
+    uint32_t ulRank = ( uint32_t ) ( ( ( uint64_t ) LatencyHistogram_Count( pxHistogram ) * ulPercent + 99U ) / 100U );
+    uint32_t ulSeen = 0;
+    uint32_t ulBucket;
+    uint32_t ulLowest;
+    uint32_t ulWidth;
+
+    if( ulRank == 0 )
+    {
+        return 0;
+    }
+
+    for( ulBucket = 0; ulBucket < LATENCY_HISTOGRAM_BUCKETS - 1U; ulBucket++ )
+    {
+        ulSeen += pxHistogram->ulCounts[ ulBucket ];
+
+        if( ulSeen >= ulRank )
+        {
+            break;
+        }
+    }
+
+    prvBucketRange( ulBucket, &ulLowest, &ulWidth );
+
+    /* The last bucket has no upper bound but the maximum. */
+    return ( ( ulBucket < LATENCY_HISTOGRAM_BUCKETS - 1U ) && ( ulLowest + ulWidth - 1U < pxHistogram->ulMaxUs ) ) ?
+           ulLowest + ulWidth - 1U : pxHistogram->ulMaxUs;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t LatencyHistogram_Mean( const LatencyHistogram_t * pxHistogram )
+{
+    uint64_t ullTotal = 0;
+    uint32_t ulCount = 0;
+    uint32_t ulBucket;
+    uint32_t ulLowest;
+    uint32_t ulWidth;
+
+    for( ulBucket = 0; ulBucket < LATENCY_HISTOGRAM_BUCKETS; ulBucket++ )
+    {
+        if( pxHistogram->ulCounts[ ulBucket ] != 0 )
+        {
+            prvBucketRange( ulBucket, &ulLowest, &ulWidth );
+            ullTotal += ( uint64_t ) pxHistogram->ulCounts[ ulBucket ] * ( ulLowest + ( ulWidth - 1U ) / 2U );
+            ulCount += pxHistogram->ulCounts[ ulBucket ];
+        }
+    }
+
+    return ( ulCount == 0 ) ? 0 : ( uint32_t ) ( ullTotal / ulCount );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t LatencyHistogram_Serialize( const LatencyHistogram_t * pxHistogram,
+                                     char * pcBuffer,
+                                     uint32_t ulBufferSize )
+{
+    uint32_t ulCursor = LATENCY_HISTOGRAM_CURSOR_START;
+    int32_t lLength = LatencyHistogram_SerializePart( pxHistogram, &ulCursor, pcBuffer, ulBufferSize );
+
+    return ( ulCursor == LATENCY_HISTOGRAM_CURSOR_DONE ) ? ( uint32_t ) lLength : 0;
+}
+/*-----------------------------------------------------------*/
+
+int32_t LatencyHistogram_SerializePart( const LatencyHistogram_t * pxHistogram,
+                                        uint32_t * pulCursor,
+                                        char * pcBuffer,
+                                        uint32_t ulBufferSize )
+{
+    uint32_t ulLength = 0;
+    uint32_t ulBucket;
+    uint32_t ulNext;
+    bool xFirstBucket;
+    int lLength;
+
+    /* Cursor 1 + n resumes the buckets at n, the one after them ends. */
+    while( *pulCursor != LATENCY_HISTOGRAM_CURSOR_DONE )
+    {
+        if( *pulCursor == LATENCY_HISTOGRAM_CURSOR_START )
+        {
+            lLength = snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength,
+                                "{\"count\":%u,\"mean\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u,\"buckets\":[",
+                                ( unsigned ) LatencyHistogram_Count( pxHistogram ),
+                                ( unsigned ) LatencyHistogram_Mean( pxHistogram ),
+                                ( unsigned ) LatencyHistogram_Percentile( pxHistogram, 50 ),
+                                ( unsigned ) LatencyHistogram_Percentile( pxHistogram, 90 ),
+                                ( unsigned ) LatencyHistogram_Percentile( pxHistogram, 99 ),
+                                ( unsigned ) pxHistogram->ulMaxUs );
+            ulNext = 1U;
+        }
+        else if( *pulCursor == LATENCY_HISTOGRAM_CURSOR_DONE - 1U )
+        {
+            lLength = snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "]}" );
+            ulNext = LATENCY_HISTOGRAM_CURSOR_DONE;
+        }
+        else
+        {
+            ulBucket = *pulCursor - 1U;
+
+            /* Writing a bucket moves the cursor past 1, so it is only 1
+             * before the first bucket written. */
+            xFirstBucket = ( *pulCursor == 1U );
+
+            while( ( ulBucket < LATENCY_HISTOGRAM_BUCKETS ) && ( pxHistogram->ulCounts[ ulBucket ] == 0 ) )
+            {
+                ulBucket++;
+            }
+
+            if( ulBucket == LATENCY_HISTOGRAM_BUCKETS )
+            {
+                *pulCursor = LATENCY_HISTOGRAM_CURSOR_DONE - 1U;
+                continue;
+            }
+
+            lLength = snprintf( &pcBuffer[ ulLength ], ulBufferSize - ulLength, "%s%u,%u",
+                                xFirstBucket ? "" : ",",
+                                ( unsigned ) ulBucket, ( unsigned ) pxHistogram->ulCounts[ ulBucket ] );
+            ulNext = ulBucket + 2U;
+        }
+
+        if( ( lLength <= 0 ) || ( ( uint32_t ) lLength >= ulBufferSize - ulLength ) )
+        {
+            break;
+        }
+
+        ulLength += ( uint32_t ) lLength;
+        *pulCursor = ulNext;
+    }
+
+    if( ( ulLength == 0 ) && ( *pulCursor != LATENCY_HISTOGRAM_CURSOR_DONE ) )
+    {
+        return -1;
+    }
+
+    return ( int32_t ) ulLength;
+}
+/*-----------------------------------------------------------*/
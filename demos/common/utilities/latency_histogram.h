@@ -0,0 +1,158 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file latency_histogram.h
+ * @brief Fixed size latency histogram with log-linear buckets.
+ *
+ * Latencies in microseconds are counted in buckets whose width grows with
+ * the latency, as in HdrHistogram: each power of two is split into
+ * 2^#LATENCY_HISTOGRAM_SUB_BUCKET_BITS buckets, so a percentile is within
+ * 1 / 2^#LATENCY_HISTOGRAM_SUB_BUCKET_BITS of the true value at any scale.
+ * Latencies below 2^#LATENCY_HISTOGRAM_SUB_BUCKET_BITS are exact.
+ *
+ * #LatencyHistogram_Record is lock free and can be called from any task on
+ * the same histogram. #LatencyHistogram_Snapshot moves the counts to a
+ * snapshot owned by the caller, snapshots can be merged, queried and
+ * serialized. The serialization lists the buckets that are not empty, so
+ * the histograms of many devices can be merged in the cloud.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Buckets per power of two, as a power of two.
+ *
+ * 4 keeps percentiles within 6.25 %, for 1.5 KB per histogram with the
+ * default #LATENCY_HISTOGRAM_MAX_BITS. Each bit less halves both the
+ * resolution and the size.
+ */
+#ifndef LATENCY_HISTOGRAM_SUB_BUCKET_BITS
+    #define LATENCY_HISTOGRAM_SUB_BUCKET_BITS    ( 4U )
+#endif
+
+/**
+ * @brief Latencies from 2^this microseconds, 134 seconds for 27, are
+ * counted in the last bucket.
+ */
+#ifndef LATENCY_HISTOGRAM_MAX_BITS
+    #define LATENCY_HISTOGRAM_MAX_BITS           ( 27U )
+#endif
+
+/**
+ * @brief Number of buckets, those of each power of two below
+ * 2^#LATENCY_HISTOGRAM_MAX_BITS and the last one for the latencies above.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS                                          \
+    ( ( ( LATENCY_HISTOGRAM_MAX_BITS - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1U ) \
+        << LATENCY_HISTOGRAM_SUB_BUCKET_BITS ) + 1U )
+
+/**
+ * @brief Histogram, also the type of a snapshot. Zero it to initialize.
+ */
+typedef struct LatencyHistogram
+{
+    uint32_t ulCounts[ LATENCY_HISTOGRAM_BUCKETS ];
+    uint32_t ulMaxUs;
+} LatencyHistogram_t;
+
+/**
+ * @brief Count a latency.
+ *
+ * @param[in] pxHistogram Histogram.
+ * @param[in] ullLatencyUs Latency in microseconds.
+ */
+void LatencyHistogram_Record( LatencyHistogram_t * pxHistogram,
+                              uint64_t ullLatencyUs );
+
+/**
+ * @brief Move the counts of a histogram to a snapshot, clearing the
+ * histogram.
+ *
+ * Latencies recorded at the same time end up in the snapshot or in the
+ * histogram, none are lost.
+ *
+ * @param[in] pxHistogram Histogram.
+ * @param[out] pxSnapshot Snapshot, overwritten.
+ */
+void LatencyHistogram_Snapshot( LatencyHistogram_t * pxHistogram,
+                                LatencyHistogram_t * pxSnapshot );
+
+/**
+ * @brief Add the counts of a snapshot to another.
+ *
+ * @param[in,out] pxInto Snapshot to add to, not recorded to at the same time.
+ * @param[in] pxFrom Snapshot to add.
+ */
+void LatencyHistogram_Merge( LatencyHistogram_t * pxInto,
+                             const LatencyHistogram_t * pxFrom );
+
+/**
+ * @brief Number of latencies counted.
+ */
+uint32_t LatencyHistogram_Count( const LatencyHistogram_t * pxHistogram );
+
+/**
+ * @brief Latency at a percentile, the highest latency of its bucket.
+ *
+ * @param[in] pxHistogram Snapshot.
+ * @param[in] ulPercent Percentile, 1 to 100.
+ * @return The latency in microseconds, 0 without latencies.
+ */
+uint32_t LatencyHistogram_Percentile( const LatencyHistogram_t * pxHistogram,
+                                      uint32_t ulPercent );
+
+/**
+ * @brief Mean latency, from the middle of the buckets.
+ *
+ * @return The mean in microseconds, 0 without latencies.
+ */
+uint32_t LatencyHistogram_Mean( const LatencyHistogram_t * pxHistogram );
+
+/**
+ * @brief Write a snapshot as a JSON object.
+ *
+ *     {"count":4,"mean":2755,"p50":2559,"p90":5000,"p99":5000,"max":5000,
+ *      "buckets":[108,1,131,1,132,1,147,1]}
+ *
+ * buckets holds the index and count of each bucket that is not empty.
+ *
+ * @param[in] pxHistogram Snapshot.
+ * @param[out] pcBuffer Buffer for the JSON.
+ * @param[in] ulBufferSize Size of @p pcBuffer.
+ * @return Length of the JSON, 0 if it did not fit.
+ */
+uint32_t LatencyHistogram_Serialize( const LatencyHistogram_t * pxHistogram,
+                                     char * pcBuffer,
+                                     uint32_t ulBufferSize );
+
+/**
+ * @brief Cursors of #LatencyHistogram_SerializePart.
+ */
+#define LATENCY_HISTOGRAM_CURSOR_START    ( 0U )
+#define LATENCY_HISTOGRAM_CURSOR_DONE     ( LATENCY_HISTOGRAM_BUCKETS + 2U )
+
+/**
+ * @brief Write the JSON of #LatencyHistogram_Serialize in parts, as many as
+ * fit in the buffer.
+ *
+ * The parts are the fields up to the buckets, about 100 bytes, each bucket
+ * and the end, so a snapshot can be written to a small buffer over several
+ * calls.
+ *
+ * @param[in] pxHistogram Snapshot, unchanged between the calls.
+ * @param[in,out] pulCursor Next part, #LATENCY_HISTOGRAM_CURSOR_START to
+ * start, #LATENCY_HISTOGRAM_CURSOR_DONE once all are written.
+ * @param[out] pcBuffer Buffer for the parts.
+ * @param[in] ulBufferSize Size of @p pcBuffer.
+ * @return Length written, 0 when done, or -1 if the next part does not fit.
+ */
+int32_t LatencyHistogram_SerializePart( const LatencyHistogram_t * pxHistogram,
+                                        uint32_t * pulCursor,
+                                        char * pcBuffer,
+                                        uint32_t ulBufferSize );
+
+#endif /* LATENCY_HISTOGRAM_H */
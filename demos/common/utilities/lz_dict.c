@@ -0,0 +1,291 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file lz_dict.c
+ * @brief Small LZ77 compressor with a preset dictionary.
+ */
+
+#include <string.h>
+
+#include "lz_dict.h"
+
+/*-----------------------------------------------------------*/
+
+#define lzdictMIN_MATCH        ( 3U )
+
+/**
+ * @brief Shortest match emitted. A 3 byte match costs as much as the literals
+ * it replaces plus the token of the literal run it splits, so only longer
+ * matches keep the output within #LZ_DICT_COMPRESS_BOUND.
+ */
+#define lzdictMIN_EMITTED      ( lzdictMIN_MATCH + 1U )
+#define lzdictMAX_MATCH        ( 0x7FU + lzdictMIN_MATCH )
+#define lzdictMAX_LITERALS     ( 0x80U )
+#define lzdictMATCH_FLAG       ( 0x80U )
+
+/**
+ * @brief Dictionary followed by the input, addressed as one buffer.
+ */
+typedef struct LZDictWindow
+{
+    const uint8_t * pucDictionary;
+    uint32_t ulDictionaryLength;
+    const uint8_t * pucInput;
+    uint32_t ulTotalLength;
+} LZDictWindow_t;
+/*-----------------------------------------------------------*/
+
+static uint8_t prvByteAt( const LZDictWindow_t * pxWindow,
+                          uint32_t ulPosition )
+{
+    return ( ulPosition < pxWindow->ulDictionaryLength ) ?
+           pxWindow->pucDictionary[ ulPosition ] :
+           pxWindow->pucInput[ ulPosition - pxWindow->ulDictionaryLength ];
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHash( const LZDictWindow_t * pxWindow,
+                         uint32_t ulPosition )
+{
+    uint32_t ulValue = ( ( uint32_t ) prvByteAt( pxWindow, ulPosition ) << 16 ) |
+                       ( ( uint32_t ) prvByteAt( pxWindow, ulPosition + 1 ) << 8 ) |
+                       ( uint32_t ) prvByteAt( pxWindow, ulPosition + 2 );
+
+    return ( ulValue * 2654435761U ) >> ( 32U - LZ_DICT_HASH_BITS );
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsert( LZDictContext_t * pxContext,
+                       const LZDictWindow_t * pxWindow,
+                       uint32_t ulPosition )
+{
+    if( ulPosition + lzdictMIN_MATCH <= pxWindow->ulTotalLength )
+    {
+        /* Zero marks an empty entry, so positions are stored plus one. */
+        pxContext->usHashTable[ prvHash( pxWindow, ulPosition ) ] = ( uint16_t ) ( ulPosition + 1 );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static LZDictStatus_t prvEmitLiterals( const LZDictWindow_t * pxWindow,
+                                       uint32_t ulStart,
+                                       uint32_t ulEnd,
+                                       uint8_t * pucOutput,
+                                       uint32_t ulOutputSize,
+                                       uint32_t * pulOutputIndex )
+{
+    uint32_t ulRun;
+
+    while( ulStart < ulEnd )
+    {
+        ulRun = ulEnd - ulStart;
+
+        if( ulRun > lzdictMAX_LITERALS )
+        {
+            ulRun = lzdictMAX_LITERALS;
+        }
+
+        if( *pulOutputIndex + 1 + ulRun > ulOutputSize )
+        {
+            return eLZDictBufferTooSmall;
+        }
+
+        pucOutput[ ( *pulOutputIndex )++ ] = ( uint8_t ) ( ulRun - 1 );
+        memcpy( &pucOutput[ *pulOutputIndex ],
+                &pxWindow->pucInput[ ulStart - pxWindow->ulDictionaryLength ], ulRun );
+        *pulOutputIndex += ulRun;
+        ulStart += ulRun;
+    }
+
+    return eLZDictSuccess;
+}
+/*-----------------------------------------------------------*/
+
+LZDictStatus_t LZDict_Compress( LZDictContext_t * pxContext,
+                                const uint8_t * pucDictionary,
+                                uint32_t ulDictionaryLength,
+                                const uint8_t * pucInput,
+                                uint32_t ulInputLength,
+                                uint8_t * pucOutput,
+                                uint32_t ulOutputSize,
+                                uint32_t * pulOutputLength )
+{
+    LZDictWindow_t xWindow;
+    LZDictStatus_t xStatus;
+    uint32_t ulPosition;
+    uint32_t ulLiteralStart;
+    uint32_t ulOutputIndex = 0;
+    uint32_t ulCandidate;
+    uint32_t ulMatchLength;
+    uint32_t ulDistance;
+    uint32_t ulIndex;
+
+    if( ( pxContext == NULL ) || ( pucInput == NULL ) || ( pucOutput == NULL ) ||
+        ( pulOutputLength == NULL ) || ( ( pucDictionary == NULL ) && ( ulDictionaryLength != 0 ) ) ||
+        ( ulDictionaryLength + ulInputLength > LZ_DICT_MAX_WINDOW ) )
+    {
+        return eLZDictInvalidParameter;
+    }
+
+    xWindow.pucDictionary = pucDictionary;
+    xWindow.ulDictionaryLength = ulDictionaryLength;
+    xWindow.pucInput = pucInput;
+    xWindow.ulTotalLength = ulDictionaryLength + ulInputLength;
+
+    memset( pxContext->usHashTable, 0, sizeof( pxContext->usHashTable ) );
+
+    for( ulPosition = 0; ulPosition < ulDictionaryLength; ulPosition++ )
+    {
+        prvInsert( pxContext, &xWindow, ulPosition );
+    }
+
+    ulPosition = ulDictionaryLength;
+    ulLiteralStart = ulPosition;
+
+    while( ulPosition < xWindow.ulTotalLength )
+    {
+        ulMatchLength = 0;
+        ulDistance = 0;
+
+        if( ulPosition + lzdictMIN_MATCH <= xWindow.ulTotalLength )
+        {
+            ulCandidate = pxContext->usHashTable[ prvHash( &xWindow, ulPosition ) ];
+            prvInsert( pxContext, &xWindow, ulPosition );
+
+            if( ulCandidate != 0 )
+            {
+                ulCandidate--;
+                ulDistance = ulPosition - ulCandidate;
+
+                while( ( ulPosition + ulMatchLength < xWindow.ulTotalLength ) &&
+                       ( ulMatchLength < lzdictMAX_MATCH ) &&
+                       ( prvByteAt( &xWindow, ulCandidate + ulMatchLength ) ==
+                         prvByteAt( &xWindow, ulPosition + ulMatchLength ) ) )
+                {
+                    ulMatchLength++;
+                }
+            }
+        }
+
+        if( ulMatchLength < lzdictMIN_EMITTED )
+        {
+            ulPosition++;
+            continue;
+        }
+
+        if( ( xStatus = prvEmitLiterals( &xWindow, ulLiteralStart, ulPosition, pucOutput,
+                                         ulOutputSize, &ulOutputIndex ) ) != eLZDictSuccess )
+        {
+            return xStatus;
+        }
+
+        if( ulOutputIndex + 3 > ulOutputSize )
+        {
+            return eLZDictBufferTooSmall;
+        }
+
+        pucOutput[ ulOutputIndex++ ] = ( uint8_t ) ( lzdictMATCH_FLAG | ( ulMatchLength - lzdictMIN_MATCH ) );
+        pucOutput[ ulOutputIndex++ ] = ( uint8_t ) ( ulDistance >> 8 );
+        pucOutput[ ulOutputIndex++ ] = ( uint8_t ) ulDistance;
+
+        for( ulIndex = 1; ulIndex < ulMatchLength; ulIndex++ )
+        {
+            prvInsert( pxContext, &xWindow, ulPosition + ulIndex );
+        }
+
+        ulPosition += ulMatchLength;
+        ulLiteralStart = ulPosition;
+    }
+
+    if( ( xStatus = prvEmitLiterals( &xWindow, ulLiteralStart, ulPosition, pucOutput,
+                                     ulOutputSize, &ulOutputIndex ) ) != eLZDictSuccess )
+    {
+        return xStatus;
+    }
+
+    *pulOutputLength = ulOutputIndex;
+
+    return eLZDictSuccess;
+}
+/*-----------------------------------------------------------*/
+
+LZDictStatus_t LZDict_Decompress( const uint8_t * pucDictionary,
+                                  uint32_t ulDictionaryLength,
+                                  const uint8_t * pucInput,
+                                  uint32_t ulInputLength,
+                                  uint8_t * pucOutput,
+                                  uint32_t ulOutputSize,
+                                  uint32_t * pulOutputLength )
+{
+    uint32_t ulInputIndex = 0;
+    uint32_t ulOutputIndex = 0;
+    uint32_t ulLength;
+    uint32_t ulDistance;
+    uint8_t ucToken;
+
+    if( ( pucInput == NULL ) || ( pucOutput == NULL ) || ( pulOutputLength == NULL ) ||
+        ( ( pucDictionary == NULL ) && ( ulDictionaryLength != 0 ) ) )
+    {
+        return eLZDictInvalidParameter;
+    }
+
+    while( ulInputIndex < ulInputLength )
+    {
+        ucToken = pucInput[ ulInputIndex++ ];
+
+        if( ( ucToken & lzdictMATCH_FLAG ) == 0 )
+        {
+            ulLength = ( uint32_t ) ucToken + 1;
+
+            if( ulInputIndex + ulLength > ulInputLength )
+            {
+                return eLZDictCorruptInput;
+            }
+
+            if( ulOutputIndex + ulLength > ulOutputSize )
+            {
+                return eLZDictBufferTooSmall;
+            }
+
+            memcpy( &pucOutput[ ulOutputIndex ], &pucInput[ ulInputIndex ], ulLength );
+            ulInputIndex += ulLength;
+            ulOutputIndex += ulLength;
+        }
+        else
+        {
+            if( ulInputIndex + 2 > ulInputLength )
+            {
+                return eLZDictCorruptInput;
+            }
+
+            ulLength = ( uint32_t ) ( ucToken & ~lzdictMATCH_FLAG ) + lzdictMIN_MATCH;
+            ulDistance = ( ( uint32_t ) pucInput[ ulInputIndex ] << 8 ) | pucInput[ ulInputIndex + 1 ];
+            ulInputIndex += 2;
+
+            if( ( ulDistance == 0 ) || ( ulDistance > ulOutputIndex + ulDictionaryLength ) )
+            {
+                return eLZDictCorruptInput;
+            }
+
+            if( ulOutputIndex + ulLength > ulOutputSize )
+            {
+                return eLZDictBufferTooSmall;
+            }
+
+            /* Byte by byte, the match may overlap the bytes it produces. */
+            for( ; ulLength > 0; ulLength-- )
+            {
+                pucOutput[ ulOutputIndex ] = ( ulDistance > ulOutputIndex ) ?
+                                             pucDictionary[ ulDictionaryLength - ( ulDistance - ulOutputIndex ) ] :
+                                             pucOutput[ ulOutputIndex - ulDistance ];
+                ulOutputIndex++;
+            }
+        }
+    }
+
+    *pulOutputLength = ulOutputIndex;
+
+    return eLZDictSuccess;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,113 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file lz_dict.h
+ * @brief Small LZ77 compressor with a preset dictionary.
+ *
+ * Meant for short, repetitive JSON payloads such as telemetry, where most of
+ * the bytes are property names already known at build time. Seeding the
+ * match window with those names lets even the first message compress.
+ *
+ * Encoded stream, one token after the other:
+ *  - 0x00 - 0x7F: literal run of (token + 1) bytes, which follow the token.
+ *  - 0x80 - 0xFF: match of ((token & 0x7F) + 3) bytes, followed by the
+ *    big endian 16 bit distance back from the current position. Distances
+ *    reaching before the start of the output continue into the end of the
+ *    dictionary. The compressor only emits matches of 4 bytes or more.
+ *
+ * No heap is used; the only state is the caller provided #LZDictContext_t.
+ */
+
+#ifndef LZ_DICT_H
+#define LZ_DICT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Content encoding name of the stream, for message properties.
+ */
+#define LZ_DICT_ENCODING_NAME          "lzd1"
+
+/**
+ * @brief Log2 of the number of hash table entries.
+ */
+#ifndef LZ_DICT_HASH_BITS
+    #define LZ_DICT_HASH_BITS          ( 9U )
+#endif
+
+/**
+ * @brief Largest dictionary plus input size, bound by the 16 bit distance.
+ */
+#define LZ_DICT_MAX_WINDOW             ( 0xFFFFU )
+
+/**
+ * @brief Worst case compressed size of @p ulLength input bytes.
+ *
+ * Every match saves at least one byte, so the output is never larger than
+ * the input stored as literal runs: one token per 128 bytes.
+ */
+#define LZ_DICT_COMPRESS_BOUND( ulLength )    ( ( ulLength ) + ( ( ulLength ) + 127U ) / 128U )
+
+/**
+ * @brief Status of compression operations.
+ */
+typedef enum LZDictStatus
+{
+    eLZDictSuccess = 0,       /**< Operation succeeded. */
+    eLZDictInvalidParameter,  /**< A parameter was invalid. */
+    eLZDictBufferTooSmall,    /**< The output did not fit. */
+    eLZDictCorruptInput       /**< The encoded stream is malformed. */
+} LZDictStatus_t;
+
+/**
+ * @brief Compressor state. Keep it static, it is not needed between calls.
+ */
+typedef struct LZDictContext
+{
+    uint16_t usHashTable[ 1U << LZ_DICT_HASH_BITS ];
+} LZDictContext_t;
+
+/**
+ * @brief Compress a buffer.
+ *
+ * @param[in] pxContext Scratch state.
+ * @param[in] pucDictionary Preset dictionary, may be NULL.
+ * @param[in] ulDictionaryLength Length of dictionary.
+ * @param[in] pucInput Data to compress.
+ * @param[in] ulInputLength Length of data.
+ * @param[out] pucOutput Buffer for the compressed data.
+ * @param[in] ulOutputSize Size of @p pucOutput.
+ * @param[out] pulOutputLength Length of the compressed data.
+ * @return A #LZDictStatus_t with the result of the operation.
+ */
+LZDictStatus_t LZDict_Compress( LZDictContext_t * pxContext,
+                                const uint8_t * pucDictionary,
+                                uint32_t ulDictionaryLength,
+                                const uint8_t * pucInput,
+                                uint32_t ulInputLength,
+                                uint8_t * pucOutput,
+                                uint32_t ulOutputSize,
+                                uint32_t * pulOutputLength );
+
+/**
+ * @brief Decompress a buffer produced by #LZDict_Compress.
+ *
+ * @param[in] pucDictionary Dictionary used to compress, may be NULL.
+ * @param[in] ulDictionaryLength Length of dictionary.
+ * @param[in] pucInput Compressed data.
+ * @param[in] ulInputLength Length of compressed data.
+ * @param[out] pucOutput Buffer for the decompressed data.
+ * @param[in] ulOutputSize Size of @p pucOutput.
+ * @param[out] pulOutputLength Length of the decompressed data.
+ * @return A #LZDictStatus_t with the result of the operation.
+ */
+LZDictStatus_t LZDict_Decompress( const uint8_t * pucDictionary,
+                                  uint32_t ulDictionaryLength,
+                                  const uint8_t * pucInput,
+                                  uint32_t ulInputLength,
+                                  uint8_t * pucOutput,
+                                  uint32_t ulOutputSize,
+                                  uint32_t * pulOutputLength );
+
+#endif /* LZ_DICT_H */
@@ -0,0 +1,213 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file rate_controller.c
+ * @brief Telemetry interval controller driven by link quality and backlog.
+ */
+
+#include <string.h>
+
+#include "rate_controller.h"
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvClamp( uint32_t ulValue,
+                          uint32_t ulMin,
+                          uint32_t ulMax )
+{
+    if( ulValue < ulMin )
+    {
+        return ulMin;
+    }
+
+    return ( ulValue > ulMax ) ? ulMax : ulValue;
+}
+/*-----------------------------------------------------------*/
+
+bool RateController_Init( RateController_t * pxController,
+                          const RateControllerConfig_t * pxConfig )
+{
+    if( ( pxController == NULL ) || ( pxConfig == NULL ) ||
+        ( pxConfig->ulMinIntervalMs == 0 ) ||
+        ( pxConfig->ulMinIntervalMs > pxConfig->ulMaxIntervalMs ) )
+    {
+        return false;
+    }
+
+    memset( pxController, 0, sizeof( RateController_t ) );
+    pxController->xConfig = *pxConfig;
+    pxController->xConfig.ulNominalIntervalMs = prvClamp( pxConfig->ulNominalIntervalMs,
+                                                          pxConfig->ulMinIntervalMs,
+                                                          pxConfig->ulMaxIntervalMs );
+    pxController->ulIntervalMs = pxController->xConfig.ulNominalIntervalMs;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+bool RateController_SetBounds( RateController_t * pxController,
+                               uint32_t ulMinIntervalMs,
+                               uint32_t ulMaxIntervalMs )
+{
+    if( ( pxController == NULL ) || ( ulMinIntervalMs == 0 ) || ( ulMinIntervalMs > ulMaxIntervalMs ) )
+    {
+        return false;
+    }
+
+    pxController->xConfig.ulMinIntervalMs = ulMinIntervalMs;
+    pxController->xConfig.ulMaxIntervalMs = ulMaxIntervalMs;
+    pxController->xConfig.ulNominalIntervalMs = prvClamp( pxController->xConfig.ulNominalIntervalMs,
+                                                          ulMinIntervalMs, ulMaxIntervalMs );
+    pxController->ulIntervalMs = prvClamp( pxController->ulIntervalMs, ulMinIntervalMs, ulMaxIntervalMs );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+void RateController_SetNominal( RateController_t * pxController,
+                                uint32_t ulNominalIntervalMs )
+{
+    if( pxController != NULL )
+    {
+        pxController->xConfig.ulNominalIntervalMs = prvClamp( ulNominalIntervalMs,
+                                                              pxController->xConfig.ulMinIntervalMs,
+                                                              pxController->xConfig.ulMaxIntervalMs );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void RateController_RecordPublish( RateController_t * pxController,
+                                   uint32_t ulLatencyMs,
+                                   bool xAcknowledged )
+{
+    if( pxController == NULL )
+    {
+        return;
+    }
+
+    if( !xAcknowledged )
+    {
+        pxController->ulFailures++;
+    }
+    else if( !pxController->xHasLatency )
+    {
+        pxController->ulLatencyMs = ulLatencyMs;
+        pxController->xHasLatency = true;
+    }
+    else if( ulLatencyMs >= pxController->ulLatencyMs )
+    {
+        pxController->ulLatencyMs += ( ulLatencyMs - pxController->ulLatencyMs ) >> RATE_CONTROLLER_LATENCY_SHIFT;
+    }
+    else
+    {
+        pxController->ulLatencyMs -= ( pxController->ulLatencyMs - ulLatencyMs ) >> RATE_CONTROLLER_LATENCY_SHIFT;
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t RateController_Update( RateController_t * pxController,
+                                uint32_t ulQueueDepth,
+                                uint32_t ulBacklog,
+                                RateDecision_t * pxDecision )
+{
+    const RateControllerConfig_t * pxConfig;
+    RateReason_t xReason = eRateHold;
+    uint32_t ulPrevious;
+    uint32_t ulInterval;
+    uint32_t ulStep;
+    bool xCongested;
+    bool xHealthy;
+
+    if( pxController == NULL )
+    {
+        return 0;
+    }
+
+    pxConfig = &pxController->xConfig;
+    ulPrevious = pxController->ulIntervalMs;
+    ulInterval = ulPrevious;
+
+    xCongested = ( pxController->ulFailures > 0 ) ||
+                 ( ( pxConfig->ulMaxQueueDepth > 0 ) && ( ulQueueDepth >= pxConfig->ulMaxQueueDepth ) ) ||
+                 ( pxController->xHasLatency && ( pxController->ulLatencyMs > pxConfig->ulTargetLatencyMs ) );
+
+    /* Hysteresis: only speed up with clear headroom on both latency and
+     * queue, a queue without a limit always has headroom. */
+    xHealthy = !xCongested &&
+               ( pxController->ulLatencyMs <= pxConfig->ulTargetLatencyMs / 2 ) &&
+               ( ( pxConfig->ulMaxQueueDepth == 0 ) || ( ulQueueDepth * 2 < pxConfig->ulMaxQueueDepth ) );
+
+    if( xCongested )
+    {
+        ulInterval = ( ulPrevious > pxConfig->ulMaxIntervalMs / 2 ) ? pxConfig->ulMaxIntervalMs : ulPrevious * 2;
+        xReason = eRateBackOff;
+    }
+    else if( xHealthy && ( ulBacklog > 0 ) )
+    {
+        ulInterval = ulPrevious / 2;
+        xReason = eRateCatchUp;
+    }
+    else if( xHealthy && ( ulPrevious > pxConfig->ulNominalIntervalMs ) )
+    {
+        /* Close a quarter of the gap per cycle, at least one step. */
+        ulStep = ( ulPrevious - pxConfig->ulNominalIntervalMs ) / 4;
+        ulStep = ( ulStep > pxConfig->ulRecoverStepMs ) ? ulStep : pxConfig->ulRecoverStepMs;
+        ulInterval = ( ulPrevious - pxConfig->ulNominalIntervalMs > ulStep ) ?
+                     ulPrevious - ulStep : pxConfig->ulNominalIntervalMs;
+        xReason = eRateRecover;
+    }
+    else if( xHealthy && ( ulPrevious < pxConfig->ulNominalIntervalMs ) )
+    {
+        /* Backlog drained, return to nominal at once. */
+        ulInterval = pxConfig->ulNominalIntervalMs;
+        xReason = eRateRecover;
+    }
+
+    ulInterval = prvClamp( ulInterval, pxConfig->ulMinIntervalMs, pxConfig->ulMaxIntervalMs );
+
+    if( ulInterval == ulPrevious )
+    {
+        xReason = eRateHold;
+    }
+    else
+    {
+        pxController->ulDecisionCount++;
+    }
+
+    if( pxDecision != NULL )
+    {
+        pxDecision->xReason = xReason;
+        pxDecision->ulIntervalMs = ulInterval;
+        pxDecision->ulPreviousIntervalMs = ulPrevious;
+        pxDecision->ulLatencyMs = pxController->ulLatencyMs;
+        pxDecision->ulQueueDepth = ulQueueDepth;
+        pxDecision->ulBacklog = ulBacklog;
+        pxDecision->ulFailures = pxController->ulFailures;
+    }
+
+    pxController->ulIntervalMs = ulInterval;
+    pxController->ulFailures = 0;
+
+    return ulInterval;
+}
+/*-----------------------------------------------------------*/
+
+const char * RateController_ReasonName( RateReason_t xReason )
+{
+    switch( xReason )
+    {
+        case eRateBackOff:
+            return "backoff";
+
+        case eRateCatchUp:
+            return "catchup";
+
+        case eRateRecover:
+            return "recover";
+
+        default:
+            return "hold";
+    }
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,154 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file rate_controller.h
+ * @brief Telemetry interval controller driven by link quality and backlog.
+ *
+ * Feed it the PUBACK latency of every publish, then ask it once per send
+ * cycle for the next interval given the current send queue depth and the
+ * number of messages waiting in a store-and-forward backlog:
+ *  - Congested (smoothed latency above target, queue full or a publish
+ *    failed): the interval is doubled, up to the maximum.
+ *  - Healthy with a backlog: the interval is halved, down to the minimum,
+ *    so the backlog drains.
+ *  - Healthy without a backlog: the interval moves back to the nominal one,
+ *    closing a quarter of the gap per cycle.
+ *  - Otherwise it is held.
+ *
+ * The controller is plain integer arithmetic with no kernel dependency.
+ */
+
+#ifndef RATE_CONTROLLER_H
+#define RATE_CONTROLLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Weight of a new latency sample in the smoothed latency, as a shift.
+ *
+ * A value of 2 gives each sample a weight of 1/4.
+ */
+#ifndef RATE_CONTROLLER_LATENCY_SHIFT
+    #define RATE_CONTROLLER_LATENCY_SHIFT    ( 2U )
+#endif
+
+/**
+ * @brief Why the interval was chosen.
+ */
+typedef enum RateReason
+{
+    eRateHold = 0,    /**< Interval unchanged. */
+    eRateBackOff,     /**< Link congested, interval increased. */
+    eRateCatchUp,     /**< Link healthy with a backlog, interval decreased below nominal. */
+    eRateRecover      /**< Link healthy, interval moving back to nominal. */
+} RateReason_t;
+
+/**
+ * @brief Controller settings.
+ */
+typedef struct RateControllerConfig
+{
+    uint32_t ulNominalIntervalMs;   /**< @brief Interval on a healthy link without backlog. */
+    uint32_t ulMinIntervalMs;       /**< @brief Lower bound, used to drain a backlog. */
+    uint32_t ulMaxIntervalMs;       /**< @brief Upper bound when backing off. */
+    uint32_t ulTargetLatencyMs;     /**< @brief Smoothed PUBACK latency above which the link is congested. */
+    uint32_t ulMaxQueueDepth;       /**< @brief Outstanding publishes at which the link is congested, 0 for no limit. */
+    uint32_t ulRecoverStepMs;       /**< @brief Smallest interval change per cycle when returning to nominal. */
+} RateControllerConfig_t;
+
+/**
+ * @brief Outcome of one control cycle, suitable for reporting.
+ */
+typedef struct RateDecision
+{
+    RateReason_t xReason;
+    uint32_t ulIntervalMs;          /**< @brief Interval to wait before the next send. */
+    uint32_t ulPreviousIntervalMs;
+    uint32_t ulLatencyMs;           /**< @brief Smoothed PUBACK latency. */
+    uint32_t ulQueueDepth;
+    uint32_t ulBacklog;
+    uint32_t ulFailures;            /**< @brief Failed publishes since the previous cycle. */
+} RateDecision_t;
+
+/**
+ * @brief Controller state.
+ */
+typedef struct RateController
+{
+    RateControllerConfig_t xConfig;
+    uint32_t ulIntervalMs;
+    uint32_t ulLatencyMs;
+    bool xHasLatency;
+    uint32_t ulFailures;
+    uint32_t ulDecisionCount;
+} RateController_t;
+
+/**
+ * @brief Initialize a controller at its nominal interval.
+ *
+ * @param[out] pxController Controller to initialize.
+ * @param[in] pxConfig Settings, copied.
+ * @return true if the settings are consistent.
+ */
+bool RateController_Init( RateController_t * pxController,
+                          const RateControllerConfig_t * pxConfig );
+
+/**
+ * @brief Change the bounds, for example from writable device properties.
+ *
+ * The nominal and current intervals are clamped into the new bounds.
+ *
+ * @param[in] pxController Controller to update.
+ * @param[in] ulMinIntervalMs New lower bound.
+ * @param[in] ulMaxIntervalMs New upper bound.
+ * @return true if the bounds are consistent.
+ */
+bool RateController_SetBounds( RateController_t * pxController,
+                               uint32_t ulMinIntervalMs,
+                               uint32_t ulMaxIntervalMs );
+
+/**
+ * @brief Change the nominal interval, clamped into the bounds.
+ *
+ * @param[in] pxController Controller to update.
+ * @param[in] ulNominalIntervalMs New nominal interval.
+ */
+void RateController_SetNominal( RateController_t * pxController,
+                                uint32_t ulNominalIntervalMs );
+
+/**
+ * @brief Record the completion of one publish.
+ *
+ * @param[in] pxController Controller to update.
+ * @param[in] ulLatencyMs Send to PUBACK latency.
+ * @param[in] xAcknowledged false if the publish was abandoned.
+ */
+void RateController_RecordPublish( RateController_t * pxController,
+                                   uint32_t ulLatencyMs,
+                                   bool xAcknowledged );
+
+/**
+ * @brief Run one control cycle.
+ *
+ * @param[in] pxController Controller to update.
+ * @param[in] ulQueueDepth Publishes waiting for their PUBACK.
+ * @param[in] ulBacklog Messages waiting to be sent, 0 without store-and-forward.
+ * @param[out] pxDecision Outcome of the cycle, may be NULL.
+ * @return Interval to wait before the next send.
+ */
+uint32_t RateController_Update( RateController_t * pxController,
+                                uint32_t ulQueueDepth,
+                                uint32_t ulBacklog,
+                                RateDecision_t * pxDecision );
+
+/**
+ * @brief Short name of a reason, for logs and telemetry.
+ *
+ * @param[in] xReason Reason to name.
+ * @return Static string.
+ */
+const char * RateController_ReasonName( RateReason_t xReason );
+
+#endif /* RATE_CONTROLLER_H */
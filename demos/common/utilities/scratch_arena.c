@@ -0,0 +1,73 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file scratch_arena.c
+ * @brief Bump allocator for the scratch space of one operation at a time.
+ */
+
+#include "scratch_arena.h"
+
+#include <stddef.h>
+
+/*-----------------------------------------------------------*/
+
+void ScratchArena_Init( ScratchArena_t * pxArena,
+                        uint8_t * pucBuffer,
+                        uint32_t ulBufferSize )
+{
+    uint32_t ulPadding = ( uint32_t ) ( ( scratcharenaALIGNMENT - ( ( uintptr_t ) pucBuffer & ( scratcharenaALIGNMENT - 1U ) ) ) &
+                                        ( scratcharenaALIGNMENT - 1U ) );
+
+    if( ulPadding > ulBufferSize )
+    {
+        ulPadding = ulBufferSize;
+    }
+
+    pxArena->pucBuffer = &pucBuffer[ ulPadding ];
+    pxArena->ulSize = ulBufferSize - ulPadding;
+    pxArena->ulUsed = 0;
+}
+/*-----------------------------------------------------------*/
+
+void * ScratchArena_Alloc( ScratchArena_t * pxArena,
+                           uint32_t ulLength )
+{
+    void * pvAllocation;
+
+    if( ( ulLength == 0 ) || ( ulLength > pxArena->ulSize - pxArena->ulUsed ) )
+    {
+        return NULL;
+    }
+
+    pvAllocation = &pxArena->pucBuffer[ pxArena->ulUsed ];
+
+    /* The end may not be aligned, the next allocation would not fit anyway. */
+    if( scratcharenaSIZE( ulLength ) > pxArena->ulSize - pxArena->ulUsed )
+    {
+        pxArena->ulUsed = pxArena->ulSize;
+    }
+    else
+    {
+        pxArena->ulUsed += scratcharenaSIZE( ulLength );
+    }
+
+    return pvAllocation;
+}
+/*-----------------------------------------------------------*/
+
+ScratchArenaMark_t ScratchArena_Mark( const ScratchArena_t * pxArena )
+{
+    return pxArena->ulUsed;
+}
+/*-----------------------------------------------------------*/
+
+void ScratchArena_Reset( ScratchArena_t * pxArena,
+                         ScratchArenaMark_t xMark )
+{
+    if( xMark < pxArena->ulUsed )
+    {
+        pxArena->ulUsed = xMark;
+    }
+}
+/*-----------------------------------------------------------*/
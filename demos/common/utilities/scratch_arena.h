@@ -0,0 +1,104 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file scratch_arena.h
+ * @brief Bump allocator for the scratch space of one operation at a time.
+ *
+ * Buffers that are only used while an operation runs, like a telemetry
+ * payload or a command response, can share one arena instead of each having
+ * a static buffer. An operation takes a mark, allocates what it needs and
+ * resets the arena to the mark when it is done:
+ *
+ *     ScratchArenaMark_t xMark = ScratchArena_Mark( &xArena );
+ *     uint8_t * pucPayload = ScratchArena_Alloc( &xArena, 256 );
+ *     ...
+ *     ScratchArena_Reset( &xArena, xMark );
+ *
+ * Marks nest, so an operation may run inside another, like a callback of a
+ * process loop, as long as the arena holds both. The arena is sized for the
+ * largest set of buffers live at the same time, with #scratcharenaSIZE.
+ *
+ * There is no lock, use an arena from one task only.
+ */
+
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <stdint.h>
+
+/**
+ * @brief Alignment of the allocations, a power of two.
+ */
+#ifndef scratcharenaALIGNMENT
+    #define scratcharenaALIGNMENT    ( 8U )
+#endif
+
+/**
+ * @brief Space taken in an arena by an allocation of @p ulLength bytes.
+ */
+#define scratcharenaSIZE( ulLength )          ( ( ( ulLength ) + scratcharenaALIGNMENT - 1U ) & ~( scratcharenaALIGNMENT - 1U ) )
+
+/**
+ * @brief Size of a buffer holding allocations taking @p ulSpace, with room
+ * to align its start.
+ */
+#define scratcharenaBUFFER_SIZE( ulSpace )    ( ( ulSpace ) + scratcharenaALIGNMENT - 1U )
+
+/**
+ * @brief Arena state.
+ */
+typedef struct ScratchArena
+{
+    uint8_t * pucBuffer; /**< @brief Start of the arena, aligned. */
+    uint32_t ulSize;
+    uint32_t ulUsed;
+} ScratchArena_t;
+
+/**
+ * @brief Position of an arena to return to.
+ */
+typedef uint32_t ScratchArenaMark_t;
+
+/**
+ * @brief Initialize an arena on a buffer.
+ *
+ * @param[out] pxArena Arena to initialize.
+ * @param[in] pucBuffer Buffer of the allocations, kept for the life of the
+ * arena.
+ * @param[in] ulBufferSize Size of @p pucBuffer.
+ */
+void ScratchArena_Init( ScratchArena_t * pxArena,
+                        uint8_t * pucBuffer,
+                        uint32_t ulBufferSize );
+
+/**
+ * @brief Allocate from an arena.
+ *
+ * @param[in] pxArena Arena to allocate from.
+ * @param[in] ulLength Bytes to allocate.
+ * @return The allocation, aligned to #scratcharenaALIGNMENT, or NULL if the
+ * arena has no room for it.
+ */
+void * ScratchArena_Alloc( ScratchArena_t * pxArena,
+                           uint32_t ulLength );
+
+/**
+ * @brief Current position of an arena.
+ *
+ * @param[in] pxArena Arena.
+ * @return Mark to pass to #ScratchArena_Reset.
+ */
+ScratchArenaMark_t ScratchArena_Mark( const ScratchArena_t * pxArena );
+
+/**
+ * @brief Free the allocations made since a mark.
+ *
+ * @param[in] pxArena Arena.
+ * @param[in] xMark Mark of the same arena, not older than the marks it was
+ * reset to since.
+ */
+void ScratchArena_Reset( ScratchArena_t * pxArena,
+                         ScratchArenaMark_t xMark );
+
+#endif /* SCRATCH_ARENA_H */
@@ -0,0 +1,269 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file token_log.c
+ * @brief Packing and output of tokenised log messages.
+ *
+ * A message is the token, 4 bytes little endian, the number of arguments,
+ * their kinds packed two bits each, 0 integer, 1 double, 2 string, and their
+ * values in order:
+ *
+ * - integer: zigzag varint of its value sign extended to 64 bits;
+ * - double: 8 bytes little endian;
+ * - string: varint of the length times 4, plus 2 if truncated, plus 1 for a
+ *   NULL pointer, then the bytes.
+ *
+ * Arguments that do not fit in #tokenlogMAX_MESSAGE_SIZE are left out.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+#include "logging_levels.h"
+
+/* Any level, only the declarations are used. */
+#define LIBRARY_LOG_LEVEL    LOG_NONE
+#include "token_log.h"
+
+/*-----------------------------------------------------------*/
+
+#define tokenlogKIND_INTEGER    ( 0U )
+#define tokenlogKIND_DOUBLE     ( 1U )
+#define tokenlogKIND_STRING     ( 2U )
+
+/* '$', base64 of the message and "\r\n". */
+#define tokenlogLINE_SIZE       ( 1U + ( ( tokenlogMAX_MESSAGE_SIZE + 2U ) / 3U ) * 4U + 2U )
+
+extern void vLoggingPrintf( const char * pcFormatString,
+                            ... );
+
+static const char cBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write a varint, returns its length or 0 if it does not fit.
+ */
+static uint32_t prvPutVarint( uint8_t * pucBuffer,
+                              uint32_t ulSize,
+                              uint64_t ullValue )
+{
+    uint32_t ulLength = 0;
+
+    do
+    {
+        if( ulLength == ulSize )
+        {
+            return 0;
+        }
+
+        pucBuffer[ ulLength++ ] = ( uint8_t ) ( ( ullValue & 0x7FU ) | ( ( ullValue > 0x7FU ) ? 0x80U : 0U ) );
+        ullValue >>= 7;
+    } while( ullValue != 0 );
+
+    return ulLength;
+}
+/*-----------------------------------------------------------*/
+
+static int64_t prvGetInteger( const TokenLogArg_t * pxArg )
+{
+    int32_t lValue;
+    int64_t llValue;
+
+    /* Variadic arguments are at least an int, 4 or 8 bytes here. */
+    if( pxArg->ucSize == sizeof( int64_t ) )
+    {
+        memcpy( &llValue, pxArg->pvValue, sizeof( llValue ) );
+
+        return llValue;
+    }
+
+    memcpy( &lValue, pxArg->pvValue, sizeof( lValue ) );
+
+    return lValue;
+}
+/*-----------------------------------------------------------*/
+
+static double prvGetDouble( const TokenLogArg_t * pxArg )
+{
+    if( pxArg->ucKind == eTokenLogArgFloat )
+    {
+        return *( const float * ) pxArg->pvValue;
+    }
+    else if( pxArg->ucKind == eTokenLogArgLongDouble )
+    {
+        return ( double ) *( const long double * ) pxArg->pvValue;
+    }
+
+    return *( const double * ) pxArg->pvValue;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the arguments after the header, returns the length of the
+ * message.
+ */
+static uint32_t prvPutArgs( uint8_t * pucMessage,
+                            uint32_t ulLength,
+                            int xHasStar,
+                            const TokenLogArg_t * pxArgs,
+                            uint32_t ulArgCount )
+{
+    const char * pcString;
+    uint64_t ullBits;
+    int64_t llValue;
+    int64_t llPrecision = -1;
+    double xValue;
+    uint32_t ulStringLength;
+    uint32_t ulHeaderLength;
+    uint32_t ulMaxLength;
+    uint32_t ulPut;
+    uint32_t ulArg;
+    uint32_t ulByte;
+
+    for( ulArg = 0; ulArg < ulArgCount; ulArg++ )
+    {
+        switch( pxArgs[ ulArg ].ucKind )
+        {
+            case eTokenLogArgString:
+                memcpy( &pcString, pxArgs[ ulArg ].pvValue, sizeof( pcString ) );
+                ulMaxLength = tokenlogMAX_STRING_LENGTH;
+                ulHeaderLength = 0;
+
+                if( pcString == NULL )
+                {
+                    ulStringLength = 0;
+                }
+                else if( xHasStar && ( llPrecision >= 0 ) && ( llPrecision <= ( int64_t ) ulMaxLength ) )
+                {
+                    /* No more than the precision of a "%.*s" is read, the
+                     * string need not end. */
+                    ulStringLength = ( uint32_t ) strnlen( pcString, ( size_t ) llPrecision );
+                }
+                else
+                {
+                    ulStringLength = ( uint32_t ) strnlen( pcString, ulMaxLength );
+
+                    /* Marked as cut if the string goes on. */
+                    if( ( ulStringLength == ulMaxLength ) && ( pcString[ ulMaxLength ] != '\0' ) )
+                    {
+                        ulHeaderLength = 2U;
+                    }
+                }
+
+                if( ulStringLength + 2U > tokenlogMAX_MESSAGE_SIZE - ulLength )
+                {
+                    if( tokenlogMAX_MESSAGE_SIZE - ulLength < 3U )
+                    {
+                        return ulLength;
+                    }
+
+                    ulStringLength = tokenlogMAX_MESSAGE_SIZE - ulLength - 2U;
+                    ulHeaderLength = 2U;
+                }
+
+                ulPut = prvPutVarint( &pucMessage[ ulLength ], tokenlogMAX_MESSAGE_SIZE - ulLength,
+                                      ( ( uint64_t ) ulStringLength << 2 ) | ulHeaderLength | ( ( pcString == NULL ) ? 1U : 0U ) );
+
+                if( ulPut == 0 )
+                {
+                    return ulLength;
+                }
+
+                ulLength += ulPut;
+                memcpy( &pucMessage[ ulLength ], pcString, ulStringLength );
+                ulLength += ulStringLength;
+                llPrecision = -1;
+                break;
+
+            case eTokenLogArgFloat:
+            case eTokenLogArgDouble:
+            case eTokenLogArgLongDouble:
+
+                if( tokenlogMAX_MESSAGE_SIZE - ulLength < sizeof( ullBits ) )
+                {
+                    return ulLength;
+                }
+
+                xValue = prvGetDouble( &pxArgs[ ulArg ] );
+                memcpy( &ullBits, &xValue, sizeof( ullBits ) );
+
+                for( ulByte = 0; ulByte < sizeof( ullBits ); ulByte++ )
+                {
+                    pucMessage[ ulLength++ ] = ( uint8_t ) ( ullBits >> ( ulByte * 8U ) );
+                }
+
+                llPrecision = -1;
+                break;
+
+            default:
+                llValue = prvGetInteger( &pxArgs[ ulArg ] );
+                ulPut = prvPutVarint( &pucMessage[ ulLength ], tokenlogMAX_MESSAGE_SIZE - ulLength,
+                                      ( ( uint64_t ) llValue << 1 ) ^ ( uint64_t ) ( llValue >> 63 ) );
+
+                if( ulPut == 0 )
+                {
+                    return ulLength;
+                }
+
+                ulLength += ulPut;
+                llPrecision = llValue;
+                break;
+        }
+    }
+
+    return ulLength;
+}
+/*-----------------------------------------------------------*/
+
+void TokenLog_Write( uint32_t ulToken,
+                     int xHasStar,
+                     const TokenLogArg_t * pxArgs,
+                     uint32_t ulArgCount )
+{
+    uint8_t ucMessage[ tokenlogMAX_MESSAGE_SIZE ];
+    char cLine[ tokenlogLINE_SIZE ];
+    uint32_t ulKindsLength = ( ulArgCount + 3U ) / 4U;
+    uint32_t ulLength;
+    uint32_t ulLineLength = 0;
+    uint32_t ulBits;
+    uint32_t ulKind;
+    uint32_t ulArg;
+    uint32_t ulByte;
+
+    ucMessage[ 0 ] = ( uint8_t ) ulToken;
+    ucMessage[ 1 ] = ( uint8_t ) ( ulToken >> 8 );
+    ucMessage[ 2 ] = ( uint8_t ) ( ulToken >> 16 );
+    ucMessage[ 3 ] = ( uint8_t ) ( ulToken >> 24 );
+    ucMessage[ 4 ] = ( uint8_t ) ulArgCount;
+    memset( &ucMessage[ 5 ], 0, ulKindsLength );
+
+    for( ulArg = 0; ulArg < ulArgCount; ulArg++ )
+    {
+        ulKind = ( pxArgs[ ulArg ].ucKind == eTokenLogArgString ) ? tokenlogKIND_STRING :
+                 ( pxArgs[ ulArg ].ucKind == eTokenLogArgInteger ) ? tokenlogKIND_INTEGER : tokenlogKIND_DOUBLE;
+        ucMessage[ 5U + ulArg / 4U ] |= ( uint8_t ) ( ulKind << ( ( ulArg % 4U ) * 2U ) );
+    }
+
+    ulLength = prvPutArgs( ucMessage, 5U + ulKindsLength, xHasStar, pxArgs, ulArgCount );
+
+    cLine[ ulLineLength++ ] = '$';
+
+    for( ulByte = 0; ulByte < ulLength; ulByte += 3U )
+    {
+        ulBits = ( uint32_t ) ucMessage[ ulByte ] << 16;
+        ulBits |= ( ulByte + 1U < ulLength ) ? ( uint32_t ) ucMessage[ ulByte + 1U ] << 8 : 0U;
+        ulBits |= ( ulByte + 2U < ulLength ) ? ( uint32_t ) ucMessage[ ulByte + 2U ] : 0U;
+
+        cLine[ ulLineLength++ ] = cBase64[ ( ulBits >> 18 ) & 0x3FU ];
+        cLine[ ulLineLength++ ] = cBase64[ ( ulBits >> 12 ) & 0x3FU ];
+        cLine[ ulLineLength++ ] = ( ulByte + 1U < ulLength ) ? cBase64[ ( ulBits >> 6 ) & 0x3FU ] : '=';
+        cLine[ ulLineLength++ ] = ( ulByte + 2U < ulLength ) ? cBase64[ ulBits & 0x3FU ] : '=';
+    }
+
+    cLine[ ulLineLength++ ] = '\r';
+    cLine[ ulLineLength++ ] = '\n';
+
+    tokenlogOUTPUT( cLine, ulLineLength );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,191 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file token_log.h
+ * @brief Tokenised logging: the device sends a token of the format and the
+ * arguments, a host tool turns them back into text.
+ *
+ * Include in place of logging_stack.h, after logging_levels.h and the
+ * LIBRARY_LOG_NAME and LIBRARY_LOG_LEVEL definitions, to make LogError,
+ * LogWarn, LogInfo and LogDebug tokenised. The call sites stay the same.
+ *
+ * Each log call keeps its format, with the level, library, file and line
+ * prefix of logging_stack.h, in the .tokenlog section, which token_log.ld
+ * leaves out of the loaded image. At run time it only computes the token of
+ * the format, see token_log_hash.h, and packs the arguments:
+ *
+ * - integers and pointers as zigzag varints;
+ * - floating point numbers as 8 byte doubles;
+ * - char and uint8_t pointers as the bytes of the string, up to its
+ *   terminator, the precision of a "%.*s" or #tokenlogMAX_STRING_LENGTH.
+ *
+ * The message is written with #tokenlogOUTPUT as '$', the message in base64
+ * and "\r\n", so it can share the output with text logs. tools/token_log
+ * extracts the formats of an image into a dictionary and decodes the output.
+ *
+ * Needs GCC: the section attribute, __typeof__ and the comma elision of
+ * ##__VA_ARGS__. Build with optimization, without it the formats stay in the
+ * image as well.
+ */
+
+#ifndef TOKEN_LOG_H
+#define TOKEN_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "token_log_hash.h"
+
+/**
+ * @brief Most bytes of a message, token and arguments.
+ */
+#ifndef tokenlogMAX_MESSAGE_SIZE
+    #define tokenlogMAX_MESSAGE_SIZE     ( 96U )
+#endif
+
+/**
+ * @brief Most bytes kept of a string argument.
+ */
+#ifndef tokenlogMAX_STRING_LENGTH
+    #define tokenlogMAX_STRING_LENGTH    ( 48U )
+#endif
+
+/**
+ * @brief Writes a line of @p ulLength characters at @p pcLine.
+ */
+#ifndef tokenlogOUTPUT
+    #define tokenlogOUTPUT( pcLine, ulLength )    vLoggingPrintf( "%.*s", ( int ) ( ulLength ), ( pcLine ) )
+#endif
+
+/**
+ * @brief Kinds of arguments, by their C type.
+ */
+typedef enum TokenLogArgKind
+{
+    eTokenLogArgInteger = 0, /**< @brief Integer or pointer other than a string. */
+    eTokenLogArgFloat,
+    eTokenLogArgDouble,
+    eTokenLogArgLongDouble,
+    eTokenLogArgString       /**< @brief char or uint8_t pointer. */
+} TokenLogArgKind_t;
+
+/**
+ * @brief An argument of a log call, pointing to a copy of its value.
+ */
+typedef struct TokenLogArg
+{
+    const void * pvValue;
+    uint8_t ucSize;
+    uint8_t ucKind;
+} TokenLogArg_t;
+
+/**
+ * @brief Pack a message and write it, called by the Log macros.
+ *
+ * @param[in] ulToken Token of the format.
+ * @param[in] xHasStar Whether the format takes a precision argument, then a
+ * string after an integer is bounded by it.
+ * @param[in] pxArgs Arguments.
+ * @param[in] ulArgCount Number of @p pxArgs.
+ */
+void TokenLog_Write( uint32_t ulToken,
+                     int xHasStar,
+                     const TokenLogArg_t * pxArgs,
+                     uint32_t ulArgCount );
+
+/*-----------------------------------------------------------*/
+
+/* Type of an argument after the promotions of a variadic call. */
+#define tokenlogPROMOTED( xArg )    __typeof__( 1 ? ( xArg ) : ( xArg ) )
+
+#define tokenlogARG_KIND( xArg )             \
+    _Generic( ( 1 ? ( xArg ) : ( xArg ) ),   \
+              char *: eTokenLogArgString,          \
+              const char *: eTokenLogArgString,    \
+              signed char *: eTokenLogArgString,   \
+              const signed char *: eTokenLogArgString, \
+              unsigned char *: eTokenLogArgString, \
+              const unsigned char *: eTokenLogArgString, \
+              float: eTokenLogArgFloat,            \
+              double: eTokenLogArgDouble,          \
+              long double: eTokenLogArgLongDouble, \
+              default: eTokenLogArgInteger )
+
+#define tokenlogARG( xArg )                                    \
+    { &( tokenlogPROMOTED( xArg ) ) { ( xArg ) },                   \
+      ( uint8_t ) sizeof( tokenlogPROMOTED( xArg ) ),             \
+      ( uint8_t ) tokenlogARG_KIND( xArg ) }
+
+/* Applies tokenlogARG to up to 12 arguments. */
+#define tokenlogARGS_1( a )                                        tokenlogARG( a )
+#define tokenlogARGS_2( a, ... )                                   tokenlogARG( a ), tokenlogARGS_1( __VA_ARGS__ )
+#define tokenlogARGS_3( a, ... )                                   tokenlogARG( a ), tokenlogARGS_2( __VA_ARGS__ )
+#define tokenlogARGS_4( a, ... )                                   tokenlogARG( a ), tokenlogARGS_3( __VA_ARGS__ )
+#define tokenlogARGS_5( a, ... )                                   tokenlogARG( a ), tokenlogARGS_4( __VA_ARGS__ )
+#define tokenlogARGS_6( a, ... )                                   tokenlogARG( a ), tokenlogARGS_5( __VA_ARGS__ )
+#define tokenlogARGS_7( a, ... )                                   tokenlogARG( a ), tokenlogARGS_6( __VA_ARGS__ )
+#define tokenlogARGS_8( a, ... )                                   tokenlogARG( a ), tokenlogARGS_7( __VA_ARGS__ )
+#define tokenlogARGS_9( a, ... )                                   tokenlogARG( a ), tokenlogARGS_8( __VA_ARGS__ )
+#define tokenlogARGS_10( a, ... )                                  tokenlogARG( a ), tokenlogARGS_9( __VA_ARGS__ )
+#define tokenlogARGS_11( a, ... )                                  tokenlogARG( a ), tokenlogARGS_10( __VA_ARGS__ )
+#define tokenlogARGS_12( a, ... )                                  tokenlogARG( a ), tokenlogARGS_11( __VA_ARGS__ )
+#define tokenlogSELECT( _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, xName, ... )    xName
+#define tokenlogARGS( ... )                                                                      \
+    tokenlogSELECT( __VA_ARGS__, tokenlogARGS_12, tokenlogARGS_11, tokenlogARGS_10, tokenlogARGS_9, \
+                    tokenlogARGS_8, tokenlogARGS_7, tokenlogARGS_6, tokenlogARGS_5, tokenlogARGS_4,    \
+                    tokenlogARGS_3, tokenlogARGS_2, tokenlogARGS_1, unused )( __VA_ARGS__ )
+
+/**
+ * @brief Log a format and at least one argument.
+ */
+#define tokenlogWRITE( pcFormat, ... )                                                    \
+    do {                                                                                  \
+        static const char pcTokenLogEntry[] __attribute__( ( section( ".tokenlog" ), used ) ) = pcFormat; \
+        const TokenLogArg_t xTokenLogArgs[] = { tokenlogARGS( __VA_ARGS__ ) };            \
+        TokenLog_Write( tokenlogHASH( pcFormat, pcTokenLogEntry ),                        \
+                        tokenlogHAS_STAR( pcFormat, pcTokenLogEntry ),                    \
+                        xTokenLogArgs, sizeof( xTokenLogArgs ) / sizeof( xTokenLogArgs[ 0 ] ) ); \
+    } while( 0 )
+
+/* The message of a Log macro is a parenthesized format and arguments, the
+ * format is joined to the prefix and the line is the first argument. */
+#define tokenlogCALL( xMacro, xArguments )                    xMacro xArguments
+#define tokenlogUNWRAP( ... )                                 __VA_ARGS__
+#define tokenlogJOIN( pcPrefix, pcFormat, ... )               tokenlogWRITE( pcPrefix pcFormat "\r\n", __LINE__, ## __VA_ARGS__ )
+#define tokenlogMESSAGE( pcLevel, message )                                          \
+    tokenlogCALL( tokenlogJOIN,                                                      \
+                  ( "[" pcLevel "] [" LIBRARY_LOG_NAME "] [" __FILE__ ":%d] ", tokenlogUNWRAP message ) )
+
+#endif /* TOKEN_LOG_H */
+
+/* The levels follow the LIBRARY_LOG_LEVEL of each including header, as with
+ * logging_stack.h. */
+#undef LogError
+#undef LogWarn
+#undef LogInfo
+#undef LogDebug
+
+#if LIBRARY_LOG_LEVEL >= LOG_ERROR
+    #define LogError( message )    tokenlogMESSAGE( "ERROR", message )
+#else
+    #define LogError( message )
+#endif
+
+#if LIBRARY_LOG_LEVEL >= LOG_WARN
+    #define LogWarn( message )     tokenlogMESSAGE( "WARN", message )
+#else
+    #define LogWarn( message )
+#endif
+
+#if LIBRARY_LOG_LEVEL >= LOG_INFO
+    #define LogInfo( message )     tokenlogMESSAGE( "INFO", message )
+#else
+    #define LogInfo( message )
+#endif
+
+#if LIBRARY_LOG_LEVEL >= LOG_DEBUG
+    #define LogDebug( message )    tokenlogMESSAGE( "DEBUG", message )
+#else
+    #define LogDebug( message )
+#endif
@@ -0,0 +1,304 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file token_log_hash.h
+ * @brief Token of a format string of token_log.h, computed by the compiler.
+ *
+ * The token is the length of the format plus each of its last
+ * #tokenlogHASH_LENGTH characters times a power of 65599, the last character
+ * times 65599, the one before times 65599^2 and so on, modulo 2^32. The
+ * powers are written out below. The characters are read from the end, so the
+ * path of the file at the start of the formats does not push the message out
+ * of the hashed characters. tools/token_log computes the same hash.
+ *
+ * With optimization the expressions fold to constants and the string literal
+ * is not kept in the image.
+ */
+
+#ifndef TOKEN_LOG_HASH_H
+#define TOKEN_LOG_HASH_H
+
+#include <stdint.h>
+
+/**
+ * @brief Characters hashed, from the end of the format.
+ */
+#define tokenlogHASH_LENGTH    ( 128U )
+
+/**
+ * @brief Character @p ulIndex from the end of @p pcFormat, 0 past its start.
+ *
+ * @p pcEntry is an array holding the same format, only its size is used.
+ */
+#define tokenlogCHAR( pcFormat, pcEntry, ulIndex ) \
+    ( ( uint32_t ) ( uint8_t ) ( pcFormat )[ ( ( ulIndex ) < sizeof( pcEntry ) - 1U ) ? sizeof( pcEntry ) - 2U - ( ulIndex ) : sizeof( pcEntry ) - 1U ] )
+
+/**
+ * @brief Token of a string literal.
+ */
+#define tokenlogHASH( pcFormat, pcEntry ) \
+    ( ( uint32_t ) ( sizeof( pcEntry ) - 1U ) + \
+      0x0001003FU * tokenlogCHAR( pcFormat, pcEntry, 0 ) + \
+      0x007E0F81U * tokenlogCHAR( pcFormat, pcEntry, 1 ) + \
+      0x2E86D0BFU * tokenlogCHAR( pcFormat, pcEntry, 2 ) + \
+      0x43EC5F01U * tokenlogCHAR( pcFormat, pcEntry, 3 ) + \
+      0x162C613FU * tokenlogCHAR( pcFormat, pcEntry, 4 ) + \
+      0xD62AEE81U * tokenlogCHAR( pcFormat, pcEntry, 5 ) + \
+      0xA311B1BFU * tokenlogCHAR( pcFormat, pcEntry, 6 ) + \
+      0xD319BE01U * tokenlogCHAR( pcFormat, pcEntry, 7 ) + \
+      0xB156C23FU * tokenlogCHAR( pcFormat, pcEntry, 8 ) + \
+      0x6698CD81U * tokenlogCHAR( pcFormat, pcEntry, 9 ) + \
+      0x0D1B92BFU * tokenlogCHAR( pcFormat, pcEntry, 10 ) + \
+      0xCC881D01U * tokenlogCHAR( pcFormat, pcEntry, 11 ) + \
+      0x7280233FU * tokenlogCHAR( pcFormat, pcEntry, 12 ) + \
+      0x50C7AC81U * tokenlogCHAR( pcFormat, pcEntry, 13 ) + \
+      0x8DA473BFU * tokenlogCHAR( pcFormat, pcEntry, 14 ) + \
+      0x4F377C01U * tokenlogCHAR( pcFormat, pcEntry, 15 ) + \
+      0xFAA8843FU * tokenlogCHAR( pcFormat, pcEntry, 16 ) + \
+      0x33B78B81U * tokenlogCHAR( pcFormat, pcEntry, 17 ) + \
+      0x45AC54BFU * tokenlogCHAR( pcFormat, pcEntry, 18 ) + \
+      0x7A27DB01U * tokenlogCHAR( pcFormat, pcEntry, 19 ) + \
+      0xEACFE53FU * tokenlogCHAR( pcFormat, pcEntry, 20 ) + \
+      0xAE686A81U * tokenlogCHAR( pcFormat, pcEntry, 21 ) + \
+      0x563335BFU * tokenlogCHAR( pcFormat, pcEntry, 22 ) + \
+      0x6C593A01U * tokenlogCHAR( pcFormat, pcEntry, 23 ) + \
+      0xE3F6463FU * tokenlogCHAR( pcFormat, pcEntry, 24 ) + \
+      0x5FDA4981U * tokenlogCHAR( pcFormat, pcEntry, 25 ) + \
+      0xE03916BFU * tokenlogCHAR( pcFormat, pcEntry, 26 ) + \
+      0x44CB9901U * tokenlogCHAR( pcFormat, pcEntry, 27 ) + \
+      0x871BA73FU * tokenlogCHAR( pcFormat, pcEntry, 28 ) + \
+      0xE70D2881U * tokenlogCHAR( pcFormat, pcEntry, 29 ) + \
+      0x04BDF7BFU * tokenlogCHAR( pcFormat, pcEntry, 30 ) + \
+      0x227EF801U * tokenlogCHAR( pcFormat, pcEntry, 31 ) + \
+      0x7540083FU * tokenlogCHAR( pcFormat, pcEntry, 32 ) + \
+      0xE3010781U * tokenlogCHAR( pcFormat, pcEntry, 33 ) + \
+      0xE4C1D8BFU * tokenlogCHAR( pcFormat, pcEntry, 34 ) + \
+      0x24735701U * tokenlogCHAR( pcFormat, pcEntry, 35 ) + \
+      0x4F63693FU * tokenlogCHAR( pcFormat, pcEntry, 36 ) + \
+      0xF2B5E681U * tokenlogCHAR( pcFormat, pcEntry, 37 ) + \
+      0xA144B9BFU * tokenlogCHAR( pcFormat, pcEntry, 38 ) + \
+      0x69A8B601U * tokenlogCHAR( pcFormat, pcEntry, 39 ) + \
+      0xB685CA3FU * tokenlogCHAR( pcFormat, pcEntry, 40 ) + \
+      0xB52BC581U * tokenlogCHAR( pcFormat, pcEntry, 41 ) + \
+      0x5B469ABFU * tokenlogCHAR( pcFormat, pcEntry, 42 ) + \
+      0x111F1501U * tokenlogCHAR( pcFormat, pcEntry, 43 ) + \
+      0x4BA72B3FU * tokenlogCHAR( pcFormat, pcEntry, 44 ) + \
+      0xC962A481U * tokenlogCHAR( pcFormat, pcEntry, 45 ) + \
+      0x33C77BBFU * tokenlogCHAR( pcFormat, pcEntry, 46 ) + \
+      0x39D67401U * tokenlogCHAR( pcFormat, pcEntry, 47 ) + \
+      0xAFC78C3FU * tokenlogCHAR( pcFormat, pcEntry, 48 ) + \
+      0xCE5A8381U * tokenlogCHAR( pcFormat, pcEntry, 49 ) + \
+      0x4BC75CBFU * tokenlogCHAR( pcFormat, pcEntry, 50 ) + \
+      0x02CED301U * tokenlogCHAR( pcFormat, pcEntry, 51 ) + \
+      0x83E6ED3FU * tokenlogCHAR( pcFormat, pcEntry, 52 ) + \
+      0x63136281U * tokenlogCHAR( pcFormat, pcEntry, 53 ) + \
+      0xC4463DBFU * tokenlogCHAR( pcFormat, pcEntry, 54 ) + \
+      0x8B083201U * tokenlogCHAR( pcFormat, pcEntry, 55 ) + \
+      0x69054E3FU * tokenlogCHAR( pcFormat, pcEntry, 56 ) + \
+      0x268D4181U * tokenlogCHAR( pcFormat, pcEntry, 57 ) + \
+      0xBE441EBFU * tokenlogCHAR( pcFormat, pcEntry, 58 ) + \
+      0xF1829101U * tokenlogCHAR( pcFormat, pcEntry, 59 ) + \
+      0x0022AF3FU * tokenlogCHAR( pcFormat, pcEntry, 60 ) + \
+      0xB7C82081U * tokenlogCHAR( pcFormat, pcEntry, 61 ) + \
+      0x5AC0FFBFU * tokenlogCHAR( pcFormat, pcEntry, 62 ) + \
+      0x553DF001U * tokenlogCHAR( pcFormat, pcEntry, 63 ) + \
+      0xEA3F103FU * tokenlogCHAR( pcFormat, pcEntry, 64 ) + \
+      0xB5C3FF81U * tokenlogCHAR( pcFormat, pcEntry, 65 ) + \
+      0xBABCE0BFU * tokenlogCHAR( pcFormat, pcEntry, 66 ) + \
+      0xD53A4F01U * tokenlogCHAR( pcFormat, pcEntry, 67 ) + \
+      0xC85A713FU * tokenlogCHAR( pcFormat, pcEntry, 68 ) + \
+      0xBF80DE81U * tokenlogCHAR( pcFormat, pcEntry, 69 ) + \
+      0xFF37C1BFU * tokenlogCHAR( pcFormat, pcEntry, 70 ) + \
+      0x9077AE01U * tokenlogCHAR( pcFormat, pcEntry, 71 ) + \
+      0x3B74D23FU * tokenlogCHAR( pcFormat, pcEntry, 72 ) + \
+      0x73FEBD81U * tokenlogCHAR( pcFormat, pcEntry, 73 ) + \
+      0x4931A2BFU * tokenlogCHAR( pcFormat, pcEntry, 74 ) + \
+      0xA5F60D01U * tokenlogCHAR( pcFormat, pcEntry, 75 ) + \
+      0xE48E333FU * tokenlogCHAR( pcFormat, pcEntry, 76 ) + \
+      0x723D9C81U * tokenlogCHAR( pcFormat, pcEntry, 77 ) + \
+      0xB9AA83BFU * tokenlogCHAR( pcFormat, pcEntry, 78 ) + \
+      0x34B56C01U * tokenlogCHAR( pcFormat, pcEntry, 79 ) + \
+      0x64A6943FU * tokenlogCHAR( pcFormat, pcEntry, 80 ) + \
+      0x593D7B81U * tokenlogCHAR( pcFormat, pcEntry, 81 ) + \
+      0x71A264BFU * tokenlogCHAR( pcFormat, pcEntry, 82 ) + \
+      0x5BB5CB01U * tokenlogCHAR( pcFormat, pcEntry, 83 ) + \
+      0x5CBDF53FU * tokenlogCHAR( pcFormat, pcEntry, 84 ) + \
+      0xC7FE5A81U * tokenlogCHAR( pcFormat, pcEntry, 85 ) + \
+      0x921945BFU * tokenlogCHAR( pcFormat, pcEntry, 86 ) + \
+      0x39F72A01U * tokenlogCHAR( pcFormat, pcEntry, 87 ) + \
+      0x6DD4563FU * tokenlogCHAR( pcFormat, pcEntry, 88 ) + \
+      0x5D803981U * tokenlogCHAR( pcFormat, pcEntry, 89 ) + \
+      0x3C0F26BFU * tokenlogCHAR( pcFormat, pcEntry, 90 ) + \
+      0xEE798901U * tokenlogCHAR( pcFormat, pcEntry, 91 ) + \
+      0x38E9B73FU * tokenlogCHAR( pcFormat, pcEntry, 92 ) + \
+      0xB8C31881U * tokenlogCHAR( pcFormat, pcEntry, 93 ) + \
+      0x908407BFU * tokenlogCHAR( pcFormat, pcEntry, 94 ) + \
+      0x983CE801U * tokenlogCHAR( pcFormat, pcEntry, 95 ) + \
+      0x5EFE183FU * tokenlogCHAR( pcFormat, pcEntry, 96 ) + \
+      0x78C6F781U * tokenlogCHAR( pcFormat, pcEntry, 97 ) + \
+      0xB077E8BFU * tokenlogCHAR( pcFormat, pcEntry, 98 ) + \
+      0x56414701U * tokenlogCHAR( pcFormat, pcEntry, 99 ) + \
+      0x8111793FU * tokenlogCHAR( pcFormat, pcEntry, 100 ) + \
+      0x3C8BD681U * tokenlogCHAR( pcFormat, pcEntry, 101 ) + \
+      0xBCEAC9BFU * tokenlogCHAR( pcFormat, pcEntry, 102 ) + \
+      0x4786A601U * tokenlogCHAR( pcFormat, pcEntry, 103 ) + \
+      0x4023DA3FU * tokenlogCHAR( pcFormat, pcEntry, 104 ) + \
+      0xA311B581U * tokenlogCHAR( pcFormat, pcEntry, 105 ) + \
+      0xD6DCAABFU * tokenlogCHAR( pcFormat, pcEntry, 106 ) + \
+      0x8B0D0501U * tokenlogCHAR( pcFormat, pcEntry, 107 ) + \
+      0x3D353B3FU * tokenlogCHAR( pcFormat, pcEntry, 108 ) + \
+      0x4B589481U * tokenlogCHAR( pcFormat, pcEntry, 109 ) + \
+      0x1F4D8BBFU * tokenlogCHAR( pcFormat, pcEntry, 110 ) + \
+      0x3FD46401U * tokenlogCHAR( pcFormat, pcEntry, 111 ) + \
+      0x19459C3FU * tokenlogCHAR( pcFormat, pcEntry, 112 ) + \
+      0xD4607381U * tokenlogCHAR( pcFormat, pcEntry, 113 ) + \
+      0xB73D6CBFU * tokenlogCHAR( pcFormat, pcEntry, 114 ) + \
+      0x84DCC301U * tokenlogCHAR( pcFormat, pcEntry, 115 ) + \
+      0x7554FD3FU * tokenlogCHAR( pcFormat, pcEntry, 116 ) + \
+      0xDD295281U * tokenlogCHAR( pcFormat, pcEntry, 117 ) + \
+      0xBFAC4DBFU * tokenlogCHAR( pcFormat, pcEntry, 118 ) + \
+      0x79262201U * tokenlogCHAR( pcFormat, pcEntry, 119 ) + \
+      0xF2635E3FU * tokenlogCHAR( pcFormat, pcEntry, 120 ) + \
+      0x04B33181U * tokenlogCHAR( pcFormat, pcEntry, 121 ) + \
+      0x599A2EBFU * tokenlogCHAR( pcFormat, pcEntry, 122 ) + \
+      0x3BB08101U * tokenlogCHAR( pcFormat, pcEntry, 123 ) + \
+      0x3170BF3FU * tokenlogCHAR( pcFormat, pcEntry, 124 ) + \
+      0xE9FE1081U * tokenlogCHAR( pcFormat, pcEntry, 125 ) + \
+      0xA6070FBFU * tokenlogCHAR( pcFormat, pcEntry, 126 ) + \
+      0xEB7BE001U * tokenlogCHAR( pcFormat, pcEntry, 127 ) )
+
+/**
+ * @brief Whether the last #tokenlogHASH_LENGTH characters of a string literal
+ * hold ".*", a precision given as an argument.
+ */
+#define tokenlogHAS_STAR( pcFormat, pcEntry ) \
+    ( ( ( tokenlogCHAR( pcFormat, pcEntry, 1 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 0 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 2 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 1 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 3 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 2 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 4 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 3 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 5 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 4 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 6 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 5 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 7 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 6 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 8 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 7 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 9 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 8 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 10 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 9 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 11 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 10 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 12 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 11 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 13 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 12 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 14 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 13 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 15 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 14 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 16 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 15 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 17 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 16 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 18 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 17 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 19 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 18 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 20 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 19 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 21 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 20 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 22 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 21 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 23 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 22 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 24 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 23 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 25 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 24 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 26 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 25 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 27 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 26 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 28 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 27 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 29 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 28 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 30 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 29 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 31 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 30 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 32 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 31 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 33 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 32 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 34 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 33 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 35 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 34 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 36 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 35 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 37 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 36 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 38 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 37 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 39 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 38 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 40 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 39 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 41 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 40 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 42 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 41 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 43 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 42 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 44 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 43 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 45 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 44 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 46 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 45 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 47 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 46 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 48 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 47 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 49 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 48 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 50 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 49 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 51 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 50 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 52 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 51 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 53 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 52 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 54 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 53 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 55 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 54 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 56 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 55 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 57 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 56 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 58 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 57 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 59 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 58 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 60 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 59 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 61 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 60 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 62 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 61 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 63 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 62 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 64 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 63 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 65 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 64 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 66 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 65 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 67 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 66 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 68 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 67 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 69 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 68 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 70 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 69 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 71 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 70 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 72 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 71 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 73 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 72 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 74 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 73 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 75 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 74 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 76 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 75 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 77 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 76 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 78 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 77 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 79 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 78 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 80 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 79 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 81 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 80 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 82 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 81 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 83 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 82 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 84 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 83 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 85 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 84 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 86 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 85 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 87 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 86 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 88 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 87 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 89 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 88 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 90 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 89 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 91 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 90 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 92 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 91 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 93 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 92 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 94 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 93 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 95 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 94 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 96 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 95 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 97 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 96 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 98 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 97 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 99 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 98 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 100 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 99 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 101 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 100 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 102 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 101 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 103 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 102 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 104 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 103 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 105 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 104 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 106 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 105 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 107 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 106 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 108 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 107 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 109 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 108 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 110 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 109 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 111 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 110 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 112 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 111 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 113 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 112 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 114 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 113 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 115 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 114 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 116 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 115 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 117 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 116 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 118 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 117 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 119 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 118 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 120 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 119 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 121 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 120 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 122 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 121 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 123 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 122 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 124 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 123 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 125 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 124 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 126 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 125 ) == '*' ) ) || \
+      ( ( tokenlogCHAR( pcFormat, pcEntry, 127 ) == '.' ) && ( tokenlogCHAR( pcFormat, pcEntry, 126 ) == '*' ) ) )
+
+#endif /* TOKEN_LOG_HASH_H */
@@ -0,0 +1,344 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file trace_recorder.c
+ * @brief Recorder of scheduler events and transport spans, exported as a
+ * Chrome trace.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "trace_recorder.h"
+
+/*-----------------------------------------------------------*/
+
+#if ( ( traceRECORDER_EVENTS_PER_CORE & ( traceRECORDER_EVENTS_PER_CORE - 1U ) ) != 0 )
+    #error "traceRECORDER_EVENTS_PER_CORE must be a power of two."
+#endif
+
+#if defined( configNUMBER_OF_CORES ) && ( configNUMBER_OF_CORES > 1 )
+    #define traceRECORDER_CORES        configNUMBER_OF_CORES
+    #define traceRECORDER_CORE_ID()    ( ( uint32_t ) portGET_CORE_ID() )
+#else
+    #define traceRECORDER_CORES        1
+    #define traceRECORDER_CORE_ID()    ( 0U )
+#endif
+
+/**
+ * @brief One recorded event.
+ */
+typedef struct TraceRecorderEvent
+{
+    uint64_t ullTimeUs;
+    const void * pvObject; /**< @brief Queue of a block, name of a span. */
+    uint32_t ulTaskNumber;
+    uint8_t ucType;
+    uint8_t ucQueueType;
+} TraceRecorderEvent_t;
+
+/**
+ * @brief Events of one core. The head only grows, an event is written at
+ * the head modulo the size of the ring.
+ */
+typedef struct TraceRecorderRing
+{
+    uint32_t ulHead;
+    TraceRecorderEvent_t xEvents[ traceRECORDER_EVENTS_PER_CORE ];
+} TraceRecorderRing_t;
+
+/**
+ * @brief Export state of a task, the slices it has open.
+ */
+typedef struct TraceRecorderTaskState
+{
+    bool xRunning;
+    bool xWaiting;
+    uint32_t ulSpanDepth;
+} TraceRecorderTaskState_t;
+
+static TraceRecorderRing_t xRings[ traceRECORDER_CORES ];
+static TraceRecorderGetTimeUs_t xGetTimeUs;
+static bool xRecording;
+
+/* Indexed by task number modulo traceRECORDER_MAX_TASKS. */
+static char cTaskNames[ traceRECORDER_MAX_TASKS ][ configMAX_TASK_NAME_LEN ];
+static uint32_t ulTaskNumbers[ traceRECORDER_MAX_TASKS ];
+static bool xTaskBlocked[ traceRECORDER_MAX_TASKS ];
+static TraceRecorderTaskState_t xTaskStates[ traceRECORDER_MAX_TASKS ];
+/*-----------------------------------------------------------*/
+
+static void prvRecord( uint8_t ucType,
+                       uint32_t ulTaskNumber,
+                       const void * pvObject,
+                       uint8_t ucQueueType )
+{
+    TraceRecorderRing_t * pxRing;
+    TraceRecorderEvent_t * pxEvent;
+    uint32_t ulIndex;
+
+    if( !__atomic_load_n( &xRecording, __ATOMIC_ACQUIRE ) )
+    {
+        return;
+    }
+
+    /* Tasks and interrupts of the same core can record at the same time, the
+     * increment gives each its own slot. */
+    pxRing = &xRings[ traceRECORDER_CORE_ID() ];
+    ulIndex = __atomic_fetch_add( &pxRing->ulHead, 1U, __ATOMIC_RELAXED );
+    pxEvent = &pxRing->xEvents[ ulIndex & ( traceRECORDER_EVENTS_PER_CORE - 1U ) ];
+
+    pxEvent->ullTimeUs = xGetTimeUs();
+    pxEvent->pvObject = pvObject;
+    pxEvent->ulTaskNumber = ulTaskNumber;
+    pxEvent->ucType = ucType;
+    pxEvent->ucQueueType = ucQueueType;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Name of the wait on a queue of this type.
+ */
+static const char * prvWaitName( uint8_t ucType,
+                                 uint8_t ucQueueType )
+{
+    bool xReceive = ( ucType == eTraceRecorderBlockOnReceive );
+
+    switch( ucQueueType )
+    {
+        case queueQUEUE_TYPE_MUTEX:
+        case queueQUEUE_TYPE_RECURSIVE_MUTEX:
+            return xReceive ? "take mutex" : "give mutex";
+
+        case queueQUEUE_TYPE_COUNTING_SEMAPHORE:
+        case queueQUEUE_TYPE_BINARY_SEMAPHORE:
+            return xReceive ? "take semaphore" : "give semaphore";
+
+        default:
+            return xReceive ? "queue receive" : "queue send";
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write one event, or nothing for the end of a slice that started
+ * before the oldest event kept.
+ *
+ * @return false if the write failed.
+ */
+static bool prvExportEvent( FILE * pxFile,
+                            uint32_t ulCore,
+                            const TraceRecorderEvent_t * pxEvent,
+                            bool * pxFirst )
+{
+    TraceRecorderTaskState_t * pxState = &xTaskStates[ pxEvent->ulTaskNumber % traceRECORDER_MAX_TASKS ];
+    const char * pcSeparator = *pxFirst ? "" : ",\n";
+    unsigned long long ullTs = ( unsigned long long ) pxEvent->ullTimeUs;
+    unsigned uTid = ( unsigned ) pxEvent->ulTaskNumber;
+    int lResult = 0;
+
+    switch( pxEvent->ucType )
+    {
+        case eTraceRecorderSwitchedIn:
+            pxState->xRunning = true;
+            lResult = fprintf( pxFile, "%s{\"name\":\"running\",\"ph\":\"B\",\"ts\":%llu,\"pid\":%u,\"tid\":%u}",
+                               pcSeparator, ullTs, ( unsigned ) ulCore, uTid );
+            break;
+
+        case eTraceRecorderSwitchedOut:
+
+            if( !pxState->xRunning )
+            {
+                return true;
+            }
+
+            pxState->xRunning = false;
+            lResult = fprintf( pxFile, "%s{\"ph\":\"E\",\"ts\":%llu,\"pid\":%u,\"tid\":%u}",
+                               pcSeparator, ullTs, ( unsigned ) ulCore, uTid );
+            break;
+
+        case eTraceRecorderBlockOnReceive:
+        case eTraceRecorderBlockOnSend:
+
+            /* Waits and spans outlive the running slices of the task, they
+             * are async slices with the task number as id. */
+            pxState->xWaiting = true;
+            lResult = fprintf( pxFile, "%s{\"name\":\"%s\",\"cat\":\"wait\",\"ph\":\"b\",\"id\":%u,\"ts\":%llu,"
+                                       "\"pid\":%u,\"tid\":%u,\"args\":{\"object\":\"%p\"}}",
+                               pcSeparator, prvWaitName( pxEvent->ucType, pxEvent->ucQueueType ), uTid, ullTs,
+                               ( unsigned ) ulCore, uTid, pxEvent->pvObject );
+            break;
+
+        case eTraceRecorderUnblocked:
+
+            if( !pxState->xWaiting )
+            {
+                return true;
+            }
+
+            pxState->xWaiting = false;
+            lResult = fprintf( pxFile, "%s{\"cat\":\"wait\",\"ph\":\"e\",\"id\":%u,\"ts\":%llu,\"pid\":%u,\"tid\":%u}",
+                               pcSeparator, uTid, ullTs, ( unsigned ) ulCore, uTid );
+            break;
+
+        case eTraceRecorderSpanBegin:
+            pxState->ulSpanDepth++;
+            lResult = fprintf( pxFile, "%s{\"name\":\"%s\",\"cat\":\"span\",\"ph\":\"b\",\"id\":%u,\"ts\":%llu,"
+                                       "\"pid\":%u,\"tid\":%u}",
+                               pcSeparator, ( const char * ) pxEvent->pvObject, uTid, ullTs,
+                               ( unsigned ) ulCore, uTid );
+            break;
+
+        case eTraceRecorderSpanEnd:
+
+            if( pxState->ulSpanDepth == 0 )
+            {
+                return true;
+            }
+
+            pxState->ulSpanDepth--;
+            lResult = fprintf( pxFile, "%s{\"name\":\"%s\",\"cat\":\"span\",\"ph\":\"e\",\"id\":%u,\"ts\":%llu,"
+                                       "\"pid\":%u,\"tid\":%u}",
+                               pcSeparator, ( const char * ) pxEvent->pvObject, uTid, ullTs,
+                               ( unsigned ) ulCore, uTid );
+            break;
+
+        default:
+            return true;
+    }
+
+    *pxFirst = false;
+
+    return lResult > 0;
+}
+/*-----------------------------------------------------------*/
+
+void TraceRecorder_Init( TraceRecorderGetTimeUs_t xGetTime )
+{
+    configASSERT( xGetTime != NULL );
+
+    xGetTimeUs = xGetTime;
+    memset( xRings, 0, sizeof( xRings ) );
+    __atomic_store_n( &xRecording, true, __ATOMIC_RELEASE );
+}
+/*-----------------------------------------------------------*/
+
+void TraceRecorder_Stop( void )
+{
+    __atomic_store_n( &xRecording, false, __ATOMIC_RELEASE );
+}
+/*-----------------------------------------------------------*/
+
+void TraceRecorder_TaskCreated( uint32_t ulTaskNumber,
+                                const char * pcName )
+{
+    uint32_t ulSlot = ulTaskNumber % traceRECORDER_MAX_TASKS;
+
+    /* Names are kept before recording starts, most tasks are created
+     * first. */
+    ulTaskNumbers[ ulSlot ] = ulTaskNumber;
+    strncpy( cTaskNames[ ulSlot ], pcName, configMAX_TASK_NAME_LEN - 1 );
+    cTaskNames[ ulSlot ][ configMAX_TASK_NAME_LEN - 1 ] = '\0';
+}
+/*-----------------------------------------------------------*/
+
+void TraceRecorder_Record( TraceRecorderEventType_t xType,
+                           uint32_t ulTaskNumber,
+                           const void * pvObject,
+                           uint8_t ucQueueType )
+{
+    bool * pxBlocked = &xTaskBlocked[ ulTaskNumber % traceRECORDER_MAX_TASKS ];
+
+    /* Most sends and receives do not block, only the end of a block is
+     * recorded. The flag is only written by the task itself. */
+    if( ( xType == eTraceRecorderBlockOnReceive ) || ( xType == eTraceRecorderBlockOnSend ) )
+    {
+        if( *pxBlocked )
+        {
+            /* Blocked again on the same call, after a timeout or a lost race. */
+            return;
+        }
+
+        *pxBlocked = true;
+    }
+    else if( xType == eTraceRecorderUnblocked )
+    {
+        if( !*pxBlocked )
+        {
+            return;
+        }
+
+        *pxBlocked = false;
+    }
+
+    prvRecord( ( uint8_t ) xType, ulTaskNumber, pvObject, ucQueueType );
+}
+/*-----------------------------------------------------------*/
+
+void TraceRecorder_SpanBegin( const char * pcName )
+{
+    prvRecord( eTraceRecorderSpanBegin, ( uint32_t ) uxTaskGetTaskNumber( xTaskGetCurrentTaskHandle() ),
+               pcName, 0 );
+}
+/*-----------------------------------------------------------*/
+
+void TraceRecorder_SpanEnd( const char * pcName )
+{
+    prvRecord( eTraceRecorderSpanEnd, ( uint32_t ) uxTaskGetTaskNumber( xTaskGetCurrentTaskHandle() ),
+               pcName, 0 );
+}
+/*-----------------------------------------------------------*/
+
+bool TraceRecorder_ExportChromeJson( FILE * pxFile )
+{
+    const TraceRecorderRing_t * pxRing;
+    uint32_t ulCore;
+    uint32_t ulHead;
+    uint32_t ulIndex;
+    uint32_t ulSlot;
+    bool xFirst = true;
+    bool xResult;
+
+    configASSERT( pxFile != NULL );
+
+    memset( xTaskStates, 0, sizeof( xTaskStates ) );
+    xResult = fprintf( pxFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" ) > 0;
+
+    for( ulCore = 0; xResult && ( ulCore < traceRECORDER_CORES ); ulCore++ )
+    {
+        xResult = fprintf( pxFile, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"core %u\"}}",
+                           xFirst ? "" : ",\n", ( unsigned ) ulCore, ( unsigned ) ulCore ) > 0;
+        xFirst = false;
+
+        for( ulSlot = 0; xResult && ( ulSlot < traceRECORDER_MAX_TASKS ); ulSlot++ )
+        {
+            if( cTaskNames[ ulSlot ][ 0 ] != '\0' )
+            {
+                xResult = fprintf( pxFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,"
+                                           "\"args\":{\"name\":\"%s\"}}",
+                                   ( unsigned ) ulCore, ( unsigned ) ulTaskNumbers[ ulSlot ], cTaskNames[ ulSlot ] ) > 0;
+            }
+        }
+
+        /* Oldest event first, the ring holds the newest ones. */
+        pxRing = &xRings[ ulCore ];
+        ulHead = __atomic_load_n( &pxRing->ulHead, __ATOMIC_ACQUIRE );
+        ulIndex = ( ulHead > traceRECORDER_EVENTS_PER_CORE ) ? ulHead - traceRECORDER_EVENTS_PER_CORE : 0;
+
+        for( ; xResult && ( ulIndex != ulHead ); ulIndex++ )
+        {
+            xResult = prvExportEvent( pxFile, ulCore,
+                                      &pxRing->xEvents[ ulIndex & ( traceRECORDER_EVENTS_PER_CORE - 1U ) ],
+                                      &xFirst );
+        }
+    }
+
+    return xResult && ( fprintf( pxFile, "\n]}\n" ) > 0 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,122 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file trace_recorder.h
+ * @brief Recorder of scheduler events and transport spans, exported as a
+ * Chrome trace.
+ *
+ * The kernel hooks of trace_recorder_hooks.h record when each task is
+ * switched in and out and when it blocks on a queue, semaphore or mutex and
+ * gets past it. traceSPAN_BEGIN and traceSPAN_END record the calls of the
+ * transports. Each core has its own ring of events, written without locks
+ * and keeping the newest #traceRECORDER_EVENTS_PER_CORE events.
+ *
+ * #TraceRecorder_ExportChromeJson writes the rings as Chrome trace JSON,
+ * which chrome://tracing and ui.perfetto.dev open: one process per core, one
+ * thread per task with the slices it ran, and its waits and transport calls
+ * as async slices.
+ *
+ * Needs configUSE_TRACE_FACILITY for the task numbers.
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+/* Included from FreeRTOSConfig.h through trace_recorder_hooks.h, the
+ * FreeRTOS types are not defined yet. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Events kept per core, a power of two.
+ */
+#ifndef traceRECORDER_EVENTS_PER_CORE
+    #define traceRECORDER_EVENTS_PER_CORE    ( 32768U )
+#endif
+
+/**
+ * @brief Tasks whose names are kept, by task number modulo this.
+ */
+#ifndef traceRECORDER_MAX_TASKS
+    #define traceRECORDER_MAX_TASKS          ( 32U )
+#endif
+
+/**
+ * @brief Recorded events.
+ */
+typedef enum TraceRecorderEventType
+{
+    eTraceRecorderSwitchedIn = 0,
+    eTraceRecorderSwitchedOut,
+    eTraceRecorderBlockOnReceive, /**< @brief Queue receive, semaphore or mutex take. */
+    eTraceRecorderBlockOnSend,    /**< @brief Queue send, semaphore or mutex give. */
+    eTraceRecorderUnblocked,      /**< @brief End of the receive or send, done or timed out. */
+    eTraceRecorderSpanBegin,
+    eTraceRecorderSpanEnd
+} TraceRecorderEventType_t;
+
+/**
+ * @brief Time source of the events in microseconds.
+ */
+typedef uint64_t ( * TraceRecorderGetTimeUs_t )( void );
+
+/**
+ * @brief Start recording.
+ *
+ * @param[in] xGetTimeUs Time source, called from the kernel hooks with the
+ * scheduler suspended or in a critical section.
+ */
+void TraceRecorder_Init( TraceRecorderGetTimeUs_t xGetTimeUs );
+
+/**
+ * @brief Stop recording, before exporting.
+ */
+void TraceRecorder_Stop( void );
+
+/**
+ * @brief Keep the name of a new task, hook of traceTASK_CREATE.
+ */
+void TraceRecorder_TaskCreated( uint32_t ulTaskNumber,
+                                const char * pcName );
+
+/**
+ * @brief Record a kernel event, hook of the scheduler and queue trace macros.
+ *
+ * @param[in] xType Event.
+ * @param[in] ulTaskNumber Task number of the task of the event.
+ * @param[in] pvObject Queue of a block, NULL otherwise.
+ * @param[in] ucQueueType queueQUEUE_TYPE_* of the queue of a block.
+ */
+void TraceRecorder_Record( TraceRecorderEventType_t xType,
+                           uint32_t ulTaskNumber,
+                           const void * pvObject,
+                           uint8_t ucQueueType );
+
+/**
+ * @brief Record the start of a span of the calling task.
+ *
+ * @param[in] pcName Name of the span, a string literal.
+ */
+void TraceRecorder_SpanBegin( const char * pcName );
+
+/**
+ * @brief Record the end of a span of the calling task.
+ *
+ * @param[in] pcName Name given to #TraceRecorder_SpanBegin.
+ */
+void TraceRecorder_SpanEnd( const char * pcName );
+
+/**
+ * @brief Write the recorded events as Chrome trace JSON.
+ *
+ * Events older than the start of a ring that wrapped are lost, slices they
+ * opened are left out.
+ *
+ * @param[in] pxFile File to write to.
+ * @return false if a write failed.
+ */
+bool TraceRecorder_ExportChromeJson( FILE * pxFile );
+
+#endif /* TRACE_RECORDER_H */
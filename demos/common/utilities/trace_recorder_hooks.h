@@ -0,0 +1,52 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file trace_recorder_hooks.h
+ * @brief Kernel trace macros feeding trace_recorder.h.
+ *
+ * Include at the end of FreeRTOSConfig.h. The macros expand inside tasks.c
+ * and queue.c, where the TCB and queue fields they read are visible. The
+ * current TCB is private to tasks.c, queue.c asks for the current task.
+ */
+
+#ifndef TRACE_RECORDER_HOOKS_H
+#define TRACE_RECORDER_HOOKS_H
+
+#include "trace_recorder.h"
+
+#if defined( configNUMBER_OF_CORES ) && ( configNUMBER_OF_CORES > 1 )
+    #define traceRECORDER_CURRENT_TCB    pxCurrentTCBs[ portGET_CORE_ID() ]
+#else
+    #define traceRECORDER_CURRENT_TCB    pxCurrentTCB
+#endif
+
+#define traceTASK_CREATE( pxNewTCB ) \
+    TraceRecorder_TaskCreated( ( uint32_t ) ( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->pcTaskName )
+
+#define traceTASK_SWITCHED_IN()                                                                       \
+    TraceRecorder_Record( eTraceRecorderSwitchedIn, ( uint32_t ) traceRECORDER_CURRENT_TCB->uxTCBNumber, \
+                          NULL, 0 )
+
+#define traceTASK_SWITCHED_OUT()                                                                       \
+    TraceRecorder_Record( eTraceRecorderSwitchedOut, ( uint32_t ) traceRECORDER_CURRENT_TCB->uxTCBNumber, \
+                          NULL, 0 )
+
+#define traceRECORDER_QUEUE_EVENT( xType, pxQueue )                                                  \
+    TraceRecorder_Record( ( xType ), ( uint32_t ) uxTaskGetTaskNumber( xTaskGetCurrentTaskHandle() ), \
+                          ( pxQueue ), ( pxQueue )->ucQueueType )
+
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )    traceRECORDER_QUEUE_EVENT( eTraceRecorderBlockOnReceive, pxQueue )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )       traceRECORDER_QUEUE_EVENT( eTraceRecorderBlockOnSend, pxQueue )
+#define traceRECORDER_UNBLOCKED( pxQueue )           traceRECORDER_QUEUE_EVENT( eTraceRecorderUnblocked, pxQueue )
+
+#define traceQUEUE_RECEIVE( pxQueue )                traceRECORDER_UNBLOCKED( pxQueue )
+#define traceQUEUE_RECEIVE_FAILED( pxQueue )         traceRECORDER_UNBLOCKED( pxQueue )
+#define traceQUEUE_SEND( pxQueue )                   traceRECORDER_UNBLOCKED( pxQueue )
+#define traceQUEUE_SEND_FAILED( pxQueue )            traceRECORDER_UNBLOCKED( pxQueue )
+
+/* Spans of the application, see the transports. */
+#define traceSPAN_BEGIN( pcName )                    TraceRecorder_SpanBegin( pcName )
+#define traceSPAN_END( pcName )                      TraceRecorder_SpanEnd( pcName )
+
+#endif /* TRACE_RECORDER_HOOKS_H */
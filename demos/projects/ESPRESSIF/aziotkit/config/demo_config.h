@@ -163,9 +163,36 @@
  */
 #define democonfigIOTHUB_PORT 8883
 
+/**
+ * @brief Compress telemetry with a dictionary of its property names.
+ */
+#ifdef CONFIG_AZURE_SAMPLE_TELEMETRY_COMPRESSION
+    #define democonfigENABLE_TELEMETRY_COMPRESSION
+#endif
+
+/**
+ * @brief Create telemetry on a producer task while the demo task sends.
+ */
+#ifdef CONFIG_AZURE_SAMPLE_TELEMETRY_DOUBLE_BUFFER
+    #define democonfigTELEMETRY_DOUBLE_BUFFER
+#endif
+
+/**
+ * @brief Run commands on worker tasks instead of the demo task.
+ */
+#ifdef CONFIG_AZURE_SAMPLE_ASYNC_COMMANDS
+    #define democonfigASYNC_COMMANDS
+#endif
+
 /**
  * @brief Defines configRAND32, used by the common sample modules.
  */
 #define configRAND32() (rand()/RAND_MAX)
 
+/**
+ * @brief Microsecond monotonic time for the clock service, from the high resolution timer.
+ */
+#include "esp_timer.h"
+#define CLOCK_SERVICE_MONOTONIC_US()    ( ( uint64_t ) esp_timer_get_time() )
+
 #endif /* DEMO_CONFIG_H */
@@ -5,7 +5,6 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
 
 /* Azure Provisioning/IoT Hub library includes */
 #include "azure_iot_hub_client.h"
@@ -15,7 +14,6 @@
 #include "sensor_manager.h"
 /*-----------------------------------------------------------*/
 
-#define INDEFINITE_TIME                            ( ( time_t ) - 1 )
 #define lengthof( x )                              ( sizeof(x) - 1 )
 // This macro helps remove quotes around a string.
 // That is achieved by skipping the first char in the string, and reducing the length by 2 chars.
@@ -66,7 +64,13 @@ static const char *TAG = "sample_azureiotkit";
 #define sampleazureiotTELEMETRY_ACCELEROMETERY     ( "accelerometerY" )
 #define sampleazureiotTELEMETRY_ACCELEROMETERZ     ( "accelerometerZ" )
 
-static time_t xLastTelemetrySendTime = INDEFINITE_TIME;
+/**
+ * @brief Compression dictionary, every telemetry property name in the order they are written.
+ */
+static const char sampleazureiotTELEMETRY_DICTIONARY[] =
+    "{\"temperature\":,\"humidity\":,\"light\":,\"pressure\":,\"altitude\":,"
+    "\"magnetometerX\":,\"magnetometerY\":,\"magnetometerZ\":,\"pitch\":,\"roll\":,"
+    "\"accelerometerX\":,\"accelerometerY\":,\"accelerometerZ\":}";
 
 /**
  * @brief Command Values
@@ -215,101 +219,105 @@ uint32_t ulSampleHandleCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
 }
 /*-----------------------------------------------------------*/
 
+uint32_t ulSampleGetTelemetryDictionary( const uint8_t ** ppucDictionary )
+{
+    *ppucDictionary = ( const uint8_t * ) sampleazureiotTELEMETRY_DICTIONARY;
+
+    return lengthof( sampleazureiotTELEMETRY_DICTIONARY );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulSampleGetTelemetryIntervalMs( void )
+{
+    /* The sample core sends no more often than this, and less often while
+     * the link is congested. */
+    return ( lTelemetryFrequencySecs > 0 ) ? ( uint32_t ) lTelemetryFrequencySecs * 1000U : 0U;
+}
+/*-----------------------------------------------------------*/
+
 uint32_t ulSampleCreateTelemetry( uint8_t * pucTelemetryData,
                                   uint32_t ulTelemetryDataLength )
 {
     int32_t lBytesWritten = 0;
-    time_t xNow = time( NULL );
+    AzureIoTResult_t xAzIoTResult;
+    AzureIoTJSONWriter_t xWriter;
 
-    if ( xNow == INDEFINITE_TIME )
-    {
-        ESP_LOGE( TAG, "Failed obtaining current time.\r\n" );
-    }
+    float xPressure;
+    float xAltitude;
+    int lMagnetometerX;
+    int lMagnetometerY;
+    int lMagnetometerZ;
+    int lPitch;
+    int lRoll;
+    int lAccelerometerX;
+    int lAccelerometerY;
+    int lAccelerometerZ;
+
+    // Collect sensor data
+    float xTemperature = get_temperature();
+    float xHumidity = get_humidity();
+    float xLight = get_ambientLight();
+    get_pressure_altitude( &xPressure, &xAltitude );
+    get_magnetometer( &lMagnetometerX, &lMagnetometerY, &lMagnetometerZ );
+    get_pitch_roll_accel( &lPitch, &lRoll, &lAccelerometerX, &lAccelerometerY, &lAccelerometerZ );
+
+    // Initialize Json Writer
+    xAzIoTResult = AzureIoTJSONWriter_Init( &xWriter, pucTelemetryData, ulTelemetryDataLength );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-    if ( xLastTelemetrySendTime == INDEFINITE_TIME || xNow == INDEFINITE_TIME ||
-         difftime( xNow , xLastTelemetrySendTime ) > lTelemetryFrequencySecs )
-    {
-        AzureIoTResult_t xAzIoTResult;
-        AzureIoTJSONWriter_t xWriter;
-
-        float xPressure;
-        float xAltitude;
-        int lMagnetometerX;
-        int lMagnetometerY;
-        int lMagnetometerZ;
-        int lPitch;
-        int lRoll;
-        int lAccelerometerX;
-        int lAccelerometerY;
-        int lAccelerometerZ;
-
-        // Collect sensor data
-        float xTemperature = get_temperature();
-        float xHumidity = get_humidity();
-        float xLight = get_ambientLight();
-        get_pressure_altitude( &xPressure, &xAltitude );
-        get_magnetometer( &lMagnetometerX, &lMagnetometerY, &lMagnetometerZ );
-        get_pitch_roll_accel( &lPitch, &lRoll, &lAccelerometerX, &lAccelerometerY, &lAccelerometerZ );
-
-        // Initialize Json Writer
-        xAzIoTResult = AzureIoTJSONWriter_Init( &xWriter, pucTelemetryData, ulTelemetryDataLength );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
-
-        xAzIoTResult = AzureIoTJSONWriter_AppendBeginObject( &xWriter );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
-        
-        // Temperature, Humidity, Light Intensity
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_TEMPERATURE, lengthof( sampleazureiotTELEMETRY_TEMPERATURE ), xTemperature, 2 );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendBeginObject( &xWriter );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    
+    // Temperature, Humidity, Light Intensity
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_TEMPERATURE, lengthof( sampleazureiotTELEMETRY_TEMPERATURE ), xTemperature, 2 );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_HUMIDITY, lengthof( sampleazureiotTELEMETRY_HUMIDITY ), xHumidity, 2 );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_HUMIDITY, lengthof( sampleazureiotTELEMETRY_HUMIDITY ), xHumidity, 2 );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_LIGHT, lengthof( sampleazureiotTELEMETRY_LIGHT ), xLight, 2 );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_LIGHT, lengthof( sampleazureiotTELEMETRY_LIGHT ), xLight, 2 );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        // Pressure, Altitude
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_PRESSURE, lengthof( sampleazureiotTELEMETRY_PRESSURE ), xPressure, 2 );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    // Pressure, Altitude
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_PRESSURE, lengthof( sampleazureiotTELEMETRY_PRESSURE ), xPressure, 2 );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ALTITUDE, lengthof( sampleazureiotTELEMETRY_ALTITUDE ), xAltitude, 2 );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithDoubleValue( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ALTITUDE, lengthof( sampleazureiotTELEMETRY_ALTITUDE ), xAltitude, 2 );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        // Magnetometer
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_MAGNETOMETERX, lengthof( sampleazureiotTELEMETRY_MAGNETOMETERX ), lMagnetometerX );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    // Magnetometer
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_MAGNETOMETERX, lengthof( sampleazureiotTELEMETRY_MAGNETOMETERX ), lMagnetometerX );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_MAGNETOMETERY, lengthof( sampleazureiotTELEMETRY_MAGNETOMETERY ), lMagnetometerY );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_MAGNETOMETERY, lengthof( sampleazureiotTELEMETRY_MAGNETOMETERY ), lMagnetometerY );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_MAGNETOMETERZ, lengthof( sampleazureiotTELEMETRY_MAGNETOMETERZ ), lMagnetometerZ );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_MAGNETOMETERZ, lengthof( sampleazureiotTELEMETRY_MAGNETOMETERZ ), lMagnetometerZ );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        // Pitch, Roll, Accelleration
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_PITCH, lengthof( sampleazureiotTELEMETRY_PITCH ), lPitch );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    // Pitch, Roll, Accelleration
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_PITCH, lengthof( sampleazureiotTELEMETRY_PITCH ), lPitch );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ROLL, lengthof( sampleazureiotTELEMETRY_ROLL ), lRoll );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ROLL, lengthof( sampleazureiotTELEMETRY_ROLL ), lRoll );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ACCELEROMETERX, lengthof( sampleazureiotTELEMETRY_ACCELEROMETERX ), lAccelerometerX );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ACCELEROMETERX, lengthof( sampleazureiotTELEMETRY_ACCELEROMETERX ), lAccelerometerX );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ACCELEROMETERY, lengthof( sampleazureiotTELEMETRY_ACCELEROMETERY ), lAccelerometerY );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ACCELEROMETERY, lengthof( sampleazureiotTELEMETRY_ACCELEROMETERY ), lAccelerometerY );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ACCELEROMETERZ, lengthof( sampleazureiotTELEMETRY_ACCELEROMETERZ ), lAccelerometerZ );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    xAzIoTResult = AzureIoTJSONWriter_AppendPropertyWithInt32Value( &xWriter, ( uint8_t * )sampleazureiotTELEMETRY_ACCELEROMETERZ, lengthof( sampleazureiotTELEMETRY_ACCELEROMETERZ ), lAccelerometerZ );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        // Complete Json Content
-        xAzIoTResult = AzureIoTJSONWriter_AppendEndObject( &xWriter );
-        configASSERT( xAzIoTResult == eAzureIoTSuccess );
+    // Complete Json Content
+    xAzIoTResult = AzureIoTJSONWriter_AppendEndObject( &xWriter );
+    configASSERT( xAzIoTResult == eAzureIoTSuccess );
 
-        lBytesWritten = AzureIoTJSONWriter_GetBytesUsed( &xWriter );
-        configASSERT( lBytesWritten > 0 );
+    lBytesWritten = AzureIoTJSONWriter_GetBytesUsed( &xWriter );
+    configASSERT( lBytesWritten > 0 );
 
-        xLastTelemetrySendTime = xNow;
-    }
 
     return lBytesWritten;
 }
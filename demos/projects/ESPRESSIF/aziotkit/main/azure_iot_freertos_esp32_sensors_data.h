@@ -45,6 +45,22 @@ uint32_t ulSampleHandleCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
 uint32_t ulSampleCreateTelemetry( uint8_t * pucTelemetryData,
                                   uint32_t ulTelemetryDataLength );
 
+/**
+ * @brief Implements the sample interface for the telemetry interval.
+ * 
+ * @return uint32_t The telemetryFrequencySecs property in milliseconds.
+ */
+uint32_t ulSampleGetTelemetryIntervalMs( void );
+
+/**
+ * @brief Implements the sample interface for the telemetry compression dictionary.
+ * 
+ * @param[out] ppucDictionary Pointer to the dictionary.
+ * 
+ * @return uint32_t Length of the dictionary.
+ */
+uint32_t ulSampleGetTelemetryDictionary( const uint8_t ** ppucDictionary );
+
 /**
  * @brief Handler for writable properties updates.
  * 
@@ -170,4 +170,10 @@
  */
 #define configRAND32() (rand()/RAND_MAX)
 
+/**
+ * @brief Microsecond monotonic time for the clock service, from the high resolution timer.
+ */
+#include "esp_timer.h"
+#define CLOCK_SERVICE_MONOTONIC_US()    ( ( uint64_t ) esp_timer_get_time() )
+
 #endif /* DEMO_CONFIG_H */
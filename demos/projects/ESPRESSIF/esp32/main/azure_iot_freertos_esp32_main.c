@@ -18,6 +18,8 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "nvs_flash.h"
+
+#include "clock_service.h"
 /*-----------------------------------------------------------*/
 
 #define NR_OF_IP_ADDRESSES_TO_WAIT_FOR 1
@@ -247,6 +249,7 @@ static esp_err_t example_connect(void)
 static void time_sync_notification_cb(struct timeval *tv)
 {
     ESP_LOGI(TAG, "Notification of a time synchronization event");
+    Clock_Discipline((uint64_t)tv->tv_sec * 1000U + (uint64_t)tv->tv_usec / 1000U, Clock_GetMonotonicUs());
     g_timeInitialized = true;
 }
 /*-----------------------------------------------------------*/
@@ -269,6 +272,8 @@ static void initialize_time()
 
 void app_main(void)
 {
+    Clock_Init();
+
     ESP_ERROR_CHECK(nvs_flash_init());
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -285,13 +290,7 @@ void app_main(void)
 
 uint64_t ullGetUnixTime( void )
 {
-    time_t now = time(NULL);
-
-    if (now == (time_t)(-1))
-    {
-        ESP_LOGE(TAG, "Failed obtaining current time.\r\n");
-    }
-
-    return now;
+    /* The middleware expects seconds, used for SAS token expiry. */
+    return Clock_GetUnixTimeMs() / 1000U;
 }
 /*-----------------------------------------------------------*/
@@ -29,6 +29,12 @@
 
 #include "fsl_debug_console.h"
 
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "clock_service.h"
+#include "sntp_client.h"
+
 #include "clock_config.h"
 #include "fsl_gpio.h"
 #include "fsl_iomuxc.h"
@@ -100,7 +106,6 @@ static ethernetif_config_t xEnetConfig =
     .phyHandle  = &xPhyHandle,
     .macAddress = mainConfigMAC_ADDR,
 };
-static uint64_t ulGlobalEntryTime = 1673769600;
 
 /*
  * Prototypes for the demos that can be started from this project.
@@ -258,8 +263,14 @@ int uxRand( void )
 
 void vApplicationDaemonTaskStartupHook( void )
 {
+    Clock_Init();
+
     prvNetworkUp();
 
+#ifdef democonfigSNTP_SERVER
+    ( void ) SNTPClient_StartTask( democonfigSNTP_SERVER, democonfigSNTP_SYNC_INTERVAL_MS );
+#endif
+
     /* Demos that use the network are created after the network is
      * up. */
     configPRINTF( ( "---------STARTING DEMO---------\r\n" ) );
@@ -494,20 +505,8 @@ void * pvPortCalloc( size_t xNum,
 
 uint64_t ullGetUnixTime( void )
 {
-    TickType_t xTickCount = 0;
-    uint64_t ulTime = 0UL;
-
-    /* Get the current tick count. */
-    xTickCount = xTaskGetTickCount();
-
-    /* Convert the ticks to milliseconds. */
-    ulTime = ( uint64_t ) xTickCount / configTICK_RATE_HZ;
-
-    /* Reduce ulGlobalEntryTimeMs from obtained time so as to always return the
-     * elapsed time in the application. */
-    ulTime = ( uint64_t ) ( ulTime + ulGlobalEntryTime );
-
-    return ulTime;
+    /* The middleware expects seconds, used for SAS token expiry. */
+    return Clock_GetUnixTimeMs() / 1000U;
 }
 /*-----------------------------------------------------------*/
 
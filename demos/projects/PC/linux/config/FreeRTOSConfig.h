@@ -25,7 +25,6 @@
 #define configMINIMAL_STACK_SIZE                   ( ( unsigned short ) 60 ) /* In this simulated case, the stack only has to hold one small structure as the real stack is part of the Win32 thread. */
 #define configTOTAL_HEAP_SIZE                      ( ( size_t ) ( 2048U * 1024U ) )
 #define configMAX_TASK_NAME_LEN                    ( 15 )
-#define configUSE_TRACE_FACILITY                   0
 #define configUSE_16_BIT_TICKS                     0
 #define configIDLE_SHOULD_YIELD                    1
 #define configUSE_CO_ROUTINES                      0
@@ -54,8 +53,20 @@
 /* Event group related definitions. */
 #define configUSE_EVENT_GROUPS                     1
 
-/* Run time stats gathering configuration options. */
-#define configGENERATE_RUN_TIME_STATS              0
+/* Trace facility and run time stats, enabled with -DHEALTH_MONITOR=ON for
+ * health_monitor.c. The monotonic microseconds of main.c replace the counter
+ * of the POSIX port, which only counts process CPU time in steps of 10 ms.
+ * They are kept in 64 bits, 32 would wrap after 71 minutes. */
+#ifdef healthmonitorENABLED
+    #define configUSE_TRACE_FACILITY                              1
+    #define configGENERATE_RUN_TIME_STATS                         1
+    #define configRUN_TIME_COUNTER_TYPE                           uint64_t
+    extern uint64_t ullMainGetMonotonicUs( void );
+    #define portALT_GET_RUN_TIME_COUNTER_VALUE( xCountValue )    ( xCountValue ) = ullMainGetMonotonicUs()
+#else
+    #define configUSE_TRACE_FACILITY                              0
+    #define configGENERATE_RUN_TIME_STATS                         0
+#endif
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                      0
@@ -79,6 +90,7 @@
 #define INCLUDE_xEventGroupSetBitsFromISR          1
 #define INCLUDE_xTimerPendFunctionCall             1
 #define INCLUDE_pcTaskGetTaskName                  1
+#define INCLUDE_xTaskGetCurrentTaskHandle          1
 
 /* This demo makes use of one or more example stats formatting functions.  These
  * format the raw data provided by the uxTaskGetSystemState() function in to human
@@ -185,4 +197,10 @@ extern void vLoggingPrintf( const char * pcFormatString,
 extern int iMainRand32( void );
 #define configRAND32()    iMainRand32()
 
+/* Chrome trace of the scheduler and the transports, enabled with
+ * -DTRACE_RECORDER=ON. See trace_recorder.h. */
+#ifdef traceRECORDER_ENABLED
+    #include "trace_recorder_hooks.h"
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
@@ -39,7 +39,12 @@ extern void vLoggingPrintf( const char * pcFormatString,
     #define SdkLog( message )    vLoggingPrintf message
 #endif
 
-#include "logging_stack.h"
+/* Tokenised Log macros with -DTOKEN_LOG=ON, see token_log.h */
+#ifdef tokenlogENABLED
+    #include "token_log.h"
+#else
+    #include "logging_stack.h"
+#endif
 /************ End of logging configuration ****************/
 
 /**
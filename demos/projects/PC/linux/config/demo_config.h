@@ -48,7 +48,12 @@ extern void vLoggingPrintf( const char * pcFormatString,
     #define SdkLog( message )    vLoggingPrintf message
 #endif
 
-#include "logging_stack.h"
+/* Tokenised Log macros with -DTOKEN_LOG=ON, see token_log.h */
+#ifdef tokenlogENABLED
+    #include "token_log.h"
+#else
+    #include "logging_stack.h"
+#endif
 
 /************ End of logging configuration ****************/
 
@@ -167,4 +172,97 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define democonfigIOTHUB_PORT          ( 8883 )
 
+/**
+ * @brief SNTP server the clock service is synchronized with.
+ *
+ * @note Leave undefined to keep the wall clock from the host.
+ */
+// #define democonfigSNTP_SERVER               "pool.ntp.org"
+
+/**
+ * @brief Time between SNTP exchanges.
+ */
+#define democonfigSNTP_SYNC_INTERVAL_MS     ( 60U * 60U * 1000U )
+
+/**
+ * @brief Compress Plug and Play telemetry with a dictionary of its property names.
+ *
+ * @note Compressed messages carry the application property "content-encoding"
+ * set to "lzd1", the cloud side must decompress them before parsing.
+ */
+// #define democonfigENABLE_TELEMETRY_COMPRESSION
+
+/**
+ * @brief Create Plug and Play telemetry on a producer task, into one of two
+ * buffers, while the demo task sends the other.
+ *
+ * @note The sample logs the achieved telemetry rate with and without it.
+ */
+// #define democonfigTELEMETRY_DOUBLE_BUFFER
+
+/**
+ * @brief Run Plug and Play command handlers on worker tasks, so a slow
+ * command does not hold back the MQTT process loop.
+ *
+ * @note Requests are copied into a fixed pool, see hub_command.h for its
+ * sizes. Requests finding no free slot are answered with status 503.
+ * Requests with a request ID over HUB_COMMAND_MAX_REQUEST_ID_LENGTH (64),
+ * a component or command name over HUB_COMMAND_MAX_NAME_LENGTH (64) or a
+ * payload over HUB_COMMAND_MAX_PAYLOAD_LENGTH (256 bytes) are answered with
+ * status 413; define those here to change them.
+ */
+// #define democonfigASYNC_COMMANDS
+
+/**
+ * @brief Emulate a poor network link between the device and IoT Hub, one of
+ * lan, wifi-congested, lte, cellular-weak or satellite.
+ *
+ * @note Used by the basic sample and the load generator. The basic sample
+ * stops on a lost connection, only the load generator survives the resets of
+ * cellular-weak. The same seed repeats the same impairments.
+ */
+// #define democonfigNETWORK_IMPAIRMENT_PROFILE    "lte"
+#define democonfigNETWORK_IMPAIRMENT_SEED       ( 1U )
+
+/**
+ * @brief Record the sessions of the PnP sample to this file, for the replay
+ * benchmark of benchmarks/.
+ *
+ * @note The recording holds the SAS tokens of the device, keep it private.
+ */
+// #define democonfigTRANSPORT_CAPTURE_FILE    "session.azc"
+
+/**
+ * @brief Publish the CPU share and stack headroom of every task and the free
+ * heap as telemetry at this interval in milliseconds, from the PnP sample.
+ *
+ * @note Enabled with -DHEALTH_MONITOR=ON, which also turns on
+ * configUSE_TRACE_FACILITY and configGENERATE_RUN_TIME_STATS in
+ * FreeRTOSConfig.h.
+ */
+#ifdef healthmonitorENABLED
+    #define democonfigHEALTH_MONITOR_INTERVAL_MS    ( 5 * 60 * 1000U )
+#endif
+
+/**
+ * @brief Load generator (iot-middleware-sample-load) settings.
+ *
+ * Each line of the credentials file is "<hostname>,<device id>,<symmetric key>[,<profile>]"
+ * with profile one of small, medium, burst or idle.
+ */
+#define democonfigLOAD_CREDENTIALS_FILE     "load_devices.csv"
+#define democonfigLOAD_DEFAULT_PROFILE      "small"
+#define democonfigLOAD_MAX_DEVICES          ( 1000U )
+#define democonfigLOAD_RAMP_UP_PER_SECOND   ( 10U )
+#define democonfigLOAD_CONNECT_JITTER_MS    ( 2000U )
+#define democonfigLOAD_REPORT_INTERVAL_MS   ( 10U * 1000U )
+#define democonfigLOAD_NETWORK_BUFFER_SIZE  ( 1024U )
+
+/**
+ * @brief Microsecond monotonic time for the clock service, from the host
+ * monotonic clock instead of the 1 ms tick.
+ */
+extern uint64_t ullMainGetMonotonicUs( void );
+#define CLOCK_SERVICE_MONOTONIC_US()    ullMainGetMonotonicUs()
+
 #endif /* DEMO_CONFIG_H */
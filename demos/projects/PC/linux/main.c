@@ -20,13 +20,34 @@
 
 /* Demo logging includes. */
 #include "logging.h"
+#include "deferred_log.h"
 
 /* Demo Specific configs. */
 #include "demo_config.h"
 
+#include "clock_service.h"
+#include "sntp_client.h"
+
+#ifdef traceRECORDER_ENABLED
+    /* Scheduler and transport trace header. */
+    #include "trace_recorder.h"
+#endif
+
 #define mainHOST_NAME           "RTOSDemo"
 #define mainDEVICE_NICK_NAME    "linux_demo"
 
+#ifdef traceRECORDER_ENABLED
+
+/* The trace is written to this file once the application has run for this
+ * long, enough to connect and publish a few messages. */
+    #ifndef mainTRACE_FILE
+        #define mainTRACE_FILE           "trace.json"
+    #endif
+    #ifndef mainTRACE_DURATION_MS
+        #define mainTRACE_DURATION_MS    ( 30 * 1000U )
+    #endif
+#endif
+
 /*
  * Prototypes for the demos that can be started from this project.  Note the
  * MQTT demo is not actually started until the network is already, which is
@@ -50,6 +71,26 @@ static void prvSRand( UBaseType_t ulSeed );
  */
 static void prvMiscInitialisation( void );
 
+/*
+ * Writes a message of the deferred logger to standard out.
+ */
+static void prvWriteLog( const char * pcMessage,
+                         uint32_t ulLength );
+
+/*
+ * Monotonic time in microseconds, of the run time stats, the trace and the
+ * clock service.
+ */
+uint64_t ullMainGetMonotonicUs( void );
+
+#ifdef traceRECORDER_ENABLED
+
+/*
+ * Writes the trace to mainTRACE_FILE after mainTRACE_DURATION_MS.
+ */
+    static void prvTraceExportTask( void * pvParameters );
+#endif
+
 /* The default IP and MAC address used by the demo.  The address configuration
  * defined here will be used if ipconfigUSE_DHCP is 0, or if ipconfigUSE_DHCP is
  * 1 but a DHCP server could not be contacted.  See the online documentation for
@@ -85,12 +126,20 @@ void vLoggingInit( BaseType_t xLogToStdout,
                    uint32_t ulRemoteIPAddress,
                    uint16_t usRemotePort )
 {
+    bool xLogTaskCreated;
+
     /* Can only be called before the scheduler has started. */
     configASSERT( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED );
 
-    /* FreeRTOSIPConfig is set such that no print messages will be output.
-     *              * Avoid compiler warnings about unused parameters. */
-    ( void ) xLogToStdout;
+    /* Messages are formatted by the tasks that log and written to standard
+     * out by the log task of deferred_log.c. Only standard out is
+     * supported. */
+    if( xLogToStdout )
+    {
+        xLogTaskCreated = DeferredLog_Init( prvWriteLog );
+        configASSERT( xLogTaskCreated );
+    }
+
     ( void ) xLogToFile;
     ( void ) xLogToUDP;
     ( void ) usRemotePort;
@@ -103,9 +152,18 @@ void vLoggingPrintf( const char * pcFormat,
     va_list arg;
 
     va_start( arg, pcFormat );
-    vprintf( pcFormat, arg );
+    ( void ) DeferredLog_VPrintf( pcFormat, arg );
     va_end( arg );
 }
+/*-----------------------------------------------------------*/
+
+static void prvWriteLog( const char * pcMessage,
+                         uint32_t ulLength )
+{
+    ( void ) fwrite( pcMessage, 1, ulLength, stdout );
+    ( void ) fflush( stdout );
+}
+/*-----------------------------------------------------------*/
 
 int main( void )
 {
@@ -117,6 +175,12 @@ int main( void )
      * the random number generator. */
     prvMiscInitialisation();
 
+    #ifdef traceRECORDER_ENABLED
+        TraceRecorder_Init( ullMainGetMonotonicUs );
+        xTaskCreate( prvTraceExportTask, "TraceExport", configMINIMAL_STACK_SIZE * 4,
+                     NULL, tskIDLE_PRIORITY + 1, NULL );
+    #endif
+
     /* Initialize the network interface.
      *
      ***NOTE*** Tasks that use the network are created in the network event hook
@@ -161,6 +225,9 @@ void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
              * up. */
             LogInfo( ( "---------STARTING DEMO---------\r\n" ) );
             vStartDemoTask();
+#ifdef democonfigSNTP_SERVER
+            ( void ) SNTPClient_StartTask( democonfigSNTP_SERVER, democonfigSNTP_SYNC_INTERVAL_MS );
+#endif
             xTasksAlreadyCreated = pdTRUE;
         }
 
@@ -192,6 +259,8 @@ void vAssertCalled( const char * pcFile,
     ( void ) pcFileName;
     ( void ) ulLineNumber;
 
+    /* The messages leading to the assert. */
+    DeferredLog_Flush();
     printf( "vAssertCalled( %s, %u\n", pcFile, ulLine );
 
     /* Setting ulBlockVariable to a non-zero value in the debugger will allow
@@ -228,6 +297,7 @@ UBaseType_t uxRand( void )
 static void prvMiscInitialisation( void )
 {
     time_t xTimeNow;
+    struct timespec xHostTime;
     uint32_t ulLoggingIPAddress;
 
     ulLoggingIPAddress = FreeRTOS_inet_addr_quick( configUDP_LOGGING_ADDR0, configUDP_LOGGING_ADDR1, configUDP_LOGGING_ADDR2, configUDP_LOGGING_ADDR3 );
@@ -244,6 +314,11 @@ static void prvMiscInitialisation( void )
     LogDebug( ( "Seed for randomizer: %lu\n", xTimeNow ) );
     prvSRand( ( uint32_t ) xTimeNow );
     LogDebug( ( "Random numbers: %08X %08X %08X %08X\n", ipconfigRAND32(), ipconfigRAND32(), ipconfigRAND32(), ipconfigRAND32() ) );
+
+    /* Start the wall clock from the host clock. */
+    Clock_Init();
+    clock_gettime( CLOCK_REALTIME, &xHostTime );
+    Clock_SetUnixTimeMs( ( uint64_t ) xHostTime.tv_sec * 1000U + ( uint64_t ) xHostTime.tv_nsec / 1000000U );
 }
 /*-----------------------------------------------------------*/
 
@@ -379,7 +454,8 @@ void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
 
 uint64_t ullGetUnixTime( void )
 {
-    return (uint64_t) time(NULL);
+    /* The middleware expects seconds, used for SAS token expiry. */
+    return Clock_GetUnixTimeMs() / 1000U;
 }
 /*-----------------------------------------------------------*/
 
@@ -443,3 +519,40 @@ int iMainRand32( void )
     return( ( int ) ( uxlNextRand >> 16UL ) & 0x7fffUL );
 }
 /*-----------------------------------------------------------*/
+
+#ifdef traceRECORDER_ENABLED
+    static void prvTraceExportTask( void * pvParameters )
+    {
+        FILE * pxFile;
+        bool xResult;
+
+        ( void ) pvParameters;
+
+        vTaskDelay( pdMS_TO_TICKS( mainTRACE_DURATION_MS ) );
+        TraceRecorder_Stop();
+
+        if( ( pxFile = fopen( mainTRACE_FILE, "w" ) ) == NULL )
+        {
+            configPRINTF( ( "Failed to open " mainTRACE_FILE " for the trace\r\n" ) );
+        }
+        else
+        {
+            xResult = TraceRecorder_ExportChromeJson( pxFile );
+            xResult = ( fclose( pxFile ) == 0 ) && xResult;
+            configPRINTF( ( "%s the trace to " mainTRACE_FILE "\r\n", xResult ? "Wrote" : "Failed to write" ) );
+        }
+
+        vTaskDelete( NULL );
+    }
+/*-----------------------------------------------------------*/
+#endif /* traceRECORDER_ENABLED */
+
+uint64_t ullMainGetMonotonicUs( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( uint64_t ) xTime.tv_sec * 1000000U + ( uint64_t ) xTime.tv_nsec / 1000U;
+}
+/*-----------------------------------------------------------*/
@@ -24,6 +24,9 @@
 /* Demo Specific configs. */
 #include "demo_config.h"
 
+#include "clock_service.h"
+#include "sntp_client.h"
+
 #define mainHOST_NAME           "RTOSDemo"
 #define mainDEVICE_NICK_NAME    "windows_demo"
 
@@ -161,6 +164,9 @@ void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
              * up. */
             LogInfo( ( "---------STARTING DEMO---------\r\n" ) );
             vStartDemoTask();
+#ifdef democonfigSNTP_SERVER
+            ( void ) SNTPClient_StartTask( democonfigSNTP_SERVER, democonfigSNTP_SYNC_INTERVAL_MS );
+#endif
             xTasksAlreadyCreated = pdTRUE;
         }
 
@@ -233,6 +239,10 @@ static void prvMiscInitialisation( void )
     LogDebug( ( "Seed for randomizer: %lu\n", xTimeNow ) );
     prvSRand( ( uint32_t ) xTimeNow );
     LogDebug( ( "Random numbers: %08X %08X %08X %08X\n", ipconfigRAND32(), ipconfigRAND32(), ipconfigRAND32(), ipconfigRAND32() ) );
+
+    /* Start the wall clock from the host clock. */
+    Clock_Init();
+    Clock_SetUnixTimeMs( ( uint64_t ) xTimeNow * 1000U );
 }
 /*-----------------------------------------------------------*/
 
@@ -368,7 +378,8 @@ void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
 
 uint64_t ullGetUnixTime( void )
 {
-    return (uint64_t) time(NULL);
+    /* The middleware expects seconds, used for SAS token expiry. */
+    return Clock_GetUnixTimeMs() / 1000U;
 }
 /*-----------------------------------------------------------*/
 
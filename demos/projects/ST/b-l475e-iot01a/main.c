@@ -22,6 +22,8 @@
 /* Demo includes */
 #include "demo_config.h"
 
+#include "clock_service.h"
+
 /* WiFi driver includes. */
 #include "es_wifi.h"
 #include "wifi.h"
@@ -67,7 +69,6 @@ xSemaphoreHandle xWifiSemaphoreHandle;
 static UART_HandleTypeDef xConsoleUart;
 /* Use by the pseudo random number generator. */
 static UBaseType_t ulNextRand;
-static uint64_t ulGlobalEntryTime = 1673769600;
 
 /* Private function prototypes -----------------------------------------------*/
 static void Init_MEM1_Sensors( void );
@@ -156,6 +157,9 @@ void vApplicationDaemonTaskStartupHook( void )
 	/* Initialize semaphore. */
 	xSemaphoreGive( xWifiSemaphoreHandle );
 
+    /* No SNTP client over the es_wifi sockets, the clock runs from its default. */
+    Clock_Init();
+
     /* Demos that use the network are created after the network is
     * up. */
     configPRINTF( ( "---------STARTING DEMO---------\r\n" ) );
@@ -760,19 +764,7 @@ int mbedtls_platform_entropy_poll( void * data,
 
 uint64_t ullGetUnixTime( void )
 {
-    TickType_t xTickCount = 0;
-    uint64_t ulTime = 0UL;
-
-    /* Get the current tick count. */
-    xTickCount = xTaskGetTickCount();
-
-    /* Convert the ticks to milliseconds. */
-    ulTime = ( uint64_t ) xTickCount / configTICK_RATE_HZ;
-
-    /* Reduce ulGlobalEntryTimeMs from obtained time so as to always return the
-     * elapsed time in the application. */
-    ulTime = ( uint64_t ) ( ulTime + ulGlobalEntryTime );
-
-    return ulTime;
+    /* The middleware expects seconds, used for SAS token expiry. */
+    return Clock_GetUnixTimeMs() / 1000U;
 }
 /*-----------------------------------------------------------*/
@@ -167,4 +167,16 @@ extern void vLoggingPrintf( const char * pcFormatString,
  */
 #define democonfigIOTHUB_PORT          ( 8883 )
 
+/**
+ * @brief SNTP server the clock service is synchronized with.
+ *
+ * @note Leave undefined to run the wall clock from its build time default.
+ */
+#define democonfigSNTP_SERVER               "pool.ntp.org"
+
+/**
+ * @brief Time between SNTP exchanges.
+ */
+#define democonfigSNTP_SYNC_INTERVAL_MS     ( 60U * 60U * 1000U )
+
 #endif /* DEMO_CONFIG_H */
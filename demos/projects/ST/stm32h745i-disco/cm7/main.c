@@ -12,6 +12,12 @@
 #include "task.h"
 #include "lwip.h"
 
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "clock_service.h"
+#include "sntp_client.h"
+
 /*-----------------------------------------------------------*/
 
 void vApplicationDaemonTaskStartupHook( void );
@@ -28,7 +34,6 @@ static void MPU_Config( void );
 static void MX_RNG_Init( void );
 static void MX_USART3_UART_Init( void );
 static char cPrintString[ 512 ];
-static uint64_t ulGlobalEntryTime = 1673769600;
 
 /*
  * Prototypes for the demos that can be started from this project.
@@ -116,8 +121,14 @@ int uxRand( void )
 
 void vApplicationDaemonTaskStartupHook( void )
 {
+    Clock_Init();
+
     MX_LWIP_Init();
 
+#ifdef democonfigSNTP_SERVER
+    ( void ) SNTPClient_StartTask( democonfigSNTP_SERVER, democonfigSNTP_SYNC_INTERVAL_MS );
+#endif
+
     /* Demos that use the network are created after the network is
      * up. */
     configPRINTF( ( "---------STARTING DEMO---------\r\n" ) );
@@ -640,19 +651,7 @@ int mbedtls_platform_entropy_poll( void * data,
 
 uint64_t ullGetUnixTime( void )
 {
-    TickType_t xTickCount = 0;
-    uint64_t ulTime = 0UL;
-
-    /* Get the current tick count. */
-    xTickCount = xTaskGetTickCount();
-
-    /* Convert the ticks to milliseconds. */
-    ulTime = ( uint64_t ) xTickCount / configTICK_RATE_HZ;
-
-    /* Reduce ulGlobalEntryTimeMs from obtained time so as to always return the
-     * elapsed time in the application. */
-    ulTime = ( uint64_t ) ( ulTime + ulGlobalEntryTime );
-
-    return ulTime;
+    /* The middleware expects seconds, used for SAS token expiry. */
+    return Clock_GetUnixTimeMs() / 1000U;
 }
 /*-----------------------------------------------------------*/
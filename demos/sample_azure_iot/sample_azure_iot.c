@@ -14,8 +14,13 @@
 
 /* Azure Provisioning/IoT Hub library includes */
 #include "azure_iot_hub_client.h"
+#include "azure_iot_hub_client_properties.h"
 #include "azure_iot_provisioning_client.h"
 
+/* Azure JSON includes */
+#include "azure_iot_json_reader.h"
+#include "azure_iot_json_writer.h"
+
 /* Exponential backoff retry include. */
 #include "backoff_algorithm.h"
 
@@ -25,6 +30,35 @@
 /* Crypto helper header. */
 #include "crypto.h"
 
+/* Persistent hub session header. */
+#include "hub_session.h"
+
+/* Telemetry publish pipeline header. */
+#include "hub_publish.h"
+
+/* Adaptive telemetry rate header. */
+#include "rate_controller.h"
+
+/* Monotonic clock header. */
+#include "clock_service.h"
+
+/* Latency tracing header. */
+#include "hub_trace.h"
+
+/* Shared message properties header. */
+#include "hub_properties.h"
+
+/* Scratch space header. */
+#include "scratch_arena.h"
+
+/* Streaming transport header. */
+#include "transport_streaming.h"
+
+#ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+    /* Network impairment header. */
+    #include "transport_impairment.h"
+#endif
+
 /*-----------------------------------------------------------*/
 
 /* Compile time error for undefined configs. */
@@ -98,7 +132,8 @@
  * demo iteration.
  *
  * Note that the process loop also has a timeout, so the total time between
- * publishes is the sum of the two delays.
+ * publishes is the sum of the two delays. This is the nominal delay, the rate
+ * controller lengthens it on a congested link.
  */
 #define sampleazureiotDELAY_BETWEEN_PUBLISHES_TICKS           ( pdMS_TO_TICKS( 2000U ) )
 
@@ -107,6 +142,23 @@
  */
 #define sampleazureiotTRANSPORT_SEND_RECV_TIMEOUT_MS          ( 2000U )
 
+/**
+ * @brief Transport timeout for receive, short behind the network impairment
+ * so it does not hold back the bytes it delays.
+ */
+#ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+    #define sampleazureiotTRANSPORT_RECV_TIMEOUT_MS           impairmentPOLL_INTERVAL_MS
+#else
+    #define sampleazureiotTRANSPORT_RECV_TIMEOUT_MS           sampleazureiotTRANSPORT_SEND_RECV_TIMEOUT_MS
+#endif
+
+/**
+ * @brief Seed of the network impairment.
+ */
+#ifndef democonfigNETWORK_IMPAIRMENT_SEED
+    #define democonfigNETWORK_IMPAIRMENT_SEED                 ( 1U )
+#endif
+
 /**
  * @brief Transport timeout in milliseconds for transport send and receive.
  */
@@ -116,6 +168,67 @@
  * @brief Wait timeout for subscribe to finish.
  */
 #define sampleazureiotSUBSCRIBE_TIMEOUT                       ( 10 * 1000U )
+
+/**
+ * @brief Maximum number of telemetry messages waiting for their PUBACK.
+ */
+#define sampleazureiotPUBLISH_WINDOW_SIZE                     ( 4U )
+
+/**
+ * @brief Time to wait for outstanding PUBACKs, or for room in the publish window.
+ */
+#define sampleazureiotPUBLISH_TIMEOUT_MS                      ( 10 * 1000U )
+
+/**
+ * @brief Default bounds of the adaptive publish interval, overridden by the
+ * writable properties below.
+ */
+#define sampleazureiotRATE_MIN_INTERVAL_MS                    ( 500U )
+#define sampleazureiotRATE_MAX_INTERVAL_MS                    ( 60 * 1000U )
+
+/**
+ * @brief Smoothed PUBACK latency above which the link is treated as congested.
+ */
+#define sampleazureiotRATE_TARGET_LATENCY_MS                  ( 1000U )
+
+/**
+ * @brief Interval decrease per cycle when the link recovers.
+ */
+#define sampleazureiotRATE_RECOVER_STEP_MS                    ( 500U )
+
+/**
+ * @brief Writable properties bounding the adaptive publish interval.
+ */
+#define sampleazureiotRATE_MIN_INTERVAL_PROPERTY              "minTelemetryIntervalMs"
+#define sampleazureiotRATE_MAX_INTERVAL_PROPERTY              "maxTelemetryIntervalMs"
+
+/**
+ * @brief Status and description of the writable property responses.
+ */
+#define sampleazureiotPROPERTY_STATUS_SUCCESS                 ( 200 )
+#define sampleazureiotPROPERTY_STATUS_INVALID                 ( 400 )
+#define sampleazureiotPROPERTY_SUCCESS                        "success"
+#define sampleazureiotPROPERTY_INVALID                        "invalid bounds"
+
+/**
+ * @brief Telemetry reporting a change of the publish interval.
+ */
+#define sampleazureiotRATE_DECISION_MESSAGE                                                          \
+    "{\"rateDecision\":{\"reason\":\"%s\",\"intervalMs\":%u,\"previousIntervalMs\":%u,"           \
+    "\"ackLatencyMs\":%u,\"queueDepth\":%u,\"backlog\":%u,\"failures\":%u}}"
+
+/**
+ * @brief Encoded properties of every telemetry message.
+ */
+#define sampleazureiotTELEMETRY_PROPERTIES                    "name=value"
+
+/**
+ * @brief Sizes of the scratch buffers of the operations of the sample task.
+ */
+#define sampleazureiotSCRATCH_BUFFER_SIZE                     ( 128U )
+#define sampleazureiotPROPERTY_BUFFER_SIZE                    ( sizeof( sampleazureiotTELEMETRY_PROPERTIES ) + HUB_TRACE_PROPERTIES_SIZE )
+#define sampleazureiotRATE_DECISION_BUFFER_SIZE               ( 192U )
+#define sampleazureiotRATE_BOUNDS_RESPONSE_SIZE               ( 256U )
 /*-----------------------------------------------------------*/
 
 /**
@@ -133,8 +246,21 @@ uint64_t ullGetUnixTime( void );
     static AzureIoTProvisioningClient_t xAzureIoTProvisioningClient;
 #endif /* democonfigENABLE_DPS_SAMPLE */
 
-static uint8_t ucPropertyBuffer[ 32 ];
-static uint8_t ucScratchBuffer[ 128 ];
+/* Scratch space of each operation of the sample task. The operations run one
+ * at a time, so they share an arena that holds the largest. */
+typedef union SampleScratchSpace
+{
+    uint8_t ucTelemetry[ scratcharenaSIZE( sampleazureiotSCRATCH_BUFFER_SIZE ) +
+                         scratcharenaSIZE( sampleazureiotPROPERTY_BUFFER_SIZE ) ];
+    uint8_t ucRateDecision[ scratcharenaSIZE( sampleazureiotRATE_DECISION_BUFFER_SIZE ) ];
+    uint8_t ucRateBoundsResponse[ scratcharenaSIZE( sampleazureiotRATE_BOUNDS_RESPONSE_SIZE ) ];
+} SampleScratchSpace_t;
+
+static uint8_t ucScratchArenaBuffer[ scratcharenaBUFFER_SIZE( sizeof( SampleScratchSpace_t ) ) ];
+static ScratchArena_t xScratchArena;
+
+/* Properties of every telemetry message, encoded at build time. */
+static const HubPropertyTemplate_t xTelemetryPropertyTemplate = HUB_PROPERTY_TEMPLATE_LITERAL( sampleazureiotTELEMETRY_PROPERTIES );
 
 /* Each compilation unit must define the NetworkContext struct. */
 struct NetworkContext
@@ -143,6 +269,24 @@ struct NetworkContext
 };
 
 static AzureIoTHubClient_t xAzureIoTHubClient;
+static HubSession_t xHubSession;
+static HubPublishPipeline_t xPublishPipeline;
+static RateController_t xRateController;
+static HubTrace_t xTrace;
+
+/* Latency trace being published. It is kept until the publish completes, as
+ * a resend on reconnect writes its JSON again, and for the next interval if
+ * the publish fails. */
+static HubTraceSnapshot_t xTraceSnapshot;
+static HubTraceCursor_t xTraceCursor;
+static bool xTracePublishPending;
+
+/* Writes streamed telemetry, like the latency trace, as it is sent. */
+static StreamingTransport_t xStreamingTransport;
+
+#ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+    static ImpairedTransport_t xImpairedTransport;
+#endif
 /*-----------------------------------------------------------*/
 
 #ifdef democonfigENABLE_DPS_SAMPLE
@@ -213,23 +357,400 @@ static void prvHandleCloudMessage( AzureIoTHubClientCloudToDeviceMessageRequest_
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Telemetry acknowledgement callback handler
+ *
+ * Hands the PUBACKs of the hub client to its publish pipeline.
+ */
+static void prvHandleTelemetryAck( uint16_t usPacketID )
+{
+    HubPublish_HandleAck( &xPublishPipeline, usPacketID );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Telemetry completion callback handler
+ */
+static void prvHandleTelemetryComplete( uint16_t usPacketID,
+                                        uint32_t ulLatencyMs,
+                                        AzureIoTResult_t xResult,
+                                        void * pvContext )
+{
+    HubTraceRecord_t * pxTraceRecord = ( HubTraceRecord_t * ) pvContext;
+
+    RateController_RecordPublish( &xRateController, ulLatencyMs, xResult == eAzureIoTSuccess );
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        HubTrace_Mark( pxTraceRecord, eHubTracePuback );
+    }
+
+    HubTrace_TelemetryEnd( &xTrace, pxTraceRecord );
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        LogInfo( ( "Telemetry packet id %u acknowledged after %u ms\r\n",
+                   usPacketID, ( unsigned ) ulLatencyMs ) );
+    }
+    else
+    {
+        LogWarn( ( "Telemetry packet id %u not acknowledged: result 0x%08x\r\n",
+                   usPacketID, xResult ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Command message callback handler
  */
 static void prvHandleCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
                               void * pvContext )
 {
+    AzureIoTHubClient_t * xHandle = ( AzureIoTHubClient_t * ) pvContext;
+    HubTraceRecord_t xTraceRecord;
+
+    HubTrace_CommandStart( &xTraceRecord );
+
+    HubTrace_Mark( &xTraceRecord, eHubTraceHandlerStart );
     LogInfo( ( "Command payload : %.*s \r\n",
                pxMessage->ulPayloadLength,
                ( const char * ) pxMessage->pvMessagePayload ) );
-
-    AzureIoTHubClient_t * xHandle = ( AzureIoTHubClient_t * ) pvContext;
+    HubTrace_Mark( &xTraceRecord, eHubTraceHandlerEnd );
 
     if( AzureIoTHubClient_SendCommandResponse( xHandle, pxMessage, 200,
                                                NULL, 0 ) != eAzureIoTSuccess )
     {
         LogInfo( ( "Error sending command response\r\n" ) );
     }
+    else
+    {
+        HubTrace_Mark( &xTraceRecord, eHubTraceResponse );
+    }
+
+    HubTrace_CommandEnd( &xTrace, &xTraceRecord );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append the response to one writable publish interval bound.
+ */
+static void prvAppendRateBoundResponse( AzureIoTJSONWriter_t * pxWriter,
+                                        const char * pcPropertyName,
+                                        uint32_t ulPropertyNameLength,
+                                        int32_t lValue,
+                                        uint32_t ulVersion,
+                                        bool xAccepted )
+{
+    AzureIoTResult_t xResult;
+
+    xResult = AzureIoTHubClientProperties_BuilderBeginResponseStatus( &xAzureIoTHubClient, pxWriter,
+                                                                      ( const uint8_t * ) pcPropertyName,
+                                                                      ulPropertyNameLength,
+                                                                      xAccepted ? sampleazureiotPROPERTY_STATUS_SUCCESS :
+                                                                      sampleazureiotPROPERTY_STATUS_INVALID,
+                                                                      ulVersion,
+                                                                      ( const uint8_t * ) ( xAccepted ? sampleazureiotPROPERTY_SUCCESS :
+                                                                                            sampleazureiotPROPERTY_INVALID ),
+                                                                      xAccepted ? sizeof( sampleazureiotPROPERTY_SUCCESS ) - 1 :
+                                                                      sizeof( sampleazureiotPROPERTY_INVALID ) - 1 );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xResult = AzureIoTJSONWriter_AppendInt32( pxWriter, lValue );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xResult = AzureIoTHubClientProperties_BuilderEndResponseStatus( &xAzureIoTHubClient, pxWriter );
+    configASSERT( xResult == eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Acknowledge the writable publish interval bounds of a document, as
+ * reported properties.
+ */
+static void prvAcknowledgeRateBounds( uint32_t ulVersion,
+                                      bool xMinWritten,
+                                      int32_t lMinIntervalMs,
+                                      bool xMaxWritten,
+                                      int32_t lMaxIntervalMs,
+                                      bool xAccepted )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJSONWriter_t xWriter;
+    ScratchArenaMark_t xScratchMark;
+    uint8_t * pucResponseBuffer;
+    int32_t lLength;
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucResponseBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotRATE_BOUNDS_RESPONSE_SIZE );
+    configASSERT( pucResponseBuffer != NULL );
+
+    xResult = AzureIoTJSONWriter_Init( &xWriter, pucResponseBuffer, sampleazureiotRATE_BOUNDS_RESPONSE_SIZE );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xResult = AzureIoTJSONWriter_AppendBeginObject( &xWriter );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    if( xMinWritten )
+    {
+        prvAppendRateBoundResponse( &xWriter, sampleazureiotRATE_MIN_INTERVAL_PROPERTY,
+                                    sizeof( sampleazureiotRATE_MIN_INTERVAL_PROPERTY ) - 1,
+                                    lMinIntervalMs, ulVersion, xAccepted );
+    }
+
+    if( xMaxWritten )
+    {
+        prvAppendRateBoundResponse( &xWriter, sampleazureiotRATE_MAX_INTERVAL_PROPERTY,
+                                    sizeof( sampleazureiotRATE_MAX_INTERVAL_PROPERTY ) - 1,
+                                    lMaxIntervalMs, ulVersion, xAccepted );
+    }
+
+    xResult = AzureIoTJSONWriter_AppendEndObject( &xWriter );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    lLength = AzureIoTJSONWriter_GetBytesUsed( &xWriter );
+    configASSERT( lLength > 0 );
+
+    xResult = AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient,
+                                                        pucResponseBuffer, ( uint32_t ) lLength,
+                                                        NULL );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        LogError( ( "Failed to acknowledge the publish interval bounds: result 0x%08x", xResult ) );
+    }
+
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Apply the publish interval bounds found in a writable properties
+ * document, and acknowledge them.
+ */
+static void prvUpdateRateBounds( AzureIoTHubClientPropertiesResponse_t * pxMessage )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJSONReader_t xReader;
+    const uint8_t * pucComponentName = NULL;
+    uint32_t ulComponentNameLength = 0;
+    uint32_t ulMinIntervalMs = xRateController.xConfig.ulMinIntervalMs;
+    uint32_t ulMaxIntervalMs = xRateController.xConfig.ulMaxIntervalMs;
+    int32_t lMinIntervalMs = ( int32_t ) ulMinIntervalMs;
+    int32_t lMaxIntervalMs = ( int32_t ) ulMaxIntervalMs;
+    bool xMinWritten = false;
+    bool xMaxWritten = false;
+    bool xValid = true;
+    bool xAccepted;
+    uint32_t ulVersion;
+    int32_t * plBound;
+    bool * pxWritten;
+    int32_t lValue;
+
+    xResult = AzureIoTJSONReader_Init( &xReader, pxMessage->pvMessagePayload, pxMessage->ulPayloadLength );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    if( AzureIoTHubClientProperties_GetPropertiesVersion( &xAzureIoTHubClient, &xReader,
+                                                          pxMessage->xMessageType, &ulVersion ) != eAzureIoTSuccess )
+    {
+        LogError( ( "Error getting the property version" ) );
+        return;
+    }
+
+    /* Reset JSON reader to the beginning */
+    xResult = AzureIoTJSONReader_Init( &xReader, pxMessage->pvMessagePayload, pxMessage->ulPayloadLength );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    while( ( xResult = AzureIoTHubClientProperties_GetNextComponentProperty( &xAzureIoTHubClient, &xReader,
+                                                                             pxMessage->xMessageType,
+                                                                             eAzureIoTHubClientPropertyWritable,
+                                                                             &pucComponentName, &ulComponentNameLength ) ) == eAzureIoTSuccess )
+    {
+        plBound = NULL;
+        pxWritten = NULL;
+
+        if( ulComponentNameLength == 0 )
+        {
+            if( AzureIoTJSONReader_TokenIsTextEqual( &xReader, ( const uint8_t * ) sampleazureiotRATE_MIN_INTERVAL_PROPERTY,
+                                                     sizeof( sampleazureiotRATE_MIN_INTERVAL_PROPERTY ) - 1 ) )
+            {
+                plBound = &lMinIntervalMs;
+                pxWritten = &xMinWritten;
+            }
+            else if( AzureIoTJSONReader_TokenIsTextEqual( &xReader, ( const uint8_t * ) sampleazureiotRATE_MAX_INTERVAL_PROPERTY,
+                                                          sizeof( sampleazureiotRATE_MAX_INTERVAL_PROPERTY ) - 1 ) )
+            {
+                plBound = &lMaxIntervalMs;
+                pxWritten = &xMaxWritten;
+            }
+        }
+
+        xResult = AzureIoTJSONReader_NextToken( &xReader );
+        configASSERT( xResult == eAzureIoTSuccess );
+
+        if( plBound != NULL )
+        {
+            *pxWritten = true;
+
+            if( ( AzureIoTJSONReader_GetTokenInt32( &xReader, &lValue ) == eAzureIoTSuccess ) && ( lValue > 0 ) )
+            {
+                *plBound = lValue;
+            }
+            else
+            {
+                xValid = false;
+            }
+        }
+
+        /* Skip the value, including any nested children. */
+        xResult = AzureIoTJSONReader_SkipChildren( &xReader );
+        configASSERT( xResult == eAzureIoTSuccess );
+
+        xResult = AzureIoTJSONReader_NextToken( &xReader );
+        configASSERT( xResult == eAzureIoTSuccess );
+    }
+
+    if( xResult != eAzureIoTErrorEndOfProperties )
+    {
+        LogError( ( "There was an error parsing the properties: 0x%08x", xResult ) );
+        return;
+    }
+
+    if( !xMinWritten && !xMaxWritten )
+    {
+        return;
+    }
+
+    ulMinIntervalMs = ( uint32_t ) lMinIntervalMs;
+    ulMaxIntervalMs = ( uint32_t ) lMaxIntervalMs;
+    xAccepted = xValid && RateController_SetBounds( &xRateController, ulMinIntervalMs, ulMaxIntervalMs );
+
+    if( xAccepted )
+    {
+        LogInfo( ( "Publish interval bounds %u..%u ms",
+                   ( unsigned ) ulMinIntervalMs, ( unsigned ) ulMaxIntervalMs ) );
+    }
+    else
+    {
+        LogError( ( "Ignoring publish interval bounds %u..%u ms",
+                    ( unsigned ) ulMinIntervalMs, ( unsigned ) ulMaxIntervalMs ) );
+    }
+
+    prvAcknowledgeRateBounds( ulVersion, xMinWritten, lMinIntervalMs, xMaxWritten, lMaxIntervalMs, xAccepted );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send a publish interval change as telemetry.
+ */
+static void prvReportRateDecision( const RateDecision_t * pxDecision )
+{
+    AzureIoTResult_t xResult;
+    uint8_t * pucRateDecisionBuffer;
+    ScratchArenaMark_t xScratchMark;
+    int lLength;
+
+    LogInfo( ( "Publish interval %u -> %u ms (%s)\r\n",
+               ( unsigned ) pxDecision->ulPreviousIntervalMs, ( unsigned ) pxDecision->ulIntervalMs,
+               RateController_ReasonName( pxDecision->xReason ) ) );
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucRateDecisionBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotRATE_DECISION_BUFFER_SIZE );
+    configASSERT( pucRateDecisionBuffer != NULL );
+
+    lLength = snprintf( ( char * ) pucRateDecisionBuffer, sampleazureiotRATE_DECISION_BUFFER_SIZE,
+                        sampleazureiotRATE_DECISION_MESSAGE,
+                        RateController_ReasonName( pxDecision->xReason ),
+                        ( unsigned ) pxDecision->ulIntervalMs, ( unsigned ) pxDecision->ulPreviousIntervalMs,
+                        ( unsigned ) pxDecision->ulLatencyMs, ( unsigned ) pxDecision->ulQueueDepth,
+                        ( unsigned ) pxDecision->ulBacklog, ( unsigned ) pxDecision->ulFailures );
+    configASSERT( ( lLength > 0 ) && ( lLength < ( int ) sampleazureiotRATE_DECISION_BUFFER_SIZE ) );
+
+    xResult = HubPublish_SendTelemetry( &xPublishPipeline,
+                                        pucRateDecisionBuffer, ( uint32_t ) lLength,
+                                        NULL, prvHandleTelemetryComplete, NULL,
+                                        sampleazureiotPUBLISH_TIMEOUT_MS, NULL );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        LogWarn( ( "Failed to report the publish interval: result 0x%08x\r\n", xResult ) );
+    }
+
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Generator of the latency trace, written in parts of a chunk of the
+ * streaming transport.
+ */
+static int32_t prvGenerateLatencyTrace( void * pvContext,
+                                        uint32_t ulOffset,
+                                        uint8_t * pucBuffer,
+                                        uint32_t ulBufferSize )
+{
+    HubTraceCursor_t * pxCursor = ( HubTraceCursor_t * ) pvContext;
+
+    if( ulOffset == 0 )
+    {
+        HubTrace_CursorRewind( pxCursor );
+    }
+
+    return HubTrace_SerializePart( pxCursor, pucBuffer, ulBufferSize );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Completion of the latency trace publish.
+ */
+static void prvLatencyTraceComplete( uint16_t usPacketID,
+                                     uint32_t ulLatencyMs,
+                                     AzureIoTResult_t xResult,
+                                     void * pvContext )
+{
+    ( void ) usPacketID;
+    ( void ) ulLatencyMs;
+    ( void ) pvContext;
+
+    /* A trace which was not acknowledged goes out with the next interval. */
+    if( xResult == eAzureIoTSuccess )
+    {
+        HubTrace_SnapshotClear( &xTraceSnapshot );
+    }
+
+    xTracePublishPending = false;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publish the latency histograms collected since the previous call.
+ *
+ * The JSON is streamed, it grows with the spans and buckets seen and is not
+ * held in memory as a whole.
+ */
+static void prvPublishLatencyTrace( void )
+{
+    AzureIoTResult_t xResult;
+
+    /* The histograms keep counting until the previous trace completes. */
+    if( xTracePublishPending )
+    {
+        return;
+    }
+
+    HubTrace_Snapshot( &xTrace, &xTraceSnapshot );
+    HubTrace_CursorInit( &xTraceCursor, &xTraceSnapshot );
+    xTracePublishPending = true;
+
+    xResult = HubPublish_SendTelemetryStream( &xPublishPipeline, &xStreamingTransport,
+                                              prvGenerateLatencyTrace, &xTraceCursor, 0,
+                                              NULL, prvLatencyTraceComplete, NULL,
+                                              sampleazureiotPUBLISH_TIMEOUT_MS, NULL );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        xTracePublishPending = false;
+        LogWarn( ( "Failed to publish the latency trace: result 0x%08x\r\n", xResult ) );
+    }
 }
 /*-----------------------------------------------------------*/
 
@@ -245,6 +766,7 @@ static void prvHandlePropertiesMessage( AzureIoTHubClientPropertiesResponse_t *
     {
         case eAzureIoTHubPropertiesRequestedMessage:
             LogInfo( ( "Device property document GET received" ) );
+            prvUpdateRateBounds( pxMessage );
             break;
 
         case eAzureIoTHubPropertiesReportedResponseMessage:
@@ -253,6 +775,7 @@ static void prvHandlePropertiesMessage( AzureIoTHubClientPropertiesResponse_t *
 
         case eAzureIoTHubPropertiesWritablePropertyMessage:
             LogInfo( ( "Device property desired property received" ) );
+            prvUpdateRateBounds( pxMessage );
             break;
 
         default:
@@ -293,6 +816,9 @@ static void prvAzureDemoTask( void * pvParameters )
 {
     int lPublishCount = 0;
     uint32_t ulScratchBufferLength = 0U;
+    uint8_t * pucScratchBuffer;
+    uint8_t * pucPropertyBuffer;
+    ScratchArenaMark_t xScratchMark;
     const int lMaxPublishCount = 5;
     NetworkCredentials_t xNetworkCredentials = { 0 };
     AzureIoTTransportInterface_t xTransport;
@@ -300,9 +826,20 @@ static void prvAzureDemoTask( void * pvParameters )
     TlsTransportParams_t xTlsTransportParams = { 0 };
     AzureIoTResult_t xResult;
     uint32_t ulStatus;
+    uint64_t ullConnectStartUs;
     AzureIoTHubClientOptions_t xHubOptions = { 0 };
     AzureIoTMessageProperties_t xPropertyBag;
-    bool xSessionPresent;
+    HubTraceRecord_t * pxTraceRecord;
+    HubSubscriptions_t xSubscriptions = { 0 };
+    RateControllerConfig_t xRateConfig = { 0 };
+    RateDecision_t xRateDecision;
+    uint32_t ulPublishIntervalMs;
+    bool xRateConfigValid;
+
+    #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+        const ImpairmentConfig_t * pxImpairment;
+        ImpairmentStats_t xImpairmentStats;
+    #endif
 
     #ifdef democonfigENABLE_DPS_SAMPLE
         uint8_t * pucIotHubHostname = NULL;
@@ -337,6 +874,75 @@ static void prvAzureDemoTask( void * pvParameters )
 
     xNetworkContext.pParams = &xTlsTransportParams;
 
+    /* Fill in Transport Interface send and receive function pointers. */
+    xTransport.pxNetworkContext = &xNetworkContext;
+    xTransport.xSend = TLS_Socket_Send;
+    xTransport.xRecv = TLS_Socket_Recv;
+
+    #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+        pxImpairment = Impairment_FindProfile( democonfigNETWORK_IMPAIRMENT_PROFILE,
+                                               sizeof( democonfigNETWORK_IMPAIRMENT_PROFILE ) - 1 );
+        configASSERT( pxImpairment != NULL );
+        LogInfo( ( "Emulating a %s link, seed %u\r\n", pxImpairment->pcName,
+                   ( unsigned ) democonfigNETWORK_IMPAIRMENT_SEED ) );
+
+        Impairment_Init( &xImpairedTransport, pxImpairment, democonfigNETWORK_IMPAIRMENT_SEED );
+        xTlsTransportParams.pxInterposer = Impairment_GetInterposer( &xImpairedTransport );
+    #endif /* democonfigNETWORK_IMPAIRMENT_PROFILE */
+
+    Streaming_Wrap( &xStreamingTransport, &xTransport );
+
+    /* Init IoT Hub option */
+    xResult = AzureIoTHubClient_OptionsInit( &xHubOptions );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xHubOptions.pucModuleID = ( const uint8_t * ) democonfigMODULE_ID;
+    xHubOptions.ulModuleIDLength = sizeof( democonfigMODULE_ID ) - 1;
+    xHubOptions.xTelemetryCallback = prvHandleTelemetryAck;
+
+    /* The client is initialized once and reused across connections, so that
+     * its receive callbacks survive a reconnect that resumes the session. */
+    xResult = AzureIoTHubClient_Init( &xAzureIoTHubClient,
+                                      pucIotHubHostname, pulIothubHostnameLength,
+                                      pucIotHubDeviceId, pulIothubDeviceIdLength,
+                                      &xHubOptions,
+                                      ucMQTTMessageBuffer, sizeof( ucMQTTMessageBuffer ),
+                                      ullGetUnixTime,
+                                      &xTransport );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    #ifdef democonfigDEVICE_SYMMETRIC_KEY
+        xResult = AzureIoTHubClient_SetSymmetricKey( &xAzureIoTHubClient,
+                                                     ( const uint8_t * ) democonfigDEVICE_SYMMETRIC_KEY,
+                                                     sizeof( democonfigDEVICE_SYMMETRIC_KEY ) - 1,
+                                                     Crypto_HMAC );
+        configASSERT( xResult == eAzureIoTSuccess );
+    #endif /* democonfigDEVICE_SYMMETRIC_KEY */
+
+    xSubscriptions.xCloudToDeviceMessageCallback = prvHandleCloudMessage;
+    xSubscriptions.xCommandCallback = prvHandleCommand;
+    xSubscriptions.xPropertiesCallback = prvHandlePropertiesMessage;
+    xSubscriptions.pvCallbackContext = &xAzureIoTHubClient;
+    xSubscriptions.ulSubscribeTimeoutMs = sampleazureiotSUBSCRIBE_TIMEOUT;
+
+    xResult = HubSession_Init( &xHubSession, &xAzureIoTHubClient, &xSubscriptions );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xResult = HubPublish_Init( &xPublishPipeline, &xAzureIoTHubClient, sampleazureiotPUBLISH_WINDOW_SIZE );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xRateConfig.ulNominalIntervalMs = sampleazureiotDELAY_BETWEEN_PUBLISHES_TICKS * portTICK_PERIOD_MS;
+    xRateConfig.ulMinIntervalMs = sampleazureiotRATE_MIN_INTERVAL_MS;
+    xRateConfig.ulMaxIntervalMs = sampleazureiotRATE_MAX_INTERVAL_MS;
+    xRateConfig.ulTargetLatencyMs = sampleazureiotRATE_TARGET_LATENCY_MS;
+    xRateConfig.ulMaxQueueDepth = sampleazureiotPUBLISH_WINDOW_SIZE;
+    xRateConfig.ulRecoverStepMs = sampleazureiotRATE_RECOVER_STEP_MS;
+    xRateConfigValid = RateController_Init( &xRateController, &xRateConfig );
+    configASSERT( xRateConfigValid );
+
+    ScratchArena_Init( &xScratchArena, ucScratchArenaBuffer, sizeof( ucScratchArenaBuffer ) );
+    HubTrace_Init( &xTrace );
+
     for( ; ; )
     {
         /* Attempt to establish TLS session with IoT Hub. If connection fails,
@@ -345,123 +951,134 @@ static void prvAzureDemoTask( void * pvParameters )
          * value is reached. The function returns a failure status if the TCP
          * connection cannot be established to the IoT Hub after the configured
          * number of attempts. */
+        ullConnectStartUs = Clock_GetMonotonicUs();
         ulStatus = prvConnectToServerWithBackoffRetries( ( const char * ) pucIotHubHostname,
                                                          democonfigIOTHUB_PORT,
                                                          &xNetworkCredentials, &xNetworkContext );
         configASSERT( ulStatus == 0 );
+        HubTrace_AddLatency( &xTrace, eHubTraceConnect, Clock_GetMonotonicUs() - ullConnectStartUs );
 
-        /* Fill in Transport Interface send and receive function pointers. */
-        xTransport.pxNetworkContext = &xNetworkContext;
-        xTransport.xSend = TLS_Socket_Send;
-        xTransport.xRecv = TLS_Socket_Recv;
-
-        /* Init IoT Hub option */
-        xResult = AzureIoTHubClient_OptionsInit( &xHubOptions );
-        configASSERT( xResult == eAzureIoTSuccess );
-
-        xHubOptions.pucModuleID = ( const uint8_t * ) democonfigMODULE_ID;
-        xHubOptions.ulModuleIDLength = sizeof( democonfigMODULE_ID ) - 1;
-
-        xResult = AzureIoTHubClient_Init( &xAzureIoTHubClient,
-                                          pucIotHubHostname, pulIothubHostnameLength,
-                                          pucIotHubDeviceId, pulIothubDeviceIdLength,
-                                          &xHubOptions,
-                                          ucMQTTMessageBuffer, sizeof( ucMQTTMessageBuffer ),
-                                          ullGetUnixTime,
-                                          &xTransport );
-        configASSERT( xResult == eAzureIoTSuccess );
-
-        #ifdef democonfigDEVICE_SYMMETRIC_KEY
-            xResult = AzureIoTHubClient_SetSymmetricKey( &xAzureIoTHubClient,
-                                                         ( const uint8_t * ) democonfigDEVICE_SYMMETRIC_KEY,
-                                                         sizeof( democonfigDEVICE_SYMMETRIC_KEY ) - 1,
-                                                         Crypto_HMAC );
-            configASSERT( xResult == eAzureIoTSuccess );
-        #endif /* democonfigDEVICE_SYMMETRIC_KEY */
+        Streaming_Reconnect( &xStreamingTransport );
 
         /* Sends an MQTT Connect packet over the already established TLS connection,
-         * and waits for connection acknowledgment (CONNACK) packet. */
+         * waits for connection acknowledgment (CONNACK) packet and subscribes
+         * unless IoT Hub kept the session of the previous iteration. */
         LogInfo( ( "Creating an MQTT connection to %s.\r\n", pucIotHubHostname ) );
 
-        xResult = AzureIoTHubClient_Connect( &xAzureIoTHubClient,
-                                             false, &xSessionPresent,
-                                             sampleazureiotCONNACK_RECV_TIMEOUT_MS );
-        configASSERT( xResult == eAzureIoTSuccess );
-
-        xResult = AzureIoTHubClient_SubscribeCloudToDeviceMessage( &xAzureIoTHubClient, prvHandleCloudMessage,
-                                                                   &xAzureIoTHubClient, sampleazureiotSUBSCRIBE_TIMEOUT );
+        xResult = HubSession_Connect( &xHubSession, sampleazureiotCONNACK_RECV_TIMEOUT_MS );
         configASSERT( xResult == eAzureIoTSuccess );
 
-        xResult = AzureIoTHubClient_SubscribeCommand( &xAzureIoTHubClient, prvHandleCommand,
-                                                      &xAzureIoTHubClient, sampleazureiotSUBSCRIBE_TIMEOUT );
-        configASSERT( xResult == eAzureIoTSuccess );
+        /* Send again the telemetry the previous connection left without
+         * PUBACK if IoT Hub kept the session, else give it up. */
+        xResult = HubPublish_Resume( &xPublishPipeline, xHubSession.xStats.xLastSessionPresent );
 
-        xResult = AzureIoTHubClient_SubscribeProperties( &xAzureIoTHubClient, prvHandlePropertiesMessage,
-                                                         &xAzureIoTHubClient, sampleazureiotSUBSCRIBE_TIMEOUT );
-        configASSERT( xResult == eAzureIoTSuccess );
+        if( xResult != eAzureIoTSuccess )
+        {
+            LogWarn( ( "Failed to resend telemetry: result 0x%08x\r\n", xResult ) );
+        }
 
         /* Get property document after initial connection */
         xResult = AzureIoTHubClient_RequestPropertiesAsync( &xAzureIoTHubClient );
         configASSERT( xResult == eAzureIoTSuccess );
 
-        /* Create a bag of properties for the telemetry */
-        xResult = AzureIoTMessage_PropertiesInit( &xPropertyBag, ucPropertyBuffer, 0, sizeof( xPropertyBag ) );
-        configASSERT( xResult == eAzureIoTSuccess );
-
-        xResult = AzureIoTMessage_PropertiesAppend( &xPropertyBag, ( uint8_t * ) "name", sizeof( "name" ) - 1,
-                                                    ( uint8_t * ) "value", sizeof( "value" ) - 1 );
-        configASSERT( xResult == eAzureIoTSuccess );
-
         /* Publish messages with QoS1, send and process Keep alive messages. */
         for( lPublishCount = 0; lPublishCount < lMaxPublishCount; lPublishCount++ )
         {
-            ulScratchBufferLength = snprintf( ( char * ) ucScratchBuffer, sizeof( ucScratchBuffer ),
+            xScratchMark = ScratchArena_Mark( &xScratchArena );
+            pucScratchBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotSCRATCH_BUFFER_SIZE );
+            pucPropertyBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotPROPERTY_BUFFER_SIZE );
+            configASSERT( ( pucScratchBuffer != NULL ) && ( pucPropertyBuffer != NULL ) );
+
+            ulScratchBufferLength = snprintf( ( char * ) pucScratchBuffer, sampleazureiotSCRATCH_BUFFER_SIZE,
                                               sampleazureiotMESSAGE, lPublishCount );
-            xResult = AzureIoTHubClient_SendTelemetry( &xAzureIoTHubClient,
-                                                       ucScratchBuffer, ulScratchBufferLength,
-                                                       &xPropertyBag, eAzureIoTHubMessageQoS1, NULL );
+
+            /* Create a bag of properties for the telemetry, the encoded
+             * constant ones followed by the trace correlation-id and
+             * creation time of this message. */
+            xResult = HubProperties_Instantiate( &xTelemetryPropertyTemplate, &xPropertyBag,
+                                                 pucPropertyBuffer, sampleazureiotPROPERTY_BUFFER_SIZE );
+            configASSERT( xResult == eAzureIoTSuccess );
+
+            pxTraceRecord = HubTrace_TelemetryStart( &xTrace, &xPropertyBag );
+            HubTrace_Mark( pxTraceRecord, eHubTraceEnqueue );
+
+            /* Does not wait for the PUBACK, which is reported to
+             * prvHandleTelemetryComplete by a later process loop. */
+            xResult = HubPublish_SendTelemetry( &xPublishPipeline,
+                                                pucScratchBuffer, ulScratchBufferLength,
+                                                &xPropertyBag, prvHandleTelemetryComplete, pxTraceRecord,
+                                                sampleazureiotPUBLISH_TIMEOUT_MS, NULL );
             configASSERT( xResult == eAzureIoTSuccess );
+            HubTrace_Mark( pxTraceRecord, eHubTraceSendComplete );
+            ScratchArena_Reset( &xScratchArena, xScratchMark );
 
             LogInfo( ( "Attempt to receive publish message from IoT Hub.\r\n" ) );
-            xResult = AzureIoTHubClient_ProcessLoop( &xAzureIoTHubClient,
-                                                     sampleazureiotPROCESS_LOOP_TIMEOUT_MS );
+            xResult = HubPublish_ProcessLoop( &xPublishPipeline,
+                                              sampleazureiotPROCESS_LOOP_TIMEOUT_MS );
             configASSERT( xResult == eAzureIoTSuccess );
 
             if( lPublishCount % 2 == 0 )
             {
                 /* Send reported property every other cycle */
-                ulScratchBufferLength = snprintf( ( char * ) ucScratchBuffer, sizeof( ucScratchBuffer ),
+                pucScratchBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotSCRATCH_BUFFER_SIZE );
+                configASSERT( pucScratchBuffer != NULL );
+
+                ulScratchBufferLength = snprintf( ( char * ) pucScratchBuffer, sampleazureiotSCRATCH_BUFFER_SIZE,
                                                   sampleazureiotPROPERTY, lPublishCount / 2 + 1 );
                 xResult = AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient,
-                                                                    ucScratchBuffer, ulScratchBufferLength,
+                                                                    pucScratchBuffer, ulScratchBufferLength,
                                                                     NULL );
                 configASSERT( xResult == eAzureIoTSuccess );
+                ScratchArena_Reset( &xScratchArena, xScratchMark );
+            }
+
+            /* Adapt the publish interval to the PUBACK latency and the
+             * number of publishes still waiting for one. This sample has
+             * no store-and-forward queue, so there is no backlog. */
+            ulPublishIntervalMs = RateController_Update( &xRateController,
+                                                         HubPublish_InFlight( &xPublishPipeline ),
+                                                         0, &xRateDecision );
+
+            if( xRateDecision.xReason != eRateHold )
+            {
+                prvReportRateDecision( &xRateDecision );
             }
 
             /* Leave Connection Idle for some time. */
             LogInfo( ( "Keeping Connection Idle...\r\n\r\n" ) );
-            vTaskDelay( sampleazureiotDELAY_BETWEEN_PUBLISHES_TICKS );
+            vTaskDelay( pdMS_TO_TICKS( ulPublishIntervalMs ) );
         }
 
-        xResult = AzureIoTHubClient_UnsubscribeProperties( &xAzureIoTHubClient );
-        configASSERT( xResult == eAzureIoTSuccess );
+        /* Publish the latencies of this iteration. */
+        prvPublishLatencyTrace();
 
-        xResult = AzureIoTHubClient_UnsubscribeCommand( &xAzureIoTHubClient );
-        configASSERT( xResult == eAzureIoTSuccess );
+        /* Collect the acknowledgements still outstanding. */
+        xResult = HubPublish_Flush( &xPublishPipeline, sampleazureiotPUBLISH_TIMEOUT_MS );
 
-        xResult = AzureIoTHubClient_UnsubscribeCloudToDeviceMessage( &xAzureIoTHubClient );
-        configASSERT( xResult == eAzureIoTSuccess );
+        if( xResult != eAzureIoTSuccess )
+        {
+            LogWarn( ( "%u telemetry messages not acknowledged before disconnect, resent on reconnect\r\n",
+                       ( unsigned ) HubPublish_InFlight( &xPublishPipeline ) ) );
+        }
 
         /* Send an MQTT Disconnect packet over the already connected TLS over
          * TCP connection. There is no corresponding response for the disconnect
          * packet. After sending disconnect, client must close the network
-         * connection. */
-        xResult = AzureIoTHubClient_Disconnect( &xAzureIoTHubClient );
+         * connection. The subscriptions are kept so the next iteration can
+         * resume the session without subscribing again. */
+        xResult = HubSession_Disconnect( &xHubSession );
         configASSERT( xResult == eAzureIoTSuccess );
 
         /* Close the network connection.  */
         TLS_Socket_Disconnect( &xNetworkContext );
 
+        #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+            Impairment_GetStats( &xImpairedTransport, &xImpairmentStats );
+            LogInfo( ( "Link: %u chunks lost, %u stalls, longest delay %u ms\r\n",
+                       ( unsigned ) xImpairmentStats.ulChunksLost, ( unsigned ) xImpairmentStats.ulStalls,
+                       ( unsigned ) xImpairmentStats.ulMaxDelayMs ) );
+        #endif
+
         /* Wait for some time between two iterations to ensure that we do not
          * bombard the IoT Hub. */
         LogInfo( ( "Demo completed successfully.\r\n" ) );
@@ -582,7 +1199,7 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
         xNetworkStatus = TLS_Socket_Connect( pxNetworkContext,
                                              pcHostName, port,
                                              pxNetworkCredentials,
-                                             sampleazureiotTRANSPORT_SEND_RECV_TIMEOUT_MS,
+                                             sampleazureiotTRANSPORT_RECV_TIMEOUT_MS,
                                              sampleazureiotTRANSPORT_SEND_RECV_TIMEOUT_MS );
 
         if( xNetworkStatus != eTLSTransportSuccess )
@@ -618,7 +1235,7 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
 void vStartDemoTask( void )
 {
     /* This example uses a single application task, which in turn is used to
-     * connect, subscribe, publish, unsubscribe and disconnect from the IoT Hub */
+     * connect, subscribe, publish and disconnect from the IoT Hub */
     xTaskCreate( prvAzureDemoTask,         /* Function that implements the task. */
                  "AzureDemoTask",          /* Text name for the task - only used for debugging. */
                  democonfigDEMO_STACKSIZE, /* Size of stack (in words, not bytes) to allocate for the task. */
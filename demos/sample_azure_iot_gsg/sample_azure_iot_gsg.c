@@ -27,6 +27,18 @@
 /* Crypto helper header. */
 #include "crypto.h"
 
+/* Hub subscribe helper header. */
+#include "hub_subscribe.h"
+
+/* Reported property coalescing header. */
+#include "hub_reporter.h"
+
+/* Telemetry interval controller header. */
+#include "rate_controller.h"
+
+/* Scratch space header. */
+#include "scratch_arena.h"
+
 /* Demo specific configs. */
 #include "demo_config.h"
 
@@ -102,6 +114,40 @@
  * @brief Wait timeout for subscribe to finish.
  */
 #define sampleazureiotgsgSUBSCRIBE_TIMEOUT                       ( 10 * 1000U )
+
+/**
+ * @brief Time reported property updates are held to be merged into one patch.
+ */
+#define sampleazureiotgsgREPORTED_PROPERTIES_WINDOW_MS           ( 1000U )
+
+/**
+ * @brief Bounds of the telemetry interval. telemetryInterval sets the nominal
+ * interval, which grows toward the maximum while the link is congested.
+ */
+#define sampleazureiotgsgRATE_MIN_INTERVAL_MS                    ( 1000U )
+#define sampleazureiotgsgRATE_MAX_INTERVAL_MS                    ( 10 * 60 * 1000U )
+
+/**
+ * @brief Smoothed PUBACK and reported properties latency above which the
+ * link is treated as congested.
+ */
+#define sampleazureiotgsgRATE_TARGET_LATENCY_MS                  ( 1000U )
+
+/**
+ * @brief Interval decrease per cycle when the link recovers.
+ */
+#define sampleazureiotgsgRATE_RECOVER_STEP_MS                    ( 1000U )
+
+/**
+ * @brief Telemetry messages awaiting their PUBACK which are tracked. The link
+ * is treated as congested when all are taken.
+ */
+#define sampleazureiotgsgTELEMETRY_MAX_IN_FLIGHT                 ( 4U )
+
+/**
+ * @brief Time after which a PUBACK is given up on.
+ */
+#define sampleazureiotgsgPUBACK_TIMEOUT_MS                       ( 10 * 1000U )
 /*-----------------------------------------------------------*/
 
 #define sampleazureiotgsgTELEMETRY_INTERVAL_PROPERTY             ( "telemetryInterval" )
@@ -119,6 +165,12 @@
 #define sampleazureiotgsgTOTAL_MEMORY_PROPERTY_NAME              ( "totalMemory" )
 
 #define sampleazureiotgsgTRUE                                    ( "true" )
+
+/**
+ * @brief Sizes of the scratch buffers, the property reports are the largest.
+ */
+#define sampleazureiotgsgSCRATCH_BUFFER_SIZE                     ( 128U )
+#define sampleazureiotgsgPROPERTY_BUFFER_SIZE                    ( 400U )
 /*-----------------------------------------------------------*/
 
 /* Each compilation unit must define the NetworkContext struct. */
@@ -137,17 +189,30 @@ struct NetworkContext
 
 #endif /* democonfigENABLE_DPS_SAMPLE */
 
-/* Scratch buffer */
-static uint8_t ucScratchBuffer[ 128 ];
+/* Scratch space of the DPS payload, telemetry and property reports. They
+ * are built one at a time, so they share an arena that holds the largest. */
+static uint8_t ucScratchArenaBuffer[ scratcharenaBUFFER_SIZE( scratcharenaSIZE( sampleazureiotgsgPROPERTY_BUFFER_SIZE ) ) ];
+static ScratchArena_t xScratchArena;
 
-/* Property buffer */
-static uint8_t ucPropertyPayloadBuffer[ 400 ];
+/* Merged reported properties patch buffer */
+static uint8_t ucReportedPatchBuffer[ 512 ];
 
 /* Device properties */
 static int32_t lTelemetryInterval = 5;
 static bool xLedState = false;
 
 static AzureIoTHubClient_t xAzureIoTHubClient;
+static HubReporter_t xReporter;
+
+/* Telemetry interval adapted to the PUBACK and reported properties latency */
+static RateController_t xRateController;
+
+/* Telemetry sent and awaiting its PUBACK, a packet ID of 0 marks a free slot. */
+static struct
+{
+    uint16_t usPacketID;
+    TickType_t xSentTicks;
+} xTelemetryInFlight[ sampleazureiotgsgTELEMETRY_MAX_IN_FLIGHT ];
 /*-----------------------------------------------------------*/
 
 /**
@@ -169,9 +234,15 @@ static void prvReportLedState()
     AzureIoTResult_t xResult;
     AzureIoTJSONWriter_t xWriter;
     int32_t lBytesWritten;
+    uint8_t * pucPropertyPayloadBuffer;
+    ScratchArenaMark_t xScratchMark;
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucPropertyPayloadBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotgsgPROPERTY_BUFFER_SIZE );
+    configASSERT( pucPropertyPayloadBuffer != NULL );
 
     /* Update reported property */
-    xResult = AzureIoTJSONWriter_Init( &xWriter, ucPropertyPayloadBuffer, sizeof( ucPropertyPayloadBuffer ) );
+    xResult = AzureIoTJSONWriter_Init( &xWriter, pucPropertyPayloadBuffer, sampleazureiotgsgPROPERTY_BUFFER_SIZE );
     configASSERT( xResult == eAzureIoTSuccess );
 
     xResult = AzureIoTJSONWriter_AppendBeginObject( &xWriter );
@@ -192,15 +263,13 @@ static void prvReportLedState()
     if( lBytesWritten < 0 )
     {
         LogError( ( "Error getting the bytes written for the properties confirmation JSON" ) );
-        return;
     }
-
-    xResult = AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient, ucPropertyPayloadBuffer, lBytesWritten, NULL );
-
-    if( xResult != eAzureIoTSuccess )
+    else if( ( xResult = HubReporter_MergePatch( &xReporter, pucPropertyPayloadBuffer, lBytesWritten ) ) != eAzureIoTSuccess )
     {
-        LogError( ( "There was an error sending the reported properties: 0x%08x", xResult ) );
+        LogError( ( "There was an error queuing the reported properties: 0x%08x", xResult ) );
     }
+
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
 }
 /*-----------------------------------------------------------*/
 
@@ -209,8 +278,14 @@ static void prvReportTelemetryInterval( uint32_t ulVersion )
     AzureIoTResult_t xResult;
     AzureIoTJSONWriter_t xWriter;
     int32_t lBytesWritten;
+    uint8_t * pucPropertyPayloadBuffer;
+    ScratchArenaMark_t xScratchMark;
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucPropertyPayloadBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotgsgPROPERTY_BUFFER_SIZE );
+    configASSERT( pucPropertyPayloadBuffer != NULL );
 
-    xResult = AzureIoTJSONWriter_Init( &xWriter, ucPropertyPayloadBuffer, sizeof( ucPropertyPayloadBuffer ) );
+    xResult = AzureIoTJSONWriter_Init( &xWriter, pucPropertyPayloadBuffer, sampleazureiotgsgPROPERTY_BUFFER_SIZE );
     configASSERT( xResult == eAzureIoTSuccess );
 
     xResult = AzureIoTJSONWriter_AppendBeginObject( &xWriter );
@@ -244,14 +319,16 @@ static void prvReportTelemetryInterval( uint32_t ulVersion )
     }
     else
     {
-        LogDebug( ( "Sending acknowledged writable property. Payload: %.*s", lBytesWritten, ucPropertyPayloadBuffer ) );
-        xResult = AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient, ucPropertyPayloadBuffer, lBytesWritten, NULL );
+        LogDebug( ( "Queuing acknowledged writable property. Payload: %.*s", lBytesWritten, pucPropertyPayloadBuffer ) );
+        xResult = HubReporter_MergePatch( &xReporter, pucPropertyPayloadBuffer, lBytesWritten );
 
         if( xResult != eAzureIoTSuccess )
         {
-            LogError( ( "There was an error sending the reported properties: 0x%08x", xResult ) );
+            LogError( ( "There was an error queuing the reported properties: 0x%08x", xResult ) );
         }
     }
+
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
 }
 /*-----------------------------------------------------------*/
 
@@ -260,9 +337,15 @@ static void prvReportDeviceInfo()
     AzureIoTResult_t xResult;
     AzureIoTJSONWriter_t xWriter;
     int32_t lBytesWritten;
+    uint8_t * pucPropertyPayloadBuffer;
+    ScratchArenaMark_t xScratchMark;
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucPropertyPayloadBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotgsgPROPERTY_BUFFER_SIZE );
+    configASSERT( pucPropertyPayloadBuffer != NULL );
 
     /* Update reported property */
-    xResult = AzureIoTJSONWriter_Init( &xWriter, ucPropertyPayloadBuffer, sizeof( ucPropertyPayloadBuffer ) );
+    xResult = AzureIoTJSONWriter_Init( &xWriter, pucPropertyPayloadBuffer, sampleazureiotgsgPROPERTY_BUFFER_SIZE );
     configASSERT( xResult == eAzureIoTSuccess );
 
     xResult = AzureIoTJSONWriter_AppendBeginObject( &xWriter );
@@ -314,15 +397,13 @@ static void prvReportDeviceInfo()
     if( lBytesWritten < 0 )
     {
         LogError( ( "Error getting the bytes written for the device properties JSON" ) );
-        return;
     }
-
-    xResult = AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient, ucPropertyPayloadBuffer, lBytesWritten, NULL );
-
-    if( xResult != eAzureIoTSuccess )
+    else if( ( xResult = HubReporter_MergePatch( &xReporter, pucPropertyPayloadBuffer, lBytesWritten ) ) != eAzureIoTSuccess )
     {
-        LogError( ( "There was an error sending the device properties: 0x%08x", xResult ) );
+        LogError( ( "There was an error queuing the device properties: 0x%08x", xResult ) );
     }
+
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
 }
 
 static void prvInvokeSetLedStateCommand( const void * pvMessagePayload,
@@ -444,6 +525,8 @@ static AzureIoTResult_t prvProcessProperties( AzureIoTHubClientPropertiesRespons
 
                 /* Update the property and report back */
                 lTelemetryInterval = lNewTelemetryInterval;
+                RateController_SetNominal( &xRateController,
+                                           ( lTelemetryInterval > 0 ) ? ( uint32_t ) lTelemetryInterval * 1000U : 0U );
                 prvReportTelemetryInterval( ulVersion );
 
                 LogInfo( ( "TelemetryInterval Property received: %d.", lTelemetryInterval ) );
@@ -514,6 +597,7 @@ static void prvHandleProperties( AzureIoTHubClientPropertiesResponse_t * pxMessa
 
         case eAzureIoTHubPropertiesReportedResponseMessage:
             LogInfo( ( "Device reported property response received" ) );
+            HubReporter_HandleResponse( &xReporter, pxMessage );
 
             break;
 
@@ -523,6 +607,94 @@ static void prvHandleProperties( AzureIoTHubClientPropertiesResponse_t * pxMessa
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Telemetry PUBACK callback, a latency sample of the link.
+ */
+static void prvHandleTelemetryAck( uint16_t usPacketID )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < sampleazureiotgsgTELEMETRY_MAX_IN_FLIGHT; ulIndex++ )
+    {
+        if( xTelemetryInFlight[ ulIndex ].usPacketID == usPacketID )
+        {
+            RateController_RecordPublish( &xRateController,
+                                          ( xTaskGetTickCount() - xTelemetryInFlight[ ulIndex ].xSentTicks ) * portTICK_PERIOD_MS,
+                                          true );
+            xTelemetryInFlight[ ulIndex ].usPacketID = 0;
+            break;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reported properties response callback, a latency sample of the link.
+ */
+static void prvHandleReportedResponse( uint32_t ulRequestID,
+                                       uint32_t ulLatencyMs,
+                                       bool xAnswered,
+                                       void * pvContext )
+{
+    ( void ) ulRequestID;
+    ( void ) pvContext;
+
+    RateController_RecordPublish( &xRateController, ulLatencyMs, xAnswered );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Track a sent telemetry message until its PUBACK. Untracked if every
+ * slot is taken, which the controller already treats as congestion.
+ */
+static void prvTrackTelemetry( uint16_t usPacketID )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ( usPacketID != 0 ) && ( ulIndex < sampleazureiotgsgTELEMETRY_MAX_IN_FLIGHT ); ulIndex++ )
+    {
+        if( xTelemetryInFlight[ ulIndex ].usPacketID == 0 )
+        {
+            xTelemetryInFlight[ ulIndex ].usPacketID = usPacketID;
+            xTelemetryInFlight[ ulIndex ].xSentTicks = xTaskGetTickCount();
+            break;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Number of telemetry messages awaiting their PUBACK, giving up on the
+ * overdue ones as failed publishes.
+ */
+static uint32_t prvTelemetryInFlight( void )
+{
+    uint32_t ulIndex;
+    uint32_t ulInFlight = 0;
+
+    for( ulIndex = 0; ulIndex < sampleazureiotgsgTELEMETRY_MAX_IN_FLIGHT; ulIndex++ )
+    {
+        if( xTelemetryInFlight[ ulIndex ].usPacketID == 0 )
+        {
+            continue;
+        }
+
+        if( ( xTaskGetTickCount() - xTelemetryInFlight[ ulIndex ].xSentTicks ) >= pdMS_TO_TICKS( sampleazureiotgsgPUBACK_TIMEOUT_MS ) )
+        {
+            LogWarn( ( "No PUBACK for telemetry packet id %u", xTelemetryInFlight[ ulIndex ].usPacketID ) );
+            RateController_RecordPublish( &xRateController, sampleazureiotgsgPUBACK_TIMEOUT_MS, false );
+            xTelemetryInFlight[ ulIndex ].usPacketID = 0;
+        }
+        else
+        {
+            ulInFlight++;
+        }
+    }
+
+    return ulInFlight;
+}
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Setup transport credentials.
  */
@@ -630,6 +802,8 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
         uint32_t ulSamplepIothubDeviceIdLength = sizeof( ucSampleIotHubDeviceId );
         uint32_t ulStatus;
         int32_t lBytesWritten;
+        uint8_t * pucPayloadBuffer;
+        ScratchArenaMark_t xScratchMark;
 
         /* Set the pParams member of the network context with desired transport. */
         xNetworkContext.pParams = &xTlsTransportParams;
@@ -663,8 +837,12 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
             configASSERT( xResult == eAzureIoTSuccess );
         #endif /* democonfigDEVICE_SYMMETRIC_KEY */
 
-        /* Create the DPS payload */
-        xResult = AzureIoTJSONWriter_Init( &xWriter, ( uint8_t * ) &ucScratchBuffer, sizeof( ucScratchBuffer ) - 1 );
+        /* Create the DPS payload, kept by the client until the registration ends */
+        xScratchMark = ScratchArena_Mark( &xScratchArena );
+        pucPayloadBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotgsgSCRATCH_BUFFER_SIZE );
+        configASSERT( pucPayloadBuffer != NULL );
+
+        xResult = AzureIoTJSONWriter_Init( &xWriter, pucPayloadBuffer, sampleazureiotgsgSCRATCH_BUFFER_SIZE - 1 );
         configASSERT( xResult == eAzureIoTSuccess );
 
         xResult = AzureIoTJSONWriter_AppendBeginObject( &xWriter );
@@ -683,7 +861,7 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
         configASSERT( lBytesWritten > 0 );
 
         xResult = AzureIoTProvisioningClient_SetRegistrationPayload( &xAzureIoTProvisioningClient,
-                                                                     ( const uint8_t * ) ucScratchBuffer,
+                                                                     pucPayloadBuffer,
                                                                      lBytesWritten );
         configASSERT( xResult == eAzureIoTSuccess );
 
@@ -711,6 +889,7 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
         configASSERT( xResult == eAzureIoTSuccess );
 
         AzureIoTProvisioningClient_Deinit( &xAzureIoTProvisioningClient );
+        ScratchArena_Reset( &xScratchArena, xScratchMark );
 
         /* Close the network connection.  */
         TLS_Socket_Disconnect( &xNetworkContext );
@@ -736,6 +915,8 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
 static void prvAzureDemoTask( void * pvParameters )
 {
     uint32_t ulScratchBufferLength = 0U;
+    uint8_t * pucScratchBuffer;
+    ScratchArenaMark_t xScratchMark;
     NetworkCredentials_t xNetworkCredentials = { 0 };
     AzureIoTTransportInterface_t xTransport;
     NetworkContext_t xNetworkContext = { 0 };
@@ -743,8 +924,14 @@ static void prvAzureDemoTask( void * pvParameters )
     AzureIoTResult_t xResult;
     uint32_t ulStatus;
     AzureIoTHubClientOptions_t xHubOptions = { 0 };
+    HubSubscriptions_t xSubscriptions = { 0 };
     bool xSessionPresent;
-    uint64_t lastTelemetryTime;
+    RateControllerConfig_t xRateConfig = { 0 };
+    RateDecision_t xRateDecision;
+    bool xRateConfigValid;
+    TickType_t xLastTelemetryTicks;
+    uint32_t ulTelemetryIntervalMs;
+    uint16_t usPacketID;
 
     #ifdef democonfigENABLE_DPS_SAMPLE
         uint8_t * pucIotHubHostname = NULL;
@@ -766,6 +953,8 @@ static void prvAzureDemoTask( void * pvParameters )
     ulStatus = prvSetupNetworkCredentials( &xNetworkCredentials );
     configASSERT( ulStatus == 0 );
 
+    ScratchArena_Init( &xScratchArena, ucScratchArenaBuffer, sizeof( ucScratchArenaBuffer ) );
+
     #ifdef democonfigENABLE_DPS_SAMPLE
         /* Run DPS.  */
         if( ( ulStatus = prvIoTHubInfoGet( &xNetworkCredentials, &pucIotHubHostname,
@@ -803,6 +992,7 @@ static void prvAzureDemoTask( void * pvParameters )
     xHubOptions.ulModuleIDLength = sizeof( democonfigMODULE_ID ) - 1;
     xHubOptions.pucModelID = ( const uint8_t * ) pcModelId;
     xHubOptions.ulModelIDLength = strlen( pcModelId );
+    xHubOptions.xTelemetryCallback = prvHandleTelemetryAck;
 
     xResult = AzureIoTHubClient_Init( &xAzureIoTHubClient,
                                       pucIotHubHostname, pulIothubHostnameLength,
@@ -813,6 +1003,22 @@ static void prvAzureDemoTask( void * pvParameters )
                                       &xTransport );
     configASSERT( xResult == eAzureIoTSuccess );
 
+    xResult = HubReporter_Init( &xReporter, &xAzureIoTHubClient,
+                                ucReportedPatchBuffer, sizeof( ucReportedPatchBuffer ),
+                                sampleazureiotgsgREPORTED_PROPERTIES_WINDOW_MS );
+    configASSERT( xResult == eAzureIoTSuccess );
+    HubReporter_SetResponseCallback( &xReporter, prvHandleReportedResponse, NULL );
+
+    xRateConfig.ulNominalIntervalMs = ( uint32_t ) lTelemetryInterval * 1000U;
+    xRateConfig.ulMinIntervalMs = sampleazureiotgsgRATE_MIN_INTERVAL_MS;
+    xRateConfig.ulMaxIntervalMs = sampleazureiotgsgRATE_MAX_INTERVAL_MS;
+    xRateConfig.ulTargetLatencyMs = sampleazureiotgsgRATE_TARGET_LATENCY_MS;
+    xRateConfig.ulMaxQueueDepth = sampleazureiotgsgTELEMETRY_MAX_IN_FLIGHT;
+    xRateConfig.ulRecoverStepMs = sampleazureiotgsgRATE_RECOVER_STEP_MS;
+    xRateConfigValid = RateController_Init( &xRateController, &xRateConfig );
+    configASSERT( xRateConfigValid );
+    ulTelemetryIntervalMs = xRateController.ulIntervalMs;
+
     #ifdef democonfigDEVICE_SYMMETRIC_KEY
         xResult = AzureIoTHubClient_SetSymmetricKey( &xAzureIoTHubClient,
                                                      ( const uint8_t * ) democonfigDEVICE_SYMMETRIC_KEY,
@@ -830,21 +1036,21 @@ static void prvAzureDemoTask( void * pvParameters )
                                          sampleazureiotgsgCONNACK_RECV_TIMEOUT_MS );
     configASSERT( xResult == eAzureIoTSuccess );
 
-    xResult = AzureIoTHubClient_SubscribeCommand( &xAzureIoTHubClient, prvHandleCommand,
-                                                  &xAzureIoTHubClient, sampleazureiotgsgSUBSCRIBE_TIMEOUT );
-    configASSERT( xResult == eAzureIoTSuccess );
+    xSubscriptions.xCommandCallback = prvHandleCommand;
+    xSubscriptions.xPropertiesCallback = prvHandleProperties;
+    xSubscriptions.pvCallbackContext = &xAzureIoTHubClient;
+    xSubscriptions.ulSubscribeTimeoutMs = sampleazureiotgsgSUBSCRIBE_TIMEOUT;
 
-    xResult = AzureIoTHubClient_SubscribeProperties( &xAzureIoTHubClient, prvHandleProperties,
-                                                     &xAzureIoTHubClient, sampleazureiotgsgSUBSCRIBE_TIMEOUT );
+    xResult = HubSubscribe_All( &xAzureIoTHubClient, &xSubscriptions, NULL );
     configASSERT( xResult == eAzureIoTSuccess );
 
     /* Get property document after initial connection */
     xResult = AzureIoTHubClient_RequestPropertiesAsync( &xAzureIoTHubClient );
     configASSERT( xResult == eAzureIoTSuccess );
 
-    lastTelemetryTime = ullGetUnixTime();
+    xLastTelemetryTicks = xTaskGetTickCount();
 
-    /* Report properties */
+    /* Report properties, merged by the reporter into a single patch */
     prvReportLedState();
     prvReportTelemetryInterval( 0 );
     prvReportDeviceInfo();
@@ -852,24 +1058,41 @@ static void prvAzureDemoTask( void * pvParameters )
     /* Loop forever */
     while( true )
     {
-        uint64_t currentTime = ullGetUnixTime();
-
-        if( currentTime > ( lastTelemetryTime + lTelemetryInterval ) )
+        if( ( xTaskGetTickCount() - xLastTelemetryTicks ) >= pdMS_TO_TICKS( ulTelemetryIntervalMs ) )
         {
-            /* Advance the time */
-            while( currentTime > ( lastTelemetryTime + lTelemetryInterval ) )
-            {
-                lastTelemetryTime += lTelemetryInterval;
-            }
+            xLastTelemetryTicks = xTaskGetTickCount();
+
+            xScratchMark = ScratchArena_Mark( &xScratchArena );
+            pucScratchBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotgsgSCRATCH_BUFFER_SIZE );
+            configASSERT( pucScratchBuffer != NULL );
 
-            ulScratchBufferLength = ulCreateTelemetry( ucScratchBuffer, sizeof( ucScratchBuffer ) - 1 );
+            ulScratchBufferLength = ulCreateTelemetry( pucScratchBuffer, sampleazureiotgsgSCRATCH_BUFFER_SIZE - 1 );
 
             xResult = AzureIoTHubClient_SendTelemetry( &xAzureIoTHubClient,
-                                                       ucScratchBuffer, ulScratchBufferLength,
-                                                       NULL, eAzureIoTHubMessageQoS1, NULL );
+                                                       pucScratchBuffer, ulScratchBufferLength,
+                                                       NULL, eAzureIoTHubMessageQoS1, &usPacketID );
             configASSERT( xResult == eAzureIoTSuccess );
+            ScratchArena_Reset( &xScratchArena, xScratchMark );
+            prvTrackTelemetry( usPacketID );
+
+            /* Lengthen the interval while the PUBACKs and the reported
+             * properties responses are slow, or the PUBACKs pile up. */
+            ulTelemetryIntervalMs = RateController_Update( &xRateController, prvTelemetryInFlight(), 0, &xRateDecision );
+
+            if( xRateDecision.xReason != eRateHold )
+            {
+                LogInfo( ( "Telemetry interval %u ms (%s), latency %u ms, %u PUBACKs awaited",
+                           ( unsigned ) xRateDecision.ulIntervalMs,
+                           RateController_ReasonName( xRateDecision.xReason ),
+                           ( unsigned ) xRateDecision.ulLatencyMs,
+                           ( unsigned ) xRateDecision.ulQueueDepth ) );
+            }
         }
 
+        /* Send reported properties whose window has passed */
+        xResult = HubReporter_Process( &xReporter );
+        configASSERT( xResult == eAzureIoTSuccess );
+
         /* :TODO: the processloop runs for 10 seconds */
         xResult = AzureIoTHubClient_ProcessLoop( &xAzureIoTHubClient, 0 );
 
@@ -0,0 +1,287 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file load_config.c
+ * @brief Device identities and telemetry profiles of the load generator.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+
+#ifndef LIBRARY_LOG_NAME
+    #define LIBRARY_LOG_NAME    "LoadConfig"
+#endif
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+#include "load_config.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Fixed part of a generated payload, padded to the profile size.
+ */
+#define loadconfigPAYLOAD_FORMAT    "{\"profile\":\"%s\",\"pad\":\""
+#define loadconfigPAYLOAD_END       "\"}"
+
+/**
+ * @brief Built in profiles, the first one is the default.
+ */
+static LoadProfile_t xProfiles[] =
+{
+    /* Name,    size, interval, burst */
+    { "small",  64,   5000,     1,  NULL },
+    { "medium", 512,  1000,     1,  NULL },
+    { "burst",  128,  10000,    10, NULL },
+    { "idle",   32,   60000,    1,  NULL }
+};
+
+#define loadconfigPROFILE_COUNT    ( sizeof( xProfiles ) / sizeof( xProfiles[ 0 ] ) )
+/*-----------------------------------------------------------*/
+
+const LoadProfile_t * LoadConfig_FindProfile( const char * pcName,
+                                              uint32_t ulNameLength )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < loadconfigPROFILE_COUNT; ulIndex++ )
+    {
+        if( ( strlen( xProfiles[ ulIndex ].pcName ) == ulNameLength ) &&
+            ( strncmp( xProfiles[ ulIndex ].pcName, pcName, ulNameLength ) == 0 ) )
+        {
+            return &xProfiles[ ulIndex ];
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+bool LoadConfig_BuildPayloads( void )
+{
+    LoadProfile_t * pxProfile;
+    uint8_t * pucPayload;
+    uint32_t ulIndex;
+    int lLength;
+
+    for( ulIndex = 0; ulIndex < loadconfigPROFILE_COUNT; ulIndex++ )
+    {
+        pxProfile = &xProfiles[ ulIndex ];
+
+        if( pxProfile->pucPayload != NULL )
+        {
+            continue;
+        }
+
+        pucPayload = pvPortMalloc( pxProfile->ulPayloadSize + 1 );
+
+        if( pucPayload == NULL )
+        {
+            return false;
+        }
+
+        lLength = snprintf( ( char * ) pucPayload, pxProfile->ulPayloadSize + 1,
+                            loadconfigPAYLOAD_FORMAT, pxProfile->pcName );
+        configASSERT( ( lLength > 0 ) &&
+                      ( ( uint32_t ) lLength + sizeof( loadconfigPAYLOAD_END ) - 1 <= pxProfile->ulPayloadSize ) );
+
+        memset( &pucPayload[ lLength ], 'x',
+                pxProfile->ulPayloadSize - ( uint32_t ) lLength - ( sizeof( loadconfigPAYLOAD_END ) - 1 ) );
+        memcpy( &pucPayload[ pxProfile->ulPayloadSize - ( sizeof( loadconfigPAYLOAD_END ) - 1 ) ],
+                loadconfigPAYLOAD_END, sizeof( loadconfigPAYLOAD_END ) );
+
+        pxProfile->pucPayload = pucPayload;
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t LoadConfig_MaxPayloadSize( void )
+{
+    uint32_t ulMax = 0;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < loadconfigPROFILE_COUNT; ulIndex++ )
+    {
+        if( xProfiles[ ulIndex ].ulPayloadSize > ulMax )
+        {
+            ulMax = xProfiles[ ulIndex ].ulPayloadSize;
+        }
+    }
+
+    return ulMax;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Split a line into at most ulMaxFields comma separated fields,
+ * trimming the line ending.
+ *
+ * @return Number of fields.
+ */
+static uint32_t prvSplitLine( char * pcLine,
+                              char ** ppcFields,
+                              uint32_t * pulLengths,
+                              uint32_t ulMaxFields )
+{
+    uint32_t ulCount = 0;
+    char * pcEnd;
+
+    pcLine[ strcspn( pcLine, "\r\n" ) ] = '\0';
+
+    while( ulCount < ulMaxFields )
+    {
+        pcEnd = strchr( pcLine, ',' );
+        ppcFields[ ulCount ] = pcLine;
+        pulLengths[ ulCount ] = ( pcEnd == NULL ) ? ( uint32_t ) strlen( pcLine ) : ( uint32_t ) ( pcEnd - pcLine );
+        ulCount++;
+
+        if( pcEnd == NULL )
+        {
+            break;
+        }
+
+        pcLine = pcEnd + 1;
+    }
+
+    return ulCount;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Make the identity described by one line of the credentials file.
+ *
+ * @return The identity, or NULL if the line is skipped.
+ */
+static LoadCredentials_t * prvParseLine( char * pcLine,
+                                         uint32_t ulLineNumber,
+                                         const LoadProfile_t * pxDefaultProfile )
+{
+    char * pcFields[ 4 ];
+    uint32_t ulLengths[ 4 ];
+    uint32_t ulFieldCount;
+    const LoadProfile_t * pxProfile = pxDefaultProfile;
+    LoadCredentials_t * pxCredentials;
+    char * pcStrings;
+
+    if( ( pcLine[ 0 ] == '#' ) || ( pcLine[ strspn( pcLine, " \t\r\n" ) ] == '\0' ) )
+    {
+        return NULL;
+    }
+
+    ulFieldCount = prvSplitLine( pcLine, pcFields, ulLengths, 4 );
+
+    if( ( ulFieldCount < 3 ) || ( ulLengths[ 0 ] == 0 ) || ( ulLengths[ 1 ] == 0 ) || ( ulLengths[ 2 ] == 0 ) )
+    {
+        LogWarn( ( "Credentials line %u is malformed, skipped", ( unsigned ) ulLineNumber ) );
+        return NULL;
+    }
+
+    if( ( ulFieldCount == 4 ) && ( ulLengths[ 3 ] > 0 ) &&
+        ( ( pxProfile = LoadConfig_FindProfile( pcFields[ 3 ], ulLengths[ 3 ] ) ) == NULL ) )
+    {
+        LogWarn( ( "Credentials line %u names unknown profile %.*s, skipped",
+                   ( unsigned ) ulLineNumber, ( int ) ulLengths[ 3 ], pcFields[ 3 ] ) );
+        return NULL;
+    }
+
+    /* One allocation for the identity and its three NUL terminated strings. */
+    pxCredentials = pvPortMalloc( sizeof( LoadCredentials_t ) + ulLengths[ 0 ] + ulLengths[ 1 ] + ulLengths[ 2 ] + 3 );
+
+    if( pxCredentials == NULL )
+    {
+        return NULL;
+    }
+
+    pcStrings = ( char * ) ( pxCredentials + 1 );
+
+    pxCredentials->pcHostname = pcStrings;
+    pxCredentials->ulHostnameLength = ulLengths[ 0 ];
+    memcpy( pcStrings, pcFields[ 0 ], ulLengths[ 0 ] );
+    pcStrings[ ulLengths[ 0 ] ] = '\0';
+    pcStrings += ulLengths[ 0 ] + 1;
+
+    pxCredentials->pcDeviceId = pcStrings;
+    pxCredentials->ulDeviceIdLength = ulLengths[ 1 ];
+    memcpy( pcStrings, pcFields[ 1 ], ulLengths[ 1 ] );
+    pcStrings[ ulLengths[ 1 ] ] = '\0';
+    pcStrings += ulLengths[ 1 ] + 1;
+
+    pxCredentials->pcSymmetricKey = pcStrings;
+    pxCredentials->ulSymmetricKeyLength = ulLengths[ 2 ];
+    memcpy( pcStrings, pcFields[ 2 ], ulLengths[ 2 ] );
+    pcStrings[ ulLengths[ 2 ] ] = '\0';
+
+    pxCredentials->pxProfile = pxProfile;
+
+    return pxCredentials;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t LoadConfig_ReadCredentials( const char * pcPath,
+                                     const LoadProfile_t * pxDefaultProfile,
+                                     LoadCredentials_t *** ppxCredentials,
+                                     uint32_t ulMaxDevices )
+{
+    static char cLine[ LOAD_CONFIG_MAX_LINE_LENGTH ];
+    LoadCredentials_t ** ppxArray;
+    LoadCredentials_t * pxCredentials;
+    uint32_t ulLineNumber = 0;
+    uint32_t ulLines = 0;
+    uint32_t ulCount = 0;
+    FILE * pxFile;
+
+    *ppxCredentials = NULL;
+
+    if( ( pxFile = fopen( pcPath, "r" ) ) == NULL )
+    {
+        LogError( ( "Cannot open credentials file %s", pcPath ) );
+        return 0;
+    }
+
+    /* Size the array from the number of lines, so it needs no reallocation. */
+    while( fgets( cLine, sizeof( cLine ), pxFile ) != NULL )
+    {
+        ulLines++;
+    }
+
+    ulLines = ( ulLines < ulMaxDevices ) ? ulLines : ulMaxDevices;
+
+    if( ( ulLines == 0 ) || ( ( ppxArray = pvPortMalloc( ulLines * sizeof( LoadCredentials_t * ) ) ) == NULL ) )
+    {
+        fclose( pxFile );
+        return 0;
+    }
+
+    rewind( pxFile );
+
+    while( ( ulCount < ulLines ) && ( fgets( cLine, sizeof( cLine ), pxFile ) != NULL ) )
+    {
+        ulLineNumber++;
+
+        if( ( pxCredentials = prvParseLine( cLine, ulLineNumber, pxDefaultProfile ) ) != NULL )
+        {
+            ppxArray[ ulCount++ ] = pxCredentials;
+        }
+    }
+
+    fclose( pxFile );
+
+    if( ulCount == 0 )
+    {
+        vPortFree( ppxArray );
+        ppxArray = NULL;
+    }
+
+    *ppxCredentials = ppxArray;
+
+    return ulCount;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,95 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file load_config.h
+ * @brief Device identities and telemetry profiles of the load generator.
+ *
+ * Identities are read from a text file with one device per line:
+ *
+ *     <hostname>,<device id>,<symmetric key>[,<profile>]
+ *
+ * Empty lines and lines starting with '#' are skipped. Without a profile
+ * column the default profile is used.
+ */
+
+#ifndef LOAD_CONFIG_H
+#define LOAD_CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Longest line accepted in the credentials file.
+ */
+#ifndef LOAD_CONFIG_MAX_LINE_LENGTH
+    #define LOAD_CONFIG_MAX_LINE_LENGTH    ( 512U )
+#endif
+
+/**
+ * @brief Telemetry sent by a simulated device.
+ */
+typedef struct LoadProfile
+{
+    const char * pcName;
+    uint32_t ulPayloadSize;   /**< @brief Bytes per message. */
+    uint32_t ulIntervalMs;    /**< @brief Time between bursts. */
+    uint32_t ulBurst;         /**< @brief Messages sent back to back per interval. */
+    const uint8_t * pucPayload; /**< @brief Payload shared by every device of the profile, see #LoadConfig_BuildPayloads. */
+} LoadProfile_t;
+
+/**
+ * @brief Identity of one simulated device.
+ *
+ * The strings are stored in the same allocation as the structure.
+ */
+typedef struct LoadCredentials
+{
+    const char * pcHostname;
+    uint32_t ulHostnameLength;
+    const char * pcDeviceId;
+    uint32_t ulDeviceIdLength;
+    const char * pcSymmetricKey;
+    uint32_t ulSymmetricKeyLength;
+    const LoadProfile_t * pxProfile;
+} LoadCredentials_t;
+
+/**
+ * @brief Find a profile by name.
+ *
+ * @param[in] pcName Profile name.
+ * @param[in] ulNameLength Length of @p pcName.
+ * @return The profile, or NULL if there is none with that name.
+ */
+const LoadProfile_t * LoadConfig_FindProfile( const char * pcName,
+                                              uint32_t ulNameLength );
+
+/**
+ * @brief Generate the shared JSON payload of every profile.
+ *
+ * @return true on success, false if out of memory.
+ */
+bool LoadConfig_BuildPayloads( void );
+
+/**
+ * @brief Largest payload of all profiles.
+ */
+uint32_t LoadConfig_MaxPayloadSize( void );
+
+/**
+ * @brief Read device identities from a credentials file.
+ *
+ * Malformed lines and lines naming an unknown profile are logged and skipped.
+ *
+ * @param[in] pcPath Path of the credentials file.
+ * @param[in] pxDefaultProfile Profile of lines without a profile column.
+ * @param[out] ppxCredentials Array of identities, allocated with pvPortMalloc.
+ * @param[in] ulMaxDevices Stop after this many identities.
+ * @return Number of identities read, 0 if the file could not be read.
+ */
+uint32_t LoadConfig_ReadCredentials( const char * pcPath,
+                                     const LoadProfile_t * pxDefaultProfile,
+                                     LoadCredentials_t *** ppxCredentials,
+                                     uint32_t ulMaxDevices );
+
+#endif /* LOAD_CONFIG_H */
@@ -0,0 +1,616 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file sample_azure_iot_load.c
+ * @brief Load generator simulating many devices from one process.
+ *
+ * Every identity of the credentials file gets its own task, hub client, TLS
+ * connection and MQTT buffer. Devices are started at a fixed rate and wait a
+ * random jitter before their first connect, then publish telemetry as given
+ * by their profile, reconnecting with backoff whenever the connection drops.
+ * The devices do not subscribe to any feature, which keeps the per device
+ * memory down to the hub client, the MQTT buffer and the TLS context.
+ *
+ * A controller task starts the devices and periodically logs the aggregate
+ * connect latency percentiles, message rates and failure counts.
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Demo Specific configs. */
+#include "demo_config.h"
+
+/* Azure IoT Hub library includes */
+#include "azure_iot_hub_client.h"
+
+/* Exponential backoff retry include. */
+#include "backoff_algorithm.h"
+
+/* Transport interface implementation include header for TLS. */
+#include "transport_tls_socket.h"
+
+#ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+    /* Network impairment header. */
+    #include "transport_impairment.h"
+#endif
+
+/* Crypto helper header. */
+#include "crypto.h"
+
+/* Monotonic clock header. */
+#include "clock_service.h"
+
+/* Latency histogram header. */
+#include "latency_histogram.h"
+
+#include "load_config.h"
+
+/*-----------------------------------------------------------*/
+
+/* Compile time error for undefined configs. */
+#ifndef democonfigROOT_CA_PEM
+    #error "Please define Root CA certificate of the IoT Hub(democonfigROOT_CA_PEM) in demo_config.h."
+#endif
+
+/**
+ * @brief File with one device identity per line, see load_config.h.
+ */
+#ifndef democonfigLOAD_CREDENTIALS_FILE
+    #define democonfigLOAD_CREDENTIALS_FILE            "load_devices.csv"
+#endif
+
+/**
+ * @brief Profile of devices without a profile column.
+ */
+#ifndef democonfigLOAD_DEFAULT_PROFILE
+    #define democonfigLOAD_DEFAULT_PROFILE             "small"
+#endif
+
+/**
+ * @brief Upper bound on the number of simulated devices.
+ */
+#ifndef democonfigLOAD_MAX_DEVICES
+    #define democonfigLOAD_MAX_DEVICES                 ( 1000U )
+#endif
+
+/**
+ * @brief Devices started per second.
+ */
+#ifndef democonfigLOAD_RAMP_UP_PER_SECOND
+    #define democonfigLOAD_RAMP_UP_PER_SECOND          ( 10U )
+#endif
+
+/**
+ * @brief Largest random delay of a device before its first connect.
+ */
+#ifndef democonfigLOAD_CONNECT_JITTER_MS
+    #define democonfigLOAD_CONNECT_JITTER_MS           ( 2000U )
+#endif
+
+/**
+ * @brief Interval of the metrics report.
+ */
+#ifndef democonfigLOAD_REPORT_INTERVAL_MS
+    #define democonfigLOAD_REPORT_INTERVAL_MS          ( 10 * 1000U )
+#endif
+
+/**
+ * @brief MQTT buffer of each device, sized for the largest profile payload
+ * plus the telemetry topic.
+ */
+#ifndef democonfigLOAD_NETWORK_BUFFER_SIZE
+    #define democonfigLOAD_NETWORK_BUFFER_SIZE         ( 1024U )
+#endif
+
+/**
+ * @brief Stack of each device task, in words.
+ */
+#ifndef democonfigLOAD_DEVICE_STACKSIZE
+    #define democonfigLOAD_DEVICE_STACKSIZE            democonfigDEMO_STACKSIZE
+#endif
+
+/**
+ * @brief Seed of the network impairment of the first device, the next
+ * devices use the following values.
+ */
+#ifndef democonfigNETWORK_IMPAIRMENT_SEED
+    #define democonfigNETWORK_IMPAIRMENT_SEED          ( 1U )
+#endif
+
+/**
+ * @brief Room in the MQTT buffer needed besides the payload.
+ */
+#define sampleloadTOPIC_OVERHEAD                       ( 256U )
+
+/**
+ * @brief Backoff between connection attempts of a device.
+ */
+#define sampleloadRETRY_BACKOFF_BASE_MS                ( 1000U )
+#define sampleloadRETRY_MAX_BACKOFF_DELAY_MS           ( 30 * 1000U )
+
+/**
+ * @brief Timeout for receiving CONNACK packet in milliseconds.
+ */
+#define sampleloadCONNACK_RECV_TIMEOUT_MS              ( 10 * 1000U )
+
+/**
+ * @brief Transport timeout in milliseconds for transport send and receive.
+ */
+#define sampleloadTRANSPORT_SEND_RECV_TIMEOUT_MS       ( 2000U )
+
+/**
+ * @brief Transport timeout for receive, short behind the network impairment
+ * so it does not hold back the bytes it delays.
+ */
+#ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+    #define sampleloadTRANSPORT_RECV_TIMEOUT_MS        impairmentPOLL_INTERVAL_MS
+#else
+    #define sampleloadTRANSPORT_RECV_TIMEOUT_MS        sampleloadTRANSPORT_SEND_RECV_TIMEOUT_MS
+#endif
+
+/**
+ * @brief Longest wait in the process loop between publishes.
+ */
+#define sampleloadPROCESS_LOOP_TIMEOUT_MS              ( 500U )
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Unix time.
+ *
+ * @return Time in seconds.
+ */
+uint64_t ullGetUnixTime( void );
+/*-----------------------------------------------------------*/
+
+/* Each compilation unit must define the NetworkContext struct. */
+struct NetworkContext
+{
+    TlsTransportParams_t * pParams;
+};
+
+/**
+ * @brief State of one simulated device, allocated together with its MQTT buffer.
+ */
+typedef struct LoadDevice
+{
+    const LoadCredentials_t * pxCredentials;
+    AzureIoTHubClient_t xHubClient;
+    NetworkContext_t xNetworkContext;
+    TlsTransportParams_t xTlsTransportParams;
+    AzureIoTTransportInterface_t xTransport;
+    #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+        ImpairedTransport_t xImpairedTransport;
+    #endif
+    uint8_t ucMQTTMessageBuffer[];
+} LoadDevice_t;
+
+/**
+ * @brief Counters of all devices, updated in critical sections.
+ */
+typedef struct LoadMetrics
+{
+    uint32_t ulDevicesStarted;
+    uint32_t ulDevicesConnected;
+    uint32_t ulConnectAttempts;
+    uint32_t ulConnectFailures;
+    uint32_t ulDisconnects;
+    uint64_t ullSent;
+    uint64_t ullSendFailures;
+    uint64_t ullAcknowledged;
+} LoadMetrics_t;
+
+static NetworkCredentials_t xNetworkCredentials;
+static LoadMetrics_t xMetrics;
+
+/**
+ * @brief Latency of the successful connects, recorded by the devices and
+ * moved to #xConnectLatencyTotal by the controller.
+ */
+static LatencyHistogram_t xConnectLatency;
+static LatencyHistogram_t xConnectLatencyTotal;
+/*-----------------------------------------------------------*/
+
+static void prvRecordConnect( uint64_t ullLatencyUs,
+                              bool xConnected )
+{
+    if( xConnected )
+    {
+        LatencyHistogram_Record( &xConnectLatency, ullLatencyUs );
+    }
+
+    taskENTER_CRITICAL();
+    {
+        xMetrics.ulConnectAttempts++;
+
+        if( xConnected )
+        {
+            xMetrics.ulDevicesConnected++;
+        }
+        else
+        {
+            xMetrics.ulConnectFailures++;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecordDisconnect( void )
+{
+    taskENTER_CRITICAL();
+    {
+        xMetrics.ulDevicesConnected--;
+        xMetrics.ulDisconnects++;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecordSend( bool xSent )
+{
+    taskENTER_CRITICAL();
+    {
+        if( xSent )
+        {
+            xMetrics.ullSent++;
+        }
+        else
+        {
+            xMetrics.ullSendFailures++;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief PUBACK callback shared by every device. Only the total is kept,
+ * as the callback is not told which client it belongs to.
+ */
+static void prvHandleTelemetryAck( uint16_t usPacketID )
+{
+    ( void ) usPacketID;
+
+    taskENTER_CRITICAL();
+    {
+        xMetrics.ullAcknowledged++;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Open the TLS connection and the MQTT session of a device.
+ *
+ * @return true if the device is connected.
+ */
+static bool prvConnectDevice( LoadDevice_t * pxDevice )
+{
+    const LoadCredentials_t * pxCredentials = pxDevice->pxCredentials;
+    uint64_t ullStartUs = Clock_GetMonotonicUs();
+    bool xSessionPresent;
+    bool xConnected = false;
+
+    if( TLS_Socket_Connect( &pxDevice->xNetworkContext,
+                            pxCredentials->pcHostname, democonfigIOTHUB_PORT,
+                            &xNetworkCredentials,
+                            sampleloadTRANSPORT_RECV_TIMEOUT_MS,
+                            sampleloadTRANSPORT_SEND_RECV_TIMEOUT_MS ) != eTLSTransportSuccess )
+    {
+        LogDebug( ( "%s: TLS connect failed", pxCredentials->pcDeviceId ) );
+    }
+    else if( AzureIoTHubClient_Connect( &pxDevice->xHubClient, true, &xSessionPresent,
+                                        sampleloadCONNACK_RECV_TIMEOUT_MS ) != eAzureIoTSuccess )
+    {
+        LogDebug( ( "%s: MQTT connect failed", pxCredentials->pcDeviceId ) );
+        TLS_Socket_Disconnect( &pxDevice->xNetworkContext );
+    }
+    else
+    {
+        xConnected = true;
+    }
+
+    prvRecordConnect( Clock_GetMonotonicUs() - ullStartUs, xConnected );
+
+    return xConnected;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publish on the profile schedule until the connection fails.
+ */
+static void prvRunDevice( LoadDevice_t * pxDevice )
+{
+    const LoadProfile_t * pxProfile = pxDevice->pxCredentials->pxProfile;
+    uint64_t ullNextBurstMs = Clock_GetMonotonicMs();
+    uint64_t ullNowMs;
+    uint32_t ulTimeoutMs;
+    uint32_t ulIndex;
+
+    for( ; ; )
+    {
+        ullNowMs = Clock_GetMonotonicMs();
+
+        if( ullNowMs >= ullNextBurstMs )
+        {
+            for( ulIndex = 0; ulIndex < pxProfile->ulBurst; ulIndex++ )
+            {
+                if( AzureIoTHubClient_SendTelemetry( &pxDevice->xHubClient,
+                                                     pxProfile->pucPayload, pxProfile->ulPayloadSize,
+                                                     NULL, eAzureIoTHubMessageQoS1, NULL ) != eAzureIoTSuccess )
+                {
+                    prvRecordSend( false );
+                    return;
+                }
+
+                prvRecordSend( true );
+            }
+
+            ullNextBurstMs += pxProfile->ulIntervalMs;
+
+            /* Do not try to catch up after a stall. */
+            if( ullNextBurstMs < ullNowMs )
+            {
+                ullNextBurstMs = ullNowMs + pxProfile->ulIntervalMs;
+            }
+        }
+
+        ulTimeoutMs = ( uint32_t ) ( ullNextBurstMs - ullNowMs );
+        ulTimeoutMs = ( ulTimeoutMs < sampleloadPROCESS_LOOP_TIMEOUT_MS ) ? ulTimeoutMs : sampleloadPROCESS_LOOP_TIMEOUT_MS;
+
+        if( AzureIoTHubClient_ProcessLoop( &pxDevice->xHubClient, ulTimeoutMs ) != eAzureIoTSuccess )
+        {
+            return;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Task of one simulated device.
+ */
+static void prvLoadDeviceTask( void * pvParameters )
+{
+    LoadDevice_t * pxDevice = ( LoadDevice_t * ) pvParameters;
+    const LoadCredentials_t * pxCredentials = pxDevice->pxCredentials;
+    AzureIoTHubClientOptions_t xHubOptions = { 0 };
+    BackoffAlgorithmContext_t xReconnectParams;
+    uint16_t usNextRetryBackOff = 0U;
+    AzureIoTResult_t xResult;
+
+    pxDevice->xNetworkContext.pParams = &pxDevice->xTlsTransportParams;
+    pxDevice->xTransport.pxNetworkContext = &pxDevice->xNetworkContext;
+    pxDevice->xTransport.xSend = TLS_Socket_Send;
+    pxDevice->xTransport.xRecv = TLS_Socket_Recv;
+
+    #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+        /* Below TLS, the connect and the handshake cross the emulated link. */
+        pxDevice->xTlsTransportParams.pxInterposer = Impairment_GetInterposer( &pxDevice->xImpairedTransport );
+    #endif
+
+    xResult = AzureIoTHubClient_OptionsInit( &xHubOptions );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xHubOptions.xTelemetryCallback = prvHandleTelemetryAck;
+
+    xResult = AzureIoTHubClient_Init( &pxDevice->xHubClient,
+                                      ( const uint8_t * ) pxCredentials->pcHostname, pxCredentials->ulHostnameLength,
+                                      ( const uint8_t * ) pxCredentials->pcDeviceId, pxCredentials->ulDeviceIdLength,
+                                      &xHubOptions,
+                                      pxDevice->ucMQTTMessageBuffer, democonfigLOAD_NETWORK_BUFFER_SIZE,
+                                      ullGetUnixTime,
+                                      &pxDevice->xTransport );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    xResult = AzureIoTHubClient_SetSymmetricKey( &pxDevice->xHubClient,
+                                                 ( const uint8_t * ) pxCredentials->pcSymmetricKey,
+                                                 pxCredentials->ulSymmetricKeyLength,
+                                                 Crypto_HMAC );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    BackoffAlgorithm_InitializeParams( &xReconnectParams,
+                                       sampleloadRETRY_BACKOFF_BASE_MS,
+                                       sampleloadRETRY_MAX_BACKOFF_DELAY_MS,
+                                       BACKOFF_ALGORITHM_RETRY_FOREVER );
+
+    /* Spread the first connects of devices started in the same tick. */
+    vTaskDelay( pdMS_TO_TICKS( ( uint32_t ) configRAND32() % ( democonfigLOAD_CONNECT_JITTER_MS + 1U ) ) );
+
+    for( ; ; )
+    {
+        if( prvConnectDevice( pxDevice ) )
+        {
+            BackoffAlgorithm_InitializeParams( &xReconnectParams,
+                                               sampleloadRETRY_BACKOFF_BASE_MS,
+                                               sampleloadRETRY_MAX_BACKOFF_DELAY_MS,
+                                               BACKOFF_ALGORITHM_RETRY_FOREVER );
+
+            prvRunDevice( pxDevice );
+
+            LogDebug( ( "%s: connection lost", pxCredentials->pcDeviceId ) );
+            ( void ) AzureIoTHubClient_Disconnect( &pxDevice->xHubClient );
+            TLS_Socket_Disconnect( &pxDevice->xNetworkContext );
+            prvRecordDisconnect();
+        }
+
+        ( void ) BackoffAlgorithm_GetNextBackoff( &xReconnectParams, configRAND32(), &usNextRetryBackOff );
+        vTaskDelay( pdMS_TO_TICKS( usNextRetryBackOff ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Log the aggregate metrics of the last interval.
+ */
+static void prvReportMetrics( uint32_t ulIntervalMs )
+{
+    static uint64_t ullPreviousSent = 0;
+    static uint64_t ullPreviousAcknowledged = 0;
+    static LatencyHistogram_t xInterval;
+    LoadMetrics_t xSnapshot;
+
+    taskENTER_CRITICAL();
+    {
+        xSnapshot = xMetrics;
+    }
+    taskEXIT_CRITICAL();
+
+    LatencyHistogram_Snapshot( &xConnectLatency, &xInterval );
+    LatencyHistogram_Merge( &xConnectLatencyTotal, &xInterval );
+
+    LogInfo( ( "Devices %u/%u connected, connects %u (%u failed), disconnects %u",
+               ( unsigned ) xSnapshot.ulDevicesConnected, ( unsigned ) xSnapshot.ulDevicesStarted,
+               ( unsigned ) xSnapshot.ulConnectAttempts, ( unsigned ) xSnapshot.ulConnectFailures,
+               ( unsigned ) xSnapshot.ulDisconnects ) );
+    LogInfo( ( "Messages sent %llu (%u/s), acknowledged %llu (%u/s), send failures %llu",
+               ( unsigned long long ) xSnapshot.ullSent,
+               ( unsigned ) ( ( xSnapshot.ullSent - ullPreviousSent ) * 1000U / ulIntervalMs ),
+               ( unsigned long long ) xSnapshot.ullAcknowledged,
+               ( unsigned ) ( ( xSnapshot.ullAcknowledged - ullPreviousAcknowledged ) * 1000U / ulIntervalMs ),
+               ( unsigned long long ) xSnapshot.ullSendFailures ) );
+
+    if( LatencyHistogram_Count( &xConnectLatencyTotal ) > 0 )
+    {
+        LogInfo( ( "Connect latency ms p50 %u, p90 %u, p99 %u, max %u",
+                   ( unsigned ) ( LatencyHistogram_Percentile( &xConnectLatencyTotal, 50 ) / 1000U ),
+                   ( unsigned ) ( LatencyHistogram_Percentile( &xConnectLatencyTotal, 90 ) / 1000U ),
+                   ( unsigned ) ( LatencyHistogram_Percentile( &xConnectLatencyTotal, 99 ) / 1000U ),
+                   ( unsigned ) ( xConnectLatencyTotal.ulMaxUs / 1000U ) ) );
+    }
+
+    ullPreviousSent = xSnapshot.ullSent;
+    ullPreviousAcknowledged = xSnapshot.ullAcknowledged;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Start a device task for every identity, then report the metrics.
+ */
+static void prvLoadControllerTask( void * pvParameters )
+{
+    LoadCredentials_t ** ppxCredentials;
+    const LoadProfile_t * pxDefaultProfile;
+    LoadDevice_t * pxDevice;
+
+    #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+        const ImpairmentConfig_t * pxImpairment;
+    #endif
+    AzureIoTResult_t xResult;
+    bool xPayloadsBuilt;
+    TickType_t xLastReport;
+    TickType_t xNow;
+    uint32_t ulDeviceCount;
+    uint32_t ulIndex;
+
+    ( void ) pvParameters;
+
+    xResult = AzureIoT_Init();
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    pxDefaultProfile = LoadConfig_FindProfile( democonfigLOAD_DEFAULT_PROFILE,
+                                               sizeof( democonfigLOAD_DEFAULT_PROFILE ) - 1 );
+    configASSERT( pxDefaultProfile != NULL );
+
+    #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+        pxImpairment = Impairment_FindProfile( democonfigNETWORK_IMPAIRMENT_PROFILE,
+                                               sizeof( democonfigNETWORK_IMPAIRMENT_PROFILE ) - 1 );
+        configASSERT( pxImpairment != NULL );
+        LogInfo( ( "Emulating a %s link, seed %u", pxImpairment->pcName,
+                   ( unsigned ) democonfigNETWORK_IMPAIRMENT_SEED ) );
+    #endif
+
+    xPayloadsBuilt = LoadConfig_BuildPayloads();
+    configASSERT( xPayloadsBuilt );
+    configASSERT( LoadConfig_MaxPayloadSize() + sampleloadTOPIC_OVERHEAD <= democonfigLOAD_NETWORK_BUFFER_SIZE );
+
+    xNetworkCredentials.xDisableSni = pdFALSE;
+    xNetworkCredentials.pucRootCa = ( const unsigned char * ) democonfigROOT_CA_PEM;
+    xNetworkCredentials.xRootCaSize = sizeof( democonfigROOT_CA_PEM );
+
+    ulDeviceCount = LoadConfig_ReadCredentials( democonfigLOAD_CREDENTIALS_FILE, pxDefaultProfile,
+                                                &ppxCredentials, democonfigLOAD_MAX_DEVICES );
+
+    if( ulDeviceCount == 0 )
+    {
+        LogError( ( "No device identities in %s", democonfigLOAD_CREDENTIALS_FILE ) );
+        vTaskDelete( NULL );
+    }
+
+    LogInfo( ( "Starting %u devices at %u per second, %u bytes each plus TLS context and task stack",
+               ( unsigned ) ulDeviceCount, ( unsigned ) democonfigLOAD_RAMP_UP_PER_SECOND,
+               ( unsigned ) ( sizeof( LoadDevice_t ) + democonfigLOAD_NETWORK_BUFFER_SIZE ) ) );
+
+    xLastReport = xTaskGetTickCount();
+
+    for( ulIndex = 0; ulIndex < ulDeviceCount; ulIndex++ )
+    {
+        pxDevice = pvPortMalloc( sizeof( LoadDevice_t ) + democonfigLOAD_NETWORK_BUFFER_SIZE );
+
+        if( pxDevice == NULL )
+        {
+            LogError( ( "Out of memory after %u devices", ( unsigned ) ulIndex ) );
+            break;
+        }
+
+        memset( pxDevice, 0, sizeof( LoadDevice_t ) );
+        pxDevice->pxCredentials = ppxCredentials[ ulIndex ];
+
+        #ifdef democonfigNETWORK_IMPAIRMENT_PROFILE
+            /* Every device gets its own, repeatable, sequence of impairments. */
+            Impairment_Init( &pxDevice->xImpairedTransport, pxImpairment,
+                             democonfigNETWORK_IMPAIRMENT_SEED + ulIndex );
+        #endif
+
+        if( xTaskCreate( prvLoadDeviceTask, "LoadDevice", democonfigLOAD_DEVICE_STACKSIZE,
+                         pxDevice, tskIDLE_PRIORITY, NULL ) != pdPASS )
+        {
+            LogError( ( "Cannot create the task of device %u", ( unsigned ) ulIndex ) );
+            vPortFree( pxDevice );
+            break;
+        }
+
+        taskENTER_CRITICAL();
+        {
+            xMetrics.ulDevicesStarted++;
+        }
+        taskEXIT_CRITICAL();
+
+        vTaskDelay( pdMS_TO_TICKS( 1000U / democonfigLOAD_RAMP_UP_PER_SECOND ) );
+
+        xNow = xTaskGetTickCount();
+
+        if( xNow - xLastReport >= pdMS_TO_TICKS( democonfigLOAD_REPORT_INTERVAL_MS ) )
+        {
+            prvReportMetrics( ( xNow - xLastReport ) * portTICK_PERIOD_MS );
+            xLastReport = xNow;
+        }
+    }
+
+    for( ; ; )
+    {
+        vTaskDelayUntil( &xLastReport, pdMS_TO_TICKS( democonfigLOAD_REPORT_INTERVAL_MS ) );
+        prvReportMetrics( democonfigLOAD_REPORT_INTERVAL_MS );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Create the task that starts the simulated devices.
+ */
+void vStartDemoTask( void )
+{
+    xTaskCreate( prvLoadControllerTask,    /* Function that implements the task. */
+                 "LoadController",         /* Text name for the task - only used for debugging. */
+                 democonfigDEMO_STACKSIZE, /* Size of stack (in words, not bytes) to allocate for the task. */
+                 NULL,                     /* Task parameter - not used in this case. */
+                 tskIDLE_PRIORITY + 1,     /* Above the devices, so reports are not starved. */
+                 NULL );                   /* Used to pass out a handle to the created task - not used in this case. */
+}
+/*-----------------------------------------------------------*/
@@ -27,9 +27,55 @@
 /* Crypto helper header. */
 #include "crypto.h"
 
+/* Hub subscribe helper header. */
+#include "hub_subscribe.h"
+
+/* Reported property coalescing header. */
+#include "hub_reporter.h"
+
+/* Latency tracing headers. */
+#include "clock_service.h"
+#include "hub_trace.h"
+
+/* Scratch space header. */
+#include "scratch_arena.h"
+
+/* Telemetry interval controller header. */
+#include "rate_controller.h"
+
+#ifdef democonfigENABLE_TELEMETRY_COMPRESSION
+    /* Telemetry compression header. */
+    #include "lz_dict.h"
+#endif
+
 /* Demo Specific configs. */
 #include "demo_config.h"
 
+#ifdef democonfigTRANSPORT_CAPTURE_FILE
+    /* Session capture header. */
+    #include "transport_capture.h"
+#endif
+
+#ifdef democonfigHEALTH_MONITOR_INTERVAL_MS
+    /* Task and heap health header. */
+    #include "health_monitor.h"
+#endif
+
+#if defined( democonfigTELEMETRY_DOUBLE_BUFFER ) || defined( democonfigASYNC_COMMANDS )
+    /* Data lock header. */
+    #include "semphr.h"
+#endif
+
+#ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+    /* Telemetry producer header. */
+    #include "double_buffer.h"
+#endif
+
+#ifdef democonfigASYNC_COMMANDS
+    /* Command worker pool header. */
+    #include "hub_command.h"
+#endif
+
 /* Data Interface Definition */
 #include "sample_azure_iot_pnp_data_if.h"
 /*-----------------------------------------------------------*/
@@ -117,6 +163,108 @@
  * @brief Wait timeout for subscribe to finish.
  */
 #define sampleazureiotSUBSCRIBE_TIMEOUT                       ( 10 * 1000U )
+
+/**
+ * @brief Application property naming the encoding of compressed telemetry.
+ */
+#define sampleazureiotCONTENT_ENCODING_PROPERTY               "content-encoding"
+
+/**
+ * @brief Time reported property updates are held to be merged into one patch.
+ */
+#define sampleazureiotREPORTED_PROPERTIES_WINDOW_MS           ( 5000U )
+
+/**
+ * @brief Interval between publishes of the latency histograms.
+ */
+#define sampleazureiotLATENCY_TRACE_INTERVAL_MS               ( 60 * 1000U )
+
+/**
+ * @brief Interval between logs of the achieved telemetry rate.
+ */
+#define sampleazureiotTELEMETRY_RATE_INTERVAL_MS              ( 60 * 1000U )
+
+/**
+ * @brief Period of the telemetry producer, the most a message is older than
+ * its sample when sent.
+ */
+#define sampleazureiotTELEMETRY_SAMPLE_PERIOD_TICKS           ( pdMS_TO_TICKS( 500U ) )
+
+/**
+ * @brief Offset of each sample into its period, whatever the send schedule.
+ */
+#define sampleazureiotTELEMETRY_SAMPLE_OFFSET_TICKS           ( pdMS_TO_TICKS( 100U ) )
+
+/**
+ * @brief Time the sample task waits for a sample under way before sending.
+ */
+#define sampleazureiotTELEMETRY_SWAP_WAIT_TICKS               ( pdMS_TO_TICKS( 100U ) )
+
+/**
+ * @brief Largest writable properties message kept for later while a command
+ * or the telemetry producer holds the data. Larger ones are picked up by
+ * requesting the property document again.
+ */
+#define sampleazureiotDEFERRED_PROPERTIES_SIZE                ( 1024U )
+
+/**
+ * @brief Bounds of the telemetry interval. ulGetTelemetryIntervalMs() gives
+ * the nominal interval, which grows toward the maximum while the link is
+ * congested.
+ */
+#define sampleazureiotRATE_MIN_INTERVAL_MS                    ( 1000U )
+#define sampleazureiotRATE_MAX_INTERVAL_MS                    ( 10 * 60 * 1000U )
+
+/**
+ * @brief Smoothed PUBACK and reported properties latency above which the
+ * link is treated as congested.
+ */
+#define sampleazureiotRATE_TARGET_LATENCY_MS                  ( 1000U )
+
+/**
+ * @brief Interval decrease per cycle when the link recovers.
+ */
+#define sampleazureiotRATE_RECOVER_STEP_MS                    ( 1000U )
+
+/**
+ * @brief Time after which a PUBACK is given up on.
+ */
+#define sampleazureiotPUBACK_TIMEOUT_MS                       ( 10 * 1000U )
+
+/**
+ * @brief Time after which a command is no longer answered, the default
+ * response timeout of IoT Hub direct methods.
+ */
+#define sampleazureiotCOMMAND_TIMEOUT_MS                      ( 30 * 1000U )
+
+/**
+ * @brief Interval between logs of the command worker pool counters.
+ */
+#define sampleazureiotCOMMAND_STATS_INTERVAL_MS               ( 60 * 1000U )
+
+/**
+ * @brief Sizes of the scratch buffers of the operations of the sample task.
+ */
+#define sampleazureiotTELEMETRY_BUFFER_SIZE                   ( 512U )
+#define sampleazureiotTELEMETRY_PROPERTIES_SIZE               ( 32U + HUB_TRACE_PROPERTIES_SIZE )
+#define sampleazureiotCOMMAND_RESPONSE_BUFFER_SIZE            ( 256U )
+#define sampleazureiotREPORTED_PROPERTIES_UPDATE_SIZE         ( 320U )
+#define sampleazureiotLATENCY_TRACE_BUFFER_SIZE               ( 2048U )
+#define sampleazureiotHEALTH_BUFFER_SIZE                      ( 1024U )
+
+#ifdef democonfigENABLE_TELEMETRY_COMPRESSION
+    #define sampleazureiotCOMPRESSED_TELEMETRY_SIZE           LZ_DICT_COMPRESS_BOUND( sampleazureiotTELEMETRY_BUFFER_SIZE )
+#else
+    #define sampleazureiotCOMPRESSED_TELEMETRY_SIZE           ( 0U )
+#endif
+
+/* With the double buffer the payload is not in the scratch space, it is
+ * created by the producer task into one of the two buffers. */
+#ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+    #define sampleazureiotTELEMETRY_SCRATCH_SIZE              ( 0U )
+#else
+    #define sampleazureiotTELEMETRY_SCRATCH_SIZE              sampleazureiotTELEMETRY_BUFFER_SIZE
+#endif
 /*-----------------------------------------------------------*/
 
 /**
@@ -142,15 +290,104 @@ struct NetworkContext
 
 AzureIoTHubClient_t xAzureIoTHubClient;
 
-/* Telemetry buffers */
-static uint8_t ucScratchBuffer[ 512 ];
+/* Scratch space of each operation of the sample task. The operations run one
+ * at a time, the command and property callbacks inside the process loop, so
+ * they share an arena that holds the largest. */
+typedef union SampleScratchSpace
+{
+    uint8_t ucTelemetry[ scratcharenaSIZE( sampleazureiotTELEMETRY_SCRATCH_SIZE ) +
+                         scratcharenaSIZE( sampleazureiotTELEMETRY_PROPERTIES_SIZE ) +
+                         scratcharenaSIZE( sampleazureiotCOMPRESSED_TELEMETRY_SIZE ) ];
+    uint8_t ucCommandResponse[ scratcharenaSIZE( sampleazureiotCOMMAND_RESPONSE_BUFFER_SIZE ) ];
+    uint8_t ucReportedPropertiesUpdate[ scratcharenaSIZE( sampleazureiotREPORTED_PROPERTIES_UPDATE_SIZE ) ];
+    uint8_t ucLatencyTrace[ scratcharenaSIZE( sampleazureiotLATENCY_TRACE_BUFFER_SIZE ) ];
+    #ifdef democonfigHEALTH_MONITOR_INTERVAL_MS
+        uint8_t ucHealth[ scratcharenaSIZE( sampleazureiotHEALTH_BUFFER_SIZE ) ];
+    #endif
+} SampleScratchSpace_t;
+
+static uint8_t ucScratchArenaBuffer[ scratcharenaBUFFER_SIZE( sizeof( SampleScratchSpace_t ) ) ];
+static ScratchArena_t xScratchArena;
+
+#ifdef democonfigENABLE_TELEMETRY_COMPRESSION
+    static LZDictContext_t xCompressionContext;
+#endif
+
+/* Latency tracing */
+static HubTrace_t xTrace;
+static uint64_t ullLatencyTracePublishedMs;
+
+/* Histograms of the intervals not yet published, kept when a publish fails. */
+static HubTraceSnapshot_t xTraceSnapshot;
+
+/* Telemetry sent and awaiting its PUBACK, a packet ID of 0 marks a free slot. */
+static struct
+{
+    uint16_t usPacketID;
+    HubTraceRecord_t * pxTraceRecord;
+    uint64_t ullSentMs;
+} xTelemetryInFlight[ HUB_TRACE_MAX_TELEMETRY ];
+
+/* Telemetry interval adapted to the PUBACK and reported properties latency */
+static RateController_t xRateController;
+static uint32_t ulTelemetryIntervalMs;
+static uint64_t ullTelemetrySentMs;
+
+#ifdef democonfigHEALTH_MONITOR_INTERVAL_MS
+    /* Task and heap health */
+    static HealthMonitor_t xHealthMonitor;
+    static uint64_t ullHealthPublishedMs;
+#endif
 
-/* Command buffers */
-static uint8_t ucCommandResponsePayloadBuffer[ 256 ];
+/* Achieved telemetry rate */
+static uint32_t ulTelemetrySent;
+static uint32_t ulTelemetrySkipped;
+static uint64_t ullTelemetryRateLoggedMs;
+
+#ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+    /* Telemetry created by the producer task while this task sends. */
+    static uint8_t ucTelemetryBuffers[ 2 * sampleazureiotTELEMETRY_BUFFER_SIZE ];
+    static DoubleBuffer_t xTelemetryDoubleBuffer;
+#endif
+
+#ifdef democonfigASYNC_COMMANDS
+    /* Commands run by workers while this task keeps processing. */
+    static HubCommandPool_t xCommandPool;
+    static uint64_t ullCommandStatsLoggedMs;
+#endif
+
+#if defined( democonfigTELEMETRY_DOUBLE_BUFFER ) || defined( democonfigASYNC_COMMANDS )
+
+/* The data lock serializes the calls of the data interface from the tasks
+ * of the sample. This task only tries it, skipping or deferring the call, so
+ * a slow command does not hold back the process loop. */
+    static SemaphoreHandle_t xDataMutex;
+    static StaticSemaphore_t xDataMutexBuffer;
+
+    #define sampleazureiotLOCK_DATA()        ( void ) xSemaphoreTake( xDataMutex, portMAX_DELAY )
+    #define sampleazureiotTRY_LOCK_DATA()    ( xSemaphoreTake( xDataMutex, 0 ) == pdTRUE )
+    #define sampleazureiotUNLOCK_DATA()      ( void ) xSemaphoreGive( xDataMutex )
+
+/* Properties message which arrived while the data was locked, handled by a
+ * later iteration of this task. */
+    static AzureIoTHubClientPropertiesResponse_t xDeferredProperties;
+    static uint8_t ucDeferredPropertiesPayload[ sampleazureiotDEFERRED_PROPERTIES_SIZE ];
+    static bool xPropertiesDeferred;
+    static bool xPropertiesResyncNeeded;
+#else
+    #define sampleazureiotLOCK_DATA()
+    #define sampleazureiotTRY_LOCK_DATA()    ( true )
+    #define sampleazureiotUNLOCK_DATA()
+#endif
 
-/* Reported Properties buffers */
-static uint8_t ucReportedPropertiesUpdate[ 320 ];
-static uint32_t ulReportedPropertiesUpdateLength;
+/* Reported Properties buffers, the patch is kept by the reporter */
+static uint8_t ucReportedPropertiesPatch[ 320 ];
+static HubReporter_t xReporter;
+
+#ifdef democonfigTRANSPORT_CAPTURE_FILE
+    /* Recording of the sessions, for the replay benchmark */
+    static CaptureTransport_t xCapture;
+#endif
 /*-----------------------------------------------------------*/
 
 #ifdef democonfigENABLE_DPS_SAMPLE
@@ -205,42 +442,133 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
  */
 static uint8_t ucMQTTMessageBuffer[ democonfigNETWORK_BUFFER_SIZE ];
 
+#ifdef democonfigASYNC_COMMANDS
+
 /**
- * @brief Internal function for handling Command requests.
- *
- * @remark This function is required for the interface with samples to work properly.
+ * @brief Command callback handing the request to the worker pool.
  */
-static void prvHandleCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
-                              void * pvContext )
-{
-    AzureIoTHubClient_t * pxHandle = ( AzureIoTHubClient_t * ) pvContext;
-    uint32_t ulResponseStatus = 0;
-    AzureIoTResult_t xResult;
+    static void prvDispatchCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
+                                    void * pvContext )
+    {
+        ( void ) pvContext;
 
-    uint32_t ulCommandResponsePayloadLength = ulHandleCommand( pxMessage,
-                                                               &ulResponseStatus,
-                                                               ucCommandResponsePayloadBuffer,
-                                                               sizeof( ucCommandResponsePayloadBuffer ) );
+        ( void ) HubCommand_Dispatch( &xCommandPool, pxMessage );
+    }
+/*-----------------------------------------------------------*/
 
-    if( ( xResult = AzureIoTHubClient_SendCommandResponse( pxHandle, pxMessage, ulResponseStatus,
-                                                           ucCommandResponsePayloadBuffer,
-                                                           ulCommandResponsePayloadLength ) ) != eAzureIoTSuccess )
+/**
+ * @brief Command handler of the workers.
+ */
+    static uint32_t prvRunCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
+                                   uint32_t * pulResponseStatus,
+                                   uint8_t * pucResponsePayload,
+                                   uint32_t ulResponsePayloadSize )
     {
-        LogError( ( "Error sending command response: result 0x%08x", xResult ) );
+        uint32_t ulResponseLength;
+
+        sampleazureiotLOCK_DATA();
+        ulResponseLength = ulHandleCommand( pxMessage, pulResponseStatus,
+                                            pucResponsePayload, ulResponsePayloadSize );
+        sampleazureiotUNLOCK_DATA();
+
+        return ulResponseLength;
     }
-    else
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Log the worker pool counters once their interval has passed.
+ */
+    static void prvLogCommandStats( void )
     {
-        LogInfo( ( "Successfully sent command response %d", ulResponseStatus ) );
+        HubCommandStats_t xStats;
+
+        if( Clock_GetMonotonicMs() - ullCommandStatsLoggedMs < sampleazureiotCOMMAND_STATS_INTERVAL_MS )
+        {
+            return;
+        }
+
+        ullCommandStatsLoggedMs = Clock_GetMonotonicMs();
+        HubCommand_GetStats( &xCommandPool, &xStats );
+
+        LogInfo( ( "Commands: %u received, %u rejected, %u completed, %u timed out, "
+                   "queue depth %u (max %u), max wait %u ms, execution %u ms in total (max %u ms)",
+                   ( unsigned ) xStats.ulReceived, ( unsigned ) xStats.ulRejected,
+                   ( unsigned ) xStats.ulCompleted, ( unsigned ) xStats.ulTimedOut,
+                   ( unsigned ) xStats.ulQueueDepth, ( unsigned ) xStats.ulMaxQueueDepth,
+                   ( unsigned ) xStats.ulMaxWaitMs, ( unsigned ) xStats.ullExecutionMs,
+                   ( unsigned ) xStats.ulMaxExecutionMs ) );
     }
-}
+#else /* democonfigASYNC_COMMANDS */
+
+/**
+ * @brief Internal function for handling Command requests.
+ *
+ * @remark This function is required for the interface with samples to work properly.
+ */
+    static void prvHandleCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
+                                  void * pvContext )
+    {
+        AzureIoTHubClient_t * pxHandle = ( AzureIoTHubClient_t * ) pvContext;
+        uint32_t ulResponseStatus = 0;
+        uint32_t ulCommandResponsePayloadLength;
+        uint8_t * pucCommandResponsePayloadBuffer;
+        ScratchArenaMark_t xScratchMark;
+        AzureIoTResult_t xResult;
+        HubTraceRecord_t xTraceRecord;
+
+        xScratchMark = ScratchArena_Mark( &xScratchArena );
+        pucCommandResponsePayloadBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotCOMMAND_RESPONSE_BUFFER_SIZE );
+        configASSERT( pucCommandResponsePayloadBuffer != NULL );
+
+        HubTrace_CommandStart( &xTraceRecord );
+
+        HubTrace_Mark( &xTraceRecord, eHubTraceHandlerStart );
+        sampleazureiotLOCK_DATA();
+        ulCommandResponsePayloadLength = ulHandleCommand( pxMessage,
+                                                          &ulResponseStatus,
+                                                          pucCommandResponsePayloadBuffer,
+                                                          sampleazureiotCOMMAND_RESPONSE_BUFFER_SIZE );
+        sampleazureiotUNLOCK_DATA();
+        HubTrace_Mark( &xTraceRecord, eHubTraceHandlerEnd );
+
+        if( ( xResult = AzureIoTHubClient_SendCommandResponse( pxHandle, pxMessage, ulResponseStatus,
+                                                               pucCommandResponsePayloadBuffer,
+                                                               ulCommandResponsePayloadLength ) ) != eAzureIoTSuccess )
+        {
+            LogError( ( "Error sending command response: result 0x%08x", xResult ) );
+        }
+        else
+        {
+            HubTrace_Mark( &xTraceRecord, eHubTraceResponse );
+            LogInfo( ( "Successfully sent command response %d", ulResponseStatus ) );
+        }
 
+        HubTrace_CommandEnd( &xTrace, &xTraceRecord );
+        ScratchArena_Reset( &xScratchArena, xScratchMark );
+    }
+#endif /* democonfigASYNC_COMMANDS */
+/*-----------------------------------------------------------*/
 
-static void prvDispatchPropertiesUpdate( AzureIoTHubClientPropertiesResponse_t * pxMessage )
+/**
+ * @brief Hand a properties message to the data interface and queue the
+ * response. Called with the data locked, unlocks it.
+ */
+static void prvApplyPropertiesUpdate( AzureIoTHubClientPropertiesResponse_t * pxMessage )
 {
+    uint8_t * pucReportedPropertiesUpdate;
+    uint32_t ulReportedPropertiesUpdateLength;
+    ScratchArenaMark_t xScratchMark;
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucReportedPropertiesUpdate = ScratchArena_Alloc( &xScratchArena, sampleazureiotREPORTED_PROPERTIES_UPDATE_SIZE );
+    configASSERT( pucReportedPropertiesUpdate != NULL );
+
     vHandleWritableProperties( pxMessage,
-                               ucReportedPropertiesUpdate,
-                               sizeof( ucReportedPropertiesUpdate ),
+                               pucReportedPropertiesUpdate,
+                               sampleazureiotREPORTED_PROPERTIES_UPDATE_SIZE,
                                &ulReportedPropertiesUpdateLength );
+    RateController_SetNominal( &xRateController, ulGetTelemetryIntervalMs() );
+    sampleazureiotUNLOCK_DATA();
 
     if( ulReportedPropertiesUpdateLength == 0 )
     {
@@ -248,12 +576,94 @@ static void prvDispatchPropertiesUpdate( AzureIoTHubClientPropertiesResponse_t *
     }
     else
     {
-        AzureIoTResult_t xResult = AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient,
-                                                                             ucReportedPropertiesUpdate,
-                                                                             ulReportedPropertiesUpdateLength,
-                                                                             NULL );
-        configASSERT( xResult == eAzureIoTSuccess );
+        AzureIoTResult_t xResult = HubReporter_MergePatch( &xReporter,
+                                                           pucReportedPropertiesUpdate,
+                                                           ulReportedPropertiesUpdateLength );
+
+        if( xResult != eAzureIoTSuccess )
+        {
+            LogError( ( "There was an error queuing the writable properties response: 0x%08x", xResult ) );
+        }
+    }
+
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
+}
+/*-----------------------------------------------------------*/
+
+#if defined( democonfigTELEMETRY_DOUBLE_BUFFER ) || defined( democonfigASYNC_COMMANDS )
+
+/**
+ * @brief Keep a properties message which arrived while the data was locked,
+ * the process loop does not wait for the lock.
+ *
+ * A second message, or one too large to keep, is not kept: the property
+ * document is requested again instead, it holds every writable property.
+ */
+    static void prvDeferPropertiesUpdate( const AzureIoTHubClientPropertiesResponse_t * pxMessage )
+    {
+        if( !xPropertiesDeferred && !xPropertiesResyncNeeded &&
+            ( pxMessage->ulPayloadLength <= sizeof( ucDeferredPropertiesPayload ) ) )
+        {
+            xDeferredProperties = *pxMessage;
+            memcpy( ucDeferredPropertiesPayload, pxMessage->pvMessagePayload, pxMessage->ulPayloadLength );
+            xDeferredProperties.pvMessagePayload = ucDeferredPropertiesPayload;
+            xPropertiesDeferred = true;
+            LogInfo( ( "Data in use, properties update deferred" ) );
+        }
+        else
+        {
+            xPropertiesDeferred = false;
+            xPropertiesResyncNeeded = true;
+            LogWarn( ( "Data in use, properties update dropped, the property document is requested again" ) );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Handle the properties update deferred by the process loop, or
+ * request the property document again, once the data is free.
+ */
+    static void prvProcessDeferredProperties( void )
+    {
+        AzureIoTResult_t xResult;
+
+        if( xPropertiesResyncNeeded )
+        {
+            if( ( xResult = AzureIoTHubClient_RequestPropertiesAsync( &xAzureIoTHubClient ) ) == eAzureIoTSuccess )
+            {
+                xPropertiesResyncNeeded = false;
+            }
+            else
+            {
+                LogError( ( "Failed to request the property document: result 0x%08x", xResult ) );
+            }
+        }
+        else if( xPropertiesDeferred && sampleazureiotTRY_LOCK_DATA() )
+        {
+            xPropertiesDeferred = false;
+            prvApplyPropertiesUpdate( &xDeferredProperties );
+        }
+    }
+/*-----------------------------------------------------------*/
+#endif /* if defined( democonfigTELEMETRY_DOUBLE_BUFFER ) || defined( democonfigASYNC_COMMANDS ) */
+
+/**
+ * @brief Handle a properties message without waiting for the data, which a
+ * command worker may hold for the whole command.
+ */
+static void prvDispatchPropertiesUpdate( AzureIoTHubClientPropertiesResponse_t * pxMessage )
+{
+    if( sampleazureiotTRY_LOCK_DATA() )
+    {
+        prvApplyPropertiesUpdate( pxMessage );
     }
+
+    #if defined( democonfigTELEMETRY_DOUBLE_BUFFER ) || defined( democonfigASYNC_COMMANDS )
+        else
+        {
+            prvDeferPropertiesUpdate( pxMessage );
+        }
+    #endif
 }
 /*-----------------------------------------------------------*/
 
@@ -285,6 +695,7 @@ static void prvHandleProperties( AzureIoTHubClientPropertiesResponse_t * pxMessa
 
         case eAzureIoTHubPropertiesReportedResponseMessage:
             LogDebug( ( "Device reported property response received" ) );
+            HubReporter_HandleResponse( &xReporter, pxMessage );
             break;
 
         default:
@@ -294,6 +705,369 @@ static void prvHandleProperties( AzureIoTHubClientPropertiesResponse_t * pxMessa
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Telemetry PUBACK callback, ends the trace of the message and gives
+ * its latency to the rate controller.
+ */
+static void prvHandleTelemetryAck( uint16_t usPacketID )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < HUB_TRACE_MAX_TELEMETRY; ulIndex++ )
+    {
+        if( xTelemetryInFlight[ ulIndex ].usPacketID == usPacketID )
+        {
+            RateController_RecordPublish( &xRateController,
+                                          ( uint32_t ) ( Clock_GetMonotonicMs() - xTelemetryInFlight[ ulIndex ].ullSentMs ),
+                                          true );
+            HubTrace_Mark( xTelemetryInFlight[ ulIndex ].pxTraceRecord, eHubTracePuback );
+            HubTrace_TelemetryEnd( &xTrace, xTelemetryInFlight[ ulIndex ].pxTraceRecord );
+            xTelemetryInFlight[ ulIndex ].usPacketID = 0;
+            break;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief End the traces of telemetry whose PUBACK will not arrive anymore,
+ * the overdue ones or all of them, as failed publishes.
+ *
+ * @return Number of telemetry messages still awaiting their PUBACK.
+ */
+static uint32_t prvEndTelemetryInFlight( bool xAll )
+{
+    uint32_t ulIndex;
+    uint32_t ulInFlight = 0;
+
+    for( ulIndex = 0; ulIndex < HUB_TRACE_MAX_TELEMETRY; ulIndex++ )
+    {
+        if( xTelemetryInFlight[ ulIndex ].usPacketID == 0 )
+        {
+            continue;
+        }
+
+        if( xAll || ( Clock_GetMonotonicMs() - xTelemetryInFlight[ ulIndex ].ullSentMs >= sampleazureiotPUBACK_TIMEOUT_MS ) )
+        {
+            RateController_RecordPublish( &xRateController,
+                                          ( uint32_t ) ( Clock_GetMonotonicMs() - xTelemetryInFlight[ ulIndex ].ullSentMs ),
+                                          false );
+            HubTrace_TelemetryEnd( &xTrace, xTelemetryInFlight[ ulIndex ].pxTraceRecord );
+            xTelemetryInFlight[ ulIndex ].usPacketID = 0;
+        }
+        else
+        {
+            ulInFlight++;
+        }
+    }
+
+    return ulInFlight;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reported properties response callback, a latency sample of the link
+ * for the rate controller.
+ */
+static void prvHandleReportedResponse( uint32_t ulRequestID,
+                                       uint32_t ulLatencyMs,
+                                       bool xAnswered,
+                                       void * pvContext )
+{
+    ( void ) ulRequestID;
+    ( void ) pvContext;
+
+    RateController_RecordPublish( &xRateController, ulLatencyMs, xAnswered );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Pick the interval to the next telemetry message, once one was sent.
+ *
+ * The interval grows while the PUBACKs and the reported properties responses
+ * are slow, or the PUBACKs pile up, and returns to the nominal interval of the
+ * data interface once the link recovers.
+ */
+static void prvUpdateTelemetryInterval( void )
+{
+    RateDecision_t xDecision;
+
+    ullTelemetrySentMs = Clock_GetMonotonicMs();
+    ulTelemetryIntervalMs = RateController_Update( &xRateController, prvEndTelemetryInFlight( false ), 0, &xDecision );
+
+    if( xDecision.xReason != eRateHold )
+    {
+        LogInfo( ( "Telemetry interval %u ms (%s), latency %u ms, %u PUBACKs awaited",
+                   ( unsigned ) xDecision.ulIntervalMs, RateController_ReasonName( xDecision.xReason ),
+                   ( unsigned ) xDecision.ulLatencyMs, ( unsigned ) xDecision.ulQueueDepth ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether the interval to the next telemetry message has passed.
+ */
+static bool prvTelemetryDue( void )
+{
+    return Clock_GetMonotonicMs() - ullTelemetrySentMs >= ulTelemetryIntervalMs;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send telemetry, compressed when enabled and when that makes it smaller.
+ *
+ * The trace of a message ends at its PUBACK, in prvHandleTelemetryAck(). When
+ * every slot for messages in flight is taken, it ends once the message is
+ * written to the transport instead.
+ */
+static AzureIoTResult_t prvSendTelemetry( const uint8_t * pucTelemetryData,
+                                          uint32_t ulTelemetryDataLength )
+{
+    AzureIoTMessageProperties_t xPropertyBag;
+    HubTraceRecord_t * pxTraceRecord;
+    AzureIoTResult_t xResult;
+    uint8_t * pucPropertyBuffer;
+    ScratchArenaMark_t xScratchMark;
+    uint16_t usPacketID = 0;
+    uint32_t ulIndex;
+
+    #ifdef democonfigENABLE_TELEMETRY_COMPRESSION
+        const uint8_t * pucDictionary;
+        uint8_t * pucCompressedTelemetryBuffer;
+        uint32_t ulDictionaryLength;
+        uint32_t ulCompressedLength;
+    #endif
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucPropertyBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotTELEMETRY_PROPERTIES_SIZE );
+    configASSERT( pucPropertyBuffer != NULL );
+
+    xResult = AzureIoTMessage_PropertiesInit( &xPropertyBag, pucPropertyBuffer, 0,
+                                              sampleazureiotTELEMETRY_PROPERTIES_SIZE );
+    configASSERT( xResult == eAzureIoTSuccess );
+
+    pxTraceRecord = HubTrace_TelemetryStart( &xTrace, &xPropertyBag );
+
+    #ifdef democonfigENABLE_TELEMETRY_COMPRESSION
+
+        ulDictionaryLength = ulGetTelemetryDictionary( &pucDictionary );
+        pucCompressedTelemetryBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotCOMPRESSED_TELEMETRY_SIZE );
+        configASSERT( pucCompressedTelemetryBuffer != NULL );
+
+        if( ( LZDict_Compress( &xCompressionContext, pucDictionary, ulDictionaryLength,
+                               pucTelemetryData, ulTelemetryDataLength,
+                               pucCompressedTelemetryBuffer, sampleazureiotCOMPRESSED_TELEMETRY_SIZE,
+                               &ulCompressedLength ) == eLZDictSuccess ) &&
+            ( ulCompressedLength < ulTelemetryDataLength ) )
+        {
+            LogDebug( ( "Telemetry compressed from %u to %u bytes",
+                        ( unsigned ) ulTelemetryDataLength, ( unsigned ) ulCompressedLength ) );
+
+            xResult = AzureIoTMessage_PropertiesAppend( &xPropertyBag,
+                                                        ( const uint8_t * ) sampleazureiotCONTENT_ENCODING_PROPERTY,
+                                                        sizeof( sampleazureiotCONTENT_ENCODING_PROPERTY ) - 1,
+                                                        ( const uint8_t * ) LZ_DICT_ENCODING_NAME,
+                                                        sizeof( LZ_DICT_ENCODING_NAME ) - 1 );
+            configASSERT( xResult == eAzureIoTSuccess );
+
+            pucTelemetryData = pucCompressedTelemetryBuffer;
+            ulTelemetryDataLength = ulCompressedLength;
+        }
+    #endif /* democonfigENABLE_TELEMETRY_COMPRESSION */
+
+    HubTrace_Mark( pxTraceRecord, eHubTraceEnqueue );
+    xResult = AzureIoTHubClient_SendTelemetry( &xAzureIoTHubClient,
+                                               pucTelemetryData, ulTelemetryDataLength,
+                                               &xPropertyBag, eAzureIoTHubMessageQoS1, &usPacketID );
+    HubTrace_Mark( pxTraceRecord, eHubTraceSendComplete );
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
+
+    for( ulIndex = 0; ( xResult == eAzureIoTSuccess ) && ( usPacketID != 0 ) &&
+         ( ulIndex < HUB_TRACE_MAX_TELEMETRY ); ulIndex++ )
+    {
+        if( xTelemetryInFlight[ ulIndex ].usPacketID == 0 )
+        {
+            xTelemetryInFlight[ ulIndex ].usPacketID = usPacketID;
+            xTelemetryInFlight[ ulIndex ].pxTraceRecord = pxTraceRecord;
+            xTelemetryInFlight[ ulIndex ].ullSentMs = Clock_GetMonotonicMs();
+            pxTraceRecord = NULL;
+            break;
+        }
+    }
+
+    /* Not awaiting a PUBACK. */
+    HubTrace_TelemetryEnd( &xTrace, pxTraceRecord );
+    prvUpdateTelemetryInterval();
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        ulTelemetrySent++;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Log the telemetry rate achieved since the last log, once its
+ * interval has passed.
+ */
+static void prvLogTelemetryRate( void )
+{
+    uint64_t ullElapsedMs = Clock_GetMonotonicMs() - ullTelemetryRateLoggedMs;
+
+    #ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+        DoubleBufferStats_t xStats;
+    #endif
+
+    if( ullElapsedMs < sampleazureiotTELEMETRY_RATE_INTERVAL_MS )
+    {
+        return;
+    }
+
+    #ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+        DoubleBuffer_GetStats( &xTelemetryDoubleBuffer, &xStats );
+        LogInfo( ( "Telemetry rate, double buffered: %u messages in %u ms, "
+                   "%u swaps, %u samples overwritten, %u producer waits, %u consumer misses",
+                   ( unsigned ) ulTelemetrySent, ( unsigned ) ullElapsedMs,
+                   ( unsigned ) xStats.ulSwaps, ( unsigned ) xStats.ulOverwrites, ( unsigned ) xStats.ulProducerWaits,
+                   ( unsigned ) xStats.ulConsumerMisses ) );
+    #else
+        LogInfo( ( "Telemetry rate, serial: %u messages in %u ms, %u skipped while the data was in use",
+                   ( unsigned ) ulTelemetrySent, ( unsigned ) ullElapsedMs, ( unsigned ) ulTelemetrySkipped ) );
+    #endif
+
+    ulTelemetrySent = 0;
+    ulTelemetrySkipped = 0;
+    ullTelemetryRateLoggedMs += ullElapsedMs;
+}
+/*-----------------------------------------------------------*/
+
+#ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+
+/**
+ * @brief Task creating telemetry into the back buffer while the sample task
+ * sends the front one.
+ *
+ * Samples every #sampleazureiotTELEMETRY_SAMPLE_PERIOD_TICKS at
+ * #sampleazureiotTELEMETRY_SAMPLE_OFFSET_TICKS into the period, not in step
+ * with the sends. The sample task swaps in the latest sample when it sends.
+ */
+    static void prvTelemetryProducerTask( void * pvParameters )
+    {
+        uint8_t * pucTelemetryData;
+        uint32_t ulTelemetryDataSize;
+        uint32_t ulTelemetryDataLength = 0;
+        uint32_t ulStatus;
+        TickType_t xSampleTime = xTaskGetTickCount();
+
+        ( void ) pvParameters;
+
+        vTaskDelayUntil( &xSampleTime,
+                         sampleazureiotTELEMETRY_SAMPLE_PERIOD_TICKS -
+                         ( xSampleTime % sampleazureiotTELEMETRY_SAMPLE_PERIOD_TICKS ) +
+                         sampleazureiotTELEMETRY_SAMPLE_OFFSET_TICKS );
+
+        for( ; ; )
+        {
+            pucTelemetryData = DoubleBuffer_Back( &xTelemetryDoubleBuffer, &ulTelemetryDataSize );
+
+            sampleazureiotLOCK_DATA();
+            ulStatus = ulCreateTelemetry( pucTelemetryData, ulTelemetryDataSize, &ulTelemetryDataLength );
+            sampleazureiotUNLOCK_DATA();
+
+            DoubleBuffer_Commit( &xTelemetryDoubleBuffer, ( ulStatus == 0 ) ? ulTelemetryDataLength : 0 );
+
+            vTaskDelayUntil( &xSampleTime, sampleazureiotTELEMETRY_SAMPLE_PERIOD_TICKS );
+        }
+    }
+#endif /* democonfigTELEMETRY_DOUBLE_BUFFER */
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publish the latency histograms once the trace interval has passed.
+ */
+static void prvPublishLatencyTrace( void )
+{
+    AzureIoTResult_t xResult;
+    uint8_t * pucLatencyTraceBuffer;
+    ScratchArenaMark_t xScratchMark;
+    uint32_t ulLength;
+
+    if( Clock_GetMonotonicMs() - ullLatencyTracePublishedMs < sampleazureiotLATENCY_TRACE_INTERVAL_MS )
+    {
+        return;
+    }
+
+    xScratchMark = ScratchArena_Mark( &xScratchArena );
+    pucLatencyTraceBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotLATENCY_TRACE_BUFFER_SIZE );
+    configASSERT( pucLatencyTraceBuffer != NULL );
+
+    ullLatencyTracePublishedMs = Clock_GetMonotonicMs();
+    HubTrace_Snapshot( &xTrace, &xTraceSnapshot );
+    ulLength = HubTrace_Serialize( &xTraceSnapshot, pucLatencyTraceBuffer, sampleazureiotLATENCY_TRACE_BUFFER_SIZE );
+
+    if( ulLength == 0 )
+    {
+        /* Dropped rather than kept, it would only grow. */
+        LogWarn( ( "Latency trace does not fit in %u bytes", ( unsigned ) sampleazureiotLATENCY_TRACE_BUFFER_SIZE ) );
+        HubTrace_SnapshotClear( &xTraceSnapshot );
+    }
+    else if( ( xResult = AzureIoTHubClient_SendTelemetry( &xAzureIoTHubClient,
+                                                          pucLatencyTraceBuffer, ulLength,
+                                                          NULL, eAzureIoTHubMessageQoS1, NULL ) ) != eAzureIoTSuccess )
+    {
+        LogWarn( ( "Failed to publish the latency trace, kept for the next interval: result 0x%08x", xResult ) );
+    }
+    else
+    {
+        HubTrace_SnapshotClear( &xTraceSnapshot );
+    }
+
+    ScratchArena_Reset( &xScratchArena, xScratchMark );
+}
+/*-----------------------------------------------------------*/
+
+#ifdef democonfigHEALTH_MONITOR_INTERVAL_MS
+
+/**
+ * @brief Publish the task and heap health once its interval has passed.
+ */
+    static void prvPublishHealth( void )
+    {
+        AzureIoTResult_t xResult;
+        uint8_t * pucHealthBuffer;
+        ScratchArenaMark_t xScratchMark;
+        uint32_t ulLength;
+
+        if( Clock_GetMonotonicMs() - ullHealthPublishedMs < democonfigHEALTH_MONITOR_INTERVAL_MS )
+        {
+            return;
+        }
+
+        xScratchMark = ScratchArena_Mark( &xScratchArena );
+        pucHealthBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotHEALTH_BUFFER_SIZE );
+        configASSERT( pucHealthBuffer != NULL );
+
+        ullHealthPublishedMs = Clock_GetMonotonicMs();
+        ulLength = HealthMonitor_Serialize( &xHealthMonitor, pucHealthBuffer, sampleazureiotHEALTH_BUFFER_SIZE );
+
+        if( ulLength == 0 )
+        {
+            LogWarn( ( "Health report does not fit in %u bytes", ( unsigned ) sampleazureiotHEALTH_BUFFER_SIZE ) );
+        }
+        else if( ( xResult = AzureIoTHubClient_SendTelemetry( &xAzureIoTHubClient,
+                                                              pucHealthBuffer, ulLength,
+                                                              NULL, eAzureIoTHubMessageQoS1, NULL ) ) != eAzureIoTSuccess )
+        {
+            LogWarn( ( "Failed to publish the health report: result 0x%08x", xResult ) );
+        }
+
+        ScratchArena_Reset( &xScratchArena, xScratchMark );
+    }
+#endif /* democonfigHEALTH_MONITOR_INTERVAL_MS */
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Setup transport credentials.
  */
@@ -322,14 +1096,28 @@ static uint32_t prvSetupNetworkCredentials( NetworkCredentials_t * pxNetworkCred
 static void prvAzureDemoTask( void * pvParameters )
 {
     uint32_t ulScratchBufferLength = 0U;
+    uint8_t * pucScratchBuffer;
+    ScratchArenaMark_t xScratchMark;
     NetworkCredentials_t xNetworkCredentials = { 0 };
     AzureIoTTransportInterface_t xTransport;
     NetworkContext_t xNetworkContext = { 0 };
     TlsTransportParams_t xTlsTransportParams = { 0 };
     AzureIoTResult_t xResult;
     uint32_t ulStatus;
+    uint64_t ullConnectStartUs;
     AzureIoTHubClientOptions_t xHubOptions = { 0 };
+    HubSubscriptions_t xSubscriptions = { 0 };
     bool xSessionPresent;
+    RateControllerConfig_t xRateConfig = { 0 };
+    bool xRateConfigValid;
+
+    #ifdef democonfigTRANSPORT_CAPTURE_FILE
+        FILE * pxCaptureFile;
+    #endif
+
+    #ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+        const uint8_t * pucTelemetryData;
+    #endif
 
     #ifdef democonfigENABLE_DPS_SAMPLE
         uint8_t * pucIotHubHostname = NULL;
@@ -364,6 +1152,42 @@ static void prvAzureDemoTask( void * pvParameters )
 
     xNetworkContext.pParams = &xTlsTransportParams;
 
+    ScratchArena_Init( &xScratchArena, ucScratchArenaBuffer, sizeof( ucScratchArenaBuffer ) );
+    HubTrace_Init( &xTrace );
+    ullLatencyTracePublishedMs = Clock_GetMonotonicMs();
+    ullTelemetryRateLoggedMs = Clock_GetMonotonicMs();
+
+    sampleazureiotLOCK_DATA();
+    xRateConfig.ulNominalIntervalMs = ulGetTelemetryIntervalMs();
+    sampleazureiotUNLOCK_DATA();
+    xRateConfig.ulMinIntervalMs = sampleazureiotRATE_MIN_INTERVAL_MS;
+    xRateConfig.ulMaxIntervalMs = sampleazureiotRATE_MAX_INTERVAL_MS;
+    xRateConfig.ulTargetLatencyMs = sampleazureiotRATE_TARGET_LATENCY_MS;
+    xRateConfig.ulMaxQueueDepth = HUB_TRACE_MAX_TELEMETRY;
+    xRateConfig.ulRecoverStepMs = sampleazureiotRATE_RECOVER_STEP_MS;
+    xRateConfigValid = RateController_Init( &xRateController, &xRateConfig );
+    configASSERT( xRateConfigValid );
+    ulTelemetryIntervalMs = xRateController.ulIntervalMs;
+    ullTelemetrySentMs = Clock_GetMonotonicMs() - ulTelemetryIntervalMs;
+
+    #ifdef democonfigASYNC_COMMANDS
+        xResult = HubCommand_Init( &xCommandPool, &xAzureIoTHubClient, prvRunCommand,
+                                   &xTrace, sampleazureiotCOMMAND_TIMEOUT_MS );
+        configASSERT( xResult == eAzureIoTSuccess );
+        ullCommandStatsLoggedMs = Clock_GetMonotonicMs();
+    #endif
+
+    #ifdef democonfigHEALTH_MONITOR_INTERVAL_MS
+        HealthMonitor_Init( &xHealthMonitor );
+        ullHealthPublishedMs = Clock_GetMonotonicMs();
+    #endif
+
+    #ifdef democonfigTRANSPORT_CAPTURE_FILE
+        pxCaptureFile = fopen( democonfigTRANSPORT_CAPTURE_FILE, "wb" );
+        configASSERT( pxCaptureFile != NULL );
+        Capture_Init( &xCapture, Capture_WriteFile, pxCaptureFile );
+    #endif
+
     for( ; ; )
     {
         /* Attempt to establish TLS session with IoT Hub. If connection fails,
@@ -372,16 +1196,22 @@ static void prvAzureDemoTask( void * pvParameters )
          * value is reached. The function returns a failure status if the TCP
          * connection cannot be established to the IoT Hub after the configured
          * number of attempts. */
+        ullConnectStartUs = Clock_GetMonotonicUs();
         ulStatus = prvConnectToServerWithBackoffRetries( ( const char * ) pucIotHubHostname,
                                                          democonfigIOTHUB_PORT,
                                                          &xNetworkCredentials, &xNetworkContext );
         configASSERT( ulStatus == 0 );
+        HubTrace_AddLatency( &xTrace, eHubTraceConnect, Clock_GetMonotonicUs() - ullConnectStartUs );
 
         /* Fill in Transport Interface send and receive function pointers. */
         xTransport.pxNetworkContext = &xNetworkContext;
         xTransport.xSend = TLS_Socket_Send;
         xTransport.xRecv = TLS_Socket_Recv;
 
+        #ifdef democonfigTRANSPORT_CAPTURE_FILE
+            Capture_Wrap( &xCapture, &xTransport );
+        #endif
+
         /* Init IoT Hub option */
         xResult = AzureIoTHubClient_OptionsInit( &xHubOptions );
         configASSERT( xResult == eAzureIoTSuccess );
@@ -390,6 +1220,7 @@ static void prvAzureDemoTask( void * pvParameters )
         xHubOptions.ulModuleIDLength = sizeof( democonfigMODULE_ID ) - 1;
         xHubOptions.pucModelID = ( const uint8_t * ) sampleazureiotMODEL_ID;
         xHubOptions.ulModelIDLength = sizeof( sampleazureiotMODEL_ID ) - 1;
+        xHubOptions.xTelemetryCallback = prvHandleTelemetryAck;
 
         xResult = AzureIoTHubClient_Init( &xAzureIoTHubClient,
                                           pucIotHubHostname, pulIothubHostnameLength,
@@ -400,6 +1231,12 @@ static void prvAzureDemoTask( void * pvParameters )
                                           &xTransport );
         configASSERT( xResult == eAzureIoTSuccess );
 
+        xResult = HubReporter_Init( &xReporter, &xAzureIoTHubClient,
+                                    ucReportedPropertiesPatch, sizeof( ucReportedPropertiesPatch ),
+                                    sampleazureiotREPORTED_PROPERTIES_WINDOW_MS );
+        configASSERT( xResult == eAzureIoTSuccess );
+        HubReporter_SetResponseCallback( &xReporter, prvHandleReportedResponse, NULL );
+
         #ifdef democonfigDEVICE_SYMMETRIC_KEY
             xResult = AzureIoTHubClient_SetSymmetricKey( &xAzureIoTHubClient,
                                                          ( const uint8_t * ) democonfigDEVICE_SYMMETRIC_KEY,
@@ -417,12 +1254,16 @@ static void prvAzureDemoTask( void * pvParameters )
                                              sampleazureiotCONNACK_RECV_TIMEOUT_MS );
         configASSERT( xResult == eAzureIoTSuccess );
 
-        xResult = AzureIoTHubClient_SubscribeCommand( &xAzureIoTHubClient, prvHandleCommand,
-                                                      &xAzureIoTHubClient, sampleazureiotSUBSCRIBE_TIMEOUT );
-        configASSERT( xResult == eAzureIoTSuccess );
+        #ifdef democonfigASYNC_COMMANDS
+            xSubscriptions.xCommandCallback = prvDispatchCommand;
+        #else
+            xSubscriptions.xCommandCallback = prvHandleCommand;
+        #endif
+        xSubscriptions.xPropertiesCallback = prvHandleProperties;
+        xSubscriptions.pvCallbackContext = &xAzureIoTHubClient;
+        xSubscriptions.ulSubscribeTimeoutMs = sampleazureiotSUBSCRIBE_TIMEOUT;
 
-        xResult = AzureIoTHubClient_SubscribeProperties( &xAzureIoTHubClient, prvHandleProperties,
-                                                         &xAzureIoTHubClient, sampleazureiotSUBSCRIBE_TIMEOUT );
+        xResult = HubSubscribe_All( &xAzureIoTHubClient, &xSubscriptions, NULL );
         configASSERT( xResult == eAzureIoTSuccess );
 
         /* Get property document after initial connection */
@@ -433,29 +1274,106 @@ static void prvAzureDemoTask( void * pvParameters )
         for( ; ; )
         {
             /* Hook for sending Telemetry */
-            if( ( ulCreateTelemetry( ucScratchBuffer, sizeof( ucScratchBuffer ), &ulScratchBufferLength ) == 0 ) &&
-                ( ulScratchBufferLength > 0 ) )
+            xScratchMark = ScratchArena_Mark( &xScratchArena );
+
+            #ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+                /* The latest sample of the producer task, swapped in once the
+                 * interval picked by the rate controller passed. */
+                pucTelemetryData = prvTelemetryDue() ?
+                                   DoubleBuffer_Front( &xTelemetryDoubleBuffer, &ulScratchBufferLength,
+                                                       sampleazureiotTELEMETRY_SWAP_WAIT_TICKS ) : NULL;
+
+                if( pucTelemetryData != NULL )
+                {
+                    xResult = prvSendTelemetry( pucTelemetryData, ulScratchBufferLength );
+                    DoubleBuffer_Release( &xTelemetryDoubleBuffer );
+                    configASSERT( xResult == eAzureIoTSuccess );
+                }
+            #else
+                pucScratchBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotTELEMETRY_BUFFER_SIZE );
+                configASSERT( pucScratchBuffer != NULL );
+
+                /* Sent once the interval picked by the rate controller
+                 * passed, skipped while a command worker holds the data. */
+                if( !prvTelemetryDue() )
+                {
+                    LogDebug( ( "Telemetry not due yet" ) );
+                }
+                else if( sampleazureiotTRY_LOCK_DATA() )
+                {
+                    ulStatus = ulCreateTelemetry( pucScratchBuffer, sampleazureiotTELEMETRY_BUFFER_SIZE, &ulScratchBufferLength );
+                    sampleazureiotUNLOCK_DATA();
+
+                    if( ( ulStatus == 0 ) && ( ulScratchBufferLength > 0 ) )
+                    {
+                        xResult = prvSendTelemetry( pucScratchBuffer, ulScratchBufferLength );
+                        configASSERT( xResult == eAzureIoTSuccess );
+                    }
+                }
+                else
+                {
+                    ulTelemetrySkipped++;
+                    LogWarn( ( "Telemetry skipped, a command holds the data (%u in this rate interval)",
+                               ( unsigned ) ulTelemetrySkipped ) );
+                }
+            #endif /* democonfigTELEMETRY_DOUBLE_BUFFER */
+
+            ScratchArena_Reset( &xScratchArena, xScratchMark );
+
+            /* Hook for sending update to reported properties, merged with
+             * other updates until the reporting window has passed. */
+            pucScratchBuffer = ScratchArena_Alloc( &xScratchArena, sampleazureiotREPORTED_PROPERTIES_UPDATE_SIZE );
+            configASSERT( pucScratchBuffer != NULL );
+
+            ulScratchBufferLength = 0;
+
+            if( sampleazureiotTRY_LOCK_DATA() )
             {
-                xResult = AzureIoTHubClient_SendTelemetry( &xAzureIoTHubClient,
-                                                           ucScratchBuffer, ulScratchBufferLength,
-                                                           NULL, eAzureIoTHubMessageQoS1, NULL );
-                configASSERT( xResult == eAzureIoTSuccess );
+                ulScratchBufferLength = ulCreateReportedPropertiesUpdate( pucScratchBuffer, sampleazureiotREPORTED_PROPERTIES_UPDATE_SIZE );
+                sampleazureiotUNLOCK_DATA();
             }
 
-            /* Hook for sending update to reported properties */
-            ulReportedPropertiesUpdateLength = ulCreateReportedPropertiesUpdate( ucReportedPropertiesUpdate, sizeof( ucReportedPropertiesUpdate ) );
-
-            if( ulReportedPropertiesUpdateLength > 0 )
+            if( ulScratchBufferLength > 0 )
             {
-                xResult = AzureIoTHubClient_SendPropertiesReported( &xAzureIoTHubClient, ucReportedPropertiesUpdate, ulReportedPropertiesUpdateLength, NULL );
-                configASSERT( xResult == eAzureIoTSuccess );
+                xResult = HubReporter_MergePatch( &xReporter, pucScratchBuffer, ulScratchBufferLength );
+
+                if( xResult != eAzureIoTSuccess )
+                {
+                    LogError( ( "There was an error queuing the reported properties: 0x%08x", xResult ) );
+                }
             }
 
+            ScratchArena_Reset( &xScratchArena, xScratchMark );
+
             LogInfo( ( "Attempt to receive publish message from IoT Hub.\r\n" ) );
             xResult = AzureIoTHubClient_ProcessLoop( &xAzureIoTHubClient,
                                                      sampleazureiotPROCESS_LOOP_TIMEOUT_MS );
             configASSERT( xResult == eAzureIoTSuccess );
 
+            #if defined( democonfigTELEMETRY_DOUBLE_BUFFER ) || defined( democonfigASYNC_COMMANDS )
+                prvProcessDeferredProperties();
+            #endif
+
+            xResult = HubReporter_Process( &xReporter );
+            configASSERT( xResult == eAzureIoTSuccess );
+
+            #ifdef democonfigASYNC_COMMANDS
+                /* A failed response only loses that response, IoT Hub
+                 * answers the caller with a timeout. */
+                if( HubCommand_Process( &xCommandPool ) != eAzureIoTSuccess )
+                {
+                    LogError( ( "Some command responses could not be sent" ) );
+                }
+                prvLogCommandStats();
+            #endif
+
+            prvPublishLatencyTrace();
+            prvLogTelemetryRate();
+
+            #ifdef democonfigHEALTH_MONITOR_INTERVAL_MS
+                prvPublishHealth();
+            #endif
+
             /* Leave Connection Idle for some time. */
             LogInfo( ( "Keeping Connection Idle...\r\n\r\n" ) );
             vTaskDelay( sampleazureiotDELAY_BETWEEN_PUBLISHES_TICKS );
@@ -476,6 +1394,12 @@ static void prvAzureDemoTask( void * pvParameters )
 
         /* Close the network connection.  */
         TLS_Socket_Disconnect( &xNetworkContext );
+        ( void ) prvEndTelemetryInFlight( true );
+
+        #ifdef democonfigTRANSPORT_CAPTURE_FILE
+            LogInfo( ( "Captured %u bytes sent and %u received to " democonfigTRANSPORT_CAPTURE_FILE "\r\n",
+                       ( unsigned ) xCapture.xBytesSent, ( unsigned ) xCapture.xBytesReceived ) );
+        #endif
 
         /* Wait for some time between two iterations to ensure that we do not
          * bombard the IoT Hub. */
@@ -646,6 +1570,23 @@ static uint32_t prvConnectToServerWithBackoffRetries( const char * pcHostName,
  */
 void vStartDemoTask( void )
 {
+    #if defined( democonfigTELEMETRY_DOUBLE_BUFFER ) || defined( democonfigASYNC_COMMANDS )
+        /* Created before any task of the sample runs. */
+        xDataMutex = xSemaphoreCreateMutexStatic( &xDataMutexBuffer );
+        configASSERT( xDataMutex != NULL );
+    #endif
+
+    #ifdef democonfigTELEMETRY_DOUBLE_BUFFER
+        DoubleBuffer_Init( &xTelemetryDoubleBuffer, ucTelemetryBuffers, sizeof( ucTelemetryBuffers ) );
+
+        xTaskCreate( prvTelemetryProducerTask, /* Function that implements the task. */
+                     "TelemetryProducer",      /* Text name for the task - only used for debugging. */
+                     democonfigDEMO_STACKSIZE, /* Size of stack (in words, not bytes) to allocate for the task. */
+                     NULL,                     /* Task parameter - not used in this case. */
+                     tskIDLE_PRIORITY,         /* Task priority, must be between 0 and configMAX_PRIORITIES - 1. */
+                     NULL );                   /* Used to pass out a handle to the created task - not used in this case. */
+    #endif
+
     /* This example uses a single application task, which in turn is used to
      * connect, subscribe, publish, unsubscribe and disconnect from the IoT Hub */
     xTaskCreate( prvAzureDemoTask,         /* Function that implements the task. */
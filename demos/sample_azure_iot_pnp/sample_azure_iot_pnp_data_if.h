@@ -28,6 +28,8 @@ extern AzureIoTHubClient_t xAzureIoTHubClient;
  *
  * @remark This function must be implemented by the specific sample.
  *         `ulCreateTelemetry` is called periodically by the sample core task (the task created by `vStartDemoTask`). 
+ *         When `democonfigTELEMETRY_DOUBLE_BUFFER` is defined it is called periodically by a producer task instead,
+ *         never at the same time as the other functions of this interface.
  *         If `pulTelemetryDataLength` returned is zero, telemetry is not send to the Azure IoT Hub.
  *
  * @param[out]  pucTelemetryData        Pointer to uint8_t* that will contain the Telemetry payload.
@@ -40,6 +42,32 @@ uint32_t ulCreateTelemetry( uint8_t * pucTelemetryData,
                             uint32_t ulTelemetryDataSize,
                             uint32_t * pulTelemetryDataLength );
 
+/**
+ * @brief Provides the nominal interval between telemetry messages.
+ *
+ * @remark This function must be implemented by the specific sample.
+ *         It is called after `vHandleWritableProperties`, so the interval can follow a writable property.
+ *         The sample core lengthens it while the link to the Azure IoT Hub is congested, and calls
+ *         `ulCreateTelemetry` no more often than the resulting interval.
+ *
+ * @return uint32_t Interval in milliseconds.
+ */
+uint32_t ulGetTelemetryIntervalMs( void );
+
+/**
+ * @brief Provides the strings expected in the telemetry payload, used to compress it.
+ *
+ * @remark This function must be implemented by the specific sample when
+ *         `democonfigENABLE_TELEMETRY_COMPRESSION` is defined.
+ *         The dictionary must not change while the device is deployed, the
+ *         cloud side needs the same bytes to decompress the telemetry.
+ *
+ * @param[out] ppucDictionary Pointer to the dictionary.
+ *
+ * @return uint32_t Length of the dictionary.
+ */
+uint32_t ulGetTelemetryDictionary( const uint8_t ** ppucDictionary );
+
 /**
  * @brief Provides the payload to be sent as reported properties update to the Azure IoT Hub.
  *
@@ -61,6 +89,9 @@ uint32_t ulCreateReportedPropertiesUpdate( uint8_t * pucPropertiesData,
  * @brief Handles a Command received from the Azure IoT Hub.
  * 
  * @remark This function must be implemented by the specific sample.
+ *         When `democonfigASYNC_COMMANDS` is defined it is called by a worker task instead of the sample core task,
+ *         never at the same time as the other functions of this interface. The core task skips its periodic calls
+ *         while a command runs, only a properties message waits for the command to return.
  *
  * @param[in]  pxMessage                          Pointer to a structure that holds details of the Command.
  * @param[out] pulResponseStatus                  Status code to be sent as response for Command request.
@@ -61,6 +61,17 @@
  */
 #define sampleazureiotMESSAGE                             "{\"" sampleazureiotTELEMETRY_NAME "\":%0.2f}"
 
+/**
+ * @brief Nominal interval between telemetry messages.
+ */
+#define sampleazureiotTELEMETRY_INTERVAL_MS               ( 2000U )
+
+
+/**
+ * @brief Compression dictionary, the telemetry payload without its value.
+ */
+#define sampleazureiotTELEMETRY_DICTIONARY                "{\"" sampleazureiotTELEMETRY_NAME "\":}"
+
 
 /* Device values */
 static double xDeviceCurrentTemperature = sampleazureiotDEFAULT_START_TEMP_CELSIUS;
@@ -489,6 +500,30 @@ uint32_t ulCreateTelemetry( uint8_t * pucTelemetryData,
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Implements the sample interface for the telemetry interval.
+ */
+uint32_t ulGetTelemetryIntervalMs( void )
+{
+    return sampleazureiotTELEMETRY_INTERVAL_MS;
+}
+/*-----------------------------------------------------------*/
+
+#ifdef democonfigENABLE_TELEMETRY_COMPRESSION
+
+/**
+ * @brief Implements the sample interface for the telemetry compression dictionary.
+ */
+    uint32_t ulGetTelemetryDictionary( const uint8_t ** ppucDictionary )
+    {
+        *ppucDictionary = ( const uint8_t * ) sampleazureiotTELEMETRY_DICTIONARY;
+
+        return sizeof( sampleazureiotTELEMETRY_DICTIONARY ) - 1;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* democonfigENABLE_TELEMETRY_COMPRESSION */
+
 /**
  * @brief Implements the sample interface for generating reported properties payload.
  */
@@ -0,0 +1,46 @@
+#! /bin/bash
+
+# Copyright (c) Microsoft. All rights reserved.
+# Licensed under the MIT license. See LICENSE file in the project root for full license information.
+#
+# gen_certs.sh [output directory] [subject alternative names]
+#
+# Creates a test root CA and a server certificate signed by it for the hub
+# stand-in, and root_ca_pem.h with the CA as a C string for democonfigROOT_CA_PEM.
+# The names default to "DNS:localhost,IP:127.0.0.1"; the address the device
+# connects to must be one of them.
+
+set -o errexit # Exit if command failed.
+set -o nounset # Exit if variable not set.
+set -o pipefail # Exit if pipe failed.
+
+OUT_DIR=${1:-"."}
+SUBJECT_ALT_NAMES=${2:-"DNS:localhost,IP:127.0.0.1"}
+
+mkdir -p "$OUT_DIR"
+cd "$OUT_DIR"
+
+openssl req -x509 -newkey rsa:2048 -nodes -days 365 -sha256 \
+    -subj "/CN=Hub Standin Test Root CA" \
+    -addext "basicConstraints=critical,CA:TRUE" \
+    -addext "keyUsage=critical,keyCertSign,cRLSign" \
+    -keyout ca.key -out ca.pem
+
+openssl req -newkey rsa:2048 -nodes -sha256 \
+    -subj "/CN=hub-standin" \
+    -keyout server.key -out server.csr
+
+printf "subjectAltName=%s\nextendedKeyUsage=serverAuth\n" "$SUBJECT_ALT_NAMES" > server.ext
+
+openssl x509 -req -in server.csr -CA ca.pem -CAkey ca.key -CAcreateserial \
+    -days 365 -sha256 -extfile server.ext -out server.pem
+
+rm -f server.csr server.ext ca.srl
+
+{
+    echo "#define democonfigROOT_CA_PEM \\"
+    sed -e 's/^/    "/' -e 's/$/\\n" \\/' ca.pem
+    echo "    \"\""
+} > root_ca_pem.h
+
+echo "Server: server.pem server.key, device root CA: ca.pem and root_ca_pem.h in $(pwd)"
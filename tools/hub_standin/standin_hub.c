@@ -0,0 +1,1113 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file standin_hub.c
+ * @brief IoT Hub and DPS behaviour of the stand-in server.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "standin_hub.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Largest payload built by the server.
+ */
+#define standinMAX_PAYLOAD    ( 32U * 1024U )
+
+/**
+ * @brief A top level member of a JSON object, stored as its raw text.
+ */
+typedef struct StandinMember
+{
+    char * pcKey;     /**< @brief Key without the quotes, escapes kept. */
+    char * pcValue;   /**< @brief Raw JSON value. */
+    struct StandinMember * pxNext;
+} StandinMember_t;
+
+/**
+ * @brief Twin and session of one device, kept across connections.
+ */
+struct StandinDevice
+{
+    char cDeviceId[ STANDIN_HUB_MAX_ID_LENGTH ];
+    StandinMember_t * pxReported;
+    uint32_t ulReportedVersion;
+    StandinSession_t xSession;
+    StandinDevice_t * pxNext;
+};
+
+static const StandinConfig_t * pxStandinConfig;
+static StandinStats_t xStats;
+static StandinDevice_t * pxDevices;
+static StandinMember_t * pxDesired;
+static uint32_t ulDesiredVersion = 1;
+static uint32_t ulRandomState;
+static uint32_t ulOperationCount;
+
+static char cTopic[ 512 ];
+static char cPayload[ standinMAX_PAYLOAD ];
+static uint8_t ucPacket[ standinMAX_PAYLOAD + sizeof( cTopic ) + 16 ];
+/*-----------------------------------------------------------*/
+
+static void prvLog( const StandinClient_t * pxClient,
+                    const char * pcFormat,
+                    ... )
+{
+    va_list xArgs;
+
+    if( !pxStandinConfig->xVerbose )
+    {
+        return;
+    }
+
+    printf( "[%s] ", ( pxClient->cClientId[ 0 ] != '\0' ) ? pxClient->cClientId : "-" );
+    va_start( xArgs, pcFormat );
+    vprintf( pcFormat, xArgs );
+    va_end( xArgs );
+    printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief xorshift32, deterministic for a given seed.
+ */
+static uint32_t prvRandom( void )
+{
+    ulRandomState ^= ulRandomState << 13;
+    ulRandomState ^= ulRandomState >> 17;
+    ulRandomState ^= ulRandomState << 5;
+
+    return ulRandomState;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvDelay( void )
+{
+    uint32_t ulDelayMs = pxStandinConfig->ulLatencyMs;
+
+    if( pxStandinConfig->ulJitterMs > 0 )
+    {
+        ulDelayMs += prvRandom() % ( pxStandinConfig->ulJitterMs + 1U );
+    }
+
+    return ulDelayMs;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvLost( void )
+{
+    if( ( pxStandinConfig->ulLossPercent > 0 ) &&
+        ( prvRandom() % 100U < pxStandinConfig->ulLossPercent ) )
+    {
+        xStats.ullDropped++;
+        return true;
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a slot of the publish rate limit.
+ *
+ * @return Time until the slot, 0 if the publish is within the limit.
+ */
+static uint32_t prvThrottle( StandinClient_t * pxClient,
+                             uint64_t ullNowMs )
+{
+    uint64_t ullSlotMs;
+
+    if( pxStandinConfig->ulThrottlePerSecond == 0 )
+    {
+        return 0;
+    }
+
+    ullSlotMs = ( pxClient->ullThrottleSlotMs > ullNowMs ) ? pxClient->ullThrottleSlotMs : ullNowMs;
+    pxClient->ullThrottleSlotMs = ullSlotMs + 1000U / pxStandinConfig->ulThrottlePerSecond;
+
+    if( ullSlotMs > ullNowMs )
+    {
+        xStats.ullThrottled++;
+    }
+
+    return ( uint32_t ) ( ullSlotMs - ullNowMs );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSendPacket( StandinClient_t * pxClient,
+                           size_t xLength,
+                           uint32_t ulExtraDelayMs )
+{
+    if( xLength > 0 )
+    {
+        pxClient->xSend( pxClient->pvConnection, ucPacket, xLength, prvDelay() + ulExtraDelayMs );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Clear a session, as for a connection with clean session 1.
+ */
+static void prvResetSession( StandinSession_t * pxSession )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < STANDIN_HUB_MAX_UNACKED; ulIndex++ )
+    {
+        free( pxSession->xUnacked[ ulIndex ].pucPacket );
+    }
+
+    memset( pxSession, 0, sizeof( StandinSession_t ) );
+    pxSession->usNextPacketId = 1;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Keep a copy of the QoS 1 PUBLISH in ucPacket until its PUBACK.
+ */
+static void prvKeepUnacked( StandinClient_t * pxClient,
+                            uint16_t usPacketId,
+                            size_t xLength )
+{
+    StandinUnacked_t * pxUnacked = NULL;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ( ulIndex < STANDIN_HUB_MAX_UNACKED ) && ( pxUnacked == NULL ); ulIndex++ )
+    {
+        if( pxClient->pxSession->xUnacked[ ulIndex ].pucPacket == NULL )
+        {
+            pxUnacked = &pxClient->pxSession->xUnacked[ ulIndex ];
+        }
+    }
+
+    if( ( pxUnacked == NULL ) || ( ( pxUnacked->pucPacket = malloc( xLength ) ) == NULL ) )
+    {
+        prvLog( pxClient, "not keeping PUBLISH %u for redelivery", ( unsigned ) usPacketId );
+        return;
+    }
+
+    memcpy( pxUnacked->pucPacket, ucPacket, xLength );
+    pxUnacked->xLength = xLength;
+    pxUnacked->usPacketId = usPacketId;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Send the unacknowledged QoS 1 messages of a resumed session again,
+ * with the DUP flag and their original packet identifiers.
+ */
+static void prvRedeliver( StandinClient_t * pxClient )
+{
+    StandinUnacked_t * pxUnacked;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < STANDIN_HUB_MAX_UNACKED; ulIndex++ )
+    {
+        pxUnacked = &pxClient->pxSession->xUnacked[ ulIndex ];
+
+        if( pxUnacked->pucPacket != NULL )
+        {
+            memcpy( ucPacket, pxUnacked->pucPacket, pxUnacked->xLength );
+            ucPacket[ 0 ] |= 0x08U; /* DUP */
+            prvLog( pxClient, "redelivering PUBLISH %u", ( unsigned ) pxUnacked->usPacketId );
+            prvSendPacket( pxClient, pxUnacked->xLength, 0 );
+            xStats.ullRedelivered++;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandlePuback( StandinClient_t * pxClient,
+                             uint16_t usPacketId )
+{
+    StandinUnacked_t * pxUnacked;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < STANDIN_HUB_MAX_UNACKED; ulIndex++ )
+    {
+        pxUnacked = &pxClient->pxSession->xUnacked[ ulIndex ];
+
+        if( ( pxUnacked->pucPacket != NULL ) && ( pxUnacked->usPacketId == usPacketId ) )
+        {
+            free( pxUnacked->pucPacket );
+            pxUnacked->pucPacket = NULL;
+            break;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvPublish( StandinClient_t * pxClient,
+                        const char * pcPayload,
+                        size_t xPayloadLength,
+                        uint8_t ucQoS )
+{
+    StandinSession_t * pxSession = pxClient->pxSession;
+    uint16_t usPacketId = 0;
+    size_t xLength;
+
+    if( ucQoS > 0 )
+    {
+        usPacketId = pxSession->usNextPacketId++;
+
+        if( pxSession->usNextPacketId == 0 )
+        {
+            pxSession->usNextPacketId = 1;
+        }
+    }
+
+    xLength = StandinMqtt_EncodePublish( ucPacket, sizeof( ucPacket ), cTopic, strlen( cTopic ),
+                                         ( const uint8_t * ) pcPayload, xPayloadLength,
+                                         ucQoS, usPacketId );
+
+    /* A lost QoS 1 message stays unacknowledged, so a resumed session
+     * delivers it again. */
+    if( ( ucQoS > 0 ) && ( xLength > 0 ) && ( pxClient->pxDevice != NULL ) )
+    {
+        prvKeepUnacked( pxClient, usPacketId, xLength );
+    }
+
+    if( prvLost() )
+    {
+        prvLog( pxClient, "dropped PUBLISH %s", cTopic );
+        return;
+    }
+
+    prvLog( pxClient, "PUBLISH %s %.*s", cTopic, ( int ) xPayloadLength, pcPayload );
+    prvSendPacket( pxClient, xLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append formatted text, returning false once the buffer is full.
+ */
+static bool prvAppend( char * pcBuffer,
+                       size_t xBufferSize,
+                       size_t * pxLength,
+                       const char * pcFormat,
+                       ... )
+{
+    va_list xArgs;
+    int lWritten;
+
+    if( *pxLength >= xBufferSize )
+    {
+        return false;
+    }
+
+    va_start( xArgs, pcFormat );
+    lWritten = vsnprintf( &pcBuffer[ *pxLength ], xBufferSize - *pxLength, pcFormat, xArgs );
+    va_end( xArgs );
+
+    if( ( lWritten < 0 ) || ( ( size_t ) lWritten >= xBufferSize - *pxLength ) )
+    {
+        *pxLength = xBufferSize;
+        return false;
+    }
+
+    *pxLength += ( size_t ) lWritten;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copy the value of a query parameter of a topic, such as "$rid".
+ */
+static bool prvTopicParameter( const StandinSpan_t * pxTopic,
+                               const char * pcName,
+                               char * pcValue,
+                               size_t xValueSize )
+{
+    size_t xNameLength = strlen( pcName );
+    size_t xIndex;
+    size_t xLength = 0;
+
+    for( xIndex = 0; xIndex + xNameLength + 1 < pxTopic->xLength; xIndex++ )
+    {
+        if( ( ( pxTopic->pcData[ xIndex ] == '?' ) || ( pxTopic->pcData[ xIndex ] == '&' ) ) &&
+            ( memcmp( &pxTopic->pcData[ xIndex + 1 ], pcName, xNameLength ) == 0 ) &&
+            ( pxTopic->pcData[ xIndex + 1 + xNameLength ] == '=' ) )
+        {
+            xIndex += xNameLength + 2;
+
+            while( ( xIndex < pxTopic->xLength ) && ( pxTopic->pcData[ xIndex ] != '&' ) &&
+                   ( xLength + 1 < xValueSize ) )
+            {
+                pcValue[ xLength++ ] = pxTopic->pcData[ xIndex++ ];
+            }
+
+            pcValue[ xLength ] = '\0';
+
+            return true;
+        }
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+/* JSON: only what is needed to merge the top level members of objects. */
+
+static const char * prvSkipSpace( const char * pcJson,
+                                  const char * pcEnd )
+{
+    while( ( pcJson < pcEnd ) && ( ( *pcJson == ' ' ) || ( *pcJson == '\t' ) ||
+                                   ( *pcJson == '\r' ) || ( *pcJson == '\n' ) ) )
+    {
+        pcJson++;
+    }
+
+    return pcJson;
+}
+/*-----------------------------------------------------------*/
+
+static const char * prvSkipString( const char * pcJson,
+                                   const char * pcEnd )
+{
+    for( pcJson++; pcJson < pcEnd; pcJson++ )
+    {
+        if( *pcJson == '\\' )
+        {
+            pcJson++;
+        }
+        else if( *pcJson == '"' )
+        {
+            return pcJson + 1;
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static const char * prvSkipValue( const char * pcJson,
+                                  const char * pcEnd )
+{
+    uint32_t ulDepth = 0;
+
+    if( pcJson >= pcEnd )
+    {
+        return NULL;
+    }
+
+    if( *pcJson == '"' )
+    {
+        return prvSkipString( pcJson, pcEnd );
+    }
+
+    if( ( *pcJson != '{' ) && ( *pcJson != '[' ) )
+    {
+        /* Number, true, false or null. */
+        while( ( pcJson < pcEnd ) && ( strchr( ",}] \t\r\n", *pcJson ) == NULL ) )
+        {
+            pcJson++;
+        }
+
+        return pcJson;
+    }
+
+    while( pcJson < pcEnd )
+    {
+        if( *pcJson == '"' )
+        {
+            if( ( pcJson = prvSkipString( pcJson, pcEnd ) ) == NULL )
+            {
+                return NULL;
+            }
+
+            continue;
+        }
+
+        if( ( *pcJson == '{' ) || ( *pcJson == '[' ) )
+        {
+            ulDepth++;
+        }
+        else if( ( ( *pcJson == '}' ) || ( *pcJson == ']' ) ) && ( --ulDepth == 0 ) )
+        {
+            return pcJson + 1;
+        }
+
+        pcJson++;
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static char * prvCopy( const char * pcData,
+                       size_t xLength )
+{
+    char * pcCopy = malloc( xLength + 1 );
+
+    if( pcCopy != NULL )
+    {
+        memcpy( pcCopy, pcData, xLength );
+        pcCopy[ xLength ] = '\0';
+    }
+
+    return pcCopy;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetMember( StandinMember_t ** ppxMembers,
+                          const char * pcKey,
+                          size_t xKeyLength,
+                          const char * pcValue,
+                          size_t xValueLength )
+{
+    StandinMember_t ** ppxMember;
+    StandinMember_t * pxMember;
+    bool xDelete = ( xValueLength == 4 ) && ( memcmp( pcValue, "null", 4 ) == 0 );
+
+    for( ppxMember = ppxMembers; *ppxMember != NULL; ppxMember = &( *ppxMember )->pxNext )
+    {
+        if( ( strlen( ( *ppxMember )->pcKey ) == xKeyLength ) &&
+            ( memcmp( ( *ppxMember )->pcKey, pcKey, xKeyLength ) == 0 ) )
+        {
+            break;
+        }
+    }
+
+    pxMember = *ppxMember;
+
+    if( xDelete )
+    {
+        if( pxMember != NULL )
+        {
+            *ppxMember = pxMember->pxNext;
+            free( pxMember->pcKey );
+            free( pxMember->pcValue );
+            free( pxMember );
+        }
+
+        return;
+    }
+
+    if( pxMember == NULL )
+    {
+        if( ( pxMember = calloc( 1, sizeof( StandinMember_t ) ) ) == NULL )
+        {
+            return;
+        }
+
+        pxMember->pcKey = prvCopy( pcKey, xKeyLength );
+        *ppxMember = pxMember;
+    }
+
+    free( pxMember->pcValue );
+    pxMember->pcValue = prvCopy( pcValue, xValueLength );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Merge the top level members of a JSON object into a member list.
+ * Members set to null are removed and metadata members ("$...") ignored.
+ *
+ * @return false if the text is not a JSON object.
+ */
+static bool prvMergeObject( StandinMember_t ** ppxMembers,
+                            const char * pcJson,
+                            size_t xLength )
+{
+    const char * pcEnd = pcJson + xLength;
+    const char * pcKey;
+    const char * pcKeyEnd;
+    const char * pcValue;
+
+    pcJson = prvSkipSpace( pcJson, pcEnd );
+
+    if( ( pcJson >= pcEnd ) || ( *pcJson != '{' ) )
+    {
+        return false;
+    }
+
+    pcJson = prvSkipSpace( pcJson + 1, pcEnd );
+
+    while( ( pcJson < pcEnd ) && ( *pcJson != '}' ) )
+    {
+        if( ( *pcJson != '"' ) || ( ( pcKeyEnd = prvSkipString( pcJson, pcEnd ) ) == NULL ) )
+        {
+            return false;
+        }
+
+        pcKey = pcJson + 1;
+        pcJson = prvSkipSpace( pcKeyEnd, pcEnd );
+
+        if( ( pcJson >= pcEnd ) || ( *pcJson != ':' ) )
+        {
+            return false;
+        }
+
+        pcValue = prvSkipSpace( pcJson + 1, pcEnd );
+
+        if( ( pcJson = prvSkipValue( pcValue, pcEnd ) ) == NULL )
+        {
+            return false;
+        }
+
+        if( *pcKey != '$' )
+        {
+            prvSetMember( ppxMembers, pcKey, ( size_t ) ( pcKeyEnd - 1 - pcKey ),
+                          pcValue, ( size_t ) ( pcJson - pcValue ) );
+        }
+
+        pcJson = prvSkipSpace( pcJson, pcEnd );
+
+        if( ( pcJson < pcEnd ) && ( *pcJson == ',' ) )
+        {
+            pcJson = prvSkipSpace( pcJson + 1, pcEnd );
+        }
+    }
+
+    return pcJson < pcEnd;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append a member list and its version as a JSON object.
+ */
+static bool prvAppendObject( char * pcBuffer,
+                             size_t xBufferSize,
+                             size_t * pxLength,
+                             const StandinMember_t * pxMembers,
+                             uint32_t ulVersion )
+{
+    bool xResult = prvAppend( pcBuffer, xBufferSize, pxLength, "{" );
+
+    for( ; xResult && ( pxMembers != NULL ); pxMembers = pxMembers->pxNext )
+    {
+        xResult = prvAppend( pcBuffer, xBufferSize, pxLength, "\"%s\":%s,", pxMembers->pcKey, pxMembers->pcValue );
+    }
+
+    return xResult && prvAppend( pcBuffer, xBufferSize, pxLength, "\"$version\":%u}", ( unsigned ) ulVersion );
+}
+/*-----------------------------------------------------------*/
+
+static StandinDevice_t * prvGetDevice( const char * pcDeviceId )
+{
+    StandinDevice_t * pxDevice;
+
+    for( pxDevice = pxDevices; pxDevice != NULL; pxDevice = pxDevice->pxNext )
+    {
+        if( strcmp( pxDevice->cDeviceId, pcDeviceId ) == 0 )
+        {
+            return pxDevice;
+        }
+    }
+
+    if( ( pxDevice = calloc( 1, sizeof( StandinDevice_t ) ) ) != NULL )
+    {
+        snprintf( pxDevice->cDeviceId, sizeof( pxDevice->cDeviceId ), "%s", pcDeviceId );
+        pxDevice->ulReportedVersion = 1;
+        pxDevice->pxNext = pxDevices;
+        pxDevices = pxDevice;
+    }
+
+    return pxDevice;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleTwinGet( StandinClient_t * pxClient,
+                              const StandinMqttPacket_t * pxPacket )
+{
+    char cRequestId[ 32 ] = "";
+    size_t xLength = 0;
+
+    xStats.ullTwinGets++;
+    ( void ) prvTopicParameter( &pxPacket->xTopic, "$rid", cRequestId, sizeof( cRequestId ) );
+
+    if( prvAppend( cPayload, sizeof( cPayload ), &xLength, "{\"desired\":" ) &&
+        prvAppendObject( cPayload, sizeof( cPayload ), &xLength, pxDesired, ulDesiredVersion ) &&
+        prvAppend( cPayload, sizeof( cPayload ), &xLength, ",\"reported\":" ) &&
+        prvAppendObject( cPayload, sizeof( cPayload ), &xLength, pxClient->pxDevice->pxReported,
+                         pxClient->pxDevice->ulReportedVersion ) &&
+        prvAppend( cPayload, sizeof( cPayload ), &xLength, "}" ) )
+    {
+        snprintf( cTopic, sizeof( cTopic ), "$iothub/twin/res/200/?$rid=%s", cRequestId );
+    }
+    else
+    {
+        snprintf( cTopic, sizeof( cTopic ), "$iothub/twin/res/500/?$rid=%s", cRequestId );
+        xLength = 0;
+    }
+
+    if( pxClient->pxSession->xTwinResponses )
+    {
+        prvPublish( pxClient, cPayload, xLength, 0 );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleTwinPatch( StandinClient_t * pxClient,
+                                const StandinMqttPacket_t * pxPacket )
+{
+    StandinDevice_t * pxDevice = pxClient->pxDevice;
+    char cRequestId[ 32 ] = "";
+
+    xStats.ullTwinPatches++;
+    ( void ) prvTopicParameter( &pxPacket->xTopic, "$rid", cRequestId, sizeof( cRequestId ) );
+
+    if( prvMergeObject( &pxDevice->pxReported, ( const char * ) pxPacket->pucPayload, pxPacket->xPayloadLength ) )
+    {
+        pxDevice->ulReportedVersion++;
+        snprintf( cTopic, sizeof( cTopic ), "$iothub/twin/res/204/?$rid=%s&$version=%u",
+                  cRequestId, ( unsigned ) pxDevice->ulReportedVersion );
+    }
+    else
+    {
+        snprintf( cTopic, sizeof( cTopic ), "$iothub/twin/res/400/?$rid=%s", cRequestId );
+    }
+
+    if( pxClient->pxSession->xTwinResponses )
+    {
+        prvPublish( pxClient, NULL, 0, 0 );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSendDpsReply( StandinClient_t * pxClient,
+                             const char * pcRequestId,
+                             bool xAssigned )
+{
+    char cTime[ 32 ];
+    size_t xLength = 0;
+    time_t xNow = time( NULL );
+    struct tm xUtc;
+
+    if( !xAssigned )
+    {
+        snprintf( cTopic, sizeof( cTopic ), "$dps/registrations/res/202/?$rid=%s&retry-after=%u",
+                  pcRequestId, ( unsigned ) pxStandinConfig->ulDpsRetryAfterS );
+        ( void ) prvAppend( cPayload, sizeof( cPayload ), &xLength,
+                            "{\"operationId\":\"%s\",\"status\":\"assigning\"}", pxClient->cOperationId );
+    }
+    else
+    {
+        gmtime_r( &xNow, &xUtc );
+        strftime( cTime, sizeof( cTime ), "%Y-%m-%dT%H:%M:%SZ", &xUtc );
+        snprintf( cTopic, sizeof( cTopic ), "$dps/registrations/res/200/?$rid=%s", pcRequestId );
+        ( void ) prvAppend( cPayload, sizeof( cPayload ), &xLength,
+                            "{\"operationId\":\"%s\",\"status\":\"assigned\",\"registrationState\":{"
+                            "\"registrationId\":\"%s\",\"createdDateTimeUtc\":\"%s\",\"assignedHub\":\"%s\","
+                            "\"deviceId\":\"%s\",\"status\":\"assigned\",\"substatus\":\"initialAssignment\","
+                            "\"lastUpdatedDateTimeUtc\":\"%s\",\"etag\":\"IjAwMDAwMDAwLTAwMDAtMDAwMC0wMDAwLTAwMDAwMDAwMDAwMCI=\"}}",
+                            pxClient->cOperationId, pxClient->cClientId, cTime, pxStandinConfig->pcAssignedHub,
+                            pxClient->cClientId, cTime );
+    }
+
+    prvPublish( pxClient, cPayload, xLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleDps( StandinClient_t * pxClient,
+                          const StandinMqttPacket_t * pxPacket,
+                          uint64_t ullNowMs )
+{
+    char cRequestId[ 32 ] = "";
+
+    ( void ) prvTopicParameter( &pxPacket->xTopic, "$rid", cRequestId, sizeof( cRequestId ) );
+
+    /* DPS rejects requests over the limit instead of delaying them. */
+    if( ( pxStandinConfig->ulThrottlePerSecond > 0 ) && ( pxClient->ullThrottleSlotMs > ullNowMs ) )
+    {
+        xStats.ullThrottled++;
+        snprintf( cTopic, sizeof( cTopic ), "$dps/registrations/res/429/?$rid=%s&retry-after=%u",
+                  cRequestId, ( unsigned ) pxStandinConfig->ulDpsRetryAfterS );
+        snprintf( cPayload, sizeof( cPayload ), "{\"errorCode\":429001,\"message\":\"Operations are being throttled.\"}" );
+        prvPublish( pxClient, cPayload, strlen( cPayload ), 0 );
+    }
+    else if( StandinSpan_StartsWith( &pxPacket->xTopic, "$dps/registrations/PUT/iotdps-register/" ) )
+    {
+        ( void ) prvThrottle( pxClient, ullNowMs );
+        xStats.ullDpsRegistrations++;
+        snprintf( pxClient->cOperationId, sizeof( pxClient->cOperationId ), "standin.%08x%08x",
+                  ( unsigned ) ++ulOperationCount, ( unsigned ) prvRandom() );
+        pxClient->ulDpsPolls = 0;
+        prvSendDpsReply( pxClient, cRequestId, false );
+    }
+    else if( StandinSpan_StartsWith( &pxPacket->xTopic, "$dps/registrations/GET/iotdps-get-operationstatus/" ) )
+    {
+        ( void ) prvThrottle( pxClient, ullNowMs );
+        pxClient->ulDpsPolls++;
+        prvSendDpsReply( pxClient, cRequestId, pxClient->ulDpsPolls > pxStandinConfig->ulDpsPolls );
+    }
+    else
+    {
+        prvLog( pxClient, "unknown DPS topic %.*s", ( int ) pxPacket->xTopic.xLength, pxPacket->xTopic.pcData );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Handle a device to cloud PUBLISH.
+ *
+ * @return Delay of its PUBACK caused by the rate limit.
+ */
+static uint32_t prvHandlePublish( StandinClient_t * pxClient,
+                                  const StandinMqttPacket_t * pxPacket,
+                                  uint64_t ullNowMs )
+{
+    const StandinSpan_t * pxTopic = &pxPacket->xTopic;
+    uint32_t ulDelayMs = 0;
+
+    prvLog( pxClient, "received PUBLISH %.*s %.*s", ( int ) pxTopic->xLength, pxTopic->pcData,
+            ( int ) pxPacket->xPayloadLength, ( const char * ) pxPacket->pucPayload );
+
+    if( pxClient->xIsDps )
+    {
+        prvHandleDps( pxClient, pxPacket, ullNowMs );
+    }
+    else if( StandinSpan_StartsWith( pxTopic, "devices/" ) )
+    {
+        /* Telemetry of a device or module; the only device to cloud
+         * publish IoT Hub accepts under devices/. */
+        xStats.ullTelemetry++;
+        xStats.ullTelemetryBytes += pxPacket->xPayloadLength;
+        ulDelayMs = prvThrottle( pxClient, ullNowMs );
+    }
+    else if( StandinSpan_StartsWith( pxTopic, "$iothub/twin/GET/" ) )
+    {
+        prvHandleTwinGet( pxClient, pxPacket );
+    }
+    else if( StandinSpan_StartsWith( pxTopic, "$iothub/twin/PATCH/properties/reported/" ) )
+    {
+        prvHandleTwinPatch( pxClient, pxPacket );
+    }
+    else if( StandinSpan_StartsWith( pxTopic, "$iothub/methods/res/" ) )
+    {
+        xStats.ullMethodResponses++;
+        prvLog( pxClient, "method answered after %u ms", ( unsigned ) ( ullNowMs - pxClient->ullMethodSentMs ) );
+    }
+    else
+    {
+        prvLog( pxClient, "unknown topic %.*s", ( int ) pxTopic->xLength, pxTopic->pcData );
+    }
+
+    return ulDelayMs;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvHandleConnect( StandinClient_t * pxClient,
+                              const StandinMqttPacket_t * pxPacket,
+                              uint64_t ullNowMs )
+{
+    const StandinSpan_t * pxUsername = &pxPacket->xUsername;
+    size_t xIndex;
+    uint8_t ucReturnCode = 0;
+    bool xSessionPresent = false;
+
+    if( ( pxPacket->xClientId.xLength == 0 ) || ( pxPacket->xClientId.xLength >= STANDIN_HUB_MAX_ID_LENGTH ) )
+    {
+        ucReturnCode = 2; /* Identifier rejected. */
+    }
+    else
+    {
+        memcpy( pxClient->cClientId, pxPacket->xClientId.pcData, pxPacket->xClientId.xLength );
+        pxClient->cClientId[ pxPacket->xClientId.xLength ] = '\0';
+
+        /* DPS user names are "{idScope}/registrations/{registrationId}/api-version=...". */
+        for( xIndex = 0; xIndex + 15 <= pxUsername->xLength; xIndex++ )
+        {
+            if( memcmp( &pxUsername->pcData[ xIndex ], "/registrations/", 15 ) == 0 )
+            {
+                pxClient->xIsDps = true;
+                break;
+            }
+        }
+
+        if( !pxClient->xIsDps && ( ( pxClient->pxDevice = prvGetDevice( pxClient->cClientId ) ) == NULL ) )
+        {
+            ucReturnCode = 3; /* Server unavailable. */
+        }
+        else if( !pxClient->xIsDps )
+        {
+            /* The session of the last connection is resumed if both that one
+             * and this one asked for a persistent session. */
+            pxClient->pxSession = &pxClient->pxDevice->xSession;
+            xSessionPresent = !pxPacket->xCleanSession && pxClient->pxSession->xPersistent;
+
+            if( !xSessionPresent )
+            {
+                prvResetSession( pxClient->pxSession );
+            }
+
+            pxClient->pxSession->xPersistent = !pxPacket->xCleanSession;
+        }
+    }
+
+    prvLog( pxClient, "CONNECT %s keep alive %u s, clean session %u, return code %u, session present %u",
+            pxClient->xIsDps ? "DPS" : "hub", ( unsigned ) pxPacket->usKeepAliveS,
+            ( unsigned ) pxPacket->xCleanSession, ( unsigned ) ucReturnCode, ( unsigned ) xSessionPresent );
+
+    prvSendPacket( pxClient, StandinMqtt_EncodeConnack( ucPacket, sizeof( ucPacket ), xSessionPresent, ucReturnCode ), 0 );
+
+    if( ucReturnCode != 0 )
+    {
+        return false;
+    }
+
+    if( xSessionPresent )
+    {
+        xStats.ullSessionsResumed++;
+        prvRedeliver( pxClient );
+    }
+
+    xStats.ullConnects++;
+    pxClient->xConnected = true;
+    pxClient->ulKeepAliveMs = pxPacket->usKeepAliveS * 1000U;
+    pxClient->ullNextC2DMs = ullNowMs + pxStandinConfig->ulC2DIntervalMs;
+    pxClient->ullNextMethodMs = ullNowMs + pxStandinConfig->ulMethodIntervalMs;
+    pxClient->ullNextDesiredMs = ullNowMs + pxStandinConfig->ulDesiredIntervalMs;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleSubscribe( StandinClient_t * pxClient,
+                                const StandinMqttPacket_t * pxPacket,
+                                bool xSubscribe )
+{
+    uint8_t ucReturnCodes[ STANDIN_MQTT_MAX_FILTERS ];
+    const StandinSpan_t * pxFilter;
+    uint32_t ulIndex;
+    size_t xLength;
+
+    if( xSubscribe )
+    {
+        xStats.ullSubscribes++;
+    }
+
+    for( ulIndex = 0; ulIndex < pxPacket->ulFilterCount; ulIndex++ )
+    {
+        pxFilter = &pxPacket->xFilters[ ulIndex ];
+        ucReturnCodes[ ulIndex ] = ( pxPacket->ucFilterQoS[ ulIndex ] > 0 ) ? 1U : 0U;
+
+        prvLog( pxClient, "%s %.*s", xSubscribe ? "SUBSCRIBE" : "UNSUBSCRIBE",
+                ( int ) pxFilter->xLength, pxFilter->pcData );
+
+        if( StandinSpan_StartsWith( pxFilter, "$iothub/methods/POST/" ) )
+        {
+            pxClient->pxSession->xMethods = xSubscribe;
+        }
+        else if( StandinSpan_StartsWith( pxFilter, "$iothub/twin/res/" ) ||
+                 StandinSpan_StartsWith( pxFilter, "$dps/registrations/res/" ) )
+        {
+            pxClient->pxSession->xTwinResponses = xSubscribe;
+        }
+        else if( StandinSpan_StartsWith( pxFilter, "$iothub/twin/PATCH/properties/desired/" ) )
+        {
+            pxClient->pxSession->xDesired = xSubscribe;
+        }
+        else if( StandinSpan_StartsWith( pxFilter, "devices/" ) )
+        {
+            pxClient->pxSession->xC2D = xSubscribe;
+        }
+        else
+        {
+            ucReturnCodes[ ulIndex ] = 0x80U;
+        }
+    }
+
+    xLength = xSubscribe ?
+              StandinMqtt_EncodeSuback( ucPacket, sizeof( ucPacket ), pxPacket->usPacketId,
+                                        ucReturnCodes, pxPacket->ulFilterCount ) :
+              StandinMqtt_EncodeAck( ucPacket, sizeof( ucPacket ), STANDIN_MQTT_UNSUBACK, pxPacket->usPacketId );
+    prvSendPacket( pxClient, xLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
+bool StandinHub_Init( const StandinConfig_t * pxConfig )
+{
+    pxStandinConfig = pxConfig;
+    ulRandomState = ( pxConfig->ulSeed != 0 ) ? pxConfig->ulSeed : 1U;
+
+    return ( pxConfig->pcDesired == NULL ) ||
+           prvMergeObject( &pxDesired, pxConfig->pcDesired, strlen( pxConfig->pcDesired ) );
+}
+/*-----------------------------------------------------------*/
+
+void StandinHub_ClientInit( StandinClient_t * pxClient,
+                            void * pvConnection,
+                            StandinSendFunction_t xSend,
+                            uint64_t ullNowMs )
+{
+    memset( pxClient, 0, sizeof( StandinClient_t ) );
+    pxClient->pvConnection = pvConnection;
+    pxClient->xSend = xSend;
+    pxClient->ullLastReceiveMs = ullNowMs;
+    pxClient->ulNextRequestId = 1;
+    pxClient->pxSession = &pxClient->xDpsSession;
+    pxClient->xDpsSession.usNextPacketId = 1;
+}
+/*-----------------------------------------------------------*/
+
+bool StandinHub_HandlePacket( StandinClient_t * pxClient,
+                              const StandinMqttPacket_t * pxPacket,
+                              uint64_t ullNowMs )
+{
+    uint32_t ulDelayMs;
+
+    pxClient->ullLastReceiveMs = ullNowMs;
+
+    if( !pxClient->xConnected )
+    {
+        return ( pxPacket->ucType == STANDIN_MQTT_CONNECT ) && prvHandleConnect( pxClient, pxPacket, ullNowMs );
+    }
+
+    switch( pxPacket->ucType )
+    {
+        case STANDIN_MQTT_PUBLISH:
+
+            if( prvLost() )
+            {
+                prvLog( pxClient, "dropped received PUBLISH %.*s",
+                        ( int ) pxPacket->xTopic.xLength, pxPacket->xTopic.pcData );
+                break;
+            }
+
+            ulDelayMs = prvHandlePublish( pxClient, pxPacket, ullNowMs );
+
+            if( pxPacket->ucQoS > 0 )
+            {
+                prvSendPacket( pxClient,
+                               StandinMqtt_EncodeAck( ucPacket, sizeof( ucPacket ), STANDIN_MQTT_PUBACK, pxPacket->usPacketId ),
+                               ulDelayMs );
+            }
+
+            break;
+
+        case STANDIN_MQTT_PUBACK:
+            prvHandlePuback( pxClient, pxPacket->usPacketId );
+            break;
+
+        case STANDIN_MQTT_SUBSCRIBE:
+            prvHandleSubscribe( pxClient, pxPacket, true );
+            break;
+
+        case STANDIN_MQTT_UNSUBSCRIBE:
+            prvHandleSubscribe( pxClient, pxPacket, false );
+            break;
+
+        case STANDIN_MQTT_PINGREQ:
+            prvSendPacket( pxClient, StandinMqtt_EncodePingresp( ucPacket, sizeof( ucPacket ) ), 0 );
+            break;
+
+        default:
+            /* DISCONNECT, or a second CONNECT. */
+            prvLog( pxClient, "closing on packet type %u", ( unsigned ) pxPacket->ucType );
+            return false;
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether a periodic action is due, moving its schedule forward.
+ */
+static bool prvDue( uint64_t * pullNextMs,
+                    uint32_t ulIntervalMs,
+                    uint64_t ullNowMs,
+                    uint64_t * pullWakeMs )
+{
+    bool xDue = false;
+
+    if( ulIntervalMs == 0 )
+    {
+        return false;
+    }
+
+    if( ullNowMs >= *pullNextMs )
+    {
+        *pullNextMs = ( *pullNextMs + ulIntervalMs > ullNowMs ) ? *pullNextMs + ulIntervalMs : ullNowMs + ulIntervalMs;
+        xDue = true;
+    }
+
+    if( *pullNextMs < *pullWakeMs )
+    {
+        *pullWakeMs = *pullNextMs;
+    }
+
+    return xDue;
+}
+/*-----------------------------------------------------------*/
+
+bool StandinHub_Poll( StandinClient_t * pxClient,
+                      uint64_t ullNowMs,
+                      uint64_t * pullNextMs )
+{
+    uint64_t ullWakeMs = UINT64_MAX;
+    uint32_t ulCount;
+    size_t xLength = 0;
+
+    if( !pxClient->xConnected )
+    {
+        /* CONNECT must arrive within a keep alive period of the default 4 minutes. */
+        *pullNextMs = pxClient->ullLastReceiveMs + 240000U;
+        return ullNowMs < *pullNextMs;
+    }
+
+    if( pxClient->ulKeepAliveMs > 0 )
+    {
+        /* MQTT allows one and a half keep alive periods of silence. */
+        ullWakeMs = pxClient->ullLastReceiveMs + pxClient->ulKeepAliveMs + pxClient->ulKeepAliveMs / 2;
+
+        if( ullNowMs >= ullWakeMs )
+        {
+            prvLog( pxClient, "keep alive expired" );
+            return false;
+        }
+    }
+
+    if( pxClient->pxSession->xC2D && prvDue( &pxClient->ullNextC2DMs, pxStandinConfig->ulC2DIntervalMs, ullNowMs, &ullWakeMs ) )
+    {
+        ulCount = ( uint32_t ) ++xStats.ullC2DSent;
+        snprintf( cTopic, sizeof( cTopic ),
+                  "devices/%s/messages/devicebound/%%24.mid=standin-%u&%%24.to=%%2Fdevices%%2F%s%%2Fmessages%%2Fdevicebound",
+                  pxClient->cClientId, ( unsigned ) ulCount, pxClient->cClientId );
+        ( void ) prvAppend( cPayload, sizeof( cPayload ), &xLength, "Cloud to device message %u", ( unsigned ) ulCount );
+        prvPublish( pxClient, cPayload, xLength, 1 );
+    }
+
+    if( pxClient->pxSession->xMethods && prvDue( &pxClient->ullNextMethodMs, pxStandinConfig->ulMethodIntervalMs, ullNowMs, &ullWakeMs ) )
+    {
+        xStats.ullMethodsSent++;
+        pxClient->ullMethodSentMs = ullNowMs;
+        snprintf( cTopic, sizeof( cTopic ), "$iothub/methods/POST/%s/?$rid=%x",
+                  pxStandinConfig->pcMethodName, ( unsigned ) pxClient->ulNextRequestId++ );
+        prvPublish( pxClient, pxStandinConfig->pcMethodPayload, strlen( pxStandinConfig->pcMethodPayload ), 0 );
+    }
+
+    if( pxClient->pxSession->xDesired && prvDue( &pxClient->ullNextDesiredMs, pxStandinConfig->ulDesiredIntervalMs, ullNowMs, &ullWakeMs ) )
+    {
+        xStats.ullDesiredSent++;
+        ulDesiredVersion++;
+        snprintf( cTopic, sizeof( cTopic ), "$iothub/twin/PATCH/properties/desired/?$version=%u",
+                  ( unsigned ) ulDesiredVersion );
+        xLength = 0;
+
+        if( prvAppendObject( cPayload, sizeof( cPayload ), &xLength, pxDesired, ulDesiredVersion ) )
+        {
+            prvPublish( pxClient, cPayload, xLength, 0 );
+        }
+    }
+
+    *pullNextMs = ullWakeMs;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+void StandinHub_GetStats( StandinStats_t * pxStats )
+{
+    *pxStats = xStats;
+}
+/*-----------------------------------------------------------*/
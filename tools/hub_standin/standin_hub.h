@@ -0,0 +1,211 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file standin_hub.h
+ * @brief IoT Hub and DPS behaviour of the stand-in server.
+ *
+ * Implements the MQTT topic conventions used by the middleware:
+ *  - Telemetry on devices/{id}/messages/events/, acknowledged and counted.
+ *  - Cloud to device messages on devices/{id}/messages/devicebound/, sent
+ *    periodically to subscribed clients.
+ *  - Direct methods and commands on $iothub/methods/POST/, sent periodically,
+ *    with the responses on $iothub/methods/res/ matched by request ID.
+ *  - Twin GET and reported PATCH with replies on $iothub/twin/res/, and
+ *    periodic desired property patches. Twins are kept per device ID for the
+ *    life of the server.
+ *  - The DPS register and operation status poll flow on $dps/registrations/.
+ *  - Persistent sessions: a device connecting with clean session 0 finds
+ *    the subscriptions and unacknowledged QoS 1 messages of its previous
+ *    connection, if that one asked for a persistent session too, and gets
+ *    session present 1.
+ *
+ * Passwords are not checked. Network impairments are applied on top: a fixed
+ * latency with jitter on every packet sent, random loss of PUBLISH packets in
+ * both directions, and a per connection publish rate limit which delays the
+ * PUBACKs of IoT Hub and rejects DPS requests with status 429.
+ */
+
+#ifndef STANDIN_HUB_H
+#define STANDIN_HUB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "standin_mqtt.h"
+
+/**
+ * @brief Longest device or registration ID.
+ */
+#define STANDIN_HUB_MAX_ID_LENGTH    ( 128U )
+
+/**
+ * @brief Most QoS 1 messages to a device kept until their PUBACK.
+ */
+#define STANDIN_HUB_MAX_UNACKED      ( 16U )
+
+/**
+ * @brief Server settings, all times in milliseconds and 0 to disable.
+ */
+typedef struct StandinConfig
+{
+    uint32_t ulLatencyMs;              /**< @brief Delay of every packet sent. */
+    uint32_t ulJitterMs;               /**< @brief Largest random delay added to the latency. */
+    uint32_t ulLossPercent;            /**< @brief Chance of dropping a PUBLISH, each direction. */
+    uint32_t ulThrottlePerSecond;      /**< @brief Publishes accepted per second and connection. */
+    uint32_t ulC2DIntervalMs;          /**< @brief Cloud to device message period. */
+    uint32_t ulMethodIntervalMs;       /**< @brief Direct method period. */
+    uint32_t ulDesiredIntervalMs;      /**< @brief Desired property patch period. */
+    uint32_t ulDpsPolls;               /**< @brief Status polls answered "assigning" before "assigned". */
+    uint32_t ulDpsRetryAfterS;         /**< @brief retry-after sent with DPS replies. */
+    uint32_t ulSeed;                   /**< @brief Seed of the jitter and loss generator. */
+    const char * pcAssignedHub;        /**< @brief Hub hostname returned by DPS. */
+    const char * pcMethodName;
+    const char * pcMethodPayload;      /**< @brief JSON value. */
+    const char * pcDesired;            /**< @brief Initial desired properties, a JSON object. */
+    bool xVerbose;                     /**< @brief Log every packet. */
+} StandinConfig_t;
+
+/**
+ * @brief Counters of the whole server.
+ */
+typedef struct StandinStats
+{
+    uint64_t ullConnects;
+    uint64_t ullDpsRegistrations;
+    uint64_t ullTelemetry;
+    uint64_t ullTelemetryBytes;
+    uint64_t ullC2DSent;
+    uint64_t ullMethodsSent;
+    uint64_t ullMethodResponses;
+    uint64_t ullTwinGets;
+    uint64_t ullTwinPatches;
+    uint64_t ullDesiredSent;
+    uint64_t ullSubscribes;            /**< @brief SUBSCRIBE packets received. */
+    uint64_t ullSessionsResumed;       /**< @brief Connects which found a persistent session. */
+    uint64_t ullRedelivered;           /**< @brief QoS 1 messages sent again in a resumed session. */
+    uint64_t ullDropped;               /**< @brief PUBLISH packets lost on purpose. */
+    uint64_t ullThrottled;             /**< @brief Publishes delayed or rejected by the rate limit. */
+} StandinStats_t;
+
+/**
+ * @brief Queue a packet on the connection of a client.
+ *
+ * Packets must leave in the order they are queued, a packet due earlier than
+ * the previous one waits for it.
+ *
+ * @param[in] pvConnection Connection given to #StandinHub_ClientInit.
+ * @param[in] pucData Encoded packet, copied.
+ * @param[in] xLength Length of @p pucData.
+ * @param[in] ulDelayMs Time to hold the packet back.
+ */
+typedef void ( * StandinSendFunction_t )( void * pvConnection,
+                                          const uint8_t * pucData,
+                                          size_t xLength,
+                                          uint32_t ulDelayMs );
+
+typedef struct StandinDevice StandinDevice_t;
+
+/**
+ * @brief A QoS 1 PUBLISH sent to a device and not acknowledged yet.
+ */
+typedef struct StandinUnacked
+{
+    uint16_t usPacketId;
+    uint8_t * pucPacket;               /**< @brief Encoded PUBLISH, allocated, NULL when the entry is free. */
+    size_t xLength;
+} StandinUnacked_t;
+
+/**
+ * @brief MQTT session state, kept with the twin of a device across
+ * connections which ask for a persistent session.
+ */
+typedef struct StandinSession
+{
+    bool xPersistent;                  /**< @brief The last connection asked for a persistent session. */
+    uint16_t usNextPacketId;
+
+    /* Subscriptions */
+    bool xC2D;
+    bool xMethods;
+    bool xTwinResponses;
+    bool xDesired;
+
+    StandinUnacked_t xUnacked[ STANDIN_HUB_MAX_UNACKED ];
+} StandinSession_t;
+
+/**
+ * @brief Protocol state of one connection.
+ */
+typedef struct StandinClient
+{
+    void * pvConnection;
+    StandinSendFunction_t xSend;
+    bool xConnected;
+    bool xIsDps;
+    char cClientId[ STANDIN_HUB_MAX_ID_LENGTH ];
+    StandinDevice_t * pxDevice;
+    uint32_t ulKeepAliveMs;
+    uint64_t ullLastReceiveMs;
+    uint32_t ulNextRequestId;
+
+    /* Session of the device, or xDpsSession for DPS. */
+    StandinSession_t * pxSession;
+    StandinSession_t xDpsSession;
+
+    /* Schedules */
+    uint64_t ullNextC2DMs;
+    uint64_t ullNextMethodMs;
+    uint64_t ullNextDesiredMs;
+    uint64_t ullMethodSentMs;
+    uint64_t ullThrottleSlotMs;        /**< @brief Time the next publish is accepted without delay. */
+
+    /* DPS */
+    uint32_t ulDpsPolls;
+    char cOperationId[ 64 ];
+} StandinClient_t;
+
+/**
+ * @brief Set up the server state.
+ *
+ * @param[in] pxConfig Settings, must outlive the server.
+ * @return false if the desired properties are not a JSON object.
+ */
+bool StandinHub_Init( const StandinConfig_t * pxConfig );
+
+/**
+ * @brief Prepare the state of a new connection.
+ */
+void StandinHub_ClientInit( StandinClient_t * pxClient,
+                            void * pvConnection,
+                            StandinSendFunction_t xSend,
+                            uint64_t ullNowMs );
+
+/**
+ * @brief Handle a packet received from a client.
+ *
+ * @return false if the connection must be closed.
+ */
+bool StandinHub_HandlePacket( StandinClient_t * pxClient,
+                              const StandinMqttPacket_t * pxPacket,
+                              uint64_t ullNowMs );
+
+/**
+ * @brief Send what is due to a client and check its keep alive.
+ *
+ * @param[in] pxClient Client.
+ * @param[in] ullNowMs Current time.
+ * @param[out] pullNextMs Time this should be called again at the latest.
+ * @return false if the connection must be closed.
+ */
+bool StandinHub_Poll( StandinClient_t * pxClient,
+                      uint64_t ullNowMs,
+                      uint64_t * pullNextMs );
+
+/**
+ * @brief Counters since start.
+ */
+void StandinHub_GetStats( StandinStats_t * pxStats );
+
+#endif /* STANDIN_HUB_H */
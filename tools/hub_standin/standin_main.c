@@ -0,0 +1,632 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file standin_main.c
+ * @brief Local IoT Hub and DPS stand-in: TLS server, connections and options.
+ *
+ * A single threaded poll() loop serves every connection. Packets sent to a
+ * client are queued with the time they are due, which is how the configured
+ * latency is applied without blocking other clients.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include "standin_hub.h"
+#include "standin_mqtt.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Largest packet accepted from a client.
+ */
+#define standinRECEIVE_BUFFER_SIZE    ( 64U * 1024U )
+
+/**
+ * @brief Most connections served at once.
+ */
+#define standinMAX_CONNECTIONS        ( 4096U )
+
+/**
+ * @brief A packet waiting to be sent.
+ */
+typedef struct StandinOutPacket
+{
+    struct StandinOutPacket * pxNext;
+    uint64_t ullDueMs;
+    size_t xLength;
+    size_t xSent;
+    uint8_t ucData[];
+} StandinOutPacket_t;
+
+/**
+ * @brief One TLS connection.
+ */
+typedef struct StandinConnection
+{
+    struct StandinConnection * pxNext;
+    int lSocket;
+    SSL * pxSsl;
+    bool xHandshakeDone;
+    bool xWantWrite;         /**< @brief TLS needs the socket writable to make progress. */
+    bool xClosing;
+    StandinOutPacket_t * pxHead;
+    StandinOutPacket_t * pxTail;
+    uint64_t ullLastDueMs;
+    size_t xReceived;
+    uint8_t ucReceive[ standinRECEIVE_BUFFER_SIZE ];
+    StandinClient_t xClient;
+} StandinConnection_t;
+
+static StandinConfig_t xConfig =
+{
+    .ulDpsRetryAfterS = 1,
+    .ulSeed           = 1,
+    .pcAssignedHub    = "localhost",
+    .pcMethodName     = "standinMethod",
+    .pcMethodPayload  = "{}",
+    .pcDesired        = "{}"
+};
+
+static StandinConnection_t * pxConnections;
+static uint32_t ulConnectionCount;
+static uint64_t ullNowMs;
+static volatile sig_atomic_t xStop;
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowMs( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( uint64_t ) xTime.tv_sec * 1000U + ( uint64_t ) xTime.tv_nsec / 1000000U;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandleSignal( int lSignal )
+{
+    ( void ) lSignal;
+    xStop = 1;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintStats( void )
+{
+    StandinStats_t xStats;
+
+    StandinHub_GetStats( &xStats );
+
+    printf( "connections %u, connects %llu, dps %llu, telemetry %llu (%llu bytes), c2d %llu, "
+            "methods %llu/%llu, twin get %llu, twin patch %llu, desired %llu, subscribes %llu, "
+            "sessions resumed %llu, redelivered %llu, dropped %llu, throttled %llu\n",
+            ( unsigned ) ulConnectionCount,
+            ( unsigned long long ) xStats.ullConnects, ( unsigned long long ) xStats.ullDpsRegistrations,
+            ( unsigned long long ) xStats.ullTelemetry, ( unsigned long long ) xStats.ullTelemetryBytes,
+            ( unsigned long long ) xStats.ullC2DSent,
+            ( unsigned long long ) xStats.ullMethodResponses, ( unsigned long long ) xStats.ullMethodsSent,
+            ( unsigned long long ) xStats.ullTwinGets, ( unsigned long long ) xStats.ullTwinPatches,
+            ( unsigned long long ) xStats.ullDesiredSent, ( unsigned long long ) xStats.ullSubscribes,
+            ( unsigned long long ) xStats.ullSessionsResumed, ( unsigned long long ) xStats.ullRedelivered,
+            ( unsigned long long ) xStats.ullDropped, ( unsigned long long ) xStats.ullThrottled );
+    fflush( stdout );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief #StandinSendFunction_t of the connections.
+ */
+static void prvQueuePacket( void * pvConnection,
+                            const uint8_t * pucData,
+                            size_t xLength,
+                            uint32_t ulDelayMs )
+{
+    StandinConnection_t * pxConnection = ( StandinConnection_t * ) pvConnection;
+    StandinOutPacket_t * pxPacket = malloc( sizeof( StandinOutPacket_t ) + xLength );
+    uint64_t ullDueMs = ullNowMs + ulDelayMs;
+
+    if( pxPacket == NULL )
+    {
+        pxConnection->xClosing = true;
+        return;
+    }
+
+    /* Keep the stream in order: a packet never overtakes the previous one. */
+    if( ullDueMs < pxConnection->ullLastDueMs )
+    {
+        ullDueMs = pxConnection->ullLastDueMs;
+    }
+
+    pxConnection->ullLastDueMs = ullDueMs;
+
+    pxPacket->pxNext = NULL;
+    pxPacket->ullDueMs = ullDueMs;
+    pxPacket->xLength = xLength;
+    pxPacket->xSent = 0;
+    memcpy( pxPacket->ucData, pucData, xLength );
+
+    if( pxConnection->pxTail == NULL )
+    {
+        pxConnection->pxHead = pxPacket;
+    }
+    else
+    {
+        pxConnection->pxTail->pxNext = pxPacket;
+    }
+
+    pxConnection->pxTail = pxPacket;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Whether an SSL call failed only because the socket would block.
+ */
+static bool prvWouldBlock( StandinConnection_t * pxConnection,
+                           int lResult )
+{
+    int lError = SSL_get_error( pxConnection->pxSsl, lResult );
+
+    pxConnection->xWantWrite = ( lError == SSL_ERROR_WANT_WRITE );
+
+    return ( lError == SSL_ERROR_WANT_READ ) || ( lError == SSL_ERROR_WANT_WRITE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReceive( StandinConnection_t * pxConnection )
+{
+    StandinMqttPacket_t xPacket;
+    StandinMqttStatus_t xStatus;
+    size_t xPacketLength;
+    size_t xOffset = 0;
+    int lResult;
+
+    for( ; ; )
+    {
+        if( pxConnection->xReceived == sizeof( pxConnection->ucReceive ) )
+        {
+            /* A packet larger than the buffer. */
+            pxConnection->xClosing = true;
+            return;
+        }
+
+        lResult = SSL_read( pxConnection->pxSsl, &pxConnection->ucReceive[ pxConnection->xReceived ],
+                            ( int ) ( sizeof( pxConnection->ucReceive ) - pxConnection->xReceived ) );
+
+        if( lResult <= 0 )
+        {
+            if( !prvWouldBlock( pxConnection, lResult ) )
+            {
+                pxConnection->xClosing = true;
+            }
+
+            return;
+        }
+
+        pxConnection->xReceived += ( size_t ) lResult;
+        xOffset = 0;
+
+        while( ( xStatus = StandinMqtt_Decode( &pxConnection->ucReceive[ xOffset ], pxConnection->xReceived - xOffset,
+                                               &xPacket, &xPacketLength ) ) == eStandinMqttSuccess )
+        {
+            if( !StandinHub_HandlePacket( &pxConnection->xClient, &xPacket, ullNowMs ) )
+            {
+                pxConnection->xClosing = true;
+                return;
+            }
+
+            xOffset += xPacketLength;
+        }
+
+        if( xStatus == eStandinMqttMalformed )
+        {
+            pxConnection->xClosing = true;
+            return;
+        }
+
+        memmove( pxConnection->ucReceive, &pxConnection->ucReceive[ xOffset ], pxConnection->xReceived - xOffset );
+        pxConnection->xReceived -= xOffset;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvFlush( StandinConnection_t * pxConnection )
+{
+    StandinOutPacket_t * pxPacket;
+    int lResult;
+
+    while( ( ( pxPacket = pxConnection->pxHead ) != NULL ) && ( pxPacket->ullDueMs <= ullNowMs ) )
+    {
+        lResult = SSL_write( pxConnection->pxSsl, &pxPacket->ucData[ pxPacket->xSent ],
+                             ( int ) ( pxPacket->xLength - pxPacket->xSent ) );
+
+        if( lResult <= 0 )
+        {
+            if( !prvWouldBlock( pxConnection, lResult ) )
+            {
+                pxConnection->xClosing = true;
+            }
+
+            return;
+        }
+
+        pxPacket->xSent += ( size_t ) lResult;
+
+        if( pxPacket->xSent == pxPacket->xLength )
+        {
+            pxConnection->pxHead = pxPacket->pxNext;
+
+            if( pxConnection->pxHead == NULL )
+            {
+                pxConnection->pxTail = NULL;
+            }
+
+            free( pxPacket );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvService( StandinConnection_t * pxConnection )
+{
+    int lResult;
+
+    pxConnection->xWantWrite = false;
+
+    if( !pxConnection->xHandshakeDone )
+    {
+        lResult = SSL_do_handshake( pxConnection->pxSsl );
+
+        if( lResult == 1 )
+        {
+            pxConnection->xHandshakeDone = true;
+        }
+        else
+        {
+            if( !prvWouldBlock( pxConnection, lResult ) )
+            {
+                pxConnection->xClosing = true;
+            }
+
+            return;
+        }
+    }
+
+    prvReceive( pxConnection );
+
+    if( !pxConnection->xClosing )
+    {
+        prvFlush( pxConnection );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvAccept( int lListenSocket,
+                       SSL_CTX * pxSslContext )
+{
+    StandinConnection_t * pxConnection;
+    int lSocket;
+    int lOne = 1;
+
+    while( ( lSocket = accept( lListenSocket, NULL, NULL ) ) >= 0 )
+    {
+        if( ( ulConnectionCount == standinMAX_CONNECTIONS ) ||
+            ( ( pxConnection = calloc( 1, sizeof( StandinConnection_t ) ) ) == NULL ) )
+        {
+            close( lSocket );
+            continue;
+        }
+
+        fcntl( lSocket, F_SETFL, fcntl( lSocket, F_GETFL ) | O_NONBLOCK );
+        setsockopt( lSocket, IPPROTO_TCP, TCP_NODELAY, &lOne, sizeof( lOne ) );
+
+        pxConnection->lSocket = lSocket;
+        pxConnection->pxSsl = SSL_new( pxSslContext );
+        SSL_set_fd( pxConnection->pxSsl, lSocket );
+        SSL_set_accept_state( pxConnection->pxSsl );
+        SSL_set_mode( pxConnection->pxSsl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER );
+        StandinHub_ClientInit( &pxConnection->xClient, pxConnection, prvQueuePacket, ullNowMs );
+
+        pxConnection->pxNext = pxConnections;
+        pxConnections = pxConnection;
+        ulConnectionCount++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvClose( StandinConnection_t * pxConnection )
+{
+    StandinOutPacket_t * pxPacket;
+
+    if( xConfig.xVerbose )
+    {
+        printf( "[%s] closed\n", ( pxConnection->xClient.cClientId[ 0 ] != '\0' ) ? pxConnection->xClient.cClientId : "-" );
+    }
+
+    while( ( pxPacket = pxConnection->pxHead ) != NULL )
+    {
+        pxConnection->pxHead = pxPacket->pxNext;
+        free( pxPacket );
+    }
+
+    SSL_free( pxConnection->pxSsl );
+    close( pxConnection->lSocket );
+    free( pxConnection );
+    ulConnectionCount--;
+}
+/*-----------------------------------------------------------*/
+
+static int prvListen( uint16_t usPort )
+{
+    struct sockaddr_in xAddress = { 0 };
+    int lSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    int lOne = 1;
+
+    if( lSocket < 0 )
+    {
+        return -1;
+    }
+
+    xAddress.sin_family = AF_INET;
+    xAddress.sin_port = htons( usPort );
+    xAddress.sin_addr.s_addr = htonl( INADDR_ANY );
+
+    setsockopt( lSocket, SOL_SOCKET, SO_REUSEADDR, &lOne, sizeof( lOne ) );
+
+    if( ( bind( lSocket, ( struct sockaddr * ) &xAddress, sizeof( xAddress ) ) != 0 ) ||
+        ( listen( lSocket, 128 ) != 0 ) )
+    {
+        close( lSocket );
+        return -1;
+    }
+
+    fcntl( lSocket, F_SETFL, fcntl( lSocket, F_GETFL ) | O_NONBLOCK );
+
+    return lSocket;
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgram )
+{
+    printf( "Usage: %s [options]\n"
+            "  --port N                 TCP port (8883)\n"
+            "  --cert FILE              Server certificate chain, PEM (server.pem)\n"
+            "  --key FILE               Server private key, PEM (server.key)\n"
+            "  --latency-ms N           Delay of every packet sent\n"
+            "  --jitter-ms N            Largest random delay added to the latency\n"
+            "  --loss-percent N         Chance of dropping a PUBLISH in each direction\n"
+            "  --throttle-per-sec N     Publishes accepted per second and connection\n"
+            "  --c2d-interval-ms N      Send a cloud to device message every N ms\n"
+            "  --method-interval-ms N   Invoke a direct method every N ms\n"
+            "  --method-name NAME       Method to invoke (standinMethod)\n"
+            "  --method-payload JSON    Method payload ({})\n"
+            "  --desired JSON           Desired properties object ({})\n"
+            "  --desired-interval-ms N  Send a desired properties patch every N ms\n"
+            "  --dps-polls N            Status polls answered 'assigning' (0)\n"
+            "  --dps-retry-after N      retry-after of DPS replies in seconds (1)\n"
+            "  --assigned-hub HOST      Hub returned by DPS (localhost)\n"
+            "  --seed N                 Seed of the loss and jitter generator (1)\n"
+            "  --stats-interval-ms N    Print the counters every N ms (10000, 0 never)\n"
+            "  --verbose                Log every packet\n",
+            pcProgram );
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    static const struct option xOptions[] =
+    {
+        { "port",               required_argument, NULL, 'p' },
+        { "cert",               required_argument, NULL, 'c' },
+        { "key",                required_argument, NULL, 'k' },
+        { "latency-ms",         required_argument, NULL, 'l' },
+        { "jitter-ms",          required_argument, NULL, 'j' },
+        { "loss-percent",       required_argument, NULL, 'o' },
+        { "throttle-per-sec",   required_argument, NULL, 't' },
+        { "c2d-interval-ms",    required_argument, NULL, 'C' },
+        { "method-interval-ms", required_argument, NULL, 'M' },
+        { "method-name",        required_argument, NULL, 'n' },
+        { "method-payload",     required_argument, NULL, 'P' },
+        { "desired",            required_argument, NULL, 'd' },
+        { "desired-interval-ms",required_argument, NULL, 'D' },
+        { "dps-polls",          required_argument, NULL, 'q' },
+        { "dps-retry-after",    required_argument, NULL, 'r' },
+        { "assigned-hub",       required_argument, NULL, 'a' },
+        { "seed",               required_argument, NULL, 's' },
+        { "stats-interval-ms",  required_argument, NULL, 'S' },
+        { "verbose",            no_argument,       NULL, 'v' },
+        { "help",               no_argument,       NULL, 'h' },
+        { NULL,                 0,                 NULL, 0   }
+    };
+    const char * pcCertificate = "server.pem";
+    const char * pcKey = "server.key";
+    uint32_t ulStatsIntervalMs = 10000;
+    uint64_t ullNextStatsMs;
+    uint64_t ullWakeMs;
+    uint64_t ullNextMs;
+    uint16_t usPort = 8883;
+    StandinConnection_t ** ppxConnection;
+    StandinConnection_t * pxConnection;
+    struct pollfd * pxPollFds;
+    SSL_CTX * pxSslContext;
+    int lListenSocket;
+    int lTimeoutMs;
+    int lOption;
+    uint32_t ulCount;
+
+    while( ( lOption = getopt_long( argc, argv, "vh", xOptions, NULL ) ) != -1 )
+    {
+        switch( lOption )
+        {
+            case 'p': usPort = ( uint16_t ) strtoul( optarg, NULL, 10 ); break;
+            case 'c': pcCertificate = optarg; break;
+            case 'k': pcKey = optarg; break;
+            case 'l': xConfig.ulLatencyMs = strtoul( optarg, NULL, 10 ); break;
+            case 'j': xConfig.ulJitterMs = strtoul( optarg, NULL, 10 ); break;
+            case 'o': xConfig.ulLossPercent = strtoul( optarg, NULL, 10 ); break;
+            case 't': xConfig.ulThrottlePerSecond = strtoul( optarg, NULL, 10 ); break;
+            case 'C': xConfig.ulC2DIntervalMs = strtoul( optarg, NULL, 10 ); break;
+            case 'M': xConfig.ulMethodIntervalMs = strtoul( optarg, NULL, 10 ); break;
+            case 'n': xConfig.pcMethodName = optarg; break;
+            case 'P': xConfig.pcMethodPayload = optarg; break;
+            case 'd': xConfig.pcDesired = optarg; break;
+            case 'D': xConfig.ulDesiredIntervalMs = strtoul( optarg, NULL, 10 ); break;
+            case 'q': xConfig.ulDpsPolls = strtoul( optarg, NULL, 10 ); break;
+            case 'r': xConfig.ulDpsRetryAfterS = strtoul( optarg, NULL, 10 ); break;
+            case 'a': xConfig.pcAssignedHub = optarg; break;
+            case 's': xConfig.ulSeed = strtoul( optarg, NULL, 10 ); break;
+            case 'S': ulStatsIntervalMs = strtoul( optarg, NULL, 10 ); break;
+            case 'v': xConfig.xVerbose = true; break;
+            default: prvUsage( argv[ 0 ] ); return ( lOption == 'h' ) ? 0 : 1;
+        }
+    }
+
+    if( !StandinHub_Init( &xConfig ) )
+    {
+        fprintf( stderr, "--desired must be a JSON object\n" );
+        return 1;
+    }
+
+    if( ( pxSslContext = SSL_CTX_new( TLS_server_method() ) ) == NULL )
+    {
+        ERR_print_errors_fp( stderr );
+        return 1;
+    }
+
+    SSL_CTX_set_min_proto_version( pxSslContext, TLS1_2_VERSION );
+
+    if( ( SSL_CTX_use_certificate_chain_file( pxSslContext, pcCertificate ) != 1 ) ||
+        ( SSL_CTX_use_PrivateKey_file( pxSslContext, pcKey, SSL_FILETYPE_PEM ) != 1 ) )
+    {
+        fprintf( stderr, "Cannot load %s and %s, see gen_certs.sh\n", pcCertificate, pcKey );
+        ERR_print_errors_fp( stderr );
+        return 1;
+    }
+
+    if( ( lListenSocket = prvListen( usPort ) ) < 0 )
+    {
+        fprintf( stderr, "Cannot listen on port %u: %s\n", ( unsigned ) usPort, strerror( errno ) );
+        return 1;
+    }
+
+    pxPollFds = calloc( standinMAX_CONNECTIONS + 1, sizeof( struct pollfd ) );
+
+    if( pxPollFds == NULL )
+    {
+        return 1;
+    }
+
+    signal( SIGPIPE, SIG_IGN );
+    signal( SIGINT, prvHandleSignal );
+    signal( SIGTERM, prvHandleSignal );
+
+    printf( "Listening on port %u\n", ( unsigned ) usPort );
+    fflush( stdout );
+
+    ullNowMs = prvNowMs();
+    ullNextStatsMs = ullNowMs + ulStatsIntervalMs;
+
+    while( !xStop )
+    {
+        /* Run the schedules, and find when the loop must wake up at the latest. */
+        ullWakeMs = ( ulStatsIntervalMs > 0 ) ? ullNextStatsMs : ullNowMs + 1000U;
+
+        pxPollFds[ 0 ].fd = lListenSocket;
+        pxPollFds[ 0 ].events = POLLIN;
+        ulCount = 1;
+
+        for( pxConnection = pxConnections; pxConnection != NULL; pxConnection = pxConnection->pxNext )
+        {
+            if( pxConnection->xHandshakeDone && !pxConnection->xClosing )
+            {
+                if( StandinHub_Poll( &pxConnection->xClient, ullNowMs, &ullNextMs ) )
+                {
+                    ullWakeMs = ( ullNextMs < ullWakeMs ) ? ullNextMs : ullWakeMs;
+                    prvFlush( pxConnection );
+                }
+                else
+                {
+                    pxConnection->xClosing = true;
+                }
+            }
+
+            if( ( pxConnection->pxHead != NULL ) && ( pxConnection->pxHead->ullDueMs < ullWakeMs ) )
+            {
+                ullWakeMs = pxConnection->pxHead->ullDueMs;
+            }
+
+            pxPollFds[ ulCount ].fd = pxConnection->lSocket;
+            pxPollFds[ ulCount ].events = POLLIN | ( pxConnection->xWantWrite ? POLLOUT : 0 );
+            pxPollFds[ ulCount ].revents = 0;
+            ulCount++;
+        }
+
+        lTimeoutMs = ( ullWakeMs > ullNowMs ) ? ( int ) ( ullWakeMs - ullNowMs ) : 0;
+
+        if( ( poll( pxPollFds, ulCount, lTimeoutMs ) < 0 ) && ( errno != EINTR ) )
+        {
+            break;
+        }
+
+        ullNowMs = prvNowMs();
+
+        if( pxPollFds[ 0 ].revents & POLLIN )
+        {
+            prvAccept( lListenSocket, pxSslContext );
+        }
+
+        /* Newly accepted connections are at the head of the list, past the
+         * ones polled, so they are skipped until the next round. */
+        ulCount = 1;
+        ppxConnection = &pxConnections;
+
+        while( ( pxConnection = *ppxConnection ) != NULL )
+        {
+            if( pxConnection->lSocket == pxPollFds[ ulCount ].fd )
+            {
+                if( pxPollFds[ ulCount ].revents != 0 )
+                {
+                    prvService( pxConnection );
+                }
+
+                ulCount++;
+            }
+
+            if( pxConnection->xClosing )
+            {
+                *ppxConnection = pxConnection->pxNext;
+                prvClose( pxConnection );
+            }
+            else
+            {
+                ppxConnection = &pxConnection->pxNext;
+            }
+        }
+
+        if( ( ulStatsIntervalMs > 0 ) && ( ullNowMs >= ullNextStatsMs ) )
+        {
+            prvPrintStats();
+            ullNextStatsMs = ullNowMs + ulStatsIntervalMs;
+        }
+    }
+
+    prvPrintStats();
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
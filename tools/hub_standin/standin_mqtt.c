@@ -0,0 +1,389 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file standin_mqtt.c
+ * @brief The subset of MQTT 3.1.1 used by the Azure IoT middleware.
+ */
+
+#include <string.h>
+
+#include "standin_mqtt.h"
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Reader over the variable header and payload of a packet.
+ */
+typedef struct StandinReader
+{
+    const uint8_t * pucData;
+    size_t xLength;
+    size_t xOffset;
+    bool xError;
+} StandinReader_t;
+/*-----------------------------------------------------------*/
+
+static uint16_t prvReadU16( StandinReader_t * pxReader )
+{
+    uint16_t usValue;
+
+    if( pxReader->xOffset + 2 > pxReader->xLength )
+    {
+        pxReader->xError = true;
+        return 0;
+    }
+
+    usValue = ( uint16_t ) ( ( pxReader->pucData[ pxReader->xOffset ] << 8 ) |
+                             pxReader->pucData[ pxReader->xOffset + 1 ] );
+    pxReader->xOffset += 2;
+
+    return usValue;
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t prvReadU8( StandinReader_t * pxReader )
+{
+    if( pxReader->xOffset + 1 > pxReader->xLength )
+    {
+        pxReader->xError = true;
+        return 0;
+    }
+
+    return pxReader->pucData[ pxReader->xOffset++ ];
+}
+/*-----------------------------------------------------------*/
+
+static StandinSpan_t prvReadString( StandinReader_t * pxReader )
+{
+    StandinSpan_t xSpan = { NULL, 0 };
+    uint16_t usLength = prvReadU16( pxReader );
+
+    if( pxReader->xError || ( pxReader->xOffset + usLength > pxReader->xLength ) )
+    {
+        pxReader->xError = true;
+        return xSpan;
+    }
+
+    xSpan.pcData = ( const char * ) &pxReader->pucData[ pxReader->xOffset ];
+    xSpan.xLength = usLength;
+    pxReader->xOffset += usLength;
+
+    return xSpan;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvDecodeConnect( StandinReader_t * pxReader,
+                              StandinMqttPacket_t * pxPacket )
+{
+    StandinSpan_t xProtocol = prvReadString( pxReader );
+    uint8_t ucLevel = prvReadU8( pxReader );
+    uint8_t ucConnectFlags = prvReadU8( pxReader );
+
+    pxPacket->usKeepAliveS = prvReadU16( pxReader );
+    pxPacket->xCleanSession = ( ucConnectFlags & 0x02U ) != 0;
+    pxPacket->xClientId = prvReadString( pxReader );
+
+    if( ( ucConnectFlags & 0x04U ) != 0 )
+    {
+        /* Will topic and message, not used by IoT Hub. */
+        ( void ) prvReadString( pxReader );
+        ( void ) prvReadString( pxReader );
+    }
+
+    if( ( ucConnectFlags & 0x80U ) != 0 )
+    {
+        pxPacket->xUsername = prvReadString( pxReader );
+    }
+
+    if( ( ucConnectFlags & 0x40U ) != 0 )
+    {
+        pxPacket->xPassword = prvReadString( pxReader );
+    }
+
+    return !pxReader->xError && StandinSpan_Equals( &xProtocol, "MQTT" ) && ( ucLevel == 4U );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvDecodePublish( StandinReader_t * pxReader,
+                              StandinMqttPacket_t * pxPacket )
+{
+    pxPacket->ucQoS = ( uint8_t ) ( ( pxPacket->ucFlags >> 1 ) & 0x03U );
+    pxPacket->xTopic = prvReadString( pxReader );
+
+    if( pxPacket->ucQoS > 0 )
+    {
+        pxPacket->usPacketId = prvReadU16( pxReader );
+    }
+
+    pxPacket->pucPayload = &pxReader->pucData[ pxReader->xOffset ];
+    pxPacket->xPayloadLength = pxReader->xError ? 0 : pxReader->xLength - pxReader->xOffset;
+
+    return !pxReader->xError && ( pxPacket->ucQoS < 2U ) && ( pxPacket->xTopic.xLength > 0 );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvDecodeSubscribe( StandinReader_t * pxReader,
+                                StandinMqttPacket_t * pxPacket,
+                                bool xHasQoS )
+{
+    pxPacket->usPacketId = prvReadU16( pxReader );
+
+    while( !pxReader->xError && ( pxReader->xOffset < pxReader->xLength ) )
+    {
+        if( pxPacket->ulFilterCount == STANDIN_MQTT_MAX_FILTERS )
+        {
+            return false;
+        }
+
+        pxPacket->xFilters[ pxPacket->ulFilterCount ] = prvReadString( pxReader );
+        pxPacket->ucFilterQoS[ pxPacket->ulFilterCount ] = xHasQoS ? ( prvReadU8( pxReader ) & 0x03U ) : 0;
+        pxPacket->ulFilterCount++;
+    }
+
+    return !pxReader->xError && ( pxPacket->ulFilterCount > 0 );
+}
+/*-----------------------------------------------------------*/
+
+StandinMqttStatus_t StandinMqtt_Decode( const uint8_t * pucBuffer,
+                                        size_t xLength,
+                                        StandinMqttPacket_t * pxPacket,
+                                        size_t * pxPacketLength )
+{
+    StandinReader_t xReader = { 0 };
+    size_t xRemaining = 0;
+    size_t xHeaderLength = 1;
+    uint32_t ulShift = 0;
+    uint8_t ucByte;
+    bool xValid;
+
+    /* Fixed header: type and flags, then up to four bytes of remaining length. */
+    do
+    {
+        if( xHeaderLength >= xLength )
+        {
+            return eStandinMqttNeedMore;
+        }
+
+        if( xHeaderLength > 4 )
+        {
+            return eStandinMqttMalformed;
+        }
+
+        ucByte = pucBuffer[ xHeaderLength++ ];
+        xRemaining |= ( size_t ) ( ucByte & 0x7FU ) << ulShift;
+        ulShift += 7;
+    } while( ( ucByte & 0x80U ) != 0 );
+
+    if( xHeaderLength + xRemaining > xLength )
+    {
+        return eStandinMqttNeedMore;
+    }
+
+    memset( pxPacket, 0, sizeof( StandinMqttPacket_t ) );
+    pxPacket->ucType = pucBuffer[ 0 ] >> 4;
+    pxPacket->ucFlags = pucBuffer[ 0 ] & 0x0FU;
+    xReader.pucData = &pucBuffer[ xHeaderLength ];
+    xReader.xLength = xRemaining;
+
+    switch( pxPacket->ucType )
+    {
+        case STANDIN_MQTT_CONNECT:
+            xValid = prvDecodeConnect( &xReader, pxPacket );
+            break;
+
+        case STANDIN_MQTT_PUBLISH:
+            xValid = prvDecodePublish( &xReader, pxPacket );
+            break;
+
+        case STANDIN_MQTT_PUBACK:
+            pxPacket->usPacketId = prvReadU16( &xReader );
+            xValid = !xReader.xError;
+            break;
+
+        case STANDIN_MQTT_SUBSCRIBE:
+            xValid = ( pxPacket->ucFlags == 0x02U ) && prvDecodeSubscribe( &xReader, pxPacket, true );
+            break;
+
+        case STANDIN_MQTT_UNSUBSCRIBE:
+            xValid = ( pxPacket->ucFlags == 0x02U ) && prvDecodeSubscribe( &xReader, pxPacket, false );
+            break;
+
+        case STANDIN_MQTT_PINGREQ:
+        case STANDIN_MQTT_DISCONNECT:
+            xValid = ( xRemaining == 0 );
+            break;
+
+        default:
+            xValid = false;
+            break;
+    }
+
+    *pxPacketLength = xHeaderLength + xRemaining;
+
+    return xValid ? eStandinMqttSuccess : eStandinMqttMalformed;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Write the fixed header, returning its length or 0 if it does not fit.
+ */
+static size_t prvEncodeHeader( uint8_t * pucBuffer,
+                               size_t xBufferSize,
+                               uint8_t ucFirstByte,
+                               size_t xRemaining )
+{
+    size_t xLength = 0;
+
+    if( xBufferSize < 1 )
+    {
+        return 0;
+    }
+
+    pucBuffer[ xLength++ ] = ucFirstByte;
+
+    do
+    {
+        if( xLength >= xBufferSize )
+        {
+            return 0;
+        }
+
+        pucBuffer[ xLength ] = ( uint8_t ) ( xRemaining & 0x7FU );
+        xRemaining >>= 7;
+
+        if( xRemaining > 0 )
+        {
+            pucBuffer[ xLength ] |= 0x80U;
+        }
+
+        xLength++;
+    } while( xRemaining > 0 );
+
+    return xLength;
+}
+/*-----------------------------------------------------------*/
+
+size_t StandinMqtt_EncodeConnack( uint8_t * pucBuffer,
+                                  size_t xBufferSize,
+                                  bool xSessionPresent,
+                                  uint8_t ucReturnCode )
+{
+    size_t xLength = prvEncodeHeader( pucBuffer, xBufferSize, STANDIN_MQTT_CONNACK << 4, 2 );
+
+    if( ( xLength == 0 ) || ( xLength + 2 > xBufferSize ) )
+    {
+        return 0;
+    }
+
+    pucBuffer[ xLength++ ] = xSessionPresent ? 1U : 0U;
+    pucBuffer[ xLength++ ] = ucReturnCode;
+
+    return xLength;
+}
+/*-----------------------------------------------------------*/
+
+size_t StandinMqtt_EncodePublish( uint8_t * pucBuffer,
+                                  size_t xBufferSize,
+                                  const char * pcTopic,
+                                  size_t xTopicLength,
+                                  const uint8_t * pucPayload,
+                                  size_t xPayloadLength,
+                                  uint8_t ucQoS,
+                                  uint16_t usPacketId )
+{
+    size_t xRemaining = 2 + xTopicLength + ( ( ucQoS > 0 ) ? 2 : 0 ) + xPayloadLength;
+    size_t xLength = prvEncodeHeader( pucBuffer, xBufferSize,
+                                      ( uint8_t ) ( ( STANDIN_MQTT_PUBLISH << 4 ) | ( ucQoS << 1 ) ),
+                                      xRemaining );
+
+    if( ( xLength == 0 ) || ( xTopicLength > 0xFFFFU ) || ( xLength + xRemaining > xBufferSize ) )
+    {
+        return 0;
+    }
+
+    pucBuffer[ xLength++ ] = ( uint8_t ) ( xTopicLength >> 8 );
+    pucBuffer[ xLength++ ] = ( uint8_t ) xTopicLength;
+    memcpy( &pucBuffer[ xLength ], pcTopic, xTopicLength );
+    xLength += xTopicLength;
+
+    if( ucQoS > 0 )
+    {
+        pucBuffer[ xLength++ ] = ( uint8_t ) ( usPacketId >> 8 );
+        pucBuffer[ xLength++ ] = ( uint8_t ) usPacketId;
+    }
+
+    if( xPayloadLength > 0 )
+    {
+        memcpy( &pucBuffer[ xLength ], pucPayload, xPayloadLength );
+        xLength += xPayloadLength;
+    }
+
+    return xLength;
+}
+/*-----------------------------------------------------------*/
+
+size_t StandinMqtt_EncodeAck( uint8_t * pucBuffer,
+                              size_t xBufferSize,
+                              uint8_t ucType,
+                              uint16_t usPacketId )
+{
+    size_t xLength = prvEncodeHeader( pucBuffer, xBufferSize, ( uint8_t ) ( ucType << 4 ), 2 );
+
+    if( ( xLength == 0 ) || ( xLength + 2 > xBufferSize ) )
+    {
+        return 0;
+    }
+
+    pucBuffer[ xLength++ ] = ( uint8_t ) ( usPacketId >> 8 );
+    pucBuffer[ xLength++ ] = ( uint8_t ) usPacketId;
+
+    return xLength;
+}
+/*-----------------------------------------------------------*/
+
+size_t StandinMqtt_EncodeSuback( uint8_t * pucBuffer,
+                                 size_t xBufferSize,
+                                 uint16_t usPacketId,
+                                 const uint8_t * pucReturnCodes,
+                                 uint32_t ulCount )
+{
+    size_t xLength = prvEncodeHeader( pucBuffer, xBufferSize, STANDIN_MQTT_SUBACK << 4, 2 + ulCount );
+
+    if( ( xLength == 0 ) || ( xLength + 2 + ulCount > xBufferSize ) )
+    {
+        return 0;
+    }
+
+    pucBuffer[ xLength++ ] = ( uint8_t ) ( usPacketId >> 8 );
+    pucBuffer[ xLength++ ] = ( uint8_t ) usPacketId;
+    memcpy( &pucBuffer[ xLength ], pucReturnCodes, ulCount );
+
+    return xLength + ulCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t StandinMqtt_EncodePingresp( uint8_t * pucBuffer,
+                                   size_t xBufferSize )
+{
+    return prvEncodeHeader( pucBuffer, xBufferSize, STANDIN_MQTT_PINGRESP << 4, 0 );
+}
+/*-----------------------------------------------------------*/
+
+bool StandinSpan_Equals( const StandinSpan_t * pxSpan,
+                         const char * pcString )
+{
+    return ( strlen( pcString ) == pxSpan->xLength ) &&
+           ( memcmp( pxSpan->pcData, pcString, pxSpan->xLength ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+bool StandinSpan_StartsWith( const StandinSpan_t * pxSpan,
+                             const char * pcPrefix )
+{
+    size_t xPrefixLength = strlen( pcPrefix );
+
+    return ( xPrefixLength <= pxSpan->xLength ) &&
+           ( memcmp( pxSpan->pcData, pcPrefix, xPrefixLength ) == 0 );
+}
+/*-----------------------------------------------------------*/
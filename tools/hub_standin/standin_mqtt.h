@@ -0,0 +1,155 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file standin_mqtt.h
+ * @brief The subset of MQTT 3.1.1 used by the Azure IoT middleware.
+ *
+ * Decoding works on a buffer holding whole packets and never copies, the
+ * strings of a decoded packet point into that buffer.
+ */
+
+#ifndef STANDIN_MQTT_H
+#define STANDIN_MQTT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STANDIN_MQTT_CONNECT        ( 1U )
+#define STANDIN_MQTT_CONNACK        ( 2U )
+#define STANDIN_MQTT_PUBLISH        ( 3U )
+#define STANDIN_MQTT_PUBACK         ( 4U )
+#define STANDIN_MQTT_SUBSCRIBE      ( 8U )
+#define STANDIN_MQTT_SUBACK         ( 9U )
+#define STANDIN_MQTT_UNSUBSCRIBE    ( 10U )
+#define STANDIN_MQTT_UNSUBACK       ( 11U )
+#define STANDIN_MQTT_PINGREQ        ( 12U )
+#define STANDIN_MQTT_PINGRESP       ( 13U )
+#define STANDIN_MQTT_DISCONNECT     ( 14U )
+
+/**
+ * @brief Most topic filters accepted in one SUBSCRIBE or UNSUBSCRIBE.
+ */
+#define STANDIN_MQTT_MAX_FILTERS    ( 8U )
+
+/**
+ * @brief Length delimited string pointing into a packet.
+ */
+typedef struct StandinSpan
+{
+    const char * pcData;
+    size_t xLength;
+} StandinSpan_t;
+
+/**
+ * @brief A decoded packet. Only the members of its type are set.
+ */
+typedef struct StandinMqttPacket
+{
+    uint8_t ucType;
+    uint8_t ucFlags;
+    uint16_t usPacketId;
+
+    /* CONNECT */
+    StandinSpan_t xClientId;
+    StandinSpan_t xUsername;
+    StandinSpan_t xPassword;
+    uint16_t usKeepAliveS;
+    bool xCleanSession;
+
+    /* PUBLISH */
+    StandinSpan_t xTopic;
+    const uint8_t * pucPayload;
+    size_t xPayloadLength;
+    uint8_t ucQoS;
+
+    /* SUBSCRIBE and UNSUBSCRIBE */
+    StandinSpan_t xFilters[ STANDIN_MQTT_MAX_FILTERS ];
+    uint8_t ucFilterQoS[ STANDIN_MQTT_MAX_FILTERS ];
+    uint32_t ulFilterCount;
+} StandinMqttPacket_t;
+
+/**
+ * @brief Result of decoding.
+ */
+typedef enum StandinMqttStatus
+{
+    eStandinMqttSuccess = 0,
+    eStandinMqttNeedMore,    /**< The buffer does not hold a whole packet yet. */
+    eStandinMqttMalformed    /**< Protocol violation, the connection must be closed. */
+} StandinMqttStatus_t;
+
+/**
+ * @brief Decode the packet at the start of a buffer.
+ *
+ * @param[in] pucBuffer Received bytes.
+ * @param[in] xLength Number of bytes in @p pucBuffer.
+ * @param[out] pxPacket Decoded packet.
+ * @param[out] pxPacketLength Bytes taken by the packet.
+ * @return #eStandinMqttSuccess, or why no packet was decoded.
+ */
+StandinMqttStatus_t StandinMqtt_Decode( const uint8_t * pucBuffer,
+                                        size_t xLength,
+                                        StandinMqttPacket_t * pxPacket,
+                                        size_t * pxPacketLength );
+
+/**
+ * @brief Encode a CONNACK.
+ *
+ * @return Packet length, 0 if @p xBufferSize is too small. Same for every
+ * encoder below.
+ */
+size_t StandinMqtt_EncodeConnack( uint8_t * pucBuffer,
+                                  size_t xBufferSize,
+                                  bool xSessionPresent,
+                                  uint8_t ucReturnCode );
+
+/**
+ * @brief Encode a PUBLISH, with a packet ID when @p ucQoS is 1.
+ */
+size_t StandinMqtt_EncodePublish( uint8_t * pucBuffer,
+                                  size_t xBufferSize,
+                                  const char * pcTopic,
+                                  size_t xTopicLength,
+                                  const uint8_t * pucPayload,
+                                  size_t xPayloadLength,
+                                  uint8_t ucQoS,
+                                  uint16_t usPacketId );
+
+/**
+ * @brief Encode a PUBACK or UNSUBACK, which only carry a packet ID.
+ */
+size_t StandinMqtt_EncodeAck( uint8_t * pucBuffer,
+                              size_t xBufferSize,
+                              uint8_t ucType,
+                              uint16_t usPacketId );
+
+/**
+ * @brief Encode a SUBACK granting the requested QoS of every filter.
+ */
+size_t StandinMqtt_EncodeSuback( uint8_t * pucBuffer,
+                                 size_t xBufferSize,
+                                 uint16_t usPacketId,
+                                 const uint8_t * pucReturnCodes,
+                                 uint32_t ulCount );
+
+/**
+ * @brief Encode a PINGRESP.
+ */
+size_t StandinMqtt_EncodePingresp( uint8_t * pucBuffer,
+                                   size_t xBufferSize );
+
+/**
+ * @brief Whether a span equals a NUL terminated string.
+ */
+bool StandinSpan_Equals( const StandinSpan_t * pxSpan,
+                         const char * pcString );
+
+/**
+ * @brief Whether a span starts with a NUL terminated string.
+ */
+bool StandinSpan_StartsWith( const StandinSpan_t * pxSpan,
+                             const char * pcPrefix );
+
+#endif /* STANDIN_MQTT_H */
@@ -0,0 +1,926 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file token_log.c
+ * @brief Dictionary and decoder of the tokenised logs of token_log.h.
+ *
+ * Usage:
+ *
+ *     token_log database <output.tokens> <image.elf>...
+ *     token_log decode <dictionary.tokens> [<log>]
+ *
+ * database reads the formats in the .tokenlog section of the images and
+ * writes one line per format, its token in hex, a space and the format with C
+ * escapes. decode copies the log, from standard input without a file, to
+ * standard output with each '$' message replaced by its text.
+ *
+ * The token and message layouts are described in token_log_hash.h and
+ * token_log.c of demos/common/utilities. Reads little endian ELF files of 32
+ * or 64 bits. Runs on the host, without FreeRTOS.
+ */
+
+/* Standard includes. */
+#include <elf.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*-----------------------------------------------------------*/
+
+#define tokenlogSECTION_NAME         ".tokenlog"
+
+/* Same as token_log_hash.h. */
+#define tokenlogHASH_LENGTH          ( 128U )
+#define tokenlogHASH_MULTIPLIER      ( 65599U )
+
+#define tokenlogMAX_ARGS             ( 16U )
+#define tokenlogMAX_STRING_LENGTH    ( 255U )
+#define tokenlogMAX_LINE_LENGTH      ( 4096U )
+
+#define tokenlogKIND_INTEGER         ( 0U )
+#define tokenlogKIND_DOUBLE          ( 1U )
+#define tokenlogKIND_STRING          ( 2U )
+
+typedef struct TokenLogEntry
+{
+    uint32_t ulToken;
+    char * pcFormat;
+} TokenLogEntry_t;
+
+typedef struct TokenLogDictionary
+{
+    TokenLogEntry_t * pxEntries;
+    size_t xCount;
+    size_t xCapacity;
+} TokenLogDictionary_t;
+
+typedef struct TokenLogValue
+{
+    uint32_t ulKind;
+    int64_t llInteger;
+    double xDouble;
+    char cString[ tokenlogMAX_STRING_LENGTH + 1 ];
+    size_t xStringLength;
+    bool xTruncated;
+    bool xNull;
+} TokenLogValue_t;
+
+typedef struct TokenLogMessage
+{
+    uint32_t ulToken;
+    TokenLogValue_t xArgs[ tokenlogMAX_ARGS ];
+    uint32_t ulArgCount; /**< @brief Arguments received, fewer than sent if the message was cut. */
+} TokenLogMessage_t;
+
+static TokenLogDictionary_t xDictionary;
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHash( const char * pcFormat,
+                         size_t xLength )
+{
+    uint32_t ulHash = ( uint32_t ) xLength;
+    uint32_t ulCoefficient = tokenlogHASH_MULTIPLIER;
+    size_t xIndex;
+
+    for( xIndex = 0; ( xIndex < xLength ) && ( xIndex < tokenlogHASH_LENGTH ); xIndex++ )
+    {
+        ulHash += ulCoefficient * ( uint8_t ) pcFormat[ xLength - 1 - xIndex ];
+        ulCoefficient *= tokenlogHASH_MULTIPLIER;
+    }
+
+    return ulHash;
+}
+/*-----------------------------------------------------------*/
+
+static int prvCompareEntries( const void * pvFirst,
+                              const void * pvSecond )
+{
+    const TokenLogEntry_t * pxFirst = pvFirst;
+    const TokenLogEntry_t * pxSecond = pvSecond;
+
+    if( pxFirst->ulToken != pxSecond->ulToken )
+    {
+        return ( pxFirst->ulToken < pxSecond->ulToken ) ? -1 : 1;
+    }
+
+    return strcmp( pxFirst->pcFormat, pxSecond->pcFormat );
+}
+/*-----------------------------------------------------------*/
+
+static bool prvAddEntry( uint32_t ulToken,
+                         const char * pcFormat )
+{
+    TokenLogEntry_t * pxEntries;
+
+    if( xDictionary.xCount == xDictionary.xCapacity )
+    {
+        xDictionary.xCapacity = ( xDictionary.xCapacity == 0 ) ? 256 : xDictionary.xCapacity * 2;
+        pxEntries = realloc( xDictionary.pxEntries, xDictionary.xCapacity * sizeof( *pxEntries ) );
+
+        if( pxEntries == NULL )
+        {
+            return false;
+        }
+
+        xDictionary.pxEntries = pxEntries;
+    }
+
+    xDictionary.pxEntries[ xDictionary.xCount ].ulToken = ulToken;
+    xDictionary.pxEntries[ xDictionary.xCount ].pcFormat = strdup( pcFormat );
+
+    return xDictionary.pxEntries[ xDictionary.xCount++ ].pcFormat != NULL;
+}
+/*-----------------------------------------------------------*/
+
+static const char * prvFindFormat( uint32_t ulToken )
+{
+    TokenLogEntry_t xKey = { ulToken, "" };
+    const TokenLogEntry_t * pxEntry;
+    size_t xLow = 0;
+    size_t xHigh = xDictionary.xCount;
+    size_t xMiddle;
+
+    /* The first entry of the token, sorted by token then format. */
+    while( xLow < xHigh )
+    {
+        xMiddle = ( xLow + xHigh ) / 2;
+
+        if( prvCompareEntries( &xDictionary.pxEntries[ xMiddle ], &xKey ) < 0 )
+        {
+            xLow = xMiddle + 1;
+        }
+        else
+        {
+            xHigh = xMiddle;
+        }
+    }
+
+    pxEntry = &xDictionary.pxEntries[ xLow ];
+
+    return ( ( xLow < xDictionary.xCount ) && ( pxEntry->ulToken == ulToken ) ) ? pxEntry->pcFormat : NULL;
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t * prvReadFile( const char * pcPath,
+                              size_t * pxLength )
+{
+    FILE * pxStream = fopen( pcPath, "rb" );
+    uint8_t * pucContent = NULL;
+    long lLength;
+
+    if( pxStream == NULL )
+    {
+        return NULL;
+    }
+
+    if( ( fseek( pxStream, 0, SEEK_END ) == 0 ) && ( ( lLength = ftell( pxStream ) ) > 0 ) &&
+        ( fseek( pxStream, 0, SEEK_SET ) == 0 ) && ( ( pucContent = malloc( ( size_t ) lLength ) ) != NULL ) )
+    {
+        if( fread( pucContent, 1, ( size_t ) lLength, pxStream ) == ( size_t ) lLength )
+        {
+            *pxLength = ( size_t ) lLength;
+        }
+        else
+        {
+            free( pucContent );
+            pucContent = NULL;
+        }
+    }
+
+    fclose( pxStream );
+
+    return pucContent;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Find the formats section of an ELF image.
+ *
+ * @return The offset of the section in the file, its size in @p pxSize, or
+ * 0 if there is none.
+ */
+static size_t prvFindSection( const uint8_t * pucImage,
+                              size_t xImageLength,
+                              size_t * pxSize )
+{
+    Elf64_Ehdr xHeader64;
+    Elf32_Ehdr xHeader32;
+    Elf64_Shdr xSection64;
+    Elf32_Shdr xSection32;
+    uint64_t ullSectionsOffset;
+    uint64_t ullNamesOffset = 0;
+    uint64_t ullOffset;
+    uint64_t ullSize;
+    uint32_t ulName;
+    size_t xSectionSize;
+    size_t xCount;
+    size_t xIndex;
+    size_t xNamesIndex;
+    bool x64 = ( pucImage[ EI_CLASS ] == ELFCLASS64 );
+
+    if( ( xImageLength < sizeof( xHeader64 ) ) || ( memcmp( pucImage, ELFMAG, SELFMAG ) != 0 ) ||
+        ( pucImage[ EI_DATA ] != ELFDATA2LSB ) )
+    {
+        return 0;
+    }
+
+    if( x64 )
+    {
+        memcpy( &xHeader64, pucImage, sizeof( xHeader64 ) );
+        ullSectionsOffset = xHeader64.e_shoff;
+        xCount = xHeader64.e_shnum;
+        xNamesIndex = xHeader64.e_shstrndx;
+        xSectionSize = sizeof( xSection64 );
+    }
+    else
+    {
+        memcpy( &xHeader32, pucImage, sizeof( xHeader32 ) );
+        ullSectionsOffset = xHeader32.e_shoff;
+        xCount = xHeader32.e_shnum;
+        xNamesIndex = xHeader32.e_shstrndx;
+        xSectionSize = sizeof( xSection32 );
+    }
+
+    if( ( xNamesIndex >= xCount ) || ( ullSectionsOffset + xCount * xSectionSize > xImageLength ) )
+    {
+        return 0;
+    }
+
+    /* The section names first, then the section with ours. */
+    for( xIndex = 0; xIndex <= xCount; xIndex++ )
+    {
+        const uint8_t * pucSection = &pucImage[ ullSectionsOffset + ( ( xIndex == 0 ) ? xNamesIndex : xIndex - 1 ) * xSectionSize ];
+
+        if( x64 )
+        {
+            memcpy( &xSection64, pucSection, sizeof( xSection64 ) );
+            ulName = xSection64.sh_name;
+            ullOffset = xSection64.sh_offset;
+            ullSize = xSection64.sh_size;
+        }
+        else
+        {
+            memcpy( &xSection32, pucSection, sizeof( xSection32 ) );
+            ulName = xSection32.sh_name;
+            ullOffset = xSection32.sh_offset;
+            ullSize = xSection32.sh_size;
+        }
+
+        if( ullOffset + ullSize > xImageLength )
+        {
+            return 0;
+        }
+
+        if( xIndex == 0 )
+        {
+            ullNamesOffset = ullOffset;
+        }
+        else if( ( ullNamesOffset + ulName + sizeof( tokenlogSECTION_NAME ) <= xImageLength ) &&
+                 ( memcmp( &pucImage[ ullNamesOffset + ulName ], tokenlogSECTION_NAME,
+                           sizeof( tokenlogSECTION_NAME ) ) == 0 ) )
+        {
+            *pxSize = ( size_t ) ullSize;
+
+            return ( size_t ) ullOffset;
+        }
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteEscaped( FILE * pxStream,
+                             const char * pcText )
+{
+    for( ; *pcText != '\0'; pcText++ )
+    {
+        switch( *pcText )
+        {
+            case '\\':
+                fputs( "\\\\", pxStream );
+                break;
+
+            case '\r':
+                fputs( "\\r", pxStream );
+                break;
+
+            case '\n':
+                fputs( "\\n", pxStream );
+                break;
+
+            case '\t':
+                fputs( "\\t", pxStream );
+                break;
+
+            default:
+
+                if( ( ( unsigned char ) *pcText < 0x20 ) || ( ( unsigned char ) *pcText >= 0x7F ) )
+                {
+                    fprintf( pxStream, "\\x%02x", ( unsigned char ) *pcText );
+                }
+                else
+                {
+                    fputc( *pcText, pxStream );
+                }
+
+                break;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Undo prvWriteEscaped in place.
+ */
+static void prvUnescape( char * pcText )
+{
+    char * pcOutput = pcText;
+    unsigned int ulByte;
+
+    for( ; *pcText != '\0'; pcText++ )
+    {
+        if( ( *pcText != '\\' ) || ( pcText[ 1 ] == '\0' ) )
+        {
+            *pcOutput++ = *pcText;
+            continue;
+        }
+
+        switch( *++pcText )
+        {
+            case 'r':
+                *pcOutput++ = '\r';
+                break;
+
+            case 'n':
+                *pcOutput++ = '\n';
+                break;
+
+            case 't':
+                *pcOutput++ = '\t';
+                break;
+
+            case 'x':
+
+                if( sscanf( pcText + 1, "%2x", &ulByte ) == 1 )
+                {
+                    *pcOutput++ = ( char ) ulByte;
+                    pcText += 2;
+                }
+
+                break;
+
+            default:
+                *pcOutput++ = *pcText;
+                break;
+        }
+    }
+
+    *pcOutput = '\0';
+}
+/*-----------------------------------------------------------*/
+
+static int prvDatabase( const char * pcOutputPath,
+                        char ** ppcImagePaths,
+                        int lImageCount )
+{
+    FILE * pxOutput;
+    uint8_t * pucImage;
+    size_t xImageLength;
+    size_t xOffset;
+    size_t xSize = 0;
+    size_t xPosition;
+    size_t xLength;
+    size_t xIndex;
+    int lImage;
+
+    for( lImage = 0; lImage < lImageCount; lImage++ )
+    {
+        if( ( pucImage = prvReadFile( ppcImagePaths[ lImage ], &xImageLength ) ) == NULL )
+        {
+            fprintf( stderr, "Cannot read %s\n", ppcImagePaths[ lImage ] );
+
+            return 1;
+        }
+
+        if( ( xOffset = prvFindSection( pucImage, xImageLength, &xSize ) ) == 0 )
+        {
+            fprintf( stderr, "%s has no " tokenlogSECTION_NAME " section\n", ppcImagePaths[ lImage ] );
+            free( pucImage );
+
+            return 1;
+        }
+
+        /* Formats end with their terminator, alignment may add empty ones. */
+        for( xPosition = 0; xPosition < xSize; xPosition += xLength + 1 )
+        {
+            xLength = strnlen( ( const char * ) &pucImage[ xOffset + xPosition ], xSize - xPosition );
+
+            if( ( xLength > 0 ) && ( xPosition + xLength < xSize ) &&
+                !prvAddEntry( prvHash( ( const char * ) &pucImage[ xOffset + xPosition ], xLength ),
+                              ( const char * ) &pucImage[ xOffset + xPosition ] ) )
+            {
+                free( pucImage );
+
+                return 1;
+            }
+        }
+
+        free( pucImage );
+    }
+
+    qsort( xDictionary.pxEntries, xDictionary.xCount, sizeof( TokenLogEntry_t ), prvCompareEntries );
+
+    if( ( pxOutput = fopen( pcOutputPath, "w" ) ) == NULL )
+    {
+        fprintf( stderr, "Cannot write %s\n", pcOutputPath );
+
+        return 1;
+    }
+
+    for( xIndex = 0; xIndex < xDictionary.xCount; xIndex++ )
+    {
+        /* The same format from several files or images. */
+        if( ( xIndex > 0 ) && ( prvCompareEntries( &xDictionary.pxEntries[ xIndex - 1 ], &xDictionary.pxEntries[ xIndex ] ) == 0 ) )
+        {
+            continue;
+        }
+
+        if( ( xIndex > 0 ) && ( xDictionary.pxEntries[ xIndex - 1 ].ulToken == xDictionary.pxEntries[ xIndex ].ulToken ) )
+        {
+            fprintf( stderr, "Token %08" PRIx32 " of several formats, decoded as the first\n", xDictionary.pxEntries[ xIndex ].ulToken );
+        }
+
+        fprintf( pxOutput, "%08" PRIx32 " ", xDictionary.pxEntries[ xIndex ].ulToken );
+        prvWriteEscaped( pxOutput, xDictionary.pxEntries[ xIndex ].pcFormat );
+        fputc( '\n', pxOutput );
+    }
+
+    return ( fclose( pxOutput ) == 0 ) ? 0 : 1;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvLoadDictionary( const char * pcPath )
+{
+    FILE * pxStream = fopen( pcPath, "r" );
+    char cLine[ tokenlogMAX_LINE_LENGTH ];
+    unsigned long ulToken;
+    char * pcFormat;
+    bool xResult = ( pxStream != NULL );
+
+    while( xResult && ( fgets( cLine, sizeof( cLine ), pxStream ) != NULL ) )
+    {
+        cLine[ strcspn( cLine, "\n" ) ] = '\0';
+        ulToken = strtoul( cLine, &pcFormat, 16 );
+
+        if( ( pcFormat == cLine ) || ( *pcFormat != ' ' ) )
+        {
+            continue;
+        }
+
+        prvUnescape( ++pcFormat );
+        xResult = prvAddEntry( ( uint32_t ) ulToken, pcFormat );
+    }
+
+    if( pxStream != NULL )
+    {
+        fclose( pxStream );
+    }
+
+    if( !xResult )
+    {
+        fprintf( stderr, "Cannot read %s\n", pcPath );
+    }
+
+    qsort( xDictionary.pxEntries, xDictionary.xCount, sizeof( TokenLogEntry_t ), prvCompareEntries );
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+static int prvBase64Value( char cDigit )
+{
+    const char * pcDigit;
+    static const char cDigits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    if( ( cDigit == '\0' ) || ( ( pcDigit = strchr( cDigits, cDigit ) ) == NULL ) )
+    {
+        return -1;
+    }
+
+    return ( int ) ( pcDigit - cDigits );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Decode base64 up to the first character that is not.
+ *
+ * @return The number of characters read.
+ */
+static size_t prvDecodeBase64( const char * pcText,
+                               uint8_t * pucOutput,
+                               size_t xOutputSize,
+                               size_t * pxOutputLength )
+{
+    uint32_t ulBits = 0;
+    size_t xBits = 0;
+    size_t xRead = 0;
+    int lValue;
+
+    *pxOutputLength = 0;
+
+    while( ( lValue = prvBase64Value( pcText[ xRead ] ) ) >= 0 )
+    {
+        ulBits = ( ulBits << 6 ) | ( uint32_t ) lValue;
+        xBits += 6;
+        xRead++;
+
+        if( xBits >= 8 )
+        {
+            xBits -= 8;
+
+            if( *pxOutputLength < xOutputSize )
+            {
+                pucOutput[ ( *pxOutputLength )++ ] = ( uint8_t ) ( ulBits >> xBits );
+            }
+        }
+    }
+
+    while( pcText[ xRead ] == '=' )
+    {
+        xRead++;
+    }
+
+    return xRead;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvGetVarint( const uint8_t * pucMessage,
+                          size_t xLength,
+                          size_t * pxPosition,
+                          uint64_t * pullValue )
+{
+    uint32_t ulShift = 0;
+
+    *pullValue = 0;
+
+    while( ( *pxPosition < xLength ) && ( ulShift < 64 ) )
+    {
+        *pullValue |= ( uint64_t ) ( pucMessage[ *pxPosition ] & 0x7FU ) << ulShift;
+
+        if( ( pucMessage[ ( *pxPosition )++ ] & 0x80U ) == 0 )
+        {
+            return true;
+        }
+
+        ulShift += 7;
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvParseMessage( const uint8_t * pucMessage,
+                             size_t xLength,
+                             TokenLogMessage_t * pxMessage )
+{
+    TokenLogValue_t * pxValue;
+    size_t xPosition;
+    uint64_t ullValue;
+    uint32_t ulCount;
+    uint32_t ulArg;
+    uint32_t ulByte;
+
+    if( xLength < 5 )
+    {
+        return false;
+    }
+
+    pxMessage->ulToken = ( uint32_t ) pucMessage[ 0 ] | ( ( uint32_t ) pucMessage[ 1 ] << 8 ) |
+                         ( ( uint32_t ) pucMessage[ 2 ] << 16 ) | ( ( uint32_t ) pucMessage[ 3 ] << 24 );
+    ulCount = pucMessage[ 4 ];
+    xPosition = 5 + ( ulCount + 3 ) / 4;
+    pxMessage->ulArgCount = 0;
+
+    if( ( ulCount > tokenlogMAX_ARGS ) || ( xPosition > xLength ) )
+    {
+        return false;
+    }
+
+    for( ulArg = 0; ulArg < ulCount; ulArg++ )
+    {
+        pxValue = &pxMessage->xArgs[ ulArg ];
+        memset( pxValue, 0, sizeof( *pxValue ) );
+        pxValue->ulKind = ( pucMessage[ 5 + ulArg / 4 ] >> ( ( ulArg % 4 ) * 2 ) ) & 0x3U;
+
+        if( pxValue->ulKind == tokenlogKIND_DOUBLE )
+        {
+            if( xPosition + sizeof( ullValue ) > xLength )
+            {
+                break;
+            }
+
+            for( ullValue = 0, ulByte = 0; ulByte < sizeof( ullValue ); ulByte++ )
+            {
+                ullValue |= ( uint64_t ) pucMessage[ xPosition++ ] << ( ulByte * 8 );
+            }
+
+            memcpy( &pxValue->xDouble, &ullValue, sizeof( pxValue->xDouble ) );
+        }
+        else if( !prvGetVarint( pucMessage, xLength, &xPosition, &ullValue ) )
+        {
+            break;
+        }
+        else if( pxValue->ulKind == tokenlogKIND_STRING )
+        {
+            pxValue->xStringLength = ( size_t ) ( ullValue >> 2 );
+            pxValue->xTruncated = ( ( ullValue & 2U ) != 0 );
+            pxValue->xNull = ( ( ullValue & 1U ) != 0 );
+
+            if( ( pxValue->xStringLength > tokenlogMAX_STRING_LENGTH ) ||
+                ( xPosition + pxValue->xStringLength > xLength ) )
+            {
+                break;
+            }
+
+            memcpy( pxValue->cString, &pucMessage[ xPosition ], pxValue->xStringLength );
+            xPosition += pxValue->xStringLength;
+        }
+        else
+        {
+            pxValue->llInteger = ( int64_t ) ( ullValue >> 1 ) ^ -( int64_t ) ( ullValue & 1U );
+        }
+
+        pxMessage->ulArgCount++;
+    }
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Print one conversion, @p pcSpecification is its flags, width and
+ * precision with '*' already replaced.
+ */
+static void prvPrintConversion( FILE * pxOutput,
+                                const char * pcSpecification,
+                                const char * pcLengthModifier,
+                                char cConversion,
+                                const TokenLogValue_t * pxValue )
+{
+    char cFormat[ 64 ];
+    int64_t llValue = pxValue->llInteger;
+    uint64_t ullValue = ( uint64_t ) llValue;
+    bool xLong = ( strpbrk( pcLengthModifier, "ljztq" ) != NULL );
+
+    if( pxValue->ulKind == tokenlogKIND_STRING )
+    {
+        /* A string for any conversion, as a %p of a char pointer. */
+        snprintf( cFormat, sizeof( cFormat ), "%%%ss%s", pcSpecification, pxValue->xTruncated ? "[...]" : "" );
+        fprintf( pxOutput, cFormat, pxValue->xNull ? "(null)" : pxValue->cString );
+
+        return;
+    }
+
+    if( pxValue->ulKind == tokenlogKIND_DOUBLE )
+    {
+        snprintf( cFormat, sizeof( cFormat ), "%%%s%c", pcSpecification, strchr( "fFeEgGaA", cConversion ) ? cConversion : 'g' );
+        fprintf( pxOutput, cFormat, pxValue->xDouble );
+
+        return;
+    }
+
+    switch( cConversion )
+    {
+        case 'd':
+        case 'i':
+
+            if( !xLong )
+            {
+                llValue = ( strcmp( pcLengthModifier, "hh" ) == 0 ) ? ( signed char ) llValue :
+                          ( strcmp( pcLengthModifier, "h" ) == 0 ) ? ( short ) llValue : ( int32_t ) llValue;
+            }
+
+            snprintf( cFormat, sizeof( cFormat ), "%%%s" PRId64, pcSpecification );
+            fprintf( pxOutput, cFormat, llValue );
+            break;
+
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+
+            if( !xLong )
+            {
+                ullValue = ( strcmp( pcLengthModifier, "hh" ) == 0 ) ? ( uint8_t ) ullValue :
+                           ( strcmp( pcLengthModifier, "h" ) == 0 ) ? ( uint16_t ) ullValue : ( uint32_t ) ullValue;
+            }
+
+            snprintf( cFormat, sizeof( cFormat ), "%%%s%s", pcSpecification,
+                      ( cConversion == 'u' ) ? PRIu64 : ( cConversion == 'o' ) ? PRIo64 : ( cConversion == 'x' ) ? PRIx64 : PRIX64 );
+            fprintf( pxOutput, cFormat, ullValue );
+            break;
+
+        case 'c':
+            snprintf( cFormat, sizeof( cFormat ), "%%%sc", pcSpecification );
+            fprintf( pxOutput, cFormat, ( int ) ( unsigned char ) llValue );
+            break;
+
+        case 'p':
+            snprintf( cFormat, sizeof( cFormat ), "0x%%%s" PRIx64, pcSpecification );
+            fprintf( pxOutput, cFormat, ullValue );
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            snprintf( cFormat, sizeof( cFormat ), "%%%s%c", pcSpecification, cConversion );
+            fprintf( pxOutput, cFormat, ( double ) llValue );
+            break;
+
+        default:
+            snprintf( cFormat, sizeof( cFormat ), "%%%s" PRId64, pcSpecification );
+            fprintf( pxOutput, cFormat, llValue );
+            break;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Print the text of a message, as printf would with its arguments.
+ */
+static void prvPrintMessage( FILE * pxOutput,
+                             const char * pcFormat,
+                             const TokenLogMessage_t * pxMessage )
+{
+    char cSpecification[ 48 ];
+    char cLengthModifier[ 3 ];
+    size_t xSpecificationLength;
+    size_t xModifierLength;
+    uint32_t ulArg = 0;
+
+    while( *pcFormat != '\0' )
+    {
+        if( *pcFormat != '%' )
+        {
+            fputc( *pcFormat++, pxOutput );
+            continue;
+        }
+
+        if( *++pcFormat == '%' )
+        {
+            fputc( *pcFormat++, pxOutput );
+            continue;
+        }
+
+        /* Flags, width and precision, with the '*' from the arguments. */
+        xSpecificationLength = 0;
+
+        while( ( *pcFormat != '\0' ) && ( strchr( "-+ #0123456789.*", *pcFormat ) != NULL ) &&
+               ( xSpecificationLength + 24 < sizeof( cSpecification ) ) )
+        {
+            if( *pcFormat == '*' )
+            {
+                xSpecificationLength += ( size_t ) snprintf( &cSpecification[ xSpecificationLength ],
+                                                             sizeof( cSpecification ) - xSpecificationLength, "%d",
+                                                             ( ulArg < pxMessage->ulArgCount ) ? ( int ) pxMessage->xArgs[ ulArg ].llInteger : 0 );
+                ulArg++;
+            }
+            else
+            {
+                cSpecification[ xSpecificationLength++ ] = *pcFormat;
+            }
+
+            pcFormat++;
+        }
+
+        cSpecification[ xSpecificationLength ] = '\0';
+
+        for( xModifierLength = 0; ( xModifierLength < 2 ) && ( *pcFormat != '\0' ) &&
+             ( strchr( "hljztLq", *pcFormat ) != NULL ); xModifierLength++ )
+        {
+            cLengthModifier[ xModifierLength ] = *pcFormat++;
+        }
+
+        cLengthModifier[ xModifierLength ] = '\0';
+
+        if( *pcFormat == '\0' )
+        {
+            break;
+        }
+
+        if( *pcFormat == 'n' )
+        {
+            ulArg++;
+        }
+        else if( ulArg < pxMessage->ulArgCount )
+        {
+            prvPrintConversion( pxOutput, cSpecification, cLengthModifier, *pcFormat, &pxMessage->xArgs[ ulArg++ ] );
+        }
+        else
+        {
+            /* Left out of a message that did not fit. */
+            fputs( "<?>", pxOutput );
+            ulArg++;
+        }
+
+        pcFormat++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static int prvDecode( FILE * pxInput )
+{
+    static TokenLogMessage_t xMessage;
+    char cLine[ tokenlogMAX_LINE_LENGTH ];
+    uint8_t ucMessage[ tokenlogMAX_LINE_LENGTH ];
+    const char * pcFormat;
+    size_t xMessageLength;
+    size_t xRead;
+    size_t xIndex;
+    size_t xLength;
+
+    while( fgets( cLine, sizeof( cLine ), stdin == pxInput ? stdin : pxInput ) != NULL )
+    {
+        xLength = strcspn( cLine, "\r\n" );
+
+        for( xIndex = 0; xIndex < xLength; xIndex++ )
+        {
+            if( cLine[ xIndex ] == '$' )
+            {
+                xRead = prvDecodeBase64( &cLine[ xIndex + 1 ], ucMessage, sizeof( ucMessage ), &xMessageLength );
+
+                if( prvParseMessage( ucMessage, xMessageLength, &xMessage ) &&
+                    ( ( pcFormat = prvFindFormat( xMessage.ulToken ) ) != NULL ) )
+                {
+                    prvPrintMessage( stdout, pcFormat, &xMessage );
+                    xIndex += xRead;
+
+                    /* The format ends the line of a whole message. */
+                    if( ( xIndex + 1 == xLength ) && ( strchr( pcFormat, '\n' ) != NULL ) )
+                    {
+                        cLine[ xLength ] = '\0';
+                    }
+
+                    continue;
+                }
+            }
+
+            fputc( cLine[ xIndex ], stdout );
+        }
+
+        fputs( &cLine[ xLength ], stdout );
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    FILE * pxInput = stdin;
+    int lResult;
+
+    if( ( argc >= 4 ) && ( strcmp( argv[ 1 ], "database" ) == 0 ) )
+    {
+        return prvDatabase( argv[ 2 ], &argv[ 3 ], argc - 3 );
+    }
+
+    if( ( ( argc == 3 ) || ( argc == 4 ) ) && ( strcmp( argv[ 1 ], "decode" ) == 0 ) )
+    {
+        if( !prvLoadDictionary( argv[ 2 ] ) )
+        {
+            return 1;
+        }
+
+        if( ( argc == 4 ) && ( ( pxInput = fopen( argv[ 3 ], "r" ) ) == NULL ) )
+        {
+            fprintf( stderr, "Cannot read %s\n", argv[ 3 ] );
+
+            return 1;
+        }
+
+        lResult = prvDecode( pxInput );
+
+        if( pxInput != stdin )
+        {
+            fclose( pxInput );
+        }
+
+        return lResult;
+    }
+
+    fprintf( stderr, "Usage: %s database <output.tokens> <image.elf>...\n"
+                     "       %s decode <dictionary.tokens> [<log>]\n", argv[ 0 ], argv[ 0 ] );
+
+    return 2;
+}
+/*-----------------------------------------------------------*/